@@ -32,6 +32,7 @@ public:
 
 	const static unsigned long m_Signature = 0xCA464242;	//'BBF' + CRC of 'BBF'		
   const static unsigned short m_CurrentVersion = 2;
+  const static unsigned short m_CompressedVersion = 3;	//non-uniform bricks compressed by mafBrickedFileCodec
 
 public:
 
@@ -53,6 +54,7 @@ public:
 		unsigned char rlgrid;     //0 - regular grid, 1 - rectilinear grid => coordinates stored in the file
 
 		unsigned long long idxtblofs;	//offset to index table (in file), map is always before
+										//version 3: offsets of bricks follow the extra index items
 		unsigned long extra_idx_items;	//number of extra index items
 	} BBF_HEADER;
 
@@ -0,0 +1,201 @@
+/**=======================================================================
+
+File:    	 mafBrickedFileCache.cpp
+Language:  C++
+Date:      $Date$
+Version:   $Revision: 1.1.2.1 $
+
+Copyright (c) 2008
+University of Bedfordshire
+=========================================================================
+Process-wide LRU cache of bricks loaded from BBF files
+=========================================================================*/
+
+#include "mafDefines.h"
+//----------------------------------------------------------------------------
+// NOTE: Every CPP file in the MAF must include "mafDefines.h" as first.
+// This force to include Window,wxWidgets and VTK exactly in this order.
+// Failing in doing this will result in a run-time error saying:
+// "Failure#0: The value of ESP was not properly saved across a function call"
+//----------------------------------------------------------------------------
+
+#include "mafBrickedFileCache.h"
+#include "mafMemDbg.h"
+
+#define BBF_CACHE_DEFAULT_LIMIT   262144    //256 MB
+
+mafBrickedFileCache::mafBrickedFileCache()
+{
+  m_NextFileId = 0;
+  m_MemoryLimit = ((unsigned long long)BBF_CACHE_DEFAULT_LIMIT)*1024;
+  m_MemoryUsed = 0;
+  m_NHits = m_NMisses = 0;
+}
+
+mafBrickedFileCache::~mafBrickedFileCache()
+{
+  for (CACHE_MAP::iterator it = m_Items.begin(); it != m_Items.end(); ++it) {
+    delete[] it->second.pData;
+  }
+}
+
+//returns the process-wide instance of the cache
+/*static*/ mafBrickedFileCache* mafBrickedFileCache::GetInstance()
+{
+  static mafBrickedFileCache instance;
+  return &instance;
+}
+
+//returns identifier of the given BBF file to be used in keys
+int mafBrickedFileCache::RegisterFile(const char* fname, unsigned long long nStamp)
+{
+  wxMutexLocker lock(m_Mutex);
+
+  FILES_MAP::iterator itFile = m_Files.find(fname);
+  if (itFile != m_Files.end())
+  {
+    if (itFile->second.nStamp == nStamp)
+      return itFile->second.nFileId;
+
+    //the file was changed, give it a new identifier, so that stale bricks
+    //are never returned; they will be released as they are unlocked
+    int nOldId = itFile->second.nFileId;
+    for (CACHE_MAP::iterator it = m_Items.begin(); it != m_Items.end(); )
+    {
+      CACHE_MAP::iterator itCur = it++;
+      if (itCur->first.nFileId == nOldId && itCur->second.nLocks == 0)
+        RemoveItem(itCur);
+    }
+  }
+
+  BBF_CACHE_FILE& file = m_Files[fname];
+  file.nFileId = m_NextFileId++;
+  file.nStamp = nStamp;
+  return file.nFileId;
+}
+
+//finds the brick in the cache and locks it
+const char* mafBrickedFileCache::Lock(const BBF_CACHE_KEY& key)
+{
+  wxMutexLocker lock(m_Mutex);
+
+  CACHE_MAP::iterator it = m_Items.find(key);
+  if (it == m_Items.end())
+  {
+    m_NMisses++;
+    return NULL;
+  }
+
+  m_NHits++;
+  it->second.nLocks++;
+
+  //move the item to the front of LRU list
+  m_LRU.splice(m_LRU.begin(), m_LRU, it->second.lruPos);
+  return it->second.pData;
+}
+
+//unlocks the brick previously returned by Lock or Insert
+void mafBrickedFileCache::Unlock(const BBF_CACHE_KEY& key)
+{
+  wxMutexLocker lock(m_Mutex);
+
+  CACHE_MAP::iterator it = m_Items.find(key);
+  if (it != m_Items.end() && it->second.nLocks > 0)
+  {
+    it->second.nLocks--;
+
+    //the limit might have been lowered while the item was in use
+    if (m_MemoryUsed > m_MemoryLimit)
+      ReleaseLRU(0);
+  }
+}
+
+//stores a copy of nSize bytes of pData under the given key
+const char* mafBrickedFileCache::Insert(const BBF_CACHE_KEY& key, const char* pData,
+                                        int nSize, bool bLock)
+{
+  wxMutexLocker lock(m_Mutex);
+
+  CACHE_MAP::iterator it = m_Items.find(key);
+  if (it == m_Items.end())
+  {
+    if ((unsigned long long)nSize > m_MemoryLimit)
+      return NULL;  //never fits
+
+    ReleaseLRU(nSize);
+    if (m_MemoryUsed + nSize > m_MemoryLimit)
+      return NULL;  //all cached bricks are locked
+
+    BBF_CACHE_ITEM item;
+    item.pData = new char[nSize];
+    item.nSize = nSize;
+    item.nLocks = 0;
+    memcpy(item.pData, pData, nSize);
+
+    m_LRU.push_front(key);
+    item.lruPos = m_LRU.begin();
+
+    it = m_Items.insert(CACHE_MAP::value_type(key, item)).first;
+    m_MemoryUsed += nSize;
+  }
+
+  if (bLock)
+    it->second.nLocks++;
+
+  return it->second.pData;
+}
+
+//releases all unlocked bricks
+void mafBrickedFileCache::Clear()
+{
+  wxMutexLocker lock(m_Mutex);
+
+  for (CACHE_MAP::iterator it = m_Items.begin(); it != m_Items.end(); )
+  {
+    CACHE_MAP::iterator itCur = it++;
+    if (itCur->second.nLocks == 0)
+      RemoveItem(itCur);
+  }
+}
+
+//sets the memory limit in kilobytes (0 disables caching)
+void mafBrickedFileCache::SetMemoryLimit(unsigned long nLimitKB)
+{
+  wxMutexLocker lock(m_Mutex);
+
+  m_MemoryLimit = ((unsigned long long)nLimitKB)*1024;
+  ReleaseLRU(0);
+}
+
+//resets the hit/miss counters
+void mafBrickedFileCache::ResetStatistics()
+{
+  wxMutexLocker lock(m_Mutex);
+  m_NHits = m_NMisses = 0;
+}
+
+//releases the least recently used unlocked items until nRequired more bytes fit into the limit
+void mafBrickedFileCache::ReleaseLRU(unsigned long long nRequired)
+{
+  LRU_LIST::iterator itLRU = m_LRU.end();
+  while (m_MemoryUsed + nRequired > m_MemoryLimit && itLRU != m_LRU.begin())
+  {
+    --itLRU;
+
+    CACHE_MAP::iterator it = m_Items.find(*itLRU);
+    if (it->second.nLocks == 0)
+    {
+      itLRU++;        //RemoveItem invalidates the current position
+      RemoveItem(it);
+    }
+  }
+}
+
+//removes the item from the cache
+void mafBrickedFileCache::RemoveItem(CACHE_MAP::iterator it)
+{
+  m_MemoryUsed -= it->second.nSize;
+  m_LRU.erase(it->second.lruPos);
+  delete[] it->second.pData;
+  m_Items.erase(it);
+}
@@ -0,0 +1,146 @@
+/**=======================================================================
+
+  File:    	 mafBrickedFileCache.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision: 1.1.2.1 $
+
+  Copyright (c) 2008
+  University of Bedfordshire
+=========================================================================
+Process-wide cache of bricks loaded from BBF files. Bricks are identified
+by (file, level, brick index), so that all mafBrickedFileReader instances
+(all LOD levels of mafVolumeLargeReader and all views) share the data.
+When the memory budget is exceeded, the least recently used bricks
+are released. Only non-uniform bricks are stored; uniform bricks are
+kept as a single value in the low resolution level of the reader.
+=========================================================================*/
+
+#ifndef __mafBrickedFileCache__
+#define __mafBrickedFileCache__
+
+#include <wx/thread.h>
+#include <map>
+#include <list>
+#include <string>
+
+class mafBrickedFileCache
+{
+public:
+  //key identifying one brick
+  typedef struct BBF_CACHE_KEY
+  {
+    int nFileId;        //file identifier returned by RegisterFile
+    int nLevel;         //LOD level (sample rate) of the file
+    int nBrickIndex;    //index of the brick in the file
+
+    inline bool operator < (const BBF_CACHE_KEY& key) const
+    {
+      if (nFileId != key.nFileId)
+        return nFileId < key.nFileId;
+      if (nLevel != key.nLevel)
+        return nLevel < key.nLevel;
+      return nBrickIndex < key.nBrickIndex;
+    }
+  } BBF_CACHE_KEY;
+
+protected:
+  typedef std::list< BBF_CACHE_KEY > LRU_LIST;
+
+  typedef struct BBF_CACHE_ITEM
+  {
+    char* pData;                  //brick data
+    int nSize;                    //size of data in bytes
+    int nLocks;                   //number of users, locked items are not released
+    LRU_LIST::iterator lruPos;    //position in LRU list
+  } BBF_CACHE_ITEM;
+
+  typedef std::map< BBF_CACHE_KEY, BBF_CACHE_ITEM > CACHE_MAP;
+
+  //information about registered files
+  typedef struct BBF_CACHE_FILE
+  {
+    int nFileId;                  //unique identifier
+    unsigned long long nStamp;    //stamp of the file content (e.g., index table offset)
+  } BBF_CACHE_FILE;
+
+  typedef std::map< std::string, BBF_CACHE_FILE > FILES_MAP;
+
+protected:
+  CACHE_MAP m_Items;
+  LRU_LIST m_LRU;               //front = the most recently used
+  FILES_MAP m_Files;
+  int m_NextFileId;
+
+  unsigned long long m_MemoryLimit;   //maximal number of bytes to be cached
+  unsigned long long m_MemoryUsed;    //number of bytes currently cached
+
+  unsigned long long m_NHits;         //number of successful lookups
+  unsigned long long m_NMisses;       //number of failed lookups
+
+  wxMutex m_Mutex;
+
+protected:
+  mafBrickedFileCache();
+  ~mafBrickedFileCache();
+
+public:
+  //returns the process-wide instance of the cache
+  static mafBrickedFileCache* GetInstance();
+
+  //returns identifier of the given BBF file to be used in keys; nStamp should identify
+  //the content of the file, if it differs from the stamp used at the previous
+  //registration of the same file, bricks of this file cached previously are released
+  int RegisterFile(const char* fname, unsigned long long nStamp);
+
+  //finds the brick in the cache and locks it, so that it is not released
+  //until Unlock is called, returns NULL, if the brick is not in the cache
+  const char* Lock(const BBF_CACHE_KEY& key);
+
+  //unlocks the brick previously returned by Lock or Insert
+  void Unlock(const BBF_CACHE_KEY& key);
+
+  //stores a copy of nSize bytes of pData under the given key; if bLock is true
+  //the brick is also locked and the pointer to the cached data is returned;
+  //returns NULL, if the brick cannot be cached (e.g., larger than the limit)
+  const char* Insert(const BBF_CACHE_KEY& key, const char* pData, int nSize, bool bLock = false);
+
+  //releases all unlocked bricks
+  void Clear();
+
+  //gets the memory limit in kilobytes
+  inline unsigned long GetMemoryLimit() {
+    return (unsigned long)(m_MemoryLimit / 1024);
+  }
+
+  //sets the memory limit in kilobytes (0 disables caching)
+  void SetMemoryLimit(unsigned long nLimitKB);
+
+  //gets the number of bytes currently occupied by cached bricks
+  inline unsigned long long GetMemoryUsed() {
+    return m_MemoryUsed;
+  }
+
+  //gets the number of lookups (Lock) that found the brick in the cache
+  inline unsigned long long GetNumberOfHits() {
+    return m_NHits;
+  }
+
+  //gets the number of lookups (Lock) that did not find the brick in the cache
+  inline unsigned long long GetNumberOfMisses() {
+    return m_NMisses;
+  }
+
+  //resets the hit/miss counters
+  void ResetStatistics();
+
+protected:
+  //releases the least recently used unlocked items until nRequired more bytes
+  //fit into the memory limit; NB: m_Mutex must be locked by the caller
+  void ReleaseLRU(unsigned long long nRequired);
+
+  //removes the item from the cache; NB: m_Mutex must be locked by the caller
+  void RemoveItem(CACHE_MAP::iterator it);
+};
+
+#endif //__mafBrickedFileCache__
@@ -0,0 +1,376 @@
+/**=======================================================================
+
+File:    	 mafBrickedFileCodec.cpp
+Language:  C++
+Date:      $Date$
+Version:   $Revision: 1.1.2.1 $
+
+Copyright (c) 2008
+University of Bedfordshire
+=========================================================================
+Fast lossless codec for bricks of BBF files (version 3)
+=========================================================================*/
+
+#include "mafDefines.h"
+//----------------------------------------------------------------------------
+// NOTE: Every CPP file in the MAF must include "mafDefines.h" as first.
+// This force to include Window,wxWidgets and VTK exactly in this order.
+// Failing in doing this will result in a run-time error saying:
+// "Failure#0: The value of ESP was not properly saved across a function call"
+//----------------------------------------------------------------------------
+
+#include "mafBrickedFileCodec.h"
+#include "mafMemDbg.h"
+
+#define BBF_LZ_HASHLOG        12    //log2 of the number of entries in the hash table
+#define BBF_LZ_MINMATCH       4     //shortest match
+#define BBF_LZ_MAXOFFSET      65535 //the farthest match (2 bytes offset)
+#define BBF_LZ_MFLIMIT        12    //no match may start in the last 12 bytes
+#define BBF_LZ_LASTLITERALS   5     //the last 5 bytes are always literals
+#define BBF_LZ_SKIPTRIGGER    6     //speeds up the search in incompressible data
+
+#define BBF_CORRUPTED_MSG     _("Compressed brick is corrupted. The file is corrupted and unreadable.")
+
+//reads 4 bytes from (possibly unaligned) memory
+static inline unsigned int BBFRead32(const unsigned char* p)
+{
+  unsigned int v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+//returns the index into the hash table for 4 bytes v
+static inline int BBFHash(unsigned int v)
+{
+  return (int)((v*2654435761U) >> (32 - BBF_LZ_HASHLOG));
+}
+
+//compresses nSize bytes of brick pSrc into pDst, returns the number of bytes
+//stored in pDst, which is nSize if the brick could not be compressed
+/*static*/ int mafBrickedFileCodec::Compress(const char* pSrc, int nSize,
+                                             int nElemSize, int nComps, char* pDst, char* pWork)
+{
+  int nElems = nSize / nElemSize;
+  unsigned char* pFiltered = (unsigned char*)pWork;
+  switch (nElemSize)
+  {
+  case 1: EncodeDelta< unsigned char >(pSrc, nElems, nComps, pFiltered); break;
+  case 2: EncodeDelta< unsigned short >(pSrc, nElems, nComps, pFiltered); break;
+  case 4: EncodeDelta< unsigned int >(pSrc, nElems, nComps, pFiltered); break;
+  case 8: EncodeDelta< unsigned long long >(pSrc, nElems, nComps, pFiltered); break;
+  default:
+    memcpy(pFiltered, pSrc, nSize); break;   //unknown element, compress bytes only
+  }
+
+  //it is worth only if we save something
+  int nPacked = CompressBlock(pFiltered, nSize, (unsigned char*)pDst, nSize - 1);
+  if (nPacked < 0)
+  {
+    memcpy(pDst, pSrc, nSize);
+    return nSize;
+  }
+
+  return nPacked;
+}
+
+//decompresses nSrcSize bytes of pSrc produced by Compress into the brick pDst of nSize bytes
+/*static*/ void mafBrickedFileCodec::Decompress(const char* pSrc, int nSrcSize, char* pDst,
+                                                int nSize, int nElemSize, int nComps, char* pWork) throw(...)
+{
+  if (nSrcSize == nSize)
+  {
+    memcpy(pDst, pSrc, nSize);  //stored raw
+    return;
+  }
+
+  if (nSrcSize <= 0 || nSrcSize > nSize)
+    throw std::ios::failure(BBF_CORRUPTED_MSG);
+
+  unsigned char* pFiltered = (unsigned char*)pWork;
+  DecompressBlock((const unsigned char*)pSrc, nSrcSize, pFiltered, nSize);
+
+  int nElems = nSize / nElemSize;
+  switch (nElemSize)
+  {
+  case 1: DecodeDelta< unsigned char >(pFiltered, nElems, nComps, pDst); break;
+  case 2: DecodeDelta< unsigned short >(pFiltered, nElems, nComps, pDst); break;
+  case 4: DecodeDelta< unsigned int >(pFiltered, nElems, nComps, pDst); break;
+  case 8: DecodeDelta< unsigned long long >(pFiltered, nElems, nComps, pDst); break;
+  default:
+    memcpy(pDst, pFiltered, nSize); break;
+  }
+}
+
+//computes differences of elements of pSrc and stores their bytes into planes of pDst
+template< typename T >
+/*static*/ void mafBrickedFileCodec::EncodeDelta(const char* pSrc, int nElems, int nComps,
+                                                 unsigned char* pDst)
+{
+  T* pPrev = new T[nComps];
+  memset(pPrev, 0, nComps*sizeof(T));
+
+  for (int i = 0; i < nElems; )
+  {
+    for (int j = 0; j < nComps; j++, i++)
+    {
+      T v;
+      memcpy(&v, pSrc + i*sizeof(T), sizeof(T));
+
+      T d = (T)(v - pPrev[j]);
+      pPrev[j] = v;
+
+      //k-th byte of every difference goes to k-th plane
+      for (int k = 0; k < (int)sizeof(T); k++) {
+        pDst[k*nElems + i] = (unsigned char)(d >> (8*k));
+      }
+    }
+  }
+
+  delete[] pPrev;
+}
+
+//inverse of EncodeDelta
+template< typename T >
+/*static*/ void mafBrickedFileCodec::DecodeDelta(const unsigned char* pSrc, int nElems, int nComps,
+                                                 char* pDst)
+{
+  if (nComps == 1)
+  {
+    //the most common case (scalar volumes), no need to track components
+    T prev = 0;
+    for (int i = 0; i < nElems; i++)
+    {
+      T d = 0;
+      for (int k = 0; k < (int)sizeof(T); k++) {
+        d |= ((T)pSrc[k*nElems + i]) << (8*k);
+      }
+
+      prev = (T)(prev + d);
+      memcpy(pDst + i*sizeof(T), &prev, sizeof(T));
+    }
+    return;
+  }
+
+  T* pPrev = new T[nComps];
+  memset(pPrev, 0, nComps*sizeof(T));
+
+  for (int i = 0; i < nElems; )
+  {
+    for (int j = 0; j < nComps; j++, i++)
+    {
+      T d = 0;
+      for (int k = 0; k < (int)sizeof(T); k++) {
+        d |= ((T)pSrc[k*nElems + i]) << (8*k);
+      }
+
+      T v = (T)(pPrev[j] + d);
+      pPrev[j] = v;
+      memcpy(pDst + i*sizeof(T), &v, sizeof(T));
+    }
+  }
+
+  delete[] pPrev;
+}
+
+//LZ4 block compression of nSize bytes of pSrc into pDst that has nDstSize bytes
+//returns the number of bytes written or -1, if the output does not fit
+/*static*/ int mafBrickedFileCodec::CompressBlock(const unsigned char* pSrc, int nSize,
+                                                  unsigned char* pDst, int nDstSize)
+{
+  int hashTable[1 << BBF_LZ_HASHLOG];   //positions of the last occurrences of 4 bytes
+  memset(hashTable, 0, sizeof(hashTable));
+
+  const unsigned char* ip = pSrc;
+  const unsigned char* anchor = pSrc;   //the first literal not stored yet
+  const unsigned char* iend = pSrc + nSize;
+  const unsigned char* mflimit = iend - BBF_LZ_MFLIMIT;
+  const unsigned char* matchlimit = iend - BBF_LZ_LASTLITERALS;
+
+  unsigned char* op = pDst;
+  unsigned char* oend = pDst + nDstSize;
+
+  if (nSize > BBF_LZ_MFLIMIT)
+  {
+    ip++;
+    int nSearchCount = 1 << BBF_LZ_SKIPTRIGGER;
+    while (ip < mflimit)
+    {
+      unsigned int seq = BBFRead32(ip);
+      int h = BBFHash(seq);
+      const unsigned char* ref = pSrc + hashTable[h];
+      hashTable[h] = (int)(ip - pSrc);
+
+      if (ip - ref > BBF_LZ_MAXOFFSET || BBFRead32(ref) != seq)
+      {
+        //no match, the step increases as we do not find anything
+        ip += (nSearchCount++ >> BBF_LZ_SKIPTRIGGER);
+        continue;
+      }
+
+      nSearchCount = 1 << BBF_LZ_SKIPTRIGGER;
+
+      //extend the match backwards and forwards
+      while (ip > anchor && ref > pSrc && ip[-1] == ref[-1]) {
+        ip--; ref--;
+      }
+
+      const unsigned char* mp = ip + BBF_LZ_MINMATCH;
+      const unsigned char* mr = ref + BBF_LZ_MINMATCH;
+      while (mp < matchlimit && *mp == *mr) {
+        mp++; mr++;
+      }
+
+      int nLitLen = (int)(ip - anchor);
+      int nMatchLen = (int)(mp - ip) - BBF_LZ_MINMATCH;
+      if (op + 1 + nLitLen/255 + 1 + nLitLen + 2 + nMatchLen/255 + 1 > oend)
+        return -1;  //would not fit
+
+      //token, literals, offset and match length
+      unsigned char* token = op++;
+      if (nLitLen >= 15)
+      {
+        *token = (unsigned char)(15 << 4);
+        int nLen = nLitLen - 15;
+        for (; nLen >= 255; nLen -= 255) {
+          *op++ = 255;
+        }
+        *op++ = (unsigned char)nLen;
+      }
+      else
+        *token = (unsigned char)(nLitLen << 4);
+
+      memcpy(op, anchor, nLitLen);
+      op += nLitLen;
+
+      int nOffset = (int)(ip - ref);
+      *op++ = (unsigned char)(nOffset & 0xFF);
+      *op++ = (unsigned char)(nOffset >> 8);
+
+      if (nMatchLen >= 15)
+      {
+        *token |= 15;
+        int nLen = nMatchLen - 15;
+        for (; nLen >= 255; nLen -= 255) {
+          *op++ = 255;
+        }
+        *op++ = (unsigned char)nLen;
+      }
+      else
+        *token |= (unsigned char)nMatchLen;
+
+      anchor = ip = mp;
+
+      //remember the position just before the end of match (cheap improvement of ratio)
+      if (ip - 2 > pSrc)
+        hashTable[BBFHash(BBFRead32(ip - 2))] = (int)(ip - 2 - pSrc);
+    }
+  }
+
+  //the last literals
+  int nLitLen = (int)(iend - anchor);
+  if (op + 1 + nLitLen/255 + 1 + nLitLen > oend)
+    return -1;
+
+  if (nLitLen >= 15)
+  {
+    *op++ = (unsigned char)(15 << 4);
+    int nLen = nLitLen - 15;
+    for (; nLen >= 255; nLen -= 255) {
+      *op++ = 255;
+    }
+    *op++ = (unsigned char)nLen;
+  }
+  else
+    *op++ = (unsigned char)(nLitLen << 4);
+
+  memcpy(op, anchor, nLitLen);
+  op += nLitLen;
+
+  return (int)(op - pDst);
+}
+
+//LZ4 block decompression of nSrcSize bytes of pSrc into exactly nDstSize bytes of pDst
+/*static*/ void mafBrickedFileCodec::DecompressBlock(const unsigned char* pSrc, int nSrcSize,
+                                                     unsigned char* pDst, int nDstSize) throw(...)
+{
+  const unsigned char* ip = pSrc;
+  const unsigned char* iend = pSrc + nSrcSize;
+  unsigned char* op = pDst;
+  unsigned char* oend = pDst + nDstSize;
+
+  while (true)
+  {
+    if (ip >= iend)
+      throw std::ios::failure(BBF_CORRUPTED_MSG);
+
+    //literals
+    unsigned int token = *ip++;
+    int nLen = (int)(token >> 4);
+    if (nLen == 15)
+    {
+      unsigned int s;
+      do
+      {
+        if (ip >= iend || nLen > nDstSize)
+          throw std::ios::failure(BBF_CORRUPTED_MSG);
+
+        s = *ip++;
+        nLen += s;
+      } while (s == 255);
+    }
+
+    if (nLen > iend - ip || nLen > oend - op)
+      throw std::ios::failure(BBF_CORRUPTED_MSG);
+
+    memcpy(op, ip, nLen);
+    op += nLen; ip += nLen;
+
+    if (ip == iend)
+      break;  //the last sequence has literals only
+
+    //match
+    if (iend - ip < 2)
+      throw std::ios::failure(BBF_CORRUPTED_MSG);
+
+    int nOffset = ip[0] | (ip[1] << 8);
+    ip += 2;
+
+    if (nOffset == 0 || nOffset > op - pDst)
+      throw std::ios::failure(BBF_CORRUPTED_MSG);
+
+    nLen = (int)(token & 15);
+    if (nLen == 15)
+    {
+      unsigned int s;
+      do
+      {
+        if (ip >= iend || nLen > nDstSize)
+          throw std::ios::failure(BBF_CORRUPTED_MSG);
+
+        s = *ip++;
+        nLen += s;
+      } while (s == 255);
+    }
+
+    nLen += BBF_LZ_MINMATCH;
+    if (nLen > oend - op)
+      throw std::ios::failure(BBF_CORRUPTED_MSG);
+
+    const unsigned char* pMatch = op - nOffset;
+    if (nOffset >= nLen)
+    {
+      memcpy(op, pMatch, nLen);
+      op += nLen;
+    }
+    else
+    {
+      //overlapping copy (repeated pattern)
+      for (int i = 0; i < nLen; i++) {
+        *op++ = *pMatch++;
+      }
+    }
+  }
+
+  if (op != oend)
+    throw std::ios::failure(BBF_CORRUPTED_MSG);
+}
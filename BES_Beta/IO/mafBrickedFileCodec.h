@@ -0,0 +1,65 @@
+/**=======================================================================
+
+  File:    	 mafBrickedFileCodec.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision: 1.1.2.1 $
+
+  Copyright (c) 2008
+  University of Bedfordshire
+=========================================================================
+Fast lossless codec for bricks of BBF files (version 3). Every element
+of the brick is replaced by its difference from the same component of
+the previous voxel (wrap-around integer arithmetic on the element bits,
+so it is lossless also for floating point data), the bytes of these
+differences are reordered into planes (all low bytes first, then all
+next bytes, etc.) and the result is compressed by a bundled LZ77 coder
+that uses the LZ4 block format (greedy parsing, 64 KB window).
+Bricks whose compressed size is not smaller than their raw size are
+stored raw, i.e., the stored size equal to the raw size denotes raw data.
+=========================================================================*/
+
+#ifndef __mafBrickedFileCodec__
+#define __mafBrickedFileCodec__
+
+class mafBrickedFileCodec
+{
+public:
+  //compresses nSize bytes of brick pSrc consisting of elements of nElemSize
+  //bytes (1, 2, 4 or 8) with nComps components per voxel into pDst,
+  //returns the number of bytes stored in pDst, which is nSize if
+  //the brick could not be compressed (pDst contains copy of pSrc)
+  //both, pDst and pWork, must be buffers of (at least) nSize bytes
+  //NB: thread safe, all state is in the given buffers
+  static int Compress(const char* pSrc, int nSize, int nElemSize, int nComps,
+    char* pDst, char* pWork);
+
+  //decompresses nSrcSize bytes of pSrc produced by Compress into the brick
+  //pDst of nSize bytes; pWork must be a buffer of (at least) nSize bytes
+  //throws std::ios::failure, if the compressed data is corrupted
+  //NB: thread safe, all state is in the given buffers
+  static void Decompress(const char* pSrc, int nSrcSize, char* pDst, int nSize,
+    int nElemSize, int nComps, char* pWork) throw(...);
+
+protected:
+  //LZ4 block compression of nSize bytes of pSrc into pDst that has nDstSize bytes
+  //returns the number of bytes written or -1, if the output does not fit
+  static int CompressBlock(const unsigned char* pSrc, int nSize,
+    unsigned char* pDst, int nDstSize);
+
+  //LZ4 block decompression of nSrcSize bytes of pSrc into exactly nDstSize bytes of pDst
+  //throws std::ios::failure, if the data is corrupted
+  static void DecompressBlock(const unsigned char* pSrc, int nSrcSize,
+    unsigned char* pDst, int nDstSize) throw(...);
+
+  //computes differences of elements of pSrc (nElems elements of type T,
+  //nComps components per voxel) and stores their bytes into planes of pDst
+  template< typename T >
+  static void EncodeDelta(const char* pSrc, int nElems, int nComps, unsigned char* pDst);
+
+  //inverse of EncodeDelta
+  template< typename T >
+  static void DecodeDelta(const unsigned char* pSrc, int nElems, int nComps, char* pDst);
+};
+
+#endif //__mafBrickedFileCodec__
@@ -0,0 +1,277 @@
+/**=======================================================================
+
+File:    	 mafBrickedFilePrefetcher.cpp
+Language:  C++
+Date:      $Date$
+Version:   $Revision: 1.1.2.1 $
+
+Copyright (c) 2008
+University of Bedfordshire
+=========================================================================
+Loads bricks of BBF file asynchronously by a small pool of IO threads
+=========================================================================*/
+
+#include "mafDefines.h"
+//----------------------------------------------------------------------------
+// NOTE: Every CPP file in the MAF must include "mafDefines.h" as first.
+// This force to include Window,wxWidgets and VTK exactly in this order.
+// Failing in doing this will result in a run-time error saying:
+// "Failure#0: The value of ESP was not properly saved across a function call"
+//----------------------------------------------------------------------------
+
+#include "mafBrickedFilePrefetcher.h"
+#include "mafBrickedFileCodec.h"
+#include "mafMemDbg.h"
+
+#define BBF_PREFETCH_PAGESIZE   4096    //granularity used to fault in mapped pages
+
+mafBrickedFilePrefetcher::mafBrickedFilePrefetcher()
+{
+  m_MappedFile = NULL;
+  m_DataOffset = 0;
+  m_BrickSizeInB = 0;
+  m_BrickOffsets = NULL;
+  m_ElemSize = m_NumComps = 1;
+  m_Slots = NULL;
+  m_QueueDepth = 0;
+  m_Condition = new wxCondition(m_Mutex);
+
+  m_NextJob = m_NextToRelease = 0;
+  m_Abort = false;
+}
+
+mafBrickedFilePrefetcher::~mafBrickedFilePrefetcher()
+{
+  Stop();
+  delete m_Condition;
+}
+
+//starts nThreads IO threads loading bricks listed in jobs into a ring of nQueueDepth buffers
+void mafBrickedFilePrefetcher::Start(const char* fname, vtkMAFFile* pFile, long long nDataOffset,
+                                     int nBrickSizeInB, const std::vector< int >& jobs,
+                                     int nThreads, int nQueueDepth,
+                                     const unsigned long long* pBrickOffsets, int nElemSize, int nComps)
+{
+  Stop();   //terminate previous jobs
+
+  m_FileName = fname;
+  m_MappedFile = (pFile != NULL && pFile->IsMapped()) ? pFile : NULL;
+  m_DataOffset = nDataOffset;
+  m_BrickSizeInB = nBrickSizeInB;
+  m_BrickOffsets = pBrickOffsets;
+  m_ElemSize = nElemSize;
+  m_NumComps = nComps;
+  m_Jobs = jobs;
+
+  if (nQueueDepth < nThreads)
+    nQueueDepth = nThreads;   //every thread should have at least one buffer
+  if (nQueueDepth < 1)
+    nQueueDepth = 1;
+
+  m_QueueDepth = nQueueDepth;
+  m_Slots = new BBF_PREFETCH_SLOT[m_QueueDepth];
+  for (int i = 0; i < m_QueueDepth; i++)
+  {
+    m_Slots[i].nJob = -1;
+    m_Slots[i].pData = NULL;
+    m_Slots[i].pBuffer = (m_MappedFile != NULL && m_BrickOffsets == NULL) ? 
+      NULL : new char[m_BrickSizeInB];  //compressed bricks are always decoded into buffers
+  }
+
+  m_NextJob = m_NextToRelease = 0;
+  m_Abort = false;
+  m_Error.clear();
+
+  if (m_Jobs.empty())
+    return;   //nothing to be done
+
+  if (nThreads > (int)m_Jobs.size())
+    nThreads = (int)m_Jobs.size();
+
+  for (int i = 0; i < nThreads; i++)
+  {
+    mafBrickedFilePrefetcherThread* pThread = new mafBrickedFilePrefetcherThread(this);
+    if (pThread->Create() != wxTHREAD_NO_ERROR || pThread->Run() != wxTHREAD_NO_ERROR)
+    {
+      delete pThread;   //not able to create more threads, continue with what we have
+      break;
+    }
+
+    m_Threads.push_back(pThread);
+  }
+
+  if (m_Threads.empty()) {
+    m_Error = "Unable to create IO threads.";
+  }
+}
+
+//terminates all IO threads and releases the memory
+void mafBrickedFilePrefetcher::Stop()
+{
+  {
+    wxMutexLocker lock(m_Mutex);
+    m_Abort = true;
+    m_Condition->Broadcast();
+  }
+
+  for (int i = 0; i < (int)m_Threads.size(); i++)
+  {
+    m_Threads[i]->Wait();
+    delete m_Threads[i];
+  }
+
+  m_Threads.clear();
+
+  if (m_Slots != NULL)
+  {
+    for (int i = 0; i < m_QueueDepth; i++) {
+      delete[] m_Slots[i].pBuffer;
+    }
+
+    delete[] m_Slots;
+    m_Slots = NULL;
+  }
+
+  m_QueueDepth = 0;
+  m_Jobs.clear();
+}
+
+//waits until the data of nJob-th job is available and returns pointer to it
+//throws std::exceptions if the brick could not be loaded
+const char* mafBrickedFilePrefetcher::Acquire(int nJob) throw(...)
+{
+  wxMutexLocker lock(m_Mutex);
+
+  BBF_PREFETCH_SLOT* pSlot = &m_Slots[nJob % m_QueueDepth];
+  while (pSlot->nJob != nJob && m_Error.empty()) {
+    m_Condition->Wait();
+  }
+
+  if (pSlot->nJob != nJob)
+    throw std::ios::failure(m_Error.c_str());
+
+  return pSlot->pData;
+}
+
+//releases the data of nJob-th job, so that the slot can be reused by next bricks
+void mafBrickedFilePrefetcher::Release(int nJob)
+{
+  wxMutexLocker lock(m_Mutex);
+
+  m_Slots[nJob % m_QueueDepth].nJob = -1;
+  m_NextToRelease = nJob + 1;
+  m_Condition->Broadcast();
+}
+
+//executed by IO threads
+void mafBrickedFilePrefetcher::ExecuteWorker()
+{
+  //every thread has its own handle, if the file is not mapped,
+  //as Seek + Read on the shared handle would not be thread safe
+  vtkMAFFile2* pFile = NULL;
+  char* pWork = NULL;
+  try
+  {
+    if (m_MappedFile == NULL)
+    {
+      pFile = vtkMAFFile2::New();
+      pFile->Open(m_FileName);
+    }
+
+    //compressed brick + working buffer of the codec
+    if (m_BrickOffsets != NULL)
+      pWork = new char[2*m_BrickSizeInB];
+
+    while (true)
+    {
+      int nJob;
+      {
+        wxMutexLocker lock(m_Mutex);
+
+        //wait until there is a free slot for the next job
+        while (!m_Abort && m_NextJob < (int)m_Jobs.size() &&
+          m_NextJob >= m_NextToRelease + m_QueueDepth) {
+            m_Condition->Wait();
+        }
+
+        if (m_Abort || m_NextJob >= (int)m_Jobs.size())
+          break;
+
+        nJob = m_NextJob++;
+      }
+
+      //slot is exclusively ours, until we mark it as ready
+      BBF_PREFETCH_SLOT* pSlot = &m_Slots[nJob % m_QueueDepth];
+      LoadBrick(m_Jobs[nJob], pSlot, pFile, pWork);
+
+      wxMutexLocker lock(m_Mutex);
+      pSlot->nJob = nJob;
+      m_Condition->Broadcast();
+    }
+  }
+  catch (std::exception& e)
+  {
+    wxMutexLocker lock(m_Mutex);
+    if (m_Error.empty())
+      m_Error = e.what();
+
+    m_Condition->Broadcast();
+  }
+
+  delete[] pWork;
+  if (pFile != NULL)
+    pFile->Delete();
+}
+
+//loads the brick with the given index into the slot
+void mafBrickedFilePrefetcher::LoadBrick(int nBrickIndex, BBF_PREFETCH_SLOT* pSlot, 
+                                         vtkMAFFile2* pFile, char* pWork) throw(...)
+{
+  if (m_BrickOffsets != NULL)
+  {
+    //compressed brick, offsets were validated by the reader
+    long long offset = (long long)m_BrickOffsets[nBrickIndex];
+    int nPackedSize = (int)(m_BrickOffsets[nBrickIndex + 1] - m_BrickOffsets[nBrickIndex]);
+
+    const char* pPacked = pWork;
+    if (pFile == NULL)
+    {
+      pPacked = m_MappedFile->GetView(offset, nPackedSize);
+      if (pPacked == NULL)
+        throw std::ios::failure(("Reached the end of the file (EOF). The file is corrupted and unreadable."));
+    }
+    else
+    {
+      pFile->Seek(offset);
+      pFile->Read(pWork, nPackedSize);
+    }
+
+    mafBrickedFileCodec::Decompress(pPacked, nPackedSize, pSlot->pBuffer, 
+      m_BrickSizeInB, m_ElemSize, m_NumComps, pWork + m_BrickSizeInB);
+    pSlot->pData = pSlot->pBuffer;
+    return;
+  }
+
+  long long offset = ((long long)nBrickIndex)*m_BrickSizeInB + m_DataOffset;
+  if (pFile == NULL)
+  {
+    const char* pView = m_MappedFile->GetView(offset, m_BrickSizeInB);
+    if (pView == NULL)
+      throw std::ios::failure(("Reached the end of the file (EOF). The file is corrupted and unreadable."));
+
+    //touch every page of the brick, so that the consumer does not wait for disk
+    volatile char chDummy = 0;
+    for (int i = 0; i < m_BrickSizeInB; i += BBF_PREFETCH_PAGESIZE) {
+      chDummy += pView[i];
+    }
+
+    chDummy += pView[m_BrickSizeInB - 1];
+    pSlot->pData = pView;
+  }
+  else
+  {
+    pFile->Seek(offset);
+    pFile->Read(pSlot->pBuffer, m_BrickSizeInB);
+    pSlot->pData = pSlot->pBuffer;
+  }
+}
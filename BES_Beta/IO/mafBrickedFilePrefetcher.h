@@ -0,0 +1,131 @@
+/**=======================================================================
+
+  File:    	 mafBrickedFilePrefetcher.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision: 1.1.2.1 $
+
+  Copyright (c) 2008
+  University of Bedfordshire
+=========================================================================
+Loads bricks of BBF file asynchronously by a small pool of IO threads
+into a bounded ring of brick buffers, so that the disk latency overlaps
+the de-bricking performed by mafBrickedFileReader in the main thread.
+Compressed bricks (BBF version 3) are also decoded by these threads.
+=========================================================================*/
+
+#ifndef __mafBrickedFilePrefetcher__
+#define __mafBrickedFilePrefetcher__
+
+#include "mafString.h"
+#include "../vtkMAF/vtkMAFFile.h"
+
+#include <wx/thread.h>
+#include <vector>
+#include <string>
+
+class mafBrickedFilePrefetcher
+{
+protected:
+  //IO thread that executes mafBrickedFilePrefetcher::ExecuteWorker
+  class mafBrickedFilePrefetcherThread : public wxThread
+  {
+  protected:
+    mafBrickedFilePrefetcher* m_Owner;
+
+  public:
+    mafBrickedFilePrefetcherThread(mafBrickedFilePrefetcher* owner)
+      : wxThread(wxTHREAD_JOINABLE), m_Owner(owner) {
+    }
+
+  protected:
+    /*virtual*/ ExitCode Entry() {
+      m_Owner->ExecuteWorker();
+      return 0;
+    }
+  };
+
+  //one item of the ring
+  typedef struct BBF_PREFETCH_SLOT
+  {
+    int nJob;             //index of job whose data is in this slot, -1 if not ready
+    char* pBuffer;        //buffer for the brick data (if the file is not mapped or compressed)
+    const char* pData;    //pointer to the brick data (either pBuffer or a view of file)
+  } BBF_PREFETCH_SLOT;
+
+protected:
+  //BBF file to be read (each IO thread opens its own handle)
+  mafString m_FileName;
+
+  //the file opened by the caller; if it is mapped into the memory,
+  //IO threads only fault in pages of bricks and no buffers are needed
+  vtkMAFFile* m_MappedFile;
+
+  //offset of the first brick in the file and the size of one brick in bytes
+  long long m_DataOffset;
+  int m_BrickSizeInB;
+
+  //offsets of compressed bricks (version 3 only, NULL otherwise), see mafBrickedFileReader,
+  //size of one element and number of components needed by mafBrickedFileCodec
+  const unsigned long long* m_BrickOffsets;
+  int m_ElemSize;
+  int m_NumComps;
+
+  //indices of bricks (in the file) to be loaded in the order in which they are consumed
+  std::vector< int > m_Jobs;
+
+  //ring of brick buffers
+  BBF_PREFETCH_SLOT* m_Slots;
+  int m_QueueDepth;
+
+  //IO threads
+  std::vector< mafBrickedFilePrefetcherThread* > m_Threads;
+
+  //synchronization
+  wxMutex m_Mutex;
+  wxCondition* m_Condition;
+
+  int m_NextJob;          //index of the next job to be processed by some IO thread
+  int m_NextToRelease;    //index of the job not released by the consumer yet
+  bool m_Abort;           //true, if IO threads should terminate as soon as possible
+  std::string m_Error;    //error message of the first failed IO operation (if any)
+
+public:
+  mafBrickedFilePrefetcher();
+  ~mafBrickedFilePrefetcher();
+
+public:
+  //starts nThreads IO threads loading bricks listed in jobs (indices into the file
+  //data area of the BBF file fname) into a ring of nQueueDepth buffers;
+  //if pFile is mapped into the memory, its view is used instead of reading.
+  //nDataOffset is the offset of the first brick, nBrickSizeInB size of one brick
+  //if pBrickOffsets is not NULL, bricks are compressed by mafBrickedFileCodec,
+  //pBrickOffsets contains their offsets in the file and IO threads decode them
+  //NB: pBrickOffsets must be valid until Stop is called
+  void Start(const char* fname, vtkMAFFile* pFile, long long nDataOffset,
+    int nBrickSizeInB, const std::vector< int >& jobs, int nThreads, int nQueueDepth,
+    const unsigned long long* pBrickOffsets = NULL, int nElemSize = 1, int nComps = 1);
+
+  //terminates all IO threads and releases the memory
+  void Stop();
+
+  //waits until the data of nJob-th job is available and returns pointer to it
+  //the pointer is valid until Release(nJob) is called; jobs must be acquired in order
+  //throws std::exceptions if the brick could not be loaded
+  const char* Acquire(int nJob) throw(...);
+
+  //releases the data of nJob-th job, so that the slot can be reused by next bricks
+  void Release(int nJob);
+
+protected:
+  //executed by IO threads
+  void ExecuteWorker();
+
+  //loads the brick with the given index into the slot,
+  //pFile is the handle owned by the calling IO thread (NULL, if the file is mapped)
+  //pWork is the buffer of two bricks owned by the calling IO thread (compressed files only)
+  void LoadBrick(int nBrickIndex, BBF_PREFETCH_SLOT* pSlot, 
+    vtkMAFFile2* pFile, char* pWork) throw(...);
+};
+
+#endif //__mafBrickedFilePrefetcher__
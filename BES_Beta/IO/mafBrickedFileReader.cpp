@@ -21,6 +21,7 @@ Reads the BBF file, writing data into vtkImageDataSet
 //----------------------------------------------------------------------------
 
 #include "mafBrickedFileReader.h"
+#include "mafBrickedFileCodec.h"
 
 mafCxxTypeMacro(mafBrickedFileReader);
 
@@ -29,6 +30,7 @@ mafCxxTypeMacro(mafBrickedFileReader);
 
 #include "mafMemDbg.h"
 #include "vtkMAFIdType64.h"
+#include <algorithm>
 
 #define BBF_DATACACHE_MAXCOUNT	7	//central brick + bricks around (L1 resample only)
 
@@ -39,6 +41,18 @@ mafBrickedFileReader::mafBrickedFileReader()
 	m_BROIValid = false;
 	
 	m_PBrickDataCache = NULL;
+	m_PBrickOffsets = NULL;
+	m_NPackedBricks = 0;
+	m_PPackedBuffer = NULL;
+	m_PCodecBuffer = NULL;
+	m_UseMemoryMapping = true;
+
+	m_UseBrickCache = true;
+	m_CacheFileId = -1;
+
+	m_Prefetcher = new mafBrickedFilePrefetcher();
+	m_PrefetchThreads = 2;
+	m_PrefetchQueueDepth = 16;
 	
 	m_VOI[0] = m_VOI[2] = m_VOI[4] = 0;
 	m_VOI[1] = m_VOI[3] = m_VOI[5] = 0xFFFF;	//short max
@@ -47,6 +61,7 @@ mafBrickedFileReader::mafBrickedFileReader()
 mafBrickedFileReader::~mafBrickedFileReader()
 {	
 	CloseBrickFile();
+	cppDEL(m_Prefetcher);
 	vtkDEL(m_DataSet);
   vtkDEL(m_DataSetRLG);
 }
@@ -100,6 +115,11 @@ void mafBrickedFileReader::SetOutputRLGDataSet(vtkRectilinearGrid* ds)
 		throw std::ios::failure(_("Not BBF file or corrupted one."));
 	}
 
+	if (m_FileHeader.version > mafBrickedFile::m_CompressedVersion) {
+		m_BrickFile->Close();
+		throw std::ios::failure(_("Unsupported version of BBF file."));
+	}
+
 	//recompute global information
 	for (int i = 0; i < 3; i++) 
 	{
@@ -126,12 +146,56 @@ void mafBrickedFileReader::SetOutputRLGDataSet(vtkRectilinearGrid* ds)
 	}
 
 	AllocateBuffers();
+
+	//register the file in the brick cache, the file size, its modification
+	//time and the header identify the content, if the file is rewritten
+	unsigned long long nFileSize = (unsigned long long)m_BrickFile->GetFileSize();
+	unsigned long long nModTime = (unsigned long long)wxFileModificationTime(m_BrickFileName.GetCStr());
+	unsigned long long nStamp = 14695981039346656037ULL;	//FNV-1a 64-bit hash
+	nStamp = HashBytes(nStamp, &nFileSize, sizeof(nFileSize));
+	nStamp = HashBytes(nStamp, &nModTime, sizeof(nModTime));
+	nStamp = HashBytes(nStamp, &m_FileHeader, sizeof(m_FileHeader));
+	m_CacheFileId = mafBrickedFileCache::GetInstance()->RegisterFile(
+		m_BrickFileName, nStamp);
+
+	//map the file, if possible, so that LoadBrick can use its view
+	if (m_UseMemoryMapping)
+		m_BrickFile->MapFile();
+}
+
+//combines nSize bytes of pData into the FNV-1a hash nHash and returns the result
+/*static*/ unsigned long long mafBrickedFileReader::HashBytes(unsigned long long nHash,
+	const void* pData, int nSize)
+{
+	const unsigned char* pBytes = (const unsigned char*)pData;
+	for (int i = 0; i < nSize; i++)
+	{
+		nHash ^= pBytes[i];
+		nHash *= 1099511628211ULL;
+	}
+	return nHash;
+}
+
+//returns the version of the given BBF file, or 0, if the file
+//cannot be opened or it is not BBF file
+/*static*/ int mafBrickedFileReader::GetFileVersion(const char* fname)
+{
+	vtkMAFFile* pFile = vtkMAFFile::New();
+
+	BBF_HEADER header;
+	bool bValid = pFile->Open(fname) && 
+		pFile->Read(&header, sizeof(header)) == sizeof(header) &&
+		header.signature == mafBrickedFile::m_Signature;
+
+	pFile->Delete();
+	return bValid ? header.version : 0;
 }
 
 //closes the currently opened brick file (if there is any)
 //releasing memory allocated for index table, etc.
 /*virtual*/ void mafBrickedFileReader::CloseBrickFile()
 {	
+	m_Prefetcher->Stop();   //IO threads might still use the file
 	DeallocateBuffers();
   if (m_BrickFile != NULL)
   {
@@ -157,6 +221,34 @@ void mafBrickedFileReader::SetOutputRLGDataSet(vtkRectilinearGrid* ds)
 	m_PExIdxTable = new BBF_IDX_EXITEM[m_FileHeader.extra_idx_items];
 	m_BrickFile->Read( m_PExIdxTable, m_FileHeader.extra_idx_items*sizeof(BBF_IDX_EXITEM));
 
+	if (m_FileHeader.version >= m_CompressedVersion)
+	{
+		//offsets of compressed bricks follow the index table
+		unsigned long long nBricks;
+		m_BrickFile->Read( &nBricks, sizeof(nBricks));
+		if (nBricks > (unsigned long long)m_NBricksDimSize[2])
+			throw std::ios::failure(_("Not BBF file or corrupted one."));
+
+		m_NPackedBricks = (int)nBricks;
+		m_PBrickOffsets = new unsigned long long[m_NPackedBricks + 1];
+		m_BrickFile->Read( m_PBrickOffsets, (m_NPackedBricks + 1)*sizeof(unsigned long long));
+
+		//validate them now, so that bricks can be loaded without further checks
+		unsigned long long nDataEnd = m_FileHeader.idxtblofs - nLRSize;
+		if (m_PBrickOffsets[0] != sizeof(BBF_HEADER) || m_PBrickOffsets[m_NPackedBricks] != nDataEnd)
+			throw std::ios::failure(_("Not BBF file or corrupted one."));
+
+		for (int i = 0; i < m_NPackedBricks; i++)
+		{
+			if (m_PBrickOffsets[i + 1] <= m_PBrickOffsets[i] || 
+				m_PBrickOffsets[i + 1] - m_PBrickOffsets[i] > (unsigned long long)m_NBrickSizeInB[2])
+				throw std::ios::failure(_("Not BBF file or corrupted one."));
+		}
+
+		m_PPackedBuffer = new char[m_NBrickSizeInB[2]];
+		m_PCodecBuffer = new char[m_NBrickSizeInB[2]];
+	}
+
   if (this->IsRectilinearGrid())
   {
     for (int i = 0; i < 3; i++)
@@ -187,6 +279,10 @@ void mafBrickedFileReader::SetOutputRLGDataSet(vtkRectilinearGrid* ds)
 /*virtual*/ void mafBrickedFileReader::DeallocateBuffers()  throw(...)
 {
 	cppDEL(m_PBrickDataCache);
+	cppDEL(m_PBrickOffsets);
+	cppDEL(m_PPackedBuffer);
+	cppDEL(m_PCodecBuffer);
+	m_NPackedBricks = 0;
 	cppDEL(m_PLowResLevel);
 	cppDEL(m_PMainIdxTable);
   cppDEL(m_PExIdxTable);
@@ -362,6 +458,41 @@ void mafBrickedFileReader::SetOutputRLGDataSet(vtkRectilinearGrid* ds)
 	}	
 }
 
+//loads the compressed brick with the given index from file (version 3 only),
+//decodes it into pOutPtr and returns pointer to its data
+const char* mafBrickedFileReader::LoadPackedBrick(int nBrickIndex, char* pOutPtr) throw(...)
+{
+	if (nBrickIndex < 0 || nBrickIndex >= m_NPackedBricks)
+		throw std::ios::failure(_("Not BBF file or corrupted one."));
+
+	//offsets were validated in AllocateBuffers
+	long long offset = (long long)m_PBrickOffsets[nBrickIndex];
+	int nPackedSize = (int)(m_PBrickOffsets[nBrickIndex + 1] - m_PBrickOffsets[nBrickIndex]);
+
+	const char* pPacked;
+	if (m_BrickFile->IsMapped())
+	{
+		pPacked = m_BrickFile->GetView(offset, nPackedSize);
+		if (nPackedSize == m_NBrickSizeInB[2])
+			return pPacked;		//stored raw, use it directly
+	}
+	else
+	{
+		//raw bricks are read directly into the output
+		char* pBuffer = (nPackedSize == m_NBrickSizeInB[2]) ? pOutPtr : m_PPackedBuffer;
+		m_BrickFile->Seek(offset);
+		m_BrickFile->Read(pBuffer, nPackedSize);
+		if (pBuffer == pOutPtr)
+			return pOutPtr;
+
+		pPacked = pBuffer;
+	}
+
+	mafBrickedFileCodec::Decompress(pPacked, nPackedSize, pOutPtr, m_NBrickSizeInB[2],
+		m_NVoxelSizeInB / m_FileHeader.numcomps, m_FileHeader.numcomps, m_PCodecBuffer);
+	return pOutPtr;
+}
+
 //computes extents in inner bricks and boundary bricks	
 //for the given extent VOI that is specified in voxels (of highest resolution level)
 void mafBrickedFileReader::GetBricksExtent(int VOI[6], int inBExt[6], int bndBExt[6])
@@ -427,94 +558,204 @@ void mafBrickedFileReader::GetBricksExtent(int VOI[6], int inBExt[6], int bndBEx
 		outIncrInB[i] = outIncr[i]*(m_NVoxelSizeInB / m_FileHeader.numcomps);
 	}
 
-	int RSR = m_FileHeader.sample_rate;
-	char* pOutPtrZ = (char*)output->GetScalarPointer();	
+	//non-uniform bricks are shared with other readers via the process-wide cache
+	mafBrickedFileCache* pCache = mafBrickedFileCache::GetInstance();
+	bool bUseCache = m_UseBrickCache && pCache->GetMemoryLimit() > 0;
+	mafBrickedFileCache::BBF_CACHE_KEY key;
+	key.nFileId = m_CacheFileId;
+	key.nLevel = m_FileHeader.sample_rate;
+
+	//if prefetching is enabled, the bricks are traversed twice, first to collect
+	//indices of non-uniform bricks to be loaded (no IO is done), then the IO 
+	//threads are started to load them while the bricks are copied into output;
+	//bricks found in the cache during the first pass are locked until they are used
+	std::vector< int > nonUniformBricks;
+	std::vector< const char* > cachedBricks;
+	int nNonUniform = 0, nLoadedBricks = 0;
+	bool bPrefetch = m_PrefetchThreads > 0;
 
-	//compute the initial BrickLine (i.e., index into the index table)
-	//and compute also initial index to low resolution map
-	int nBrickLineZ = (bndBExt[4]*m_NBricksDim[1] + bndBExt[2]);
-	int nLRIdxZ = (nBrickLineZ*m_NBricksDim[0] + bndBExt[0])*m_NVoxelSizeInB;
-		
-	int xyzb[3];
-	for (xyzb[2] = bndBExt[4]; xyzb[2] <= bndBExt[5]; xyzb[2]++, nBrickLineZ += m_NBricksDim[1], 
-		nLRIdxZ += m_NBricksDimSize[1]*m_NVoxelSizeInB)
+	try
 	{
-		mafEventMacro(mafEvent(this, PROGRESSBAR_SET_VALUE, (long)(
-			100*(xyzb[2] - bndBExt[4]) / (bndBExt[5] - bndBExt[4] + 1))));
-
-		//planes from bndBExt[4] to inBExt[4] (exclusively)
-		//and planes from inBExt[5] (exclusively) to bndExt[5]
-		//contains boundary bricks and must be processed differently
-		int nBrickLineY = nBrickLineZ;
-		int nBrickIndexY = nBrickLineY*m_NBricksDimSize[0];
-		int nLRIdxY = nLRIdxZ;
-
-		brckExt[4] = brckMinExt[4 + (xyzb[2] == bndBExt[4])];
-		brckExt[5] = brckMaxExt[4 + (xyzb[2] == bndBExt[5])];
-
-		bool zbValid = xyzb[2] >= inVBExt[4] && xyzb[2] <= inVBExt[5];		
-		char* pOutPtrY = pOutPtrZ;
-
-		for (xyzb[1] = bndBExt[2]; xyzb[1] <= bndBExt[3]; xyzb[1]++, nBrickLineY++,
-			nBrickIndexY += m_NBricksDimSize[0], nLRIdxY += m_NBricksDimSize[0]*m_NVoxelSizeInB)
-		{	
-			//get the index table item
-			BBF_IDX_MAINITEM* pIdxMain = &m_PMainIdxTable[nBrickLineY];
-			BBF_IDX_EXITEM* pIdxEx = &m_PExIdxTable[pIdxMain->nNextItemIndex];
-			int nRemPos = pIdxMain->nListLength - 1;
-
-			//compute number of bricks skipped before the first item
-			int nBrickIndex = nBrickIndexY;
-			int nSkippedBricks = pIdxMain->nPrevSkipped;
-			for (xyzb[0] = 0; xyzb[0] < bndBExt[0]; xyzb[0]++, nBrickIndex++)
+		for (int nPass = (bPrefetch ? 0 : 1); nPass < 2; nPass++)
+		{
+			bool bCollectOnly = nPass == 0;
+			if (!bCollectOnly && bPrefetch)
 			{
-				if (IsBrickUniform(xyzb[0], pIdxMain, pIdxEx, nRemPos))
-					nSkippedBricks++;
+				std::vector< int > jobs;
+				for (int i = 0; i < (int)nonUniformBricks.size(); i++)
+				{
+					if (cachedBricks[i] == NULL)
+						jobs.push_back(nonUniformBricks[i]);
+				}
+
+				//IO threads do not check the index table against offsets of compressed bricks
+				if (m_PBrickOffsets != NULL && !jobs.empty() && 
+					*std::max_element(jobs.begin(), jobs.end()) >= m_NPackedBricks)
+					throw std::ios::failure(_("Not BBF file or corrupted one."));
+
+				//compressed bricks are decoded by IO threads, which is CPU bound
+				int nThreads = m_PrefetchThreads;
+				if (m_PBrickOffsets != NULL && nThreads < wxThread::GetCPUCount())
+					nThreads = wxThread::GetCPUCount();
+
+				m_Prefetcher->Start(m_BrickFileName, m_BrickFile, sizeof(BBF_HEADER),
+					m_NBrickSizeInB[2], jobs, nThreads, m_PrefetchQueueDepth, m_PBrickOffsets,
+					m_NVoxelSizeInB / m_FileHeader.numcomps, m_FileHeader.numcomps);
 			}
-			
-			brckExt[2] = brckMinExt[2 + (xyzb[1] == bndBExt[2])];
-			brckExt[3] = brckMaxExt[2 + (xyzb[1] == bndBExt[3])];
 
-			int nLRIdx = nLRIdxY;	
-			bool ybValid = zbValid && xyzb[1] >= inVBExt[2] && xyzb[1] <= inVBExt[3];
-			char* pOutPtrX = pOutPtrY;
+			char* pOutPtrZ = (char*)output->GetScalarPointer();	
 
-			for (xyzb[0] = bndBExt[0]; xyzb[0] <= bndBExt[1]; xyzb[0]++, 
-				nLRIdx += m_NVoxelSizeInB, nBrickIndex++
-				)
+			//compute the initial BrickLine (i.e., index into the index table)
+			//and compute also initial index to low resolution map
+			int nBrickLineZ = (bndBExt[4]*m_NBricksDim[1] + bndBExt[2]);
+			int nLRIdxZ = (nBrickLineZ*m_NBricksDim[0] + bndBExt[0])*m_NVoxelSizeInB;
+		
+			int xyzb[3];
+			for (xyzb[2] = bndBExt[4]; xyzb[2] <= bndBExt[5]; xyzb[2]++, nBrickLineZ += m_NBricksDim[1], 
+				nLRIdxZ += m_NBricksDimSize[1]*m_NVoxelSizeInB)
 			{
-				brckExt[0] = brckMinExt[xyzb[0] == bndBExt[0]];
-				brckExt[1] = brckMaxExt[xyzb[0] == bndBExt[1]];
+				if (!bCollectOnly)
+				{
+					mafEventMacro(mafEvent(this, PROGRESSBAR_SET_VALUE, (long)(
+						100*(xyzb[2] - bndBExt[4]) / (bndBExt[5] - bndBExt[4] + 1))));
+				}
+
+				//planes from bndBExt[4] to inBExt[4] (exclusively)
+				//and planes from inBExt[5] (exclusively) to bndExt[5]
+				//contains boundary bricks and must be processed differently
+				int nBrickLineY = nBrickLineZ;
+				int nBrickIndexY = nBrickLineY*m_NBricksDimSize[0];
+				int nLRIdxY = nLRIdxZ;
+
+				brckExt[4] = brckMinExt[4 + (xyzb[2] == bndBExt[4])];
+				brckExt[5] = brckMaxExt[4 + (xyzb[2] == bndBExt[5])];
+
+				bool zbValid = xyzb[2] >= inVBExt[4] && xyzb[2] <= inVBExt[5];		
+				char* pOutPtrY = pOutPtrZ;
+
+				for (xyzb[1] = bndBExt[2]; xyzb[1] <= bndBExt[3]; xyzb[1]++, nBrickLineY++,
+					nBrickIndexY += m_NBricksDimSize[0], nLRIdxY += m_NBricksDimSize[0]*m_NVoxelSizeInB)
+				{	
+					//get the index table item
+					BBF_IDX_MAINITEM* pIdxMain = &m_PMainIdxTable[nBrickLineY];
+					BBF_IDX_EXITEM* pIdxEx = &m_PExIdxTable[pIdxMain->nNextItemIndex];
+					int nRemPos = pIdxMain->nListLength - 1;
+
+					//compute number of bricks skipped before the first item
+					int nBrickIndex = nBrickIndexY;
+					int nSkippedBricks = pIdxMain->nPrevSkipped;
+					for (xyzb[0] = 0; xyzb[0] < bndBExt[0]; xyzb[0]++, nBrickIndex++)
+					{
+						if (IsBrickUniform(xyzb[0], pIdxMain, pIdxEx, nRemPos))
+							nSkippedBricks++;
+					}
+			
+					brckExt[2] = brckMinExt[2 + (xyzb[1] == bndBExt[2])];
+					brckExt[3] = brckMaxExt[2 + (xyzb[1] == bndBExt[3])];
+
+					int nLRIdx = nLRIdxY;	
+					bool ybValid = zbValid && xyzb[1] >= inVBExt[2] && xyzb[1] <= inVBExt[3];
+					char* pOutPtrX = pOutPtrY;
+
+					for (xyzb[0] = bndBExt[0]; xyzb[0] <= bndBExt[1]; xyzb[0]++, 
+						nLRIdx += m_NVoxelSizeInB, nBrickIndex++
+						)
+					{
+						brckExt[0] = brckMinExt[xyzb[0] == bndBExt[0]];
+						brckExt[1] = brckMaxExt[xyzb[0] == bndBExt[1]];
+
+						//check first, if it is not uniform
+						bool bUniform = nRemPos < 0 || IsBrickUniform(xyzb[0], pIdxMain, pIdxEx, nRemPos);
+						if (bUniform)	//increase number of skipped bricks, if it is uniform
+							nSkippedBricks++;
+
+						//check if this brick should be processed
+						if (!ybValid || xyzb[0] < inVBExt[0] || xyzb[0] > inVBExt[1]) 
+						{
+							key.nBrickIndex = nBrickIndex - nSkippedBricks;
+							if (bCollectOnly)
+							{
+								//just remember the brick to be loaded by the prefetcher
+								if (!bUniform)
+								{
+									nonUniformBricks.push_back(key.nBrickIndex);
+									cachedBricks.push_back(bUseCache ? pCache->Lock(key) : NULL);
+								}
+							}
+							else
+							{
+								//unfortunately, this brick has to be processed
+								//compute index of this current cell					 
+								const char* pBrickData = m_PBrickDataCache;
+								const char* pCachedData = NULL;
+								if (bUniform)
+									FillBrick(m_PBrickDataCache, &m_PLowResLevel[nLRIdx]);						
+								else 
+								{
+									if (bPrefetch)
+										pCachedData = cachedBricks[nNonUniform];
+									else if (bUseCache)
+										pCachedData = pCache->Lock(key);
+
+									if (pCachedData != NULL)
+										pBrickData = pCachedData;
+									else if (bPrefetch)
+										pBrickData = m_Prefetcher->Acquire(nLoadedBricks);
+									else					
+										pBrickData = LoadBrick(key.nBrickIndex, m_PBrickDataCache);
+								}
+
+								//having the data in pBrickData, copy its bytes													
+								CopyBrickData(pBrickData, brckExt, pOutPtrX, outIncrInB);
+
+								if (!bUniform)
+								{
+									if (pCachedData != NULL)
+										pCache->Unlock(key);
+									else 
+									{
+										if (bUseCache)
+											pCache->Insert(key, pBrickData, m_NBrickSizeInB[2]);
+
+										if (bPrefetch)
+											m_Prefetcher->Release(nLoadedBricks++);
+									}
+
+									nNonUniform++;
+								}
+							}
+						} //end if - check of validity
+
+						//advance addresses
+						pOutPtrX += (brckExt[1] - brckExt[0] + 1)*outIncrInB[0];
+					} //end for x
+
+					pOutPtrY += (brckExt[3] - brckExt[2] + 1)*outIncrInB[1];
+				} //end for xyzb[1]
+
+				//advance to next brick plane
+				pOutPtrZ += (brckExt[5] - brckExt[4] + 1)*outIncrInB[2];
+			} //end for xyzb[2]
+		} //end for nPass
+	}
+	catch (...)
+	{
+		m_Prefetcher->Stop();	//terminate IO threads before propagating the error
 
-				//check first, if it is not uniform
-				bool bUniform = nRemPos < 0 || IsBrickUniform(xyzb[0], pIdxMain, pIdxEx, nRemPos);
-				if (bUniform)	//increase number of skipped bricks, if it is uniform
-					nSkippedBricks++;
+		//unlock cached bricks that have not been used yet
+		for (int i = nNonUniform; i < (int)cachedBricks.size(); i++)
+		{
+			if (cachedBricks[i] != NULL)
+			{
+				key.nBrickIndex = nonUniformBricks[i];
+				pCache->Unlock(key);
+			}
+		}
+		throw;
+	}
 
-				//check if this brick should be processed
-				if (!ybValid || xyzb[0] < inVBExt[0] || xyzb[0] > inVBExt[1]) 
-				{
-					//unfortunately, this brick has to be processed
-					//compute index of this current cell					 
-					if (bUniform)
-						FillBrick(m_PBrickDataCache, &m_PLowResLevel[nLRIdx]);						
-					else					
-						LoadBrick(nBrickIndex - nSkippedBricks, m_PBrickDataCache);					
-
-					//having the data in pBrickData, copy its bytes													
-					CopyBrickData(m_PBrickDataCache, brckExt, pOutPtrX, outIncrInB);
-				} //end if - check of validity
-
-				//advance addresses
-				pOutPtrX += (brckExt[1] - brckExt[0] + 1)*outIncrInB[0];
-			} //end for x
-
-			pOutPtrY += (brckExt[3] - brckExt[2] + 1)*outIncrInB[1];
-		} //end for xyzb[1]
-
-		//advance to next brick plane
-		pOutPtrZ += (brckExt[5] - brckExt[4] + 1)*outIncrInB[2];
-	} //end for xyzb[2]
+	if (bPrefetch)
+		m_Prefetcher->Stop();
 
 	memcpy(&m_ValidROI[0], &m_VOI[0], sizeof(int)*6);
 	m_BROIValid = true;  
@@ -16,6 +16,8 @@ Reads the BBF file into vtkImageDataSet
 #define __mafBrickedFileReader__
 
 #include "mafBrickedFile.h"
+#include "mafBrickedFilePrefetcher.h"
+#include "mafBrickedFileCache.h"
 #include "vtkImageData.h"
 #include "vtkRectilinearGrid.h"
 
@@ -61,6 +63,26 @@ protected:
 	//small cache for one brick
 	char* m_PBrickDataCache;
 
+	//offsets of non-uniform bricks in the file (version 3 only, NULL otherwise),
+	//the brick i is stored (compressed) from m_PBrickOffsets[i] to m_PBrickOffsets[i + 1] - 1
+	unsigned long long* m_PBrickOffsets;
+	int m_NPackedBricks;				//number of non-uniform bricks (version 3 only)
+	char* m_PPackedBuffer;			//compressed brick read from file (version 3 only)
+	char* m_PCodecBuffer;				//working buffer for mafBrickedFileCodec (version 3 only)
+
+	//true, if the brick file should be mapped into the memory, so that
+	//bricks are accessed directly without Seek/Read and extra copying
+	bool m_UseMemoryMapping;
+
+	//true, if non-uniform bricks should be shared via mafBrickedFileCache
+	bool m_UseBrickCache;
+	int m_CacheFileId;		//identifier of the opened file in mafBrickedFileCache
+
+	//loads non-uniform bricks asynchronously, while the current one is de-bricked
+	mafBrickedFilePrefetcher* m_Prefetcher;
+	int m_PrefetchThreads;		//number of IO threads, 0 = no prefetching
+	int m_PrefetchQueueDepth;	//number of bricks that can be loaded in advance
+
 public:
 	mafBrickedFileReader();
 	virtual ~mafBrickedFileReader();
@@ -117,6 +139,69 @@ public:
 		}
 	}
 
+  //Returns true, if the brick file is to be mapped into the memory
+  inline bool GetUseMemoryMapping() {
+    return m_UseMemoryMapping;
+  }
+
+  //Sets whether the brick file is to be mapped into the memory (default true)
+  //If mapping is not possible (e.g., address space is exhausted),
+  //the reader silently falls back to Seek/Read
+  inline void SetUseMemoryMapping(bool bUseMapping)
+  {
+    if (m_UseMemoryMapping != bUseMapping) {
+      m_UseMemoryMapping = bUseMapping;
+      m_LUBrickFileName = "";   //force reopening of the file
+      this->Modified();
+    }
+  }
+
+  //Returns true, if loaded bricks are shared with other readers via mafBrickedFileCache
+  inline bool GetUseBrickCache() {
+    return m_UseBrickCache;
+  }
+
+  //Sets whether loaded bricks are shared with other readers via mafBrickedFileCache
+  //(default true), the memory budget of the cache is set by 
+  //mafBrickedFileCache::GetInstance()->SetMemoryLimit
+  inline void SetUseBrickCache(bool bUseCache) {
+    m_UseBrickCache = bUseCache;
+  }
+
+  //Gets the number of IO threads used to prefetch bricks (0 = no prefetching)
+  inline int GetPrefetchThreads() {
+    return m_PrefetchThreads;
+  }
+
+  //Sets the number of IO threads used to prefetch bricks (default 2)
+  //0 means that bricks are loaded sequentially by the calling thread
+  //NB: bricks of compressed files (version 3) are decoded by these threads,
+  //so at least as many threads as there are CPUs are used for such files
+  inline void SetPrefetchThreads(int nThreads) {
+    m_PrefetchThreads = nThreads < 0 ? 0 : nThreads;
+  }
+
+  //Gets the maximal number of bricks that can be prefetched in advance
+  inline int GetPrefetchQueueDepth() {
+    return m_PrefetchQueueDepth;
+  }
+
+  //Sets the maximal number of bricks that can be prefetched in advance (default 16)
+  //NB: if the file is not mapped, every prefetched brick occupies one brick buffer
+  inline void SetPrefetchQueueDepth(int nDepth) {
+    m_PrefetchQueueDepth = nDepth < 1 ? 1 : nDepth;
+  }
+
+  //Returns true, if bricks of the currently opened file are compressed (version 3)
+  inline bool IsCompressed() {
+    return m_PBrickOffsets != NULL;
+  }
+
+  //Returns true, if the currently opened brick file is mapped into the memory
+  inline bool IsMemoryMapped() {
+    return m_BrickFile != NULL && m_BrickFile->IsMapped();
+  }
+
   /** Sets VOI to be empty, i.e., this will actually release the memory */
   inline void SetEmptyVOI()
   {
@@ -129,6 +214,16 @@ public:
 	//returns false if an error occurs
 	/*virtual*/ bool Update();
 
+	//returns the version of the given BBF file, or 0, if the file
+	//cannot be opened or it is not BBF file
+	static int GetFileVersion(const char* fname);
+
+	//returns true, if the given file is BBF file of a version supported by this reader
+	inline static bool IsFileSupported(const char* fname) {
+		int nVersion = GetFileVersion(fname);
+		return nVersion > 0 && nVersion <= mafBrickedFile::m_CompressedVersion;
+	}
+
 protected:
 	//Called by Update to fill some internal structures
 	/*virtual*/ void ExecuteInformation() throw(...);
@@ -152,6 +247,9 @@ protected:
 	//releasing memory allocated for index table, etc.
 	virtual void CloseBrickFile();
 
+	//combines nSize bytes of pData into the FNV-1a hash nHash and returns the result
+	static unsigned long long HashBytes(unsigned long long nHash, const void* pData, int nSize);
+
 protected:
 	//returns true, if the brick at position xb relative to the
 	//beginning of the brick line described by pIdxMain and the 
@@ -165,9 +263,14 @@ protected:
 	//fills the entire brick specified by pOutPtr with the value pointed by pConstVal	
 	inline void FillBrick(char* pOutPtr, const char* pConstVal);
 
-	//loads the brick with the given index from file 
-	//into the memory denoted by pOutPtr
-	inline void LoadBrick(int nBrickIndex, char* pOutPtr) throw(...);
+	//loads the brick with the given index from file and returns pointer to its data;
+	//if the file is mapped, the returned pointer points directly into the view,
+	//otherwise the brick is read into the memory denoted by pOutPtr
+	inline const char* LoadBrick(int nBrickIndex, char* pOutPtr) throw(...);
+
+	//loads the compressed brick with the given index from file (version 3 only),
+	//decodes it into pOutPtr and returns pointer to its data
+	const char* LoadPackedBrick(int nBrickIndex, char* pOutPtr) throw(...);
 	
 	//computes extents in inner bricks and boundary bricks	
 	//for the given extent VOI that is specified in voxels (of highest resolution level)
@@ -223,14 +326,21 @@ inline void mafBrickedFileReader::FillBrick(char* pOutPtr, const char* pConstVal
 	}
 }
 
-//loads the brick with the given index from file 
-//into the memory denoted by pOutPtr
-inline void mafBrickedFileReader::LoadBrick(int nBrickIndex, char* pOutPtr) throw(...)
+//loads the brick with the given index from file and returns pointer to its data;
+//if the file is mapped, the returned pointer points directly into the view,
+//otherwise the brick is read into the memory denoted by pOutPtr
+inline const char* mafBrickedFileReader::LoadBrick(int nBrickIndex, char* pOutPtr) throw(...)
 {
+	if (m_PBrickOffsets != NULL)
+		return LoadPackedBrick(nBrickIndex, pOutPtr);
+
 	long long offset = ((long long)nBrickIndex)*m_NBrickSizeInB[2] + sizeof(BBF_HEADER);
+  if (m_BrickFile->IsMapped())
+    return m_BrickFile->GetView(offset, m_NBrickSizeInB[2]);
 
   m_BrickFile->Seek(offset);
 	m_BrickFile->Read(pOutPtr, m_NBrickSizeInB[2]);
+  return pOutPtr;
 }
 
 //copies the part of brick data that is within brckExt into pOutPtr 
@@ -21,6 +21,8 @@ Writes the BBF file, using data from vtkMAFLargeImageDataSet
 //----------------------------------------------------------------------------
 
 #include "mafBrickedFileWriter.h"
+#include "mafBrickedFileWriterPool.h"
+#include "mafBrickedFileCodec.h"
 #include "../vtkMAF/vtkMAFFileDataProvider.h"
 
 mafCxxTypeMacro(mafBrickedFileWriter);
@@ -40,16 +42,20 @@ mafBrickedFileWriter::mafBrickedFileWriter()
   m_PInputXYZCoords[1] = NULL;
   m_PInputXYZCoords[2] = NULL;
 
-	m_PBricksBuffer = NULL;
-	m_PBricksValidity = NULL;	
+	m_CurrentSlot = -1;
+	m_NextPlaneToStore = 0;
+	m_PDstBuf = NULL;
 
-	m_PTuplesBuffer = NULL;
-	m_PSumTuplesBuffer = NULL;		
+	m_Pool = NULL;
+	m_SharedPool = NULL;
+	m_NumberOfThreads = -1;		//auto
+	m_NumberOfPlaneBuffers = 3;	//one being filled, one processed and one written
 }
 
 mafBrickedFileWriter::~mafBrickedFileWriter()
 {	
 	//all should be removed in Update
+	AbortWrite();
 	vtkDEL(m_InputDataSet);
   vtkDEL(m_PInputXYZCoords[0]);
   vtkDEL(m_PInputXYZCoords[1]);
@@ -193,22 +199,44 @@ void mafBrickedFileWriter::SetInputZCoordinates(vtkDoubleArray* pCoords)
 //allocates the required buffers
 /*virtual*/ void mafBrickedFileWriter::AllocateBuffers() throw(...)
 {	
-	m_PDataBuffer = new char[m_NBricksDimSizeInB[1]];
-	m_PBricksBuffer = new char[m_NBricksDimSizeInB[1]];	
-	m_PBricksValidity = new bool[m_NBricksDimSize[1]];
-	m_PLowResLevel = new char[m_NBricksDimSize[2]*m_NVoxelSizeInB];
+	//without threads, one plane is processed at a time
+	int nSlots = (m_Pool->GetNumberOfThreads() == 0) ? 1 : m_NumberOfPlaneBuffers;
+	m_PlaneSlots.resize(nSlots);
+	for (int i = 0; i < nSlots; i++)
+	{
+		BBF_PLANE_SLOT& slot = m_PlaneSlots[i];
+		slot.pDataBuffer = new char[m_NBricksDimSizeInB[1]];
+		slot.pBricksBuffer = new char[m_NBricksDimSizeInB[1]];	
+		slot.pBricksValidity = new bool[m_NBricksDimSize[1]];
+		slot.pPackedBuffer = NULL;
+		slot.pPackedSizes = NULL;
+		slot.nBrickPlane = -1;
+		slot.nPendingTasks = 0;
+		slot.nState = BBF_SLOT_FREE;
+
+		memset(slot.pDataBuffer, 0, m_NBricksDimSizeInB[1]);	//to ensure we have zeros
+
+		if (GetCompression())
+		{
+			slot.pPackedBuffer = new char[m_NBricksDimSizeInB[1]];
+			slot.pPackedSizes = new int[m_NBricksDimSize[1]];
+		}
+	}
 
-	memset(m_PDataBuffer, 0, m_NBricksDimSizeInB[1]);	//to ensure we have zeros
+	m_CurrentSlot = -1;
+	m_NextPlaneToStore = 0;
+	m_PDstBuf = NULL;
 
-	//buffers for tuples
-	m_PTuplesBuffer = new char[16*m_NVoxelSizeInB];
-	m_PSumTuplesBuffer = new double[16*this->GetNumberOfComponents()];
+	m_PLowResLevel = new char[m_NBricksDimSize[2]*m_NVoxelSizeInB];
 
 	m_PMainIdxTable = new BBF_IDX_MAINITEM[m_NBricksDim[1]*m_NBricksDim[2]];
 	memset(m_PMainIdxTable, 0, m_NBricksDim[1]*m_NBricksDim[2]*sizeof(BBF_IDX_MAINITEM));
 	
 	m_ExtraBrckMAP.clear();	
 
+	m_BrickOffsets.clear();
+	m_BrickOffsets.push_back(sizeof(BBF_HEADER));	//bricks follow the header
+
   if (this->IsRectilinearGrid())
   {
     for (int i = 0; i < 3; i++)
@@ -225,11 +253,18 @@ void mafBrickedFileWriter::SetInputZCoordinates(vtkDoubleArray* pCoords)
 {
 	cppDEL(m_PLowResLevel);
 	cppDEL(m_PMainIdxTable);	
-	cppDEL(m_PDataBuffer);
-	cppDEL(m_PBricksBuffer);
-	cppDEL(m_PBricksValidity);
-	cppDEL(m_PTuplesBuffer);
-	cppDEL(m_PSumTuplesBuffer);
+
+	for (int i = 0; i < (int)m_PlaneSlots.size(); i++)
+	{
+		delete[] m_PlaneSlots[i].pDataBuffer;
+		delete[] m_PlaneSlots[i].pBricksBuffer;
+		delete[] m_PlaneSlots[i].pBricksValidity;
+		delete[] m_PlaneSlots[i].pPackedBuffer;
+		delete[] m_PlaneSlots[i].pPackedSizes;
+	}
+
+	m_PlaneSlots.clear();
+	m_CurrentSlot = -1;
 
   for (int i = 0; i < 3; i++) {    
     vtkDEL(m_PXYZCoords[i]);
@@ -263,84 +298,114 @@ void mafBrickedFileWriter::SetInputZCoordinates(vtkDoubleArray* pCoords)
 	int nElemsPerLine = (VOI[1] - VOI[0] + 1) * dsc->GetNumberOfComponents();
 	int nBytesPerLine = nElemsPerLine * dsc->GetDataTypeSize();
   char* pLineBuffer = new char[nBytesPerLine];
-	
-	//number of sampled bytes
-	int nSkipBytesX = (m_NBricksDim[0]*m_NBrickSize[0] - nDims[0])*m_NVoxelSizeInB;
-	int nSkipBytesY = m_NBricksDim[0]*m_NBrickSize[0]*
-		(m_NBricksDim[1]*m_NBrickSize[0] - nDims[1])*m_NVoxelSizeInB;
 
 	//get increments
 	vtkIdType64 dataIncr[3];
 	m_InputDataSet->GetIncrements(dataIncr);	//get increments (in elements)	
 
 	vtkIdType64 dataIncrSkip[3];
-	dataIncrSkip[0] = dataIncr[0]*nSampleRate;
 	dataIncrSkip[1] = dataIncr[1]*nSampleRate;
 	dataIncrSkip[2] = dataIncr[2]*nSampleRate;
-  int nLineBufSkip = 
-  //BES: 11.7.2008 - GetIncrements takes number of components into account
-    ((int)dataIncrSkip[0] - dsc->GetNumberOfComponents())*
-      (m_NVoxelSizeInB / dsc->GetNumberOfComponents());
-
-	char* pDstBuf = m_PDataBuffer;
 
-	//index to the first element	
-	vtkIdType64 nStartIndex = VOI[0]*dataIncr[0] + VOI[2]*dataIncr[1] + VOI[4]*dataIncr[2];		
-	for (int zb = 0; zb < nDims[2]; zb++, nStartIndex += dataIncrSkip[2])
+	try
 	{
-		mafEventMacro(mafEvent(this, PROGRESSBAR_SET_VALUE, (long)(100*zb / nDims[2])));
-
-		//processing one plane
-		//process sampled lines at this plane
-		vtkIdType64 nLineIndex = nStartIndex;				
-		for (int yb = 0; yb < nDims[1]; yb++, nLineIndex += dataIncrSkip[1])
+		//index to the first element	
+		vtkIdType64 nStartIndex = VOI[0]*dataIncr[0] + VOI[2]*dataIncr[1] + VOI[4]*dataIncr[2];		
+		for (int zb = 0; zb < nDims[2]; zb++, nStartIndex += dataIncrSkip[2])
 		{
-			//process every pixel the current line 
-			dp->GetDataArray(nScalarsDscIndex, (void*)pLineBuffer, 
-				(vtkIdType64)nElemsPerLine, nLineIndex);
-
-			//now sample the read pixel line and write it
-			//first voxel is always present
-			char* pSrcLineBuf = pLineBuffer;
-			for (int xb = 0; xb < nDims[0]; xb++)
+			mafEventMacro(mafEvent(this, PROGRESSBAR_SET_VALUE, (long)(100*zb / nDims[2])));
+
+			//processing one plane
+			//process sampled lines at this plane
+			vtkIdType64 nLineIndex = nStartIndex;				
+			for (int yb = 0; yb < nDims[1]; yb++, nLineIndex += dataIncrSkip[1])
 			{
-				for (int i = 0; i < m_NVoxelSizeInB; i++) {
-					*pDstBuf = *pSrcLineBuf;
-					pDstBuf++; pSrcLineBuf++;
-				}
+				//process every pixel the current line 
+				dp->GetDataArray(nScalarsDscIndex, (void*)pLineBuffer, 
+					(vtkIdType64)nElemsPerLine, nLineIndex);
 
-				pSrcLineBuf += nLineBufSkip;	//we increased it in loop
+				//sample it and pass completed brick planes to the pool
+				ProcessSourceLine(yb*nSampleRate, zb*nSampleRate, pLineBuffer);
+			}
+		}	
+	}
+	catch (...)
+	{
+		delete[] pLineBuffer;
+		throw;
+	}
+
+  delete[] pLineBuffer;
+}
+
+//Processes one line of the input data set, y and z are indices of the line 
+//relative to VOI, pLineBuffer contains the whole line within VOI
+void mafBrickedFileWriter::ProcessSourceLine(int y, int z, const char* pLineBuffer) throw(...)
+{
+	int nSampleRate = this->GetSampleRate();
+	if ((y % nSampleRate) != 0 || (z % nSampleRate) != 0)
+		return;	//not on our sampling grid
+
+	int yb = y / nSampleRate;
+	int zb = z / nSampleRate;
+	if (yb == 0 && (zb % m_NBrickSize[0]) == 0)
+	{
+		//the first line of a new brick plane
+		m_CurrentSlot = m_Pool->AcquireSlot(this);
+		m_PDstBuf = m_PlaneSlots[m_CurrentSlot].pDataBuffer;
+	}
+
+	//now sample the read pixel line and write it
+	//first voxel is always present
+	char* pDstBuf = m_PDstBuf;
+	if (m_NLineBufSkip == 0)
+	{
+		//no sampling in x-direction
+		memcpy(pDstBuf, pLineBuffer, m_FileHeader.dims[0]*m_NVoxelSizeInB);
+		pDstBuf += m_FileHeader.dims[0]*m_NVoxelSizeInB;
+	}
+	else
+	{
+		const char* pSrcLineBuf = pLineBuffer;
+		for (int xb = 0; xb < m_FileHeader.dims[0]; xb++)
+		{
+			for (int i = 0; i < m_NVoxelSizeInB; i++) {
+				*pDstBuf = *pSrcLineBuf;
+				pDstBuf++; pSrcLineBuf++;
 			}
 
-			pDstBuf += nSkipBytesX;
+			pSrcLineBuf += m_NLineBufSkip;	//we increased it in loop
 		}
+	}
+
+	pDstBuf += m_NSkipBytesX;
 
-		pDstBuf += nSkipBytesY;
+	if (yb + 1 == m_FileHeader.dims[1])
+	{
+		//the last line of the plane
+		pDstBuf += m_NSkipBytesY;
 
+		BBF_PLANE_SLOT& slot = m_PlaneSlots[m_CurrentSlot];
 		bool bBrickFinished = ((zb + 1) % m_NBrickSize[0]) == 0;
-		if (!bBrickFinished && (zb + 1) == nDims[2])
+		if (!bBrickFinished && (zb + 1) == m_FileHeader.dims[2])
 		{
 			//reset the rest planes
-			memset(pDstBuf, 0, m_NBricksDimSizeInB[1] - (pDstBuf - m_PDataBuffer));
+			memset(pDstBuf, 0, m_NBricksDimSizeInB[1] - (pDstBuf - slot.pDataBuffer));
 			bBrickFinished = true;
 		}
 
 		if (bBrickFinished)
 		{
-			//perform bricking
-			ConstructBricks();
-
-			//process the loaded bricks
-			ProcessBricks(zb / m_NBrickSize[0]);
-
-			//data written already in ProcessBricks
-			//m_BrickFile->WriteFile( m_pDataBuffer, m_nBricksDimSizeInB[1]);
+			//perform bricking and writing (possibly asynchronously)
+			slot.nBrickPlane = zb / m_NBrickSize[0];
+			m_CurrentSlot = -1;
+			pDstBuf = NULL;
 
-			pDstBuf = m_PDataBuffer;
+			m_Pool->SubmitSlot(this, (int)(&slot - &m_PlaneSlots[0]));
 		}
-	}	
+	}
 
-  delete[] pLineBuffer;
+	m_PDstBuf = pDstBuf;
 }
 
 //------------------------------------------------------------------------
@@ -407,25 +472,28 @@ void mafBrickedFileWriter::SetInputZCoordinates(vtkDoubleArray* pCoords)
 
 
 
-//processes the currently loaded block of data
-//creating its bricked version, computing average values
-//for every brick and determining which bricks are uniform
-/*virtual*/ void mafBrickedFileWriter::ConstructBricks()  throw(...)
+//processes the block of data in the slot, brick lines nFromBrickLine to
+//nToBrickLine - 1 only, creating its bricked version
+/*virtual*/ void mafBrickedFileWriter::ConstructBricks(BBF_PLANE_SLOT& slot,
+	int nFromBrickLine, int nToBrickLine)  throw(...)
 {
-	char* pCurLineBuf = m_PDataBuffer;
+	int nLineSizeInB = m_NBricksDim[0]*m_NBrickSizeInB[0];	//one sampled line incl. alignment
 
-	int nBricksBufOfsZ = 0;
+	int nBricksBufOfsZ = nFromBrickLine*m_NBricksDimSizeInB[0];
 	for (int zb = 0; zb < m_NBrickSize[0]; zb++, nBricksBufOfsZ += m_NBrickSizeInB[1])
 	{				
+		const char* pCurLineBuf = slot.pDataBuffer + 
+			(zb*m_NBricksDim[1] + nFromBrickLine)*m_NBrickSize[0]*nLineSizeInB;
+
 		//process every brick line at this plane
 		int nBricksBufOfsY = nBricksBufOfsZ;	
-		for (int yb = 0; yb < m_NBricksDim[1]; yb++, nBricksBufOfsY += m_NBricksDimSizeInB[0])
+		for (int yb = nFromBrickLine; yb < nToBrickLine; yb++, nBricksBufOfsY += m_NBricksDimSizeInB[0])
 		{				
 			int nBricksBufOfs = nBricksBufOfsY;	
 			for (int y = 0; y < m_NBrickSize[0]; y++, nBricksBufOfs += m_NBrickSizeInB[0])
 			{					
 				//now copy the read pixel line into bricks					
-				char* pCurBricksBuf = m_PBricksBuffer + nBricksBufOfs;					
+				char* pCurBricksBuf = slot.pBricksBuffer + nBricksBufOfs;					
 				for (int i = 0; i < m_NBricksDim[0]; i++)
 				{
 					memcpy(pCurBricksBuf, pCurLineBuf, m_NBrickSizeInB[0]);
@@ -438,43 +506,84 @@ void mafBrickedFileWriter::SetInputZCoordinates(vtkDoubleArray* pCoords)
 	}
 }
 
-//Process the currently loaded bricks, computing average values
-//for every brick and determining which bricks are uniform
-/*virtual*/ void mafBrickedFileWriter::ProcessBricks(int nCurBrickPlane)  throw(...)
+//constructs bricks for brick lines nFromBrickLine to nToBrickLine - 1 of the slot,
+//computing average values for every brick and determining which bricks are uniform
+/*virtual*/ void mafBrickedFileWriter::ProcessBricks(BBF_PLANE_SLOT& slot,
+	int nFromBrickLine, int nToBrickLine)  throw(...)
 {
-	switch (m_InputDataSet->GetScalarType())
+	ConstructBricks(slot, nFromBrickLine, nToBrickLine);
+
+	//NB: the input data set is not accessed here as we may run in a worker thread
+	switch (m_FileHeader.datatype)
 	{
 		//short data type => we can use int for sums (will be faster)
-	case VTK_UNSIGNED_CHAR: CreateBricksLowResolution< unsigned char, int >(nCurBrickPlane); break;
-	case VTK_CHAR: CreateBricksLowResolution< char, int >(nCurBrickPlane); break;
-	case VTK_UNSIGNED_SHORT: CreateBricksLowResolution< unsigned short, int >(nCurBrickPlane); break;
-	case VTK_SHORT: CreateBricksLowResolution< short, int >(nCurBrickPlane); break;
+	case VTK_UNSIGNED_CHAR: CreateBricksLowResolution< unsigned char, int >(slot, nFromBrickLine, nToBrickLine); break;
+	case VTK_CHAR: CreateBricksLowResolution< char, int >(slot, nFromBrickLine, nToBrickLine); break;
+	case VTK_UNSIGNED_SHORT: CreateBricksLowResolution< unsigned short, int >(slot, nFromBrickLine, nToBrickLine); break;
+	case VTK_SHORT: CreateBricksLowResolution< short, int >(slot, nFromBrickLine, nToBrickLine); break;
 
 		//we will have to use double for sums
-	case VTK_DOUBLE: CreateBricksLowResolution< double, double >(nCurBrickPlane); break;
-	case VTK_FLOAT: CreateBricksLowResolution< float, double >(nCurBrickPlane); break;
-	case VTK_LONG: CreateBricksLowResolution< long, double >(nCurBrickPlane); break;
-	case VTK_UNSIGNED_LONG: CreateBricksLowResolution< unsigned long, double >(nCurBrickPlane); break;
-	case VTK_INT: CreateBricksLowResolution< int, double >(nCurBrickPlane); break;
-	case VTK_UNSIGNED_INT: CreateBricksLowResolution< unsigned int, double >(nCurBrickPlane); break;
+	case VTK_DOUBLE: CreateBricksLowResolution< double, double >(slot, nFromBrickLine, nToBrickLine); break;
+	case VTK_FLOAT: CreateBricksLowResolution< float, double >(slot, nFromBrickLine, nToBrickLine); break;
+	case VTK_LONG: CreateBricksLowResolution< long, double >(slot, nFromBrickLine, nToBrickLine); break;
+	case VTK_UNSIGNED_LONG: CreateBricksLowResolution< unsigned long, double >(slot, nFromBrickLine, nToBrickLine); break;
+	case VTK_INT: CreateBricksLowResolution< int, double >(slot, nFromBrickLine, nToBrickLine); break;
+	case VTK_UNSIGNED_INT: CreateBricksLowResolution< unsigned int, double >(slot, nFromBrickLine, nToBrickLine); break;
 
 	default:
 		throw std::invalid_argument(_("Unknown data type.\n"));	
 	}	
 
+	if (GetCompression())
+		PackBricks(slot, nFromBrickLine, nToBrickLine);
+}
+
+//compresses non-uniform bricks of brick lines nFromBrickLine to nToBrickLine - 1 of the slot
+/*virtual*/ void mafBrickedFileWriter::PackBricks(BBF_PLANE_SLOT& slot,
+	int nFromBrickLine, int nToBrickLine)  throw(...)
+{
+	int nFirst = nFromBrickLine*m_NBricksDim[0];
+	int nLast = nToBrickLine*m_NBricksDim[0];
+	int nElemSize = m_NVoxelSizeInB / m_FileHeader.numcomps;
+
+	char* pWork = new char[m_NBrickSizeInB[2]];		//every thread has its own
+	for (int i = nFirst; i < nLast; i++)
+	{
+		if (slot.pBricksValidity[i])
+		{
+			int nOfs = i*m_NBrickSizeInB[2];
+			slot.pPackedSizes[i] = mafBrickedFileCodec::Compress(slot.pBricksBuffer + nOfs, 
+				m_NBrickSizeInB[2], nElemSize, m_FileHeader.numcomps, slot.pPackedBuffer + nOfs, pWork);
+		}
+	}
+
+	delete[] pWork;
+}
+
+//writes non-uniform bricks of the processed slot and updates the index table
+/*virtual*/ void mafBrickedFileWriter::StoreBricks(BBF_PLANE_SLOT& slot) throw(...)
+{
 	//store every non uniform brick
-	char* pCurBrick = m_PBricksBuffer;
+	bool bCompressed = GetCompression();
+	char* pCurBrick = bCompressed ? slot.pPackedBuffer : slot.pBricksBuffer;
 	for (int i = 0; i < m_NBricksDimSize[1]; i++)
 	{
-		if (m_PBricksValidity[i]) {			
-			m_BrickFile->Write( pCurBrick, m_NBrickSizeInB[2]);
+		if (slot.pBricksValidity[i]) 
+		{			
+			if (!bCompressed)
+				m_BrickFile->Write( pCurBrick, m_NBrickSizeInB[2]);
+			else
+			{
+				m_BrickFile->Write( pCurBrick, slot.pPackedSizes[i]);
+				m_BrickOffsets.push_back(m_BrickOffsets.back() + slot.pPackedSizes[i]);
+			}
 		}
 
 		pCurBrick += m_NBrickSizeInB[2];
 	}
 
 	//this updates brick map, i.e., data stucture storing the information which bricks are uniform
-	CreateBricksIndexTable(nCurBrickPlane);
+	CreateBricksIndexTable(slot.nBrickPlane, slot.pBricksValidity);
 }
 
 //computes an average value for every brick in the current
@@ -484,26 +593,26 @@ void mafBrickedFileWriter::SetInputZCoordinates(vtkDoubleArray* pCoords)
 //the computed values are stored as the lowest resolution snapshot
 //and uniform bricks are also denoted during the process
 template< typename T_VAL, typename T_SUM >
-void mafBrickedFileWriter::CreateBricksLowResolution(int nCurBrickPlane)
+void mafBrickedFileWriter::CreateBricksLowResolution(BBF_PLANE_SLOT& slot,
+	int nFromBrickLine, int nToBrickLine)
 {
-	vtkMAFLargeDataProvider* dp = m_InputDataSet->GetPointDataProvider();
-	vtkMAFDataArrayDescriptor* dsc = dp->GetScalarsDescriptor();
-
-	int comps = dsc->GetNumberOfComponents();
+	int comps = m_FileHeader.numcomps;
 
-	//prepare buffers for min and max
-	T_VAL* pMins = (T_VAL*)m_PTuplesBuffer;
+	//prepare buffers for min and max (every thread has its own)
+	T_VAL* pMins = new T_VAL[2*comps];
 	T_VAL* pMaxs = pMins + comps;
-	T_SUM* pSums = (T_SUM*)m_PSumTuplesBuffer;
+	T_SUM* pSums = new T_SUM[comps];
 
 	//compute the current index
-	int index = nCurBrickPlane*m_NBricksDimSize[1];
+	int nFirst = nFromBrickLine*m_NBricksDim[0];
+	int nLast = nToBrickLine*m_NBricksDim[0];
+	int index = slot.nBrickPlane*m_NBricksDimSize[1] + nFirst;
 	T_VAL* pLevelBuf = (T_VAL*)m_PLowResLevel;
 	pLevelBuf += index*comps;
 
 	//process every brick
-	char* pCurBrick = m_PBricksBuffer;
-	for (int i = 0; i < m_NBricksDimSize[1]; i++, index++)
+	char* pCurBrick = slot.pBricksBuffer + nFirst*m_NBrickSizeInB[2];
+	for (int i = nFirst; i < nLast; i++, index++)
 	{		
 		T_VAL* pData = (T_VAL*)pCurBrick;
 		pCurBrick += m_NBrickSizeInB[2];
@@ -540,7 +649,7 @@ void mafBrickedFileWriter::CreateBricksLowResolution(int nCurBrickPlane)
 			}
 		}
 
-		if (!(m_PBricksValidity[i] = !bUniform))
+		if (!(slot.pBricksValidity[i] = !bUniform))
 		{
 			//brick is not uniform => compute average
 			for (int j = 0; j < comps; j++) {
@@ -554,11 +663,14 @@ void mafBrickedFileWriter::CreateBricksLowResolution(int nCurBrickPlane)
 			pLevelBuf++;
 		}		
 	}
+
+	delete[] pMins;
+	delete[] pSums;
 }
 
 //updates brick map, i.e., data stucture storing the information which bricks are uniform
 //NB: nPrevSkipped member has a temporary value 
-void mafBrickedFileWriter::CreateBricksIndexTable(int nCurBrickPlane)
+void mafBrickedFileWriter::CreateBricksIndexTable(int nCurBrickPlane, const bool* pBricksValidity)
 {
 	BBF_IDX_EXITEM ssItem;
 	
@@ -568,10 +680,10 @@ void mafBrickedFileWriter::CreateBricksIndexTable(int nCurBrickPlane)
 		bool bCurMode = false;		
 		for (int x = 0; x < m_NBricksDim[0]; x++, idx++)
 		{
-			if (!m_PBricksValidity[idx])	//increase number of skipped bricks
+			if (!pBricksValidity[idx])	//increase number of skipped bricks
 				m_PMainIdxTable[nIndex].nPrevSkipped++;
 
-			if (m_PBricksValidity[idx] != bCurMode ||	//change in mode
+			if (pBricksValidity[idx] != bCurMode ||	//change in mode
 				(bCurMode && x + 1 == m_NBricksDim[0]))	//or last item in the line
 			{
 				//either begin or end of uniformity
@@ -611,93 +723,156 @@ void mafBrickedFileWriter::CreateBricksIndexTable(int nCurBrickPlane)
 }
 
 
-//This method updates the output (i.e., it performs the bricking)	
-/*virtual*/ bool mafBrickedFileWriter::Update()
+//Creates the output file and prepares the writer for ProcessSourceLine calls
+void mafBrickedFileWriter::BeginWrite() throw(...)
 {
-	if (this->GetMTime() <= m_LastUpdateTime) {
-		return true; //no change
-	}
+	//create file
+  m_BrickFile = vtkMAFFile2::New();
+	m_BrickFile->Create(m_BrickFileName);
+  m_BrickFile->Write( &m_FileHeader, sizeof(BBF_HEADER));
 
-	mafEventMacro(mafEvent(this, PROGRESSBAR_SHOW, this));
+	ExecuteInformation();	//initialize "global" variables
 
-	mafString szMsg = _("Initialization ...");
-	mafEventMacro(mafEvent(this, PROGRESSBAR_SET_TEXT, &szMsg));
-	mafEventMacro(mafEvent(this, PROGRESSBAR_SET_VALUE, (long)0));
-
-	try
+	m_Pool = m_SharedPool;
+	if (m_Pool == NULL)
 	{
-		//create file
-    m_BrickFile = vtkMAFFile2::New();
-		m_BrickFile->Create(m_BrickFileName);
-    m_BrickFile->Write( &m_FileHeader, sizeof(BBF_HEADER));
+		m_Pool = new mafBrickedFileWriterPool();
+		m_Pool->Start(m_NumberOfThreads >= 0 ? m_NumberOfThreads : 
+			mafBrickedFileWriterPool::GetDefaultNumberOfThreads());
+	}
 
-		ExecuteInformation();	//initialize "global" variables
-		AllocateBuffers();		//allocate memory for bricks, etc.		
+	AllocateBuffers();		//allocate memory for bricks, etc.		
 
-		//perform sampling + bricking (stores also rectilinear grid)
-		ExecuteData();
+	//number of sampled bytes
+	int nSampleRate = this->GetSampleRate();
+	m_NSkipBytesX = (m_NBricksDim[0]*m_NBrickSize[0] - m_FileHeader.dims[0])*m_NVoxelSizeInB;
+	m_NSkipBytesY = m_NBricksDim[0]*m_NBrickSize[0]*
+		(m_NBricksDim[1]*m_NBrickSize[0] - m_FileHeader.dims[1])*m_NVoxelSizeInB;
 
-		//time to store low resolution
-		szMsg = _("Writing LOW Resolution map ...");
-		mafEventMacro(mafEvent(this, PROGRESSBAR_SET_TEXT, &szMsg));    
-		
-		m_BrickFile->Write( m_PLowResLevel, m_NBricksDimSize[2]*m_NVoxelSizeInB);
+	//get increments
+	vtkIdType64 dataIncr[3];
+	m_InputDataSet->GetIncrements(dataIncr);	//get increments (in elements)	
 
-//		int f = IOFileUtils::CreateFile(wxString::Format("g:\\brckmap_%d_%d_%d.raw",
-//			m_nBricksDim[0], m_nBricksDim[1], m_nBricksDim[2]));
-//		IOFileUtils::WriteFile(f, m_pLowResLevel, m_nBricksDimSize[2]*m_nVoxelSizeInB);
-//		IOFileUtils::CloseFile(f);
+	m_NLineBufSkip = 
+	//BES: 11.7.2008 - GetIncrements takes number of components into account
+		((int)(dataIncr[0]*nSampleRate) - m_FileHeader.numcomps)*
+			(m_NVoxelSizeInB / m_FileHeader.numcomps);
+}
 
-		//and our index table
-		szMsg = _("Writing index table ...");
-		mafEventMacro(mafEvent(this, PROGRESSBAR_SET_TEXT, &szMsg));
-				
-		int nPrevSum = 0;		
-		int nCount = m_NBricksDim[1]*m_NBricksDim[2];
-		for (int i = 0; i < nCount; i++) {
-			int nNextVal = m_PMainIdxTable[i].nPrevSkipped;
-			m_PMainIdxTable[i].nPrevSkipped = nPrevSum;
-			nPrevSum += nNextVal;			
-		}
-		
+//Writes the remaining parts of the file and closes it
+void mafBrickedFileWriter::EndWrite() throw(...)
+{
+	//wait until all brick planes are written
+	m_Pool->Flush(this);
 
-		m_FileHeader.idxtblofs = m_BrickFile->GetCurrentPos();
-    m_BrickFile->Write(m_PMainIdxTable, nCount*sizeof(BBF_IDX_MAINITEM));
+	//time to store low resolution
+	mafString szMsg = _("Writing LOW Resolution map ...");
+	mafEventMacro(mafEvent(this, PROGRESSBAR_SET_TEXT, &szMsg));    
+	
+	m_BrickFile->Write( m_PLowResLevel, m_NBricksDimSize[2]*m_NVoxelSizeInB);
 
-		m_FileHeader.extra_idx_items = (unsigned long)m_ExtraBrckMAP.size();
-		for (int i = 0; i < (int)m_ExtraBrckMAP.size(); i++) {
-			m_BrickFile->Write(&m_ExtraBrckMAP[i], sizeof(BBF_IDX_EXITEM));
-		}
+	//and our index table
+	szMsg = _("Writing index table ...");
+	mafEventMacro(mafEvent(this, PROGRESSBAR_SET_TEXT, &szMsg));
+			
+	int nPrevSum = 0;		
+	int nCount = m_NBricksDim[1]*m_NBricksDim[2];
+	for (int i = 0; i < nCount; i++) {
+		int nNextVal = m_PMainIdxTable[i].nPrevSkipped;
+		m_PMainIdxTable[i].nPrevSkipped = nPrevSum;
+		nPrevSum += nNextVal;			
+	}
+	
 
-    //compute rectilinear coordinates and store them
-    ProcessCoordinates(); 
+	m_FileHeader.idxtblofs = m_BrickFile->GetCurrentPos();
+  m_BrickFile->Write(m_PMainIdxTable, nCount*sizeof(BBF_IDX_MAINITEM));
 
-		m_BrickFile->Seek(0, SEEK_SET);
-		m_BrickFile->Write( &m_FileHeader, sizeof(BBF_HEADER));
+	m_FileHeader.extra_idx_items = (unsigned long)m_ExtraBrckMAP.size();
+	for (int i = 0; i < (int)m_ExtraBrckMAP.size(); i++) {
+		m_BrickFile->Write(&m_ExtraBrckMAP[i], sizeof(BBF_IDX_EXITEM));
 	}
-	catch (std::exception& e)
+
+	if (GetCompression())
 	{
-		//time to display the message
-		wxMessageBox(e.what(), _("Error: Bricking failed"), wxOK | wxICON_EXCLAMATION);
+		//number of non-uniform bricks and their offsets, so that the reader
+		//can access any brick directly, the brick i is stored in the range
+		//from m_BrickOffsets[i] to m_BrickOffsets[i + 1] - 1
+		unsigned long long nBricks = m_BrickOffsets.size() - 1;
+		m_BrickFile->Write(&nBricks, sizeof(nBricks));
+		m_BrickFile->Write(&m_BrickOffsets[0], m_BrickOffsets.size()*sizeof(unsigned long long));
+	}
+
+  //compute rectilinear coordinates and store them
+  ProcessCoordinates(); 
+
+	m_BrickFile->Seek(0, SEEK_SET);
+	m_BrickFile->Write( &m_FileHeader, sizeof(BBF_HEADER));
+
+	szMsg = _("Finalization ...");
+	mafEventMacro(mafEvent(this, PROGRESSBAR_SET_TEXT, &szMsg));
+
+	if (m_Pool != m_SharedPool)
+		delete m_Pool;		//stops also its threads
+	m_Pool = NULL;
+
+	DeallocateBuffers();	
+	m_BrickFile->Close();	
+  m_BrickFile->Delete();
+  m_BrickFile = NULL;
+}
 
+//Closes and deletes the output file after an error
+void mafBrickedFileWriter::AbortWrite()
+{
+	//own threads must not touch our buffers anymore
+	if (m_Pool != m_SharedPool)
+		delete m_Pool;
+	m_Pool = NULL;
+
+	if (m_BrickFile != NULL)
+	{
 		//delete the file
 		m_BrickFile->Close();
-    m_BrickFile->Delete();
-    m_BrickFile = NULL;
+		m_BrickFile->Delete();
+		m_BrickFile = NULL;
 #pragma warning(suppress: 6031) // warning C6031: Return value ignored: '_unlink'
 		_unlink(m_BrickFileName);
+	}
 
-		return false;
+	DeallocateBuffers();
+}
+
+//This method updates the output (i.e., it performs the bricking)	
+/*virtual*/ bool mafBrickedFileWriter::Update()
+{
+	if (this->GetMTime() <= m_LastUpdateTime) {
+		return true; //no change
 	}
 
+	mafEventMacro(mafEvent(this, PROGRESSBAR_SHOW, this));
 
-	szMsg = _("Finalization ...");
+	mafString szMsg = _("Initialization ...");
 	mafEventMacro(mafEvent(this, PROGRESSBAR_SET_TEXT, &szMsg));
+	mafEventMacro(mafEvent(this, PROGRESSBAR_SET_VALUE, (long)0));
 
-	DeallocateBuffers();	
-	m_BrickFile->Close();	
-  m_BrickFile->Delete();
-  m_BrickFile = NULL;
+	try
+	{
+		BeginWrite();
+
+		//perform sampling + bricking
+		ExecuteData();
+
+		//store low resolution, index table and rectilinear grid
+		EndWrite();
+	}
+	catch (std::exception& e)
+	{
+		//time to display the message
+		wxMessageBox(e.what(), _("Error: Bricking failed"), wxOK | wxICON_EXCLAMATION);
+
+		AbortWrite();
+		return false;
+	}
 
 	mafEventMacro(mafEvent(this, PROGRESSBAR_HIDE, this));
 
@@ -18,28 +18,70 @@ Writes the BBF file, using data from vtkMAFLargeImageDataSet
 #include "mafBrickedFile.h"
 #include "../vtkMAF/vtkMAFLargeImageData.h"
 
+class mafBrickedFileWriterPool;
+
 class mafBrickedFileWriter : public mafBrickedFile
 {
 public:
 	mafTypeMacro(mafBrickedFileWriter, mafBrickedFile);	
 
+	friend class mafBrickedFileWriterPool;
+
+protected:
+	//states of plane slots
+	enum BBF_SLOT_STATE
+	{
+		BBF_SLOT_FREE,					//not used
+		BBF_SLOT_FILLING,				//sampled data are being stored into the slot
+		BBF_SLOT_QUEUED,				//waiting for (or being processed by) worker threads
+		BBF_SLOT_PROCESSED,			//bricks constructed, waiting for the writer thread
+	};
+
+	//buffers for one brick plane
+	typedef struct BBF_PLANE_SLOT
+	{
+		char* pDataBuffer;				//sampled data
+		char* pBricksBuffer;			//buffer for bricks data
+		bool* pBricksValidity;		//false mean that the brick is uniform
+		char* pPackedBuffer;			//compressed bricks (version 3 only), same layout as pBricksBuffer
+		int* pPackedSizes;				//sizes of compressed bricks (version 3 only)
+		int nBrickPlane;					//index of the brick plane in the slot
+		int nPendingTasks;				//number of worker tasks not finished yet
+		int nState;								//one of BBF_SLOT_STATE
+	} BBF_PLANE_SLOT;
+
 protected:
 	//input data set that should be bricked
 	vtkMAFLargeImageData* m_InputDataSet;
   vtkDoubleArray* m_PInputXYZCoords[3];   //<X,Y,Z-coordinates for rectilinear grids
   
-	//buffer for bricks data
-	char* m_PBricksBuffer;
-	bool* m_PBricksValidity;	//false mean that the brick is uniform
+	//buffers for brick planes being sampled, processed or written
+	std::vector< BBF_PLANE_SLOT > m_PlaneSlots;
+	int m_CurrentSlot;				//slot being filled, -1 if none
+	int m_NextPlaneToStore;		//index of brick plane to be written next
+
+	//the current position in the data buffer of the current slot
+	char* m_PDstBuf;
 
-	//buffer for input data set	
-	char* m_PDataBuffer;	//sampled data
+	//number of bytes skipped in the source line between two sampled voxels
+	int m_NLineBufSkip;
 
-	//a small buffers capable to hold 16 tuples (or their sums)
-	char* m_PTuplesBuffer;
-	double* m_PSumTuplesBuffer;
+	//number of bytes to align the sampled line / plane to bricks
+	int m_NSkipBytesX, m_NSkipBytesY;
 
 	std::vector< BBF_IDX_EXITEM > m_ExtraBrckMAP;
+
+	//offsets of non-uniform bricks in the file (version 3 only), 
+	//the last item is the offset just after the last brick
+	std::vector< unsigned long long > m_BrickOffsets;
+
+	//pool that processes and writes planes, m_Pool is either
+	//m_SharedPool or a pool owned by this writer (during writing)
+	mafBrickedFileWriterPool* m_Pool;
+	mafBrickedFileWriterPool* m_SharedPool;
+
+	int m_NumberOfThreads;				//number of worker threads for own pool, -1 = auto
+	int m_NumberOfPlaneBuffers;		//number of plane slots if threads are used
 	
 public:
 	mafBrickedFileWriter();
@@ -83,11 +125,81 @@ public:
 		}		
 	}  
 
+	//Returns true, if non-uniform bricks are compressed (BBF version 3)
+	inline bool GetCompression() {
+		return m_FileHeader.version >= m_CompressedVersion;
+	}
+
+	//Sets whether non-uniform bricks are compressed by a fast lossless codec
+	//(default false), compressed files (BBF version 3) are not readable by 
+	//readers that support only version 2, the output of version 2 is unchanged
+	inline void SetCompression(bool bCompress)
+	{
+		unsigned short nVersion = bCompress ? m_CompressedVersion : m_CurrentVersion;
+		if (m_FileHeader.version != nVersion) {
+			m_FileHeader.version = nVersion;
+			this->Modified();
+		}
+	}
+
+	//Gets the number of worker threads used to process brick planes
+	//-1 denotes the number suitable for this machine, 0 no threads
+	inline int GetNumberOfThreads() {
+		return m_NumberOfThreads;
+	}
+
+	//Sets the number of worker threads used to process brick planes
+	//-1 denotes the number suitable for this machine, 0 no threads
+	//NB: the output is the same for any number of threads
+	inline void SetNumberOfThreads(int nThreads)
+	{
+		if (m_NumberOfThreads != nThreads) {
+			m_NumberOfThreads = nThreads;
+			this->Modified();
+		}
+	}
+
+	//Gets the number of brick plane buffers used when threads are used
+	inline int GetNumberOfPlaneBuffers() {
+		return m_NumberOfPlaneBuffers;
+	}
+
+	//Sets the number of brick plane buffers used when threads are used,
+	//i.e., how many planes may be sampled, processed and written concurrently
+	//NB: every buffer needs twice the memory of one brick plane
+	inline void SetNumberOfPlaneBuffers(int nBuffers) {
+		m_NumberOfPlaneBuffers = nBuffers < 2 ? 2 : nBuffers;
+	}
+
+	//Sets the pool to be used instead of own threads, so that multiple
+	//writers (e.g., all LOD levels) can be processed by the same threads
+	inline void SetPool(mafBrickedFileWriterPool* pool) {
+		m_SharedPool = pool;
+	}
+
 public:
-	//This method updates the output (i.e., it performs the bricking)	
+	//This method updates the output (i.e., it performs the bricking)
 	//returns false if an error occurs
 	/*virtual*/ bool Update();
 
+	//Creates the output file and prepares the writer for ProcessSourceLine calls
+	//Update calls BeginWrite, ExecuteData and EndWrite, these methods are
+	//public for drivers that feed more writers from one pass over the input
+	void BeginWrite() throw(...);
+
+	//Processes one line of the input data set, y and z are indices of the line
+	//relative to VOI, pLineBuffer contains the whole line within VOI
+	//lines must come in the order of increasing z and y, lines not lying on
+	//the sampling grid of this writer are ignored
+	void ProcessSourceLine(int y, int z, const char* pLineBuffer) throw(...);
+
+	//Writes the remaining parts of the file and closes it
+	void EndWrite() throw(...);
+
+	//Closes and deletes the output file after an error
+	//NB: if a shared pool is used, it must be stopped in prior to this call
+	void AbortWrite();
+
 protected:
 	//Called by Update to fill some internal structures
 	/*virtual*/ void ExecuteInformation() throw(...);
@@ -101,13 +213,27 @@ protected:
 	//processes data
 	virtual void ExecuteData() throw(...);
 
-	//processes the currently loaded block of data
-	//creating its bricked version
-	virtual void ConstructBricks() throw(...);
+	//processes the block of data in the slot, brick lines nFromBrickLine to
+	//nToBrickLine - 1 only, creating its bricked version
+	//NB: called from worker threads
+	virtual void ConstructBricks(BBF_PLANE_SLOT& slot, 
+		int nFromBrickLine, int nToBrickLine) throw(...);
+
+	//constructs bricks for brick lines nFromBrickLine to nToBrickLine - 1 of the slot,
+	//computing average values for every brick and determining which bricks are uniform
+	//NB: called from worker threads, different ranges may be processed concurrently
+	virtual void ProcessBricks(BBF_PLANE_SLOT& slot, 
+		int nFromBrickLine, int nToBrickLine) throw(...);
+
+	//compresses non-uniform bricks of brick lines nFromBrickLine to nToBrickLine - 1
+	//of the slot, called by ProcessBricks for version 3 only
+	//NB: called from worker threads, different ranges may be processed concurrently
+	virtual void PackBricks(BBF_PLANE_SLOT& slot, 
+		int nFromBrickLine, int nToBrickLine) throw(...);
 
-	//Process the currently loaded bricks, computing average values
-	//for every brick and determining which bricks are uniform
-	virtual void ProcessBricks(int nCurBrickPlane) throw(...);
+	//writes non-uniform bricks of the processed slot and updates the index table
+	//NB: called from the writer thread in the order of brick planes
+	virtual void StoreBricks(BBF_PLANE_SLOT& slot) throw(...);
 
   /** Process the grid coordinates for rectilinear grid
   If the input data is regular, this method does nothing */
@@ -121,11 +247,12 @@ protected:
 	//the computed values are stored as the lowest resolution snapshot
 	//and uniform bricks are also denoted during the process
 	template< typename T_VAL, typename T_SUM >
-		void CreateBricksLowResolution(int nCurBrickPlane);
+		void CreateBricksLowResolution(BBF_PLANE_SLOT& slot, 
+		int nFromBrickLine, int nToBrickLine);
 
 	//updates brick map, i.e., data stucture storing the information which bricks are uniform
 	//NB: nPrevSkipped member has a temporary value 
-	void CreateBricksIndexTable(int nCurBrickPlane);
+	void CreateBricksIndexTable(int nCurBrickPlane, const bool* pBricksValidity);
 };
 
 #endif //__mafBrickedFileWriter__
\ No newline at end of file
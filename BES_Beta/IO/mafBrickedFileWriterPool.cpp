@@ -0,0 +1,313 @@
+/**=======================================================================
+
+File:    	 mafBrickedFileWriterPool.cpp
+Language:  C++
+Date:      $Date$
+Version:   $Revision: 1.1.2.1 $
+
+Copyright (c) 2008
+University of Bedfordshire
+=========================================================================
+Pool of threads shared by one or more mafBrickedFileWriter instances
+=========================================================================*/
+
+#include "mafDefines.h"
+//----------------------------------------------------------------------------
+// NOTE: Every CPP file in the MAF must include "mafDefines.h" as first.
+// This force to include Window,wxWidgets and VTK exactly in this order.
+// Failing in doing this will result in a run-time error saying:
+// "Failure#0: The value of ESP was not properly saved across a function call"
+//----------------------------------------------------------------------------
+
+#include "mafBrickedFileWriterPool.h"
+#include "mafBrickedFileWriter.h"
+#include "mafMemDbg.h"
+
+mafBrickedFileWriterPool::mafBrickedFileWriterPool()
+{
+  m_Writer = NULL;
+  m_Condition = new wxCondition(m_Mutex);
+  m_Abort = false;
+}
+
+mafBrickedFileWriterPool::~mafBrickedFileWriterPool()
+{
+  Stop();
+  delete m_Condition;
+}
+
+//returns the recommended number of worker threads for this machine
+/*static*/ int mafBrickedFileWriterPool::GetDefaultNumberOfThreads()
+{
+  //one CPU is left for the thread reading the source and the writer thread
+  int nCPUs = wxThread::GetCPUCount();
+  return (nCPUs > 2) ? nCPUs - 1 : 1;
+}
+
+//starts nThreads worker threads and the writer thread
+void mafBrickedFileWriterPool::Start(int nThreads)
+{
+  Stop();   //terminate previous threads
+
+  m_Abort = false;
+  m_Error.clear();
+
+  for (int i = 0; i < nThreads; i++)
+  {
+    mafBrickedFileWriterPoolThread* pThread = new mafBrickedFileWriterPoolThread(this, false);
+    if (pThread->Create() != wxTHREAD_NO_ERROR || pThread->Run() != wxTHREAD_NO_ERROR)
+    {
+      delete pThread;   //not able to create more threads, continue with what we have
+      break;
+    }
+
+    m_Workers.push_back(pThread);
+  }
+
+  if (m_Workers.empty())
+    return;   //synchronous mode
+
+  m_Writer = new mafBrickedFileWriterPoolThread(this, true);
+  if (m_Writer->Create() != wxTHREAD_NO_ERROR || m_Writer->Run() != wxTHREAD_NO_ERROR)
+  {
+    //without the writer thread, we must fall back to synchronous mode
+    delete m_Writer;
+    m_Writer = NULL;
+
+    Stop();
+  }
+}
+
+//terminates all threads, pending tasks are discarded
+void mafBrickedFileWriterPool::Stop()
+{
+  {
+    wxMutexLocker lock(m_Mutex);
+    m_Abort = true;
+    m_Condition->Broadcast();
+  }
+
+  for (int i = 0; i < (int)m_Workers.size(); i++)
+  {
+    m_Workers[i]->Wait();
+    delete m_Workers[i];
+  }
+
+  m_Workers.clear();
+
+  if (m_Writer != NULL)
+  {
+    m_Writer->Wait();
+    delete m_Writer;
+    m_Writer = NULL;
+  }
+
+  m_Tasks.clear();
+  m_Processed.clear();
+}
+
+//waits until some plane slot of the writer is free and returns its index
+int mafBrickedFileWriterPool::AcquireSlot(mafBrickedFileWriter* pWriter) throw(...)
+{
+  wxMutexLocker lock(m_Mutex);
+
+  std::vector< mafBrickedFileWriter::BBF_PLANE_SLOT >& slots = pWriter->m_PlaneSlots;
+  while (true)
+  {
+    if (!m_Error.empty())
+      throw std::ios::failure(m_Error.c_str());
+
+    for (int i = 0; i < (int)slots.size(); i++)
+    {
+      if (slots[i].nState == mafBrickedFileWriter::BBF_SLOT_FREE)
+      {
+        slots[i].nState = mafBrickedFileWriter::BBF_SLOT_FILLING;
+        return i;
+      }
+    }
+
+    if (m_Writer == NULL) //synchronous mode, slots are freed in SubmitSlot
+      throw std::logic_error(_("No free plane buffer available."));
+
+    m_Condition->Wait();
+  }
+}
+
+//passes the filled plane slot of the writer for processing
+void mafBrickedFileWriterPool::SubmitSlot(mafBrickedFileWriter* pWriter, int nSlot) throw(...)
+{
+  mafBrickedFileWriter::BBF_PLANE_SLOT& slot = pWriter->m_PlaneSlots[nSlot];
+  int nBrickLines = pWriter->m_NBricksDim[1];
+
+  if (m_Writer == NULL)
+  {
+    //synchronous mode, planes come in the order of their indices
+    pWriter->ProcessBricks(slot, 0, nBrickLines);
+    pWriter->StoreBricks(slot);
+
+    slot.nState = mafBrickedFileWriter::BBF_SLOT_FREE;
+    pWriter->m_NextPlaneToStore++;
+    return;
+  }
+
+  //split the plane into ranges of brick lines, one task per worker at most
+  int nTasks = (int)m_Workers.size();
+  if (nTasks > nBrickLines)
+    nTasks = nBrickLines;
+
+  wxMutexLocker lock(m_Mutex);
+  if (!m_Error.empty())
+    throw std::ios::failure(m_Error.c_str());
+
+  slot.nState = mafBrickedFileWriter::BBF_SLOT_QUEUED;
+  slot.nPendingTasks = nTasks;
+
+  BBF_WRITER_TASK task;
+  task.pWriter = pWriter;
+  task.nSlot = nSlot;
+  for (int i = 0; i < nTasks; i++)
+  {
+    task.nFromBrickLine = i*nBrickLines / nTasks;
+    task.nToBrickLine = (i + 1)*nBrickLines / nTasks;
+    m_Tasks.push_back(task);
+  }
+
+  m_Condition->Broadcast();
+}
+
+//waits until all submitted planes of the writer are stored
+void mafBrickedFileWriterPool::Flush(mafBrickedFileWriter* pWriter) throw(...)
+{
+  if (m_Writer == NULL)
+    return; //synchronous mode, everything is already stored
+
+  wxMutexLocker lock(m_Mutex);
+
+  std::vector< mafBrickedFileWriter::BBF_PLANE_SLOT >& slots = pWriter->m_PlaneSlots;
+  while (m_Error.empty())
+  {
+    bool bPending = false;
+    for (int i = 0; i < (int)slots.size(); i++)
+    {
+      if (slots[i].nState != mafBrickedFileWriter::BBF_SLOT_FREE) {
+        bPending = true; break;
+      }
+    }
+
+    if (!bPending)
+      return;
+
+    m_Condition->Wait();
+  }
+
+  throw std::ios::failure(m_Error.c_str());
+}
+
+//executed by worker threads
+void mafBrickedFileWriterPool::ExecuteWorker()
+{
+  while (true)
+  {
+    BBF_WRITER_TASK task;
+    {
+      wxMutexLocker lock(m_Mutex);
+      while (!m_Abort && m_Tasks.empty()) {
+        m_Condition->Wait();
+      }
+
+      if (m_Abort)
+        break;
+
+      task = m_Tasks.front();
+      m_Tasks.pop_front();
+    }
+
+    //brick lines of the task are exclusively ours
+    mafBrickedFileWriter::BBF_PLANE_SLOT& slot = task.pWriter->m_PlaneSlots[task.nSlot];
+    try
+    {
+      task.pWriter->ProcessBricks(slot, task.nFromBrickLine, task.nToBrickLine);
+    }
+    catch (std::exception& e)
+    {
+      wxMutexLocker lock(m_Mutex);
+      SetError(e.what());
+      continue;   //the slot is never processed, the owner gets the error
+    }
+
+    wxMutexLocker lock(m_Mutex);
+    if (--slot.nPendingTasks == 0)
+    {
+      slot.nState = mafBrickedFileWriter::BBF_SLOT_PROCESSED;
+
+      BBF_WRITER_PLANE plane;
+      plane.pWriter = task.pWriter;
+      plane.nSlot = task.nSlot;
+      m_Processed.push_back(plane);
+
+      m_Condition->Broadcast();
+    }
+  }
+}
+
+//executed by the writer thread
+void mafBrickedFileWriterPool::ExecuteWriter()
+{
+  while (true)
+  {
+    BBF_WRITER_PLANE plane;
+    {
+      wxMutexLocker lock(m_Mutex);
+
+      //find the plane that is next in the order of its writer
+      int nFound = -1;
+      while (!m_Abort)
+      {
+        for (int i = 0; i < (int)m_Processed.size(); i++)
+        {
+          mafBrickedFileWriter* pWriter = m_Processed[i].pWriter;
+          if (pWriter->m_PlaneSlots[m_Processed[i].nSlot].nBrickPlane == pWriter->m_NextPlaneToStore) {
+            nFound = i; break;
+          }
+        }
+
+        if (nFound >= 0)
+          break;
+
+        m_Condition->Wait();
+      }
+
+      if (m_Abort)
+        break;
+
+      plane = m_Processed[nFound];
+      m_Processed.erase(m_Processed.begin() + nFound);
+    }
+
+    mafBrickedFileWriter::BBF_PLANE_SLOT& slot = plane.pWriter->m_PlaneSlots[plane.nSlot];
+    try
+    {
+      plane.pWriter->StoreBricks(slot);
+    }
+    catch (std::exception& e)
+    {
+      wxMutexLocker lock(m_Mutex);
+      SetError(e.what());
+      continue;
+    }
+
+    wxMutexLocker lock(m_Mutex);
+    slot.nState = mafBrickedFileWriter::BBF_SLOT_FREE;
+    plane.pWriter->m_NextPlaneToStore++;
+    m_Condition->Broadcast();
+  }
+}
+
+//stores the message of the first error and wakes up all waiting threads
+void mafBrickedFileWriterPool::SetError(const char* szMsg)
+{
+  if (m_Error.empty())
+    m_Error = szMsg;
+
+  m_Condition->Broadcast();
+}
@@ -0,0 +1,131 @@
+/**=======================================================================
+
+  File:    	 mafBrickedFileWriterPool.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision: 1.1.2.1 $
+
+  Copyright (c) 2008
+  University of Bedfordshire
+=========================================================================
+Pool of threads shared by one or more mafBrickedFileWriter instances.
+Worker threads construct bricks of complete brick planes and compute
+their low resolution values (every plane is split into ranges of brick
+lines), while one dedicated writer thread stores processed planes of
+every writer in the order of their indices, so that the output file
+is exactly the same as if it was produced sequentially.
+=========================================================================*/
+
+#ifndef __mafBrickedFileWriterPool__
+#define __mafBrickedFileWriterPool__
+
+#include <wx/thread.h>
+#include <vector>
+#include <deque>
+#include <string>
+
+class mafBrickedFileWriter;
+
+class mafBrickedFileWriterPool
+{
+protected:
+  //thread that executes either ExecuteWorker or ExecuteWriter of the pool
+  class mafBrickedFileWriterPoolThread : public wxThread
+  {
+  protected:
+    mafBrickedFileWriterPool* m_Owner;
+    bool m_BWriter;
+
+  public:
+    mafBrickedFileWriterPoolThread(mafBrickedFileWriterPool* owner, bool bWriter)
+      : wxThread(wxTHREAD_JOINABLE), m_Owner(owner), m_BWriter(bWriter) {
+    }
+
+  protected:
+    /*virtual*/ ExitCode Entry()
+    {
+      if (m_BWriter)
+        m_Owner->ExecuteWriter();
+      else
+        m_Owner->ExecuteWorker();
+      return 0;
+    }
+  };
+
+  //one job for worker threads: range of brick lines of the plane in the slot
+  typedef struct BBF_WRITER_TASK
+  {
+    mafBrickedFileWriter* pWriter;
+    int nSlot;                //index of plane slot of pWriter
+    int nFromBrickLine;       //first brick line to be processed
+    int nToBrickLine;         //brick line after the last one to be processed
+  } BBF_WRITER_TASK;
+
+  //processed plane waiting to be stored
+  typedef struct BBF_WRITER_PLANE
+  {
+    mafBrickedFileWriter* pWriter;
+    int nSlot;
+  } BBF_WRITER_PLANE;
+
+protected:
+  std::vector< mafBrickedFileWriterPoolThread* > m_Workers;
+  mafBrickedFileWriterPoolThread* m_Writer;   //NULL, if planes are processed synchronously
+
+  std::deque< BBF_WRITER_TASK > m_Tasks;        //tasks waiting for some worker
+  std::vector< BBF_WRITER_PLANE > m_Processed;  //planes waiting for the writer thread
+
+  //synchronization
+  wxMutex m_Mutex;
+  wxCondition* m_Condition;
+
+  bool m_Abort;           //true, if threads should terminate as soon as possible
+  std::string m_Error;    //error message of the first failed operation (if any)
+
+public:
+  mafBrickedFileWriterPool();
+  ~mafBrickedFileWriterPool();
+
+public:
+  //returns the recommended number of worker threads for this machine
+  static int GetDefaultNumberOfThreads();
+
+  //starts nThreads worker threads and the writer thread,
+  //if nThreads is 0, planes are processed synchronously in SubmitSlot
+  void Start(int nThreads);
+
+  //terminates all threads, pending tasks are discarded
+  //NB: writers using the pool must be flushed in prior to this call, otherwise
+  //their output is incomplete and must be aborted
+  void Stop();
+
+  //returns the number of running worker threads (0 = synchronous mode)
+  inline int GetNumberOfThreads() {
+    return (int)m_Workers.size();
+  }
+
+  //waits until some plane slot of the writer is free, marks it as being filled and
+  //returns its index; throws std::exception if the processing of some plane failed
+  int AcquireSlot(mafBrickedFileWriter* pWriter) throw(...);
+
+  //passes the filled plane slot of the writer for processing
+  //throws std::exception if the processing of some plane failed
+  void SubmitSlot(mafBrickedFileWriter* pWriter, int nSlot) throw(...);
+
+  //waits until all submitted planes of the writer are stored
+  //throws std::exception if the processing of some plane failed
+  void Flush(mafBrickedFileWriter* pWriter) throw(...);
+
+protected:
+  //executed by worker threads
+  void ExecuteWorker();
+
+  //executed by the writer thread
+  void ExecuteWriter();
+
+  //stores the message of the first error and wakes up all waiting threads
+  //NB: m_Mutex must be locked by the caller
+  void SetError(const char* szMsg);
+};
+
+#endif //__mafBrickedFileWriterPool__
@@ -22,6 +22,7 @@
 
 #include "mafVolumeLargeWriter.h"
 #include "mafBrickedFileWriter.h"
+#include "mafBrickedFileWriterPool.h"
 #include "../vtkMAF/vtkMAFFileDataProvider.h"
 #include <wx/busyinfo.h>
 
@@ -39,6 +40,8 @@ mafVolumeLargeWriter::mafVolumeLargeWriter()
 	m_DblLimitCoef = 1.35;	//NB. upper bound is lest than 2, 
 							            //even 30 levels has 1.2+
 	m_Listener = NULL;
+	m_NumberOfThreads = -1;	//auto
+	m_Compression = false;
 }
 
 mafVolumeLargeWriter::~mafVolumeLargeWriter()
@@ -249,68 +252,161 @@ int mafVolumeLargeWriter::CreateLODs(int nMaxSampleRate, vtkIdType64& nTotalMaxS
 	szFNamePref += szFile;
 
 
-	//process every LOD
-	mafBrickedFileWriter bf;
-	bf.SetListener(m_Listener);	
-	bf.SetInputDataSet(m_InputDataSet);
-  bf.SetInputXCoordinates(m_PInputXYZCoords[0]);
-  bf.SetInputYCoordinates(m_PInputXYZCoords[1]);
-  bf.SetInputZCoordinates(m_PInputXYZCoords[2]);
+	//all LODs are constructed in one pass over the input data set,
+	//every level has its own writer but they share one pool of threads
+	mafBrickedFileWriterPool pool;
+	pool.Start(m_NumberOfThreads >= 0 ? m_NumberOfThreads : 
+		mafBrickedFileWriterPool::GetDefaultNumberOfThreads());
+
+	std::vector< mafBrickedFileWriter* > writers;
+	for (int i = 1; i <= nMaxSampleRate; i++)
+	{
+		mafBrickedFileWriter* bf = new mafBrickedFileWriter();
+		bf->SetInputDataSet(m_InputDataSet);
+		bf->SetInputXCoordinates(m_PInputXYZCoords[0]);
+		bf->SetInputYCoordinates(m_PInputXYZCoords[1]);
+		bf->SetInputZCoordinates(m_PInputXYZCoords[2]);
+		bf->SetSampleRate(i);
+		bf->SetBrickSize(ComputeBrickSize(i, nMaxSampleRate));
+		bf->SetCompression(m_Compression);
+		bf->SetFileName(wxString::Format("%s_%02d.bbf", szFNamePref, i));
+		bf->SetPool(&pool);
+		writers.push_back(bf);
+	}
+
+#ifdef _PROFILE_LARGEDATA_
+  LARGE_INTEGER liBegin;
+  ::QueryPerformanceCounter(&liBegin);
+#endif //_PROFILE_LARGEDATA_
+
+	try
+	{
+		for (int i = 0; i < (int)writers.size(); i++) {
+			writers[i]->BeginWrite();
+		}
+
+		ExecuteData(writers);
+
+		for (int i = 0; i < (int)writers.size(); i++) {
+			writers[i]->EndWrite();
+		}
+	}
+	catch (std::exception&)
+	{
+		//threads must be stopped before writers release their buffers
+		pool.Stop();
+
+		for (int i = 0; i < (int)writers.size(); i++) {
+			writers[i]->AbortWrite();
+			delete writers[i];
+		}
+
+		throw;
+	}
+
+	pool.Stop();
 
 #ifdef _PROFILE_LARGEDATA_
+  LARGE_INTEGER liEnd, liFreq;
+  ::QueryPerformanceCounter(&liEnd);
+  ::QueryPerformanceFrequency(&liFreq);
+
   int VOI[6];
   m_InputDataSet->GetVOI(VOI);
   double dblVOISizeInMB = GetVOISizeInBytes() / (1024*1024.0);
-  
-  LARGE_INTEGER liFreq;
-  ::QueryPerformanceFrequency(&liFreq);
-#endif
 
+  FILE* fLog = fopen("mafVolumeLargeWriter2.log", "at");
+  fprintf(fLog, "%dx%dx%d (%.2f MB; %d levels, %d threads) in %.2f s.\n", 
+    VOI[1] + 1, VOI[3] + 1, VOI[5] + 1, dblVOISizeInMB, nMaxSampleRate, 
+    pool.GetNumberOfThreads(), ((double)(liEnd.QuadPart - liBegin.QuadPart)) / liFreq.QuadPart);
+  fclose(fLog);          
+#endif //_PROFILE_LARGEDATA_
+
+	//keep levels until we are out of space, levels with higher
+	//sample rates were constructed in vain, so delete them
   int nRetLevels = 0;
 	vtkIdType64 nTotalSize = 0;
-	for (int i = 1; i <= nMaxSampleRate/*nCount*/; i++)
+	for (int i = 0; i < (int)writers.size(); i++)
 	{
-//		if (pOrder[i] <= nMaxSampleRate)
+		mafString szFName = writers[i]->GetFileName();
+		if (nTotalSize < nTotalMaxSize)
 		{
-#ifdef _PROFILE_LARGEDATA_
-      LARGE_INTEGER liBegin;
-      ::QueryPerformanceCounter(&liBegin);
-#endif //_PROFILE_LARGEDATA_
+			nRetLevels++;
+			nTotalSize += vtkMAFFile2::GetFileSize(szFName);
+		}
+		else
+		{
+#pragma warning(suppress: 6031) // warning C6031: Return value ignored: '_unlink'
+			_unlink(szFName);
+		}
 
-			wxString szFName = wxString::Format("%s_%02d.bbf", szFNamePref, /*pOrder[i]*/i);
+		delete writers[i];
+	}
 
-			bf.SetSampleRate(i/*pOrder[i]*/);
-			bf.SetBrickSize(ComputeBrickSize(i/*pOrder[i]*/, nMaxSampleRate));
-			bf.SetFileName(szFName);
-			if (!bf.Update()) 
-			{
-				wxString szMsg = wxString::Format(_("Unable to create level %d"), i);
-				throw std::ios::failure(szMsg.c_str());
-			}
+  nTotalMaxSize = nTotalSize;
+  return nRetLevels;
+}
 
-      vtkIdType64 nFileSize = vtkMAFFile2::GetFileSize(szFName);
+//samples the input data set in one pass and feeds every line into all writers
+void mafVolumeLargeWriter::ExecuteData(std::vector< mafBrickedFileWriter* >& writers) throw(...)
+{
+	mafString szMsg = wxString::Format(_("Sampling and bricking data (%d levels) ..."),
+		(int)writers.size());
 
-#ifdef _PROFILE_LARGEDATA_
-      LARGE_INTEGER liEnd;
-      ::QueryPerformanceCounter(&liEnd);      
-
-      FILE* fLog = fopen("mafVolumeLargeWriter2.log", "at");
-      fprintf(fLog, "%dx%dx%d (%.2f MB -> %.2f MB; SR = %d, BS = %d) in %.2f s.\n", 
-        VOI[1] + 1, VOI[3] + 1, VOI[5] + 1, dblVOISizeInMB,
-        (double)(nFileSize / (1024*1024.0)), bf.GetSampleRate(), 
-        bf.GetBrickSize(), ((double)(liEnd.QuadPart - liBegin.QuadPart)) / liFreq.QuadPart);
-      fclose(fLog);          
-#endif //_PROFILE_LARGEDATA_
+	mafEventMacro(mafEvent(this, PROGRESSBAR_SHOW, this));
+	mafEventMacro(mafEvent(this, PROGRESSBAR_SET_TEXT, &szMsg));
+	mafEventMacro(mafEvent(this, PROGRESSBAR_SET_VALUE, (long)0));
+
+	vtkMAFLargeDataProvider* dp = m_InputDataSet->GetPointDataProvider();	
+	int nScalarsDscIndex = dp->GetIndexOfScalarsDescriptor();
+	vtkMAFDataArrayDescriptor* dsc = dp->GetDescriptor(nScalarsDscIndex);
+
+	//get VOI
+	int VOI[6];
+	m_InputDataSet->GetVOI(VOI);
+
+	//compute how many elements will be read in one step
+	int nElemsPerLine = (VOI[1] - VOI[0] + 1) * dsc->GetNumberOfComponents();
+	int nBytesPerLine = nElemsPerLine * dsc->GetDataTypeSize();
+	char* pLineBuffer = new char[nBytesPerLine];
 
-      nRetLevels++;
-			nTotalSize += nFileSize;
-			if (nTotalSize >= nTotalMaxSize)
-				break;	//out of space
+	//get increments
+	vtkIdType64 dataIncr[3];
+	m_InputDataSet->GetIncrements(dataIncr);	//get increments (in elements)	
+
+	int nDimY = VOI[3] - VOI[2] + 1;
+	int nDimZ = VOI[5] - VOI[4] + 1;
+
+	try
+	{
+		//index to the first element	
+		vtkIdType64 nStartIndex = VOI[0]*dataIncr[0] + VOI[2]*dataIncr[1] + VOI[4]*dataIncr[2];		
+		for (int z = 0; z < nDimZ; z++, nStartIndex += dataIncr[2])
+		{
+			mafEventMacro(mafEvent(this, PROGRESSBAR_SET_VALUE, (long)(100*z / nDimZ)));
+
+			//the level with sample rate 1 needs every line, so read all of them
+			vtkIdType64 nLineIndex = nStartIndex;				
+			for (int y = 0; y < nDimY; y++, nLineIndex += dataIncr[1])
+			{
+				dp->GetDataArray(nScalarsDscIndex, (void*)pLineBuffer, 
+					(vtkIdType64)nElemsPerLine, nLineIndex);
+
+				for (int i = 0; i < (int)writers.size(); i++) {
+					writers[i]->ProcessSourceLine(y, z, pLineBuffer);
+				}
+			}
 		}
-	}	
+	}
+	catch (...)
+	{
+		delete[] pLineBuffer;
+		mafEventMacro(mafEvent(this, PROGRESSBAR_HIDE, this));
+		throw;
+	}
 
-  nTotalMaxSize = nTotalSize;
-  return nRetLevels;
+	delete[] pLineBuffer;
+	mafEventMacro(mafEvent(this, PROGRESSBAR_HIDE, this));
 }
 
 //returns estimated total size for the given VOI and number of levels
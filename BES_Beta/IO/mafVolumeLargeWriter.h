@@ -20,6 +20,9 @@
 #include "mafObserver.h"
 #include "../vtkMAF/vtkMAFLargeImageData.h"
 #include "vtkDoubleArray.h"
+#include <vector>
+
+class mafBrickedFileWriter;
 
 class MED_VME_EXPORT mafVolumeLargeWriter : public mafObject
 {
@@ -40,6 +43,12 @@ protected:
 	//the maximal allowed ratio of the output and input data
 	double m_DblLimitCoef;
 
+	//number of threads processing brick planes, -1 = auto
+	int m_NumberOfThreads;
+
+	//true, if non-uniform bricks are to be compressed (BBF version 3)
+	bool m_Compression;
+
 public:
 	mafVolumeLargeWriter();
 	virtual ~mafVolumeLargeWriter();
@@ -92,6 +101,29 @@ public:
 		m_DblLimitCoef = dblLimitCoef;
 	}
 
+	//Gets the number of worker threads used to construct bricks
+	inline int GetNumberOfThreads() {
+		return m_NumberOfThreads;
+	}
+
+	//Sets the number of worker threads used to construct bricks of all levels
+	//-1 denotes the number suitable for this machine, 0 no threads
+	//NB: the output is the same for any number of threads
+	inline void SetNumberOfThreads(int nThreads) {
+		m_NumberOfThreads = nThreads;
+	}
+
+	//Returns true, if non-uniform bricks of all levels are compressed
+	inline bool GetCompression() {
+		return m_Compression;
+	}
+
+	//Sets whether non-uniform bricks of all levels are compressed (BBF version 3)
+	//default is false, i.e., levels are stored as BBF version 2
+	inline void SetCompression(bool bCompress) {
+		m_Compression = bCompress;
+	}
+
 	//returns estimated total size for the current VOI and number of levels
 	//or all levels, if nLevels == 0
 	vtkIdType64 GetEstimatedTotalSize(int nLevels = 0);
@@ -114,7 +146,11 @@ protected:
 	//creates BBF files with LOD with sample rate ranges from 1 to nMaxSampleRate
 	//skipping less important levels in order to fit into nTotalMaxSize Bytes
   //returns number of constructed levels and in nTotalMaxSize their size in bytes
+	//NB: all levels are constructed in one pass over the input data set
 	int CreateLODs(int nMaxSampleRate, vtkIdType64& nTotalMaxSize) throw(...);
+
+	//samples the input data set in one pass and feeds every line into all writers
+	void ExecuteData(std::vector< mafBrickedFileWriter* >& writers) throw(...);
 };
 
 #endif //__mafBrickingProcessObject__
\ No newline at end of file
@@ -25,6 +25,10 @@
   #include <share.h>
 #endif
 
+#ifndef _WIN32
+  #include <sys/mman.h>
+#endif
+
 vtkCxxRevisionMacro(vtkMAFFile, "$Revision: 1.1.2.3 $");
 vtkStandardNewMacro(vtkMAFFile);
 
@@ -101,6 +105,66 @@ long long vtkMAFFile::GetFileSize()
   return f.GetFileSize(); //dtor will close it
 }
 
+//maps the whole opened file into the address space (read-only) 
+//returns false if an error occurs
+bool vtkMAFFile::MapFile()
+{
+  UnmapFile();  //release the previous view
+
+  long long size = GetFileSize();
+  if (size <= 0 || (unsigned long long)size > (unsigned long long)((size_t)-1) / 2)
+    return false; //empty file or too large for the address space
+
+#ifdef _WIN32
+  m_HMapping = CreateFileMappingA(m_HFile, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (m_HMapping == NULL)
+    return false;
+
+  m_PMappedView = (const char*)MapViewOfFile(m_HMapping, FILE_MAP_READ, 0, 0, 0);
+  if (m_PMappedView == NULL)
+  {
+    CloseHandle(m_HMapping);
+    m_HMapping = NULL;
+    return false;
+  }
+#else
+  if (PFile == NULL)
+    return false;
+
+  void* pView = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, fileno(PFile), 0);
+  if (pView == MAP_FAILED)
+    return false;
+
+  m_PMappedView = (const char*)pView;
+#endif
+
+  m_MappedSize = size;
+  return true;
+}
+
+//releases the view created by MapFile (with no exception!)
+void vtkMAFFile::UnmapFile()
+{
+  if (m_PMappedView != NULL)
+  {
+#ifdef _WIN32
+    UnmapViewOfFile(m_PMappedView);
+#else
+    munmap((void*)m_PMappedView, (size_t)m_MappedSize);
+#endif
+    m_PMappedView = NULL;
+    m_MappedSize = 0;
+  }
+
+#ifdef _WIN32
+  if (m_HMapping != NULL)
+  {
+    CloseHandle(m_HMapping);
+    m_HMapping = NULL;
+  }
+#endif
+}
+
 //creates a new file
 //throws std::exceptions if an error occurs
 void vtkMAFFile2::Create(const char* fname) throw(...)
@@ -39,6 +39,12 @@ protected:
   FILE* PFile;    //associated FILE
 #endif // _WIN32
 
+#ifdef _WIN32
+  HANDLE m_HMapping;      //file mapping object (valid only if mapped)
+#endif // _WIN32
+  const char* m_PMappedView;  //read-only view of the whole file, NULL if not mapped
+  long long m_MappedSize;     //number of bytes accessible through m_PMappedView
+
 public:
   vtkTypeRevisionMacro(vtkMAFFile, vtkObject);
   static vtkMAFFile* New();
@@ -47,9 +53,12 @@ protected:
   vtkMAFFile() {
 #ifdef _WIN32
     m_HFile = INVALID_HANDLE_VALUE;
+    m_HMapping = NULL;
 #else
     PFile = NULL;
 #endif // _WIN32
+    m_PMappedView = NULL;
+    m_MappedSize = 0;
   }
 
   ~vtkMAFFile() {
@@ -98,12 +107,37 @@ public:
 
   //returns file size or -1, if an error occurs (e.g., because file not found)
   static long long GetFileSize(const char* fname);
+
+  //maps the whole opened file into the address space (read-only) so that
+  //its content can be accessed by GetView without Seek/Read calls and
+  //without copying data into an intermediate buffer. The mapping uses
+  //64-bit offsets but it fails on 32-bit platforms for files that do not
+  //fit into the address space; the caller is then expected to use Read.
+  //NB: the view is not updated, if the file is written after mapping
+  //returns false if an error occurs
+  bool MapFile();
+
+  //releases the view created by MapFile (with no exception!)
+  void UnmapFile();
+
+  //returns true, if the file is currently mapped into the memory
+  inline bool IsMapped() {
+    return m_PMappedView != NULL;
+  }
+
+  //returns the pointer to count bytes of the file starting at pos,
+  //the file must be mapped by MapFile. The returned pointer is valid
+  //until UnmapFile or Close is called.
+  //returns NULL, if the file is not mapped or the range is out of file
+  inline const char* GetView(long long pos, int count);
 };
 
 
 //closes the file (with no exception!) and invalidates it
 inline void vtkMAFFile::Close()
 {
+  UnmapFile();
+
 #ifdef _WIN32
   if (m_HFile != INVALID_HANDLE_VALUE)
   {
@@ -158,6 +192,16 @@ inline bool vtkMAFFile::Seek(long long pos, int origin)
 #endif  
 }
 
+//returns the pointer to count bytes of the file starting at pos,
+//returns NULL, if the file is not mapped or the range is out of file
+inline const char* vtkMAFFile::GetView(long long pos, int count)
+{
+  if (m_PMappedView == NULL || pos < 0 || count < 0 || pos + count > m_MappedSize)
+    return NULL;
+
+  return m_PMappedView + pos;
+}
+
 //returns the current position in file, throws an exception if an error occurs
 inline long long vtkMAFFile::GetCurrentPos() throw(...)
 {
@@ -191,9 +235,12 @@ protected:
   vtkMAFFile2() {
 #ifdef _WIN32
     m_HFile = INVALID_HANDLE_VALUE;
+    m_HMapping = NULL;
 #else
     PFile = NULL;
 #endif // _WIN32
+    m_PMappedView = NULL;
+    m_MappedSize = 0;
   }
 
   ~vtkMAFFile2() {
@@ -236,6 +283,10 @@ public:
 
 	//returns file size, throwing exception if an error occurs (e.g., file not found)
 	static long long GetFileSize(const char* fname) throw(...);
+
+  //returns the pointer to count bytes of the mapped file starting at pos
+  //throws std::exceptions if the file is not mapped or the range is out of file
+  inline const char* GetView(long long pos, int count) throw(...);
 };
 
 //writes count bytes from the buffer into the file
@@ -292,6 +343,22 @@ inline void vtkMAFFile2::Seek(long long pos, int origin) throw(...)
     throw std::ios::failure(("Unable to seek in the specified file."));
 }
 
+//returns the pointer to count bytes of the mapped file starting at pos
+//throws std::exceptions if the file is not mapped or the range is out of file
+inline const char* vtkMAFFile2::GetView(long long pos, int count) throw(...)
+{
+  const char* ret = vtkMAFFile::GetView(pos, count);
+  if (ret == NULL)
+  {
+    throw std::ios::failure((IsMapped() ?
+      ("Reached the end of the file (EOF). The file is corrupted and unreadable.") :
+      ("The file is not mapped into the memory."))
+      );
+  }
+
+  return ret;
+}
+
 //returns the current position in file, throws an exception if an error occurs
 inline long long vtkMAFFile2::GetCurrentPos() throw(...)
 {
@@ -32,6 +32,7 @@
 #include "medWizardManager.h"
 #include "mafGUIApplicationSettings.h"
 #include "mafView.h"
+#include "vtkMEDDistanceFieldFilter.h"
 
 #ifdef MAF_USE_VTK
   #include "mafInteractionManager.h"
@@ -279,6 +280,9 @@ void medLogicWithManagers::OnQuit()
     return;
 
   mafLogicWithManagers::OnQuit();
+
+  // the cached distance fields keep a reference to their volumes
+  vtkMEDDistanceFieldFilter::ReleaseDistanceFields();
 }
 
 
@@ -104,9 +104,18 @@ int mafOpImporterBBF::ImportBBF()
   wxString nFileName = m_File.Mid(0,idx1)+m_File.Mid(idx2);
   size_t idx4 = nFileName.find_last_of(".");
   wxString showName = m_File.Mid(idx3+1,idx4-idx3-1);
+
+  //BBF version 2 (raw bricks) and 3 (compressed bricks) are supported
+  if (!mafBrickedFileReader::IsFileSupported(m_File))
+    return MAF_ERROR;
+
   mafVolumeLargeReader *reader = mafVolumeLargeReader::New();
   reader->SetFileName(nFileName);
-  reader->Update();
+  if (!reader->Update())
+  {
+    cppDEL(reader);
+    return MAF_ERROR;
+  }
 	
 	mafNEW(m_VmeLarge); 
   m_VmeLarge->SetFileName("");
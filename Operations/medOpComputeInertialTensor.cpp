@@ -43,6 +43,8 @@ using namespace std;
 #include "vtkMassProperties.h"
 #include "vtkGeometryFilter.h"
 #include "vtkMAFCellLocator.h"
+#include "vtkMEDMassProperties.h"
+#include "vtkMultiThreader.h"
 
 #include "mafDecl.h"
 #include "mafEvent.h"
@@ -97,6 +99,7 @@ mafOp(label)
   m_Principal_I3 = 0.0;
   m_Accuracy = 1000;
   m_Vtkcomp = 1;
+  m_NumberOfThreads = 0;
 
   m_InertialTensor[0] = 0;
   m_InertialTensor[1] = 0;
@@ -220,7 +223,7 @@ void medOpComputeInertialTensor::OnEvent(mafEventBase *maf_event)
 			break;
     case ID_COMBO:
       {
-        if (m_MethodToUse==1) 
+        if (m_MethodToUse!=MONTE_CARLO) 
         {
           m_Gui->Enable(ID_ACCURACY,false);
           m_Gui->Enable(ID_VTKCOMP,false);
@@ -314,14 +317,14 @@ void medOpComputeInertialTensor::CreateGui()
   m_Gui->Integer(ID_ACCURACY,_("Accuracy"),&m_Accuracy,0,100000);
   m_Gui->Divider(0);
 
-  wxString choices[2]={_("Monte Carlo"),_("Geometry")};
-  m_Gui->Combo(ID_COMBO,_("Method:"),&m_MethodToUse,2,choices,"Select method");
+  wxString choices[3]={_("Monte Carlo"),_("Geometry"),_("Exact")};
+  m_Gui->Combo(ID_COMBO,_("Method:"),&m_MethodToUse,3,choices,"Select method");
   m_Gui->Divider(0);
 
   m_Gui->Bool(ID_VTKCOMP,"Use VTK compatibility",&m_Vtkcomp,1,"Use VTK compatibility");
   m_Gui->Divider(0);
 
-  if (m_MethodToUse==1) {
+  if (m_MethodToUse!=MONTE_CARLO) {
     m_Gui->Enable(ID_ACCURACY,false);
     m_Gui->Enable(ID_VTKCOMP,false);
   }
@@ -498,20 +501,246 @@ double medOpComputeInertialTensor::GetSurfaceMassFromVTK(mafNode* node)
   return tot_mass;
 }
 //----------------------------------------------------------------------------
-int medOpComputeInertialTensor::ComputeInertialTensor(mafNode* node, int current_node, int n_of_nodes)
+int medOpComputeInertialTensor::ComputeInertialTensor(mafNode* node)
 //----------------------------------------------------------------------------
 {
   if (m_MethodToUse==MONTE_CARLO)
   {
-    return ComputeInertialTensorUsingMonteCarlo(node,current_node,n_of_nodes);
+    return ComputeInertialTensorUsingMonteCarlo(node);
+  }
+  else if (m_MethodToUse==EXACT)
+  {
+    return ComputeInertialTensorUsingExactIntegrals(node);
   }
   else
   {
-    return ComputeInertialTensorUsingGeometry(node,current_node,n_of_nodes);
+    return ComputeInertialTensorUsingGeometry(node);
   }
 }
 //----------------------------------------------------------------------------
-int medOpComputeInertialTensor::ComputeInertialTensorUsingGeometry(mafNode* node, int current_node, int n_of_nodes)
+int medOpComputeInertialTensor::ComputeInertialTensorUsingGeometry(mafNode* node)
+//----------------------------------------------------------------------------
+{
+  std::vector<mafNode*> nodes;
+  nodes.push_back(node);
+
+  return ComputeInertialTensors(nodes, GEOMETRY);
+}
+//----------------------------------------------------------------------------
+int medOpComputeInertialTensor::ComputeInertialTensorUsingMonteCarlo(mafNode* node)
+//----------------------------------------------------------------------------
+{
+  std::vector<mafNode*> nodes;
+  nodes.push_back(node);
+
+  return ComputeInertialTensors(nodes, MONTE_CARLO);
+}
+//----------------------------------------------------------------------------
+int medOpComputeInertialTensor::ComputeInertialTensorUsingExactIntegrals(mafNode* node)
+//----------------------------------------------------------------------------
+{
+  std::vector<mafNode*> nodes;
+  nodes.push_back(node);
+
+  return ComputeInertialTensors(nodes, EXACT);
+}
+
+//----------------------------------------------------------------------------
+// Parallel computation:
+//----------------------------------------------------------------------------
+
+// number of Monte Carlo samples generated and classified by one task
+#define MC_BATCH_SIZE 1024
+
+// number of tasks processed by every thread between two updates of the progress bar
+#define TASKS_PER_THREAD 16
+
+// indices of sums computed by tasks
+enum INERTIAL_SUMS
+{
+  // geometry: signed volume, centroid and second moments of tetrahedra
+  GS_M = 0, GS_CX, GS_CY, GS_CZ, GS_XX, GS_YY, GS_ZZ, GS_YX, GS_ZX, GS_ZY,
+
+  // Monte Carlo: number of inside samples, their first and second moments
+  MC_N = 0, MC_X, MC_Y, MC_Z, MC_XX, MC_YY, MC_ZZ, MC_XY, MC_XZ, MC_YZ,
+
+  NUMBER_OF_SUMS = 10,
+};
+
+// surface prepared in the main thread (VTK pipelines are not thread safe)
+typedef struct INERTIAL_SURFACE
+{
+  mafNode* Node;
+  vtkDataSet* DataSet;          // surface data, its cells are built
+  double DataSetBounds[6];      // bounds of DataSet
+  vtkGeometryFilter* Filter;    // converts DataSet to PolyData (Monte Carlo only)
+  vtkPolyData* PolyData;        // surface for inside tests (Monte Carlo only)
+  vtkMAFCellLocator* Locator;   // locator of PolyData, shared read-only by threads (Monte Carlo only)
+  double Bounds[6];             // bounds of PolyData
+  double Length;                // length of the diagonal of Bounds
+  double VMEBounds[6];          // bounds from which samples are taken
+  int FirstTask;                // index of the first task of this surface
+  int NumberOfTasks;            // number of tasks of this surface
+  int NumberOfSamples;          // total number of Monte Carlo samples
+} INERTIAL_SURFACE;
+
+// one unit of work: the whole surface (geometry) or a batch of samples (Monte Carlo)
+typedef struct INERTIAL_TASK
+{
+  int Surface;                  // index of the surface
+  int Batch;                    // index of the batch of samples, -1 for geometry
+  int NumberOfSamples;          // number of samples in the batch
+  double Sums[NUMBER_OF_SUMS];  // partial sums, see INERTIAL_SUMS
+} INERTIAL_TASK;
+
+// state of a thread, locators of surfaces are queried with marks of visited cells 
+// owned by the thread, so that they are never modified by the threads
+typedef struct INERTIAL_THREAD
+{
+  int Surface;                  // surface of Visited, -1 if none
+  std::vector<int> Visited;     // marks of cells visited by queries of the locator
+  int QueryNumber;              // mark of the current query
+  vtkIdList* CellIds;
+  vtkGenericCell* Cell;
+} INERTIAL_THREAD;
+
+typedef struct INERTIAL_JOB
+{
+  INERTIAL_SURFACE* Surfaces;
+  INERTIAL_TASK* Tasks;
+  INERTIAL_THREAD* Threads;
+  int FirstTask, LastTask;      // tasks of the current round
+} INERTIAL_JOB;
+
+//----------------------------------------------------------------------------
+// Returns the seed of the random generator for the given batch of the given surface,
+// so that samples do not depend on the thread processing the batch
+static long IT_GetBatchSeed(int surface, int batch)
+//----------------------------------------------------------------------------
+{
+  // integer hash spreads seeds of neighbouring batches over the whole period
+  unsigned int h = (unsigned int)(surface*65599 + batch + 1);
+  h = (h ^ 61) ^ (h >> 16);
+  h *= 9;
+  h ^= h >> 4;
+  h *= 0x27d4eb2d;
+  h ^= h >> 15;
+
+  return (long)(h % 2147483646u) + 1;
+}
+//----------------------------------------------------------------------------
+// Returns a random number from [min, max] and updates the seed
+// (minimal standard generator of Park and Miller, the same as vtkMath::Random)
+static double IT_Random(long& seed, double min, double max)
+//----------------------------------------------------------------------------
+{
+  long hi = seed / 127773;
+  long lo = seed % 127773;
+  seed = 16807*lo - 2836*hi;
+  if (seed < 0)
+  {
+    seed += 2147483647;
+  }
+
+  return min + (max - min)*((double)seed / 2147483647.0);
+}
+//----------------------------------------------------------------------------
+// Returns 1 if the point x is inside the surface, 0 otherwise.
+// Rays are fired in random directions generated from seed.
+static int IT_IsInsideSurface(INERTIAL_SURFACE* surface, INERTIAL_THREAD* thread, double x[3], long& seed)
+//----------------------------------------------------------------------------
+{
+  /*
+    IMPORTED FROM VTK 5.2 and modified by Simone Brazzale
+  */
+
+  double *bounds = surface->Bounds;
+
+  // do a quick bounds check
+  if ( x[0] < bounds[0] || x[0] > bounds[1] ||
+       x[1] < bounds[2] || x[1] > bounds[3] ||
+       x[2] < bounds[4] || x[2] > bounds[5])
+    {
+    return 0;
+    }
+  
+  // Set up structures for acceleration ray casting
+  double tolerance = 0.001;
+  double length = surface->Length;
+
+  //  Perform in/out by shooting random rays. Multiple rays are fired
+  //  to improve accuracy of the result.
+  //
+  //  The variable iterNumber counts the number of rays fired and is
+  //  limited by the defined variable VTK_MAX_ITER.
+  //
+  //  The variable deltaVotes keeps track of the number of votes for
+  //  "in" versus "out" of the surface.  When deltaVotes > 0, more votes
+  //  have counted for "in" than "out".  When deltaVotes < 0, more votes
+  //  have counted for "out" than "in".  When the delta_vote exceeds or
+  //  equals the defined variable VTK_VOTE_THRESHOLD, then the
+  //  appropriate "in" or "out" status is returned.
+  //
+  double rayMag, ray[3], xray[3], t, pcoords[3], xint[3];
+  int i, numInts, iterNumber, deltaVotes, subId;
+  vtkIdType idx, numCells;
+  double tol = tolerance*length;
+
+  for (deltaVotes = 0, iterNumber = 1;
+       (iterNumber < VTK_MAX_ITER) && (abs(deltaVotes) < VTK_VOTE_THRESHOLD);
+       iterNumber++) 
+    {
+    //  Define a random ray to fire.
+    rayMag = 0.0;
+    while (rayMag == 0.0 )
+      {
+      for (i=0; i<3; i++)
+        {
+        ray[i] = IT_Random(seed,-1.0,1.0);
+        }
+      rayMag = vtkMath::Norm(ray);
+      }
+
+    // The ray must be appropriately sized wrt the bounding box. (It has to go
+    // all the way through the bounding box.)
+    for (i=0; i<3; i++)
+      {
+      xray[i] = x[i] + (length/rayMag)*ray[i];
+      }
+
+    // Retrieve the candidate cells from the locator
+    surface->Locator->FindCellsAlongLine(x,xray,tol,thread->CellIds,&thread->Visited[0],thread->QueryNumber);
+
+    // Intersect the line with each of the candidate cells
+    numInts = 0;
+    numCells = thread->CellIds->GetNumberOfIds();
+    for ( idx=0; idx < numCells; idx++ )
+      {
+      surface->PolyData->GetCell(thread->CellIds->GetId(idx), thread->Cell);
+      if ( thread->Cell->IntersectWithLine(x, xray, tol, t, xint, pcoords, subId) )
+        {
+        numInts++;
+        }
+      } //for all candidate cells
+    
+    // Count the result
+    if ( (numInts % 2) == 0)
+      {
+      --deltaVotes;
+      }
+    else
+      {
+      ++deltaVotes;
+      }
+    } //try another ray
+
+  //   If the number of votes is positive, the point is inside
+  //
+  return ( deltaVotes < 0 ? 0 : 1 );
+}
+//----------------------------------------------------------------------------
+// Computes sums of signed tetrahedra formed by the origin and triangles of the surface
+static void IT_ComputeGeometrySums(vtkDataSet* ds, double sums[NUMBER_OF_SUMS])
 //----------------------------------------------------------------------------
 {
   //tensor components
@@ -528,65 +757,22 @@ int medOpComputeInertialTensor::ComputeInertialTensorUsingGeometry(mafNode* node
 
   */
 
-  int result = OP_RUN_CANCEL;
-
-  if (!node->IsMAFType(mafVMESurface))
-  {
-    return result;
-  }
-  
-  // get surface
-  mafVMESurface* surf = (mafVMESurface*) node;
-  if (surf->GetOutput() == NULL || surf->GetOutput()->GetVTKData() == NULL)
-    return result;
-  surf->GetOutput()->Update();
-  surf->GetOutput()->GetVTKData()->Update();
-
-  // get dataset
-  vtkDataSet* ds = surf->GetOutput()->GetVTKData();
-  int npoints = ds->GetNumberOfPoints();
   int ncells = ds->GetNumberOfCells();
 
-  if (ncells==0)
-  {
-    return result;
-  }
-
-  // wx stuff
-  wxBusyInfo *wait;
-  wxString str("Computing inertial tensor: surface ");
-  str << current_node << "/" << n_of_nodes;
-  mafString s(str.c_str());
-  if(!m_TestMode)
-  {
-    wxSetCursor(wxCursor(wxCURSOR_WAIT));
-    wait = new wxBusyInfo("Computing inertial tensor components...");
-    mafEventMacro(mafEvent(this,PROGRESSBAR_SHOW));
-    mafEventMacro(mafEvent(this,PROGRESSBAR_SET_TEXT,&s));
-  }
-
   // initialize variables
   int pId, qId, rId;
   double p[3],q[3],r[3];
-  double *a[3], a0[3], a1[3], a2[3], *v[3], v0[3], v1[3], v2[3];
 
   double _xx=0; double _yy=0; double _zz=0;
   double _yx=0; double _zx=0; double _zy=0;
   double _Cx=0; double _Cy=0; double _Cz=0;
   double _m=0;
   
-  a[0] = a0; a[1] = a1; a[2] = a2;
-  for (int i=0; i<3; i++ )
-    {
-    a0[i] = a1[i] = a2[i] = 0.0;
-    }
-  
   // loop through cells
   for (int i=0; i<ncells;i++)
   {
     int cellId = i;
-    vtkCell* cell = ds->GetCell(cellId);
-    int type = cell->GetCellType();
+    int type = ds->GetCellType(cellId);
     
     vtkIdType numPts = 0;
     vtkIdType *ptIds = 0;
@@ -633,36 +819,485 @@ int medOpComputeInertialTensor::ComputeInertialTensorUsingGeometry(mafNode* node
       // Contribution to the mass
       _m += v;
 
-      // Contribution to the centroid
-      double x4 = x1 + x2 + x3;           
-      _Cx += (v * x4);
-      double y4 = y1 + y2 + y3;           
-      _Cy += (v * y4);
-      double z4 = z1 + z2 + z3;           
-      _Cz += (v * z4);
+      // Contribution to the centroid
+      double x4 = x1 + x2 + x3;           
+      _Cx += (v * x4);
+      double y4 = y1 + y2 + y3;           
+      _Cy += (v * y4);
+      double z4 = z1 + z2 + z3;           
+      _Cz += (v * z4);
+
+      // Contribution to moment of inertia 
+      _xx += v * (x1*x1 + x2*x2 + x3*x3 + x4*x4);
+      _yy += v * (y1*y1 + y2*y2 + y3*y3 + y4*y4);
+      _zz += v * (z1*z1 + z2*z2 + z3*z3 + z4*z4);
+      _yx += v * (y1*x1 + y2*x2 + y3*x3 + y4*x4);
+      _zx += v * (z1*x1 + z2*x2 + z3*x3 + z4*x4);
+      _zy += v * (z1*y1 + z2*y2 + z3*y3 + z4*y4);
+
+    } // end foreach triangle
+  }// end foreach cell
+
+  sums[GS_M] = _m;
+  sums[GS_CX] = _Cx;
+  sums[GS_CY] = _Cy;
+  sums[GS_CZ] = _Cz;
+  sums[GS_XX] = _xx;
+  sums[GS_YY] = _yy;
+  sums[GS_ZZ] = _zz;
+  sums[GS_YX] = _yx;
+  sums[GS_ZX] = _zx;
+  sums[GS_ZY] = _zy;
+}
+//----------------------------------------------------------------------------
+// Generates and classifies one batch of Monte Carlo samples, moments of inside 
+// samples are computed about the center of VMEBounds to avoid loss of precision
+static void IT_ComputeMonteCarloSums(INERTIAL_JOB* job, INERTIAL_THREAD* thread, INERTIAL_TASK* task)
+//----------------------------------------------------------------------------
+{
+  INERTIAL_SURFACE* surface = &job->Surfaces[task->Surface];
+  if (thread->Surface != task->Surface)
+  {
+    thread->Visited.assign(surface->PolyData->GetNumberOfCells() + 1, 0);
+    thread->QueryNumber = 0;
+    thread->Surface = task->Surface;
+  }
+
+  double *vme_bounds = surface->VMEBounds;
+  double *ds_bounds = surface->DataSetBounds;
+  double center[3];
+  center[0] = (vme_bounds[0] + vme_bounds[1]) / 2;
+  center[1] = (vme_bounds[2] + vme_bounds[3]) / 2;
+  center[2] = (vme_bounds[4] + vme_bounds[5]) / 2;
+
+  double* sums = task->Sums;
+  long seed = IT_GetBatchSeed(task->Surface, task->Batch);
+  for (int i = 0; i < task->NumberOfSamples; i++)
+  {
+    // get random point
+    double x = IT_Random(seed,vme_bounds[0],vme_bounds[1]);
+    double y = IT_Random(seed,vme_bounds[2],vme_bounds[3]);
+    double z = IT_Random(seed,vme_bounds[4],vme_bounds[5]);
+
+    // refer points to the center of the bounding box for vtk calculations
+    double p[3];
+    p[0] = x - (vme_bounds[0] - ds_bounds[0]);
+    p[1] = y - (vme_bounds[2] - ds_bounds[2]);
+    p[2] = z - (vme_bounds[4] - ds_bounds[4]);
+
+    // is it inside surface? (the algorithm assumes the surface is closed)
+    if (IT_IsInsideSurface(surface,thread,p,seed))
+    {
+      x -= center[0];
+      y -= center[1];
+      z -= center[2];
+
+      sums[MC_N] += 1;
+      sums[MC_X] += x;
+      sums[MC_Y] += y;
+      sums[MC_Z] += z;
+      sums[MC_XX] += x*x;
+      sums[MC_YY] += y*y;
+      sums[MC_ZZ] += z*z;
+      sums[MC_XY] += x*y;
+      sums[MC_XZ] += x*z;
+      sums[MC_YZ] += y*z;
+    }
+  }
+}
+//----------------------------------------------------------------------------
+// Processes tasks of the current round assigned to the given thread
+static void IT_ExecuteTasks(INERTIAL_JOB* job, int threadId, int nThreads)
+//----------------------------------------------------------------------------
+{
+  for (int i = job->FirstTask + threadId; i < job->LastTask; i += nThreads)
+  {
+    INERTIAL_TASK* task = &job->Tasks[i];
+    for (int j = 0; j < NUMBER_OF_SUMS; j++)
+    {
+      task->Sums[j] = 0.0;
+    }
+
+    if (task->Batch < 0)
+    {
+      IT_ComputeGeometrySums(job->Surfaces[task->Surface].DataSet, task->Sums);
+    }
+    else
+    {
+      IT_ComputeMonteCarloSums(job, &job->Threads[threadId], task);
+    }
+  }
+}
+//----------------------------------------------------------------------------
+// Thread function of ComputeInertialTensors
+static VTK_THREAD_RETURN_TYPE IT_ExecuteTasksThread(void* arg)
+//----------------------------------------------------------------------------
+{
+  vtkMultiThreader::ThreadInfo* info = (vtkMultiThreader::ThreadInfo*)arg;
+  IT_ExecuteTasks((INERTIAL_JOB*)info->UserData, info->ThreadID, info->NumberOfThreads);
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+int medOpComputeInertialTensor::ComputeInertialTensors(std::vector<mafNode*>& nodes, int method)
+//----------------------------------------------------------------------------
+{
+  if (method == EXACT)
+  {
+    return ComputeInertialTensorsUsingExactIntegrals(nodes);
+  }
+
+  int result = OP_RUN_CANCEL;
+  bool monteCarlo = (method == MONTE_CARLO);
+
+  // prepare surfaces and tasks
+  std::vector<INERTIAL_SURFACE> surfaces;
+  std::vector<INERTIAL_TASK> tasks;
+  for (int i = 0; i < (int)nodes.size(); i++)
+  {
+    if (nodes[i] == NULL || !nodes[i]->IsMAFType(mafVMESurface))
+    {
+      continue;
+    }
+
+    // get surface
+    mafVMESurface* surf = (mafVMESurface*) nodes[i];
+    if (surf->GetOutput() == NULL || surf->GetOutput()->GetVTKData() == NULL)
+      continue;
+    surf->GetOutput()->Update();
+    surf->GetOutput()->GetVTKData()->Update();
+
+    // get dataset
+    vtkDataSet* ds = surf->GetOutput()->GetVTKData();
+    if (ds->GetNumberOfCells() == 0)
+    {
+      continue;
+    }
+
+    INERTIAL_SURFACE surface;
+    surface.Node = nodes[i];
+    surface.DataSet = ds;
+    surface.Filter = NULL;
+    surface.PolyData = NULL;
+    surface.Locator = NULL;
+    surface.FirstTask = tasks.size();
+    surface.NumberOfTasks = 0;
+    surface.NumberOfSamples = 0;
+
+    // data is accessed from threads, so cells and bounds must be built here
+    ds->GetCellType(0);
+    ds->GetBounds(surface.DataSetBounds);
+
+    INERTIAL_TASK task;
+    task.Surface = surfaces.size();
+    if (!monteCarlo)
+    {
+      task.Batch = -1;
+      task.NumberOfSamples = 0;
+      tasks.push_back(task);
+      surface.NumberOfTasks = 1;
+    }
+    else
+    {
+      surface.Filter = vtkGeometryFilter::New();
+      surface.Filter->SetInput(ds);
+      surface.Filter->Update();
+      surface.PolyData = surface.Filter->GetOutput();
+      if (surface.PolyData->GetNumberOfCells() > 0)
+      {
+        surface.PolyData->GetCellType(0);
+      }
+      surface.PolyData->GetBounds(surface.Bounds);
+      surface.Length = surface.PolyData->GetLength();
+
+      // the locator is built once here and only queried by the threads
+      surface.Locator = vtkMAFCellLocator::New();
+      surface.Locator->SetDataSet(surface.PolyData);
+      surface.Locator->BuildLocator();
+      surf->GetOutput()->GetBounds(surface.VMEBounds);
+
+      surface.NumberOfSamples = m_Accuracy > 0 ? m_Accuracy : 0;
+      for (task.Batch = 0; task.Batch*MC_BATCH_SIZE < surface.NumberOfSamples; task.Batch++)
+      {
+        task.NumberOfSamples = surface.NumberOfSamples - task.Batch*MC_BATCH_SIZE;
+        if (task.NumberOfSamples > MC_BATCH_SIZE)
+          task.NumberOfSamples = MC_BATCH_SIZE;
+
+        tasks.push_back(task);
+        surface.NumberOfTasks++;
+      }
+    }
+
+    surfaces.push_back(surface);
+  }
+
+  if (surfaces.empty())
+  {
+    return result;
+  }
+
+  // wx stuff
+  wxBusyInfo *wait = NULL;
+  wxString str("Computing inertial tensor: ");
+  str << (int)surfaces.size() << (surfaces.size() == 1 ? " surface" : " surfaces");
+  mafString s(str.c_str());
+  if(!m_TestMode)
+  {
+    wxSetCursor(wxCursor(wxCURSOR_WAIT));
+    wait = new wxBusyInfo("Computing inertial tensor components, please wait...");
+    mafEventMacro(mafEvent(this,PROGRESSBAR_SHOW));
+    mafEventMacro(mafEvent(this,PROGRESSBAR_SET_TEXT,&s));
+  }
+
+  // process tasks in rounds, the progress bar is updated after every round
+  vtkMultiThreader* threader = vtkMultiThreader::New();
+  int nTasks = tasks.size();
+  int nThreads = m_NumberOfThreads > 0 ? m_NumberOfThreads : threader->GetNumberOfThreads();
+  if (nThreads > VTK_MAX_THREADS)
+    nThreads = VTK_MAX_THREADS;
+  if (nThreads > nTasks)
+    nThreads = nTasks;
+  if (nThreads < 1)
+    nThreads = 1;
+
+  std::vector<INERTIAL_THREAD> threads(nThreads);
+  for (int i = 0; i < nThreads; i++)
+  {
+    threads[i].Surface = -1;
+    threads[i].QueryNumber = 0;
+    threads[i].CellIds = NULL;
+    threads[i].Cell = NULL;
+    if (monteCarlo)
+    {
+      threads[i].CellIds = vtkIdList::New();
+      threads[i].Cell = vtkGenericCell::New();
+    }
+  }
+
+  INERTIAL_JOB job;
+  job.Surfaces = &surfaces[0];
+  job.Tasks = tasks.empty() ? NULL : &tasks[0];
+  job.Threads = &threads[0];
+
+  int nRoundTasks = nThreads*TASKS_PER_THREAD;
+  for (job.FirstTask = 0; job.FirstTask < nTasks; job.FirstTask = job.LastTask)
+  {
+    job.LastTask = job.FirstTask + nRoundTasks;
+    if (job.LastTask > nTasks)
+      job.LastTask = nTasks;
+
+    if (nThreads == 1)
+    {
+      IT_ExecuteTasks(&job, 0, 1);
+    }
+    else
+    {
+      threader->SetNumberOfThreads(nThreads);
+      threader->SetSingleMethod(IT_ExecuteTasksThread, &job);
+      threader->SingleMethodExecute();
+    }
+
+    if (!m_TestMode)
+    {
+      mafEventMacro(mafEvent(this,PROGRESSBAR_SET_VALUE,(long)(((double) job.LastTask)/((double) nTasks)*100.)));
+    }
+  }
+
+  for (int i = 0; i < nThreads; i++)
+  {
+    vtkDEL(threads[i].CellIds);
+    vtkDEL(threads[i].Cell);
+  }
+  vtkDEL(threader);
+
+  // sum partial results in the order of tasks, so they do not depend on the number of threads
+  result = OP_RUN_OK;
+  for (int i = 0; i < (int)surfaces.size(); i++)
+  {
+    INERTIAL_SURFACE& surface = surfaces[i];
+
+    double sums[NUMBER_OF_SUMS];
+    for (int j = 0; j < NUMBER_OF_SUMS; j++)
+    {
+      sums[j] = 0.0;
+    }
+
+    for (int k = 0; k < surface.NumberOfTasks; k++)
+    {
+      INERTIAL_TASK& task = tasks[surface.FirstTask + k];
+      for (int j = 0; j < NUMBER_OF_SUMS; j++)
+      {
+        sums[j] += task.Sums[j];
+      }
+    }
+
+    if (!monteCarlo)
+    {
+      AddInertialTensorFromGeometry(surface.Node, sums);
+    }
+    else 
+    {
+      if (!AddInertialTensorFromMonteCarlo(surface.Node, sums, surface.NumberOfSamples, surface.DataSetBounds))
+      {
+        result = OP_RUN_CANCEL;
+      }
+
+      vtkDEL(surface.Locator);
+      vtkDEL(surface.Filter);
+    }
+  }
+
+  if(!m_TestMode)
+  {
+    mafEventMacro(mafEvent(this,PROGRESSBAR_HIDE));
+    wxSetCursor(wxCursor(wxCURSOR_DEFAULT));
+    cppDEL(wait);
+  }
+
+  return result;
+}
+//----------------------------------------------------------------------------
+int medOpComputeInertialTensor::ComputeInertialTensorsUsingExactIntegrals(std::vector<mafNode*>& nodes)
+//----------------------------------------------------------------------------
+{
+  int result = OP_RUN_CANCEL;
+
+  // wx stuff
+  wxBusyInfo *wait = NULL;
+  if(!m_TestMode)
+  {
+    wxSetCursor(wxCursor(wxCURSOR_WAIT));
+    wait = new wxBusyInfo("Computing inertial tensor components...");
+    mafEventMacro(mafEvent(this,PROGRESSBAR_SHOW));
+  }
+
+  vtkMEDMassProperties* massProperties = vtkMEDMassProperties::New();
+  if (m_NumberOfThreads > 0)
+  {
+    massProperties->SetNumberOfThreads(m_NumberOfThreads);
+  }
+
+  for (int i = 0; i < (int)nodes.size(); i++)
+  {
+    if (nodes[i] == NULL || !nodes[i]->IsMAFType(mafVMESurface))
+    {
+      continue;
+    }
+
+    // get surface
+    mafVMESurface* surf = (mafVMESurface*) nodes[i];
+    if (surf->GetOutput() == NULL || surf->GetOutput()->GetVTKData() == NULL)
+      continue;
+    surf->GetOutput()->Update();
+    surf->GetOutput()->GetVTKData()->Update();
+
+    vtkPolyData* pd = vtkPolyData::SafeDownCast(surf->GetOutput()->GetVTKData());
+    if (pd == NULL || pd->GetNumberOfCells() == 0)
+    {
+      continue;
+    }
+
+    if(!m_TestMode)
+    {
+      wxString str("Computing inertial tensor: surface ");
+      str << i + 1 << "/" << (int)nodes.size();
+      mafString s(str.c_str());
+      mafEventMacro(mafEvent(this,PROGRESSBAR_SET_TEXT,&s));
+      mafEventMacro(mafEvent(this,PROGRESSBAR_SET_VALUE,(long)(((double) i)/((double) nodes.size())*100.)));
+    }
+
+    massProperties->SetInput(pd);
+    massProperties->SetDensity(GetDensityForComputation(nodes[i]));
+    massProperties->Update();
+
+    // vtkMEDMassProperties stores -Ixy, -Ixz, -Iyz, while the geometry method 
+    // stores the products of inertia themselves, so their sign is changed
+    double* tensor = massProperties->GetInertiaTensor();
+    double *a[3], a0[3], a1[3], a2[3], *v[3], v0[3], v1[3], v2[3];
+    a[0] = a0; a[1] = a1; a[2] = a2;
+    for (int j = 0; j < 9; j++)
+    {
+      a[j / 3][j % 3] = (j % 4 == 0) ? tensor[j] : -tensor[j];
+      m_InertialTensor[j] += a[j / 3][j % 3];
+    }
+
+    // principal moments of the same matrix used by the geometry method, so that both methods
+    // give the same principal moments for the same surface
+    double eval[3];
+    v[0] = v0; v[1] = v1; v[2] = v2; 
+    vtkMath::Jacobi(a,eval,v);
+    m__Principal_I1 += eval[0];
+    m_Principal_I2 += eval[1];
+    m_Principal_I3 += eval[2];
+
+    // store the mass for later use
+    double mass = massProperties->GetMass();
+
+    pair<mafNode* , double> nodeMassPair(nodes[i] , mass);
+
+    m_NodeMassPairVector.push_back(nodeMassPair);
+
+    m_Mass += mass;
+
+    result = OP_RUN_OK;
+  }
+
+  vtkDEL(massProperties);
+
+  if(!m_TestMode)
+  {
+    mafEventMacro(mafEvent(this,PROGRESSBAR_HIDE));
+    wxSetCursor(wxCursor(wxCURSOR_DEFAULT));
+    cppDEL(wait);
+  }
+
+  return result;
+}
+//----------------------------------------------------------------------------
+double medOpComputeInertialTensor::GetDensityForComputation(mafNode* node)
+//----------------------------------------------------------------------------
+{
+  double density = GetDensity(node);
+  
+  if (density == DENSITY_NOT_FOUND)
+  {
+
+	  density = m_DefaultDensity;
+
+	  std::ostringstream stringStream;
+	  stringStream << DENSITY_TAG_NAME.c_str() << " tag not found. Using default density value ie " << density << std::endl;          			
+	  mafLogMessage(stringStream.str().c_str());
+	  
+  }
+  else
+  {
+	  std::ostringstream stringStream;
+	  stringStream << DENSITY_TAG_NAME.c_str() << " tag found. Using value " << density << std::endl;          			
+	  mafLogMessage(stringStream.str().c_str());
+
+  }
 
-      // Contribution to moment of inertia 
-      _xx += v * (x1*x1 + x2*x2 + x3*x3 + x4*x4);
-      _yy += v * (y1*y1 + y2*y2 + y3*y3 + y4*y4);
-      _zz += v * (z1*z1 + z2*z2 + z3*z3 + z4*z4);
-      _yx += v * (y1*x1 + y2*x2 + y3*x3 + y4*x4);
-      _zx += v * (z1*x1 + z2*x2 + z3*x3 + z4*x4);
-      _zy += v * (z1*y1 + z2*y2 + z3*y3 + z4*y4);
+  return density;
+}
+//----------------------------------------------------------------------------
+void medOpComputeInertialTensor::AddInertialTensorFromGeometry(mafNode* node, const double sums[10])
+//----------------------------------------------------------------------------
+{
+  double *a[3], a0[3], a1[3], a2[3], *v[3], v0[3], v1[3], v2[3];
 
-      if (!m_TestMode)
-      {
-        mafEventMacro(mafEvent(this,PROGRESSBAR_SET_VALUE,(long)(((double) i)/((double) ncells)*100.)));
-      }
+  a[0] = a0; a[1] = a1; a[2] = a2;
 
-    } // end foreach triangle
-  }// end foreach cell
+  double _xx = sums[GS_XX]; double _yy = sums[GS_YY]; double _zz = sums[GS_ZZ];
+  double _yx = sums[GS_YX]; double _zx = sums[GS_ZX]; double _zy = sums[GS_ZY];
+  double _m = sums[GS_M];
 
   // Centroid.  
   // The case _m = 0 needs to be addressed here.
   double rr = 1.0 / (4 * _m);
-  double Cx = _Cx * rr;
-  double Cy = _Cy * rr;
-  double Cz = _Cz * rr;
+  double Cx = sums[GS_CX] * rr;
+  double Cy = sums[GS_CY] * rr;
+  double Cz = sums[GS_CZ] * rr;
 
   // Mass
   double m = _m / 6;
@@ -696,27 +1331,7 @@ int medOpComputeInertialTensor::ComputeInertialTensorUsingGeometry(mafNode* node
 
   // scale by the density
 
-  double density = GetDensity(node);
-  
-  if (density == DENSITY_NOT_FOUND)
-  {
-
-	  density = m_DefaultDensity;
-
-	  std::ostringstream stringStream;
-	  stringStream << DENSITY_TAG_NAME.c_str() << " tag not found. Using default density value ie " << density << std::endl;          			
-	  mafLogMessage(stringStream.str().c_str());
-	  
-  }
-  else
-  {
-	  std::ostringstream stringStream;
-	  stringStream << DENSITY_TAG_NAME.c_str() << " tag found. Using value " << density << std::endl;          			
-	  mafLogMessage(stringStream.str().c_str());
-
-  }
-
-  double scale = density;
+  double scale = GetDensityForComputation(node);
 
   // scale the inertial tensor with the density
   m_InertialTensor[0] += scale * Ixx;
@@ -744,183 +1359,66 @@ int medOpComputeInertialTensor::ComputeInertialTensorUsingGeometry(mafNode* node
   m_NodeMassPairVector.push_back(nodeMassPair);
 
   m_Mass += mass;
-
-  if(!m_TestMode)
-  {
-    mafEventMacro(mafEvent(this,PROGRESSBAR_HIDE));
-    wxSetCursor(wxCursor(wxCURSOR_DEFAULT));
-    cppDEL(wait);
-  }
-
-  result = OP_RUN_OK;
-  return result;
 }
 //----------------------------------------------------------------------------
-int medOpComputeInertialTensor::ComputeInertialTensorUsingMonteCarlo(mafNode* node, int current_node, int n_of_nodes)
+bool medOpComputeInertialTensor::AddInertialTensorFromMonteCarlo(mafNode* node, const double sums[10], 
+  int n_samples, const double ds_bounds[6])
 //----------------------------------------------------------------------------
 {
-  //tensor components
-  /* 
-            | (y^2+z^2)    -x*y      -x*z     |
-     T_i =  |   -x*y    (x^2+z^2)    -y*z     |
-            |   -x*z       -y*z    (x^2+y^2)  |
-
-              t21 = t12; t31 = t13; t32 = t23
-
-      T   =   sum_i (m_i*t_i)
-
-      the tensor of a system with n points each of mass m_i is the sum of the components over the n points.
-
-  */
-
-  int result = OP_RUN_CANCEL;
-
-  if (!node->IsMAFType(mafVMESurface))
-  {
-    return result;
-  }
-  
-  // get surface
-  mafVMESurface* surf = (mafVMESurface*) node;
-  if (surf->GetOutput() == NULL || surf->GetOutput()->GetVTKData() == NULL)
-    return result;
-  surf->GetOutput()->Update();
-  surf->GetOutput()->GetVTKData()->Update();
-
-  // wx stuff
-  wxBusyInfo *wait;
-  wxString str("Computing inertial tensor: surface ");
-  str << current_node << "/" << n_of_nodes;
-  mafString s(str.c_str());
-  if(!m_TestMode)
-  {
-    wxSetCursor(wxCursor(wxCURSOR_WAIT));
-    wait = new wxBusyInfo("Computing inertial tensor components, please wait...");
-    mafEventMacro(mafEvent(this,PROGRESSBAR_SHOW));
-    mafEventMacro(mafEvent(this,PROGRESSBAR_SET_TEXT,&s));
-  }
-  
-  // get dataset
-  vtkDataSet* ds = surf->GetOutput()->GetVTKData();
-  vtkGeometryFilter* gfilter = vtkGeometryFilter::New();
-  gfilter->SetInput(ds);
-  gfilter->Update();
-  vtkPolyData* pd = gfilter->GetOutput();
-
-  // get vme bounds
-  double vme_bounds[6];
-  surf->GetOutput()->GetBounds(vme_bounds);
-
-  // get dataset bounds
-  double ds_bounds[6];
-  ds->GetBounds(ds_bounds);
-  
-  // initialize points for Monte Carlo method
-  double pint = 0; // this is the counter for the internal points
-  double ptot = 0; // this is the counter for all the points
-
-  // inizialize matrixes
-  double *a[3], a0[3], a1[3], a2[3], *ai[3], ai0[3], ai1[3], ai2[3],*v[3], v0[3], v1[3], v2[3];
-  ai[0] = ai0; ai[1] = ai1; ai[2] = ai2; // matrix elements for internal points
-  a[0] = a0; a[1] = a1; a[2] = a2; // final matrix elements for tensor computation
-  for (int i=0; i<3; i++ )
-  {
-    ai0[i] = ai1[i] = ai2[i] = 0.0;
-    a0[i] = a1[i] = a2[i] = 0.0;
-  }
-  v[0] = v0; v[1] = v1; v[2] = v2;
-  
   /*
-    START MONTE CARLO:
+    MONTE CARLO:
     Pick a point in the containing hypercube. Add to the ptot counter. 
     Is it in the polyhedron? If yes, add to the pint counter. Do this lots (m_Accuracy).
     Then mass_polyhedron/mass_hypercube \approx pint/ptot.
 
     For the moment of inertia, each count is weighted by the square of the distance of the point to the reference axis.
+    The distances are measured from the center of mass, i.e., sums of inside points are moved to it 
+    (parallel axis theorem): sum (x - cx)*(y - cy) = sum x*y - cy * sum x, where cx = sum x / pint
   */
- 
-  // 1) Measure Center Of Mass coordinates
+  double pint = sums[MC_N];         // this is the counter for the internal points
+  double ptot = n_samples;          // this is the counter for all the points
 
-  double com[3];
-  com[0]=0;com[1]=0;com[2]=0;
-  double pcom = 0;
-  for (int i=0; i<m_Accuracy; i++)
+  if (pint == 0)
   {
-    // get random point
-    double x = vtkMath::Random(vme_bounds[0],vme_bounds[1]);
-    double y = vtkMath::Random(vme_bounds[2],vme_bounds[3]);
-    double z = vtkMath::Random(vme_bounds[4],vme_bounds[5]);
-    
-    // refer points to the center of the bounding box for vtk calculations
-    double p[3];
-    p[0] = x - (vme_bounds[0] - ds_bounds[0]);
-    p[1] = y - (vme_bounds[2] - ds_bounds[2]);
-    p[2] = z - (vme_bounds[4] - ds_bounds[4]);
-    
-    // is it inside surface? (the algorithm assumes the surface is closed)
-    if (IsInsideSurface(pd,p))
-    {
-      com[0] += x;
-      com[1] += y;
-      com[2] += z;
-      pcom++;
-    }
-
-    if (!m_TestMode)
-    {
-      mafEventMacro(mafEvent(this,PROGRESSBAR_SET_VALUE,(long)(((double) i)/((double) m_Accuracy)*50.)));
-    }
+    wxString s;
+    s << "Monte Carlo: no sample found inside " << node->GetName() << ". Increase the accuracy!";
+    mafLogMessage(s.c_str());
+    return false;
   }
-  com[0] /= pcom;
-  com[1] /= pcom;
-  com[2] /= pcom;
 
-  if (!m_TestMode)
-  {
-    mafEventMacro(mafEvent(this,PROGRESSBAR_SET_VALUE,50.0));
-  }
+  // convergence report: relative standard error of the mass estimated from pint/ptot
+  double ratio = pint/ptot;
+  std::ostringstream stringStream;
+  stringStream << "Monte Carlo: " << node->GetName() << ": " << pint << " of " << ptot << 
+    " samples inside, relative standard error of the mass " << 100.0*sqrt((1.0 - ratio)/pint) << "%" << std::endl;
+  mafLogMessage(stringStream.str().c_str());
 
-  // 2) Apply Monte Carlo method
+  // 1) Measure Center Of Mass coordinates
 
-  for (int i=0; i<m_Accuracy; i++)
-  {
-    // get random point
-    double x = vtkMath::Random(vme_bounds[0],vme_bounds[1]);
-    double y = vtkMath::Random(vme_bounds[2],vme_bounds[3]);
-    double z = vtkMath::Random(vme_bounds[4],vme_bounds[5]);
-    
-    // refer points to the center of the bounding box for vtk calculations
-    double p[3];
-    p[0] = x - (vme_bounds[0] - ds_bounds[0]);
-    p[1] = y - (vme_bounds[2] - ds_bounds[2]);
-    p[2] = z - (vme_bounds[4] - ds_bounds[4]);
+  double com[3];
+  com[0] = sums[MC_X] / pint;
+  com[1] = sums[MC_Y] / pint;
+  com[2] = sums[MC_Z] / pint;
 
-    // is it inside surface? (the algorithm assumes the surface is closed)
-    if (IsInsideSurface(pd,p))
-    {
-      pint++;
-
-      // refere points to the center of mass of the surface for Monte Carlo calculations
-      x -= com[0];
-      y -= com[1];
-      z -= com[2];
-
-      // perform matrix element calculation
-      ai0[0] += y*y + z*z ;
-      ai1[1] += x*x + z*z ;
-      ai2[2] += x*x + y*y ;
-      ai0[1] -= x*y;
-      ai0[2] -= x*z;
-      ai1[2] -= y*z;
-    }
+  // 2) Apply Monte Carlo method
+
+  // inizialize matrixes
+  double *a[3], a0[3], a1[3], a2[3], *ai[3], ai0[3], ai1[3], ai2[3],*v[3], v0[3], v1[3], v2[3];
+  ai[0] = ai0; ai[1] = ai1; ai[2] = ai2; // matrix elements for internal points
+  a[0] = a0; a[1] = a1; a[2] = a2; // final matrix elements for tensor computation
+  v[0] = v0; v[1] = v1; v[2] = v2;
 
-    ptot++;
+  double xx = sums[MC_XX] - sums[MC_X]*com[0];
+  double yy = sums[MC_YY] - sums[MC_Y]*com[1];
+  double zz = sums[MC_ZZ] - sums[MC_Z]*com[2];
 
-    if (!m_TestMode)
-    {
-      mafEventMacro(mafEvent(this,PROGRESSBAR_SET_VALUE,(long)(50+(((double) i)/((double) m_Accuracy)*50.))));
-    }
-  }
+  // perform matrix element calculation
+  ai0[0] = yy + zz ;
+  ai1[1] = xx + zz ;
+  ai2[2] = xx + yy ;
+  ai0[1] = -(sums[MC_XY] - sums[MC_X]*com[1]);
+  ai0[2] = -(sums[MC_XZ] - sums[MC_X]*com[2]);
+  ai1[2] = -(sums[MC_YZ] - sums[MC_Y]*com[2]);
 
   // 3) Get final values
 
@@ -983,8 +1481,6 @@ int medOpComputeInertialTensor::ComputeInertialTensorUsingMonteCarlo(mafNode* no
   a[2][1] = hycube_m*ph_t32ratio;
   a[2][2] = hycube_m*ph_t33ratio;
 
-  mafString ss;
-  
   // by the spectral theorem, since the moment of inertia tensor is real and symmetric, there exists a Cartesian coordinate system in which it is diagonal,
   // the coordinate axes are called the principal axes and the constants I1, I2 and I3 are called the principal moments of inertia. 
   // extract eigenvalues from jacobian matrix (inertial tensor components referred to principal axes).
@@ -1007,17 +1503,7 @@ int medOpComputeInertialTensor::ComputeInertialTensorUsingMonteCarlo(mafNode* no
   m_InertialTensor[7] += scale * a[2][1];
   m_InertialTensor[8] += scale * a[2][2];
 
-  if(!m_TestMode)
-  {
-    mafEventMacro(mafEvent(this,PROGRESSBAR_HIDE));
-    wxSetCursor(wxCursor(wxCURSOR_DEFAULT));
-    cppDEL(wait);
-  }
-
-  vtkDEL(gfilter);
-  
-  result = OP_RUN_OK;
-  return result;
+  return true;
 }
 //----------------------------------------------------------------------------
 int medOpComputeInertialTensor::ComputeInertialTensorFromGroup()
@@ -1052,6 +1538,7 @@ int medOpComputeInertialTensor::ComputeInertialTensorFromGroup()
   }
 
   // compute inertial tensor fro each children (results will be summed)
+  std::vector<mafNode*> surfaces;
   for (int i=0;i<n_of_children;i++)
   {
 	mafVMESurface *childSurface = mafVMESurface::SafeDownCast(group->GetChild(i));
@@ -1062,125 +1549,18 @@ int medOpComputeInertialTensor::ComputeInertialTensorFromGroup()
 	  wxString s;
 	  s << "Computing Inertial tensor for: " << childSurface->GetName();
 	  mafLogMessage(s.c_str());      
-	  ComputeInertialTensor(childSurface,i+1,n_of_children - 1);
+	  surfaces.push_back(childSurface);
 
     }
   }
 
+  // children are processed concurrently
+  ComputeInertialTensors(surfaces, m_MethodToUse);
+
   result = OP_RUN_OK;
 
   return result;
 }
-//----------------------------------------------------------------------------
-int medOpComputeInertialTensor::IsInsideSurface(vtkPolyData* surface, double x[3])
-//----------------------------------------------------------------------------
-{
-  /*
-    IMPORTED FROM VTK 5.2 and modified by Simone Brazzale
-  */
-
-  if (surface==NULL)
-  {
-    return 0;
-  }
-
-  double bounds[6];
-  surface->GetBounds(bounds);
-
-  // do a quick bounds check
-  if ( x[0] < bounds[0] || x[0] > bounds[1] ||
-       x[1] < bounds[2] || x[1] > bounds[3] ||
-       x[2] < bounds[4] || x[2] > bounds[5])
-    {
-    return 0;
-    }
-  
-  // Set up structures for acceleration ray casting
-  double tolerance = 0.001;
-  double length = surface->GetLength();
-
-  vtkMAFCellLocator* cellLocator = vtkMAFCellLocator::New();
-  vtkIdList* cellIds = vtkIdList::New();
-  vtkGenericCell* cell = vtkGenericCell::New();
-
-  cellLocator->SetDataSet(surface);
-  cellLocator->BuildLocator();
-  
-  //  Perform in/out by shooting random rays. Multiple rays are fired
-  //  to improve accuracy of the result.
-  //
-  //  The variable iterNumber counts the number of rays fired and is
-  //  limited by the defined variable VTK_MAX_ITER.
-  //
-  //  The variable deltaVotes keeps track of the number of votes for
-  //  "in" versus "out" of the surface.  When deltaVotes > 0, more votes
-  //  have counted for "in" than "out".  When deltaVotes < 0, more votes
-  //  have counted for "out" than "in".  When the delta_vote exceeds or
-  //  equals the defined variable VTK_VOTE_THRESHOLD, then the
-  //  appropriate "in" or "out" status is returned.
-  //
-  double rayMag, ray[3], xray[3], t, pcoords[3], xint[3];
-  int i, numInts, iterNumber, deltaVotes, subId;
-  vtkIdType idx, numCells;
-  double tol = tolerance*length;
-
-  for (deltaVotes = 0, iterNumber = 1;
-       (iterNumber < VTK_MAX_ITER) && (abs(deltaVotes) < VTK_VOTE_THRESHOLD);
-       iterNumber++) 
-    {
-    //  Define a random ray to fire.
-    rayMag = 0.0;
-    while (rayMag == 0.0 )
-      {
-      for (i=0; i<3; i++)
-        {
-        ray[i] = vtkMath::Random(-1.0,1.0);
-        }
-      rayMag = vtkMath::Norm(ray);
-      }
-
-    // The ray must be appropriately sized wrt the bounding box. (It has to go
-    // all the way through the bounding box.)
-    for (i=0; i<3; i++)
-      {
-      xray[i] = x[i] + (length/rayMag)*ray[i];
-      }
-
-    // Retrieve the candidate cells from the locator
-    cellLocator->FindCellsAlongLine(x,xray,tol,cellIds);
-
-    // Intersect the line with each of the candidate cells
-    numInts = 0;
-    numCells = cellIds->GetNumberOfIds();
-    for ( idx=0; idx < numCells; idx++ )
-      {
-      surface->GetCell(cellIds->GetId(idx), cell);
-      if ( cell->IntersectWithLine(x, xray, tol, t, xint, pcoords, subId) )
-        {
-        numInts++;
-        }
-      } //for all candidate cells
-    
-    // Count the result
-    if ( (numInts % 2) == 0)
-      {
-      --deltaVotes;
-      }
-    else
-      {
-      ++deltaVotes;
-      }
-    } //try another ray
-
-  cell->Delete();
-  cellIds->Delete();
-  cellLocator->Delete();
-
-  //   If the number of votes is positive, the point is inside
-  //
-  return ( deltaVotes < 0 ? 0 : 1 );
-}
-
 double medOpComputeInertialTensor::GetDensity( mafNode* node)
 {
 	double density = DENSITY_NOT_FOUND;
@@ -56,6 +56,13 @@ class vtkCell;
 class MED_OPERATION_EXPORT medOpComputeInertialTensor: public mafOp
 {
 public:
+  enum COMPUTATION_METHOD
+  {
+    MONTE_CARLO = 0,
+    GEOMETRY,
+    EXACT,        // closed-form integrals of vtkMEDMassProperties, parallel over cells
+  };	
+
   /** constructor */
   medOpComputeInertialTensor(const wxString &label = "ComputeInertialTensor");
   /** destructor */
@@ -88,8 +95,24 @@ public:
   /** Return the default density value used for computation */
   double GetDefaultDensity();
 
+  /** Set the method used for computation (MONTE_CARLO, GEOMETRY or EXACT) */
+  void SetMethodToUse(int method) {m_MethodToUse = method;};
+
+  /** Return the method used for computation */
+  int GetMethodToUse() {return m_MethodToUse;};
+
+  /** Set the number of random samples per surface used by the Monte Carlo method */
+  void SetAccuracy(int accuracy) {m_Accuracy = accuracy;};
+
+  /** Set the number of threads computing the tensors, 0 (default) means one per CPU.
+      The results do not depend on the number of threads. */
+  void SetNumberOfThreads(int nThreads) {m_NumberOfThreads = nThreads;};
+
+  /** Return the number of threads computing the tensors */
+  int GetNumberOfThreads() {return m_NumberOfThreads;};
+
   /** Calculate inertial tensor components from a surface and store them in the input vme. */
-  int ComputeInertialTensor(mafNode* node, int current_node = 1, int n_of_nodes = 1);
+  int ComputeInertialTensor(mafNode* node);
 
   /** Calculate inertial tensor components from a group of surfaces and store them in the input vme. */
   int ComputeInertialTensorFromGroup();
@@ -126,18 +149,44 @@ protected:
   /** Compute mass using both surface and volume. (VTK method, most accurate)*/
   double GetSurfaceMassFromVTK(mafNode* node);
 
-  /** Get if a point is inside or outside a surface */
-  int IsInsideSurface(vtkPolyData* surface, double x[3]);
-
   /** Calculate inertial tensor using Monte Carlo approach.
       This algorithm requires time and resources but is efficient for complex surfaces.
   */
-  int ComputeInertialTensorUsingMonteCarlo(mafNode* node, int current_node = 1, int n_of_nodes = 1);
+  int ComputeInertialTensorUsingMonteCarlo(mafNode* node);
 
   /** Calculate inertial tensor using geometry.
       This algorithm is fast but 
   */
-  int ComputeInertialTensorUsingGeometry(mafNode* node, int current_node = 1, int n_of_nodes = 1);
+  int ComputeInertialTensorUsingGeometry(mafNode* node);
+
+  /** Calculate inertial tensor using exact integrals over triangles of the surface.
+      This algorithm is fast, exact for closed surfaces and the tensor has the same
+      sign of products of inertia as the one computed using geometry.
+  */
+  int ComputeInertialTensorUsingExactIntegrals(mafNode* node);
+
+  /** Calculate inertial tensors of the given surfaces using the given method and sum them.
+      Surfaces (and batches of Monte Carlo samples) are processed concurrently,
+      the results are summed in the order of nodes. */
+  int ComputeInertialTensors(std::vector<mafNode*>& nodes, int method);
+
+  /** Calculate inertial tensors of the given surfaces using exact integrals and sum them.
+      Surfaces are processed one by one, triangles of every surface are processed concurrently. */
+  int ComputeInertialTensorsUsingExactIntegrals(std::vector<mafNode*>& nodes);
+
+  /** Get the density of the node for computation, i.e., the value of the "DENSITY" tag or
+      the default density if the tag is not found */
+  double GetDensityForComputation(mafNode* node);
+
+  /** Add the inertial tensor of the surface computed from the sums of signed tetrahedra
+      (mass, centroid and second moments, see ComputeInertialTensors) */
+  void AddInertialTensorFromGeometry(mafNode* node, const double sums[10]);
+
+  /** Add the inertial tensor of the surface computed from the sums of n_samples Monte Carlo
+      samples (number of inside samples, their first and second moments about the center of
+      vme_bounds), ds_bounds are bounds of the surface data. Returns false if no sample is inside. */
+  bool AddInertialTensorFromMonteCarlo(mafNode* node, const double sums[10], int n_samples, 
+    const double ds_bounds[6]);
  
   
   enum GUI_METHOD_ID
@@ -148,12 +197,6 @@ protected:
     MINID,
   };	
 
-  enum COMPUTATION_METHOD
-  {
-    MONTE_CARLO = 0,
-    GEOMETRY,
-  };	
-  
   double  m_DefaultDensity;                            // Material density
   double  m_Mass;                               // Material mass
   double  m__Principal_I1,m_Principal_I2,m_Principal_I3;  // Principal Inertial Tensor components.
@@ -171,6 +214,7 @@ protected:
   int m_MethodToUse;
   int m_Accuracy;
   int m_Vtkcomp;
+  int m_NumberOfThreads;
 
   vector<pair<mafNode * , double>> m_NodeMassPairVector;
 
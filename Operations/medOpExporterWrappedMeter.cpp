@@ -199,19 +199,37 @@ void medOpExporterWrappedMeter::ExportWrappedMeter()
 	mafVMERoot *root = ((mafVMERoot*)m_Meters[0]->GetRoot());
 	root->GetTimeStamps(m_Times);
 
-	//for(int j=0; j< 10; j++)//for test output format
-	for(int j=0; j< m_Times.size(); j++)
+	std::vector<medVMEComputeWrapping *> meters;
+	for(int i=0;i< m_Meters.size();i++)
 	{
-		m_CurrentTime = m_Times[j];
-		mafEventMacro(mafEvent(this, TIME_SET, m_CurrentTime, 0));
+		medVMEComputeWrapping *meter = medVMEComputeWrapping::SafeDownCast(m_Meters[i]);
+		if(meter && meter->GetWrappedClass()==medVMEComputeWrapping::NEW_METER)
+		{
+			meters.push_back(meter);
+		}
+	}
 
-		for(int i=0;i< m_Meters.size();i++)
+	if(meters.size() == m_Meters.size())
+	{
+		// all the meters are evaluated in one pass over time stamps without updating views
+		ExportWrappedMeterTimeSeries(meters);
+	}
+	else
+	{
+		//for(int j=0; j< 10; j++)//for test output format
+		for(int j=0; j< m_Times.size(); j++)
 		{
-			m_CurrentVme = m_Meters[i];
+			m_CurrentTime = m_Times[j];
+			mafEventMacro(mafEvent(this, TIME_SET, m_CurrentTime, 0));
 
-			if(medVMEComputeWrapping::SafeDownCast(m_CurrentVme))
+			for(int i=0;i< m_Meters.size();i++)
 			{
-				ExportWrappedMeterCoordinates(i,j);
+				m_CurrentVme = m_Meters[i];
+
+				if(medVMEComputeWrapping::SafeDownCast(m_CurrentVme))
+				{
+					ExportWrappedMeterCoordinates(i,j);
+				}
 			}
 		}
 	}
@@ -219,6 +237,34 @@ void medOpExporterWrappedMeter::ExportWrappedMeter()
 	WriteOnFile();
 }
 //----------------------------------------------------------------------------
+void medOpExporterWrappedMeter::ExportWrappedMeterTimeSeries(std::vector<medVMEComputeWrapping *> &meters)
+//----------------------------------------------------------------------------
+{
+	std::vector<medVMEComputeWrapping::TimeSeries> series;
+	medVMEComputeWrapping::EvaluateTimeSeries(meters, m_Times, series);
+
+	const int numberOfColumns = medVMEComputeWrapping::TIME_SERIES_POINTS*3;
+	for(int i=0;i< meters.size();i++)
+	{
+		vnl_matrix<double> M;
+		M.set_size(m_Times.size(), numberOfColumns);
+		if (m_Times.size() != 0)
+		{
+			M.copy_in(&series[i].m_Points[0]);
+		}
+		m_MetersCoordinatesList.push_back(M);
+	}
+
+	// the same order of key point numbers as ExportWrappedMeterCoordinates
+	for(int j=0; j< m_Times.size(); j++)
+	{
+		for(int i=0;i< meters.size();i++)
+		{
+			m_KeyNumList.push_back(series[i].m_NumberOfExportPoints[j]);
+		}
+	}
+}
+//----------------------------------------------------------------------------
 void medOpExporterWrappedMeter::ExportWrappedMeterCoordinates(int index, int indexTime)
 //----------------------------------------------------------------------------
 {
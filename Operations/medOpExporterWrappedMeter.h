@@ -27,6 +27,7 @@
 // forward references :
 //----------------------------------------------------------------------------
 class medVMEWrappedMeter;
+class medVMEComputeWrapping;
 class mafGui;
 class mafEvent;
 //----------------------------------------------------------------------------
@@ -75,6 +76,9 @@ public:
 
   /** specific exporter for wrapped meters */
   void ExportWrappedMeter();
+  /** Export the coordinates of meters at all time stamps computed in one call of
+  medVMEComputeWrapping::EvaluateTimeSeries, the time is not broadcasted to views */
+  void ExportWrappedMeterTimeSeries(std::vector<medVMEComputeWrapping *> &meters);
   /** generic function for handling export*/
   void Export();
   /** write the data stream to a file */
@@ -93,6 +93,9 @@
 #include "vtkImageFlip.h"
 
 #include "vtkMath.h"
+#include "vtkMultiThreader.h"
+#include "vtkMutexLock.h"
+#include "vtkTimerLog.h"
 
 #define round(x) (x<0?ceil((x)-0.5):floor((x)+0.5))
 
@@ -128,6 +131,10 @@
 #include "medDicomCardiacMRIHelper.h"
 #include "vnl/vnl_vector.h"
 #include "time.h"
+#include <fstream>
+#include <deque>
+#include <set>
+#include <algorithm>
 #include "vtkImageReslice.h"
 
 // copied from wx/list.h : needed to make Visual Assist X work correctly 
@@ -170,6 +177,9 @@ mafCxxTypeMacro(medOpImporterDicomOffis);
 //----------------------------------------------------------------------------
 #define FIRST_SELECTION 0
 #define START_PROGRESS_BAR 0
+#define DICOM_BUILD_BATCH_SIZE 32 // slices decoded together by the volume build
+#define DICOM_PREVIEW_CACHE_SIZE 128 // slices loaded by the preview kept in memory
+#define DICOM_PREFETCH_SIZE 8 // slices decoded in background ahead of the shown one
 
 
 enum VOLUME_SIDE
@@ -314,11 +324,29 @@ mafOp(label)
   m_CurrentImageID = 0;
 
   m_SkipAllNoPosition=false;
+
+  m_LastScannedSlice = 0;
+  m_LastScannedTime = 0;
+  m_PreviewCacheSize = DICOM_PREVIEW_CACHE_SIZE;
+  m_PrefetchThreader = NULL;
+  m_PrefetchThreadID = -1;
+  m_PrefetchJob = NULL;
+  m_PreviewCacheHits = 0;
+  m_PreviewPrefetchHits = 0;
+  m_PreviewCacheMisses = 0;
+  m_PreviewDecodeTime = 0;
+
+  m_UseDicomIndex = true;
+  m_DicomIndexFileName = "";
+  m_NumberOfIndexedFiles = 0;
+  m_NumberOfReadFiles = 0;
 }
 //----------------------------------------------------------------------------
 medOpImporterDicomOffis::~medOpImporterDicomOffis()
 //----------------------------------------------------------------------------
 {
+	ReleasePreviewCache();
+
 	vtkDEL(m_SliceActor);
 
 	mafDEL(m_TagArray);
@@ -492,33 +520,7 @@ int medOpImporterDicomOffis::RunWizard()
 					}
 				}
 
-				//rescale to 16 bit all the rest of the dataset
-				if(m_RescaleTo16Bit == TRUE && m_HighBit == 11)
-				{
-					int i=0, size = m_SelectedSeriesSlicesList->size();
-
-					wxBusyInfo *wait = NULL;
-					if(!this->m_TestMode)
-					{
-						wait = new wxBusyInfo("Conversion to Unsigned Short: please wait...");
-						mafEventMacro(mafEvent(this,PROGRESSBAR_SHOW));
-					}
-
-					long progress = 0;
-					for(int slice_num=0;slice_num<size;slice_num++)
-					{
-						RescaleTo16Bit(m_SelectedSeriesSlicesList->Item(slice_num)->GetData()\
-							->GetVTKImageData());
-						if(!this->m_TestMode)
-						{
-							progress = slice_num * 100 / (double)size;
-							mafEventMacro(mafEvent(this,PROGRESSBAR_SET_VALUE,progress));
-						}
-					}
-					mafEventMacro(mafEvent(this,PROGRESSBAR_HIDE));
-					if(wait) delete wait;
-				}
-
+				// slices are rescaled to 16 bit by ReadVolumeSlices while the volume is built
 				if(m_DicomReaderModality != medGUIDicomSettings::ID_CMRI_MODALITY)
 					result = BuildOutputVMEGrayVolumeFromDicom();
 				else
@@ -598,6 +600,8 @@ void medOpImporterDicomOffis::Destroy()
 	if(!this->m_TestMode)
 		m_SeriesListbox->Clear();
 
+	ReleasePreviewCache();
+
 	std::map<std::vector<mafString>,medDicomSeriesSliceList*>::iterator it;
 	for ( it=m_SeriesIDToSlicesListMap.begin() ; it != m_SeriesIDToSlicesListMap.end(); it++ )
 	{
@@ -725,7 +729,17 @@ int medOpImporterDicomOffis::BuildOutputVMEImagesFromDicom()
 	for (count = m_ZCropBounds[0], s_count = 0; count < m_ZCropBounds[1]+1; count += step)
 	{
 		if (s_count == n_slices) {break;}
-		GenerateSliceTexture(count);
+		if (!GenerateSliceTexture(count))
+		{
+			// the pixels of the slice can not be decoded
+			m_ImagesGroup->ReparentTo(NULL);
+			mafDEL(m_ImagesGroup);
+			if(!this->m_TestMode)
+			{
+				mafEventMacro(mafEvent(this,PROGRESSBAR_HIDE));
+			}
+			return OP_RUN_CANCEL;
+		}
 
 		double spacing[3];
 		vtkMAFSmartPointer<vtkImageData> im;
@@ -892,7 +906,17 @@ int medOpImporterDicomOffis::BuildOutputVMEImagesFromDicomCineMRI()
 			if (currImageId != -1) 
 			{
 				// update v_texture ivar
-				GenerateSliceTexture(currImageId);
+				if (!GenerateSliceTexture(currImageId))
+				{
+					// the pixels of the slice can not be decoded
+					m_ImagesGroup->ReparentTo(NULL);
+					mafDEL(m_ImagesGroup);
+					if(!this->m_TestMode)
+					{
+						mafEventMacro(mafEvent(this,PROGRESSBAR_HIDE));
+					}
+					return OP_RUN_CANCEL;
+				}
 			}
 
 			double spacing[3];
@@ -943,7 +967,20 @@ int medOpImporterDicomOffis::BuildOutputVMEImagesFromDicomCineMRI()
 
 				double sliceVtkDataCenter[3] = {-999, -999, -999};
 
-				slice->GetVTKImageData()->GetCenter(sliceVtkDataCenter);
+				vtkImageData *sliceImageData = slice->GetVTKImageData();
+				if (sliceImageData == NULL)
+				{
+					// the pixels of the slice can not be decoded
+					sliceOrientationMatrix->Delete();
+					m_ImagesGroup->ReparentTo(NULL);
+					mafDEL(m_ImagesGroup);
+					if(!this->m_TestMode)
+					{
+						mafEventMacro(mafEvent(this,PROGRESSBAR_HIDE));
+					}
+					return OP_RUN_CANCEL;
+				}
+				sliceImageData->GetCenter(sliceVtkDataCenter);
 
 				vtkTransform *tr = vtkTransform::New();
 				tr->PostMultiply();
@@ -1069,6 +1106,14 @@ int medOpImporterDicomOffis::BuildOutputVMEGrayVolumeFromDicom()
 
         int dim[3];
         vtkImageData *image = m_SelectedSeriesSlicesList->Item(count)->GetData()->GetVTKImageData();
+        if (image == NULL)
+        {
+          // the pixels of the slice can not be decoded
+          mafLogMessage("SLICE SKIPPED: %d",m_SelectedSeriesSlicesList->Item(count)->GetData()->GetDcmInstanceNumber());
+          numSliceToSkip++;
+          sliceToSkip[count] = true;
+          continue;
+        }
         image->Update();
         image->GetDimensions(dim);
 
@@ -1091,6 +1136,14 @@ int medOpImporterDicomOffis::BuildOutputVMEGrayVolumeFromDicom()
         m_SelectedSeriesSlicesList->Item(count)->GetData()->GetDcmImageOrientationPatient(cosinDirectorToCheck);
 
         vtkImageData *image = m_SelectedSeriesSlicesList->Item(count)->GetData()->GetVTKImageData();
+        if (image == NULL)
+        {
+          // the pixels of the slice can not be decoded: the next slice is checked
+          mafLogMessage("SLICE SKIPPED: %d",m_SelectedSeriesSlicesList->Item(count)->GetData()->GetDcmInstanceNumber());
+          numSliceToSkip++;
+          sliceToSkip[count] = true;
+          continue;
+        }
         image->Update();
         image->GetDimensions(dimensionsToCheck);
         
@@ -1113,78 +1166,97 @@ int medOpImporterDicomOffis::BuildOutputVMEGrayVolumeFromDicom()
   double oldPosTrasformed = -1.0;
   double oldOrigin[3];
 
-	long progress = 0;
-	for (count = m_ZCropBounds[0], s_count = 0; count < m_ZCropBounds[1]+1; count += step)
+	// slices out of the Z crop are never read
+	std::vector<int> sliceIDs;
+	for (count = m_ZCropBounds[0]; count < m_ZCropBounds[1]+1 && sliceIDs.size() < n_slices; count += step)
 	{
-    if (sliceToSkip[count-m_ZCropBounds[0]])
-    {
-      break;
-    }
+		if (sliceToSkip[count-m_ZCropBounds[0]])
+		{
+			break;
+		}
+		sliceIDs.push_back(count);
+	}
 
-		if (s_count == n_slices) {break;}
-		GenerateSliceTexture(count);
+	// slices are read in batches and released once accumulated, so that the read slices are never all in memory
+	long progress = 0;
+	bool readError = false;
+	s_count = 0;
+	for (int first = 0; first < sliceIDs.size(); first += DICOM_BUILD_BATCH_SIZE)
+	{
+		int last = first + DICOM_BUILD_BATCH_SIZE < sliceIDs.size() ? first + DICOM_BUILD_BATCH_SIZE : sliceIDs.size();
+		std::vector<int> batchIDs(sliceIDs.begin() + first, sliceIDs.begin() + last);
+		std::vector<vtkImageData *> images;
+		if (!ReadVolumeSlices(batchIDs, images))
+		{
+			readError = true;
+			break;
+		}
 
-    if (applyCorrectionToRotateZcoordinate)
-    {
-      if (s_count != 0)
-      {
-        double originSlice[3];
-        m_SelectedSeriesSlicesList->Item(count)->GetData()->GetDcmImagePositionPatientOriginal(originSlice);
+		for (int b = 0; b < batchIDs.size(); b++)
+		{
+			count = batchIDs[b];
+			vtkImageData *im = images[b];
 
-        vtkImageData *im = m_SliceTexture->GetInput();
-        im->Update();
+			if (applyCorrectionToRotateZcoordinate)
+			{
+				if (s_count != 0)
+				{
+					double originSlice[3];
+					m_SelectedSeriesSlicesList->Item(count)->GetData()->GetDcmImagePositionPatientOriginal(originSlice);
 
-        double originTexture[3];
-        im->GetOrigin(originTexture);
+					double originTexture[3];
+					im->GetOrigin(originTexture);
 
-        double newPosTransformed;
+					double newPosTransformed;
 
-        double spacing = sqrt(vtkMath::Distance2BetweenPoints(originSlice,oldOrigin));
+					double spacing = sqrt(vtkMath::Distance2BetweenPoints(originSlice,oldOrigin));
 
-        mafLogMessage("SPACING: %3f",spacing);
+					mafLogMessage("SPACING: %3f",spacing);
 
-        if (oldOrigin[m_SortAxes] < originSlice[m_SortAxes])
-        {
-          newPosTransformed = oldPosTrasformed + spacing;
-        }
-        else
-        {
-          newPosTransformed = oldPosTrasformed - spacing;
-        }
+					if (oldOrigin[m_SortAxes] < originSlice[m_SortAxes])
+					{
+						newPosTransformed = oldPosTrasformed + spacing;
+					}
+					else
+					{
+						newPosTransformed = oldPosTrasformed - spacing;
+					}
 
-        oldPosTrasformed = newPosTransformed;
+					oldPosTrasformed = newPosTransformed;
 
-        for (int i=0;i<3;++i)
-        {
-          oldOrigin[i] = originSlice[i];
-        }
+					for (int i=0;i<3;++i)
+					{
+						oldOrigin[i] = originSlice[i];
+					}
 
-        originTexture[m_SortAxes] = newPosTransformed;
+					originTexture[m_SortAxes] = newPosTransformed;
 
-        im->SetOrigin(originTexture);
-        im->Update();
-      }
-      else
-      {
-        double originSlice[3];
-        m_SelectedSeriesSlicesList->Item(count)->GetData()->GetDcmImagePositionPatientOriginal(originSlice);
+					im->SetOrigin(originTexture);
+					im->Update();
+				}
+				else
+				{
+					double originSlice[3];
+					m_SelectedSeriesSlicesList->Item(count)->GetData()->GetDcmImagePositionPatientOriginal(originSlice);
 
-        oldPosTrasformed = originSlice[m_SortAxes];
+					oldPosTrasformed = originSlice[m_SortAxes];
 
-        for (int i=0;i<3;++i)
-        {
-          oldOrigin[i] = originSlice[i];
-        }
-      }
-    }
+					for (int i=0;i<3;++i)
+					{
+						oldOrigin[i] = originSlice[i];
+					}
+				}
+			}
 
-		accumulate->SetSlice(s_count,m_SliceTexture->GetInput());
-		s_count++;
+			accumulate->SetSlice(s_count,im);
+			s_count++;
+			vtkDEL(images[b]);
 
-		if(!this->m_TestMode)
-		{
-			progress = count * 100 / m_DICOMDirectoryReader->GetNumberOfFiles();
-			mafEventMacro(mafEvent(this,PROGRESSBAR_SET_VALUE,progress));
+			if(!this->m_TestMode)
+			{
+				progress = count * 100 / m_DICOMDirectoryReader->GetNumberOfFiles();
+				mafEventMacro(mafEvent(this,PROGRESSBAR_SET_VALUE,progress));
+			}
 		}
 	}
 
@@ -1195,6 +1267,11 @@ int medOpImporterDicomOffis::BuildOutputVMEGrayVolumeFromDicom()
 		mafEventMacro(mafEvent(this,PROGRESSBAR_HIDE));
 	}
 
+	if (readError)
+	{
+		return OP_RUN_CANCEL;
+	}
+
 	mafNEW(m_Volume);
 
 	accumulate->Update();
@@ -1399,10 +1476,20 @@ int medOpImporterDicomOffis::BuildOutputVMEGrayVolumeFromDicomCineMRI()
             }
           }
           
-          int dim[3];
+          int dim[3] = {0, 0, 0};
           vtkImageData *image = m_SelectedSeriesSlicesList->Item(currImageId)->GetData()->GetVTKImageData();
-          image->Update();
-          image->GetDimensions(dim);
+          if (image == NULL && !sliceToSkip[sourceVolumeSliceId])
+          {
+            // the pixels of the slice can not be decoded
+            mafLogMessage("SLICE SKIPPED: %d",m_SelectedSeriesSlicesList->Item(currImageId)->GetData()->GetDcmInstanceNumber());
+            numSliceToSkip++;
+            sliceToSkip[sourceVolumeSliceId] = true;
+          }
+          else if (image != NULL)
+          {
+            image->Update();
+            image->GetDimensions(dim);
+          }
 
           if (!sliceToSkip[sourceVolumeSliceId])
           {
@@ -1426,10 +1513,22 @@ int medOpImporterDicomOffis::BuildOutputVMEGrayVolumeFromDicomCineMRI()
           m_SelectedSeriesSlicesList->Item(currImageId)->GetData()->GetDcmImageOrientationPatient(cosinDirectorToCheck);
           
           vtkImageData *image = m_SelectedSeriesSlicesList->Item(currImageId)->GetData()->GetVTKImageData();
-          image->Update();
-          image->GetDimensions(dimensionsToCheck);
-
-          storedFirstCosinDirector = true;
+          if (image == NULL)
+          {
+            // the pixels of the slice can not be decoded: the next slice is checked
+            if (!sliceToSkip[sourceVolumeSliceId])
+            {
+              mafLogMessage("SLICE SKIPPED: %d",m_SelectedSeriesSlicesList->Item(currImageId)->GetData()->GetDcmInstanceNumber());
+              numSliceToSkip++;
+              sliceToSkip[sourceVolumeSliceId] = true;
+            }
+          }
+          else
+          {
+            image->Update();
+            image->GetDimensions(dimensionsToCheck);
+            storedFirstCosinDirector = true;
+          }
         }
 
         targetVolumeSliceId++;
@@ -1476,24 +1575,77 @@ int medOpImporterDicomOffis::BuildOutputVMEGrayVolumeFromDicomCineMRI()
     double oldPosTrasformed = -1.0;
     double oldOrigin[3];
 
-		for (int sourceVolumeSliceId = m_ZCropBounds[0], targetVolumeSliceId = 0; sourceVolumeSliceId < m_ZCropBounds[1]+1; sourceVolumeSliceId += step)
+		// slices of the time frame: slices out of the Z crop are never read
+		std::vector<int> frameImageIDs;
+		int missingFirstSlices = 0;
+		for (int sourceVolumeSliceId = m_ZCropBounds[0]; sourceVolumeSliceId < m_ZCropBounds[1]+1 && frameImageIDs.size() + missingFirstSlices < n_slices; sourceVolumeSliceId += step)
 		{
-			if(!this->m_TestMode)
+			currImageId = GetSliceIDInSeries(ts, probeHeigthId);
+			if (currImageId == -1)
 			{
-				progress = progressCounter * 100 / totalNumberOfImages;
-				mafEventMacro(mafEvent(this,PROGRESSBAR_SET_VALUE,progress));
+				if (frameImageIDs.empty())
+				{
+					// missing first slices are replaced by the first slice found
+					missingFirstSlices++;
+				}
+				else
+				{
+					// missing slices are replaced by the previous one
+					frameImageIDs.push_back(frameImageIDs.back());
+				}
 			}
-			if (targetVolumeSliceId == n_slices) {break;}
+			else
+			{
+				frameImageIDs.insert(frameImageIDs.end(), missingFirstSlices + 1, currImageId);
+				missingFirstSlices = 0;
+			}
+			probeHeigthId++;
+		}
 
-			// show the current slice
-			currImageId = GetSliceIDInSeries(ts, probeHeigthId);
+		// slices of the frame are sorted by Z before being accumulated, so the whole frame is kept in memory,
+		// but files are decoded in batches as by the volume build
+		bool readError = frameImageIDs.empty();
+		for (int first = 0; first < frameImageIDs.size() && !readError; first += DICOM_BUILD_BATCH_SIZE)
+		{
+			int last = first + DICOM_BUILD_BATCH_SIZE < frameImageIDs.size() ? first + DICOM_BUILD_BATCH_SIZE : frameImageIDs.size();
+			std::vector<int> batchIDs(frameImageIDs.begin() + first, frameImageIDs.begin() + last);
+			std::vector<vtkImageData *> images;
+			if (ReadVolumeSlices(batchIDs, images))
+			{
+				imageDataVector.insert(imageDataVector.end(), images.begin(), images.end());
+			}
+			else
+			{
+				readError = true;
+			}
+		}
 
-			if (currImageId != -1) 
+		if (readError)
+		{
+			for (int i = 0; i < imageDataVector.size(); i++)
 			{
-				// update v_texture ivar
-				GenerateSliceTexture(currImageId);
+				vtkDEL(imageDataVector[i]);
+			}
+			delete []sliceToSkip;
+			mafDEL(m_Volume);
+			if(!this->m_TestMode)
+			{
+				mafEventMacro(mafEvent(this,PROGRESSBAR_HIDE));
+			}
+			return OP_RUN_CANCEL;
+		}
+
+		for (int targetVolumeSliceId = 0; targetVolumeSliceId < frameImageIDs.size(); targetVolumeSliceId++)
+		{
+			if(!this->m_TestMode)
+			{
+				progress = progressCounter * 100 / totalNumberOfImages;
+				mafEventMacro(mafEvent(this,PROGRESSBAR_SET_VALUE,progress));
 			}
 
+			currImageId = frameImageIDs[targetVolumeSliceId];
+			vtkImageData *imageData = imageDataVector[targetVolumeSliceId];
+
       if (applyCorrectionToRotateZcoordinate)
       {
 	      if (targetVolumeSliceId != 0)
@@ -1501,11 +1653,8 @@ int medOpImporterDicomOffis::BuildOutputVMEGrayVolumeFromDicomCineMRI()
 	        double originSlice[3];
 	        m_SelectedSeriesSlicesList->Item(currImageId)->GetData()->GetDcmImagePositionPatientOriginal(originSlice);
 	
-	        vtkImageData *im = m_SliceTexture->GetInput();
-	        im->Update();
-	
 	        double originTexture[3];
-	        im->GetOrigin(originTexture);
+	        imageData->GetOrigin(originTexture);
 	
 	        double newPosTransformed;
 	
@@ -1533,8 +1682,8 @@ int medOpImporterDicomOffis::BuildOutputVMEGrayVolumeFromDicomCineMRI()
 	
 	        originTexture[m_SortAxes] = newPosTransformed;
 	
-	        im->SetOrigin(originTexture);
-	        im->Update();
+	        imageData->SetOrigin(originTexture);
+	        imageData->Update();
 	      }
 	      else
 	      {
@@ -1550,14 +1699,6 @@ int medOpImporterDicomOffis::BuildOutputVMEGrayVolumeFromDicomCineMRI()
 	      }
       }
 
-			vtkImageData *imageData = NULL;
-			imageData = m_SliceTexture->GetInput();
-			assert(imageData);
-
-			vtkImageData *bufferImageData = vtkImageData::New();
-			bufferImageData->DeepCopy(imageData);
-			imageDataVector.push_back(bufferImageData);
-
 			std::ostringstream stringStream;
 
 			double spacing[3] = {0,0,0};
@@ -1570,7 +1711,7 @@ int medOpImporterDicomOffis::BuildOutputVMEGrayVolumeFromDicomCineMRI()
 			imageData->GetOrigin(origin);
 
 			stringStream <<  "ts: " << ts << \
-				"  probeHeightId: " << probeHeigthId<< \
+				"  probeHeightId: " << targetVolumeSliceId << \
 				"  currImageId: " << currImageId << \
 				"  origin: " << origin[0] << " " << origin[1] << " " << origin[2] << " " <<\
 				"  spacing: " << spacing[0]<< " " << spacing[1] << " " << spacing[2]<< " "
@@ -1578,10 +1719,7 @@ int medOpImporterDicomOffis::BuildOutputVMEGrayVolumeFromDicomCineMRI()
 
 			mafLogMessage(stringStream.str().c_str());
 
-			targetVolumeSliceId++;
 			progressCounter++;
-			probeHeigthId++;
-
 		}
 
 		std::map<double , int> zToIDMap;
@@ -1598,11 +1736,8 @@ int medOpImporterDicomOffis::BuildOutputVMEGrayVolumeFromDicomCineMRI()
 		// Build item at timestamp ts    
 		vtkMAFSmartPointer<vtkMAFRGSliceAccumulate> accumulator;
 
-		// always build the volume on z-axis
-		accumulator->BuildVolumeOnAxes(m_SortAxes);
-		accumulator->SetNumberOfSlices(m_NumberOfSlices - numSliceToSkip);
-
-		int i = 0;
+		// slices replacing a missing one have the same Z and are accumulated once
+		std::vector<vtkImageData *> sortedImages;
     int j = 0;
 
 		for( map<double,int>::iterator currentMapElement=zToIDMap.begin(); currentMapElement!=zToIDMap.end(); ++currentMapElement,++j)
@@ -1611,10 +1746,16 @@ int medOpImporterDicomOffis::BuildOutputVMEGrayVolumeFromDicomCineMRI()
       {
         break;
       }
-			double id = currentMapElement->second;
-			double z = currentMapElement->first;
-			accumulator->SetSlice(i, imageDataVector[currentMapElement->second]);
-			i++;
+			sortedImages.push_back(imageDataVector[currentMapElement->second]);
+		}
+
+		// always build the volume on z-axis
+		accumulator->BuildVolumeOnAxes(m_SortAxes);
+		accumulator->SetNumberOfSlices(sortedImages.size());
+
+		for (int i = 0; i < sortedImages.size(); i++)
+		{
+			accumulator->SetSlice(i, sortedImages[i]);
 		}
 
 		accumulator->Update();
@@ -2749,9 +2890,13 @@ void medOpImporterDicomOffis::Crop()
   m_ReferenceSystemPage->GetRWI()->CameraUpdate();
 
 	//Modify name
-	double spacing[3];
+	double spacing[3] = {1.0, 1.0, 1.0};
 	int cropInterval = (m_ZCropBounds[1]+1 - m_ZCropBounds[0]);
-	m_SelectedSeriesSlicesList->Item(currImageId)->GetData()->GetVTKImageData()->GetSpacing(spacing);
+	vtkImageData *currImageData = m_SelectedSeriesSlicesList->Item(currImageId)->GetData()->GetVTKImageData();
+	if (currImageData)
+	{
+		currImageData->GetSpacing(spacing);
+	}
 
 	double pixelDimX = diffx/spacing[0] + 1;
 	double pixelDimY = diffy/spacing[0] + 1;
@@ -2814,8 +2959,14 @@ void medOpImporterDicomOffis::AutoPositionCropPlane()
 {
 	int currImageId = GetSliceIDInSeries(m_CurrentTime, m_CurrentSlice);
 
-	m_SelectedSeriesSlicesList->Item(currImageId)->GetData()->GetVTKImageData()->Update();
-	m_SelectedSeriesSlicesList->Item(currImageId)->GetData()->GetVTKImageData()->GetBounds(m_SliceBounds);
+	vtkImageData *currImageData = m_SelectedSeriesSlicesList->Item(currImageId)->GetData()->GetVTKImageData();
+	if (currImageData == NULL)
+	{
+		// the pixels of the slice can not be decoded: the crop plane is not moved
+		return;
+	}
+	currImageData->Update();
+	currImageData->GetBounds(m_SliceBounds);
 
 	double diffY,diffX;
 	diffY=m_SliceBounds[3]-m_SliceBounds[2];
@@ -3059,156 +3210,1268 @@ void medOpImporterDicomOffis::FillSeriesListBox()
 }
 
 //----------------------------------------------------------------------------
-bool medOpImporterDicomOffis::BuildDicomFileList(const char *dicomDirABSPath)
+// Directory scan
 //----------------------------------------------------------------------------
-{   
+#define DICOM_INDEX_EXTENSION ".dicomindex"
+#define DICOM_INDEX_HEADER "MED_DICOM_INDEX 2"
+#define DICOM_INDEX_FIELDS 37
+#define DICOM_SCAN_BATCH_SIZE 256
 
-  int seriesIndex = 0;
-	long progress;
-	int sliceNum = -1;
-	double lastZPos = 0;
-	long int dcmInstanceNumber = -1;
-	long int dcmCardiacNumberOfImages = -1;
-	double dcmTriggerTime = -1.0;
-	double dcmImageOrientationPatient[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
-	double dcmImagePositionPatient[3] = {0.0,0.0,0.0};
-	bool enableToRead = true; //true for test mode
-	bool errorOccurred = false;
-	double lastDistance = 0;
-	mafString lastFileName = "";
+/** Status of a file of the scanned directory */
+enum DICOM_SCAN_STATUS
+{
+	DICOM_SCAN_NOT_READ = 0,
+	DICOM_SCAN_OK,
+	DICOM_SCAN_ERROR,
+	DICOM_SCAN_NO_PIXELS,   // no pixel data or pixel data that can not be decoded
+};
 
-	double percentageTolerance = 0;
-	double scalarTolerance = 0;
-	bool enableScalarTolerance = false;
-	bool enablePercentageTolerance = false;
+/** Tags of a file of the scanned directory used to build the series */
+typedef struct DICOM_SCAN_ENTRY
+{
+	std::string FileName; // local file name
+	long FileSize;
+	long FileTime;
+	int Status;
+	int Columns;
+	int Rows;
+	int HasPosition;
+	double Position[3];
+	double Orientation[6];
+	double PixelSpacing[2];
+	double RescaleSlope;
+	double RescaleIntercept;
+	long HighBit;
+	long PixelRepresentation;
+	long BitsAllocated;
+	long SmallestPixelValue;
+	long LargestPixelValue;
+	long InstanceNumber;
+	long CardiacNumberOfImages;
+	double TriggerTime;
+	std::string ScanOptions;
+	std::string Modality;
+	std::string PatientPosition;
+	std::string StudyInstanceUID;
+	std::string SeriesInstanceUID;
+	std::string PatientBirthDate;
+	std::string StudyDate;
+	std::string SeriesDescription;
+	std::string PatientName;
+} DICOM_SCAN_ENTRY;
+
+/** Files of the scanned directory to read */
+typedef struct DICOM_SCAN_JOB
+{
+	std::string DirectoryName;
+	std::vector<DICOM_SCAN_ENTRY> *Entries;
+	std::vector<int> *EntriesToRead; // indexes in Entries
+	int First;                       // range of EntriesToRead read by the threads
+	int Last;
+} DICOM_SCAN_JOB;
 
-	if(!this->m_TestMode)
+//----------------------------------------------------------------------------
+static void DS_ResetEntry(DICOM_SCAN_ENTRY &entry)
+//----------------------------------------------------------------------------
+{
+	entry.FileSize = -1;
+	entry.FileTime = -1;
+	entry.Status = DICOM_SCAN_NOT_READ;
+	entry.Columns = entry.Rows = 0;
+	entry.HasPosition = 0;
+	entry.Position[0] = entry.Position[1] = entry.Position[2] = 0.0;
+	for (int k = 0; k < 6; k++)
 	{
-		enableScalarTolerance = ((medGUIDicomSettings*)GetSetting())->EnableScalarTolerance() != FALSE;
-		enablePercentageTolerance = ((medGUIDicomSettings*)GetSetting())->EnablePercentageTolerance() != FALSE;
-
-		if (enableScalarTolerance)
-			scalarTolerance = ((medGUIDicomSettings*)GetSetting())->GetScalarTolerance();
-
-		if (enablePercentageTolerance)
-			percentageTolerance = ((medGUIDicomSettings*)GetSetting())->GetPercentageTolerance();
+		entry.Orientation[k] = 0.0;
 	}
+	entry.PixelSpacing[0] = entry.PixelSpacing[1] = 1.0;
+	entry.RescaleSlope = 1.0;
+	entry.RescaleIntercept = 0.0;
+	entry.HighBit = entry.PixelRepresentation = entry.BitsAllocated = 0;
+	entry.SmallestPixelValue = entry.LargestPixelValue = 0;
+	entry.InstanceNumber = entry.CardiacNumberOfImages = -1;
+	entry.TriggerTime = -1.0;
+}
 
-	m_DicomReaderModality = -1;
-	DcmFileFormat dicomImg;    
+//----------------------------------------------------------------------------
+static std::string DS_GetString(DcmDataset *dataset, const DcmTagKey &tag)
+//----------------------------------------------------------------------------
+{
+	const char *value = NULL;
+	dataset->findAndGetString(tag, value);
+	return value ? value : "";
+}
 
-	if (m_DICOMDirectoryReader->Open(dicomDirABSPath) == 0)
+//----------------------------------------------------------------------------
+// Returns true if the pixel data of the transfer syntax can be decoded by the codecs of DV_RegisterCodecs
+static bool DS_IsDecodable(E_TransferSyntax transferSyntax)
+//----------------------------------------------------------------------------
+{
+	if (!DcmXfer(transferSyntax).isEncapsulated())
 	{
-		if(!this->m_TestMode)
-		{
-			wxMessageBox(wxString::Format("Directory <%s> can not be opened",dicomDirABSPath),"Warning!!");
-		}
-		return false;
+		return true;
 	}
-
-	if (!this->m_TestMode)
+	switch (transferSyntax)
 	{
-		mafEventMacro(mafEvent(this,PROGRESSBAR_SHOW));
-		progress = START_PROGRESS_BAR;
+		case EXS_JPEGProcess1TransferSyntax:
+		case EXS_JPEGProcess2_4TransferSyntax:
+		case EXS_JPEGProcess6_8TransferSyntax:
+		case EXS_JPEGProcess10_12TransferSyntax:
+		case EXS_JPEGProcess14TransferSyntax:
+		case EXS_JPEGProcess14SV1TransferSyntax:
+		case EXS_RLELossless:
+			return true;
+		default:
+			return false;
 	}
+}
 
-	int i = -1;
-
-	time_t start,end;
+//----------------------------------------------------------------------------
+// Reads the tags of the file, the pixel data is not loaded. Files without pixel data
+// that can be decoded are not slices, so the pixels of the slices can be read later.
+static void DS_ReadTags(const char *fileName, DICOM_SCAN_ENTRY &entry)
+//----------------------------------------------------------------------------
+{
+	DcmFileFormat dicomImg;
+	// values longer than DCM_MaxReadLength, as the pixel data, are skipped and loaded only on access
+	OFCondition status = dicomImg.loadFile(fileName, EXS_Unknown, EGL_noChange, DCM_MaxReadLength);
+	if (!status.good())
+	{
+		entry.Status = DICOM_SCAN_ERROR;
+		return;
+	}
 
-	wxBusyInfo *busyInfo = NULL;
+	DcmDataset *dicomDataset = dicomImg.getDataset();
+	if (!dicomDataset->tagExists(DCM_PixelData) || !DS_IsDecodable(dicomDataset->getOriginalXfer()))
+	{
+		entry.Status = DICOM_SCAN_NO_PIXELS;
+		return;
+	}
+	entry.Status = DICOM_SCAN_OK;
+
+	long value;
+	if (dicomDataset->findAndGetLongInt(DCM_Columns, value).good())
+		entry.Columns = value;
+	if (dicomDataset->findAndGetLongInt(DCM_Rows, value).good())
+		entry.Rows = value;
+
+	entry.HasPosition = dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient, entry.Position[0], 0).good();
+	dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient, entry.Position[1], 1);
+	dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient, entry.Position[2], 2);
+	for (int k = 0; k < 6; k++)
+	{
+		dicomDataset->findAndGetFloat64(DCM_ImageOrientationPatient, entry.Orientation[k], k);
+	}
+	if (dicomDataset->findAndGetFloat64(DCM_PixelSpacing, entry.PixelSpacing[0], 0).bad())
+		entry.PixelSpacing[0] = 1.0;
+	if (dicomDataset->findAndGetFloat64(DCM_PixelSpacing, entry.PixelSpacing[1], 1).bad())
+		entry.PixelSpacing[1] = 1.0;
+	if (dicomDataset->findAndGetFloat64(DCM_RescaleSlope, entry.RescaleSlope).bad())
+		entry.RescaleSlope = 1.0;
+	if (dicomDataset->findAndGetFloat64(DCM_RescaleIntercept, entry.RescaleIntercept).bad())
+		entry.RescaleIntercept = 0.0;
+
+	dicomDataset->findAndGetLongInt(DCM_HighBit, entry.HighBit);
+	dicomDataset->findAndGetLongInt(DCM_PixelRepresentation, entry.PixelRepresentation);
+	dicomDataset->findAndGetLongInt(DCM_BitsAllocated, entry.BitsAllocated);
+	dicomDataset->findAndGetLongInt(DCM_SmallestImagePixelValue, entry.SmallestPixelValue);
+	dicomDataset->findAndGetLongInt(DCM_LargestImagePixelValue, entry.LargestPixelValue);
+	dicomDataset->findAndGetLongInt(DCM_InstanceNumber, entry.InstanceNumber);
+	dicomDataset->findAndGetLongInt(DCM_CardiacNumberOfImages, entry.CardiacNumberOfImages);
+	dicomDataset->findAndGetFloat64(DCM_TriggerTime, entry.TriggerTime);
+
+	entry.ScanOptions = DS_GetString(dicomDataset, DCM_ScanOptions);
+	entry.Modality = DS_GetString(dicomDataset, DCM_Modality);
+	entry.PatientPosition = DS_GetString(dicomDataset, DCM_PatientPosition);
+	entry.StudyInstanceUID = DS_GetString(dicomDataset, DCM_StudyInstanceUID);
+	entry.SeriesInstanceUID = DS_GetString(dicomDataset, DCM_SeriesInstanceUID);
+	entry.PatientBirthDate = DS_GetString(dicomDataset, DCM_PatientsBirthDate);
+	entry.StudyDate = DS_GetString(dicomDataset, DCM_StudyDate);
+	entry.SeriesDescription = DS_GetString(dicomDataset, DCM_SeriesDescription);
+	entry.PatientName = DS_GetString(dicomDataset, DCM_PatientsName);
+}
 
-	wxString busyMessage = "Reading DICOM directory: please wait";
+//----------------------------------------------------------------------------
+// Thread function of BuildDicomFileList
+static VTK_THREAD_RETURN_TYPE DS_ReadTagsThread(void *arg)
+//----------------------------------------------------------------------------
+{
+	vtkMultiThreader::ThreadInfo *info = (vtkMultiThreader::ThreadInfo *)arg;
+	DICOM_SCAN_JOB *job = (DICOM_SCAN_JOB *)info->UserData;
 
-	if (!m_TestMode)
+	for (int i = job->First + info->ThreadID; i < job->Last; i += info->NumberOfThreads)
 	{
-		busyInfo = new wxBusyInfo(busyMessage);
+		DICOM_SCAN_ENTRY &entry = (*job->Entries)[(*job->EntriesToRead)[i]];
+		std::string fileName = job->DirectoryName + "\\" + entry.FileName;
+		DS_ReadTags(fileName.c_str(), entry);
 	}
 
-	// foreach dicom directory file
-  int img_pos_result = wxNO; // added by Losi to avoid exiting series without image position
-	for (i=0; i < m_DICOMDirectoryReader->GetNumberOfFiles(); i++)
+	return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+// Returns the VTK scalar type of the slice, -1 if the rescaled values do not fit 16 bits
+static int DS_GetScalarType(long bitsAllocated, long pixelRepresentation, long smallestPixelValue, long largestPixelValue, double rescaleSlope, double rescaleIntercept)
+//----------------------------------------------------------------------------
+{
+	double minValue = smallestPixelValue*rescaleSlope+rescaleIntercept;
+	double maxValue = largestPixelValue*rescaleSlope+rescaleIntercept;
+	if(bitsAllocated==16 && pixelRepresentation == 0)
+	{
+		if(minValue >= VTK_UNSIGNED_SHORT_MIN && maxValue <= VTK_UNSIGNED_SHORT_MAX)
+			return VTK_UNSIGNED_SHORT;
+		else if (minValue >= VTK_SHORT_MIN && maxValue <= VTK_SHORT_MAX)
+			return VTK_SHORT;
+		return -1;
+	}
+	else if(bitsAllocated==16 && pixelRepresentation == 1)
+	{
+		if (minValue >= VTK_SHORT_MIN && maxValue <= VTK_SHORT_MAX)
+			return VTK_SHORT;
+		return -1;
+	}
+	else if(bitsAllocated==8)
+	{
+		return VTK_CHAR;
+	}
+	return VTK_DOUBLE;
+}
+
+//----------------------------------------------------------------------------
+// Replaces the separators of the index in the string
+static std::string DS_IndexString(const std::string &value)
+//----------------------------------------------------------------------------
+{
+	std::string result = value;
+	for (size_t i = 0; i < result.size(); i++)
+	{
+		if (result[i] == '\t' || result[i] == '\n' || result[i] == '\r')
+			result[i] = ' ';
+	}
+	return result;
+}
+
+//----------------------------------------------------------------------------
+// Reads the entries of the index file, indexed by local file name
+static void DS_ReadIndex(const char *indexFileName, std::map<std::string,DICOM_SCAN_ENTRY> &index)
+//----------------------------------------------------------------------------
+{
+	std::ifstream file(indexFileName);
+	std::string line;
+	if (!std::getline(file, line) || line != DICOM_INDEX_HEADER)
+	{
+		return;
+	}
+
+	while (std::getline(file, line))
+	{
+		std::vector<std::string> fields;
+		size_t start = 0, end;
+		while ((end = line.find('\t', start)) != std::string::npos)
+		{
+			fields.push_back(line.substr(start, end - start));
+			start = end + 1;
+		}
+		fields.push_back(line.substr(start));
+		if (fields.size() != DICOM_INDEX_FIELDS)
+		{
+			continue;
+		}
+
+		DICOM_SCAN_ENTRY entry;
+		int f = 0, k;
+		entry.FileName = fields[f++];
+		entry.FileSize = atol(fields[f++].c_str());
+		entry.FileTime = atol(fields[f++].c_str());
+		entry.Status = atoi(fields[f++].c_str());
+		entry.Columns = atoi(fields[f++].c_str());
+		entry.Rows = atoi(fields[f++].c_str());
+		entry.HasPosition = atoi(fields[f++].c_str());
+		for (k = 0; k < 3; k++)
+			entry.Position[k] = atof(fields[f++].c_str());
+		for (k = 0; k < 6; k++)
+			entry.Orientation[k] = atof(fields[f++].c_str());
+		for (k = 0; k < 2; k++)
+			entry.PixelSpacing[k] = atof(fields[f++].c_str());
+		entry.RescaleSlope = atof(fields[f++].c_str());
+		entry.RescaleIntercept = atof(fields[f++].c_str());
+		entry.HighBit = atol(fields[f++].c_str());
+		entry.PixelRepresentation = atol(fields[f++].c_str());
+		entry.BitsAllocated = atol(fields[f++].c_str());
+		entry.SmallestPixelValue = atol(fields[f++].c_str());
+		entry.LargestPixelValue = atol(fields[f++].c_str());
+		entry.InstanceNumber = atol(fields[f++].c_str());
+		entry.CardiacNumberOfImages = atol(fields[f++].c_str());
+		entry.TriggerTime = atof(fields[f++].c_str());
+		entry.ScanOptions = fields[f++];
+		entry.Modality = fields[f++];
+		entry.PatientPosition = fields[f++];
+		entry.StudyInstanceUID = fields[f++];
+		entry.SeriesInstanceUID = fields[f++];
+		entry.PatientBirthDate = fields[f++];
+		entry.StudyDate = fields[f++];
+		entry.SeriesDescription = fields[f++];
+		entry.PatientName = fields[f++];
+		index[entry.FileName] = entry;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Writes the entries in the index file; the index is not written if the file can not be created
+static void DS_WriteIndex(const char *indexFileName, const std::vector<DICOM_SCAN_ENTRY> &entries)
+//----------------------------------------------------------------------------
+{
+	FILE *file = fopen(indexFileName, "w");
+	if (file == NULL)
+	{
+		return;
+	}
+
+	fprintf(file, "%s\n", DICOM_INDEX_HEADER);
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const DICOM_SCAN_ENTRY &entry = entries[i];
+		int k;
+		fprintf(file, "%s\t%ld\t%ld\t%d\t%d\t%d\t%d", DS_IndexString(entry.FileName).c_str(), entry.FileSize, entry.FileTime, \
+			entry.Status, entry.Columns, entry.Rows, entry.HasPosition);
+		for (k = 0; k < 3; k++)
+			fprintf(file, "\t%.17g", entry.Position[k]);
+		for (k = 0; k < 6; k++)
+			fprintf(file, "\t%.17g", entry.Orientation[k]);
+		for (k = 0; k < 2; k++)
+			fprintf(file, "\t%.17g", entry.PixelSpacing[k]);
+		fprintf(file, "\t%.17g\t%.17g\t%ld\t%ld\t%ld\t%ld\t%ld\t%ld\t%ld\t%.17g", entry.RescaleSlope, entry.RescaleIntercept, \
+			entry.HighBit, entry.PixelRepresentation, entry.BitsAllocated, entry.SmallestPixelValue, entry.LargestPixelValue, \
+			entry.InstanceNumber, entry.CardiacNumberOfImages, entry.TriggerTime);
+		fprintf(file, "\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n", DS_IndexString(entry.ScanOptions).c_str(), \
+			DS_IndexString(entry.Modality).c_str(), DS_IndexString(entry.PatientPosition).c_str(), \
+			DS_IndexString(entry.StudyInstanceUID).c_str(), DS_IndexString(entry.SeriesInstanceUID).c_str(), \
+			DS_IndexString(entry.PatientBirthDate).c_str(), DS_IndexString(entry.StudyDate).c_str(), \
+			DS_IndexString(entry.SeriesDescription).c_str(), DS_IndexString(entry.PatientName).c_str());
+	}
+	fclose(file);
+}
+
+//----------------------------------------------------------------------------
+mafString medOpImporterDicomOffis::GetDicomIndexFileName(const char *dicomDirABSPath)
+//----------------------------------------------------------------------------
+{
+	// the index is written next to the directory, so that it is not listed with the dicom files
+	wxString dirName = dicomDirABSPath;
+	while (dirName.Length() > 1 && (dirName.Last() == '\\' || dirName.Last() == '/'))
+	{
+		dirName.RemoveLast();
+	}
+	mafString indexFileName = dirName.c_str();
+	indexFileName.Append(DICOM_INDEX_EXTENSION);
+	return indexFileName;
+}
+
+//----------------------------------------------------------------------------
+// Registrations of the DCMTK decoders not yet cleaned up: decoders are registered by the first
+// registration and deregistered by the last cleanup, so that they are never deregistered while
+// a prefetch thread is decoding. Only the main thread registers and cleans up decoders.
+static int dv_codec_registrations = 0;
+
+//----------------------------------------------------------------------------
+static void DV_RegisterCodecs()
+//----------------------------------------------------------------------------
+{
+	if (dv_codec_registrations++ == 0)
+	{
+		DJDecoderRegistration::registerCodecs(); // register JPEG codecs
+		DcmRLEDecoderRegistration ::registerCodecs(OFFalse, OFFalse,OFFalse); // register RLE codecs
+	}
+}
+
+//----------------------------------------------------------------------------
+static void DV_CleanupCodecs()
+//----------------------------------------------------------------------------
+{
+	if (--dv_codec_registrations == 0)
+	{
+		DJDecoderRegistration::cleanup(); // deregister JPEG codecs
+		DcmRLEDecoderRegistration::cleanup();
+	}
+}
+
+//----------------------------------------------------------------------------
+// Stages of the threads of ReadVolumeSlices
+enum DICOM_DECODE_STAGE
+{
+	DICOM_DECODE_FILES = 0,
+	DICOM_COPY_PIXELS,
+};
+
+//----------------------------------------------------------------------------
+// Slice read by the volume build: the file is decoded by a thread, the image is allocated
+// by the main thread and its pixels are copied by a thread
+typedef struct DICOM_DECODED_SLICE
+{
+	std::string FileName;
+	double Origin[3];
+	DcmFileFormat *FileFormat;    // decoded file, NULL if the file can not be decoded
+	int Columns;
+	int Rows;
+	double PixelSpacing[3];
+	double RescaleSlope;
+	double RescaleIntercept;
+	long BitsAllocated;
+	int ScalarType;
+	int Extent[4];                // pixels of the slice copied in the image, outside the slice they are 0
+	vtkImageData *Image;
+} DICOM_DECODED_SLICE;
+
+//----------------------------------------------------------------------------
+// Slices decoded by the threads of ReadVolumeSlices
+typedef struct DICOM_DECODE_JOB
+{
+	std::vector<DICOM_DECODED_SLICE> *Slices;
+	int Stage;
+} DICOM_DECODE_JOB;
+
+//----------------------------------------------------------------------------
+// Loads and decompresses the file of the slice and reads the tags of its pixels; codecs
+// must be registered by the caller
+static void DV_DecodeFile(DICOM_DECODED_SLICE &slice)
+//----------------------------------------------------------------------------
+{
+	slice.FileFormat = new DcmFileFormat();
+	OFCondition status = slice.FileFormat->loadFile(slice.FileName.c_str());
+	DcmDataset *dicomDataset = slice.FileFormat->getDataset();
+	if (status.good())
+	{
+		// decompress data set if compressed
+		status = dicomDataset->chooseRepresentation(EXS_LittleEndianExplicit, NULL);
+	}
+	if (status.bad())
+	{
+		delete slice.FileFormat;
+		slice.FileFormat = NULL;
+		return;
+	}
+
+	long val_long = 0;
+	dicomDataset->findAndGetLongInt(DCM_Columns, val_long);
+	slice.Columns = val_long;
+	val_long = 0;
+	dicomDataset->findAndGetLongInt(DCM_Rows, val_long);
+	slice.Rows = val_long;
+
+	slice.PixelSpacing[2] = 1;
+	if(dicomDataset->findAndGetFloat64(DCM_PixelSpacing,slice.PixelSpacing[0],0).bad())
+	{
+		slice.PixelSpacing[0] = 1.0;// for RGB??
+	}
+	if(dicomDataset->findAndGetFloat64(DCM_PixelSpacing,slice.PixelSpacing[1],1).bad())
+	{
+		slice.PixelSpacing[1] = 1.0;// for RGB??
+	}
+	if(dicomDataset->findAndGetFloat64(DCM_RescaleSlope,slice.RescaleSlope).bad())
+	{
+		slice.RescaleSlope = 1;
+	}
+	if(dicomDataset->findAndGetFloat64(DCM_RescaleIntercept,slice.RescaleIntercept).bad())
+	{
+		slice.RescaleIntercept = 0;
+	}
+
+	long pixelRepresentation = 0;
+	long smallestPixelValue = 0;
+	long largestPixelValue = 0;
+	slice.BitsAllocated = 0;
+	dicomDataset->findAndGetLongInt(DCM_PixelRepresentation,pixelRepresentation);
+	dicomDataset->findAndGetLongInt(DCM_BitsAllocated,slice.BitsAllocated);
+	dicomDataset->findAndGetLongInt(DCM_SmallestImagePixelValue, smallestPixelValue);
+	dicomDataset->findAndGetLongInt(DCM_LargestImagePixelValue, largestPixelValue);
+
+	// rescaled values not fitting 16 bits are kept in the default scalar type of vtkImageData
+	slice.ScalarType = DS_GetScalarType(slice.BitsAllocated, pixelRepresentation, smallestPixelValue, largestPixelValue, \
+		slice.RescaleSlope, slice.RescaleIntercept);
+	if (slice.ScalarType < 0)
+	{
+		slice.ScalarType = VTK_DOUBLE;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Allocates the image of the extent of the decoded slice
+static vtkImageData *DV_NewImage(const DICOM_DECODED_SLICE &slice)
+//----------------------------------------------------------------------------
+{
+	int dimX = slice.Extent[1] - slice.Extent[0] + 1;
+	int dimY = slice.Extent[3] - slice.Extent[2] + 1;
+	double origin[3] = {slice.Origin[0] + slice.Extent[0]*slice.PixelSpacing[0], \
+		slice.Origin[1] + slice.Extent[2]*slice.PixelSpacing[1], slice.Origin[2]};
+
+	vtkImageData *image = vtkImageData::New();
+	image->SetDimensions(dimX, dimY, 1);
+	image->SetWholeExtent(0,dimX-1,0,dimY-1,0,0);
+	image->SetUpdateExtent(0,dimX-1,0,dimY-1,0,0);
+	image->SetExtent(image->GetUpdateExtent());
+	image->SetNumberOfScalarComponents(1);
+	image->SetSpacing(slice.PixelSpacing);
+	image->SetOrigin(origin);
+	image->SetScalarType(slice.ScalarType);
+	image->AllocateScalars();
+	image->GetPointData()->GetScalars()->SetName("Scalars");
+	return image;
+}
+
+//----------------------------------------------------------------------------
+// Writes the pixels of the extent of the slice in out, rescaled with slope and intercept if rescale is true
+template <class TIn, class TOut>
+static void DV_CopyPixels(const TIn *pixels, const DICOM_DECODED_SLICE &slice, bool rescale, TOut *out)
+//----------------------------------------------------------------------------
+{
+	for (int y = slice.Extent[2]; y <= slice.Extent[3]; y++)
+	{
+		for (int x = slice.Extent[0]; x <= slice.Extent[1]; x++, out++)
+		{
+			if (pixels == NULL || x < 0 || y < 0 || x >= slice.Columns || y >= slice.Rows)
+			{
+				*out = 0;
+				continue;
+			}
+			TOut value = (TOut)pixels[slice.Columns*y + x];
+			if (rescale)
+			{
+				value = (TOut)(value*slice.RescaleSlope + slice.RescaleIntercept);
+			}
+			*out = value;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+// Writes the pixels of the decoded file in the image of the slice
+template <class TIn>
+static void DV_CopyPixels(const TIn *pixels, const DICOM_DECODED_SLICE &slice)
+//----------------------------------------------------------------------------
+{
+	// slope and intercept are applied only to the 16 and 8 bits types
+	bool rescale = slice.RescaleSlope != 1 || slice.RescaleIntercept != 0;
+	void *out = slice.Image->GetScalarPointer();
+	switch (slice.ScalarType)
+	{
+		case VTK_UNSIGNED_SHORT:
+			DV_CopyPixels(pixels, slice, rescale, (unsigned short *)out);
+			break;
+		case VTK_SHORT:
+			DV_CopyPixels(pixels, slice, rescale, (short *)out);
+			break;
+		case VTK_CHAR:
+			DV_CopyPixels(pixels, slice, rescale, (char *)out);
+			break;
+		default:
+			DV_CopyPixels(pixels, slice, false, (double *)out);
+			break;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Writes the pixels of the decoded file in the image of the slice and releases the file
+static void DV_CopyPixels(DICOM_DECODED_SLICE &slice)
+//----------------------------------------------------------------------------
+{
+	DcmDataset *dicomDataset = slice.FileFormat->getDataset();
+	if (slice.BitsAllocated == 16)
+	{
+		const Uint16 *dicom_buf_short = NULL;
+		dicomDataset->findAndGetUint16Array(DCM_PixelData, dicom_buf_short);
+		DV_CopyPixels(dicom_buf_short, slice);
+	}
+	else
+	{
+		const Uint8 *dicom_buf_char = NULL;
+		dicomDataset->findAndGetUint8Array(DCM_PixelData, dicom_buf_char);
+		DV_CopyPixels(dicom_buf_char, slice);
+	}
+	delete slice.FileFormat;
+	slice.FileFormat = NULL;
+}
+
+//----------------------------------------------------------------------------
+// Executes the stage of the job on the slices assigned to the thread; slices already in memory
+// have no file name
+static void DV_ExecuteStage(DICOM_DECODE_JOB *job, int threadId, int numberOfThreads)
+//----------------------------------------------------------------------------
+{
+	for (int i = threadId; i < job->Slices->size(); i += numberOfThreads)
+	{
+		DICOM_DECODED_SLICE &slice = (*job->Slices)[i];
+		if (job->Stage == DICOM_DECODE_FILES && !slice.FileName.empty())
+		{
+			DV_DecodeFile(slice);
+		}
+		else if (job->Stage == DICOM_COPY_PIXELS && slice.FileFormat != NULL)
+		{
+			DV_CopyPixels(slice);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+// Thread function of ReadVolumeSlices
+static VTK_THREAD_RETURN_TYPE DV_ExecuteStageThread(void *arg)
+//----------------------------------------------------------------------------
+{
+	vtkMultiThreader::ThreadInfo *info = (vtkMultiThreader::ThreadInfo *)arg;
+	DV_ExecuteStage((DICOM_DECODE_JOB *)info->UserData, info->ThreadID, info->NumberOfThreads);
+
+	return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+// Executes the stage of the job on at most maxThreads threads
+static void DV_ExecuteStage(DICOM_DECODE_JOB &job, int stage, int maxThreads)
+//----------------------------------------------------------------------------
+{
+	job.Stage = stage;
+	int nThreads = maxThreads;
+	if (nThreads > job.Slices->size())
+		nThreads = job.Slices->size();
+	if (nThreads <= 1)
+	{
+		DV_ExecuteStage(&job, 0, 1);
+	}
+	else
+	{
+		vtkMultiThreader *threader = vtkMultiThreader::New();
+		threader->SetNumberOfThreads(nThreads);
+		threader->SetSingleMethod(DV_ExecuteStageThread, &job);
+		threader->SingleMethodExecute();
+		vtkDEL(threader);
+	}
+}
+
+//----------------------------------------------------------------------------
+// Copies the extent of the slice image source (outside the image the pixels are 0) in a new image
+static vtkImageData *DV_CropImage(vtkImageData *source, const int extent[4])
+//----------------------------------------------------------------------------
+{
+	int dims[3];
+	double origin[3], spacing[3];
+	source->GetDimensions(dims);
+	source->GetOrigin(origin);
+	source->GetSpacing(spacing);
+
+	int dimX = extent[1] - extent[0] + 1;
+	int dimY = extent[3] - extent[2] + 1;
+	vtkImageData *image = vtkImageData::New();
+	image->SetDimensions(dimX, dimY, 1);
+	image->SetWholeExtent(0,dimX-1,0,dimY-1,0,0);
+	image->SetUpdateExtent(0,dimX-1,0,dimY-1,0,0);
+	image->SetExtent(image->GetUpdateExtent());
+	image->SetNumberOfScalarComponents(source->GetNumberOfScalarComponents());
+	image->SetSpacing(spacing);
+	image->SetOrigin(origin[0] + extent[0]*spacing[0], origin[1] + extent[2]*spacing[1], origin[2]);
+	image->SetScalarType(source->GetScalarType());
+	image->AllocateScalars();
+	image->GetPointData()->GetScalars()->SetName(source->GetPointData()->GetScalars()->GetName());
+
+	int pixelSize = source->GetScalarSize() * source->GetNumberOfScalarComponents();
+	const char *in = (const char *)source->GetScalarPointer();
+	char *out = (char *)image->GetScalarPointer();
+	memset(out, 0, dimX*dimY*pixelSize);
+
+	// rows of the extent inside the source
+	int x0 = extent[0] > 0 ? extent[0] : 0;
+	int x1 = extent[1] < dims[0] - 1 ? extent[1] : dims[0] - 1;
+	for (int y = extent[2] > 0 ? extent[2] : 0; y <= extent[3] && y < dims[1] && x0 <= x1; y++)
+	{
+		memcpy(out + ((y - extent[2])*dimX + x0 - extent[0])*pixelSize, in + (y*dims[0] + x0)*pixelSize, (x1 - x0 + 1)*pixelSize);
+	}
+	return image;
+}
+
+//----------------------------------------------------------------------------
+void medOpImporterDicomOffis::GetVolumeSliceExtent(int columns, int rows, double spacing[3], int extent[4])
+//----------------------------------------------------------------------------
+{
+	extent[0] = 0;
+	extent[1] = columns - 1;
+	extent[2] = 0;
+	extent[3] = rows - 1;
+	if (!m_CropFlag)
+	{
+		return;
+	}
+
+	// same extent of the texture probed by GenerateSliceTexture, in pixels of the slice
+	double crop_bounds[6];
+	m_CropPlane->Update();
+	m_CropPlane->GetOutput()->GetBounds(crop_bounds);
+	if(crop_bounds[1] > (columns - 1)*spacing[0])
+		crop_bounds[1] = (columns - 1)*spacing[0];
+	if(crop_bounds[3] > (rows - 1)*spacing[1])
+		crop_bounds[3] = (rows - 1)*spacing[1];
+
+	int dim_x_clip = (int)round(((crop_bounds[1] - crop_bounds[0]) / spacing[0]))+1;
+	int dim_y_clip = (int)round(((crop_bounds[3] - crop_bounds[2]) / spacing[1]))+1;
+	extent[0] = (int)round(crop_bounds[0] / spacing[0]);
+	extent[1] = extent[0] + (dim_x_clip > 1 ? dim_x_clip : 1) - 1;
+	extent[2] = (int)round(crop_bounds[2] / spacing[1]);
+	extent[3] = extent[2] + (dim_y_clip > 1 ? dim_y_clip : 1) - 1;
+}
+
+//----------------------------------------------------------------------------
+bool medOpImporterDicomOffis::ReadVolumeSlices(const std::vector<int> &imageIDs, std::vector<vtkImageData *> &images)
+//----------------------------------------------------------------------------
+{
+	images.assign(imageIDs.size(), (vtkImageData *)NULL);
+
+	vtkMultiThreader *threader = vtkMultiThreader::New();
+	int nThreads = threader->GetNumberOfThreads();
+	vtkDEL(threader);
+
+	DV_RegisterCodecs();
+
+	// slices already in memory (e.g. modified by the cardiac MRI reader) are not read again
+	std::vector<DICOM_DECODED_SLICE> slices(imageIDs.size());
+	for (int i = 0; i < imageIDs.size(); i++)
+	{
+		medDicomSlice *dicomSlice = m_SelectedSeriesSlicesList->Item(imageIDs[i])->GetData();
+		DICOM_DECODED_SLICE &slice = slices[i];
+		slice.FileFormat = NULL;
+		slice.Image = NULL;
+		dicomSlice->GetDcmImagePositionPatientOriginal(slice.Origin);
+		if (!dicomSlice->IsVTKImageDataLoaded())
+		{
+			slice.FileName = dicomSlice->GetSliceABSFileName();
+		}
+	}
+
+	DICOM_DECODE_JOB job;
+	job.Slices = &slices;
+	DV_ExecuteStage(job, DICOM_DECODE_FILES, nThreads);
+
+	bool result = true;
+	for (int i = 0; i < imageIDs.size(); i++)
+	{
+		DICOM_DECODED_SLICE &slice = slices[i];
+		vtkImageData *imageData = NULL;
+		if (slice.FileName.empty())
+		{
+			imageData = m_SelectedSeriesSlicesList->Item(imageIDs[i])->GetData()->GetVTKImageData();
+		}
+		if (imageData != NULL)
+		{
+			imageData->Update();
+			int dims[3];
+			double spacing[3];
+			imageData->GetDimensions(dims);
+			imageData->GetSpacing(spacing);
+			GetVolumeSliceExtent(dims[0], dims[1], spacing, slice.Extent);
+			images[i] = DV_CropImage(imageData, slice.Extent);
+		}
+		else if (slice.FileFormat != NULL)
+		{
+			GetVolumeSliceExtent(slice.Columns, slice.Rows, slice.PixelSpacing, slice.Extent);
+			slice.Image = images[i] = DV_NewImage(slice);
+		}
+		else
+		{
+			wxLogMessage(wxString::Format("Error decoding the image <%s>",m_SelectedSeriesSlicesList->Item(imageIDs[i])->GetData()->GetSliceABSFileName()));
+			result = false;
+		}
+	}
+
+	DV_ExecuteStage(job, DICOM_COPY_PIXELS, nThreads);
+
+	DV_CleanupCodecs();
+
+	if (!result)
+	{
+		for (int i = 0; i < images.size(); i++)
+		{
+			vtkDEL(images[i]);
+		}
+		images.clear();
+		return false;
+	}
+
+	for (int i = 0; i < images.size(); i++)
+	{
+		//rescale to 16 bit
+		if(m_RescaleTo16Bit == TRUE && m_HighBit == 11)
+		{
+			RescaleTo16Bit(images[i]);
+		}
+		images[i]->Update();
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Slices decoded in background for the preview
+typedef struct DICOM_PREFETCH_JOB
+{
+	vtkMutexLock *Lock;
+	bool Running;                                       // false when the thread has no slices left to decode
+	std::deque<DICOM_DECODED_SLICE> Requests;           // slices to decode, in order
+	std::map<std::string, DICOM_DECODED_SLICE> Decoded; // decoded slices not yet shown by file name
+} DICOM_PREFETCH_JOB;
+
+//----------------------------------------------------------------------------
+// Thread function of PrefetchSlices: decodes the requested slices until there are none left
+static VTK_THREAD_RETURN_TYPE DV_PrefetchThread(void *arg)
+//----------------------------------------------------------------------------
+{
+	vtkMultiThreader::ThreadInfo *info = (vtkMultiThreader::ThreadInfo *)arg;
+	DICOM_PREFETCH_JOB *job = (DICOM_PREFETCH_JOB *)info->UserData;
+
+	for (;;)
+	{
+		job->Lock->Lock();
+		if (job->Requests.empty())
+		{
+			job->Running = false;
+			job->Lock->Unlock();
+			break;
+		}
+		DICOM_DECODED_SLICE slice = job->Requests.front();
+		job->Requests.pop_front();
+		job->Lock->Unlock();
+
+		DV_DecodeFile(slice);
+
+		job->Lock->Lock();
+		std::map<std::string, DICOM_DECODED_SLICE>::iterator it = job->Decoded.find(slice.FileName);
+		if (it != job->Decoded.end())
+		{
+			delete it->second.FileFormat;
+		}
+		job->Decoded[slice.FileName] = slice;
+		job->Lock->Unlock();
+	}
+
+	return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+void medOpImporterDicomOffis::LoadPreviewSlice(int imageID)
+//----------------------------------------------------------------------------
+{
+	medDicomSlice *slice = m_SelectedSeriesSlicesList->Item(imageID)->GetData();
+
+	// slices loaded by the preview are kept in the order they are shown
+	std::list<medDicomSlice *>::iterator it = std::find(m_PreviewSlices.begin(), m_PreviewSlices.end(), slice);
+	bool loadedByPreview = it != m_PreviewSlices.end();
+	if (loadedByPreview)
+	{
+		m_PreviewSlices.erase(it);
+	}
+
+	if (slice->IsVTKImageDataLoaded())
+	{
+		// slices loaded elsewhere (e.g. modified by the cardiac MRI reader) are never released
+		m_PreviewCacheHits++;
+		if (loadedByPreview)
+		{
+			m_PreviewSlices.push_front(slice);
+		}
+	}
+	else
+	{
+		DICOM_DECODED_SLICE decoded;
+		decoded.FileFormat = NULL;
+		if (m_PrefetchJob != NULL)
+		{
+			m_PrefetchJob->Lock->Lock();
+			std::map<std::string, DICOM_DECODED_SLICE>::iterator decodedIt = m_PrefetchJob->Decoded.find(slice->GetSliceABSFileName());
+			if (decodedIt != m_PrefetchJob->Decoded.end())
+			{
+				decoded = decodedIt->second;
+				m_PrefetchJob->Decoded.erase(decodedIt);
+			}
+			m_PrefetchJob->Lock->Unlock();
+		}
+
+		if (decoded.FileFormat != NULL)
+		{
+			m_PreviewPrefetchHits++;
+			slice->GetDcmImagePositionPatientOriginal(decoded.Origin);
+			decoded.Extent[0] = 0;
+			decoded.Extent[1] = decoded.Columns - 1;
+			decoded.Extent[2] = 0;
+			decoded.Extent[3] = decoded.Rows - 1;
+			decoded.Image = DV_NewImage(decoded);
+			DV_CopyPixels(decoded);
+			decoded.Image->Update();
+			slice->ShareVTKImageData(decoded.Image);
+			decoded.Image->Delete();
+		}
+		else
+		{
+			m_PreviewCacheMisses++;
+			double startTime = vtkTimerLog::GetUniversalTime();
+			slice->GetVTKImageData();
+			m_PreviewDecodeTime += vtkTimerLog::GetUniversalTime() - startTime;
+		}
+
+		if (slice->IsVTKImageDataLoaded())
+		{
+			m_PreviewSlices.push_front(slice);
+		}
+	}
+
+	while (m_PreviewSlices.size() > m_PreviewCacheSize)
+	{
+		m_PreviewSlices.back()->ReleaseVTKImageData();
+		m_PreviewSlices.pop_back();
+	}
+}
+
+//----------------------------------------------------------------------------
+void medOpImporterDicomOffis::PrefetchSlices(const std::vector<int> &imageIDs)
+//----------------------------------------------------------------------------
+{
+	if (m_PrefetchJob == NULL)
+	{
+		m_PrefetchJob = new DICOM_PREFETCH_JOB;
+		m_PrefetchJob->Lock = vtkMutexLock::New();
+		m_PrefetchJob->Running = false;
+		m_PrefetchThreader = vtkMultiThreader::New();
+		m_PrefetchThreadID = -1;
+
+		// decoders stay registered while the prefetch thread can use them
+		DV_RegisterCodecs();
+	}
+
+	std::vector<DICOM_DECODED_SLICE> requests;
+	std::set<std::string> fileNames;
+	for (int i = 0; i < imageIDs.size(); i++)
+	{
+		medDicomSlice *slice = m_SelectedSeriesSlicesList->Item(imageIDs[i])->GetData();
+		if (slice->IsVTKImageDataLoaded() || !fileNames.insert(slice->GetSliceABSFileName()).second)
+		{
+			continue;
+		}
+		DICOM_DECODED_SLICE request;
+		request.FileName = slice->GetSliceABSFileName();
+		request.FileFormat = NULL;
+		request.Image = NULL;
+		requests.push_back(request);
+	}
+
+	bool spawn = false;
+	m_PrefetchJob->Lock->Lock();
+	m_PrefetchJob->Requests.clear();
+	std::map<std::string, DICOM_DECODED_SLICE>::iterator it = m_PrefetchJob->Decoded.begin();
+	while (it != m_PrefetchJob->Decoded.end())
+	{
+		if (fileNames.find(it->first) == fileNames.end())
+		{
+			delete it->second.FileFormat;
+			m_PrefetchJob->Decoded.erase(it++);
+		}
+		else
+		{
+			++it;
+		}
+	}
+	for (int i = 0; i < requests.size(); i++)
+	{
+		if (m_PrefetchJob->Decoded.find(requests[i].FileName) == m_PrefetchJob->Decoded.end())
+		{
+			m_PrefetchJob->Requests.push_back(requests[i]);
+		}
+	}
+	if (!m_PrefetchJob->Running && !m_PrefetchJob->Requests.empty())
+	{
+		m_PrefetchJob->Running = true;
+		spawn = true;
+	}
+	m_PrefetchJob->Lock->Unlock();
+
+	if (spawn)
+	{
+		// the previous thread has finished its requests
+		if (m_PrefetchThreadID >= 0)
+		{
+			m_PrefetchThreader->TerminateThread(m_PrefetchThreadID);
+		}
+		m_PrefetchThreadID = m_PrefetchThreader->SpawnThread(DV_PrefetchThread, m_PrefetchJob);
+	}
+}
+
+//----------------------------------------------------------------------------
+void medOpImporterDicomOffis::PrefetchNeighbourSlices(int sliceDirection, int timeDirection)
+//----------------------------------------------------------------------------
+{
+	std::vector<int> imageIDs;
+	int numberOfTimeFrames = max(m_NumberOfTimeFrames, 1);
+	for (int i = 1; i <= DICOM_PREFETCH_SIZE; i++)
 	{
-		time(&start);
+		int sliceID = m_CurrentSlice + i*sliceDirection;
+		int timeID = m_CurrentTime + i*timeDirection;
+		if (sliceID < 0 || sliceID >= m_NumberOfSlices || timeID < 0 || timeID >= numberOfTimeFrames)
+		{
+			break;
+		}
+		int imageID = GetSliceIDInSeries(timeID, sliceID);
+		if (imageID >= 0 && imageID < m_SelectedSeriesSlicesList->GetCount())
+		{
+			imageIDs.push_back(imageID);
+		}
+	}
+	PrefetchSlices(imageIDs);
+}
+
+//----------------------------------------------------------------------------
+bool medOpImporterDicomOffis::IsPrefetchRunning()
+//----------------------------------------------------------------------------
+{
+	if (m_PrefetchJob == NULL)
+	{
+		return false;
+	}
+	m_PrefetchJob->Lock->Lock();
+	bool running = m_PrefetchJob->Running;
+	m_PrefetchJob->Lock->Unlock();
+	return running;
+}
+
+//----------------------------------------------------------------------------
+void medOpImporterDicomOffis::ReleasePreviewCache()
+//----------------------------------------------------------------------------
+{
+	if (m_PrefetchJob != NULL)
+	{
+		m_PrefetchJob->Lock->Lock();
+		m_PrefetchJob->Requests.clear();
+		m_PrefetchJob->Lock->Unlock();
+		if (m_PrefetchThreadID >= 0)
+		{
+			m_PrefetchThreader->TerminateThread(m_PrefetchThreadID);
+		}
+		std::map<std::string, DICOM_DECODED_SLICE>::iterator it;
+		for (it = m_PrefetchJob->Decoded.begin(); it != m_PrefetchJob->Decoded.end(); it++)
+		{
+			delete it->second.FileFormat;
+		}
+		vtkDEL(m_PrefetchJob->Lock);
+		cppDEL(m_PrefetchJob);
+		vtkDEL(m_PrefetchThreader);
+		m_PrefetchThreadID = -1;
+		DV_CleanupCodecs();
+	}
+
+	int shownSlices = m_PreviewCacheHits + m_PreviewPrefetchHits + m_PreviewCacheMisses;
+	if (shownSlices > 0)
+	{
+		mafLogMessage("DICOM preview: %d slices shown, %d in memory, %d prefetched, %d decoded (%.1f%% hits, %.1f ms per decode)", \
+			shownSlices, m_PreviewCacheHits, m_PreviewPrefetchHits, m_PreviewCacheMisses, \
+			100.0*(m_PreviewCacheHits + m_PreviewPrefetchHits)/shownSlices, \
+			m_PreviewCacheMisses > 0 ? 1000.0*m_PreviewDecodeTime/m_PreviewCacheMisses : 0.0);
+	}
+
+	// the slices are not released, they can be deleted with their series
+	m_PreviewSlices.clear();
+	m_PreviewCacheHits = 0;
+	m_PreviewPrefetchHits = 0;
+	m_PreviewCacheMisses = 0;
+	m_PreviewDecodeTime = 0;
+}
+
+//----------------------------------------------------------------------------
+bool medOpImporterDicomOffis::BuildDicomFileList(const char *dicomDirABSPath)
+//----------------------------------------------------------------------------
+{   
+
+  int seriesIndex = 0;
+	long progress;
+	int sliceNum = -1;
+	double lastZPos = 0;
+	long int dcmInstanceNumber = -1;
+	long int dcmCardiacNumberOfImages = -1;
+	double dcmTriggerTime = -1.0;
+	double dcmImageOrientationPatient[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
+	double dcmImagePositionPatient[3] = {0.0,0.0,0.0};
+	bool enableToRead = true; //true for test mode
+	bool errorOccurred = false;
+	double lastDistance = 0;
+	mafString lastFileName = "";
+
+	double percentageTolerance = 0;
+	double scalarTolerance = 0;
+	bool enableScalarTolerance = false;
+	bool enablePercentageTolerance = false;
+
+	if(!this->m_TestMode)
+	{
+		enableScalarTolerance = ((medGUIDicomSettings*)GetSetting())->EnableScalarTolerance() != FALSE;
+		enablePercentageTolerance = ((medGUIDicomSettings*)GetSetting())->EnablePercentageTolerance() != FALSE;
+
+		if (enableScalarTolerance)
+			scalarTolerance = ((medGUIDicomSettings*)GetSetting())->GetScalarTolerance();
+
+		if (enablePercentageTolerance)
+			percentageTolerance = ((medGUIDicomSettings*)GetSetting())->GetPercentageTolerance();
+	}
+
+	m_DicomReaderModality = -1;
+
+	if (m_DICOMDirectoryReader->Open(dicomDirABSPath) == 0)
+	{
+		if(!this->m_TestMode)
+		{
+			wxMessageBox(wxString::Format("Directory <%s> can not be opened",dicomDirABSPath),"Warning!!");
+		}
+		return false;
+	}
+
+	if (!this->m_TestMode)
+	{
+		mafEventMacro(mafEvent(this,PROGRESSBAR_SHOW));
+		progress = START_PROGRESS_BAR;
+	}
+
+	int i = -1;
+
+	time_t start,end;
+
+	wxBusyInfo *busyInfo = NULL;
+
+	wxString busyMessage = "Reading DICOM directory: please wait";
+
+	if (!m_TestMode)
+	{
+		busyInfo = new wxBusyInfo(busyMessage);
+	}
 
+	// tags of the files of the directory: unchanged files are taken from the index of the directory,
+	// the others are read without their pixel data by a pool of threads
+	std::vector<DICOM_SCAN_ENTRY> scanEntries;
+	std::vector<int> entriesToRead;
+	std::map<std::string,DICOM_SCAN_ENTRY> dicomIndex;
+	// the index next to the directory is not written by the tests
+	bool useIndex = m_UseDicomIndex && (!m_TestMode || !m_DicomIndexFileName.IsEmpty());
+	mafString indexFileName = m_DicomIndexFileName.IsEmpty() ? GetDicomIndexFileName(dicomDirABSPath) : m_DicomIndexFileName;
+	if (useIndex)
+	{
+		DS_ReadIndex(indexFileName.GetCStr(), dicomIndex);
+	}
+
+	for (i=0; i < m_DICOMDirectoryReader->GetNumberOfFiles(); i++)
+	{
 		if ((strcmp(m_DICOMDirectoryReader->GetFile(i),".") == 0) ||\
 			(strcmp(m_DICOMDirectoryReader->GetFile(i),"..") == 0)) 
 		{
 			// skip non dicom files
 			continue;
 		}
-		else
+
+		DICOM_SCAN_ENTRY entry;
+		DS_ResetEntry(entry);
+		entry.FileName = m_DICOMDirectoryReader->GetFile(i);
+
+		mafString fileABSName = dicomDirABSPath;
+		fileABSName.Append("\\");
+		fileABSName.Append(entry.FileName.c_str());
+		wxStructStat fileStat;
+		if (wxStat(fileABSName.GetCStr(), &fileStat) == 0)
 		{
-			sliceNum++;
-			mafString currentSliceABSFileName = "";
-			mafString currentSliceLocalFileName = m_DICOMDirectoryReader->GetFile(i);
+			entry.FileSize = (long)fileStat.st_size;
+			entry.FileTime = (long)fileStat.st_mtime;
+		}
 
-			currentSliceABSFileName.Append(dicomDirABSPath);
-			currentSliceABSFileName.Append("\\");
-			currentSliceABSFileName.Append(currentSliceLocalFileName);
+		std::map<std::string,DICOM_SCAN_ENTRY>::iterator indexed = dicomIndex.find(entry.FileName);
+		if (indexed != dicomIndex.end() && indexed->second.Status != DICOM_SCAN_NOT_READ && entry.FileSize >= 0 && \
+			indexed->second.FileSize == entry.FileSize && indexed->second.FileTime == entry.FileTime)
+		{
+			entry = indexed->second;
+		}
+		else
+		{
+			entriesToRead.push_back(scanEntries.size());
+		}
+		scanEntries.push_back(entry);
+	}
+	m_NumberOfReadFiles = entriesToRead.size();
+	m_NumberOfIndexedFiles = scanEntries.size() - entriesToRead.size();
 
-			DJDecoderRegistration::registerCodecs(); // register JPEG codecs
-			DcmRLEDecoderRegistration ::registerCodecs(OFFalse, OFFalse,OFFalse); // register RLE codecs
-			OFCondition status = dicomImg.loadFile(currentSliceABSFileName);//load data into offis structure
+	if (!entriesToRead.empty() || dicomIndex.size() != scanEntries.size())
+	{
+		DICOM_SCAN_JOB job;
+		job.DirectoryName = dicomDirABSPath;
+		job.Entries = &scanEntries;
+		job.EntriesToRead = &entriesToRead;
+
+		// files are read in batches to update the progress bar
+		vtkMultiThreader *threader = vtkMultiThreader::New();
+		int nThreads = threader->GetNumberOfThreads();
+		int numberOfEntriesToRead = entriesToRead.size();
+		for (job.First = 0; job.First < numberOfEntriesToRead; job.First = job.Last)
+		{
+			job.Last = job.First + DICOM_SCAN_BATCH_SIZE < numberOfEntriesToRead ? job.First + DICOM_SCAN_BATCH_SIZE : numberOfEntriesToRead;
+			threader->SetNumberOfThreads(nThreads < job.Last - job.First ? nThreads : job.Last - job.First);
+			threader->SetSingleMethod(DS_ReadTagsThread, &job);
+			threader->SingleMethodExecute();
 
-			if (!status.good())
+			if (!this->m_TestMode)
 			{
-				if(!this->m_TestMode)
-				{
-					wxLogMessage(wxString::Format("File <%s> can not be opened",currentSliceABSFileName));
-					errorOccurred = true;
-					sliceNum--;
-				}
-				continue;
+				progress = job.Last * 100 / numberOfEntriesToRead;
+				mafEventMacro(mafEvent(this,PROGRESSBAR_SET_VALUE,progress));
 			}
+		}
+		vtkDEL(threader);
 
-			m_CurrentSliceABSFileName = currentSliceABSFileName; 
+		if (useIndex)
+		{
+			DS_WriteIndex(indexFileName.GetCStr(), scanEntries);
+		}
+	}
 
-			DcmDataset *dicomDataset = dicomImg.getDataset();//obtain dataset information from dicom file (loaded into memory)
+	// foreach dicom directory file
+  int img_pos_result = wxNO; // added by Losi to avoid exiting series without image position
+	for (i=0; i < (int)scanEntries.size(); i++)
+	{
+		time(&start);
 
-			// decompress data set if compressed
-			OFCondition error = dicomDataset->chooseRepresentation(EXS_LittleEndianExplicit, NULL);
+		DICOM_SCAN_ENTRY &entry = scanEntries[i];
+		mafString currentSliceABSFileName = "";
+		mafString currentSliceLocalFileName = entry.FileName.c_str();
 
-			DJDecoderRegistration::cleanup(); // deregister JPEG codecs
-			DcmRLEDecoderRegistration::cleanup();
+		currentSliceABSFileName.Append(dicomDirABSPath);
+		currentSliceABSFileName.Append("\\");
+		currentSliceABSFileName.Append(currentSliceLocalFileName);
 
-			if (!error.good())
+		if (entry.Status != DICOM_SCAN_OK)
+		{
+			if(!this->m_TestMode)
 			{
-				wxLogMessage(wxString::Format("Error decoding the image <%s>",currentSliceABSFileName));
+				if (entry.Status == DICOM_SCAN_NO_PIXELS)
+					wxLogMessage(wxString::Format("File <%s> has no pixel data that can be decoded",currentSliceABSFileName));
+				else
+					wxLogMessage(wxString::Format("File <%s> can not be opened",currentSliceABSFileName));
 				errorOccurred = true;
-				//return false;
-				continue;
 			}
+			continue;
+		}
+		else
+		{
+			sliceNum++;
+			m_CurrentSliceABSFileName = currentSliceABSFileName; 
 
-			const char *option = "?";
-			dicomDataset->findAndGetString(DCM_ScanOptions,option);
-			wxString scanOption = option;
+			wxString scanOption = entry.ScanOptions.c_str();
 
 			if (scanOption.Find("SCOUT") != -1)//check if it is a scout image
 			{
 				continue;
 			}
 
-			//now using findAndGet* methods to get dicom information
-			long int val_long;
-			dicomDataset->findAndGetLongInt(DCM_Columns, val_long); 
-
 			// width
-			int dcmColumns = val_long;
-
-			dicomDataset->findAndGetLongInt(DCM_Rows, val_long);
+			int dcmColumns = entry.Columns;
 
 			// height
-			int dcmRows = val_long;
-
-			dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient,dcmImagePositionPatient[0],0);
-			dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient,dcmImagePositionPatient[1],1);
-			dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient,dcmImagePositionPatient[2],2);
+			int dcmRows = entry.Rows;
 
       //Position Check
       int useDefaultPos=false;
       
-      if( dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient,dcmImagePositionPatient[2]).bad() && !m_SkipAllNoPosition)
+      if( !entry.HasPosition && !m_SkipAllNoPosition)
       {
         //Skip all not selected
         std::ostringstream stringStream;
@@ -3243,206 +4506,41 @@ bool medOpImporterDicomOffis::BuildDicomFileList(const char *dicomDirABSPath)
           continue;
         }
       }
-      else if (dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient,dcmImagePositionPatient[2]).bad()) 
+      else if (!entry.HasPosition) 
       {
         //Skip all Selected
         sliceNum--;
         continue;
       }
-			dicomDataset->findAndGetFloat64(DCM_ImageOrientationPatient,dcmImageOrientationPatient[0],0);
-			dicomDataset->findAndGetFloat64(DCM_ImageOrientationPatient,dcmImageOrientationPatient[1],1);
-			dicomDataset->findAndGetFloat64(DCM_ImageOrientationPatient,dcmImageOrientationPatient[2],2);
-			dicomDataset->findAndGetFloat64(DCM_ImageOrientationPatient,dcmImageOrientationPatient[3],3);
-			dicomDataset->findAndGetFloat64(DCM_ImageOrientationPatient,dcmImageOrientationPatient[4],4);
-			dicomDataset->findAndGetFloat64(DCM_ImageOrientationPatient,dcmImageOrientationPatient[5],5);
-
-			bool currentSliceIsRotated = false;
-			currentSliceIsRotated = IsRotated(dcmImageOrientationPatient);
-
-			double dcmPixelSpacing[3];
-			dcmPixelSpacing[2] = 1;
-
-			if(dicomDataset->findAndGetFloat64(DCM_PixelSpacing,dcmPixelSpacing[0],0).bad())
-			{
-				//Unable to get element: DCM_PixelSpacing[0];
-				dcmPixelSpacing[0] = 1.0;// for RGB??
-			} 
-			if(dicomDataset->findAndGetFloat64(DCM_PixelSpacing,dcmPixelSpacing[1],1).bad())
-			{
-				//Unable to get element: DCM_PixelSpacing[0];
-				dcmPixelSpacing[1] = 1.0;// for RGB??
-			} 
-
-			double dcmRescaleSlope;
-			if(dicomDataset->findAndGetFloat64(DCM_RescaleSlope,dcmRescaleSlope).bad())
-			{
-				//Unable to get element: DCM_RescaleSlope[0];
-				dcmRescaleSlope = 1;
-			} 
-
-			long dcmHighBit; 
-			double dcmRescaleIntercept;
-			if(dicomDataset->findAndGetLongInt(DCM_HighBit,dcmHighBit).bad())
-			{
-				//Unable to get element: DCM_RescaleIntercept[0];
-				dcmHighBit = 0;
-			} 
-			m_HighBit = dcmHighBit;
-
-			if(dicomDataset->findAndGetFloat64(DCM_RescaleIntercept,dcmRescaleIntercept).bad())
-			{
-				//Unable to get element: DCM_RescaleIntercept[0];
-				dcmRescaleIntercept = 0;
-			}
-			m_RescaleIntercept = dcmRescaleIntercept;
-
-			vtkMAFSmartPointer<vtkImageData> dicomSliceVTKImageData;
-			dicomSliceVTKImageData->SetDimensions(dcmRows, dcmColumns,1);
-			dicomSliceVTKImageData->SetWholeExtent(0,dcmColumns-1,0,dcmRows-1,0,0);
-			dicomSliceVTKImageData->SetUpdateExtent(0,dcmColumns-1,0,dcmRows-1,0,0);
-			dicomSliceVTKImageData->SetExtent(dicomSliceVTKImageData->GetUpdateExtent());
-			dicomSliceVTKImageData->SetNumberOfScalarComponents(1);
-			dicomSliceVTKImageData->SetSpacing(dcmPixelSpacing);
-
-			long dcmPixelRepresentation;
-			dicomDataset->findAndGetLongInt(DCM_PixelRepresentation,dcmPixelRepresentation);
-			dicomDataset->findAndGetLongInt(DCM_BitsAllocated,val_long);
-
-			long dcmLargestImagePixelValue;
-			long dcmSmallestImagePixelValue;
-			dicomDataset->findAndGetLongInt(DCM_SmallestImagePixelValue, dcmSmallestImagePixelValue);
-			dicomDataset->findAndGetLongInt(DCM_LargestImagePixelValue, dcmLargestImagePixelValue);
-
-			// These two lines were used for DP vertical app:
-			// removed to fix bug http://bugzilla.hpc.cineca.it/show_bug.cgi?id=2079
-			//if (dcmSmallestImagePixelValue == dcmLargestImagePixelValue)
-			//  dcmRescaleIntercept = 0;
-
-			if(val_long==16 && dcmPixelRepresentation == 0 )
-			{
-				if(dcmSmallestImagePixelValue*dcmRescaleSlope+dcmRescaleIntercept >= VTK_UNSIGNED_SHORT_MIN && dcmLargestImagePixelValue*dcmRescaleSlope+dcmRescaleIntercept <= VTK_UNSIGNED_SHORT_MAX)
-				{
-					dicomSliceVTKImageData->SetScalarType(VTK_UNSIGNED_SHORT);
-				}
-				else if (dcmSmallestImagePixelValue*dcmRescaleSlope+dcmRescaleIntercept >= VTK_SHORT_MIN && dcmLargestImagePixelValue*dcmRescaleSlope+dcmRescaleIntercept <= VTK_SHORT_MAX)
-				{
-					dicomSliceVTKImageData->SetScalarType(VTK_SHORT);
-				}
-				else
-				{
-					if(!this->m_TestMode)
-					{
-						wxLogMessage(wxString::Format("Inconsistent scalar values. Can not import file <%s>",currentSliceABSFileName));
-						errorOccurred = true;
-						continue;
-					}
-				}
-			}
-			else if(val_long==16 && dcmPixelRepresentation == 1)
-			{
-				if (dcmSmallestImagePixelValue*dcmRescaleSlope+dcmRescaleIntercept >= VTK_SHORT_MIN && dcmLargestImagePixelValue*dcmRescaleSlope+dcmRescaleIntercept <= VTK_SHORT_MAX)
-				{
-					dicomSliceVTKImageData->SetScalarType(VTK_SHORT);
-				}
-				else
-				{
-					if(!this->m_TestMode)
-					{
-						wxLogMessage(wxString::Format("Inconsistent scalar values. Can not import file <%s>",currentSliceABSFileName));
-						errorOccurred = true;
-						continue;
-					}
-				}
-			}
-			else if(val_long==16 && dcmPixelRepresentation == 0)
-			{
-				dicomSliceVTKImageData->SetScalarType(VTK_UNSIGNED_SHORT);
-			}
-			else if(val_long==8)
+			for (int k = 0; k < 6; k++)
 			{
-				dicomSliceVTKImageData->SetScalarType(VTK_CHAR);
+				dcmImageOrientationPatient[k] = entry.Orientation[k];
 			}
 
-			dicomSliceVTKImageData->AllocateScalars();
-			dicomSliceVTKImageData->GetPointData()->GetScalars()->SetName("Scalars");
-			dicomSliceVTKImageData->Update();
-
-			const Uint16 *dicom_buf_short = NULL; 
-			const Uint8* dicom_buf_char = NULL; 
-			if (val_long==16) 
-			{ 
-				dicomDataset->findAndGetUint16Array(DCM_PixelData, dicom_buf_short); 
-				int counter=0; 
-				for(int y=0;y<dcmRows;y++) 
-				{ 
-					for(int x=0;x<dcmColumns;x++) 
-					{ 
-						dicomSliceVTKImageData->GetPointData()->GetScalars()->SetTuple1(counter, dicom_buf_short[dcmColumns*y+x]); 
-						counter++; 
-					} 
-				} 
-			} 
-			else 
-			{ 
-				dicomDataset->findAndGetUint8Array(DCM_PixelData, dicom_buf_char); 
-				int counter=0; 
-				for(int y=0;y<dcmRows;y++) 
-				{ 
-					for(int x=0;x<dcmColumns;x++) 
-					{ 
-						dicomSliceVTKImageData->GetPointData()->GetScalars()->SetTuple1(counter, dicom_buf_char[dcmColumns*y+x]); 
-						counter++; 
-					} 
-				} 
-			} 
+			bool currentSliceIsRotated = false;
+			currentSliceIsRotated = IsRotated(dcmImageOrientationPatient);
 
-			dicomSliceVTKImageData->Update();
+			m_HighBit = entry.HighBit;
+			m_RescaleIntercept = entry.RescaleIntercept;
 
-			if (dcmRescaleSlope != 1 || dcmRescaleIntercept != 0)
+			if (DS_GetScalarType(entry.BitsAllocated, entry.PixelRepresentation, entry.SmallestPixelValue, \
+				entry.LargestPixelValue, entry.RescaleSlope, entry.RescaleIntercept) < 0)
 			{
-				int scalarType = dicomSliceVTKImageData->GetScalarType();
-
-				if (dicomSliceVTKImageData->GetScalarType() == VTK_UNSIGNED_SHORT)
-				{
-					vtkUnsignedShortArray *scalars=vtkUnsignedShortArray::SafeDownCast(dicomSliceVTKImageData->GetPointData()->GetScalars());
-					for(int indexScalar=0;indexScalar<dicomSliceVTKImageData->GetPointData()->GetScalars()->GetNumberOfTuples();indexScalar++)
-					{
-						scalars->SetTuple1(indexScalar,scalars->GetTuple1(indexScalar)*dcmRescaleSlope+dcmRescaleIntercept);//modify scalars using slope and intercept
-					}
-				}
-				else if (dicomSliceVTKImageData->GetScalarType() == VTK_SHORT)
-				{
-					vtkShortArray *scalars=vtkShortArray::SafeDownCast(dicomSliceVTKImageData->GetPointData()->GetScalars());
-					for(int indexScalar=0;indexScalar<dicomSliceVTKImageData->GetPointData()->GetScalars()->GetNumberOfTuples();indexScalar++)
-					{
-						scalars->SetTuple1(indexScalar,scalars->GetTuple1(indexScalar)*dcmRescaleSlope+dcmRescaleIntercept);//modify scalars using slope and intercept
-					}
-				}
-				else if (dicomSliceVTKImageData->GetScalarType() == VTK_CHAR)
+				if(!this->m_TestMode)
 				{
-					vtkCharArray *scalars=vtkCharArray::SafeDownCast(dicomSliceVTKImageData->GetPointData()->GetScalars());
-					for(int indexScalar=0;indexScalar<dicomSliceVTKImageData->GetPointData()->GetScalars()->GetNumberOfTuples();indexScalar++)
-					{
-						scalars->SetTuple1(indexScalar,scalars->GetTuple1(indexScalar)*dcmRescaleSlope+dcmRescaleIntercept);//modify scalars using slope and intercept
-					}
+					wxLogMessage(wxString::Format("Inconsistent scalar values. Can not import file <%s>",currentSliceABSFileName));
+					errorOccurred = true;
+					continue;
 				}
-
-				dicomSliceVTKImageData->Update();
 			}
 
+			const char *dcmModality = entry.Modality.c_str();
 
-			const char *dcmModality = "?";
-			dicomDataset->findAndGetString(DCM_Modality,dcmModality);
-
-			const char *dcmPatientPosition = "?";
-			dicomDataset->findAndGetString(DCM_PatientPosition,dcmPatientPosition);
-			m_PatientPosition = dcmPatientPosition;
+			m_PatientPosition = entry.PatientPosition.c_str();
 
-			const char *dcmStudyInstanceUID = "?";
-			dicomDataset->findAndGetString(DCM_StudyInstanceUID,dcmStudyInstanceUID);
+			const char *dcmStudyInstanceUID = entry.StudyInstanceUID.c_str();
 
-			const char *dcmSeriesInstanceUID = "?";
-			dicomDataset->findAndGetString(DCM_SeriesInstanceUID,dcmSeriesInstanceUID);
+			const char *dcmSeriesInstanceUID = entry.SeriesInstanceUID.c_str();
 
 			//vector of string composed by:
 			//-studyUID
@@ -3511,20 +4609,17 @@ bool medOpImporterDicomOffis::BuildDicomFileList(const char *dicomDirABSPath)
 					} 
 					else
 					{
-						dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient,dcmImagePositionPatient[0],0);
-						dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient,dcmImagePositionPatient[1],1);
-						dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient,dcmImagePositionPatient[2],2);
+						dcmImagePositionPatient[0] = entry.Position[0];
+						dcmImagePositionPatient[1] = entry.Position[1];
+						dcmImagePositionPatient[2] = entry.Position[2];
 					}
 
 					lastZPos = dcmImagePositionPatient[2];
-					dicomSliceVTKImageData->SetOrigin(dcmImagePositionPatient);
-					dicomSliceVTKImageData->Update();
 
-          const char *date,*description,*patientName,*birthdate;
-          dicomDataset->findAndGetString(DCM_PatientsBirthDate,birthdate);
-          dicomDataset->findAndGetString(DCM_StudyDate,date);
-          dicomDataset->findAndGetString(DCM_SeriesDescription,description);
-          dicomDataset->findAndGetString(DCM_PatientsName,patientName);
+          const char *date = entry.StudyDate.c_str();
+          const char *description = entry.SeriesDescription.c_str();
+          const char *patientName = entry.PatientName.c_str();
+          const char *birthdate = entry.PatientBirthDate.c_str();
 
           if (!this->m_TestMode)
           {
@@ -3551,7 +4646,7 @@ bool medOpImporterDicomOffis::BuildDicomFileList(const char *dicomDirABSPath)
 
 					dicomSeries->Append(new medDicomSlice\
 						(m_CurrentSliceABSFileName,dcmImagePositionPatient, dcmImageOrientationPatient, \
-						dicomSliceVTKImageData,description,date,patientName,birthdate));
+						NULL,description,date,patientName,birthdate));
 
 					m_SeriesIDToSlicesListMap.insert\
 						(std::pair<std::vector<mafString>,medDicomSeriesSliceList*>\
@@ -3579,13 +4674,11 @@ bool medOpImporterDicomOffis::BuildDicomFileList(const char *dicomDirABSPath)
           } 
           else
           {
-            dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient,dcmImagePositionPatient[0],0);
-            dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient,dcmImagePositionPatient[1],1);
-            dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient,dcmImagePositionPatient[2],2);
+            dcmImagePositionPatient[0] = entry.Position[0];
+            dcmImagePositionPatient[1] = entry.Position[1];
+            dcmImagePositionPatient[2] = entry.Position[2];
           }
 
-					dicomSliceVTKImageData->SetOrigin(dcmImagePositionPatient);
-					dicomSliceVTKImageData->Update();
 
 					if  (sliceNum > 1)
 					{
@@ -3615,15 +4708,14 @@ bool medOpImporterDicomOffis::BuildDicomFileList(const char *dicomDirABSPath)
 
 					lastZPos = dcmImagePositionPatient[2];
 
-          const char *date,*description,*patientName,*birthdate;
-          dicomDataset->findAndGetString(DCM_PatientsBirthDate,birthdate);
-          dicomDataset->findAndGetString(DCM_StudyDate,date);
-          dicomDataset->findAndGetString(DCM_SeriesDescription,description);
-          dicomDataset->findAndGetString(DCM_PatientsName,patientName);
+          const char *date = entry.StudyDate.c_str();
+          const char *description = entry.SeriesDescription.c_str();
+          const char *patientName = entry.PatientName.c_str();
+          const char *birthdate = entry.PatientBirthDate.c_str();
 
 					m_SeriesIDToSlicesListMap[seriesId]->Append(\
 						new medDicomSlice(m_CurrentSliceABSFileName,dcmImagePositionPatient, \
-						dcmImageOrientationPatient, dicomSliceVTKImageData,description,date,patientName,birthdate));
+						dcmImageOrientationPatient, NULL,description,date,patientName,birthdate));
 
 
 				}
@@ -3680,17 +4772,15 @@ bool medOpImporterDicomOffis::BuildDicomFileList(const char *dicomDirABSPath)
           } 
           else
           {
-            dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient,dcmImagePositionPatient[0],0);
-            dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient,dcmImagePositionPatient[1],1);
-            dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient,dcmImagePositionPatient[2],2);
+            dcmImagePositionPatient[0] = entry.Position[0];
+            dcmImagePositionPatient[1] = entry.Position[1];
+            dcmImagePositionPatient[2] = entry.Position[2];
           }
 
-					dicomSliceVTKImageData->SetOrigin(dcmImagePositionPatient);
-					dicomSliceVTKImageData->Update();
 
-					dicomDataset->findAndGetLongInt(DCM_InstanceNumber,dcmInstanceNumber);
-					dicomDataset->findAndGetLongInt(DCM_CardiacNumberOfImages,dcmCardiacNumberOfImages);
-					dicomDataset->findAndGetFloat64(DCM_TriggerTime,dcmTriggerTime);
+					dcmInstanceNumber = entry.InstanceNumber;
+					dcmCardiacNumberOfImages = entry.CardiacNumberOfImages;
+					dcmTriggerTime = entry.TriggerTime;
 					lastZPos = dcmImagePositionPatient[2];
 
 					if(dcmCardiacNumberOfImages>1)
@@ -3726,11 +4816,10 @@ bool medOpImporterDicomOffis::BuildDicomFileList(const char *dicomDirABSPath)
 						}
 					}
 
-          const char *date,*description,*patientName,*birthdate;
-          dicomDataset->findAndGetString(DCM_PatientsBirthDate,birthdate);
-          dicomDataset->findAndGetString(DCM_StudyDate,date);
-          dicomDataset->findAndGetString(DCM_SeriesDescription,description);
-          dicomDataset->findAndGetString(DCM_PatientsName,patientName);
+          const char *date = entry.StudyDate.c_str();
+          const char *description = entry.SeriesDescription.c_str();
+          const char *patientName = entry.PatientName.c_str();
+          const char *birthdate = entry.PatientBirthDate.c_str();
 
           if(((medGUIDicomSettings*)GetSetting())->GetOutputNameFormat() == medGUIDicomSettings::TRADITIONAL)
           {
@@ -3750,7 +4839,7 @@ bool medOpImporterDicomOffis::BuildDicomFileList(const char *dicomDirABSPath)
 
 					dicomSeries->Append(new medDicomSlice\
 						(m_CurrentSliceABSFileName,dcmImagePositionPatient, dcmImageOrientationPatient, \
-						dicomSliceVTKImageData,description,date,patientName,birthdate, dcmInstanceNumber, dcmCardiacNumberOfImages, dcmTriggerTime));
+						NULL,description,date,patientName,birthdate, dcmInstanceNumber, dcmCardiacNumberOfImages, dcmTriggerTime));
 
 					m_SeriesIDToSlicesListMap.insert\
 						(std::pair<std::vector<mafString>,medDicomSeriesSliceList*>\
@@ -3778,27 +4867,24 @@ bool medOpImporterDicomOffis::BuildDicomFileList(const char *dicomDirABSPath)
           } 
           else
           {
-            dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient,dcmImagePositionPatient[0],0);
-            dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient,dcmImagePositionPatient[1],1);
-            dicomDataset->findAndGetFloat64(DCM_ImagePositionPatient,dcmImagePositionPatient[2],2);
+            dcmImagePositionPatient[0] = entry.Position[0];
+            dcmImagePositionPatient[1] = entry.Position[1];
+            dcmImagePositionPatient[2] = entry.Position[2];
           }
 
-					dicomSliceVTKImageData->SetOrigin(dcmImagePositionPatient);
-					dicomSliceVTKImageData->Update();
 
-					dicomDataset->findAndGetLongInt(DCM_InstanceNumber,dcmInstanceNumber);
-					dicomDataset->findAndGetLongInt(DCM_CardiacNumberOfImages,dcmCardiacNumberOfImages);
-					dicomDataset->findAndGetFloat64(DCM_TriggerTime,dcmTriggerTime);
+					dcmInstanceNumber = entry.InstanceNumber;
+					dcmCardiacNumberOfImages = entry.CardiacNumberOfImages;
+					dcmTriggerTime = entry.TriggerTime;
 
-          const char *date,*description,*patientName,*birthdate;
-          dicomDataset->findAndGetString(DCM_PatientsBirthDate,birthdate);
-          dicomDataset->findAndGetString(DCM_StudyDate,date);
-          dicomDataset->findAndGetString(DCM_SeriesDescription,description);
-          dicomDataset->findAndGetString(DCM_PatientsName,patientName);
+          const char *date = entry.StudyDate.c_str();
+          const char *description = entry.SeriesDescription.c_str();
+          const char *patientName = entry.PatientName.c_str();
+          const char *birthdate = entry.PatientBirthDate.c_str();
 
 					m_SeriesIDToSlicesListMap[seriesId]->Append\
 						(new medDicomSlice(m_CurrentSliceABSFileName,dcmImagePositionPatient,dcmImageOrientationPatient ,\
-						dicomSliceVTKImageData,description,date,patientName,birthdate,dcmInstanceNumber,dcmCardiacNumberOfImages,dcmTriggerTime));
+						NULL,description,date,patientName,birthdate,dcmInstanceNumber,dcmCardiacNumberOfImages,dcmTriggerTime));
 				}
 			}
 
@@ -3809,11 +4895,10 @@ bool medOpImporterDicomOffis::BuildDicomFileList(const char *dicomDirABSPath)
 
 			if (!this->m_TestMode)
 			{
-				progress = i * 100 / m_DICOMDirectoryReader->GetNumberOfFiles();
+				progress = i * 100 / scanEntries.size();
 				mafEventMacro(mafEvent(this,PROGRESSBAR_SET_VALUE,progress));
 			}
 
-			dicomImg.clear();
 			seriesId.clear();
 		}
 
@@ -3995,7 +5080,12 @@ bool medOpImporterDicomOffis::BuildDicomFileList(const char *dicomDirABSPath)
 							// correction in place
 							vtkImageData *imageData = NULL;
 							imageData = currentSlice->GetVTKImageData();
-							assert(imageData);		
+							if (imageData == NULL)
+							{
+								// the pixels of the slice can not be decoded: the slice is not corrected
+								// and the volume build will fail reading it
+								continue;
+							}
 
 							double center[3] = {-9999,-9999,-9999};
 							imageData->GetCenter(center);
@@ -4089,7 +5179,7 @@ bool medOpImporterDicomOffis::BuildDicomFileList(const char *dicomDirABSPath)
 							double orientation[6] = {xv(0),xv(1),xv(2),yv(0),yv(1),yv(2)};
 							currentSlice->SetDcmImageOrientationPatient(orientation);
 
-							currentSlice->GetVTKImageData()->SetOrigin(0,0,bounds[4]);
+							imageData->SetOrigin(0,0,bounds[4]);
 
 						}			
 					}
@@ -4133,6 +5223,8 @@ void medOpImporterDicomOffis::ResetStructure()
 		m_SeriesListbox->Clear();
 	}
 
+	ReleasePreviewCache();
+
 	std::map<std::vector<mafString>,medDicomSeriesSliceList*>::iterator it;
 	for ( it=m_SeriesIDToSlicesListMap.begin() ; it != m_SeriesIDToSlicesListMap.end(); it++ )
 	{
@@ -4276,7 +5368,7 @@ int medOpImporterDicomOffis::GetSliceIDInSeries(int timeId, int heigthId)
 	return (planeIFrameJFileNumberMatrix(heigthId, timeId)); 
 }
 //----------------------------------------------------------------------------
-void medOpImporterDicomOffis::GenerateSliceTexture(int imageID)
+bool medOpImporterDicomOffis::GenerateSliceTexture(int imageID)
 //----------------------------------------------------------------------------
 {
 	// Description:
@@ -4288,13 +5380,18 @@ void medOpImporterDicomOffis::GenerateSliceTexture(int imageID)
 	slice = m_SelectedSeriesSlicesList->Item(imageID)->GetData();
 	assert(slice);
 
-	slice->GetVTKImageData()->Update();
-	slice->GetVTKImageData()->GetBounds(m_SliceBounds);
- 
-
+	LoadPreviewSlice(imageID);
+	vtkImageData *sliceImageData = slice->GetVTKImageData();
+	if (sliceImageData == NULL)
+	{
+		// the pixels of the slice can not be decoded: the texture is not changed
+		return false;
+	}
+	sliceImageData->Update();
+	sliceImageData->GetBounds(m_SliceBounds);
 
 	double Origin[3];
-	m_SelectedSeriesSlicesList->Item(imageID)->GetData()->GetVTKImageData()->GetOrigin(Origin);
+	sliceImageData->GetOrigin(Origin);
 
 	double orientation[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
 	m_SelectedSeriesSlicesList->Item(imageID)->GetData()->GetDcmImageOrientationPatient(orientation);
@@ -4309,7 +5406,7 @@ void medOpImporterDicomOffis::GenerateSliceTexture(int imageID)
 	if (m_CropFlag) 
 	{
 		// this condition is entered even if no crop is performed (?)
-		m_SelectedSeriesSlicesList->Item(imageID)->GetData()->GetVTKImageData()->GetSpacing(spacing);
+		sliceImageData->GetSpacing(spacing);
 
 		m_CropPlane->Update();
 		m_CropPlane->GetOutput()->GetBounds(crop_bounds);
@@ -4356,9 +5453,7 @@ void medOpImporterDicomOffis::GenerateSliceTexture(int imageID)
 		vtkMAFSmartPointer<vtkProbeFilter> probe;
 		probe->SetInput(clip);
 
-		vtkImageData *imageData = NULL;
-		imageData = m_SelectedSeriesSlicesList->Item(imageID)->GetData()->GetVTKImageData();
-		assert(imageData != NULL);
+		vtkImageData *imageData = sliceImageData;
 
 		imageData->GetOrigin(origin);
 		imageData->GetDimensions(dimension);
@@ -4375,7 +5470,7 @@ void medOpImporterDicomOffis::GenerateSliceTexture(int imageID)
 		//rescale to 16 bit
 		if(m_RescaleTo16Bit == TRUE && m_HighBit == 11)
 		{
-			RescaleTo16Bit(m_SelectedSeriesSlicesList->Item(imageID)->GetData()->GetVTKImageData());
+			RescaleTo16Bit(sliceImageData);
 		}
 		m_SliceTexture->SetInput((vtkImageData *)probe->GetOutput());
 	} 
@@ -4384,11 +5479,11 @@ void medOpImporterDicomOffis::GenerateSliceTexture(int imageID)
 		//rescale to 16 bit
 		if(m_RescaleTo16Bit == TRUE && m_HighBit == 11)
 		{
-			RescaleTo16Bit(m_SelectedSeriesSlicesList->Item(imageID)->GetData()->GetVTKImageData());
+			RescaleTo16Bit(sliceImageData);
 		}
 
-		m_SelectedSeriesSlicesList->Item(imageID)->GetData()->GetVTKImageData()->GetScalarRange(range);
-		m_SliceTexture->SetInput(m_SelectedSeriesSlicesList->Item(imageID)->GetData()->GetVTKImageData());
+		sliceImageData->GetScalarRange(range);
+		m_SliceTexture->SetInput(sliceImageData);
 	}
 
 	m_SliceTexture->Modified();
@@ -4399,6 +5494,7 @@ void medOpImporterDicomOffis::GenerateSliceTexture(int imageID)
 
 	m_SliceTexture->MapColorScalarsThroughLookupTableOn();
 	m_SliceTexture->SetLookupTable((vtkLookupTable *)m_SliceLookupTable);
+	return true;
 }
 
 //----------------------------------------------------------------------------
@@ -4425,26 +5521,42 @@ vtkImageData* medOpImporterDicomOffis::GetSliceImageDataFromLocalDicomFileName(m
 	{
 		name = m_SelectedSeriesSlicesList->Item(i)->GetData()->GetSliceABSFileName();
 		wxSplitPath(name, &path, &short_name, &ext);
-		if (sliceName.Compare(short_name) == 0)
-		{
-			m_SelectedSeriesSlicesList->Item(i)->GetData()->GetVTKImageData()->Update();
-			return m_SelectedSeriesSlicesList->Item(i)->GetData()->GetVTKImageData();
-		}
-		else 
+		if (sliceName.Compare(short_name) != 0)
 		{
 			//if dicom file has not extension fit wxSplitPath error
 			short_name = short_name + "." + ext;
-			if (sliceName.Compare(short_name) == 0)
+		}
+		if (sliceName.Compare(short_name) == 0)
+		{
+			// NULL if the pixels of the slice can not be decoded
+			LoadPreviewSlice(i);
+			vtkImageData *imageData = m_SelectedSeriesSlicesList->Item(i)->GetData()->GetVTKImageData();
+			if (imageData)
 			{
-				m_SelectedSeriesSlicesList->Item(i)->GetData()->GetVTKImageData()->Update();
-				return m_SelectedSeriesSlicesList->Item(i)->GetData()->GetVTKImageData();
+				imageData->Update();
 			}
+			return imageData;
 		}
 	}
 
 	return NULL;
 }
 
+//----------------------------------------------------------------------------
+int medOpImporterDicomOffis::GetNumberOfSeriesSlices()
+//----------------------------------------------------------------------------
+{
+	return m_SelectedSeriesSlicesList ? m_SelectedSeriesSlicesList->GetCount() : 0;
+}
+
+//----------------------------------------------------------------------------
+medDicomSlice *medOpImporterDicomOffis::GetSeriesSlice(int imageID)
+//----------------------------------------------------------------------------
+{
+	assert(m_SelectedSeriesSlicesList);
+	return m_SelectedSeriesSlicesList->Item(imageID)->GetData();
+}
+
 //----------------------------------------------------------------------------
 void medOpImporterDicomOffis::ImportDicomTags()
 //----------------------------------------------------------------------------
@@ -4455,12 +5567,12 @@ void medOpImporterDicomOffis::ImportDicomTags()
 	m_TagArray->SetName("TagArray");
 
 	DcmFileFormat dicomImg;  
-	DJDecoderRegistration::registerCodecs(); // register JPEG codecs
-	DcmRLEDecoderRegistration::registerCodecs();
+	DV_RegisterCodecs();
 	OFCondition status = dicomImg.loadFile(m_CurrentSliceABSFileName);//load data into offis structure
 
 	if (!status.good()) 
 	{
+		DV_CleanupCodecs();
 		if(!this->m_TestMode)
 		{
 			mafLogMessage(wxString::Format("File <%s> can not be opened",m_CurrentSliceABSFileName),"Warning!!");
@@ -4471,8 +5583,7 @@ void medOpImporterDicomOffis::ImportDicomTags()
 
 	// decompress data set if compressed
 	ds->chooseRepresentation(EXS_LittleEndianExplicit, NULL);
-	DJDecoderRegistration::cleanup(); // deregister JPEG codecs
-	DcmRLEDecoderRegistration::cleanup();
+	DV_CleanupCodecs();
 	OFString string;
 	DcmStack stack;
 	DcmObject *dobject = NULL;
@@ -4864,8 +5975,14 @@ void medOpImporterDicomOffis::GetDicomRange(double *range)
     slice = m_SelectedSeriesSlicesList->Item(imageID)->GetData();
     assert(slice);
 
-    slice->GetVTKImageData()->Update();
-    slice->GetVTKImageData()->GetScalarRange(sliceRange);
+    vtkImageData *imageData = slice->GetVTKImageData();
+    if (imageData == NULL)
+    {
+      // slices that can not be decoded are not in the range
+      continue;
+    }
+    imageData->Update();
+    imageData->GetScalarRange(sliceRange);
 
     if (sliceRange[0]<range[0]) range[0]=sliceRange[0];
     if (sliceRange[1]>range[1]) range[1]=sliceRange[1];
@@ -5359,6 +6476,10 @@ void medOpImporterDicomOffis::OnScanSlice()
 		GenerateSliceTexture(currImageId);
 		ShowSlice();
 		CameraUpdate();
+
+		// the next slices in the scan direction are decoded while the current one is shown
+		PrefetchNeighbourSlices(m_CurrentSlice < m_LastScannedSlice ? -1 : 1, 0);
+		m_LastScannedSlice = m_CurrentSlice;
 	}
 
 	m_SliceScannerLoadPage->SetValue(m_CurrentSlice);
@@ -5429,6 +6550,10 @@ void medOpImporterDicomOffis::OnScanTime()
 		GenerateSliceTexture(currImageId);
 		ShowSlice();
 		CameraUpdate();
+
+		// the next time frames in the scan direction are decoded while the current one is shown
+		PrefetchNeighbourSlices(0, m_CurrentTime < m_LastScannedTime ? -1 : 1);
+		m_LastScannedTime = m_CurrentTime;
 	}
 	m_TimeScannerLoadPage->SetValue(m_CurrentTime);
 	m_TimeScannerLoadPage->Update();
@@ -5507,6 +6632,47 @@ bool medOpImporterDicomOffis::IsRotated( double dcmImageOrientationPatient[6] )
 		);
 }
 
+vtkImageData* medDicomSlice::GetVTKImageData()
+{
+	if (m_Data == NULL && !m_SliceABSFileName.IsEmpty())
+	{
+		// the directory scan reads only the tags: pixels are read on first access
+		m_Data = ReadVTKImageData(m_SliceABSFileName.GetCStr(), m_DcmImagePositionPatientOriginal);
+	}
+	return m_Data;
+}
+
+vtkImageData* medDicomSlice::ReadVTKImageData(const char *fileName, double origin[3])
+{
+	DICOM_DECODED_SLICE slice;
+	slice.FileName = fileName;
+	slice.Origin[0] = origin[0];
+	slice.Origin[1] = origin[1];
+	slice.Origin[2] = origin[2];
+
+	DV_RegisterCodecs();
+
+	DV_DecodeFile(slice);
+
+	DV_CleanupCodecs();
+
+	if (slice.FileFormat == NULL)
+	{
+		wxLogMessage(wxString::Format("Error decoding the image <%s>",fileName));
+		return NULL;
+	}
+
+	slice.Extent[0] = 0;
+	slice.Extent[1] = slice.Columns - 1;
+	slice.Extent[2] = 0;
+	slice.Extent[3] = slice.Rows - 1;
+	slice.Image = DV_NewImage(slice);
+	DV_CopyPixels(slice);
+
+	slice.Image->Update();
+	return slice.Image;
+}
+
 void medDicomSlice::SetVTKImageData( vtkImageData *data )
 {
 	vtkDEL(m_Data);
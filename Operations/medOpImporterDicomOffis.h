@@ -24,6 +24,7 @@
 #include "mafOp.h"
 #include "vtkImageData.h"
 #include <map>
+#include <list>
 #include "medDicomCardiacMRIHelper.h"
 #include "medGUIWizard.h"
 #include "vtkMatrix4x4.h"
@@ -51,6 +52,8 @@ class vtkActor2D;
 class vtkPolyData;
 class vtkTextMapper;
 class mafVMEGroup;
+class vtkMultiThreader;
+struct DICOM_PREFETCH_JOB;
 
 class medDicomSlice;
 class medDicomSeriesSliceList;
@@ -98,10 +101,11 @@ public:
 	/** Read Dicom file */
 	void ReadDicom();
 
-	/** Create the vtkTexture for slice_num dicom slice: this will be written to m_SliceTexture ivar*/
-	void GenerateSliceTexture(int imageID);
+	/** Create the vtkTexture for slice_num dicom slice: this will be written to m_SliceTexture ivar.
+	Return false, leaving the texture unchanged, if the pixels of the slice can not be decoded. */
+	bool GenerateSliceTexture(int imageID);
 
-	/** Get dicom slice vtkImageData from its local file name */
+	/** Get dicom slice vtkImageData from its local file name, NULL if its pixels can not be decoded */
 	vtkImageData* GetSliceImageDataFromLocalDicomFileName(mafString sliceName);
 
 	/** Apply only to BuildVolume and BuildVolumeCineMRI: 
@@ -139,6 +143,39 @@ public:
 	/** Print the dicom list to the log area */
 	void PrintDicomList(medDicomSeriesSliceList *dicomList);
 
+	/** Return the file name of the index of the directory: the tags of the files read by OpenDir are stored
+	in the index, so that opening the directory again reads only new or modified files. */
+	static mafString GetDicomIndexFileName(const char *dicomDirABSPath);
+
+	/** Enable or disable the index of the directory (enabled by default) */
+	void SetUseDicomIndex(bool use) {m_UseDicomIndex = use;};
+
+	/** Set the file of the index of the directory instead of GetDicomIndexFileName. The index is not
+	used in test mode, unless its file is set. */
+	void SetDicomIndexFileName(const char *fileName) {m_DicomIndexFileName = fileName;};
+
+	/** Return the number of files of the last opened directory whose tags were taken from the index */
+	int GetNumberOfIndexedFiles() const {return m_NumberOfIndexedFiles;};
+
+	/** Return the number of files of the last opened directory whose tags were read from the files */
+	int GetNumberOfReadFiles() const {return m_NumberOfReadFiles;};
+
+	/** Set the number of slices loaded by the preview kept in memory (128 by default) */
+	void SetPreviewCacheSize(int size) {m_PreviewCacheSize = size > 1 ? size : 1;};
+	int GetPreviewCacheSize() const {return m_PreviewCacheSize;};
+
+	/** Return the number of slices shown by the preview that were in memory */
+	int GetPreviewCacheHits() const {return m_PreviewCacheHits;};
+
+	/** Return the number of slices shown by the preview that were decoded in background */
+	int GetPreviewPrefetchHits() const {return m_PreviewPrefetchHits;};
+
+	/** Return the number of slices shown by the preview that were decoded while waiting */
+	int GetPreviewCacheMisses() const {return m_PreviewCacheMisses;};
+
+	/** Return the seconds spent waiting for the decode of the slices shown by the preview */
+	double GetPreviewDecodeTime() const {return m_PreviewDecodeTime;};
+
 protected:
 
   enum DICOM_IMPORTER_GUI_ID
@@ -273,6 +310,39 @@ protected:
 	/** Rescale to 16 Bit */
 	void RescaleTo16Bit(vtkImageData *dataSet);
 
+	/** Get the pixels of a slice with columns x rows pixels that are cropped by the crop plane, as the texture of GenerateSliceTexture:
+	extent can exceed the slice, where the cropped slice is 0 */
+	void GetVolumeSliceExtent(int columns, int rows, double spacing[3], int extent[4]);
+
+	/** Read the slices imageIDs of the selected series for the volume build, cropped and rescaled as by GenerateSliceTexture.
+	Files are decoded in parallel and all together, so the callers pass batches of DICOM_BUILD_BATCH_SIZE slices;
+	the slices are not kept in memory by the series: the caller deletes the images.
+	Return false if a slice can not be decoded. */
+	bool ReadVolumeSlices(const std::vector<int> &imageIDs, std::vector<vtkImageData *> &images);
+
+	/** Load the image data of the slice imageID for the preview, from the slices prefetched in background if possible.
+	Only the last GetPreviewCacheSize() slices loaded by the preview are kept in memory. */
+	void LoadPreviewSlice(int imageID);
+
+	/** Decode in background the slices imageIDs of the selected series, in order; slices previously requested
+	and not in imageIDs are discarded */
+	void PrefetchSlices(const std::vector<int> &imageIDs);
+
+	/** Prefetch the slices following the current one with the given direction of slice and time */
+	void PrefetchNeighbourSlices(int sliceDirection, int timeDirection);
+
+	/** Return true while the prefetch thread has slices to decode */
+	bool IsPrefetchRunning();
+
+	/** Stop the prefetch, forget the slices loaded by the preview and log and reset the statistics of the preview cache */
+	void ReleasePreviewCache();
+
+	/** Return the number of slices of the selected series */
+	int GetNumberOfSeriesSlices();
+
+	/** Return the slice imageID of the selected series */
+	medDicomSlice *GetSeriesSlice(int imageID);
+
   /** Reference system page is shown only if image is the vme output type */
   void UpdateReferenceSystemPageConnection();
 
@@ -395,11 +465,31 @@ protected:
 	mafGUICheckListBox *m_DicomModalityListBox;
   int m_CurrentImageID;
 
+  std::list<medDicomSlice *> m_PreviewSlices; ///< slices loaded by the preview, the most recently shown first
+  int m_PreviewCacheSize;           ///< slices loaded by the preview kept in memory
+  int m_LastScannedSlice;           ///< slice shown before the current one, gives the scan direction for the prefetch
+  int m_LastScannedTime;            ///< time shown before the current one, gives the scan direction for the prefetch
+  vtkMultiThreader *m_PrefetchThreader;
+  int m_PrefetchThreadID;
+  DICOM_PREFETCH_JOB *m_PrefetchJob;
+  int m_PreviewCacheHits;           ///< slices shown that were in memory
+  int m_PreviewPrefetchHits;        ///< slices shown that were decoded in background
+  int m_PreviewCacheMisses;         ///< slices shown that were decoded while waiting
+  double m_PreviewDecodeTime;       ///< seconds spent waiting for the decode of the slices shown
+
+  bool m_UseDicomIndex;             ///< read and write the index of the tags of the directory
+  mafString m_DicomIndexFileName;   ///< file of the index, empty for the file given by GetDicomIndexFileName
+  int m_NumberOfIndexedFiles;       ///< files of the last scan whose tags were taken from the index
+  int m_NumberOfReadFiles;          ///< files of the last scan whose tags were read
+
   double m_TotalDicomRange[2]; ///< contains the scalar range og the full dicom
   double m_TotalDicomSubRange[2]; ///< contains the scalar range og the full dicom
 
 	/** destructor */
 	~medOpImporterDicomOffis();
+
+  /** Test friend */
+  friend class medOpImporterDicomOffisTest;
  
 };
 
@@ -522,12 +612,21 @@ public:
 	/** Set the trigger time of the dicom slice*/
 	void SetDcmTriggerTime(double time){m_DcmTriggerTime = time;};
 
-	/** Retrieve image data*/
-	vtkImageData* GetVTKImageData(){return m_Data;};
+	/** Retrieve image data: if the slice has no image data, it is read from the slice file */
+	vtkImageData* GetVTKImageData();
 
 	/** Set vtkImageData */
 	void SetVTKImageData(vtkImageData *data);
 
+	/** Return true if the image data of the slice is in memory */
+	bool IsVTKImageDataLoaded() const {return m_Data != NULL;};
+
+	/** Set the image data read from the slice file without copying it, e.g. when it was decoded in background */
+	void ShareVTKImageData(vtkImageData *data) {vtkDEL(m_Data); m_Data = data; if (m_Data) m_Data->Register(NULL);};
+
+	/** Release the image data: GetVTKImageData reads it again from the slice file */
+	void ReleaseVTKImageData() {vtkDEL(m_Data);};
+
 	/** Set the DcmImagePositionPatient tag for the slice */
 	void SetDcmImagePositionPatient(double dcmImagePositionPatient[3])
 	{
@@ -650,5 +749,8 @@ protected:
 
   int m_ReferenceSystem;  ///< Store information about the selected reference system (xy, xz, yx). see ID_REFERENCE_SYSTEM enum
   int m_SwapReferenceSystem;
+
+  /** Read the image data of the dicom file with the origin; return NULL if the file can not be decoded */
+  static vtkImageData *ReadVTKImageData(const char *fileName, double origin[3]);
 };
 #endif
@@ -23,6 +23,8 @@
 // "Failure#0: The value of ESP was not properly saved across a function call"
 //----------------------------------------------------------------------------
 #include "medOpSegmentation.h"
+#include "medSegmentationHistory.h"
+#include "medSegmentationSparseMask.h"
 #include "wx/busyinfo.h"
 
 #include "mafMatrix.h"
@@ -61,6 +63,7 @@
 #include "medDeviceButtonsPadMouseDialog.h"
 #include "medViewSliceGlobal.h"
 #include "medVMESegmentationVolume.h"
+#include "medDataPipeCustomSegmentationVolume.h"
 
 #include "medInteractorPERScalarInformation.h"
 #include "medInteractorSegmentationPicker.h"
@@ -107,7 +110,6 @@
 
 #include "vtkMEDVolumeToClosedSmoothSurface.h"
 #include "vtkMEDBinaryImageFloodFill.h"
-#include "vtkImageClip.h"
 
 
 #define max(a,b)(((a) > (b)) ? (a) : (b))
@@ -220,8 +222,8 @@ medOpSegmentation::medOpSegmentation(const wxString &label) : mafOp(label)
 
   m_ManualPER = NULL;
   
-  m_ManualUndoList.clear();
-  m_ManualRedoList.clear();
+  m_ManualHistory = new medSegmentationHistory();
+  m_ManualMask = new medSegmentationSparseMask();
 
   m_PickingStarted = false;
   //////////////////////////////////////////////////////////////////////////
@@ -247,8 +249,8 @@ medOpSegmentation::medOpSegmentation(const wxString &label) : mafOp(label)
   //////////////////////////////////////////////////////////////////////////
   m_RefinementVolumeMask = NULL;
 
-  m_RefinementUndoList.clear();
-  m_RefinementRedoList.clear();
+  m_RefinementHistory = new medSegmentationHistory();
+  m_RefinementMask = new medSegmentationSparseMask();
   //////////////////////////////////////////////////////////////////////////
 
   m_InitialFocalPoint[0]=9999;
@@ -263,6 +265,7 @@ medOpSegmentation::medOpSegmentation(const wxString &label) : mafOp(label)
 
   m_ThresholdVolumeSlice = NULL;
   m_EmptyVolumeSlice = NULL;
+  m_ThresholdPreviewVolume = NULL;
 
   m_LoadedVolume = NULL;
   m_LastMouseMovePointID = 0;
@@ -292,8 +295,18 @@ medOpSegmentation::~medOpSegmentation()
 
   mafDEL(m_OutputVolume);
   mafDEL(m_OutputSurface);
+  if (m_SegmentatedVolume)
+  {
+    // the mask of the tools is deleted with the operation
+    m_SegmentatedVolume->SetRefinementInputMask(NULL);
+  }
   mafDEL(m_SegmentatedVolume);
 
+  cppDEL(m_ManualHistory);
+  cppDEL(m_RefinementHistory);
+  cppDEL(m_ManualMask);
+  cppDEL(m_RefinementMask);
+
   Superclass;
 }
 //----------------------------------------------------------------------------
@@ -388,6 +401,7 @@ void medOpSegmentation::OpDo()
     break;
     case  MANUAL_SEGMENTATION:
     {
+      MaskToVolume(m_ManualMask, m_ManualVolumeMask);
       targetVolume = m_ManualVolumeMask;
     }
     break;
@@ -597,6 +611,7 @@ void medOpSegmentation::RemoveVMEs()
     m_ThresholdVolumeSlice->ReparentTo(NULL);
     mafDEL(m_ThresholdVolumeSlice);
   }
+  mafDEL(m_ThresholdPreviewVolume);
   if(m_EmptyVolumeSlice)
   {
     m_EmptyVolumeSlice->ReparentTo(NULL);
@@ -621,10 +636,8 @@ void medOpSegmentation::OpStop(int result)
     }
   }
 
-  ResetManualUndoList();
-  ResetManualRedoList();
-  ResetRefinementUndoList();
-  ResetRefinementRedoList();
+  m_ManualHistory->Clear();
+  m_RefinementHistory->Clear();
 
   mafEventMacro(mafEvent(this,result));
 }
@@ -957,31 +970,6 @@ void medOpSegmentation::FloodFill(vtkIdType seed)
   int center = seed;
   if(m_GlobalFloodFill == TRUE)
   {
-    UndoRedoState urs;
-    urs.dataArray = vtkUnsignedCharArray::New();
-    urs.dataArray->DeepCopy( m_ManualVolumeMask->GetOutput()->GetVTKData()->GetPointData()->GetScalars() );
-    urs.dataArray->SetName("SCALARS");
-    urs.plane=-1; // indicate that the undo redo data is global and must be performed on manual volume mask (not slice)
-    urs.slice=-1; // indicate that the undo redo data is global and must be performed on manual volume mask (not slice)
-    m_ManualUndoList.push_back( urs );
-    //On edit a new branch of redo-list starts, i need to clear the redo stack
-    ResetManualRedoList();
-
-    m_SegmentationOperationsGui[MANUAL_SEGMENTATION]->Enable(ID_MANUAL_REDO, false);
-    m_SegmentationOperationsGui[MANUAL_SEGMENTATION]->Enable(ID_MANUAL_UNDO, m_ManualUndoList.size()>0);
-
-    wxBusyCursor wait_cursor;
-    wxBusyInfo wait(_("Wait! The algorithm could take long time!"));
-
-    vtkMAFSmartPointer <vtkImageData>dummy;
-    dummy->SetExtent(0,m_VolumeDimensions[0]-1,0,m_VolumeDimensions[1]-1,0,m_VolumeDimensions[2]-1);
-    dummy->SetSpacing(m_VolumeSpacing);
-    dummy->SetOrigin(0,0,0);
-
-    m_ManualVolumeMask->GetOutput()->GetVTKData()->GetPointData()->Update();
-    dummy->SetScalarTypeToUnsignedChar();
-    dummy->GetPointData()->SetScalars(m_ManualVolumeMask->GetOutput()->GetVTKData()->GetPointData()->GetScalars());
-
     int ext[6];
     double low,hi;
     m_ManualRangeSlider->GetSubRange(&low,&hi);
@@ -998,19 +986,27 @@ void medOpSegmentation::FloodFill(vtkIdType seed)
     ext[m_CurrentSlicePlane * 2] = (int)low;
     ext[m_CurrentSlicePlane * 2 + 1] = (int)hi;
 
-    vtkMAFSmartPointer <vtkImageClip> clipper;
-    clipper->SetInput(dummy);
-    clipper->SetOutputWholeExtent(ext);
-    clipper->SetClipData(TRUE);
-    clipper->Update();
-    vtkImageData *clippedDummy = clipper->GetOutput();
-    clippedDummy->Update();
+    // plane and slice -1 indicate that the undo redo data is global (the range of the manual mask)
+    //On edit a new branch of redo-list starts, the history clears the redo stack
+    m_ManualHistory->BeginEdit(m_ManualMask, ext, -1, -1);
+
+    m_SegmentationOperationsGui[MANUAL_SEGMENTATION]->Enable(ID_MANUAL_REDO, false);
+    m_SegmentationOperationsGui[MANUAL_SEGMENTATION]->Enable(ID_MANUAL_UNDO, m_ManualHistory->GetNumberOfUndo()>0);
+
+    wxBusyCursor wait_cursor;
+    wxBusyInfo wait(_("Wait! The algorithm could take long time!"));
+
+    // only the range is read from the tiles of the manual mask
+    vtkMAFSmartPointer<vtkUnsignedCharArray> rangeScalars;
+    rangeScalars->SetName("SCALARS");
+    rangeScalars->SetNumberOfTuples((ext[1]-ext[0]+1)*(ext[3]-ext[2]+1)*(ext[5]-ext[4]+1));
+    m_ManualMask->GetExtent(ext, rangeScalars->GetPointer(0));
 
     vtkMAFSmartPointer <vtkImageData> input;
     input->SetExtent(0,(ext[1]-ext[0]),0,(ext[3]-ext[2]),0,(ext[5]-ext[4]));
     input->SetSpacing(m_VolumeSpacing);
     input->SetOrigin(0,0,0);
-    input->GetPointData()->SetScalars(clippedDummy->GetPointData()->GetScalars());
+    input->GetPointData()->SetScalars(rangeScalars);
     input->SetScalarTypeToUnsignedChar();
     input->Update();
 
@@ -1020,19 +1016,10 @@ void medOpSegmentation::FloodFill(vtkIdType seed)
 
     output->Update();
 
-    vtkUnsignedCharArray* outScalars = (vtkUnsignedCharArray*)m_ManualVolumeMask->GetOutput()->GetVTKData()->GetPointData()->GetScalars();
-    for(int x = ext[0]; x <= ext[1]; x++)
-    {
-      for(int y = ext[2]; y <= ext[3]; y++)
-      {
-        for(int z = ext[4]; z <= ext[5]; z++)
-        {
-          outScalars->SetTuple1(x + y * m_VolumeDimensions[0] + z * m_VolumeDimensions[1] * m_VolumeDimensions[0], output->GetPointData()->GetScalars()->GetTuple1((x-ext[0]) + (y-ext[2]) * (ext[1] - ext[0] + 1) + (z-ext[4]) *  (ext[1] - ext[0] + 1) * (ext[3] - ext[2] + 1)));
-        }
-      }
-    }
-    m_ManualVolumeMask->GetOutput()->GetVTKData()->GetPointData()->SetScalars(outScalars);
-    m_ManualVolumeMask->Update();
+    // the tiles that stay uniform after the fill keep no memory
+    vtkMAFSmartPointer<vtkUnsignedCharArray> outScalars;
+    outScalars->DeepCopy(output->GetPointData()->GetScalars());
+    m_ManualMask->SetExtent(ext, outScalars->GetPointer(0));
 
     UpdateSlice();
     m_View->VmeShow(m_ManualVolumeSlice,true);
@@ -1042,18 +1029,13 @@ void medOpSegmentation::FloodFill(vtkIdType seed)
   }
   else
   {
-    UndoRedoState urs;
-    urs.dataArray = vtkUnsignedCharArray::New();
-    urs.dataArray->DeepCopy( m_ManualVolumeSlice->GetOutput()->GetVTKData()->GetPointData()->GetScalars() );
-    urs.dataArray->SetName("SCALARS");
-    urs.plane=m_CurrentSlicePlane;
-    urs.slice=m_CurrentSliceIndex;
-    m_ManualUndoList.push_back( urs );
-    //On edit a new branch of redo-list starts, i need to clear the redo stack
-    ResetManualRedoList();
+    int extent[6];
+    GetSliceExtent(m_CurrentSlicePlane, m_CurrentSliceIndex, extent);
+    //On edit a new branch of redo-list starts, the history clears the redo stack
+    m_ManualHistory->BeginEdit(m_ManualMask, extent, m_CurrentSlicePlane, m_CurrentSliceIndex);
 
     m_SegmentationOperationsGui[MANUAL_SEGMENTATION]->Enable(ID_MANUAL_REDO, false);
-    m_SegmentationOperationsGui[MANUAL_SEGMENTATION]->Enable(ID_MANUAL_UNDO, m_ManualUndoList.size()>0);
+    m_SegmentationOperationsGui[MANUAL_SEGMENTATION]->Enable(ID_MANUAL_UNDO, m_ManualHistory->GetNumberOfUndo()>0);
     vtkStructuredPoints *input = vtkStructuredPoints::New();
     double dimensions[3];
 
@@ -1142,100 +1124,63 @@ bool medOpSegmentation::Refinement()
     m_ProgressBar->Update();
     m_GuiDialog->Update();
 
-    vtkMAFSmartPointer<vtkUnsignedCharArray> newScalars;
-    newScalars->SetName("SCALARS");
-    newScalars->SetNumberOfTuples(m_VolumeDimensions[0]*m_VolumeDimensions[1]*m_VolumeDimensions[2]);
-
-    double point[3];
-    inputDataSet->GetPoint(m_CurrentSliceIndex*m_VolumeDimensions[0]*m_VolumeDimensions[1], point);
-
-    vtkDataArray *inputScalars = inputDataSet->GetPointData()->GetScalars();
     vtkMAFSmartPointer<vtkUnsignedCharArray> scalars;
     scalars->SetName("SCALARS");
     scalars->SetNumberOfTuples(m_VolumeDimensions[0]*m_VolumeDimensions[1]);
 
     if(m_RefinementEverySlice)
     {
-      for (int i= 0;i<m_VolumeDimensions[2];i++)
+      // the filter refines the slices of the whole mask in parallel
+      vtkMAFSmartPointer<vtkUnsignedCharArray> volumeScalars;
+      volumeScalars->SetName("SCALARS");
+      volumeScalars->SetNumberOfTuples(m_VolumeDimensions[0]*m_VolumeDimensions[1]*m_VolumeDimensions[2]);
+      m_RefinementMask->GetArray(volumeScalars->GetPointer(0));
+
+      vtkMAFSmartPointer<vtkStructuredPoints> im;
+      im->SetDimensions(m_VolumeDimensions[0],m_VolumeDimensions[1],m_VolumeDimensions[2]);
+      im->SetSpacing(m_VolumeSpacing[0],m_VolumeSpacing[1],m_VolumeSpacing[2]);
+      im->GetPointData()->AddArray(volumeScalars);
+      im->GetPointData()->SetActiveScalars("SCALARS");
+      im->SetScalarTypeToUnsignedChar();
+      im->Update();
+
+      vtkMAFSmartPointer<vtkStructuredPoints> filteredImage;
+      if(ApplyRefinementFilter2(im, filteredImage) && filteredImage)
       {
-        progress = (i*100/m_VolumeDimensions[2]);
-        m_ProgressBar->SetValue(progress);
-        m_ProgressBar->Update();
-
-        for (int k=0;k<(m_VolumeDimensions[0]*m_VolumeDimensions[1]);k++)
-        {
-          unsigned char value = inputScalars->GetTuple1(k+i*(m_VolumeDimensions[0]*m_VolumeDimensions[1]));
-          scalars->SetTuple1(k,value);
-        }
-
-        vtkMAFSmartPointer<vtkStructuredPoints> im;
-        im->SetDimensions(m_VolumeDimensions[0],m_VolumeDimensions[1],1);
-        im->SetSpacing(m_VolumeSpacing[0],m_VolumeSpacing[1],0.0);
-        im->GetPointData()->AddArray(scalars);
-        im->GetPointData()->SetActiveScalars("SCALARS");
-        im->SetScalarTypeToUnsignedChar();
-        im->Update();
-
-        vtkMAFSmartPointer<vtkStructuredPoints> filteredImage;
-        if(ApplyRefinementFilter2(im, filteredImage) && filteredImage)
-        {
-          vtkDataArray *binaryScalars = filteredImage->GetPointData()->GetScalars();
-
-          for (int k=0;k<filteredImage->GetNumberOfPoints();k++)
-          {
-            unsigned char value = binaryScalars->GetTuple1(k);
-            newScalars->SetTuple1(k+i*(m_VolumeDimensions[0]*m_VolumeDimensions[1]),value);
-          }
-        }
+        vtkMAFSmartPointer<vtkUnsignedCharArray> binaryScalars;
+        binaryScalars->DeepCopy(filteredImage->GetPointData()->GetScalars());
+        m_RefinementMask->SetArray(binaryScalars->GetPointer(0));
       }
-
     }
     else
     {
-      for (int i= 0;i<m_VolumeDimensions[2];i++)
+      // only the current slice is read from the mask and written back
+      int slice = m_CurrentSliceIndex-1;
+      m_RefinementMask->GetSlice(slice, scalars->GetPointer(0));
+
+      vtkMAFSmartPointer<vtkStructuredPoints> im;
+      im->SetDimensions(m_VolumeDimensions[0],m_VolumeDimensions[1],1);
+      im->SetSpacing(m_VolumeSpacing[0],m_VolumeSpacing[1],0.0);
+      im->GetPointData()->AddArray(scalars);
+      im->GetPointData()->SetActiveScalars("SCALARS");
+      im->SetScalarTypeToUnsignedChar();
+      im->Update();
+
+      vtkMAFSmartPointer<vtkStructuredPoints> filteredImage;
+      if(ApplyRefinementFilter2(im, filteredImage) && filteredImage)
       {
-        if(i != m_CurrentSliceIndex-1)
-          //if(i != zID)
-        {
-          for (int k=0;k<(m_VolumeDimensions[0]*m_VolumeDimensions[1]);k++)
-          {
-            unsigned char value = inputScalars->GetTuple1(k+i*(m_VolumeDimensions[0]*m_VolumeDimensions[1]));
-            newScalars->SetTuple1(k+i*(m_VolumeDimensions[0]*m_VolumeDimensions[1]),value);
-          }
-        }
-        else
-        {
-          for (int k=0;k<(m_VolumeDimensions[0]*m_VolumeDimensions[1]);k++)
-          {
-            unsigned char value = inputScalars->GetTuple1(k+i*(m_VolumeDimensions[0]*m_VolumeDimensions[1]));
-            scalars->SetTuple1(k,value);
-          }
-
-          vtkMAFSmartPointer<vtkStructuredPoints> im;
-          im->SetDimensions(m_VolumeDimensions[0],m_VolumeDimensions[1],1);
-          im->SetSpacing(m_VolumeSpacing[0],m_VolumeSpacing[1],0.0);
-          im->GetPointData()->AddArray(scalars);
-          im->GetPointData()->SetActiveScalars("SCALARS");
-          im->SetScalarTypeToUnsignedChar();
-          im->Update();
-
-          vtkMAFSmartPointer<vtkStructuredPoints> filteredImage;
-          if(ApplyRefinementFilter2(im, filteredImage) && filteredImage)
-          {
-            vtkDataArray *binaryScalars = filteredImage->GetPointData()->GetScalars();
-
-            for (int k=0;k<filteredImage->GetNumberOfPoints();k++)
-            {
-              unsigned char value = binaryScalars->GetTuple1(k);
-              newScalars->SetTuple1(k+i*(m_VolumeDimensions[0]*m_VolumeDimensions[1]),value);
-            }
-          }
-
-        }
-
+        vtkMAFSmartPointer<vtkUnsignedCharArray> binaryScalars;
+        binaryScalars->DeepCopy(filteredImage->GetPointData()->GetScalars());
+        m_RefinementMask->SetSlice(slice, binaryScalars->GetPointer(0));
+        m_RefinementMask->Squeeze(slice, slice);
       }
+    }
 
-    }    
+    // the dense volume is written from the mask only for the display
+    vtkMAFSmartPointer<vtkUnsignedCharArray> newScalars;
+    newScalars->SetName("SCALARS");
+    newScalars->SetNumberOfTuples(m_VolumeDimensions[0]*m_VolumeDimensions[1]*m_VolumeDimensions[2]);
+    m_RefinementMask->GetArray(newScalars->GetPointer(0));
 
     if (inputDataSet->IsA("vtkStructuredPoints"))
     {
@@ -1289,6 +1234,8 @@ bool medOpSegmentation::ApplyRefinementFilter2(vtkStructuredPoints *inputImage,
   filter->SetInput(inputImage);
   filter->SetEdgeSize(m_RefinementRegionsSize);
   filter->SetRemovePeninsulaRegions(m_RemovePeninsulaRegions == TRUE);
+  // same masks as the square scan, on every slice of the input
+  filter->SetMethodToConnectedComponents2D();
   if(m_RefinementSegmentationAction == ID_REFINEMENT_HOLES_FILL)
   {
     filter->SetAlgorithmToFillHoles();
@@ -1867,6 +1814,17 @@ void medOpSegmentation::InitManualVolumeMask()
   m_ManualVolumeMask->SetName("Manual Volume Mask");
   m_ManualVolumeMask->ReparentTo(m_Volume->GetParent());
   m_ManualVolumeMask->Update();
+
+  //The tools edit the tiles of the manual mask: the dense volume is written back only
+  //for the refinement step and for the output
+  vtkDataSet *maskData = m_ManualVolumeMask->GetOutput()->GetVTKData();
+  maskData->Update();
+  m_ManualMask->SetDimensions(m_VolumeDimensions);
+  medDataPipeCustomSegmentationVolume::DataSetToMask(maskData, m_ManualMask);
+
+  //Deltas of the history are valid only for the mask they were computed on
+  m_ManualHistory->Clear();
+  m_ManualHistory->SetDimensions(m_VolumeDimensions);
 }
 
 //------------------------------------------------------------------------
@@ -1884,6 +1842,11 @@ void medOpSegmentation::InitRefinementVolumeMask()
 
   m_RefinementVolumeMask->DeepCopy(m_ManualVolumeMask);
   m_RefinementVolumeMask->SetName("Refinement Volume Mask");
+  m_RefinementMask->DeepCopy(m_ManualMask);
+
+  //Deltas of the history are valid only for the mask they were computed on
+  m_RefinementHistory->Clear();
+  m_RefinementHistory->SetDimensions(m_VolumeDimensions);
   
   m_RefinementVolumeMask->ReparentTo(m_Volume->GetParent());
   vtkLookupTable *lut = m_RefinementVolumeMask->GetMaterial()->m_ColorLut;
@@ -2058,6 +2021,8 @@ void medOpSegmentation::OnAutomaticStepExit()
   {
     m_View->VmeShow(m_ThresholdVolumeSlice,false);
   }
+  // the preview links the empty slice
+  mafDEL(m_ThresholdPreviewVolume);
   if(m_EmptyVolumeSlice)
   {
     m_EmptyVolumeSlice->ReparentTo(NULL);
@@ -2089,6 +2054,7 @@ void medOpSegmentation::OnManualStepExit()
   m_SER->GetAction("pntActionAutomatic")->BindInteractor(m_AutomaticPER);
   //apply residual changes
   ApplyVolumeSliceChanges(); 
+  MaskToVolume(m_ManualMask, m_ManualVolumeMask);
   
   m_View->VmeShow(m_ManualVolumeSlice, false);
   m_GuiDialog->Enable(ID_MANUAL_SEGMENTATION,false);
@@ -2841,18 +2807,14 @@ void medOpSegmentation::StartDraw(mafEvent *e, bool erase)
   UndoBrushPreview();
   if(!m_PickingStarted)
   {
-    UndoRedoState urs;
-    urs.dataArray = vtkUnsignedCharArray::New();
-    urs.dataArray->DeepCopy( m_ManualVolumeSlice->GetOutput()->GetVTKData()->GetPointData()->GetScalars() );
-    urs.dataArray->SetName("SCALARS");
-    urs.plane=m_CurrentSlicePlane;
-    urs.slice=m_CurrentSliceIndex;
-    m_ManualUndoList.push_back( urs );
+    //The slice is copied as reference: only the changes are kept when the edit is closed
+    //On edit a new branch of redo-list starts, the history clears the redo stack
+    int extent[6];
+    GetSliceExtent(m_CurrentSlicePlane, m_CurrentSliceIndex, extent);
+    m_ManualHistory->BeginEdit(m_ManualMask, extent, m_CurrentSlicePlane, m_CurrentSliceIndex);
 
     m_PickingStarted = true;
 
-    //On edit a new branch of redo-list starts, i need to clear the redo stack
-    ResetManualRedoList();
     m_SegmentationOperationsGui[MANUAL_SEGMENTATION]->Enable(ID_MANUAL_REDO, false);
   }
   else
@@ -2906,7 +2868,7 @@ void medOpSegmentation::OnBrushEvent(mafEvent *e)
     SelectBrushImage(datasetPoint[0], datasetPoint[1], datasetPoint[2], m_ManualSegmentationAction == MANUAL_SEGMENTATION_SELECT);
     
 
-    m_SegmentationOperationsGui[MANUAL_SEGMENTATION]->Enable(ID_MANUAL_UNDO, m_ManualUndoList.size()>0);
+    m_SegmentationOperationsGui[MANUAL_SEGMENTATION]->Enable(ID_MANUAL_UNDO, m_ManualHistory->GetNumberOfUndo()>0);
 
     m_View->CameraUpdate();
   }
@@ -2917,6 +2879,7 @@ void medOpSegmentation::SaveRefinementVolumeMask()
 //------------------------------------------------------------------------
 {
   m_SegmentatedVolume->SetRefinementVolumeMask(m_RefinementVolumeMask);
+  m_SegmentatedVolume->SetRefinementInputMask(m_RefinementMask);
   m_SegmentatedVolume->GetOutput()->Update();
   m_SegmentatedVolume->Update();
 }
@@ -3336,66 +3299,47 @@ void medOpSegmentation::OnAutomaticSegmentationEvent(mafEvent *e)
 }
 
 //------------------------------------------------------------------------
-void medOpSegmentation::ReloadUndoRedoState(vtkDataSet *dataSet,UndoRedoState state)
+void medOpSegmentation::ReloadUndoRedoState(bool redo)
 //------------------------------------------------------------------------
-{ 
-  if(state.plane==-1 && state.slice == -1)
-  {
-    m_ManualVolumeMask->GetOutput()->GetVTKData()->GetPointData()->SetScalars(state.dataArray);
-    m_ManualVolumeMask->Update();
+{
+  //Store the changes of the current slice in the manual volume mask and close the current edit
+  UndoBrushPreview();
+  m_ManualHistory->Commit(m_ManualMask);
 
-    UpdateSlice();
-    m_View->VmeShow(m_ManualVolumeSlice,true);
+  int plane, slice;
+  bool available = redo ? m_ManualHistory->GetRedoTarget(plane, slice) : m_ManualHistory->GetUndoTarget(plane, slice);
 
-    CreateRealDrawnImage();
-    OnEventUpdateManualSlice();
-  }
-  else
+  if (available)
   {
-    if (state.plane!=m_CurrentSlicePlane || state.slice!=m_CurrentSliceIndex)
+    //if i changed slice/plane from last edit the undo/redo information
+    //are in the plane-slice of last edit (where i saved last undo info).
+    if ((plane != m_CurrentSlicePlane || slice != m_CurrentSliceIndex) && plane != -1 && slice != -1)
     {
-
-      m_CurrentSlicePlane=state.plane;
-      m_CurrentSliceIndex=state.slice;
-      //m_View->SetSliceAxis(m_CurrentSlicePlane);
+      m_CurrentSlicePlane = plane;
+      m_CurrentSliceIndex = slice;
       UpdateSlice();
       m_View->CameraUpdate();
       m_GuiDialog->Update();
-      InitGui();
-      m_SegmentationOperationsGui[MANUAL_SEGMENTATION]->Update();
     }
 
-    double focalPoint[3];
-    double scaleFactor;
-    GetCameraAttribute(focalPoint, &scaleFactor);
-    double bounds[4];
-    GetVisualizedBounds(focalPoint, scaleFactor, bounds);
-
-    vtkImageData* undoRedoData = vtkImageData::New();
-    undoRedoData->DeepCopy(dataSet);
-    undoRedoData->Update();
-
-    for(int i = 0; i < undoRedoData->GetPointData()->GetScalars()->GetNumberOfTuples(); i++)
-    {
-      undoRedoData->GetPointData()->GetScalars()->SetTuple1(i,(unsigned char)abs(state.dataArray->GetTuple1(i) - dataSet->GetPointData()->GetScalars()->GetTuple1(i)));
-    }
-    undoRedoData->Update();
+    //The delta of the edit is applied on the manual mask,
+    //only the changed tiles are touched
+    if (redo)
+      m_ManualHistory->Redo(m_ManualMask);
+    else
+      m_ManualHistory->Undo(m_ManualMask);
 
-    dataSet->GetPointData()->SetScalars(state.dataArray);
     //Show changes
-    m_ManualVolumeSlice->Update();
+    UpdateSlice();
     m_View->VmeShow(m_ManualVolumeSlice, true);
 
-    //   if(ResetZoom(undoRedoData,bounds))
-    //   {
-    //     m_View->SetSliceAxis(m_CurrentSlicePlane);
-    //   }
-
-    //m_View->CameraUpdate();
     CreateRealDrawnImage();
     OnEventUpdateManualSlice();
-    undoRedoData->Delete();
-  } 
+  }
+
+  //Enable-disable buttons
+  m_SegmentationOperationsGui[MANUAL_SEGMENTATION]->Enable(ID_MANUAL_UNDO, m_ManualHistory->GetNumberOfUndo()>0);
+  m_SegmentationOperationsGui[MANUAL_SEGMENTATION]->Enable(ID_MANUAL_REDO, m_ManualHistory->GetNumberOfRedo()>0);
 }
 
 //------------------------------------------------------------------------
@@ -3482,103 +3426,12 @@ void medOpSegmentation::OnManualSegmentationEvent(mafEvent *e)
     }
   case ID_MANUAL_UNDO:
     {
-      int numOfChanges = m_ManualUndoList.size();
-      if(numOfChanges)
-      {
-        vtkDataSet *dataSet = m_ManualVolumeSlice->GetOutput()->GetVTKData();
-
-        //if i changed slice/plane from last edit the redo information
-        //are in the plane-slice of last edit (where i saved last undo info).
-        if ((m_CurrentSlicePlane!=m_ManualUndoList[numOfChanges-1].plane ||
-            m_CurrentSliceIndex != m_ManualUndoList[numOfChanges-1].slice) &&
-            m_ManualUndoList[numOfChanges-1].plane != -1 &&
-            m_ManualUndoList[numOfChanges-1].slice != -1)
-        {
-          m_CurrentSlicePlane=m_ManualUndoList[numOfChanges-1].plane;
-          m_CurrentSliceIndex=m_ManualUndoList[numOfChanges-1].slice;
-          UpdateSlice();
-          m_View->CameraUpdate();
-          m_GuiDialog->Update();
-        }
-        if(m_ManualUndoList[numOfChanges-1].plane == -1 && m_ManualUndoList[numOfChanges-1].slice == -1)
-        {
-          dataSet = m_ManualVolumeMask->GetOutput()->GetVTKData();
-        }
-        
-        //Add current state to Redo-list
-        UndoBrushPreview();
-        UndoRedoState urs;
-        urs.dataArray = vtkUnsignedCharArray::New();
-        urs.dataArray->DeepCopy( dataSet->GetPointData()->GetScalars() );
-        urs.dataArray->SetName("SCALARS");
-        urs.plane=m_ManualUndoList[numOfChanges-1].plane;
-        urs.slice=m_ManualUndoList[numOfChanges-1].slice;
-        m_ManualRedoList.push_back(urs);
-
-        //Update current slice with Undo-data
-        ReloadUndoRedoState(dataSet,m_ManualUndoList[numOfChanges-1]);
-         
-        //Remove item from undo list
-        vtkDEL(m_ManualUndoList[numOfChanges-1].dataArray);
-        m_ManualUndoList.pop_back();
-
-        //Enable-disable buttons
-        m_SegmentationOperationsGui[MANUAL_SEGMENTATION]->Enable(ID_MANUAL_UNDO, m_ManualUndoList.size()>0);
-        m_SegmentationOperationsGui[MANUAL_SEGMENTATION]->Enable(ID_MANUAL_REDO, true);
-
-        ApplyVolumeSliceChanges();
-      }
+      ReloadUndoRedoState(false);
       break;
     }
   case ID_MANUAL_REDO:
     {
-      int numOfChanges = m_ManualRedoList.size();
-      if(numOfChanges)
-      {
-        vtkDataSet *dataSet = m_ManualVolumeSlice->GetOutput()->GetVTKData();
-
-        //if i changed slice/plane from last edit the redo information
-        //are in the plane-slice of last edit (where i saved last undo info).
-        if ((m_CurrentSlicePlane!=m_ManualRedoList[numOfChanges-1].plane ||
-          m_CurrentSliceIndex != m_ManualRedoList[numOfChanges-1].slice) &&
-          m_ManualRedoList[numOfChanges-1].plane != -1 &&
-          m_ManualRedoList[numOfChanges-1].slice != -1)
-        {
-          m_CurrentSlicePlane=m_ManualRedoList[numOfChanges-1].plane;
-          m_CurrentSliceIndex=m_ManualRedoList[numOfChanges-1].slice;
-          UpdateSlice();
-          m_View->CameraUpdate();
-          m_GuiDialog->Update();
-        }
-        if(m_ManualRedoList[numOfChanges-1].plane == -1 && m_ManualRedoList[numOfChanges-1].slice == -1)
-        {
-          dataSet = m_ManualVolumeMask->GetOutput()->GetVTKData();
-        }
-
-        //Add current state to Undo-list
-        UndoBrushPreview();
-        UndoRedoState urs;
-        urs.dataArray = vtkUnsignedCharArray::New();
-        urs.dataArray->DeepCopy( dataSet->GetPointData()->GetScalars() );
-        urs.dataArray->SetName("SCALARS");
-        urs.plane=m_ManualRedoList[numOfChanges-1].plane;
-        urs.slice=m_ManualRedoList[numOfChanges-1].slice;
-        m_ManualUndoList.push_back(urs);
-
-        //Update current slice with Redo-data
-        ReloadUndoRedoState(dataSet,m_ManualRedoList[numOfChanges-1]);
-       
-        //remove item from undo list
-        vtkDEL(m_ManualRedoList[numOfChanges-1].dataArray);
-        m_ManualRedoList.pop_back();
-
-        //Enable-disable buttons
-        m_SegmentationOperationsGui[MANUAL_SEGMENTATION]->Enable(ID_MANUAL_UNDO, true);
-        m_SegmentationOperationsGui[MANUAL_SEGMENTATION]->Enable(ID_MANUAL_REDO, m_ManualRedoList.size()>0);
-
-        //UndoBrushPreview();
-        ApplyVolumeSliceChanges();
-      }
+      ReloadUndoRedoState(true);
       break;
     }
    default:
@@ -3681,94 +3534,47 @@ void medOpSegmentation::OnRefinementSegmentationEvent(mafEvent *e)
     }
     break;
   case ID_REFINEMENT_UNDO:
-    {
-      int numOfChanges = m_RefinementUndoList.size();
-      if(numOfChanges)
-      {
-        vtkDataSet *dataSet = m_RefinementVolumeMask->GetOutput()->GetVTKData();
-
-        vtkUnsignedCharArray *redoScalars = vtkUnsignedCharArray::New();
-        redoScalars->DeepCopy( dataSet->GetPointData()->GetScalars() );
-        redoScalars->SetName("SCALARS");
-        m_RefinementRedoList.push_back(redoScalars);
-
-        vtkDataArray *undoScalars = m_RefinementUndoList[numOfChanges-1];
-
-        dataSet->GetPointData()->SetScalars(undoScalars);
-        dataSet->Update();
-
-        vtkMAFSmartPointer<vtkStructuredPoints> newDataSet;
-        newDataSet->DeepCopy(dataSet);
-
-        m_RefinementVolumeMask->SetData(newDataSet, m_Volume->GetTimeStamp());
-        
-        m_View->VmeShow(m_RefinementVolumeMask, true);        
-
-        vtkDEL(m_RefinementUndoList[numOfChanges-1]);
-        m_RefinementUndoList.pop_back();
-
-        m_SegmentationOperationsGui[REFINEMENT_SEGMENTATION]->Enable(ID_REFINEMENT_UNDO, m_RefinementUndoList.size()>0);
-        m_SegmentationOperationsGui[REFINEMENT_SEGMENTATION]->Enable(ID_REFINEMENT_REDO, m_RefinementRedoList.size()>0);
-
-        UpdateSlice();
-        m_View->CameraUpdate();
-        m_GuiDialog->Update();
-      }
-      break;
-    }
-
   case ID_REFINEMENT_REDO:
     {
-      int numOfChanges = m_RefinementRedoList.size();
-      if(numOfChanges)
-      {
-        vtkDataSet *dataSet = m_RefinementVolumeMask->GetOutput()->GetVTKData();
-
-        vtkUnsignedCharArray *undoScalars = vtkUnsignedCharArray::New();
-        undoScalars->DeepCopy( dataSet->GetPointData()->GetScalars() );
-        undoScalars->SetName("SCALARS");
-        m_RefinementUndoList.push_back(undoScalars);
-
-        vtkDataArray *redoScalars = m_RefinementRedoList[numOfChanges-1];
-
-        dataSet->GetPointData()->SetScalars(redoScalars);
-        dataSet->Update();
-
-        vtkMAFSmartPointer<vtkStructuredPoints> newDataSet;
-        newDataSet->DeepCopy(dataSet);
+      //The delta of the refinement is applied on the refinement mask
+      bool done;
+      if (e->GetId() == ID_REFINEMENT_REDO)
+        done = m_RefinementHistory->Redo(m_RefinementMask);
+      else
+        done = m_RefinementHistory->Undo(m_RefinementMask);
 
-        m_RefinementVolumeMask->SetData(newDataSet, m_Volume->GetTimeStamp());
+      if(done)
+      {
+        MaskToVolume(m_RefinementMask, m_RefinementVolumeMask);
+        
         m_View->VmeShow(m_RefinementVolumeMask, true);
 
-        vtkDEL(m_RefinementRedoList[numOfChanges-1]);
-        m_RefinementRedoList.pop_back();
-
-        m_SegmentationOperationsGui[REFINEMENT_SEGMENTATION]->Enable(ID_REFINEMENT_UNDO, m_RefinementUndoList.size()>0);
-        m_SegmentationOperationsGui[REFINEMENT_SEGMENTATION]->Enable(ID_REFINEMENT_REDO, m_RefinementRedoList.size()>0);
-
         UpdateSlice();
         m_View->CameraUpdate();
         m_GuiDialog->Update();
       }
+
+      m_SegmentationOperationsGui[REFINEMENT_SEGMENTATION]->Enable(ID_REFINEMENT_UNDO, m_RefinementHistory->GetNumberOfUndo()>0);
+      m_SegmentationOperationsGui[REFINEMENT_SEGMENTATION]->Enable(ID_REFINEMENT_REDO, m_RefinementHistory->GetNumberOfRedo()>0);
       break;
     }
   case ID_REFINEMENT_APPLY:
     {
-      vtkUnsignedCharArray *scalars = vtkUnsignedCharArray::New();
-      scalars->DeepCopy( m_RefinementVolumeMask->GetOutput()->GetVTKData()->GetPointData()->GetScalars() );
-      scalars->SetName("SCALARS");
-
-      m_RefinementUndoList.push_back( scalars );
+      int extent[6] = {0, m_VolumeDimensions[0] - 1, 0, m_VolumeDimensions[1] - 1, 0, m_VolumeDimensions[2] - 1};
+      m_RefinementHistory->BeginEdit(m_RefinementMask, extent);
 
       if (!Refinement())
       {
         break;
       }
 
+      //Only the voxels changed by the refinement are stored
+      m_RefinementHistory->Commit(m_RefinementMask);
+
       SaveRefinementVolumeMask();
 
-      m_SegmentationOperationsGui[REFINEMENT_SEGMENTATION]->Enable(ID_REFINEMENT_UNDO, m_RefinementUndoList.size()>0);
-      m_SegmentationOperationsGui[REFINEMENT_SEGMENTATION]->Enable(ID_REFINEMENT_REDO, m_RefinementRedoList.size()>0);
+      m_SegmentationOperationsGui[REFINEMENT_SEGMENTATION]->Enable(ID_REFINEMENT_UNDO, m_RefinementHistory->GetNumberOfUndo()>0);
+      m_SegmentationOperationsGui[REFINEMENT_SEGMENTATION]->Enable(ID_REFINEMENT_REDO, m_RefinementHistory->GetNumberOfRedo()>0);
 
       UpdateSlice();
       m_View->CameraUpdate();
@@ -4735,7 +4541,7 @@ void medOpSegmentation::InitThresholdVolumeSlice()
 void medOpSegmentation::UpdateVolumeSlice()
 //----------------------------------------------------------------------------
 {
-  if(!m_ManualVolumeSlice || !m_ManualVolumeMask || !m_ManualVolumeMask->GetOutput()->GetVTKData())
+  if(!m_ManualVolumeSlice || !m_ManualVolumeMask || !m_ManualVolumeMask->GetOutput()->GetVTKData() || m_ManualMask->GetNumberOfPoints() == 0)
     return;
 
   m_OldSliceIndex = m_CurrentSliceIndex;
@@ -4747,8 +4553,6 @@ void medOpSegmentation::UpdateVolumeSlice()
   inputData = m_ManualVolumeMask->GetOutput()->GetVTKData();
   inputData->Update();
 
-  vtkDataArray *inputScalars = inputData->GetPointData()->GetScalars();
-
   vtkMAFSmartPointer<vtkUnsignedCharArray> scalars;
   scalars->SetName("SCALARS");
 
@@ -4760,52 +4564,15 @@ void medOpSegmentation::UpdateVolumeSlice()
   
   // Single slice volumes crashes on vmeshow
   int numberOfSlices = 1;
-  int numberOfPoints;
 
   ///////////////////////////////////////////////////////////////////
   //Setting up Scalars this is the same both for structured point
-  //and for rectilinear grid
-  if(m_CurrentSlicePlane == XY)
-  {
-    numberOfPoints = m_VolumeDimensions[0]*m_VolumeDimensions[1];
-    scalars->SetNumberOfTuples(numberOfSlices*numberOfPoints);
-    int z=(m_CurrentSliceIndex-1);
-    for (int x=0; x<m_VolumeDimensions[0]; x++)
-      for (int y=0; y<m_VolumeDimensions[1]; y++)
-      { 
-        int volPos=x + y*m_VolumeDimensions[0] + z*m_VolumeDimensions[0]*m_VolumeDimensions[1];
-        int slicePos = x + y*m_VolumeDimensions[0] + 0;
-        scalars->SetTuple1(slicePos, inputScalars->GetTuple1(volPos) );
-      }
-  }
-
-  else if(m_CurrentSlicePlane == YZ)
-  {
-    numberOfPoints = m_VolumeDimensions[1] * m_VolumeDimensions[2];
-    scalars->SetNumberOfTuples(numberOfSlices*numberOfPoints);
-    int x=(m_CurrentSliceIndex-1);
-    for (int y=0; y<m_VolumeDimensions[1]; y++)
-      for (int z=0; z<m_VolumeDimensions[2]; z++)
-      { 
-        int volPos=x + y*m_VolumeDimensions[0] + z*m_VolumeDimensions[0]*m_VolumeDimensions[1];
-        int slicePos=0 + y*numberOfSlices + z*numberOfSlices*m_VolumeDimensions[1];
-        scalars->SetTuple1(slicePos, inputScalars->GetTuple1(volPos) );
-      }
-  }
-
-  else if(m_CurrentSlicePlane == XZ)
-  {
-    numberOfPoints = m_VolumeDimensions[0] * m_VolumeDimensions[2];
-    scalars->SetNumberOfTuples(numberOfSlices*numberOfPoints);
-    int y=(m_CurrentSliceIndex-1);
-    for (int x=0; x<m_VolumeDimensions[0]; x++)
-      for (int z=0; z<m_VolumeDimensions[2]; z++)
-      { 
-        int volPos=x + y*m_VolumeDimensions[0] + z*m_VolumeDimensions[0]*m_VolumeDimensions[1];
-        int slicePos=x + 0 + z*m_VolumeDimensions[0]*numberOfSlices;
-        scalars->SetTuple1(slicePos, inputScalars->GetTuple1(volPos) );
-      }
-  }
+  //and for rectilinear grid: the points of the slice of every plane
+  //are ordered as the box of its extent, read from the manual mask
+  int extent[6];
+  GetSliceExtent(m_CurrentSlicePlane, m_CurrentSliceIndex, extent);
+  scalars->SetNumberOfTuples((extent[1]-extent[0]+1)*(extent[3]-extent[2]+1)*(extent[5]-extent[4]+1));
+  m_ManualMask->GetExtent(extent, scalars->GetPointer(0));
 
 
   //////////////////////////////////////////////////////////////////////////
@@ -4896,97 +4663,80 @@ void medOpSegmentation::UpdateVolumeSlice()
 void medOpSegmentation::ApplyVolumeSliceChanges()
 //----------------------------------------------------------------------------
 {
-  vtkDataSet *inputDataSet = vtkDataSet::SafeDownCast(m_ManualVolumeMask->GetOutput()->GetVTKData());
+  if (!m_ManualVolumeSlice || m_ManualMask->GetNumberOfPoints() == 0)
+    return;
+
   vtkDataSet *sliceDataSet = vtkDataSet::SafeDownCast(m_ManualVolumeSlice->GetOutput()->GetVTKData());
   
-  if (inputDataSet && sliceDataSet)
+  if (sliceDataSet && sliceDataSet->GetPointData()->GetScalars())
   {
-    vtkDataArray *inputScalars = inputDataSet->GetPointData()->GetScalars();
-    vtkDataArray *scalars = sliceDataSet->GetPointData()->GetScalars();
+    int extent[6];
+    GetSliceExtent(m_OldSlicePlane, m_OldSliceIndex, extent);
 
-    int numberOfPoints;
-    int numberOfSlices=1;
-    
-    if(m_OldSlicePlane == XY)
-    {
-      numberOfPoints = m_VolumeDimensions[0]*m_VolumeDimensions[1];
-      int z=(m_OldSliceIndex-1);
-      for (int x=0; x<m_VolumeDimensions[0]; x++)
-        for (int y=0; y<m_VolumeDimensions[1]; y++)
-        { 
-          int volPos=x + y*m_VolumeDimensions[0] + z*m_VolumeDimensions[0]*m_VolumeDimensions[1];
-          int slicePos = x + y*m_VolumeDimensions[0] + 0;
-          inputScalars->SetTuple1(volPos, scalars->GetTuple1(slicePos) );
-        }
-    }
+    vtkDataArray *scalars = sliceDataSet->GetPointData()->GetScalars();
+    if (scalars->GetNumberOfTuples() != (extent[1]-extent[0]+1)*(extent[3]-extent[2]+1)*(extent[5]-extent[4]+1))
+      return;
 
-    else if(m_OldSlicePlane == YZ)
+    //Only the tiles crossed by the slice are written, the ones that stay uniform keep no memory
+    vtkUnsignedCharArray *sliceScalars = vtkUnsignedCharArray::SafeDownCast(scalars);
+    if (sliceScalars)
     {
-      numberOfPoints = m_VolumeDimensions[1] * m_VolumeDimensions[2];
-      int x=(m_OldSliceIndex-1);
-      for (int y=0; y<m_VolumeDimensions[1]; y++)
-        for (int z=0; z<m_VolumeDimensions[2]; z++)
-        { 
-          int volPos=x + y*m_VolumeDimensions[0] + z*m_VolumeDimensions[0]*m_VolumeDimensions[1];
-          int slicePos=0 + y*numberOfSlices + z*numberOfSlices*m_VolumeDimensions[1];
-          inputScalars->SetTuple1(volPos, scalars->GetTuple1(slicePos) );
-        }
+      m_ManualMask->SetExtent(extent, sliceScalars->GetPointer(0));
     }
-
-    else if(m_OldSlicePlane == XZ)
+    else
     {
-      numberOfPoints = m_VolumeDimensions[0] * m_VolumeDimensions[2];
-      int y=(m_OldSliceIndex-1);
-      for (int x=0; x<m_VolumeDimensions[0]; x++)
-        for (int z=0; z<m_VolumeDimensions[2]; z++)
-        { 
-          int volPos=x + y*m_VolumeDimensions[0] + z*m_VolumeDimensions[0]*m_VolumeDimensions[1];
-          int slicePos=x + 0 + z*m_VolumeDimensions[0]*numberOfSlices;
-          inputScalars->SetTuple1(volPos, scalars->GetTuple1(slicePos) );
-        }
+      vtkMAFSmartPointer<vtkUnsignedCharArray> ucScalars;
+      ucScalars->DeepCopy(scalars);
+      m_ManualMask->SetExtent(extent, ucScalars->GetPointer(0));
     }
-    
-    m_ManualVolumeMask->Update();
   }
 
 }
 
 //----------------------------------------------------------------------------
-void medOpSegmentation::ResetManualRedoList()
+void medOpSegmentation::GetSliceExtent(int plane, int slice, int extent[6])
 //----------------------------------------------------------------------------
 {
-  for (int i=0;i<m_ManualRedoList.size();i++)
-    vtkDEL(m_ManualRedoList[i].dataArray);
-  m_ManualRedoList.clear();
+  extent[0] = 0; extent[1] = m_VolumeDimensions[0] - 1;
+  extent[2] = 0; extent[3] = m_VolumeDimensions[1] - 1;
+  extent[4] = 0; extent[5] = m_VolumeDimensions[2] - 1;
+
+  // slice indexes start from 1
+  if(plane == XY)
+    extent[4] = extent[5] = slice - 1;
+  else if(plane == YZ)
+    extent[0] = extent[1] = slice - 1;
+  else if(plane == XZ)
+    extent[2] = extent[3] = slice - 1;
 }
 
 //----------------------------------------------------------------------------
-void medOpSegmentation::ResetManualUndoList()
+void medOpSegmentation::MaskToVolume(medSegmentationSparseMask *mask, mafVMEVolumeGray *volume)
 //----------------------------------------------------------------------------
 {
-  for (int i=0;i<m_ManualUndoList.size();i++)
-    vtkDEL(m_ManualUndoList[i].dataArray);
-  m_ManualUndoList.clear();
-}
+  if(!volume || !volume->GetOutput()->GetVTKData())
+    return;
 
-//----------------------------------------------------------------------------
-void medOpSegmentation::ResetRefinementRedoList()
-//----------------------------------------------------------------------------
-{
-  for (int i=0;i<m_RefinementRedoList.size();i++)
-    vtkDEL(m_RefinementRedoList[i]);
-  m_RefinementRedoList.clear();
-}
+  vtkDataSet *data = volume->GetOutput()->GetVTKData();
+  data->Update();
+  if (data->GetNumberOfPoints() != mask->GetNumberOfPoints())
+    return;
 
-//----------------------------------------------------------------------------
-void medOpSegmentation::ResetRefinementUndoList()
-//----------------------------------------------------------------------------
-{
-  for (int i=0;i<m_RefinementUndoList.size();i++)
-    vtkDEL(m_RefinementUndoList[i]);
-  m_RefinementUndoList.clear();
-}
+  vtkUnsignedCharArray *scalars = vtkUnsignedCharArray::SafeDownCast(data->GetPointData()->GetScalars());
+  if (scalars == NULL || scalars->GetNumberOfComponents() != 1)
+  {
+    vtkMAFSmartPointer<vtkUnsignedCharArray> newScalars;
+    newScalars->SetName("SCALARS");
+    newScalars->SetNumberOfTuples(mask->GetNumberOfPoints());
+    data->GetPointData()->SetScalars(newScalars);
+    scalars = newScalars;
+  }
 
+  mask->GetArray(scalars->GetPointer(0));
+  scalars->Modified();
+  data->Modified();
+  volume->Update();
+}
 
 //----------------------------------------------------------------------------
 void medOpSegmentation::InitMaskColorLut(vtkLookupTable *lut)
@@ -5091,33 +4841,44 @@ void medOpSegmentation::UpdateThresholdRealTimePreview()
 //   m_OldAutomaticThreshold = m_AutomaticThreshold;
 //   m_OldAutomaticUpperThreshold = m_AutomaticUpperThreshold;
   
-  medVMESegmentationVolume *tVol;
-  mafNEW(tVol);
-
-  tVol->SetVolumeLink(m_EmptyVolumeSlice);
-  tVol->SetName("Threshold Volume");
-  tVol->ReparentTo(tVol->GetParent());
-  tVol->SetDoubleThresholdModality(true);
-  tVol->Update();
+  // the preview is kept between calls so that its pipe thresholds again only the slices whose threshold changed
+  if (m_ThresholdPreviewVolume == NULL)
+  {
+    mafNEW(m_ThresholdPreviewVolume);
 
+    m_ThresholdPreviewVolume->SetVolumeLink(m_EmptyVolumeSlice);
+    m_ThresholdPreviewVolume->SetName("Threshold Volume");
+    m_ThresholdPreviewVolume->ReparentTo(m_ThresholdPreviewVolume->GetParent());
+    m_ThresholdPreviewVolume->SetDoubleThresholdModality(true);
+    m_ThresholdPreviewVolume->Update();
+  }
+  else if (m_ThresholdPreviewVolume->GetVolumeLink() != m_EmptyVolumeSlice)
+  {
+    m_ThresholdPreviewVolume->SetVolumeLink(m_EmptyVolumeSlice);
+    m_ThresholdPreviewVolume->Update();
+  }
+  medVMESegmentationVolume *tVol = m_ThresholdPreviewVolume;
 
-  tVol->RemoveAllRanges();
   if (m_AutomaticGlobalThreshold == RANGE)
   {
-    int result;
-    tVol->SetAutomaticSegmentationThresholdModality(medVMESegmentationVolume::RANGE);
+    // the slice uses the threshold of the first range containing it
+    double threshold = m_AutomaticThreshold;
+    double upperThreshold = m_AutomaticUpperThreshold;
     for (int i=0;i<m_AutomaticRanges.size();i++)
     {
       if(m_CurrentSliceIndex >= m_AutomaticRanges[i].m_StartSlice + 1 && m_CurrentSliceIndex <= m_AutomaticRanges[i].m_EndSlice + 1)
-        result = tVol->AddRange(0,1,m_AutomaticRanges[i].m_ThresholdValue,m_AutomaticRanges[i].m_UpperThresholdValue);
-      
-//       if (result == MAF_ERROR)
-//       {
-//         return;
-//       }
+      {
+        threshold = m_AutomaticRanges[i].m_ThresholdValue;
+        upperThreshold = m_AutomaticRanges[i].m_UpperThresholdValue;
+        break;
+      }
     }
-    if(tVol->GetNumberOfRanges() == 0)
-      result = tVol->AddRange(0,1,m_AutomaticThreshold,m_AutomaticUpperThreshold);
+
+    tVol->SetAutomaticSegmentationThresholdModality(medVMESegmentationVolume::RANGE);
+    if (tVol->GetNumberOfRanges() == 0)
+      tVol->AddRange(0,1,threshold,upperThreshold);
+    else
+      tVol->UpdateRange(0,0,1,threshold,upperThreshold);
   }
   else
   {
@@ -5160,7 +4921,6 @@ void medOpSegmentation::UpdateThresholdRealTimePreview()
   //m_View->VmeShow(m_ThresholdVolumeSlice,true);
 
   //m_View->CameraUpdate();
-  mafDEL(tVol);
 }
 
 //----------------------------------------------------------------------------
@@ -71,6 +71,8 @@ class vtkPolyDataMapper;
 class vtkActor;
 class vtkStructuredPoints;
 class vtkUnsignedCharArray;
+class medSegmentationHistory;
+class medSegmentationSparseMask;
 class medViewSliceNotInterpolated;
 class wxStaticBoxSizer;
 
@@ -385,6 +387,7 @@ protected:
   mafVMEVolumeGray *m_ThresholdVolume;  //<Volume mask for thresholding
   mafVMEVolumeGray *m_ThresholdVolumeSlice; //<Single slice volume mask for real-time thresholding preview
   mafVMEVolumeGray *m_EmptyVolumeSlice; //<Single slice volume that represent current slice (for real-time thresholding preview)
+  medVMESegmentationVolume *m_ThresholdPreviewVolume; //<Segmentation of the current slice kept by the real-time thresholding preview
   mafVMEVolumeGray *m_OutputVolume;     //<Output volume
   mafVMESurface *m_OutputSurface;          //<Output Surface
   wxStaticText *m_SnippetsLabel;        //<Suggestion labels - GUI
@@ -393,13 +396,6 @@ protected:
   //////////////////////////////////////////////////////////////////////////
   //Manual segmentation stuff
   //////////////////////////////////////////////////////////////////////////
-  typedef struct urstate
-  {
-    int plane;
-    int slice;
-    vtkUnsignedCharArray *dataArray;
-  } UndoRedoState; //<Undo Redo data structure
-
   /** Save the volume mask for the procedural segmentation volume */
   void InitManualVolumeMask();
   
@@ -418,14 +414,14 @@ protected:
   /** Trap events raised from the brush */
   void OnBrushEvent(mafEvent *e);
 
-  /** Relead the previous/next undo/redo state*/
-  void ReloadUndoRedoState(vtkDataSet *dataSet, UndoRedoState state);
-  
-  /** Reset undo list*/
-  void ResetManualUndoList();
-  
-  /** Reset redo list */
-  void ResetManualRedoList();
+  /** Relead the previous (redo false) or the next (redo true) undo/redo state*/
+  void ReloadUndoRedoState(bool redo);
+
+  /** Get the extent of the manual volume mask covered by the slice of the plane */
+  void GetSliceExtent(int plane, int slice, int extent[6]);
+
+  /** Write the values of the mask edited by the tools in the volume, used only for display and output */
+  void MaskToVolume(medSegmentationSparseMask *mask, mafVMEVolumeGray *volume);
   
   /** Enable manual segmentation gui widget */
   void EnableManualSegmentationGui();
@@ -437,6 +433,7 @@ protected:
   void CreateRealDrawnImage();
 
   mafVMEVolumeGray *m_ManualVolumeMask;         //< Manual volume mask
+  medSegmentationSparseMask *m_ManualMask;      //< Manual mask edited by the tools
   mafVMEVolumeGray *m_ManualVolumeSlice;        //< Single slice manual volume mask
   mafGUIFloatSlider *m_ManualBrushSizeSlider;   //<Brush size slider - GUI
   wxTextCtrl *m_ManualBrushSizeText;            //<Brush size text box - GUI
@@ -451,8 +448,7 @@ protected:
   int m_ManualRefinementRegionsSize;            //<Refinement region size
   wxComboBox *m_ManualRefinementComboBox;       //<Refinement action combo - GUI
   wxTextCtrl *m_ManualRefinementRegionSizeText; //<Refinement size text - GUI
-  std::vector<UndoRedoState> m_ManualUndoList;  //< Undo stack
-  std::vector<UndoRedoState> m_ManualRedoList;  // Redo stack
+  medSegmentationHistory *m_ManualHistory;      //< Undo/redo history of manual edits
   bool m_PickingStarted;                        //<Determine if picking has started
   medInteractorPERBrushFeedback *m_ManualPER;   //<Dynamic event router
   double m_CurrentBrushMoveEventCount;          //<Id for mouse move event raised by the brush
@@ -553,12 +549,6 @@ protected:
   /** Save the volume mask for the procedural segmentation volume */
   void SaveRefinementVolumeMask();
   
-  /** Reset refinement undo list */
-  void ResetRefinementUndoList();
-  
-  /** Reset refinement redo list */
-  void ResetRefinementRedoList();
-
   /** Apply refinement algorithm implemented with ITK (not used) */
   bool ApplyRefinementFilter(vtkStructuredPoints *inputImage, vtkStructuredPoints *outputImage);
 
@@ -575,6 +565,7 @@ protected:
   void UpdateThresholdVolumeData();
 
   mafVMEVolumeGray *m_RefinementVolumeMask; //<Refinement volume mask
+  medSegmentationSparseMask *m_RefinementMask; //<Refinement mask edited by the tools
   int m_RefinementSegmentationAction;       //<Refinement action fill holes or remove islands
   int m_RefinementRegionsSize;              //<Size for region recognition
   int m_RefinementMajorityThreshold;        //<Used in itk algorithm (not yet exposed and used)
@@ -584,8 +575,7 @@ protected:
   double m_InitialFocalPoint[3];            //<Initial camera focal point
   double m_InitialScaleFactor;              //<Initial camera scale factor
 
-  std::vector<vtkUnsignedCharArray *> m_RefinementUndoList; //<Refinement undo list
-  std::vector<vtkUnsignedCharArray *> m_RefinementRedoList; //<Refinement redo list
+  medSegmentationHistory *m_RefinementHistory; //<Refinement undo/redo history
 
   int m_MajorityThreshold;                   //<Used in itk algorithm (not yet exposed and used)
 
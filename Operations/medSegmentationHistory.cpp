@@ -0,0 +1,682 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: medSegmentationHistory
+
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "medDefines.h"
+//----------------------------------------------------------------------------
+// NOTE: Every CPP file in the MAF must include "mafDefines.h" as first.
+// This force to include Window,wxWidgets and VTK exactly in this order.
+// Failing in doing this will result in a run-time error saying:
+// "Failure#0: The value of ESP was not properly saved across a function call"
+//----------------------------------------------------------------------------
+
+#include "medSegmentationHistory.h"
+#include "medSegmentationSparseMask.h"
+#include "vtkUnsignedCharArray.h"
+
+#include <string.h>
+
+//----------------------------------------------------------------------------
+// constants :
+//----------------------------------------------------------------------------
+const unsigned long DEFAULT_MEMORY_LIMIT = 64 * 1024 * 1024;
+const int MAX_RUN = 65535; // runs are stored as unsigned short
+
+//----------------------------------------------------------------------------
+medSegmentationHistory::medSegmentationHistory()
+//----------------------------------------------------------------------------
+{
+  m_Dimensions[0] = m_Dimensions[1] = m_Dimensions[2] = 0;
+  m_MemoryLimit = DEFAULT_MEMORY_LIMIT;
+  m_MemorySize = 0;
+  m_Reference = NULL;
+  m_ReferenceSize = 0;
+  m_SpillFile = NULL;
+  m_NumberOfSpilledEdits = 0;
+}
+//----------------------------------------------------------------------------
+medSegmentationHistory::~medSegmentationHistory()
+//----------------------------------------------------------------------------
+{
+  Clear();
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistory::SetDimensions(const int dims[3])
+//----------------------------------------------------------------------------
+{
+  if (dims[0] == m_Dimensions[0] && dims[1] == m_Dimensions[1] && dims[2] == m_Dimensions[2])
+    return;
+
+  Clear();
+  m_Dimensions[0] = dims[0];
+  m_Dimensions[1] = dims[1];
+  m_Dimensions[2] = dims[2];
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistory::GetDimensions(int dims[3])
+//----------------------------------------------------------------------------
+{
+  dims[0] = m_Dimensions[0];
+  dims[1] = m_Dimensions[1];
+  dims[2] = m_Dimensions[2];
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistory::SetMemoryLimit(unsigned long limit)
+//----------------------------------------------------------------------------
+{
+  m_MemoryLimit = limit;
+  SpillDeltas();
+}
+//----------------------------------------------------------------------------
+unsigned char *medSegmentationHistory::GetValues(vtkUnsignedCharArray *scalars)
+//----------------------------------------------------------------------------
+{
+  if (scalars == NULL || scalars->GetNumberOfComponents() != 1 ||
+    scalars->GetNumberOfTuples() != (vtkIdType)m_Dimensions[0] * m_Dimensions[1] * m_Dimensions[2] ||
+    scalars->GetNumberOfTuples() == 0)
+  {
+    return NULL;
+  }
+  return scalars->GetPointer(0);
+}
+//----------------------------------------------------------------------------
+bool medSegmentationHistory::IsValidMask(medSegmentationSparseMask *mask)
+//----------------------------------------------------------------------------
+{
+  if (mask == NULL || mask->GetNumberOfPoints() == 0)
+    return false;
+
+  int dims[3];
+  mask->GetDimensions(dims);
+  return dims[0] == m_Dimensions[0] && dims[1] == m_Dimensions[1] && dims[2] == m_Dimensions[2];
+}
+//----------------------------------------------------------------------------
+int medSegmentationHistory::GetNumberOfTiles(const int extent[6])
+//----------------------------------------------------------------------------
+{
+  int n = 1;
+  for (int i = 0; i < 3; i++)
+    n *= (extent[2*i+1] - extent[2*i] + TILE_SIZE) / TILE_SIZE;
+  return n;
+}
+//----------------------------------------------------------------------------
+int medSegmentationHistory::GetTileBox(const int extent[6], int t, int box[6])
+//----------------------------------------------------------------------------
+{
+  int n = 1;
+  for (int i = 0; i < 3; i++)
+  {
+    int nTiles = (extent[2*i+1] - extent[2*i] + TILE_SIZE) / TILE_SIZE;
+    int tile = t % nTiles;
+    t /= nTiles;
+
+    box[2*i] = extent[2*i] + tile * TILE_SIZE;
+    box[2*i+1] = box[2*i] + TILE_SIZE - 1;
+    if (box[2*i+1] > extent[2*i+1])
+      box[2*i+1] = extent[2*i+1];
+    n *= box[2*i+1] - box[2*i] + 1;
+  }
+  return n;
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistory::BeginEdit(vtkUnsignedCharArray *scalars, const int extent[6], int plane, int slice)
+//----------------------------------------------------------------------------
+{
+  unsigned char *values = GetValues(scalars);
+  if (values == NULL)
+    return;
+
+  Commit(scalars);
+  //On edit a new branch of redo-list starts
+  ClearRedo();
+
+  EDIT *edit = OpenEdit(extent, plane, slice);
+  if (edit == NULL)
+    return;
+
+  const int *ext = edit->Extent;
+  const int width = ext[1] - ext[0] + 1;
+  unsigned char *ref = m_Reference;
+  for (int z = ext[4]; z <= ext[5]; z++)
+  {
+    for (int y = ext[2]; y <= ext[3]; y++, ref += width)
+    {
+      memcpy(ref, values + ext[0] + (vtkIdType)m_Dimensions[0] * (y + (vtkIdType)m_Dimensions[1] * z), width);
+    }
+  }
+
+  SpillDeltas();
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistory::BeginEdit(medSegmentationSparseMask *mask, const int extent[6], int plane, int slice)
+//----------------------------------------------------------------------------
+{
+  if (!IsValidMask(mask))
+    return;
+
+  Commit(mask);
+  //On edit a new branch of redo-list starts
+  ClearRedo();
+
+  EDIT *edit = OpenEdit(extent, plane, slice);
+  if (edit == NULL)
+    return;
+
+  mask->GetExtent(edit->Extent, m_Reference);
+  SpillDeltas();
+}
+//----------------------------------------------------------------------------
+medSegmentationHistory::EDIT *medSegmentationHistory::OpenEdit(const int extent[6], int plane, int slice)
+//----------------------------------------------------------------------------
+{
+  EDIT *edit = new EDIT;
+  edit->Plane = plane;
+  edit->Slice = slice;
+  edit->DeltaSize = 0;
+  edit->FileOffset = -1;
+  for (int i = 0; i < 3; i++)
+  {
+    edit->Extent[2*i] = extent[2*i] < 0 ? 0 : extent[2*i];
+    edit->Extent[2*i+1] = extent[2*i+1] >= m_Dimensions[i] ? m_Dimensions[i] - 1 : extent[2*i+1];
+    if (edit->Extent[2*i] > edit->Extent[2*i+1])
+    {
+      delete edit;
+      return NULL;
+    }
+  }
+
+  const int *ext = edit->Extent;
+  m_ReferenceSize = (unsigned long)(ext[1] - ext[0] + 1) * (ext[3] - ext[2] + 1) * (ext[5] - ext[4] + 1);
+  m_Reference = new unsigned char[m_ReferenceSize];
+
+  m_MemorySize += m_ReferenceSize;
+  m_UndoStack.push_back(edit);
+  return edit;
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistory::Commit(vtkUnsignedCharArray *scalars)
+//----------------------------------------------------------------------------
+{
+  if (m_Reference == NULL)
+    return;
+
+  unsigned char *values = GetValues(scalars);
+  if (values == NULL)
+    return;
+
+  int wholeExtent[6] = {0, m_Dimensions[0] - 1, 0, m_Dimensions[1] - 1, 0, m_Dimensions[2] - 1};
+  CloseEdit(values, wholeExtent);
+  SpillDeltas();
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistory::Commit(medSegmentationSparseMask *mask)
+//----------------------------------------------------------------------------
+{
+  if (m_Reference == NULL || !IsValidMask(mask))
+    return;
+
+  CloseEdit(mask);
+  SpillDeltas();
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistory::CloseEdit(medSegmentationSparseMask *mask)
+//----------------------------------------------------------------------------
+{
+  // only the region of the edit is read from the mask
+  const int *ext = m_UndoStack.back()->Extent;
+  std::vector<unsigned char> values(m_ReferenceSize);
+  mask->GetExtent(ext, &values[0]);
+  CloseEdit(&values[0], ext);
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistory::CloseEdit(const unsigned char *values, const int valuesExtent[6])
+//----------------------------------------------------------------------------
+{
+  EDIT *edit = m_UndoStack.back();
+  const int *ext = edit->Extent;
+  const int width = ext[1] - ext[0] + 1;
+  const int height = ext[3] - ext[2] + 1;
+  const vtkIdType valuesWidth = valuesExtent[1] - valuesExtent[0] + 1;
+  const vtkIdType valuesSliceSize = valuesWidth * (valuesExtent[3] - valuesExtent[2] + 1);
+
+  unsigned char tile[TILE_SIZE * TILE_SIZE * TILE_SIZE];
+  std::vector<unsigned char> &delta = edit->Delta;
+
+  int nTiles = GetNumberOfTiles(ext);
+  for (int t = 0; t < nTiles; t++)
+  {
+    int box[6];
+    int n = GetTileBox(ext, t, box);
+    int rowLength = box[1] - box[0] + 1;
+
+    // XOR of the tile, rows without changes are detected with memcmp
+    bool changed = false;
+    unsigned char *row = tile;
+    for (int z = box[4]; z <= box[5]; z++)
+    {
+      for (int y = box[2]; y <= box[3]; y++, row += rowLength)
+      {
+        const unsigned char *value = values + (box[0] - valuesExtent[0]) + (y - valuesExtent[2]) * valuesWidth + (z - valuesExtent[4]) * valuesSliceSize;
+        const unsigned char *ref = m_Reference + (box[0] - ext[0]) + (y - ext[2]) * width + (vtkIdType)(z - ext[4]) * width * height;
+        if (memcmp(value, ref, rowLength) == 0)
+        {
+          memset(row, 0, rowLength);
+        }
+        else
+        {
+          changed = true;
+          for (int x = 0; x < rowLength; x++)
+            row[x] = value[x] ^ ref[x];
+        }
+      }
+    }
+    if (!changed)
+      continue;
+
+    // record: tile index, size of runs, runs of zeros followed by literal bytes
+    size_t header = delta.size();
+    delta.resize(header + 2 * sizeof(int));
+    memcpy(&delta[header], &t, sizeof(int));
+
+    int i = 0;
+    while (i < n)
+    {
+      int start = i;
+      while (i < n && tile[i] == 0 && i - start < MAX_RUN)
+        i++;
+      unsigned short zeros = i - start;
+
+      start = i;
+      while (i < n && tile[i] != 0 && i - start < MAX_RUN)
+        i++;
+      unsigned short literals = i - start;
+
+      if (literals == 0 && i == n)
+        break;
+
+      size_t pos = delta.size();
+      delta.resize(pos + 2 * sizeof(unsigned short) + literals);
+      memcpy(&delta[pos], &zeros, sizeof(unsigned short));
+      memcpy(&delta[pos + sizeof(unsigned short)], &literals, sizeof(unsigned short));
+      memcpy(&delta[pos + 2 * sizeof(unsigned short)], tile + start, literals);
+    }
+
+    int size = (int)(delta.size() - header - 2 * sizeof(int));
+    memcpy(&delta[header + sizeof(int)], &size, sizeof(int));
+  }
+
+  delete [] m_Reference;
+  m_Reference = NULL;
+  m_MemorySize -= m_ReferenceSize;
+  m_ReferenceSize = 0;
+
+  if (delta.empty())
+  {
+    // nothing changed: nothing to undo
+    DeleteEdit(edit);
+    m_UndoStack.pop_back();
+    return;
+  }
+
+  // release the memory reserved by the growth of the vector
+  std::vector<unsigned char>(delta).swap(delta);
+  edit->DeltaSize = (unsigned long)delta.size();
+  m_MemorySize += edit->DeltaSize;
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistory::ApplyDelta(EDIT *edit, unsigned char *scalars)
+//----------------------------------------------------------------------------
+{
+  const vtkIdType sliceSize = (vtkIdType)m_Dimensions[0] * m_Dimensions[1];
+  const unsigned char *data = &edit->Delta[0];
+  const unsigned char *end = data + edit->Delta.size();
+
+  while (data < end)
+  {
+    int t, size;
+    memcpy(&t, data, sizeof(int));
+    memcpy(&size, data + sizeof(int), sizeof(int));
+    data += 2 * sizeof(int);
+    const unsigned char *tileEnd = data + size;
+
+    int box[6];
+    GetTileBox(edit->Extent, t, box);
+    const int rowLength = box[1] - box[0] + 1;
+    const int nRows = box[3] - box[2] + 1;
+
+    int pos = 0; // position inside the tile
+    while (data < tileEnd)
+    {
+      unsigned short zeros, literals;
+      memcpy(&zeros, data, sizeof(unsigned short));
+      memcpy(&literals, data + sizeof(unsigned short), sizeof(unsigned short));
+      data += 2 * sizeof(unsigned short);
+      pos += zeros;
+
+      // literal bytes can span more rows of the tile
+      while (literals > 0)
+      {
+        int row = pos / rowLength;
+        int x = pos % rowLength;
+        int count = rowLength - x;
+        if (count > literals)
+          count = literals;
+
+        unsigned char *value = scalars + box[0] + x + (box[2] + row % nRows) * m_Dimensions[0] + (box[4] + row / nRows) * sliceSize;
+        for (int i = 0; i < count; i++)
+          value[i] ^= data[i];
+
+        data += count;
+        pos += count;
+        literals -= count;
+      }
+    }
+  }
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistory::ApplyDelta(EDIT *edit, medSegmentationSparseMask *mask)
+//----------------------------------------------------------------------------
+{
+  const unsigned char *data = &edit->Delta[0];
+  const unsigned char *end = data + edit->Delta.size();
+  unsigned char tile[TILE_SIZE * TILE_SIZE * TILE_SIZE];
+
+  while (data < end)
+  {
+    int t, size;
+    memcpy(&t, data, sizeof(int));
+    memcpy(&size, data + sizeof(int), sizeof(int));
+    data += 2 * sizeof(int);
+    const unsigned char *tileEnd = data + size;
+
+    // the values of the tile are read in the order of the delta, so the runs are applied in sequence
+    int box[6];
+    GetTileBox(edit->Extent, t, box);
+    mask->GetExtent(box, tile);
+
+    int pos = 0; // position inside the tile
+    while (data < tileEnd)
+    {
+      unsigned short zeros, literals;
+      memcpy(&zeros, data, sizeof(unsigned short));
+      memcpy(&literals, data + sizeof(unsigned short), sizeof(unsigned short));
+      data += 2 * sizeof(unsigned short);
+      pos += zeros;
+
+      for (int i = 0; i < literals; i++)
+        tile[pos + i] ^= data[i];
+
+      data += literals;
+      pos += literals;
+    }
+
+    mask->SetExtent(box, tile);
+  }
+}
+//----------------------------------------------------------------------------
+bool medSegmentationHistory::Undo(vtkUnsignedCharArray *scalars)
+//----------------------------------------------------------------------------
+{
+  unsigned char *values = GetValues(scalars);
+  if (values == NULL)
+    return false;
+
+  int wholeExtent[6] = {0, m_Dimensions[0] - 1, 0, m_Dimensions[1] - 1, 0, m_Dimensions[2] - 1};
+  if (m_Reference)
+    CloseEdit(values, wholeExtent);
+
+  if (m_UndoStack.empty())
+    return false;
+
+  EDIT *edit = m_UndoStack.back();
+  if (!LoadDelta(edit))
+  {
+    // the delta is lost, so neither this edit nor the older ones can be undone
+    for (int i = 0; i < (int)m_UndoStack.size(); i++)
+      DeleteEdit(m_UndoStack[i]);
+    m_UndoStack.clear();
+    return false;
+  }
+
+  ApplyDelta(edit, values);
+  m_UndoStack.pop_back();
+  m_RedoStack.push_back(edit);
+  scalars->Modified();
+
+  SpillDeltas();
+  return true;
+}
+//----------------------------------------------------------------------------
+bool medSegmentationHistory::Redo(vtkUnsignedCharArray *scalars)
+//----------------------------------------------------------------------------
+{
+  unsigned char *values = GetValues(scalars);
+  if (values == NULL || m_RedoStack.empty())
+    return false;
+
+  int wholeExtent[6] = {0, m_Dimensions[0] - 1, 0, m_Dimensions[1] - 1, 0, m_Dimensions[2] - 1};
+  if (m_Reference)
+    CloseEdit(values, wholeExtent);
+
+  EDIT *edit = m_RedoStack.back();
+  if (!LoadDelta(edit))
+  {
+    // the delta is lost, so neither this edit nor the newer ones can be redone
+    ClearRedo();
+    return false;
+  }
+
+  ApplyDelta(edit, values);
+  m_RedoStack.pop_back();
+  m_UndoStack.push_back(edit);
+  scalars->Modified();
+
+  SpillDeltas();
+  return true;
+}
+//----------------------------------------------------------------------------
+bool medSegmentationHistory::Undo(medSegmentationSparseMask *mask)
+//----------------------------------------------------------------------------
+{
+  if (!IsValidMask(mask))
+    return false;
+
+  if (m_Reference)
+    CloseEdit(mask);
+
+  if (m_UndoStack.empty())
+    return false;
+
+  EDIT *edit = m_UndoStack.back();
+  if (!LoadDelta(edit))
+  {
+    // the delta is lost, so neither this edit nor the older ones can be undone
+    for (int i = 0; i < (int)m_UndoStack.size(); i++)
+      DeleteEdit(m_UndoStack[i]);
+    m_UndoStack.clear();
+    return false;
+  }
+
+  ApplyDelta(edit, mask);
+  m_UndoStack.pop_back();
+  m_RedoStack.push_back(edit);
+
+  SpillDeltas();
+  return true;
+}
+//----------------------------------------------------------------------------
+bool medSegmentationHistory::Redo(medSegmentationSparseMask *mask)
+//----------------------------------------------------------------------------
+{
+  if (!IsValidMask(mask) || m_RedoStack.empty())
+    return false;
+
+  if (m_Reference)
+    CloseEdit(mask);
+
+  EDIT *edit = m_RedoStack.back();
+  if (!LoadDelta(edit))
+  {
+    // the delta is lost, so neither this edit nor the newer ones can be redone
+    ClearRedo();
+    return false;
+  }
+
+  ApplyDelta(edit, mask);
+  m_RedoStack.pop_back();
+  m_UndoStack.push_back(edit);
+
+  SpillDeltas();
+  return true;
+}
+//----------------------------------------------------------------------------
+bool medSegmentationHistory::GetUndoTarget(int &plane, int &slice)
+//----------------------------------------------------------------------------
+{
+  if (m_UndoStack.empty())
+    return false;
+
+  plane = m_UndoStack.back()->Plane;
+  slice = m_UndoStack.back()->Slice;
+  return true;
+}
+//----------------------------------------------------------------------------
+bool medSegmentationHistory::GetRedoTarget(int &plane, int &slice)
+//----------------------------------------------------------------------------
+{
+  if (m_RedoStack.empty())
+    return false;
+
+  plane = m_RedoStack.back()->Plane;
+  slice = m_RedoStack.back()->Slice;
+  return true;
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistory::SpillDeltas()
+//----------------------------------------------------------------------------
+{
+  while (m_MemorySize > m_MemoryLimit)
+  {
+    // the oldest edits are spilled first, the next edit to undo or to redo stays in memory
+    EDIT *oldest = NULL;
+    for (int i = 0; i + 1 < (int)m_UndoStack.size() && oldest == NULL; i++)
+    {
+      if (m_UndoStack[i]->FileOffset < 0 && m_UndoStack[i]->DeltaSize > 0)
+        oldest = m_UndoStack[i];
+    }
+    for (int i = 0; i + 1 < (int)m_RedoStack.size() && oldest == NULL; i++)
+    {
+      if (m_RedoStack[i]->FileOffset < 0 && m_RedoStack[i]->DeltaSize > 0)
+        oldest = m_RedoStack[i];
+    }
+
+    if (oldest == NULL || !SpillDelta(oldest))
+      break;
+  }
+}
+//----------------------------------------------------------------------------
+bool medSegmentationHistory::SpillDelta(EDIT *edit)
+//----------------------------------------------------------------------------
+{
+  if (m_SpillFile == NULL)
+  {
+    m_SpillFile = tmpfile();
+    if (m_SpillFile == NULL)
+      return false;
+  }
+
+  if (fseek(m_SpillFile, 0, SEEK_END) != 0)
+    return false;
+
+  long offset = ftell(m_SpillFile);
+  if (offset < 0 || fwrite(&edit->Delta[0], 1, edit->Delta.size(), m_SpillFile) != edit->Delta.size())
+    return false;
+
+  edit->FileOffset = offset;
+  std::vector<unsigned char>().swap(edit->Delta);
+  m_MemorySize -= edit->DeltaSize;
+  m_NumberOfSpilledEdits++;
+  return true;
+}
+//----------------------------------------------------------------------------
+bool medSegmentationHistory::LoadDelta(EDIT *edit)
+//----------------------------------------------------------------------------
+{
+  if (edit->FileOffset < 0)
+    return true;
+
+  edit->Delta.resize(edit->DeltaSize);
+  if (m_SpillFile == NULL || fseek(m_SpillFile, edit->FileOffset, SEEK_SET) != 0 ||
+    fread(&edit->Delta[0], 1, edit->DeltaSize, m_SpillFile) != edit->DeltaSize)
+  {
+    // truncated or unreadable file: the edit stays spilled
+    std::vector<unsigned char>().swap(edit->Delta);
+    return false;
+  }
+
+  edit->FileOffset = -1;
+  m_MemorySize += edit->DeltaSize;
+  m_NumberOfSpilledEdits--;
+
+  if (m_NumberOfSpilledEdits == 0)
+  {
+    // the file is empty of useful data: start again from scratch
+    fclose(m_SpillFile);
+    m_SpillFile = NULL;
+  }
+
+  return true;
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistory::DeleteEdit(EDIT *edit)
+//----------------------------------------------------------------------------
+{
+  if (edit->FileOffset >= 0)
+    m_NumberOfSpilledEdits--;
+  else
+    m_MemorySize -= edit->DeltaSize;
+
+  cppDEL(edit);
+
+  if (m_NumberOfSpilledEdits == 0 && m_SpillFile)
+  {
+    fclose(m_SpillFile);
+    m_SpillFile = NULL;
+  }
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistory::ClearRedo()
+//----------------------------------------------------------------------------
+{
+  for (int i = 0; i < (int)m_RedoStack.size(); i++)
+    DeleteEdit(m_RedoStack[i]);
+  m_RedoStack.clear();
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistory::Clear()
+//----------------------------------------------------------------------------
+{
+  if (m_Reference)
+  {
+    delete [] m_Reference;
+    m_Reference = NULL;
+    m_MemorySize -= m_ReferenceSize;
+    m_ReferenceSize = 0;
+  }
+
+  ClearRedo();
+  for (int i = 0; i < (int)m_UndoStack.size(); i++)
+    DeleteEdit(m_UndoStack[i]);
+  m_UndoStack.clear();
+}
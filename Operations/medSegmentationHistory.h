@@ -0,0 +1,203 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: medSegmentationHistory
+
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __medSegmentationHistory_h
+#define __medSegmentationHistory_h
+
+//----------------------------------------------------------------------------
+// Include:
+//----------------------------------------------------------------------------
+#include "medOperationsDefines.h"
+#include <vector>
+#include <stdio.h>
+
+//----------------------------------------------------------------------------
+// forward references :
+//----------------------------------------------------------------------------
+class vtkUnsignedCharArray;
+class medSegmentationSparseMask;
+
+/**
+  class name: medSegmentationHistory
+  Undo/redo history of the edits of the unsigned char scalars of a segmentation mask volume,
+  or of a medSegmentationSparseMask.
+
+  An edit covers a region (extent) of the volume: the region is copied as reference when the edit
+  is opened by BeginEdit and the edit is closed at the next BeginEdit, Undo, Redo or Commit.
+  A closed edit keeps only the 16x16x16 tiles of the region that changed, stored as the run length
+  encoding of the XOR between the old and the new values. Since XOR is its own inverse the same
+  delta is applied in place both by Undo and by Redo, so they cost a time proportional to the size
+  of the changes and not to the size of the volume. Edits without changes are discarded.
+  On a sparse mask the delta is applied by reading and writing back only its changed tiles.
+
+  When the memory used by the history exceeds the memory limit the oldest deltas are moved
+  to a temporary file and they are loaded back when needed.
+
+  Sample code:
+
+  medSegmentationHistory history;
+  history.SetDimensions(dims);
+  history.BeginEdit(scalars, sliceExtent, plane, slice);
+  ... // edit scalars
+  history.Commit(scalars);
+  history.GetUndoTarget(plane, slice); // move to the slice of the edit
+  history.Undo(scalars);
+*/
+class MED_OPERATION_EXPORT medSegmentationHistory
+{
+public:
+
+  /** constructor */
+  medSegmentationHistory();
+
+  /** destructor */
+  ~medSegmentationHistory();
+
+  /** Set the dimensions of the edited volume, the history is cleared if they change */
+  void SetDimensions(const int dims[3]);
+
+  /** Get the dimensions of the edited volume */
+  void GetDimensions(int dims[3]);
+
+  /** Set the maximum number of bytes kept in memory by the history (default 64 MB),
+      older deltas are moved to a temporary file to respect it */
+  void SetMemoryLimit(unsigned long limit);
+
+  /** Get the maximum number of bytes kept in memory by the history */
+  unsigned long GetMemoryLimit() {return m_MemoryLimit;};
+
+  /** Open a new edit of the region extent (point indexes) of the scalars, the open edit is closed
+      and the redo stack is cleared. plane and slice identify the edit for the caller (-1 for volume edits). */
+  void BeginEdit(vtkUnsignedCharArray *scalars, const int extent[6], int plane = -1, int slice = -1);
+
+  /** Open a new edit of the region extent of the sparse mask, as BeginEdit on scalars */
+  void BeginEdit(medSegmentationSparseMask *mask, const int extent[6], int plane = -1, int slice = -1);
+
+  /** Close the open edit, if any, storing the changes of the scalars from the reference */
+  void Commit(vtkUnsignedCharArray *scalars);
+
+  /** Close the open edit, if any, storing the changes of the sparse mask from the reference */
+  void Commit(medSegmentationSparseMask *mask);
+
+  /** Return true if an edit is open */
+  bool IsEditOpen() {return m_Reference != NULL;};
+
+  /** Undo the last edit on the scalars, return false if there is nothing to undo.
+      If the delta cannot be read from the temporary file, the undo stack is cleared. */
+  bool Undo(vtkUnsignedCharArray *scalars);
+
+  /** Undo the last edit on the sparse mask, as Undo on scalars */
+  bool Undo(medSegmentationSparseMask *mask);
+
+  /** Redo the last undone edit on the scalars, return false if there is nothing to redo.
+      If the delta cannot be read from the temporary file, the redo stack is cleared. */
+  bool Redo(vtkUnsignedCharArray *scalars);
+
+  /** Redo the last undone edit on the sparse mask, as Redo on scalars */
+  bool Redo(medSegmentationSparseMask *mask);
+
+  /** Get the plane and the slice of the edit undone by the next Undo, return false if there is nothing to undo */
+  bool GetUndoTarget(int &plane, int &slice);
+
+  /** Get the plane and the slice of the edit redone by the next Redo, return false if there is nothing to redo */
+  bool GetRedoTarget(int &plane, int &slice);
+
+  /** Get the number of edits that can be undone (the open edit included) */
+  int GetNumberOfUndo() {return (int)m_UndoStack.size();};
+
+  /** Get the number of edits that can be redone */
+  int GetNumberOfRedo() {return (int)m_RedoStack.size();};
+
+  /** Get the number of bytes kept in memory by deltas and by the reference of the open edit */
+  unsigned long GetMemorySize() {return m_MemorySize;};
+
+  /** Get the number of deltas moved to the temporary file */
+  int GetNumberOfSpilledEdits() {return m_NumberOfSpilledEdits;};
+
+  /** Remove all edits */
+  void Clear();
+
+  /** Remove the edits that can be redone */
+  void ClearRedo();
+
+  /** Side of the cubic tiles in which regions are split */
+  enum {TILE_SIZE = 16};
+
+protected:
+
+  /** Edit of a region of the volume */
+  typedef struct
+  {
+    int Plane;
+    int Slice;
+    int Extent[6];
+    std::vector<unsigned char> Delta; //< records: tile index, RLE size, RLE of the XOR of the tile
+    unsigned long DeltaSize;          //< size of the delta also when spilled
+    long FileOffset;                  //< position in the temporary file, -1 if the delta is in memory
+  } EDIT;
+
+  /** Push a new edit of the clamped extent and allocate its reference, return NULL if the extent is empty */
+  EDIT *OpenEdit(const int extent[6], int plane, int slice);
+
+  /** Store in the open edit the changes from the reference of values, the points of the box valuesExtent */
+  void CloseEdit(const unsigned char *values, const int valuesExtent[6]);
+
+  /** Store in the open edit the changes of the sparse mask from the reference */
+  void CloseEdit(medSegmentationSparseMask *mask);
+
+  /** Apply the XOR delta of edit to scalars */
+  void ApplyDelta(EDIT *edit, unsigned char *scalars);
+
+  /** Apply the XOR delta of edit to the changed tiles of the sparse mask */
+  void ApplyDelta(EDIT *edit, medSegmentationSparseMask *mask);
+
+  /** Get the box of the tile t of the extent, return the number of points of the tile */
+  static int GetTileBox(const int extent[6], int t, int box[6]);
+
+  /** Get the number of tiles of the extent */
+  static int GetNumberOfTiles(const int extent[6]);
+
+  /** Load the delta of the edit from the temporary file, return false if it cannot be read */
+  bool LoadDelta(EDIT *edit);
+
+  /** Move old deltas to the temporary file until the memory limit is respected */
+  void SpillDeltas();
+
+  /** Move the delta of the edit to the temporary file, return false on failure */
+  bool SpillDelta(EDIT *edit);
+
+  /** Free the edit and its memory */
+  void DeleteEdit(EDIT *edit);
+
+  /** Return a pointer to the values of scalars if they match the dimensions, NULL otherwise */
+  unsigned char *GetValues(vtkUnsignedCharArray *scalars);
+
+  /** Return true if the sparse mask matches the dimensions */
+  bool IsValidMask(medSegmentationSparseMask *mask);
+
+  int m_Dimensions[3];
+  unsigned long m_MemoryLimit;
+  unsigned long m_MemorySize;
+
+  std::vector<EDIT *> m_UndoStack; //< the open edit, if any, is the last one
+  std::vector<EDIT *> m_RedoStack;
+
+  unsigned char *m_Reference; //< values of the region of the open edit before the changes
+  unsigned long m_ReferenceSize;
+
+  FILE *m_SpillFile;          //< temporary file of spilled deltas
+  int m_NumberOfSpilledEdits;
+};
+#endif
@@ -29,6 +29,11 @@
 
 #include "mafString.h"
 #include "mafVMEVolumeLarge.h"
+#include "../BES_Beta/IO/mafBrickedFileWriter.h"
+#include "../BES_Beta/vtkMAF/vtkMAFLargeImageReader.h"
+#include "vtkDataSet.h"
+#include "vtkDataArray.h"
+#include "vtkPointData.h"
 //#include "medVMEAnalog.h"
 //#include "mafVMEOutputScalarMatrix.h"
 
@@ -36,6 +41,13 @@
 #include <assert.h>
 
 #include <iostream>
+#include <stdio.h>
+#include <stddef.h>
+
+#define TEST_RAW_FILE   "mafOpImporterBBFTest.raw"
+#define TEST_DIM_X      70
+#define TEST_DIM_Y      60
+#define TEST_DIM_Z      40
 
 //-----------------------------------------------------------
 void mafOpImporterBBFTest::TestDynamicAllocation() 
@@ -67,4 +79,112 @@ void mafOpImporterBBFTest::TestImport()
 
   CPPUNIT_ASSERT(vmeLarge != NULL);
   cppDEL(importer);
-}
\ No newline at end of file
+}
+//-----------------------------------------------------------
+void mafOpImporterBBFTest::WriteVolume(const char* fname, bool bCompression)
+//-----------------------------------------------------------
+{
+  //volume with uniform region (x < 20) and non-uniform region
+  std::vector< unsigned short > data(TEST_DIM_X*TEST_DIM_Y*TEST_DIM_Z);
+  for (int z = 0, idx = 0; z < TEST_DIM_Z; z++)
+  {
+    for (int y = 0; y < TEST_DIM_Y; y++)
+    {
+      for (int x = 0; x < TEST_DIM_X; x++, idx++) {
+        data[idx] = (unsigned short)(x < 20 ? 100 : (x*y + 7*z) % 1000);
+      }
+    }
+  }
+
+  FILE* f = fopen(TEST_RAW_FILE, "wb");
+  CPPUNIT_ASSERT(f != NULL);
+  fwrite(&data[0], sizeof(unsigned short), data.size(), f);
+  fclose(f);
+
+  vtkMAFLargeImageReader* reader = vtkMAFLargeImageReader::New();
+  reader->SetFileName(TEST_RAW_FILE);
+  reader->SetDataScalarType(VTK_UNSIGNED_SHORT);
+  reader->SetNumberOfScalarComponents(1);
+  reader->SetDataExtent(0, TEST_DIM_X - 1, 0, TEST_DIM_Y - 1, 0, TEST_DIM_Z - 1);
+  reader->SetDataVOI(0, TEST_DIM_X - 1, 0, TEST_DIM_Y - 1, 0, TEST_DIM_Z - 1);
+  reader->SetFileDimensionality(3);
+  reader->Update();
+
+  mafBrickedFileWriter* writer = new mafBrickedFileWriter();
+  writer->SetInputDataSet(reader->GetOutput());
+  writer->SetBrickSize(8);
+  writer->SetCompression(bCompression);
+  writer->SetFileName(fname);
+  CPPUNIT_ASSERT(writer->Update());
+
+  cppDEL(writer);
+  vtkDEL(reader);
+  remove(TEST_RAW_FILE);
+}
+
+//-----------------------------------------------------------
+int mafOpImporterBBFTest::Import(const char* fname, std::vector< char >& data)
+//-----------------------------------------------------------
+{
+  mafOpImporterBBF *importer = new mafOpImporterBBF("importer");
+  importer->TestModeOn();
+  importer->SetFileName(fname);
+
+  int nRet = importer->ImportBBF();
+  data.clear();
+  if (nRet == MAF_OK)
+  {
+    mafVMEVolumeLarge *vmeLarge = (mafVMEVolumeLarge *)importer->GetOutput();
+    CPPUNIT_ASSERT(vmeLarge != NULL);
+    vmeLarge->Update();
+
+    vtkDataArray* scalars = vmeLarge->GetOutput()->GetVTKData()->GetPointData()->GetScalars();
+    const char* pData = (const char*)scalars->GetVoidPointer(0);
+    data.assign(pData, pData + scalars->GetNumberOfTuples()*
+      scalars->GetNumberOfComponents()*scalars->GetDataTypeSize());
+  }
+
+  cppDEL(importer);
+  return nRet;
+}
+
+//-----------------------------------------------------------
+void mafOpImporterBBFTest::TestImportCompressed() 
+//-----------------------------------------------------------
+{
+  //mafVolumeLargeReader needs the full path
+  wxString szV2 = wxGetCwd() + wxFILE_SEP_PATH + "mafOpImporterBBFTestV2_01.bbf";
+  wxString szV3 = wxGetCwd() + wxFILE_SEP_PATH + "mafOpImporterBBFTestV3_01.bbf";
+  WriteVolume(szV2, false);
+  WriteVolume(szV3, true);
+
+  std::vector< char > data2, data3;
+  CPPUNIT_ASSERT(Import(szV2, data2) == MAF_OK);
+  CPPUNIT_ASSERT(Import(szV3, data3) == MAF_OK);
+  CPPUNIT_ASSERT(data2.size() > 0 && data2 == data3);
+
+  remove(szV2);
+  remove(szV3);
+}
+
+//-----------------------------------------------------------
+void mafOpImporterBBFTest::TestImportUnsupportedVersion() 
+//-----------------------------------------------------------
+{
+  wxString szFName = wxGetCwd() + wxFILE_SEP_PATH + "mafOpImporterBBFTestV9_01.bbf";
+  WriteVolume(szFName, true);
+
+  //pretend the file comes from some future version
+  FILE* f = fopen(szFName, "r+b");
+  CPPUNIT_ASSERT(f != NULL);
+
+  unsigned short nVersion = mafBrickedFile::m_CompressedVersion + 1;
+  fseek(f, offsetof(mafBrickedFile::BBF_HEADER, version), SEEK_SET);
+  fwrite(&nVersion, sizeof(nVersion), 1, f);
+  fclose(f);
+
+  std::vector< char > data;
+  CPPUNIT_ASSERT(Import(szFName, data) == MAF_ERROR);
+
+  remove(szFName);
+}
@@ -25,6 +25,8 @@
 #include <cppunit/TestResultCollector.h>
 #include <cppunit/TestRunner.h>
 
+#include <vector>
+
 
 class mafOpImporterBBFTest : public CPPUNIT_NS::TestFixture
 {
@@ -32,12 +34,23 @@ class mafOpImporterBBFTest : public CPPUNIT_NS::TestFixture
   CPPUNIT_TEST( TestDynamicAllocation ); 
   CPPUNIT_TEST( TestStaticAllocation );
   CPPUNIT_TEST( TestImport );
+  CPPUNIT_TEST( TestImportCompressed );
+  CPPUNIT_TEST( TestImportUnsupportedVersion );
   CPPUNIT_TEST_SUITE_END();
 
   protected:
     void TestDynamicAllocation();
     void TestStaticAllocation();
     void TestImport();
+    void TestImportCompressed();
+    void TestImportUnsupportedVersion();
+
+    /** writes a synthetic volume into BBF file fname (version 3, if bCompression is true) */
+    void WriteVolume(const char* fname, bool bCompression);
+
+    /** imports the BBF file fname, returns the result of ImportBBF and 
+    the scalars of the imported volume in data */
+    int Import(const char* fname, std::vector< char >& data);
 };
 
 
@@ -32,6 +32,12 @@
 #include "medOpImporterVTK.h"
 #include "mafTagItem.h"
 #include "mafTagArray.h"
+#include "vtkCubeSource.h"
+#include "vtkTriangleFilter.h"
+#include "vtkTransform.h"
+#include "vtkTransformPolyDataFilter.h"
+#include "vtkPolyData.h"
+#include "vtkTimerLog.h"
 
 #include <string>
 #include <assert.h>
@@ -431,4 +437,288 @@ void medOpComputeInertialTensorTest::TestComputeInertialTensorFromGroupFromDENSI
 	mafDEL(importer);
 
 	delete wxLog::SetActiveTarget(NULL);
-}
\ No newline at end of file
+}
+//-----------------------------------------------------------
+void medOpComputeInertialTensorTest::TestComputeInertialTensorUsingMonteCarlo() 
+//-----------------------------------------------------------
+{
+  // import VTK  
+  medOpImporterVTK *importer=new medOpImporterVTK("importerVTK");
+  importer->TestModeOn();
+  mafString fileName=MED_DATA_ROOT;
+  fileName<<"/Surface/sphere.vtk";
+  importer->SetFileName(fileName);
+  importer->ImportVTK();
+  mafVMESurface *surface=mafVMESurface::SafeDownCast(importer->GetOutput());
+
+  CPPUNIT_ASSERT(surface!=NULL);
+  CPPUNIT_ASSERT(surface->GetOutput()->GetVTKData()!=NULL);
+
+  // reference values computed using geometry
+  medOpComputeInertialTensor *op=new medOpComputeInertialTensor();
+  op->TestModeOn();
+  op->SetInput(surface);
+  op->ComputeInertialTensor(surface);
+  op->AddAttributes();
+
+  mafTagItem tag;
+  surface->GetTagArray()->GetTag("PRINCIPAL_INERTIAL_TENSOR_COMPONENTS",tag);
+  double geometryPrincipal[3];
+  for (int i = 0; i < 3; i++)
+  {
+    geometryPrincipal[i] = tag.GetValueAsDouble(i);
+  }
+
+  surface->GetTagArray()->GetTag("SURFACE_MASS",tag);
+  double geometryMass = tag.GetValueAsDouble(0);
+  mafDEL(op);
+
+  // Monte Carlo
+  op=new medOpComputeInertialTensor();
+  op->TestModeOn();
+  op->SetInput(surface);
+  op->SetMethodToUse(medOpComputeInertialTensor::MONTE_CARLO);
+  op->SetAccuracy(20000);
+  CPPUNIT_ASSERT(op->ComputeInertialTensor(surface) == OP_RUN_OK);
+  op->AddAttributes();
+
+  surface->GetTagArray()->GetTag("SURFACE_MASS",tag);
+  CPPUNIT_ASSERT(fabs(tag.GetValueAsDouble(0) - geometryMass) < 0.01*geometryMass);
+
+  surface->GetTagArray()->GetTag("PRINCIPAL_INERTIAL_TENSOR_COMPONENTS",tag);
+  CPPUNIT_ASSERT(tag.GetNumberOfComponents()==3);
+  for (int i = 0; i < 3; i++)
+  {
+    CPPUNIT_ASSERT(fabs(tag.GetValueAsDouble(i) - geometryPrincipal[i]) < 0.05*geometryPrincipal[i]);
+  }
+
+  mafDEL(op);
+  mafDEL(importer);
+
+  delete wxLog::SetActiveTarget(NULL);
+}
+//-----------------------------------------------------------
+void medOpComputeInertialTensorTest::TestComputeInertialTensorUsingMonteCarloThreads() 
+//-----------------------------------------------------------
+{
+  // import VTK  
+  medOpImporterVTK *importer=new medOpImporterVTK("importerVTK");
+  importer->TestModeOn();
+  mafString fileName=MED_DATA_ROOT;
+  fileName<<"/Surface/sphere.vtk";
+  importer->SetFileName(fileName);
+  importer->ImportVTK();
+  mafVMESurface *surface=mafVMESurface::SafeDownCast(importer->GetOutput());
+
+  CPPUNIT_ASSERT(surface!=NULL);
+  CPPUNIT_ASSERT(surface->GetOutput()->GetVTKData()!=NULL);
+
+  // create surface copy
+  mafVMESurface* copy;
+  mafNEW(copy);
+  copy->DeepCopy(surface);
+
+  // create group
+  mafVMEGroup* group;
+  mafNEW(group);
+  group->AddChild(surface);
+  group->AddChild(copy);
+
+  // the results must not depend on the number of threads
+  double tensor[2][9], mass[2];
+  int nThreads[2] = {1, 4};
+  for (int t = 0; t < 2; t++)
+  {
+    medOpComputeInertialTensor *op=new medOpComputeInertialTensor();
+    op->TestModeOn();
+    op->SetInput(group);
+    op->SetMethodToUse(medOpComputeInertialTensor::MONTE_CARLO);
+    op->SetAccuracy(5000);
+    op->SetNumberOfThreads(nThreads[t]);
+    op->ComputeInertialTensorFromGroup();
+    op->AddAttributes();
+
+    mafTagItem tag;
+    group->GetTagArray()->GetTag("INERTIAL_TENSOR_COMPONENTS",tag);
+    CPPUNIT_ASSERT(tag.GetNumberOfComponents()==9);
+    for (int i = 0; i < 9; i++)
+    {
+      tensor[t][i] = tag.GetValueAsDouble(i);
+    }
+
+    group->GetTagArray()->GetTag("SURFACE_MASS",tag);
+    mass[t] = tag.GetValueAsDouble(0);
+
+    mafDEL(op);
+  }
+
+  CPPUNIT_ASSERT(mass[0] == mass[1]);
+  for (int i = 0; i < 9; i++)
+  {
+    CPPUNIT_ASSERT(tensor[0][i] == tensor[1][i]);
+  }
+
+  mafDEL(group);
+  mafDEL(copy);
+  mafDEL(importer);
+
+  delete wxLog::SetActiveTarget(NULL);
+}
+//-----------------------------------------------------------
+void medOpComputeInertialTensorTest::ComputeUsingMethod(mafVMESurface* surface, int method, int accuracy, 
+                                                        double principal[3], double& mass, double tensor[9])
+//-----------------------------------------------------------
+{
+  medOpComputeInertialTensor *op=new medOpComputeInertialTensor();
+  op->TestModeOn();
+  op->SetInput(surface);
+  op->SetMethodToUse(method);
+  op->SetAccuracy(accuracy);
+  CPPUNIT_ASSERT(op->ComputeInertialTensor(surface) == OP_RUN_OK);
+  op->AddAttributes();
+
+  mafTagItem tag;
+  surface->GetTagArray()->GetTag("PRINCIPAL_INERTIAL_TENSOR_COMPONENTS",tag);
+  for (int i = 0; i < 3; i++)
+  {
+    principal[i] = tag.GetValueAsDouble(i);
+  }
+
+  surface->GetTagArray()->GetTag("SURFACE_MASS",tag);
+  mass = tag.GetValueAsDouble(0);
+
+  if (tensor != NULL)
+  {
+    surface->GetTagArray()->GetTag("INERTIAL_TENSOR_COMPONENTS",tag);
+    for (int i = 0; i < 9; i++)
+    {
+      tensor[i] = tag.GetValueAsDouble(i);
+    }
+  }
+
+  mafDEL(op);
+}
+//-----------------------------------------------------------
+void medOpComputeInertialTensorTest::TestComputeInertialTensorUsingExactIntegrals() 
+//-----------------------------------------------------------
+{
+  // import VTK  
+  medOpImporterVTK *importer=new medOpImporterVTK("importerVTK");
+  importer->TestModeOn();
+  mafString fileName=MED_DATA_ROOT;
+  fileName<<"/Surface/sphere.vtk";
+  importer->SetFileName(fileName);
+  importer->ImportVTK();
+  mafVMESurface *surface=mafVMESurface::SafeDownCast(importer->GetOutput());
+
+  CPPUNIT_ASSERT(surface!=NULL);
+  CPPUNIT_ASSERT(surface->GetOutput()->GetVTKData()!=NULL);
+
+  // both methods are exact for closed surfaces
+  double geometryPrincipal[3], geometryMass;
+  ComputeUsingMethod(surface, medOpComputeInertialTensor::GEOMETRY, 0, geometryPrincipal, geometryMass);
+
+  double exactPrincipal[3], exactMass;
+  ComputeUsingMethod(surface, medOpComputeInertialTensor::EXACT, 0, exactPrincipal, exactMass);
+
+  CPPUNIT_ASSERT(fabs(exactMass - geometryMass) < 1.e-9*geometryMass);
+  for (int i = 0; i < 3; i++)
+  {
+    CPPUNIT_ASSERT(fabs(exactPrincipal[i] - geometryPrincipal[i]) < 1.e-9*geometryPrincipal[i]);
+  }
+
+  mafDEL(importer);
+
+  delete wxLog::SetActiveTarget(NULL);
+}
+//-----------------------------------------------------------
+void medOpComputeInertialTensorTest::TestExactIntegralsOnRotatedBox() 
+//-----------------------------------------------------------
+{
+  // rotated box has non-zero products of inertia, both methods must give the same sign
+  vtkMAFSmartPointer<vtkCubeSource> cube;
+  cube->SetXLength(40);
+  cube->SetYLength(20);
+  cube->SetZLength(10);
+  cube->SetCenter(5, -3, 7);
+
+  vtkMAFSmartPointer<vtkTriangleFilter> triangles;
+  triangles->SetInput(cube->GetOutput());
+
+  vtkMAFSmartPointer<vtkTransform> rotation;
+  rotation->RotateX(30);
+  rotation->RotateZ(45);
+
+  vtkMAFSmartPointer<vtkTransformPolyDataFilter> transform;
+  transform->SetInput(triangles->GetOutput());
+  transform->SetTransform(rotation);
+  transform->Update();
+
+  mafSmartPointer<mafVMESurface> box;
+  box->SetData(transform->GetOutput(), 0);
+  box->GetOutput()->Update();
+
+  double geometryPrincipal[3], geometryMass, geometryTensor[9];
+  ComputeUsingMethod(box, medOpComputeInertialTensor::GEOMETRY, 0, geometryPrincipal, geometryMass, geometryTensor);
+
+  double exactPrincipal[3], exactMass, exactTensor[9];
+  ComputeUsingMethod(box, medOpComputeInertialTensor::EXACT, 0, exactPrincipal, exactMass, exactTensor);
+
+  CPPUNIT_ASSERT(fabs(exactMass - geometryMass) < 1.e-9*geometryMass);
+  CPPUNIT_ASSERT(fabs(geometryTensor[1]) > 1.e-3*geometryPrincipal[0]);
+  for (int i = 0; i < 9; i++)
+  {
+    CPPUNIT_ASSERT(fabs(exactTensor[i] - geometryTensor[i]) < 1.e-9*geometryPrincipal[0]);
+  }
+
+  // principal moments are the eigenvalues of the same tensor
+  for (int i = 0; i < 3; i++)
+  {
+    CPPUNIT_ASSERT(fabs(exactPrincipal[i] - geometryPrincipal[i]) < 1.e-9*geometryPrincipal[0]);
+  }
+
+  delete wxLog::SetActiveTarget(NULL);
+}
+//-----------------------------------------------------------
+void medOpComputeInertialTensorTest::TestExactIntegralsAgainstMonteCarlo() 
+//-----------------------------------------------------------
+{
+  // import VTK  
+  medOpImporterVTK *importer=new medOpImporterVTK("importerVTK");
+  importer->TestModeOn();
+  mafString fileName=MED_DATA_ROOT;
+  fileName<<"/Surface/sphere.vtk";
+  importer->SetFileName(fileName);
+  importer->ImportVTK();
+  mafVMESurface *surface=mafVMESurface::SafeDownCast(importer->GetOutput());
+
+  CPPUNIT_ASSERT(surface!=NULL);
+  CPPUNIT_ASSERT(surface->GetOutput()->GetVTKData()!=NULL);
+
+  double exactPrincipal[3], exactMass;
+  double dblStart = vtkTimerLog::GetUniversalTime();
+  ComputeUsingMethod(surface, medOpComputeInertialTensor::EXACT, 0, exactPrincipal, exactMass);
+  double dblExact = vtkTimerLog::GetUniversalTime() - dblStart;
+
+  // a small number of samples (they do not depend on the number of threads) is within 5%
+  double principal[3], mass;
+  dblStart = vtkTimerLog::GetUniversalTime();
+  ComputeUsingMethod(surface, medOpComputeInertialTensor::MONTE_CARLO, 16000, principal, mass);
+  double dblMonteCarlo = vtkTimerLog::GetUniversalTime() - dblStart;
+
+  CPPUNIT_ASSERT(fabs(mass - exactMass) < 0.05*exactMass);
+  for (int i = 0; i < 3; i++)
+  {
+    CPPUNIT_ASSERT(fabs(principal[i] - exactPrincipal[i]) < 0.05*exactPrincipal[i]);
+  }
+
+  std::cout << std::endl << "inertial tensor of sphere.vtk: exact " << dblExact*1000.0 << " ms, Monte Carlo (16000 samples) " << 
+    dblMonteCarlo*1000.0 << " ms" << std::endl;
+
+  // the exact integrals are never slower than the Monte Carlo samples they replace
+  CPPUNIT_ASSERT(dblExact <= dblMonteCarlo);
+
+  mafDEL(importer);
+
+  delete wxLog::SetActiveTarget(NULL);
+}
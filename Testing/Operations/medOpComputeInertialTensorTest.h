@@ -26,6 +26,8 @@
 #include <cppunit/TestRunner.h>
 
 
+class mafVMESurface;
+
 class medOpComputeInertialTensorTest : public CPPUNIT_NS::TestFixture
 {
   CPPUNIT_TEST_SUITE( medOpComputeInertialTensorTest );
@@ -38,6 +40,11 @@ class medOpComputeInertialTensorTest : public CPPUNIT_NS::TestFixture
   CPPUNIT_TEST( TestComputeInertialTensorFromGroupFromDefaultValue );
   CPPUNIT_TEST( TestComputeInertialTensorFromGroupFromDENSITYTag );
   CPPUNIT_TEST( TestOpDoUndo );
+  CPPUNIT_TEST( TestComputeInertialTensorUsingMonteCarlo );
+  CPPUNIT_TEST( TestComputeInertialTensorUsingMonteCarloThreads );
+  CPPUNIT_TEST( TestComputeInertialTensorUsingExactIntegrals );
+  CPPUNIT_TEST( TestExactIntegralsOnRotatedBox );
+  CPPUNIT_TEST( TestExactIntegralsAgainstMonteCarlo );
   CPPUNIT_TEST_SUITE_END();
 
 protected:
@@ -50,6 +57,17 @@ protected:
   void TestComputeInertialTensorFromGroupFromDefaultValue();
   void TestComputeInertialTensorFromGroupFromDENSITYTag();
   void TestOpDoUndo();
+  void TestComputeInertialTensorUsingMonteCarlo();
+  void TestComputeInertialTensorUsingMonteCarloThreads();
+  void TestComputeInertialTensorUsingExactIntegrals();
+  /** Compares the tensor and the principal moments of exact integrals and geometry on a rotated box */
+  void TestExactIntegralsOnRotatedBox();
+  /** Compares exact integrals with Monte Carlo using a small number of samples, and their times */
+  void TestExactIntegralsAgainstMonteCarlo();
+
+  /** Compute principal moments, mass and optionally the tensor of the surface using the given method and accuracy */
+  void ComputeUsingMethod(mafVMESurface* surface, int method, int accuracy, double principal[3], double& mass, 
+    double tensor[9] = NULL);
   
 };
 
@@ -127,6 +127,93 @@ void medOpExporterWrappedMeterTest::Test()
 	meterImplement();
 
 }
+//-----------------------------------------------------------
+void medOpExporterWrappedMeterTest::TestTimeSeries() 
+//-----------------------------------------------------------
+{
+	mafVMEStorage *storage = mafVMEStorage::New();
+	storage->GetRoot()->SetName("root");
+	storage->GetRoot()->Initialize();
+
+	mafVMESurfaceParametric *vmeSphere;
+	mafNEW(vmeSphere);	
+	vmeSphere->GetOutput()->GetVTKData()->Update();
+	vmeSphere->SetParent(storage->GetRoot());
+	vmeSphere->SetGeometryType(mafVMESurfaceParametric::PARAMETRIC_SPHERE);
+	vmeSphere->SetSphereRadius(5.0);
+	vmeSphere->Update();
+
+	mafVMESurfaceParametric *vmeSTART;
+	mafNEW(vmeSTART);	
+	vmeSTART->GetOutput()->GetVTKData()->Update();
+	vmeSTART->SetParent(storage->GetRoot());
+	vmeSTART->Update();
+
+	mafMatrix matrix1;
+	matrix1.SetElement(X,3,-10);
+	matrix1.SetElement(Y,3,1.5);
+	vmeSTART->SetAbsMatrix(matrix1); //pose must survive changes of the time stamp
+
+	mafVMESurfaceParametric *vmeEND;
+	mafNEW(vmeEND);	
+	vmeEND->GetOutput()->GetVTKData()->Update();
+	vmeEND->SetParent(storage->GetRoot());
+	vmeEND->Update();
+
+	mafMatrix matrix2;
+	matrix2.SetElement(X,3,10);
+	matrix2.SetElement(Y,3,1.5);
+	vmeEND->SetAbsMatrix(matrix2);
+
+	medVMEComputeWrapping  *wrappedMeter;
+	mafNEW(wrappedMeter);
+	wrappedMeter->SetMeterLink("StartVME",vmeSTART);
+	wrappedMeter->SetMeterLink("EndVME1",vmeEND);
+	wrappedMeter->SetMeterLink("WrappedVME1",vmeSphere);
+	wrappedMeter->SetWrappedClass(medVMEComputeWrapping::NEW_METER);
+	wrappedMeter->SetWrappedMode1(medVMEComputeWrapping::SINGLE_SPHERE);
+	wrappedMeter->SetParent(storage->GetRoot());
+
+	wrappedMeter->GetOutput()->GetVTKData()->Update();
+	wrappedMeter->Modified();
+	wrappedMeter->Update();
+	double distance = wrappedMeter->GetDistance();
+
+	//the scene is static, so every time stamp must give the same path
+	std::vector<mafTimeStamp> times;
+	for (int i = 0; i < 5; i++)
+		times.push_back(i);
+
+	std::vector<medVMEComputeWrapping *> meters;
+	meters.push_back(wrappedMeter);
+
+	std::vector<medVMEComputeWrapping::TimeSeries> series;
+	medVMEComputeWrapping::EvaluateTimeSeries(meters, times, series);
+
+	CPPUNIT_ASSERT(series.size() == 1);
+	CPPUNIT_ASSERT(series[0].m_Lengths.size() == times.size());
+	CPPUNIT_ASSERT(series[0].m_Points.size() == times.size()*medVMEComputeWrapping::TIME_SERIES_POINTS*3);
+
+	for (int i = 0; i < (int)times.size(); i++)
+	{
+		CPPUNIT_ASSERT(fabs(series[0].m_Lengths[i] - distance) < 1e-6);
+
+		double *points = &series[0].m_Points[i*medVMEComputeWrapping::TIME_SERIES_POINTS*3];
+		CPPUNIT_ASSERT(fabs(points[0] + 10) < 1e-6 && fabs(points[1] - 1.5) < 1e-6);
+		points += (medVMEComputeWrapping::TIME_SERIES_POINTS - 1)*3;
+		CPPUNIT_ASSERT(fabs(points[0] - 10) < 1e-6 && fabs(points[1] - 1.5) < 1e-6);
+	}
+
+	wrappedMeter->SetParent(NULL);
+	vmeSphere->SetParent(NULL);
+	vmeSTART->SetParent(NULL);
+	vmeEND->SetParent(NULL);
+	mafDEL(vmeSphere);
+	mafDEL(vmeSTART);
+	mafDEL(vmeEND);
+	mafDEL(wrappedMeter);
+	mafDEL(storage);
+}
 
 /*
 //create landmarks and relative landmark cloud
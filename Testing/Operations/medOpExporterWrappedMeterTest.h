@@ -30,10 +30,12 @@ class medOpExporterWrappedMeterTest : public CPPUNIT_NS::TestFixture
 {
   CPPUNIT_TEST_SUITE( medOpExporterWrappedMeterTest );
   CPPUNIT_TEST( Test );
+  CPPUNIT_TEST( TestTimeSeries );
   CPPUNIT_TEST_SUITE_END();
 
   protected:
     void Test();
+    void TestTimeSeries();
 	void meterImplement();
 };
 
@@ -45,6 +45,7 @@
 #include "vtkDirectory.h"
 
 #include <wx/dir.h>
+#include <wx/filename.h>
 
 #include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
 
@@ -257,3 +258,312 @@ void medOpImporterDicomOffisTest::TestCompareDicomImage()
   delete wxLog::SetActiveTarget(NULL);
 }
 
+//-----------------------------------------------------------
+void medOpImporterDicomOffisTest::TestDicomIndex() 
+//-----------------------------------------------------------
+{
+  mafString dirName=MED_DATA_ROOT;
+  dirName<<"/Dicom/";
+
+  wxDir dir(dirName.GetCStr());
+  wxString dicomDir;
+
+  bool cont = dir.GetFirst(&dicomDir, "", wxDIR_DIRS);
+  while ( cont )
+  {
+    if (dicomDir != "CVS")
+    {
+      wxString dicomPath = dirName + dicomDir;
+
+      // the index is written in a temporary file, not next to the test data
+      mafString defaultIndexFileName = medOpImporterDicomOffis::GetDicomIndexFileName(dicomPath.c_str());
+      bool defaultIndexExists = wxFileExists(defaultIndexFileName.GetCStr());
+      wxString indexFileName = wxFileName::CreateTempFileName("dicomindex");
+      CPPUNIT_ASSERT(!indexFileName.IsEmpty());
+
+      // the first opening reads the files and writes the index, the second one reads the tags from the index
+      int numberOfFiles = 0;
+      int numberOfPoints[2];
+      double scalarRange[2][2];
+      for (int i = 0; i < 2; i++)
+      {
+        medOpImporterDicomOffis *importer=new medOpImporterDicomOffis();
+        importer->TestModeOn();
+        importer->SetDicomIndexFileName(indexFileName.c_str());
+        importer->SetDicomDirectoryABSFileName(dicomPath.c_str());
+        importer->CreateSliceVTKPipeline();
+        CPPUNIT_ASSERT(importer->OpenDir());
+        if (i == 0)
+        {
+          numberOfFiles = importer->GetNumberOfReadFiles();
+          CPPUNIT_ASSERT(numberOfFiles > 0);
+          CPPUNIT_ASSERT(importer->GetNumberOfIndexedFiles() == 0);
+        }
+        else
+        {
+          CPPUNIT_ASSERT(importer->GetNumberOfReadFiles() == 0);
+          CPPUNIT_ASSERT(importer->GetNumberOfIndexedFiles() == numberOfFiles);
+        }
+        importer->ReadDicom();
+        importer->GenerateSliceTexture(0);
+
+        wxDir dirDicom(dicomPath);
+        wxString sliceFileName;
+        CPPUNIT_ASSERT(dirDicom.GetFirst(&sliceFileName, "*.dcm", wxDIR_FILES));
+        wxString path, short_name, ext;
+        wxSplitPath(sliceFileName, &path, &short_name, &ext);
+        vtkImageData *image = importer->GetSliceImageDataFromLocalDicomFileName(short_name);
+        CPPUNIT_ASSERT(image != NULL);
+        numberOfPoints[i] = image->GetNumberOfPoints();
+        image->GetScalarRange(scalarRange[i]);
+
+        importer->OpStop(OP_RUN_OK);
+        mafDEL(importer);
+      }
+
+      CPPUNIT_ASSERT(numberOfPoints[0] == numberOfPoints[1]);
+      CPPUNIT_ASSERT(scalarRange[0][0] == scalarRange[1][0] && scalarRange[0][1] == scalarRange[1][1]);
+
+      // a disabled index is neither read nor written
+      medOpImporterDicomOffis *importer=new medOpImporterDicomOffis();
+      importer->TestModeOn();
+      importer->SetDicomIndexFileName(indexFileName.c_str());
+      importer->SetUseDicomIndex(false);
+      importer->SetDicomDirectoryABSFileName(dicomPath.c_str());
+      importer->CreateSliceVTKPipeline();
+      CPPUNIT_ASSERT(importer->OpenDir());
+      CPPUNIT_ASSERT(importer->GetNumberOfReadFiles() == numberOfFiles);
+      CPPUNIT_ASSERT(importer->GetNumberOfIndexedFiles() == 0);
+      importer->OpStop(OP_RUN_OK);
+      mafDEL(importer);
+
+      CPPUNIT_ASSERT(wxFileExists(defaultIndexFileName.GetCStr()) == defaultIndexExists);
+      wxRemoveFile(indexFileName);
+    }
+
+    cont = dir.GetNext(&dicomDir);
+  }
+
+  delete wxLog::SetActiveTarget(NULL);
+}
+
+//-----------------------------------------------------------
+void medOpImporterDicomOffisTest::TestStreamedVolume() 
+//-----------------------------------------------------------
+{
+  mafString dirName=MED_DATA_ROOT;
+  dirName<<"/Dicom/";
+
+  wxDir dir(dirName.GetCStr());
+  wxString dicomDir;
+
+  bool cont = dir.GetFirst(&dicomDir, "", wxDIR_DIRS);
+  while ( cont )
+  {
+    if (dicomDir != "CVS")
+    {
+      wxString dicomPath = dirName + dicomDir;
+
+      // the first volume is built decoding the files in batches, the second one from the slices loaded in memory
+      vtkDataSet *volumes[2];
+      for (int i = 0; i < 2; i++)
+      {
+        medOpImporterDicomOffis *importer=new medOpImporterDicomOffis();
+        importer->TestModeOn();
+        importer->SetDicomDirectoryABSFileName(dicomPath.c_str());
+        importer->CreateSliceVTKPipeline();
+        importer->OpenDir();
+        importer->ReadDicom();
+        importer->GenerateSliceTexture(0);
+
+        if (i == 1)
+        {
+          for (int imageID = 0; imageID < importer->GetNumberOfSeriesSlices(); imageID++)
+          {
+            vtkImageData *image = importer->GetSeriesSlice(imageID)->GetVTKImageData();
+            CPPUNIT_ASSERT(image != NULL);
+            image->Update();
+          }
+        }
+
+        CPPUNIT_ASSERT(importer->BuildOutputVMEGrayVolumeFromDicom() == OP_RUN_OK);
+        mafVMEVolumeGray *volume = mafVMEVolumeGray::SafeDownCast(importer->GetOutput());
+        CPPUNIT_ASSERT(volume != NULL);
+        volume->Update();
+        vtkDataSet *data = volume->GetOutput()->GetVTKData();
+        data->Update();
+        volumes[i] = data->NewInstance();
+        volumes[i]->DeepCopy(data);
+
+        importer->OpStop(OP_RUN_OK);
+        mafDEL(importer);
+      }
+
+      double bounds[2][6];
+      volumes[0]->GetBounds(bounds[0]);
+      volumes[1]->GetBounds(bounds[1]);
+      for (int i = 0; i < 6; i++)
+      {
+        CPPUNIT_ASSERT(bounds[0][i] == bounds[1][i]);
+      }
+
+      vtkDataArray *scalars[2] = {volumes[0]->GetPointData()->GetScalars(), volumes[1]->GetPointData()->GetScalars()};
+      CPPUNIT_ASSERT(scalars[0]->GetDataType() == scalars[1]->GetDataType());
+      CPPUNIT_ASSERT(scalars[0]->GetNumberOfTuples() == scalars[1]->GetNumberOfTuples());
+      for (int i = 0; i < scalars[0]->GetNumberOfTuples(); i++)
+      {
+        CPPUNIT_ASSERT(scalars[0]->GetTuple1(i) == scalars[1]->GetTuple1(i));
+      }
+
+      vtkDEL(volumes[0]);
+      vtkDEL(volumes[1]);
+    }
+
+    cont = dir.GetNext(&dicomDir);
+  }
+
+  delete wxLog::SetActiveTarget(NULL);
+}
+
+//-----------------------------------------------------------
+medOpImporterDicomOffis *medOpImporterDicomOffisTest::OpenSeries(int minSlices) 
+//-----------------------------------------------------------
+{
+  mafString dirName=MED_DATA_ROOT;
+  dirName<<"/Dicom/";
+
+  wxDir dir(dirName.GetCStr());
+  wxString dicomDir;
+
+  bool cont = dir.GetFirst(&dicomDir, "", wxDIR_DIRS);
+  while ( cont )
+  {
+    if (dicomDir != "CVS")
+    {
+      medOpImporterDicomOffis *importer=new medOpImporterDicomOffis();
+      importer->TestModeOn();
+
+      wxString dicomPath = dirName + dicomDir;
+      importer->SetDicomDirectoryABSFileName(dicomPath.c_str());
+      importer->CreateSliceVTKPipeline();
+      importer->OpenDir();
+      importer->ReadDicom();
+
+      if (importer->GetNumberOfSeriesSlices() >= minSlices)
+      {
+        for (int imageID = 0; imageID < importer->GetNumberOfSeriesSlices(); imageID++)
+        {
+          importer->GetSeriesSlice(imageID)->ReleaseVTKImageData();
+        }
+        importer->ReleasePreviewCache();
+        return importer;
+      }
+
+      importer->OpStop(OP_RUN_OK);
+      mafDEL(importer);
+    }
+
+    cont = dir.GetNext(&dicomDir);
+  }
+
+  return NULL;
+}
+
+//-----------------------------------------------------------
+void medOpImporterDicomOffisTest::TestPreviewCache() 
+//-----------------------------------------------------------
+{
+  medOpImporterDicomOffis *importer = OpenSeries(3);
+  CPPUNIT_ASSERT(importer != NULL);
+
+  importer->SetPreviewCacheSize(2);
+  CPPUNIT_ASSERT(importer->GetPreviewCacheSize() == 2);
+
+  // slices are decoded when shown the first time
+  importer->LoadPreviewSlice(0);
+  importer->LoadPreviewSlice(1);
+  CPPUNIT_ASSERT(importer->GetPreviewCacheMisses() == 2);
+  CPPUNIT_ASSERT(importer->GetPreviewCacheHits() == 0);
+  CPPUNIT_ASSERT(importer->GetSeriesSlice(0)->IsVTKImageDataLoaded());
+  CPPUNIT_ASSERT(importer->GetSeriesSlice(1)->IsVTKImageDataLoaded());
+
+  // showing slice 0 again makes slice 1 the least recently shown one, which is released by slice 2
+  importer->LoadPreviewSlice(0);
+  CPPUNIT_ASSERT(importer->GetPreviewCacheHits() == 1);
+  importer->LoadPreviewSlice(2);
+  CPPUNIT_ASSERT(importer->GetPreviewCacheMisses() == 3);
+  CPPUNIT_ASSERT(importer->GetSeriesSlice(0)->IsVTKImageDataLoaded());
+  CPPUNIT_ASSERT(!importer->GetSeriesSlice(1)->IsVTKImageDataLoaded());
+  CPPUNIT_ASSERT(importer->GetSeriesSlice(2)->IsVTKImageDataLoaded());
+
+  // slices loaded elsewhere are never released by the preview
+  importer->GetSeriesSlice(1)->GetVTKImageData();
+  importer->LoadPreviewSlice(1);
+  CPPUNIT_ASSERT(importer->GetPreviewCacheHits() == 2);
+  importer->LoadPreviewSlice(0);
+  importer->LoadPreviewSlice(2);
+  CPPUNIT_ASSERT(importer->GetSeriesSlice(1)->IsVTKImageDataLoaded());
+
+  importer->ReleasePreviewCache();
+  CPPUNIT_ASSERT(importer->GetPreviewCacheHits() == 0);
+  CPPUNIT_ASSERT(importer->GetPreviewCacheMisses() == 0);
+  CPPUNIT_ASSERT(importer->GetPreviewDecodeTime() == 0);
+
+  importer->OpStop(OP_RUN_OK);
+  mafDEL(importer);
+
+  delete wxLog::SetActiveTarget(NULL);
+}
+
+//-----------------------------------------------------------
+void medOpImporterDicomOffisTest::TestPrefetch() 
+//-----------------------------------------------------------
+{
+  medOpImporterDicomOffis *importer = OpenSeries(3);
+  CPPUNIT_ASSERT(importer != NULL);
+  CPPUNIT_ASSERT(!importer->IsPrefetchRunning());
+
+  // the thread stops when the requested slices are decoded
+  std::vector<int> imageIDs;
+  imageIDs.push_back(1);
+  imageIDs.push_back(2);
+  importer->PrefetchSlices(imageIDs);
+  for (int i = 0; i < 100 && importer->IsPrefetchRunning(); i++)
+  {
+    mafSleep(100);
+  }
+  CPPUNIT_ASSERT(!importer->IsPrefetchRunning());
+
+  // prefetched slices are not decoded again
+  importer->LoadPreviewSlice(1);
+  importer->LoadPreviewSlice(2);
+  importer->LoadPreviewSlice(0);
+  CPPUNIT_ASSERT(importer->GetPreviewPrefetchHits() == 2);
+  CPPUNIT_ASSERT(importer->GetPreviewCacheMisses() == 1);
+  CPPUNIT_ASSERT(importer->GetSeriesSlice(1)->IsVTKImageDataLoaded());
+  CPPUNIT_ASSERT(importer->GetSeriesSlice(2)->IsVTKImageDataLoaded());
+
+  // the release stops a running thread
+  for (int imageID = 0; imageID < importer->GetNumberOfSeriesSlices(); imageID++)
+  {
+    importer->GetSeriesSlice(imageID)->ReleaseVTKImageData();
+  }
+  imageIDs.clear();
+  for (int imageID = 0; imageID < importer->GetNumberOfSeriesSlices(); imageID++)
+  {
+    imageIDs.push_back(imageID);
+  }
+  importer->PrefetchSlices(imageIDs);
+  importer->ReleasePreviewCache();
+  CPPUNIT_ASSERT(!importer->IsPrefetchRunning());
+  CPPUNIT_ASSERT(importer->GetPreviewPrefetchHits() == 0);
+
+  // the prefetch starts again after the release
+  importer->PrefetchSlices(imageIDs);
+  importer->ReleasePreviewCache();
+
+  importer->OpStop(OP_RUN_OK);
+  mafDEL(importer);
+
+  delete wxLog::SetActiveTarget(NULL);
+}
@@ -26,6 +26,8 @@
 #include <cppunit/TestRunner.h>
 using namespace std;
  
+class medOpImporterDicomOffis;
+
 class medOpImporterDicomOffisTest : public CPPUNIT_NS::TestFixture
 {
 
@@ -42,6 +44,10 @@ public:
     CPPUNIT_TEST( TestSetDirName );
     CPPUNIT_TEST( TestCreateVolume );
     CPPUNIT_TEST( TestCompareDicomImage );
+    CPPUNIT_TEST( TestDicomIndex );
+    CPPUNIT_TEST( TestStreamedVolume );
+    CPPUNIT_TEST( TestPreviewCache );
+    CPPUNIT_TEST( TestPrefetch );
   CPPUNIT_TEST_SUITE_END();
 
 protected:
@@ -50,6 +56,13 @@ protected:
   void TestSetDirName();
   void TestCompareDicomImage();
   void TestCreateVolume();
+  void TestDicomIndex();
+  void TestStreamedVolume();
+  void TestPreviewCache();
+  void TestPrefetch();
+
+  /** Open the first series of the test data with at least minSlices slices, with no slice in memory */
+  medOpImporterDicomOffis *OpenSeries(int minSlices);
 
 };
 
@@ -0,0 +1,339 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: medSegmentationHistoryTest
+ 
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "medDefines.h" 
+//----------------------------------------------------------------------------
+// NOTE: Every CPP file in the MAF must include "mafDefines.h" as first.
+// This force to include Window,wxWidgets and VTK exactly in this order.
+// Failing in doing this will result in a run-time error saying:
+// "Failure#0: The value of ESP was not properly saved across a function call"
+//----------------------------------------------------------------------------
+
+#include <cppunit/config/SourcePrefix.h>
+#include "medSegmentationHistoryTest.h"
+
+#include "medSegmentationHistory.h"
+#include "medSegmentationSparseMask.h"
+#include "vtkMAFSmartPointer.h"
+#include "vtkUnsignedCharArray.h"
+
+#include <string.h>
+#include <vector>
+
+const int DIM_X = 40;
+const int DIM_Y = 35;
+const int DIM_Z = 20;
+
+/** History whose temporary file can be replaced by an empty one */
+class medSegmentationHistoryTruncated : public medSegmentationHistory
+{
+public:
+  void TruncateSpillFile()
+  {
+    if (m_SpillFile)
+      fclose(m_SpillFile);
+    m_SpillFile = tmpfile();
+  }
+};
+
+//----------------------------------------------------------------------------
+static void DrawSquare(vtkUnsignedCharArray *scalars, int z, int x0, int y0, int size, unsigned char value)
+//----------------------------------------------------------------------------
+{
+  for (int y = y0; y < y0 + size; y++)
+    for (int x = x0; x < x0 + size; x++)
+      scalars->SetValue(x + y * DIM_X + z * DIM_X * DIM_Y, value);
+}
+//----------------------------------------------------------------------------
+static bool Equals(vtkUnsignedCharArray *a, vtkUnsignedCharArray *b)
+//----------------------------------------------------------------------------
+{
+  return memcmp(a->GetPointer(0), b->GetPointer(0), a->GetNumberOfTuples()) == 0;
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistoryTest::TestFixture()
+//----------------------------------------------------------------------------
+{
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistoryTest::setUp()
+//----------------------------------------------------------------------------
+{
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistoryTest::tearDown()
+//----------------------------------------------------------------------------
+{
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistoryTest::TestDynamicAllocation()
+//----------------------------------------------------------------------------
+{
+  medSegmentationHistory *history = new medSegmentationHistory();
+  cppDEL(history);
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistoryTest::TestUndoRedo()
+//----------------------------------------------------------------------------
+{
+  int dims[3] = {DIM_X, DIM_Y, DIM_Z};
+  int numberOfPoints = DIM_X * DIM_Y * DIM_Z;
+
+  vtkMAFSmartPointer<vtkUnsignedCharArray> scalars;
+  scalars->SetNumberOfTuples(numberOfPoints);
+  memset(scalars->GetPointer(0), 0, numberOfPoints);
+
+  vtkMAFSmartPointer<vtkUnsignedCharArray> state0, state1, state2;
+  state0->DeepCopy(scalars);
+
+  medSegmentationHistory history;
+  history.SetDimensions(dims);
+
+  // edit of the slice z = 5
+  int sliceExtent[6] = {0, DIM_X - 1, 0, DIM_Y - 1, 5, 5};
+  history.BeginEdit(scalars, sliceExtent, 0, 6);
+  DrawSquare(scalars, 5, 3, 4, 20, 255);
+  state1->DeepCopy(scalars);
+
+  // edit of the whole volume: a pixel in two slices
+  int volumeExtent[6] = {0, DIM_X - 1, 0, DIM_Y - 1, 0, DIM_Z - 1};
+  history.BeginEdit(scalars, volumeExtent);
+  DrawSquare(scalars, 0, 39, 34, 1, 255);
+  DrawSquare(scalars, 5, 10, 10, 5, 0);
+  history.Commit(scalars);
+  state2->DeepCopy(scalars);
+
+  CPPUNIT_ASSERT(history.GetNumberOfUndo() == 2);
+  CPPUNIT_ASSERT(history.GetNumberOfRedo() == 0);
+  // only the changed tiles are kept
+  CPPUNIT_ASSERT(history.GetMemorySize() < numberOfPoints / 4);
+
+  int plane, slice;
+  CPPUNIT_ASSERT(history.GetUndoTarget(plane, slice));
+  CPPUNIT_ASSERT(plane == -1 && slice == -1);
+
+  CPPUNIT_ASSERT(history.Undo(scalars));
+  CPPUNIT_ASSERT(Equals(scalars, state1));
+  CPPUNIT_ASSERT(history.GetUndoTarget(plane, slice));
+  CPPUNIT_ASSERT(plane == 0 && slice == 6);
+
+  CPPUNIT_ASSERT(history.Undo(scalars));
+  CPPUNIT_ASSERT(Equals(scalars, state0));
+  CPPUNIT_ASSERT(!history.Undo(scalars));
+
+  CPPUNIT_ASSERT(history.GetRedoTarget(plane, slice));
+  CPPUNIT_ASSERT(plane == 0 && slice == 6);
+  CPPUNIT_ASSERT(history.Redo(scalars));
+  CPPUNIT_ASSERT(Equals(scalars, state1));
+  CPPUNIT_ASSERT(history.Redo(scalars));
+  CPPUNIT_ASSERT(Equals(scalars, state2));
+  CPPUNIT_ASSERT(!history.Redo(scalars));
+
+  // a new edit clears the redo stack
+  CPPUNIT_ASSERT(history.Undo(scalars));
+  history.BeginEdit(scalars, sliceExtent, 0, 6);
+  CPPUNIT_ASSERT(history.GetNumberOfRedo() == 0);
+
+  history.Clear();
+  CPPUNIT_ASSERT(history.GetNumberOfUndo() == 0);
+  CPPUNIT_ASSERT(history.GetMemorySize() == 0);
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistoryTest::TestUndoRedoOnSparseMask()
+//----------------------------------------------------------------------------
+{
+  int dims[3] = {DIM_X, DIM_Y, DIM_Z};
+  int numberOfPoints = DIM_X * DIM_Y * DIM_Z;
+
+  medSegmentationSparseMask mask;
+  mask.SetDimensions(dims);
+
+  std::vector<unsigned char> state0(numberOfPoints), state1(numberOfPoints), state2(numberOfPoints), values(numberOfPoints);
+  mask.GetArray(&state0[0]);
+
+  medSegmentationHistory history;
+  history.SetDimensions(dims);
+
+  // edit of the slice x = 7, written as the manual tools do
+  int sliceExtent[6] = {7, 7, 0, DIM_Y - 1, 0, DIM_Z - 1};
+  history.BeginEdit(&mask, sliceExtent, 1, 8);
+  std::vector<unsigned char> sliceValues(DIM_Y * DIM_Z, 0);
+  for (int z = 2; z < 12; z++)
+    for (int y = 3; y < 30; y++)
+      sliceValues[y + z * DIM_Y] = 255;
+  mask.SetExtent(sliceExtent, &sliceValues[0]);
+  mask.GetArray(&state1[0]);
+
+  // edit of the whole volume
+  int volumeExtent[6] = {0, DIM_X - 1, 0, DIM_Y - 1, 0, DIM_Z - 1};
+  history.BeginEdit(&mask, volumeExtent);
+  mask.SetValue(39, 34, 19, 255);
+  mask.SetValue(7, 5, 5, 0);
+  history.Commit(&mask);
+  mask.GetArray(&state2[0]);
+
+  CPPUNIT_ASSERT(history.GetNumberOfUndo() == 2);
+
+  int plane, slice;
+  CPPUNIT_ASSERT(history.Undo(&mask));
+  mask.GetArray(&values[0]);
+  CPPUNIT_ASSERT(values == state1);
+  CPPUNIT_ASSERT(history.GetUndoTarget(plane, slice));
+  CPPUNIT_ASSERT(plane == 1 && slice == 8);
+
+  // undoing the first edit restores an empty mask without dense tiles
+  CPPUNIT_ASSERT(history.Undo(&mask));
+  mask.GetArray(&values[0]);
+  CPPUNIT_ASSERT(values == state0);
+  CPPUNIT_ASSERT(mask.GetNumberOfTiles(medSegmentationSparseMask::DENSE_TILE) == 0);
+  CPPUNIT_ASSERT(!history.Undo(&mask));
+
+  CPPUNIT_ASSERT(history.Redo(&mask));
+  mask.GetArray(&values[0]);
+  CPPUNIT_ASSERT(values == state1);
+  CPPUNIT_ASSERT(history.Redo(&mask));
+  mask.GetArray(&values[0]);
+  CPPUNIT_ASSERT(values == state2);
+  CPPUNIT_ASSERT(!history.Redo(&mask));
+
+  // a mask of other dimensions is refused
+  int otherDims[3] = {DIM_X, DIM_Y, DIM_Z + 1};
+  medSegmentationSparseMask other;
+  other.SetDimensions(otherDims);
+  CPPUNIT_ASSERT(!history.Undo(&other));
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistoryTest::TestEmptyEdit()
+//----------------------------------------------------------------------------
+{
+  int dims[3] = {DIM_X, DIM_Y, DIM_Z};
+  vtkMAFSmartPointer<vtkUnsignedCharArray> scalars;
+  scalars->SetNumberOfTuples(DIM_X * DIM_Y * DIM_Z);
+  memset(scalars->GetPointer(0), 0, DIM_X * DIM_Y * DIM_Z);
+
+  medSegmentationHistory history;
+  history.SetDimensions(dims);
+
+  int sliceExtent[6] = {7, 7, 0, DIM_Y - 1, 0, DIM_Z - 1};
+  history.BeginEdit(scalars, sliceExtent, 1, 8);
+  CPPUNIT_ASSERT(history.IsEditOpen());
+  CPPUNIT_ASSERT(history.GetNumberOfUndo() == 1);
+
+  // an edit without changes has nothing to undo
+  history.Commit(scalars);
+  CPPUNIT_ASSERT(!history.IsEditOpen());
+  CPPUNIT_ASSERT(history.GetNumberOfUndo() == 0);
+  CPPUNIT_ASSERT(!history.Undo(scalars));
+
+  // scalars with wrong size are ignored
+  vtkMAFSmartPointer<vtkUnsignedCharArray> wrongScalars;
+  wrongScalars->SetNumberOfTuples(10);
+  history.BeginEdit(wrongScalars, sliceExtent, 1, 8);
+  CPPUNIT_ASSERT(history.GetNumberOfUndo() == 0);
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistoryTest::TestMemoryLimit()
+//----------------------------------------------------------------------------
+{
+  int dims[3] = {DIM_X, DIM_Y, DIM_Z};
+  int numberOfPoints = DIM_X * DIM_Y * DIM_Z;
+  vtkMAFSmartPointer<vtkUnsignedCharArray> scalars;
+  scalars->SetNumberOfTuples(numberOfPoints);
+  memset(scalars->GetPointer(0), 0, numberOfPoints);
+
+  medSegmentationHistory history;
+  history.SetDimensions(dims);
+  history.SetMemoryLimit(0);
+
+  // one edit for each slice, the states are kept to check undo and redo
+  vtkUnsignedCharArray *states[DIM_Z + 1];
+  states[0] = vtkUnsignedCharArray::New();
+  states[0]->DeepCopy(scalars);
+  for (int z = 0; z < DIM_Z; z++)
+  {
+    int sliceExtent[6] = {0, DIM_X - 1, 0, DIM_Y - 1, z, z};
+    history.BeginEdit(scalars, sliceExtent, 0, z + 1);
+    DrawSquare(scalars, z, z, z, 15, 255);
+    history.Commit(scalars);
+
+    states[z + 1] = vtkUnsignedCharArray::New();
+    states[z + 1]->DeepCopy(scalars);
+  }
+
+  // all deltas but the last one are in the temporary file
+  CPPUNIT_ASSERT(history.GetNumberOfSpilledEdits() == DIM_Z - 1);
+
+  for (int z = DIM_Z - 1; z >= 0; z--)
+  {
+    CPPUNIT_ASSERT(history.Undo(scalars));
+    CPPUNIT_ASSERT(Equals(scalars, states[z]));
+  }
+  for (int z = 1; z <= DIM_Z; z++)
+  {
+    CPPUNIT_ASSERT(history.Redo(scalars));
+    CPPUNIT_ASSERT(Equals(scalars, states[z]));
+  }
+
+  history.Clear();
+  CPPUNIT_ASSERT(history.GetNumberOfSpilledEdits() == 0);
+  CPPUNIT_ASSERT(history.GetMemorySize() == 0);
+
+  for (int i = 0; i <= DIM_Z; i++)
+    vtkDEL(states[i]);
+}
+//----------------------------------------------------------------------------
+void medSegmentationHistoryTest::TestTruncatedSpillFile()
+//----------------------------------------------------------------------------
+{
+  int dims[3] = {DIM_X, DIM_Y, DIM_Z};
+  int numberOfPoints = DIM_X * DIM_Y * DIM_Z;
+  vtkMAFSmartPointer<vtkUnsignedCharArray> scalars;
+  scalars->SetNumberOfTuples(numberOfPoints);
+  memset(scalars->GetPointer(0), 0, numberOfPoints);
+
+  medSegmentationHistoryTruncated history;
+  history.SetDimensions(dims);
+  history.SetMemoryLimit(0);
+
+  vtkMAFSmartPointer<vtkUnsignedCharArray> state2, state3;
+  for (int z = 0; z < 3; z++)
+  {
+    int sliceExtent[6] = {0, DIM_X - 1, 0, DIM_Y - 1, z, z};
+    history.BeginEdit(scalars, sliceExtent, 0, z + 1);
+    DrawSquare(scalars, z, z, z, 15, 255);
+    history.Commit(scalars);
+    if (z == 1)
+      state2->DeepCopy(scalars);
+  }
+  state3->DeepCopy(scalars);
+  CPPUNIT_ASSERT(history.GetNumberOfSpilledEdits() == 2);
+
+  // the last delta is in memory, the older ones cannot be read anymore
+  history.TruncateSpillFile();
+  CPPUNIT_ASSERT(history.Undo(scalars));
+  CPPUNIT_ASSERT(Equals(scalars, state2));
+
+  CPPUNIT_ASSERT(!history.Undo(scalars));
+  CPPUNIT_ASSERT(Equals(scalars, state2));
+  CPPUNIT_ASSERT(history.GetNumberOfUndo() == 0);
+  CPPUNIT_ASSERT(history.GetNumberOfSpilledEdits() == 0);
+
+  // the undone edit is still in memory
+  CPPUNIT_ASSERT(history.Redo(scalars));
+  CPPUNIT_ASSERT(Equals(scalars, state3));
+
+  history.Clear();
+  CPPUNIT_ASSERT(history.GetMemorySize() == 0);
+}
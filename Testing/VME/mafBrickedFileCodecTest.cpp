@@ -0,0 +1,187 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: mafBrickedFileCodecTest
+
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+
+#include "mafDefines.h"
+#include "medDefines.h"
+//----------------------------------------------------------------------------
+// NOTE: Every CPP file in the MAF must include "mafDefines.h" as first.
+// This force to include Window,wxWidgets and VTK exactly in this order.
+// Failing in doing this will result in a run-time error saying:
+// "Failure#0: The value of ESP was not properly saved across a function call"
+//----------------------------------------------------------------------------
+
+#include <cppunit/config/SourcePrefix.h>
+
+#include "mafBrickedFileCodecTest.h"
+#include "../BES_Beta/IO/mafBrickedFileCodec.h"
+
+#include "vtkTimerLog.h"
+
+#include <iostream>
+#include <vector>
+
+#define BENCHMARK_BRICK_SIZE    16        //16x16x16 voxels (the default of mafBrickedFileWriter)
+#define BENCHMARK_BRICKS        2048      //number of bricks (16 MB of 16-bit data)
+#define BENCHMARK_REPETITIONS   5
+
+//---------------------------------------------------------
+void mafBrickedFileCodecTest::FillBrick(char* pBrick, int nSize, int nElemSize, int nComps, int nSeed)
+//---------------------------------------------------------
+{
+  //voxels of the brick are x-fastest, the values change slowly with some noise
+  unsigned int nRand = (unsigned int)nSeed*2654435761U + 1;
+  int nElems = nSize / nElemSize;
+  for (int i = 0; i < nElems; i++)
+  {
+    int nVoxel = i / nComps;
+    int x = nVoxel % BENCHMARK_BRICK_SIZE, y = (nVoxel / BENCHMARK_BRICK_SIZE) % BENCHMARK_BRICK_SIZE;
+    int z = nVoxel / (BENCHMARK_BRICK_SIZE*BENCHMARK_BRICK_SIZE);
+
+    nRand = nRand*1103515245 + 12345;
+    unsigned long long v = 1000 + nSeed + 3*x + 5*y + 7*z + (i % nComps)*100 + ((nRand >> 16) & 7);
+    memcpy(pBrick + i*nElemSize, &v, nElemSize);   //little-endian machines only
+  }
+}
+
+//---------------------------------------------------------
+int mafBrickedFileCodecTest::RoundTrip(const char* pBrick, int nSize, int nElemSize, int nComps)
+//---------------------------------------------------------
+{
+  std::vector< char > packed(nSize), work(nSize), out(nSize);
+  int nPacked = mafBrickedFileCodec::Compress(pBrick, nSize, nElemSize, nComps, &packed[0], &work[0]);
+  CPPUNIT_ASSERT(nPacked > 0 && nPacked <= nSize);
+
+  mafBrickedFileCodec::Decompress(&packed[0], nPacked, &out[0], nSize, nElemSize, nComps, &work[0]);
+  CPPUNIT_ASSERT(memcmp(&out[0], pBrick, nSize) == 0);
+  return nPacked;
+}
+
+//---------------------------------------------------------
+void mafBrickedFileCodecTest::TestRoundTrip()
+//---------------------------------------------------------
+{
+  const int nElemSizes[4] = {1, 2, 4, 8};
+  for (int i = 0; i < 4; i++)
+  {
+    for (int nComps = 1; nComps <= 3; nComps += 2)
+    {
+      for (int nBS = 4; nBS <= BENCHMARK_BRICK_SIZE; nBS *= 2)
+      {
+        int nSize = nBS*nBS*nBS*nElemSizes[i]*nComps;
+        std::vector< char > brick(nSize);
+        FillBrick(&brick[0], nSize, nElemSizes[i], nComps, i + nBS);
+        RoundTrip(&brick[0], nSize, nElemSizes[i], nComps);
+
+        //long runs (e.g., air around the body) must be compressed well
+        memset(&brick[nSize / 4], 0, nSize - nSize / 4);
+        CPPUNIT_ASSERT(RoundTrip(&brick[0], nSize, nElemSizes[i], nComps) < nSize / 2);
+      }
+    }
+  }
+}
+
+//---------------------------------------------------------
+void mafBrickedFileCodecTest::TestIncompressible()
+//---------------------------------------------------------
+{
+  //random data cannot be compressed, it must be stored raw
+  int nSize = BENCHMARK_BRICK_SIZE*BENCHMARK_BRICK_SIZE*BENCHMARK_BRICK_SIZE*2;
+  std::vector< char > brick(nSize);
+
+  unsigned int nRand = 12345;
+  for (int i = 0; i < nSize; i++) {
+    nRand = nRand*1103515245 + 12345;
+    brick[i] = (char)(nRand >> 16);
+  }
+
+  CPPUNIT_ASSERT(RoundTrip(&brick[0], nSize, 2, 1) == nSize);
+}
+
+//---------------------------------------------------------
+void mafBrickedFileCodecTest::TestCorruptedData()
+//---------------------------------------------------------
+{
+  int nSize = BENCHMARK_BRICK_SIZE*BENCHMARK_BRICK_SIZE*BENCHMARK_BRICK_SIZE*2;
+  std::vector< char > brick(nSize), packed(nSize), work(nSize), out(nSize);
+  FillBrick(&brick[0], nSize, 2, 1, 0);
+
+  int nPacked = mafBrickedFileCodec::Compress(&brick[0], nSize, 2, 1, &packed[0], &work[0]);
+  CPPUNIT_ASSERT(nPacked < nSize);
+
+  //truncated data must be detected, not to write out of the brick
+  bool bFailed = false;
+  try
+  {
+    mafBrickedFileCodec::Decompress(&packed[0], nPacked / 2, &out[0], nSize, 2, 1, &work[0]);
+  }
+  catch (std::exception&) {
+    bFailed = true;
+  }
+  CPPUNIT_ASSERT(bFailed);
+
+  //damaged bytes may either produce a wrong brick or an exception, but never a crash
+  for (int i = 0; i < nPacked; i += 7)
+  {
+    std::vector< char > damaged(packed.begin(), packed.begin() + nPacked);
+    damaged[i] ^= 0x5A;
+
+    try {
+      mafBrickedFileCodec::Decompress(&damaged[0], nPacked, &out[0], nSize, 2, 1, &work[0]);
+    }
+    catch (std::exception&) {
+    }
+  }
+}
+
+//---------------------------------------------------------
+void mafBrickedFileCodecTest::TestCompressionBenchmark()
+//---------------------------------------------------------
+{
+  //16-bit CT-like bricks
+  int nSize = BENCHMARK_BRICK_SIZE*BENCHMARK_BRICK_SIZE*BENCHMARK_BRICK_SIZE*2;
+  std::vector< char > bricks(nSize*BENCHMARK_BRICKS), packed(nSize*BENCHMARK_BRICKS);
+  std::vector< char > out(nSize*BENCHMARK_BRICKS), work(nSize);
+  std::vector< int > sizes(BENCHMARK_BRICKS);
+
+  for (int i = 0; i < BENCHMARK_BRICKS; i++) {
+    FillBrick(&bricks[i*nSize], nSize, 2, 1, i);
+  }
+
+  double dblStart = vtkTimerLog::GetUniversalTime();
+  long long nPackedTotal = 0;
+  for (int i = 0; i < BENCHMARK_BRICKS; i++)
+  {
+    sizes[i] = mafBrickedFileCodec::Compress(&bricks[i*nSize], nSize, 2, 1, &packed[i*nSize], &work[0]);
+    nPackedTotal += sizes[i];
+  }
+  double dblEncode = vtkTimerLog::GetUniversalTime() - dblStart;
+
+  dblStart = vtkTimerLog::GetUniversalTime();
+  for (int j = 0; j < BENCHMARK_REPETITIONS; j++)
+  {
+    for (int i = 0; i < BENCHMARK_BRICKS; i++) {
+      mafBrickedFileCodec::Decompress(&packed[i*nSize], sizes[i], &out[i*nSize], nSize, 2, 1, &work[0]);
+    }
+  }
+  double dblDecode = vtkTimerLog::GetUniversalTime() - dblStart;
+
+  CPPUNIT_ASSERT(memcmp(&out[0], &bricks[0], bricks.size()) == 0);
+
+  double dblGB = ((double)nSize)*BENCHMARK_BRICKS / (1024.0*1024.0*1024.0);
+  std::cout << std::endl << "compression ratio " << ((double)nSize)*BENCHMARK_BRICKS / nPackedTotal <<
+    ", encode " << (dblEncode > 0.0 ? dblGB / dblEncode : 0.0) << " GB/s, decode " << 
+    (dblDecode > 0.0 ? dblGB*BENCHMARK_REPETITIONS / dblDecode : 0.0) << " GB/s (one thread)" << std::endl;
+}
@@ -0,0 +1,77 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: mafBrickedFileCodecTest
+ 
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __CPP_UNIT_mafBrickedFileCodecTest_H__
+#define __CPP_UNIT_mafBrickedFileCodecTest_H__
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/BriefTestProgressListener.h>
+#include <cppunit/CompilerOutputter.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/TestResult.h>
+#include <cppunit/TestResultCollector.h>
+#include <cppunit/TestRunner.h>
+
+class mafBrickedFileCodecTest : public CPPUNIT_NS::TestFixture
+{
+public: 
+  CPPUNIT_TEST_SUITE( mafBrickedFileCodecTest );
+  CPPUNIT_TEST( TestRoundTrip );
+  CPPUNIT_TEST( TestIncompressible );
+  CPPUNIT_TEST( TestCorruptedData );
+  CPPUNIT_TEST( TestCompressionBenchmark );
+  CPPUNIT_TEST_SUITE_END();
+
+protected:
+  void TestRoundTrip();
+  void TestIncompressible();
+  void TestCorruptedData();
+  void TestCompressionBenchmark();
+
+  /** fills the brick of nSize bytes with CT-like data (smooth ramp + noise),
+  nElemSize is size of one element, nComps number of components */
+  void FillBrick(char* pBrick, int nSize, int nElemSize, int nComps, int nSeed);
+
+  /** compresses and decompresses the brick, returns the compressed size */
+  int RoundTrip(const char* pBrick, int nSize, int nElemSize, int nComps);
+};
+
+int
+main( int argc, char* argv[] )
+{
+  // Create the event manager and test controller
+  CPPUNIT_NS::TestResult controller;
+
+  // Add a listener that colllects test result
+  CPPUNIT_NS::TestResultCollector result;
+  controller.addListener( &result );        
+
+  // Add a listener that print dots as test run.
+  CPPUNIT_NS::BriefTestProgressListener progress;
+  controller.addListener( &progress );      
+
+  // Add the top suite to the test runner
+  CPPUNIT_NS::TestRunner runner;
+  runner.addTest( mafBrickedFileCodecTest::suite());
+  runner.run( controller );
+
+  // Print test in a compiler compatible format.
+  CPPUNIT_NS::CompilerOutputter outputter( &result, CPPUNIT_NS::stdCOut() );
+  outputter.write(); 
+
+  return result.wasSuccessful() ? 0 : 1;
+}
+
+#endif
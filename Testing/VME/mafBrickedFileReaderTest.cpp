@@ -0,0 +1,215 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: mafBrickedFileReaderTest
+ 
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+
+#include "mafDefines.h" 
+#include "medDefines.h"
+//----------------------------------------------------------------------------
+// NOTE: Every CPP file in the MAF must include "mafDefines.h" as first.
+// This force to include Window,wxWidgets and VTK exactly in this order.
+// Failing in doing this will result in a run-time error saying:
+// "Failure#0: The value of ESP was not properly saved across a function call"
+//----------------------------------------------------------------------------
+
+#include <cppunit/config/SourcePrefix.h>
+
+#include "mafBrickedFileReaderTest.h"
+#include "../BES_Beta/IO/mafBrickedFileReader.h"
+#include "../BES_Beta/IO/mafBrickedFileCache.h"
+
+#include "vtkImageData.h"
+#include "vtkTimerLog.h"
+
+#include <iostream>
+
+#define BENCHMARK_REPETITIONS 10
+
+//----------------------------------------------------------------------------
+void mafBrickedFileReaderTest::setUp()
+//----------------------------------------------------------------------------
+{
+}
+//----------------------------------------------------------------------------
+void mafBrickedFileReaderTest::tearDown()
+//----------------------------------------------------------------------------
+{
+}
+
+//---------------------------------------------------------
+void mafBrickedFileReaderTest::TestDynamicAllocation()
+//---------------------------------------------------------
+{
+  mafBrickedFileReader *reader = new mafBrickedFileReader();
+  CPPUNIT_ASSERT(reader->GetUseMemoryMapping());
+  cppDEL(reader);
+}
+
+//---------------------------------------------------------
+long long mafBrickedFileReaderTest::ReadVOI(const int* VOI, bool bMapped, int nThreads, char** buffer, bool bUseCache)
+//---------------------------------------------------------
+{
+  mafString filename = MED_DATA_ROOT;
+  filename << "/Test_VolumeLarge/testVolume_02.bbf";
+
+  mafBrickedFileReader *reader = new mafBrickedFileReader();
+  reader->SetUseMemoryMapping(bMapped);
+  reader->SetPrefetchThreads(nThreads);
+  reader->SetUseBrickCache(bUseCache);
+  reader->SetFileName(filename);
+
+  if (VOI != NULL)
+    reader->SetVOI(const_cast<int*>(VOI));
+
+  CPPUNIT_ASSERT(reader->Update());
+  CPPUNIT_ASSERT(reader->IsMemoryMapped() == bMapped);
+
+  vtkImageData* output = reader->GetOutputDataSet();
+  long long nBytes = ((long long)output->GetNumberOfPoints())*
+    output->GetNumberOfScalarComponents()*output->GetScalarSize();
+
+  if (buffer != NULL)
+  {
+    *buffer = new char[nBytes];
+    memcpy(*buffer, output->GetScalarPointer(), nBytes);
+  }
+
+  cppDEL(reader);
+  return nBytes;
+}
+
+//---------------------------------------------------------
+void mafBrickedFileReaderTest::CompareMappedAndRead(const int* VOI, int nThreads)
+//---------------------------------------------------------
+{
+  char* pMapped = NULL, *pRead = NULL;
+  long long nMapped = ReadVOI(VOI, true, nThreads, &pMapped);
+  long long nRead = ReadVOI(VOI, false, 0, &pRead);
+
+  CPPUNIT_ASSERT(nMapped > 0 && nMapped == nRead);
+  CPPUNIT_ASSERT(memcmp(pMapped, pRead, nMapped) == 0);
+
+  delete[] pMapped;
+  delete[] pRead;
+}
+
+//---------------------------------------------------------
+void mafBrickedFileReaderTest::TestMemoryMappedFullVolume()
+//---------------------------------------------------------
+{
+  CompareMappedAndRead(NULL, 0);
+}
+
+//---------------------------------------------------------
+void mafBrickedFileReaderTest::TestMemoryMappedVOI()
+//---------------------------------------------------------
+{
+  //VOI is given in the highest resolution units, intentionally not aligned to bricks
+  const int VOI[6] = {5, 61, 3, 47, 1, 19};
+  CompareMappedAndRead(VOI, 0);
+}
+
+//---------------------------------------------------------
+void mafBrickedFileReaderTest::TestMappedVsReadThroughput()
+//---------------------------------------------------------
+{
+  const int VOI[6] = {5, 61, 3, 47, 1, 19};
+  const int* VOIs[2] = { NULL, VOI };
+  const char* szNames[2] = { "full volume", "VOI" };
+
+  for (int i = 0; i < 2; i++)
+  {
+    double dblTimes[2];
+    long long nBytes = 0;
+    for (int nMapped = 0; nMapped < 2; nMapped++)
+    {
+      double dblStart = vtkTimerLog::GetUniversalTime();
+      for (int j = 0; j < BENCHMARK_REPETITIONS; j++) {
+        nBytes = ReadVOI(VOIs[i], nMapped != 0, 0, NULL);
+      }
+
+      dblTimes[nMapped] = vtkTimerLog::GetUniversalTime() - dblStart;
+    }
+
+    double dblMB = ((double)nBytes)*BENCHMARK_REPETITIONS / (1024.0*1024.0);
+    std::cout << std::endl << szNames[i] << ": read() " << 
+      (dblTimes[0] > 0.0 ? dblMB / dblTimes[0] : 0.0) << " MB/s, mapped " << 
+      (dblTimes[1] > 0.0 ? dblMB / dblTimes[1] : 0.0) << " MB/s" << std::endl;
+  }
+}
+
+//---------------------------------------------------------
+void mafBrickedFileReaderTest::TestPrefetch()
+//---------------------------------------------------------
+{
+  const int VOI[6] = {5, 61, 3, 47, 1, 19};
+
+  //mapped with prefetch against plain read without prefetch
+  CompareMappedAndRead(NULL, 2);
+  CompareMappedAndRead(VOI, 4);
+
+  //read with prefetch (own file handles in IO threads) against plain read
+  char* pPrefetched = NULL, *pRead = NULL;
+  long long nPrefetched = ReadVOI(VOI, false, 3, &pPrefetched);
+  long long nRead = ReadVOI(VOI, false, 0, &pRead);
+
+  CPPUNIT_ASSERT(nPrefetched > 0 && nPrefetched == nRead);
+  CPPUNIT_ASSERT(memcmp(pPrefetched, pRead, nRead) == 0);
+
+  delete[] pPrefetched;
+  delete[] pRead;
+}
+
+//---------------------------------------------------------
+void mafBrickedFileReaderTest::TestBrickCache()
+//---------------------------------------------------------
+{
+  const int VOI1[6] = {5, 61, 3, 47, 1, 19};
+  const int VOI2[6] = {9, 65, 3, 47, 1, 19};    //VOI1 panned along x-axis
+  mafBrickedFileCache* pCache = mafBrickedFileCache::GetInstance();
+  pCache->Clear();
+  pCache->ResetStatistics();
+
+  //the first read loads every brick
+  char* pCached = NULL, *pRead = NULL;
+  ReadVOI(VOI1, true, 2, &pCached, true);
+  CPPUNIT_ASSERT(pCache->GetNumberOfHits() == 0);
+  CPPUNIT_ASSERT(pCache->GetMemoryUsed() > 0);
+  delete[] pCached;
+
+  //the second read should take all bricks from the cache
+  unsigned long long nMisses = pCache->GetNumberOfMisses();
+  long long nBytes = ReadVOI(VOI1, true, 2, &pCached, true);
+  ReadVOI(VOI1, false, 0, &pRead);
+  CPPUNIT_ASSERT(pCache->GetNumberOfHits() > 0);
+  CPPUNIT_ASSERT(pCache->GetNumberOfMisses() == nMisses);
+  CPPUNIT_ASSERT(memcmp(pCached, pRead, nBytes) == 0);
+  delete[] pCached;
+  delete[] pRead;
+
+  //panned VOI (another reader) reuses the bricks it shares with VOI1
+  unsigned long long nHits = pCache->GetNumberOfHits();
+  nBytes = ReadVOI(VOI2, false, 0, &pCached, true);
+  ReadVOI(VOI2, false, 0, &pRead);
+  CPPUNIT_ASSERT(pCache->GetNumberOfHits() > nHits);
+  CPPUNIT_ASSERT(memcmp(pCached, pRead, nBytes) == 0);
+  delete[] pCached;
+  delete[] pRead;
+
+  //no memory, no caching
+  unsigned long nLimit = pCache->GetMemoryLimit();
+  pCache->SetMemoryLimit(0);
+  CPPUNIT_ASSERT(pCache->GetMemoryUsed() == 0);
+  pCache->SetMemoryLimit(nLimit);
+}
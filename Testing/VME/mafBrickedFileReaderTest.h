@@ -0,0 +1,93 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: mafBrickedFileReaderTest
+ 
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __CPP_UNIT_mafBrickedFileReaderTest_H__
+#define __CPP_UNIT_mafBrickedFileReaderTest_H__
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/BriefTestProgressListener.h>
+#include <cppunit/CompilerOutputter.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/TestResult.h>
+#include <cppunit/TestResultCollector.h>
+#include <cppunit/TestRunner.h>
+
+//-----------------------------------------------------
+// forward references:
+//-----------------------------------------------------
+class mafBrickedFileReader;
+
+class mafBrickedFileReaderTest : public CPPUNIT_NS::TestFixture
+{
+public: 
+  // CPPUNIT fixture: executed before each test
+  void setUp();
+
+  // CPPUNIT fixture: executed after each test
+  void tearDown();
+
+  CPPUNIT_TEST_SUITE( mafBrickedFileReaderTest );
+  CPPUNIT_TEST( TestDynamicAllocation );
+  CPPUNIT_TEST( TestMemoryMappedFullVolume );
+  CPPUNIT_TEST( TestMemoryMappedVOI );
+  CPPUNIT_TEST( TestMappedVsReadThroughput );
+  CPPUNIT_TEST( TestPrefetch );
+  CPPUNIT_TEST( TestBrickCache );
+  CPPUNIT_TEST_SUITE_END();
+
+protected:
+  void TestDynamicAllocation();
+  void TestMemoryMappedFullVolume();
+  void TestMemoryMappedVOI();
+  void TestMappedVsReadThroughput();
+  void TestPrefetch();
+  void TestBrickCache();
+
+  /** reads the given VOI (NULL = whole volume) using either mapped or read access 
+  and nThreads prefetching threads and returns the number of bytes read; 
+  output scalars are copied into buffer, if not NULL */
+  long long ReadVOI(const int* VOI, bool bMapped, int nThreads, char** buffer, bool bUseCache = false);
+
+  /** compares the output produced by mapped and read access for the given VOI */
+  void CompareMappedAndRead(const int* VOI, int nThreads);
+};
+
+int
+main( int argc, char* argv[] )
+{
+  // Create the event manager and test controller
+  CPPUNIT_NS::TestResult controller;
+
+  // Add a listener that colllects test result
+  CPPUNIT_NS::TestResultCollector result;
+  controller.addListener( &result );        
+
+  // Add a listener that print dots as test run.
+  CPPUNIT_NS::BriefTestProgressListener progress;
+  controller.addListener( &progress );      
+
+  // Add the top suite to the test runner
+  CPPUNIT_NS::TestRunner runner;
+  runner.addTest( mafBrickedFileReaderTest::suite());
+  runner.run( controller );
+
+  // Print test in a compiler compatible format.
+  CPPUNIT_NS::CompilerOutputter outputter( &result, CPPUNIT_NS::stdCOut() );
+  outputter.write(); 
+
+  return result.wasSuccessful() ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,298 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: mafBrickedFileWriterTest
+
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+
+#include "mafDefines.h"
+#include "medDefines.h"
+//----------------------------------------------------------------------------
+// NOTE: Every CPP file in the MAF must include "mafDefines.h" as first.
+// This force to include Window,wxWidgets and VTK exactly in this order.
+// Failing in doing this will result in a run-time error saying:
+// "Failure#0: The value of ESP was not properly saved across a function call"
+//----------------------------------------------------------------------------
+
+#include <cppunit/config/SourcePrefix.h>
+
+#include "mafBrickedFileWriterTest.h"
+#include "../BES_Beta/IO/mafBrickedFileWriter.h"
+#include "../BES_Beta/IO/mafBrickedFileReader.h"
+#include "../BES_Beta/IO/mafVolumeLargeWriter.h"
+#include "../BES_Beta/vtkMAF/vtkMAFLargeImageReader.h"
+
+#include "vtkImageData.h"
+#include "vtkTimerLog.h"
+
+#include <stdio.h>
+#include <vector>
+#include <iostream>
+
+#define TEST_RAW_FILE   "mafBrickedFileWriterTest.raw"
+#define TEST_LOD_DIR    "mafBrickedFileWriterTestLOD"
+#define TEST_DIM_X      150
+#define TEST_DIM_Y      130
+#define TEST_DIM_Z      60
+
+#define BENCHMARK_REPETITIONS 10
+
+//exposes CreateLODs, so that it can be tested without GUI (Update shows busy info)
+class mafVolumeLargeWriterTestHelper : public mafVolumeLargeWriter
+{
+public:
+  int CreateLODs(int nMaxSampleRate, vtkIdType64& nTotalMaxSize) {
+    return mafVolumeLargeWriter::CreateLODs(nMaxSampleRate, nTotalMaxSize);
+  }
+};
+
+//----------------------------------------------------------------------------
+void mafBrickedFileWriterTest::setUp()
+//----------------------------------------------------------------------------
+{
+  //volume with uniform region (x < 32) and non-uniform region
+  std::vector< unsigned short > data(TEST_DIM_X*TEST_DIM_Y);
+  FILE* f = fopen(TEST_RAW_FILE, "wb");
+  CPPUNIT_ASSERT(f != NULL);
+
+  for (int z = 0; z < TEST_DIM_Z; z++)
+  {
+    for (int y = 0, idx = 0; y < TEST_DIM_Y; y++)
+    {
+      for (int x = 0; x < TEST_DIM_X; x++, idx++) {
+        data[idx] = (unsigned short)(x < 32 ? 100 : (x*y + 7*z) % 1000);
+      }
+    }
+
+    fwrite(&data[0], sizeof(unsigned short), data.size(), f);
+  }
+
+  fclose(f);
+
+  m_Reader = vtkMAFLargeImageReader::New();
+  m_Reader->SetFileName(TEST_RAW_FILE);
+  m_Reader->SetDataScalarType(VTK_UNSIGNED_SHORT);
+  m_Reader->SetNumberOfScalarComponents(1);
+  m_Reader->SetDataExtent(0, TEST_DIM_X - 1, 0, TEST_DIM_Y - 1, 0, TEST_DIM_Z - 1);
+  m_Reader->SetDataVOI(0, TEST_DIM_X - 1, 0, TEST_DIM_Y - 1, 0, TEST_DIM_Z - 1);
+  m_Reader->SetFileDimensionality(3);
+  m_Reader->Update();
+}
+//----------------------------------------------------------------------------
+void mafBrickedFileWriterTest::tearDown()
+//----------------------------------------------------------------------------
+{
+  vtkDEL(m_Reader);
+  remove(TEST_RAW_FILE);
+}
+
+//---------------------------------------------------------
+void mafBrickedFileWriterTest::TestDynamicAllocation()
+//---------------------------------------------------------
+{
+  mafBrickedFileWriter *writer = new mafBrickedFileWriter();
+  CPPUNIT_ASSERT(writer->GetNumberOfThreads() == -1);
+  cppDEL(writer);
+}
+
+//---------------------------------------------------------
+void mafBrickedFileWriterTest::WriteLevel(const char* fname, int nSampleRate, int nBrickSize, int nThreads,
+                                          bool bCompression)
+//---------------------------------------------------------
+{
+  mafBrickedFileWriter *writer = new mafBrickedFileWriter();
+  writer->SetInputDataSet(m_Reader->GetOutput());
+  writer->SetSampleRate(nSampleRate);
+  writer->SetBrickSize(nBrickSize);
+  writer->SetNumberOfThreads(nThreads);
+  writer->SetCompression(bCompression);
+  writer->SetFileName(fname);
+  CPPUNIT_ASSERT(writer->Update());
+  cppDEL(writer);
+}
+
+//---------------------------------------------------------
+bool mafBrickedFileWriterTest::CompareFiles(const char* fname1, const char* fname2)
+//---------------------------------------------------------
+{
+  FILE* f1 = fopen(fname1, "rb");
+  FILE* f2 = fopen(fname2, "rb");
+
+  bool bEqual = (f1 != NULL && f2 != NULL);
+  while (bEqual)
+  {
+    char buf1[4096], buf2[4096];
+    size_t n1 = fread(buf1, 1, sizeof(buf1), f1);
+    size_t n2 = fread(buf2, 1, sizeof(buf2), f2);
+
+    bEqual = (n1 == n2 && memcmp(buf1, buf2, n1) == 0);
+    if (n1 == 0)
+      break;
+  }
+
+  if (f1 != NULL)
+    fclose(f1);
+  if (f2 != NULL)
+    fclose(f2);
+
+  return bEqual;
+}
+
+//---------------------------------------------------------
+void mafBrickedFileWriterTest::TestThreadedOutput()
+//---------------------------------------------------------
+{
+  //output must not depend on the number of threads
+  const int nSampleRates[2] = {1, 3};
+  for (int i = 0; i < 2; i++)
+  {
+    WriteLevel("mafBrickedFileWriterTest_seq.bbf", nSampleRates[i], 8, 0);
+    WriteLevel("mafBrickedFileWriterTest_mt1.bbf", nSampleRates[i], 8, 1);
+    WriteLevel("mafBrickedFileWriterTest_mt4.bbf", nSampleRates[i], 8, 4);
+
+    CPPUNIT_ASSERT(CompareFiles("mafBrickedFileWriterTest_seq.bbf", "mafBrickedFileWriterTest_mt1.bbf"));
+    CPPUNIT_ASSERT(CompareFiles("mafBrickedFileWriterTest_seq.bbf", "mafBrickedFileWriterTest_mt4.bbf"));
+  }
+
+  remove("mafBrickedFileWriterTest_seq.bbf");
+  remove("mafBrickedFileWriterTest_mt1.bbf");
+  remove("mafBrickedFileWriterTest_mt4.bbf");
+}
+
+//---------------------------------------------------------
+void mafBrickedFileWriterTest::TestOnePassLODs()
+//---------------------------------------------------------
+{
+  const int nLevels = 3;
+
+  mafVolumeLargeWriterTestHelper wr;
+  wr.SetInputDataSet(m_Reader->GetOutput());
+  wr.SetOutputFileName(TEST_LOD_DIR "/vol.bbf");
+  wr.SetNumberOfThreads(3);
+
+  vtkIdType64 nTotalSize = wr.GetEstimatedTotalSize(nLevels)*4;  //no limit
+  CPPUNIT_ASSERT(wr.CreateLODs(nLevels, nTotalSize) == nLevels);
+
+  //every level must be the same as if it was written separately
+  for (int i = 1; i <= nLevels; i++)
+  {
+    //brick size computed by mafVolumeLargeWriter is 4 for 3 levels
+    wxString szLOD = wxString::Format("%s%c%c%s_%02d.bbf", TEST_LOD_DIR,
+      wxFILE_SEP_PATH, wxFILE_SEP_PATH, "vol", i);
+
+    WriteLevel("mafBrickedFileWriterTest_lod.bbf", i, 4, 0);
+    CPPUNIT_ASSERT(CompareFiles("mafBrickedFileWriterTest_lod.bbf", szLOD));
+    remove(szLOD);
+  }
+
+  remove("mafBrickedFileWriterTest_lod.bbf");
+  wxRmdir(TEST_LOD_DIR);
+}
+
+//---------------------------------------------------------
+long long mafBrickedFileWriterTest::ReadLevel(const char* fname, const int* VOI, bool bMapped, int nThreads,
+                                              std::vector< char >* data)
+//---------------------------------------------------------
+{
+  mafBrickedFileReader *reader = new mafBrickedFileReader();
+  reader->SetUseMemoryMapping(bMapped);
+  reader->SetPrefetchThreads(nThreads);
+  reader->SetUseBrickCache(false);  //bricks must be really loaded
+  reader->SetFileName(fname);
+
+  if (VOI != NULL)
+    reader->SetVOI(const_cast<int*>(VOI));
+
+  CPPUNIT_ASSERT(reader->Update());
+
+  vtkImageData* output = reader->GetOutputDataSet();
+  long long nBytes = ((long long)output->GetNumberOfPoints())*
+    output->GetNumberOfScalarComponents()*output->GetScalarSize();
+
+  if (data != NULL)
+  {
+    const char* pData = (const char*)output->GetScalarPointer();
+    data->assign(pData, pData + nBytes);
+  }
+
+  cppDEL(reader);
+  return nBytes;
+}
+
+//---------------------------------------------------------
+void mafBrickedFileWriterTest::TestCompressedOutput()
+//---------------------------------------------------------
+{
+  WriteLevel("mafBrickedFileWriterTest_v2.bbf", 1, 8, 0);
+  WriteLevel("mafBrickedFileWriterTest_v3.bbf", 1, 8, 0, true);
+  WriteLevel("mafBrickedFileWriterTest_v3mt.bbf", 1, 8, 4, true);
+
+  //output must not depend on the number of threads and must be smaller
+  CPPUNIT_ASSERT(CompareFiles("mafBrickedFileWriterTest_v3.bbf", "mafBrickedFileWriterTest_v3mt.bbf"));
+  CPPUNIT_ASSERT(vtkMAFFile::GetFileSize("mafBrickedFileWriterTest_v3.bbf") <
+    vtkMAFFile::GetFileSize("mafBrickedFileWriterTest_v2.bbf"));
+
+  CPPUNIT_ASSERT(mafBrickedFileReader::GetFileVersion("mafBrickedFileWriterTest_v2.bbf") == 2);
+  CPPUNIT_ASSERT(mafBrickedFileReader::GetFileVersion("mafBrickedFileWriterTest_v3.bbf") == 3);
+
+  //both versions must give the same data, random VOI access included
+  const int VOI[6] = {5, 97, 3, 101, 1, 44};
+  const int* VOIs[2] = { NULL, VOI };
+  for (int i = 0; i < 2; i++)
+  {
+    std::vector< char > data2, data3;
+    ReadLevel("mafBrickedFileWriterTest_v2.bbf", VOIs[i], false, 0, &data2);
+
+    for (int nMapped = 0; nMapped < 2; nMapped++)
+    {
+      for (int nThreads = 0; nThreads <= 3; nThreads += 3)
+      {
+        ReadLevel("mafBrickedFileWriterTest_v3.bbf", VOIs[i], nMapped != 0, nThreads, &data3);
+        CPPUNIT_ASSERT(data2.size() > 0 && data2 == data3);
+      }
+    }
+  }
+
+  remove("mafBrickedFileWriterTest_v2.bbf");
+  remove("mafBrickedFileWriterTest_v3.bbf");
+  remove("mafBrickedFileWriterTest_v3mt.bbf");
+}
+
+//---------------------------------------------------------
+void mafBrickedFileWriterTest::TestCompressionBenchmark()
+//---------------------------------------------------------
+{
+  const char* szNames[2] = { "mafBrickedFileWriterTest_v2.bbf", "mafBrickedFileWriterTest_v3.bbf" };
+  WriteLevel(szNames[0], 1, 16, -1);
+  WriteLevel(szNames[1], 1, 16, -1, true);
+
+  double dblTimes[2];
+  long long nBytes = 0;
+  for (int i = 0; i < 2; i++)
+  {
+    double dblStart = vtkTimerLog::GetUniversalTime();
+    for (int j = 0; j < BENCHMARK_REPETITIONS; j++) {
+      nBytes = ReadLevel(szNames[i], NULL, true, 2, NULL);
+    }
+
+    dblTimes[i] = vtkTimerLog::GetUniversalTime() - dblStart;
+  }
+
+  double dblGB = ((double)nBytes)*BENCHMARK_REPETITIONS / (1024.0*1024.0*1024.0);
+  std::cout << std::endl << "BBF v3 compression ratio " << 
+    ((double)vtkMAFFile::GetFileSize(szNames[0])) / vtkMAFFile::GetFileSize(szNames[1]) <<
+    ", full volume read: v2 " << (dblTimes[0] > 0.0 ? dblGB / dblTimes[0] : 0.0) << 
+    " GB/s, v3 (decode) " << (dblTimes[1] > 0.0 ? dblGB / dblTimes[1] : 0.0) << " GB/s" << std::endl;
+
+  remove(szNames[0]);
+  remove(szNames[1]);
+}
@@ -0,0 +1,102 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: mafBrickedFileWriterTest
+ 
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __CPP_UNIT_mafBrickedFileWriterTest_H__
+#define __CPP_UNIT_mafBrickedFileWriterTest_H__
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/BriefTestProgressListener.h>
+#include <cppunit/CompilerOutputter.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/TestResult.h>
+#include <cppunit/TestResultCollector.h>
+#include <cppunit/TestRunner.h>
+
+#include <vector>
+
+//-----------------------------------------------------
+// forward references:
+//-----------------------------------------------------
+class mafBrickedFileWriter;
+class vtkMAFLargeImageReader;
+
+class mafBrickedFileWriterTest : public CPPUNIT_NS::TestFixture
+{
+public: 
+  // CPPUNIT fixture: executed before each test
+  void setUp();
+
+  // CPPUNIT fixture: executed after each test
+  void tearDown();
+
+  CPPUNIT_TEST_SUITE( mafBrickedFileWriterTest );
+  CPPUNIT_TEST( TestDynamicAllocation );
+  CPPUNIT_TEST( TestThreadedOutput );
+  CPPUNIT_TEST( TestOnePassLODs );
+  CPPUNIT_TEST( TestCompressedOutput );
+  CPPUNIT_TEST( TestCompressionBenchmark );
+  CPPUNIT_TEST_SUITE_END();
+
+protected:
+  void TestDynamicAllocation();
+  void TestThreadedOutput();
+  void TestOnePassLODs();
+  void TestCompressedOutput();
+  void TestCompressionBenchmark();
+
+  /** writes one level with the given sample rate and brick size 
+  using nThreads worker threads into the file fname, 
+  if bCompression is true, BBF version 3 is written */
+  void WriteLevel(const char* fname, int nSampleRate, int nBrickSize, int nThreads,
+    bool bCompression = false);
+
+  /** reads VOI (NULL = the whole volume) of the file fname into data, 
+  returns the number of bytes read */
+  long long ReadLevel(const char* fname, const int* VOI, bool bMapped, int nThreads,
+    std::vector< char >* data);
+
+  /** returns true, if both files have the same content */
+  bool CompareFiles(const char* fname1, const char* fname2);
+
+  vtkMAFLargeImageReader* m_Reader;
+};
+
+int
+main( int argc, char* argv[] )
+{
+  // Create the event manager and test controller
+  CPPUNIT_NS::TestResult controller;
+
+  // Add a listener that colllects test result
+  CPPUNIT_NS::TestResultCollector result;
+  controller.addListener( &result );        
+
+  // Add a listener that print dots as test run.
+  CPPUNIT_NS::BriefTestProgressListener progress;
+  controller.addListener( &progress );      
+
+  // Add the top suite to the test runner
+  CPPUNIT_NS::TestRunner runner;
+  runner.addTest( mafBrickedFileWriterTest::suite());
+  runner.run( controller );
+
+  // Print test in a compiler compatible format.
+  CPPUNIT_NS::CompilerOutputter outputter( &result, CPPUNIT_NS::stdCOut() );
+  outputter.write(); 
+
+  return result.wasSuccessful() ? 0 : 1;
+}
+
+#endif
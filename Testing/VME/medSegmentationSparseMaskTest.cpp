@@ -0,0 +1,307 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: medSegmentationSparseMaskTest
+ 
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "medDefines.h" 
+//----------------------------------------------------------------------------
+// NOTE: Every CPP file in the MAF must include "mafDefines.h" as first.
+// This force to include Window,wxWidgets and VTK exactly in this order.
+// Failing in doing this will result in a run-time error saying:
+// "Failure#0: The value of ESP was not properly saved across a function call"
+//----------------------------------------------------------------------------
+
+#include <cppunit/config/SourcePrefix.h>
+#include "medSegmentationSparseMaskTest.h"
+
+#include "medSegmentationSparseMask.h"
+
+#include <vector>
+#include <algorithm>
+
+const int DIM_X = 40;
+const int DIM_Y = 35;
+const int DIM_Z = 20;
+const int NUMBER_OF_POINTS = DIM_X * DIM_Y * DIM_Z;
+
+//----------------------------------------------------------------------------
+static void DrawBox(std::vector<unsigned char> &values, int x0, int x1, int y0, int y1, int z0, int z1, unsigned char value)
+//----------------------------------------------------------------------------
+{
+  for (int z = z0; z <= z1; z++)
+    for (int y = y0; y <= y1; y++)
+      for (int x = x0; x <= x1; x++)
+        values[x + y * DIM_X + z * DIM_X * DIM_Y] = value;
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMaskTest::TestFixture()
+//----------------------------------------------------------------------------
+{
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMaskTest::setUp()
+//----------------------------------------------------------------------------
+{
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMaskTest::tearDown()
+//----------------------------------------------------------------------------
+{
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMaskTest::TestDynamicAllocation()
+//----------------------------------------------------------------------------
+{
+  medSegmentationSparseMask *mask = new medSegmentationSparseMask();
+  cppDEL(mask);
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMaskTest::TestSetGetArray()
+//----------------------------------------------------------------------------
+{
+  int dims[3] = {DIM_X, DIM_Y, DIM_Z};
+  medSegmentationSparseMask mask;
+  mask.SetDimensions(dims);
+
+  int nTiles[3];
+  mask.GetNumberOfTiles(nTiles);
+  CPPUNIT_ASSERT(nTiles[0] == 3 && nTiles[1] == 3 && nTiles[2] == 2);
+  CPPUNIT_ASSERT(mask.GetNumberOfTiles(medSegmentationSparseMask::EMPTY_TILE) == 18);
+
+  // a box covering the first tile and crossing the second tile along x
+  std::vector<unsigned char> values(NUMBER_OF_POINTS, 0);
+  DrawBox(values, 0, 20, 0, 15, 0, 15, 255);
+  mask.SetArray(&values[0]);
+
+  CPPUNIT_ASSERT(mask.GetTileState(0) == medSegmentationSparseMask::FULL_TILE);
+  CPPUNIT_ASSERT(mask.GetTileState(1) == medSegmentationSparseMask::DENSE_TILE);
+  CPPUNIT_ASSERT(mask.GetNumberOfTiles(medSegmentationSparseMask::EMPTY_TILE) == 16);
+  CPPUNIT_ASSERT(mask.GetNumberOfSetPoints() == 21 * 16 * 16);
+
+  std::vector<unsigned char> result(NUMBER_OF_POINTS, 1);
+  mask.GetArray(&result[0]);
+  CPPUNIT_ASSERT(result == values);
+
+  // the border tiles are partially inside the volume
+  mask.Fill(255);
+  CPPUNIT_ASSERT(mask.GetNumberOfTiles(medSegmentationSparseMask::FULL_TILE) == 18);
+  CPPUNIT_ASSERT(mask.GetNumberOfSetPoints() == NUMBER_OF_POINTS);
+
+  std::vector<unsigned char> full(NUMBER_OF_POINTS, 255);
+  mask.Fill(0);
+  mask.SetArray(&full[0]);
+  CPPUNIT_ASSERT(mask.GetNumberOfTiles(medSegmentationSparseMask::FULL_TILE) == 18);
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMaskTest::TestSetValue()
+//----------------------------------------------------------------------------
+{
+  int dims[3] = {DIM_X, DIM_Y, DIM_Z};
+  medSegmentationSparseMask mask;
+  mask.SetDimensions(dims);
+
+  mask.SetValue(39, 34, 19, 0);
+  CPPUNIT_ASSERT(mask.GetNumberOfTiles(medSegmentationSparseMask::DENSE_TILE) == 0);
+
+  mask.SetValue(39, 34, 19, 1);
+  CPPUNIT_ASSERT(mask.GetValue(39, 34, 19) == 255);
+  CPPUNIT_ASSERT(mask.GetValue(38, 34, 19) == 0);
+  CPPUNIT_ASSERT(mask.GetTileState(17) == medSegmentationSparseMask::DENSE_TILE);
+
+  mask.SetValue(39, 34, 19, 0);
+  mask.Squeeze();
+  CPPUNIT_ASSERT(mask.GetTileState(17) == medSegmentationSparseMask::EMPTY_TILE);
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMaskTest::TestOr()
+//----------------------------------------------------------------------------
+{
+  int dims[3] = {DIM_X, DIM_Y, DIM_Z};
+  std::vector<unsigned char> a(NUMBER_OF_POINTS, 0);
+  std::vector<unsigned char> b(NUMBER_OF_POINTS, 0);
+  DrawBox(a, 5, 10, 5, 10, 0, 19, 255);
+  DrawBox(b, 8, 30, 8, 30, 0, 19, 255);
+
+  medSegmentationSparseMask maskA, maskB;
+  maskA.SetDimensions(dims);
+  maskB.SetDimensions(dims);
+  maskA.SetArray(&a[0]);
+  maskB.SetArray(&b[0]);
+
+  // only the slices from 3 to 12 are changed
+  maskA.Or(&maskB, 3, 12);
+
+  std::vector<unsigned char> result(NUMBER_OF_POINTS);
+  maskA.GetArray(&result[0]);
+  for (int p = 0; p < NUMBER_OF_POINTS; p++)
+  {
+    int z = p / (DIM_X * DIM_Y);
+    unsigned char expected = (z >= 3 && z <= 12) ? (a[p] | b[p]) : a[p];
+    CPPUNIT_ASSERT(result[p] == expected);
+  }
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMaskTest::TestXor()
+//----------------------------------------------------------------------------
+{
+  int dims[3] = {DIM_X, DIM_Y, DIM_Z};
+  std::vector<unsigned char> a(NUMBER_OF_POINTS, 0);
+  std::vector<unsigned char> b(NUMBER_OF_POINTS, 0);
+  DrawBox(a, 0, 39, 0, 15, 0, 15, 255);
+  DrawBox(b, 0, 15, 0, 31, 0, 15, 255);
+
+  medSegmentationSparseMask maskA, maskB;
+  maskA.SetDimensions(dims);
+  maskB.SetDimensions(dims);
+  maskA.SetArray(&a[0]);
+  maskB.SetArray(&b[0]);
+
+  maskA.Xor(&maskB);
+
+  // full tile xor full tile gives an empty tile
+  CPPUNIT_ASSERT(maskA.GetTileState(0) == medSegmentationSparseMask::EMPTY_TILE);
+  CPPUNIT_ASSERT(maskA.GetTileState(3) == medSegmentationSparseMask::FULL_TILE);
+
+  std::vector<unsigned char> result(NUMBER_OF_POINTS);
+  maskA.GetArray(&result[0]);
+  for (int p = 0; p < NUMBER_OF_POINTS; p++)
+  {
+    CPPUNIT_ASSERT(result[p] == (a[p] ^ b[p]));
+  }
+
+  // xor is its own inverse
+  maskA.Xor(&maskB);
+  maskA.GetArray(&result[0]);
+  CPPUNIT_ASSERT(result == a);
+
+  // a dense tile made uniform by the inversion is compacted
+  medSegmentationSparseMask maskC;
+  maskC.SetDimensions(dims);
+  maskC.SetValue(0, 0, 0, 255);
+  maskC.SetValue(0, 0, 0, 0);
+  CPPUNIT_ASSERT(maskC.GetTileState(0) == medSegmentationSparseMask::DENSE_TILE);
+  maskC.Xor(&maskB);
+  CPPUNIT_ASSERT(maskC.GetTileState(0) == medSegmentationSparseMask::FULL_TILE);
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMaskTest::TestSetGetExtent()
+//----------------------------------------------------------------------------
+{
+  int dims[3] = {DIM_X, DIM_Y, DIM_Z};
+  medSegmentationSparseMask mask;
+  mask.SetDimensions(dims);
+
+  std::vector<unsigned char> values(NUMBER_OF_POINTS, 0);
+  DrawBox(values, 0, 20, 0, 15, 0, 15, 255);
+  mask.SetArray(&values[0]);
+
+  // a YZ slice crossing the full tile and the dense tile of the box: x is the collapsed axis
+  int yzExtent[6] = {5, 5, 0, DIM_Y - 1, 0, DIM_Z - 1};
+  std::vector<unsigned char> slice(DIM_Y * DIM_Z, 1);
+  mask.GetExtent(yzExtent, &slice[0]);
+  for (int z = 0; z < DIM_Z; z++)
+    for (int y = 0; y < DIM_Y; y++)
+      CPPUNIT_ASSERT(slice[y + z * DIM_Y] == values[5 + y * DIM_X + z * DIM_X * DIM_Y]);
+
+  // erasing the slice makes dense only the tiles it crosses
+  std::fill(slice.begin(), slice.end(), 0);
+  mask.SetExtent(yzExtent, &slice[0]);
+  DrawBox(values, 5, 5, 0, DIM_Y - 1, 0, DIM_Z - 1, 0);
+  CPPUNIT_ASSERT(mask.GetTileState(0) == medSegmentationSparseMask::DENSE_TILE);
+  CPPUNIT_ASSERT(mask.GetTileState(2) == medSegmentationSparseMask::EMPTY_TILE);
+  CPPUNIT_ASSERT(mask.GetNumberOfSetPoints() == 20 * 16 * 16);
+
+  // a box across the borders of the tiles
+  int boxExtent[6] = {14, 33, 10, 17, 3, 18};
+  int boxSize = 20 * 8 * 16;
+  std::vector<unsigned char> box(boxSize, 255);
+  mask.SetExtent(boxExtent, &box[0]);
+  DrawBox(values, 14, 33, 10, 17, 3, 18, 255);
+
+  std::vector<unsigned char> result(NUMBER_OF_POINTS, 1);
+  mask.GetArray(&result[0]);
+  CPPUNIT_ASSERT(result == values);
+
+  std::fill(box.begin(), box.end(), 1);
+  mask.GetExtent(boxExtent, &box[0]);
+  CPPUNIT_ASSERT(std::count(box.begin(), box.end(), 255) == boxSize);
+
+  // restoring the values compacts the tiles again
+  DrawBox(values, 0, DIM_X - 1, 0, DIM_Y - 1, 0, DIM_Z - 1, 0);
+  int wholeExtent[6] = {0, DIM_X - 1, 0, DIM_Y - 1, 0, DIM_Z - 1};
+  mask.SetExtent(wholeExtent, &values[0]);
+  CPPUNIT_ASSERT(mask.GetNumberOfTiles(medSegmentationSparseMask::EMPTY_TILE) == 18);
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMaskTest::TestMemorySize()
+//----------------------------------------------------------------------------
+{
+  int dims[3] = {128, 128, 128};
+  int numberOfPoints = dims[0] * dims[1] * dims[2];
+  std::vector<unsigned char> values(numberOfPoints, 0);
+  for (int z = 0; z < dims[2]; z++)
+    for (int y = 0; y < dims[1]; y++)
+      for (int x = 0; x < dims[0]; x++)
+      {
+        int dx = x - 64, dy = y - 64, dz = z - 64;
+        if (dx * dx + dy * dy + dz * dz < 40 * 40)
+          values[x + y * dims[0] + z * dims[0] * dims[1]] = 255;
+      }
+
+  medSegmentationSparseMask mask;
+  mask.SetDimensions(dims);
+  mask.SetArray(&values[0]);
+
+  // only the tiles on the surface of the sphere are dense
+  CPPUNIT_ASSERT(mask.GetNumberOfTiles(medSegmentationSparseMask::FULL_TILE) > 0);
+  CPPUNIT_ASSERT(mask.GetMemorySize() < numberOfPoints / 2);
+
+  medSegmentationSparseMask copy;
+  copy.DeepCopy(&mask);
+  CPPUNIT_ASSERT(copy.GetMemorySize() == mask.GetMemorySize());
+  CPPUNIT_ASSERT(copy.GetNumberOfSetPoints() == mask.GetNumberOfSetPoints());
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMaskTest::TestMemorySizeOfMostlyEmptyMask()
+//----------------------------------------------------------------------------
+{
+  // a 512x512x256 mask (64 MB dense) with a few brush strokes on some slices, as the manual tools do
+  int dims[3] = {512, 512, 256};
+  double numberOfPoints = (double)dims[0] * dims[1] * dims[2];
+  medSegmentationSparseMask mask;
+  mask.SetDimensions(dims);
+
+  int strokeExtent[6] = {200, 239, 296, 303, 0, 0};
+  std::vector<unsigned char> stroke(40 * 8, 255);
+  for (int z = 100; z < 110; z++)
+  {
+    strokeExtent[4] = strokeExtent[5] = z;
+    mask.SetExtent(strokeExtent, &stroke[0]);
+  }
+
+  CPPUNIT_ASSERT(mask.GetNumberOfSetPoints() == 40 * 8 * 10);
+
+  // only the 3 tiles crossed by the strokes are dense: the footprint is a fraction of the dense volume
+  CPPUNIT_ASSERT(mask.GetNumberOfTiles(medSegmentationSparseMask::DENSE_TILE) == 3);
+  CPPUNIT_ASSERT(mask.GetMemorySize() < numberOfPoints / 100);
+
+  // erasing the strokes releases the tiles
+  std::fill(stroke.begin(), stroke.end(), 0);
+  for (int z = 100; z < 110; z++)
+  {
+    strokeExtent[4] = strokeExtent[5] = z;
+    mask.SetExtent(strokeExtent, &stroke[0]);
+  }
+  CPPUNIT_ASSERT(mask.GetNumberOfTiles(medSegmentationSparseMask::DENSE_TILE) == 0);
+  CPPUNIT_ASSERT(mask.GetNumberOfTiles(medSegmentationSparseMask::EMPTY_TILE) == mask.GetNumberOfTiles());
+}
@@ -0,0 +1,87 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: medSegmentationSparseMaskTest
+ 
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __CPP_UNIT_medSegmentationSparseMaskTest_H__
+#define __CPP_UNIT_medSegmentationSparseMaskTest_H__
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/BriefTestProgressListener.h>
+#include <cppunit/CompilerOutputter.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/TestResult.h>
+#include <cppunit/TestResultCollector.h>
+#include <cppunit/TestRunner.h>
+
+/** Test for medSegmentationSparseMask */
+class medSegmentationSparseMaskTest : public CPPUNIT_NS::TestFixture
+{
+public: 
+  // CPPUNIT fixture: executed before each test
+  void setUp();
+
+  // CPPUNIT fixture: executed after each test
+  void tearDown();
+
+  // CPPUNIT test suite
+  CPPUNIT_TEST_SUITE( medSegmentationSparseMaskTest );
+  CPPUNIT_TEST( TestFixture ); // just to test that the fixture has no leaks
+  CPPUNIT_TEST( TestDynamicAllocation );
+  CPPUNIT_TEST( TestSetGetArray );
+  CPPUNIT_TEST( TestSetValue );
+  CPPUNIT_TEST( TestOr );
+  CPPUNIT_TEST( TestXor );
+  CPPUNIT_TEST( TestSetGetExtent );
+  CPPUNIT_TEST( TestMemorySize );
+  CPPUNIT_TEST( TestMemorySizeOfMostlyEmptyMask );
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  void TestFixture();
+  void TestDynamicAllocation();
+  void TestSetGetArray();
+  void TestSetValue();
+  void TestOr();
+  void TestXor();
+  void TestSetGetExtent();
+  void TestMemorySize();
+  void TestMemorySizeOfMostlyEmptyMask();
+};
+
+int
+main( int argc, char* argv[] )
+{
+  // Create the event manager and test controller
+  CPPUNIT_NS::TestResult controller;
+
+  // Add a listener that collects test result
+  CPPUNIT_NS::TestResultCollector result;
+  controller.addListener( &result );        
+
+  // Add a listener that print dots as test run.
+  CPPUNIT_NS::BriefTestProgressListener progress;
+  controller.addListener( &progress );      
+
+  // Add the top suite to the test runner
+  CPPUNIT_NS::TestRunner runner;
+  runner.addTest( medSegmentationSparseMaskTest::suite());
+  runner.run( controller );
+
+  // Print test in a compiler compatible format.
+  CPPUNIT_NS::CompilerOutputter outputter( &result, CPPUNIT_NS::stdCOut() );
+  outputter.write(); 
+
+  return result.wasSuccessful() ? 0 : 1;
+}
+#endif
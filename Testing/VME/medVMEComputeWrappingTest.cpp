@@ -0,0 +1,243 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: medVMEComputeWrappingTest
+ 
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+
+#include "mafDefines.h" 
+//----------------------------------------------------------------------------
+// NOTE: Every CPP file in the MAF must include "mafDefines.h" as first.
+// This force to include Window,wxWidgets and VTK exactly in this order.
+// Failing in doing this will result in a run-time error saying:
+// "Failure#0: The value of ESP was not properly saved across a function call"
+//----------------------------------------------------------------------------
+
+#include <cppunit/config/SourcePrefix.h>
+#include "medVMEComputeWrappingTest.h"
+
+#include "medVMEComputeWrapping.h"
+
+#include "mafVMEStorage.h"
+#include "mafVMERoot.h"
+#include "mafVMESurfaceParametric.h"
+#include "mafMatrix.h"
+
+#include "vtkTimerLog.h"
+#include "vtkSphereSource.h"
+#include "vtkPolyData.h"
+#include "vtkPoints.h"
+#include "vtkIdList.h"
+
+#include <iostream>
+#include <vector>
+#include <math.h>
+#include <algorithm>
+
+#define TEST_RESULT CPPUNIT_ASSERT(m_Result)
+#define TOLERANCE 1.0e-2
+
+//----------------------------------------------------------------------------
+void medVMEComputeWrappingTest::TestFixture()
+//----------------------------------------------------------------------------
+{
+}
+//----------------------------------------------------------------------------
+void medVMEComputeWrappingTest::setUp()
+//----------------------------------------------------------------------------
+{
+  m_Result = false;
+}
+//----------------------------------------------------------------------------
+void medVMEComputeWrappingTest::tearDown()
+//----------------------------------------------------------------------------
+{
+}
+//----------------------------------------------------------------------------
+void medVMEComputeWrappingTest::TestDynamicAllocation()
+//----------------------------------------------------------------------------
+{
+  medVMEComputeWrapping *wrappedMeter;
+  mafNEW(wrappedMeter);
+  m_Result = wrappedMeter->GetWarmStart() == 0;
+  TEST_RESULT;
+  mafDEL(wrappedMeter);
+}
+//----------------------------------------------------------------------------
+void medVMEComputeWrappingTest::TestWarmStartTrajectory()
+//----------------------------------------------------------------------------
+{
+  const int numberOfFrames = 50;
+
+  mafVMEStorage *storage = mafVMEStorage::New();
+  storage->GetRoot()->SetName("root");
+  storage->GetRoot()->Initialize();
+
+  mafVMESurfaceParametric *vmeSphere;
+  mafNEW(vmeSphere);
+  vmeSphere->SetParent(storage->GetRoot());
+  vmeSphere->SetGeometryType(mafVMESurfaceParametric::PARAMETRIC_SPHERE);
+  vmeSphere->SetSphereRadius(5.0);
+  vmeSphere->Update();
+
+  mafVMESurfaceParametric *vmeCylinder;
+  mafNEW(vmeCylinder);
+  vmeCylinder->SetParent(storage->GetRoot());
+  vmeCylinder->SetGeometryType(mafVMESurfaceParametric::PARAMETRIC_CYLINDER);
+  vmeCylinder->SetCylinderRadius(2.0);
+  vmeCylinder->SetCylinderHeight(40.0);
+  vmeCylinder->Update();
+
+  mafVMESurfaceParametric *vmeStart;
+  mafNEW(vmeStart);
+  vmeStart->SetParent(storage->GetRoot());
+  vmeStart->Update();
+
+  mafVMESurfaceParametric *vmeEnd;
+  mafNEW(vmeEnd);
+  vmeEnd->SetParent(storage->GetRoot());
+  vmeEnd->Update();
+
+  mafMatrix endMatrix;
+  endMatrix.SetElement(0,3,2.5);
+  endMatrix.SetElement(1,3,-15.0);
+  vmeEnd->SetAbsMatrix(endMatrix);
+
+  //the same meter is wrapped with (index 1) and without (index 0) the warm start
+  medVMEComputeWrapping *wrappedMeter[2];
+  for (int m = 0; m < 2; m++)
+  {
+    mafNEW(wrappedMeter[m]);
+    wrappedMeter[m]->SetMeterLink("StartVME",vmeStart);
+    wrappedMeter[m]->SetMeterLink("EndVME1",vmeEnd);
+    wrappedMeter[m]->SetMeterLink("WrappedVME1",vmeSphere);
+    wrappedMeter[m]->SetMeterLink("WrappedVME2",vmeCylinder);
+    wrappedMeter[m]->SetWrappedClass(medVMEComputeWrapping::NEW_METER);
+    wrappedMeter[m]->SetWrappedMode1(medVMEComputeWrapping::SPHERE_CYLINDER);
+    wrappedMeter[m]->SetWarmStart(m);
+    wrappedMeter[m]->SetParent(storage->GetRoot());
+  }
+
+  //recorded trajectory: the start point moves on an arc above the sphere
+  std::vector<double> lengths[2];
+  double time[2] = {0.0, 0.0};
+  for (int i = 0; i < numberOfFrames; i++)
+  {
+    double angle = 0.5 + 0.02*i;
+    mafMatrix startMatrix;
+    startMatrix.SetElement(0,3,-12.0*cos(angle));
+    startMatrix.SetElement(1,3,12.0);
+    startMatrix.SetElement(2,3,12.0*sin(angle));
+    vmeStart->SetAbsMatrix(startMatrix);
+
+    for (int m = 0; m < 2; m++)
+    {
+      double t0 = vtkTimerLog::GetUniversalTime();
+      wrappedMeter[m]->GetOutput()->GetVTKData()->Modified();
+      wrappedMeter[m]->GetOutput()->GetVTKData()->Update();
+      wrappedMeter[m]->Modified();
+      wrappedMeter[m]->Update();
+      lengths[m].push_back(wrappedMeter[m]->GetDistance());
+      time[m] += vtkTimerLog::GetUniversalTime() - t0;
+    }
+  }
+
+  for (int i = 0; i < numberOfFrames; i++)
+  {
+    CPPUNIT_ASSERT(fabs(lengths[1][i] - lengths[0][i]) <= TOLERANCE*fabs(lengths[0][i]));
+  }
+
+  std::cout << std::endl << "full search: " << 1.0e6*time[0]/numberOfFrames << " us per wrap, "
+    << "warm start: " << 1.0e6*time[1]/numberOfFrames << " us per wrap" << std::endl;
+
+  for (int m = 0; m < 2; m++)
+  {
+    wrappedMeter[m]->SetParent(NULL);
+    mafDEL(wrappedMeter[m]);
+  }
+  vmeSphere->SetParent(NULL);
+  vmeCylinder->SetParent(NULL);
+  vmeStart->SetParent(NULL);
+  vmeEnd->SetParent(NULL);
+  mafDEL(vmeSphere);
+  mafDEL(vmeCylinder);
+  mafDEL(vmeStart);
+  mafDEL(vmeEnd);
+  mafDEL(storage);
+}
+//----------------------------------------------------------------------------
+void medVMEComputeWrappingTest::TestWrappedLocator()
+//----------------------------------------------------------------------------
+{
+  vtkSphereSource *sphere = vtkSphereSource::New();
+  sphere->SetRadius(10);
+  sphere->SetThetaResolution(32);
+  sphere->SetPhiResolution(32);
+  sphere->Update();
+
+  vtkPolyData *data = vtkPolyData::New();
+  data->DeepCopy(sphere->GetOutput());
+
+  // the centre of the sphere is at x = 5 in the frame of queries
+  mafMatrix queryToData;
+  queryToData.SetElement(0, 3, -5);
+
+  medVMEComputeWrapping::WrappedLocator *locator = new medVMEComputeWrapping::WrappedLocator();
+  locator->Update(data, queryToData);
+  CPPUNIT_ASSERT(locator->GetDataSet() == data);
+
+  double inside[3] = {5, 0, 0}, outside[3] = {-7, 0, 0};
+  CPPUNIT_ASSERT(locator->InsideOrOutside(inside) == -1);
+  CPPUNIT_ASSERT(locator->InsideOrOutside(outside) == 1);
+
+  // intersections are returned in the frame of queries
+  vtkPoints *points = vtkPoints::New();
+  vtkIdList *cellIds = vtkIdList::New();
+  double p1[3] = {-30, 0.1, 0.1}, p2[3] = {30, 0.1, 0.1};
+  CPPUNIT_ASSERT(locator->IntersectWithLine(p1, p2, points, cellIds) != 0);
+  CPPUNIT_ASSERT(points->GetNumberOfPoints() == 2);
+
+  double x1 = points->GetPoint(0)[0], x2 = points->GetPoint(1)[0];
+  if (x1 > x2) std::swap(x1, x2);
+  CPPUNIT_ASSERT(fabs(x1 + 5) < 0.2 && fabs(x2 - 15) < 0.2);
+
+  // moving the sphere only changes the transformation
+  queryToData.SetElement(0, 3, 5);
+  locator->Update(data, queryToData);
+  CPPUNIT_ASSERT(locator->IntersectWithLine(p1, p2, points, cellIds) != 0);
+  CPPUNIT_ASSERT(points->GetNumberOfPoints() == 2);
+
+  x1 = points->GetPoint(0)[0]; x2 = points->GetPoint(1)[0];
+  if (x1 > x2) std::swap(x1, x2);
+  CPPUNIT_ASSERT(fabs(x1 + 15) < 0.2 && fabs(x2 - 5) < 0.2);
+
+  // the tree of modified data is rebuilt
+  sphere->SetRadius(2);
+  sphere->Update();
+  data->DeepCopy(sphere->GetOutput());
+  data->Modified();
+
+  locator->Update(data, queryToData);
+  CPPUNIT_ASSERT(locator->InsideOrOutside(inside) == 1);
+  CPPUNIT_ASSERT(locator->IntersectWithLine(p1, p2, points, cellIds) != 0);
+  CPPUNIT_ASSERT(points->GetNumberOfPoints() == 2);
+
+  x1 = points->GetPoint(0)[0]; x2 = points->GetPoint(1)[0];
+  if (x1 > x2) std::swap(x1, x2);
+  CPPUNIT_ASSERT(fabs(x1 + 7) < 0.2 && fabs(x2 + 3) < 0.2);
+
+  delete locator;
+  vtkDEL(cellIds);
+  vtkDEL(points);
+  vtkDEL(data);
+  vtkDEL(sphere);
+}
@@ -37,6 +37,8 @@
 #include "vtkMAFSmartPointer.h"
 #include "vtkPointData.h"
 #include "vtkRectilinearGridReader.h"
+#include "vtkShortArray.h"
+#include "vtkIntArray.h"
 
 #define OUTRANGE_SCALAR -1000
 
@@ -354,3 +356,174 @@ void medVMELabeledVolumeTest::TestDeepCopy()
     CPPUNIT_ASSERT(labelValue == labelCopiedValue);
   }
 }
+
+//---------------------------------------------------------------
+mafVMEVolumeGray *medVMELabeledVolumeTest::CreateVolume(int dataType, int first, int step)
+//---------------------------------------------------------------
+{
+  vtkDataArray *scalars = vtkDataArray::CreateDataArray(dataType);
+  scalars->SetNumberOfTuples(1000);
+  for (int k = 0; k < 1000; k++)
+  {
+    scalars->SetTuple1(k, first + ((k * 7919) % 1000) * step);
+  }
+
+  vtkMAFSmartPointer<vtkStructuredPoints> sp;
+  sp->SetDimensions(10, 10, 10);
+  sp->SetSpacing(1, 1, 1);
+  sp->SetOrigin(0, 0, 0);
+  sp->SetScalarType(dataType);
+  sp->GetPointData()->SetScalars(scalars);
+  scalars->Delete();
+
+  mafVMEVolumeGray *volume;
+  mafNEW(volume);
+  volume->SetData(sp, 0);
+  volume->GetOutput()->GetVTKData()->Update();
+  volume->Update();
+  return volume;
+}
+
+//---------------------------------------------------------------
+void medVMELabeledVolumeTest::CheckLabels(medVMELabeledVolume *labeled, mafVMEVolumeGray *volume, int n, const char **labels, const bool *checked)
+//---------------------------------------------------------------
+{
+  int values[10], min[10], max[10];
+  for (int c = 0; c < n; c++)
+  {
+    char name[64];
+    sscanf(labels[c], "%s %d %d %d", name, &values[c], &min[c], &max[c]);
+  }
+
+  vtkDataArray *volumeScalars = volume->GetOutput()->GetVTKData()->GetPointData()->GetScalars();
+  vtkDataSet *datasetLabel = labeled->GetOutput()->GetVTKData();
+  datasetLabel->Update();
+  vtkDataArray *labelScalars = datasetLabel->GetPointData()->GetScalars();
+
+  CPPUNIT_ASSERT(labelScalars->GetNumberOfTuples() == volumeScalars->GetNumberOfTuples());
+  CPPUNIT_ASSERT(labelScalars->GetDataType() == volumeScalars->GetDataType());
+  for (int i = 0; i < volumeScalars->GetNumberOfTuples(); i++)
+  {
+    double volumeValue = volumeScalars->GetComponent(i, 0);
+    double expected = OUTRANGE_SCALAR;
+    for (int c = n - 1; c >= 0; c--)
+    {
+      if (checked[c] && volumeValue >= min[c] && volumeValue <= max[c])
+      {
+        expected = values[c];
+        break;
+      }
+    }
+    CPPUNIT_ASSERT(labelScalars->GetComponent(i, 0) == expected);
+  }
+}
+
+//---------------------------------------------------------------
+void medVMELabeledVolumeTest::TestLookUpTable()
+//---------------------------------------------------------------
+{
+  mafSmartPointer<mafVMERoot> root;
+
+  // values from -300 to 4695, the range is covered by the look-up table
+  mafVMEVolumeGray *volume = CreateVolume(VTK_SHORT, -300, 5);
+  volume->ReparentTo(root);
+
+  mafSmartPointer<medVMELabeledVolume> labeled; 
+  labeled->SetName("Labeled Volume");
+  labeled->SetVolumeLink(volume);
+
+  // overlapping ranges (the last label wins), a single value and an unchecked label
+  const char *labels[] = {"first 100 0 1000", "second 200 500 1500", "point 300 1800 1800", "unchecked 400 2000 3000"};
+  const bool checked[] = {true, true, true, false};
+  for (int c = 0; c < 4; c++)
+  {
+    labeled->FillLabelVector(labels[c], checked[c]);
+  }
+  labeled->GenerateLabeledVolume();
+  CheckLabels(labeled, volume, 4, labels, checked);
+
+  mafDEL(volume);
+}
+
+//---------------------------------------------------------------
+void medVMELabeledVolumeTest::TestIntervalTable()
+//---------------------------------------------------------------
+{
+  mafSmartPointer<mafVMERoot> root;
+
+  // values from -500000 to 1997500, the range is larger than the look-up table (2^20 values)
+  mafVMEVolumeGray *volume = CreateVolume(VTK_INT, -500000, 2500);
+  volume->ReparentTo(root);
+
+  double range[2];
+  volume->GetOutput()->GetVTKData()->GetPointData()->GetScalars()->GetRange(range);
+  CPPUNIT_ASSERT(range[1] - range[0] > (1 << 20));
+
+  mafSmartPointer<medVMELabeledVolume> labeled; 
+  labeled->SetName("Labeled Volume");
+  labeled->SetVolumeLink(volume);
+
+  const char *labels[] = {"first 100 0 1000000", "second 200 500000 1500000", "point 300 1000000 1000000", "unchecked 400 -500000 0"};
+  const bool checked[] = {true, true, true, false};
+  for (int c = 0; c < 4; c++)
+  {
+    labeled->FillLabelVector(labels[c], checked[c]);
+  }
+  labeled->GenerateLabeledVolume();
+  CheckLabels(labeled, volume, 4, labels, checked);
+
+  mafDEL(volume);
+}
+
+//---------------------------------------------------------------
+void medVMELabeledVolumeTest::TestLabelsCache()
+//---------------------------------------------------------------
+{
+  mafSmartPointer<mafVMERoot> root;
+
+  mafVMEVolumeGray *volume = CreateVolume(VTK_SHORT, 0, 2);
+  volume->ReparentTo(root);
+
+  mafSmartPointer<medVMELabeledVolume> labeled; 
+  labeled->SetName("Labeled Volume");
+  labeled->SetVolumeLink(volume);
+
+  const char *labels[] = {"first 100 0 500", "second 200 400 1200"};
+  bool checked[] = {true, true};
+  labeled->FillLabelVector(labels[0], checked[0]);
+  labeled->FillLabelVector(labels[1], checked[1]);
+  labeled->GenerateLabeledVolume();
+  CheckLabels(labeled, volume, 2, labels, checked);
+
+  // nothing changed: the labels are not computed again
+  vtkDataArray *labelScalars = labeled->GetOutput()->GetVTKData()->GetPointData()->GetScalars();
+  unsigned long labeledTime = labelScalars->GetMTime();
+  labeled->GenerateLabeledVolume();
+  CPPUNIT_ASSERT(labelScalars->GetMTime() == labeledTime);
+
+  // a modified label
+  labels[1] = "second 200 600 1200";
+  labeled->ModifyLabelVector(1, labels[1], checked[1]);
+  labeled->GenerateLabeledVolume();
+  CPPUNIT_ASSERT(labelScalars->GetMTime() > labeledTime);
+  CheckLabels(labeled, volume, 2, labels, checked);
+
+  // an unchecked label
+  labeledTime = labelScalars->GetMTime();
+  checked[0] = false;
+  labeled->ModifyLabelVector(0, labels[0], checked[0]);
+  labeled->GenerateLabeledVolume();
+  CPPUNIT_ASSERT(labelScalars->GetMTime() > labeledTime);
+  CheckLabels(labeled, volume, 2, labels, checked);
+
+  // modified scalars of the volume
+  labeledTime = labelScalars->GetMTime();
+  vtkDataArray *volumeScalars = volume->GetOutput()->GetVTKData()->GetPointData()->GetScalars();
+  volumeScalars->SetTuple1(0, 1000);
+  volumeScalars->Modified();
+  labeled->GenerateLabeledVolume();
+  CPPUNIT_ASSERT(labelScalars->GetMTime() > labeledTime);
+  CheckLabels(labeled, volume, 2, labels, checked);
+
+  mafDEL(volume);
+}
@@ -26,6 +26,9 @@
 #include <cppunit/TestRunner.h>
 
 
+class medVMELabeledVolume;
+class mafVMEVolumeGray;
+
 class medVMELabeledVolumeTest : public CPPUNIT_NS::TestFixture
 {
 public:
@@ -42,6 +45,9 @@ public:
   CPPUNIT_TEST( TestRemoveLabelTag );
   CPPUNIT_TEST( TestSetLabelTag );
 	CPPUNIT_TEST( TestDeepCopy );
+  CPPUNIT_TEST( TestLookUpTable );
+  CPPUNIT_TEST( TestIntervalTable );
+  CPPUNIT_TEST( TestLabelsCache );
 	CPPUNIT_TEST_SUITE_END();
 
 protected:
@@ -52,6 +58,17 @@ protected:
   void TestRemoveLabelTag();
   void TestSetLabelTag();
   void TestDeepCopy();
+  /** Labels of a short volume, mapped with the dense look-up table */
+  void TestLookUpTable();
+  /** Labels of an int volume whose range exceeds the look-up table, mapped with the interval table */
+  void TestIntervalTable();
+  /** Labels are computed again only when the checked labels or the scalars change */
+  void TestLabelsCache();
+
+  /** Build a 10x10x10 volume of the given scalar type with values first + k * step */
+  mafVMEVolumeGray *CreateVolume(int dataType, int first, int step);
+  /** Check that every scalar takes the value of the last checked label containing it */
+  void CheckLabels(medVMELabeledVolume *labeled, mafVMEVolumeGray *volume, int n, const char **labels, const bool *checked);
 };
 
 
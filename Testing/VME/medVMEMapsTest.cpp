@@ -43,6 +43,9 @@
 #include "mafVMERoot.h"
 #include "vtkRectilinearGridReader.h"
 #include "vtkDataSetReader.h"
+#include "vtkMEDDistanceFieldFilter.h"
+#include "vtkShortArray.h"
+#include "vtkFloatArray.h"
 
 #include <vnl\vnl_matrix.h>
 
@@ -153,6 +156,87 @@ void medVMEMapsTest::TestGetMaxDistance()
 
 }
 
+//---------------------------------------------------------
+void medVMEMapsTest::TestGetUseDistanceField()
+//---------------------------------------------------------
+{
+  CreateVMEMaps();
+
+  CPPUNIT_ASSERT(m_Maps->GetUseDistanceField() == 0);
+
+  m_Maps->SetUseDistanceField(1);
+  CPPUNIT_ASSERT(m_Maps->GetUseDistanceField() == 1);
+
+  double range[2];
+  m_Maps->GetScalarRange(range);
+  CPPUNIT_ASSERT(range[0] >= -m_MaxDistance && range[1] <= m_MaxDistance);
+
+  vtkMEDDistanceFieldFilter::ReleaseDistanceFields();
+
+  // a sphere of radius 10 around a ball of radius 8: both filters find the ball 2 away along the normals
+  const int dim = 41;
+  vtkMAFSmartPointer<vtkShortArray> scalars;
+  scalars->SetNumberOfTuples(dim * dim * dim);
+  for (int z = 0; z < dim; z++)
+    for (int y = 0; y < dim; y++)
+      for (int x = 0; x < dim; x++)
+      {
+        double r2 = (x - 20) * (x - 20) + (y - 20) * (y - 20) + (z - 20) * (z - 20);
+        scalars->SetValue(x + dim * (y + dim * z), r2 <= 64 ? 100 : 0);
+      }
+
+  vtkMAFSmartPointer<vtkImageData> ball;
+  ball->SetDimensions(dim, dim, dim);
+  ball->SetOrigin(-20, -20, -20);
+  ball->SetSpacing(1, 1, 1);
+  ball->SetScalarTypeToShort();
+  ball->GetPointData()->SetScalars(scalars);
+
+  mafVMEVolumeGray *volume;
+  mafNEW(volume);
+  volume->SetData(ball, 0.0);
+  volume->ReparentTo(m_Root);
+  volume->Update();
+
+  mafVMESurface *surface;
+  mafNEW(surface);
+  surface->SetData(polydata, 0.0);
+  surface->ReparentTo(m_Root);
+
+  medVMEMaps *maps;
+  mafNEW(maps);
+  maps->SetSourceVMELink(volume);
+  maps->SetMappedVMELink(surface);
+  maps->SetDensityDistance(0);
+  maps->SetFirstThreshold(50);
+  maps->SetMaxDistance(5);
+  maps->Update();
+
+  vtkMAFSmartPointer<vtkFloatArray> distances[2];
+  for (int useDistanceField = 0; useDistanceField < 2; useDistanceField++)
+  {
+    maps->SetUseDistanceField(useDistanceField);
+    vtkDataSet *output = maps->GetOutput()->GetVTKData();
+    output->Update();
+    CPPUNIT_ASSERT(output->GetPointData()->GetScalars() != NULL);
+    distances[useDistanceField]->DeepCopy(output->GetPointData()->GetScalars());
+  }
+
+  // the field puts the iso-surface half voxel away from the voxels, the normals are sampled between them
+  CPPUNIT_ASSERT(distances[0]->GetNumberOfTuples() == polydata->GetNumberOfPoints());
+  CPPUNIT_ASSERT(distances[1]->GetNumberOfTuples() == polydata->GetNumberOfPoints());
+  for (int i = 0; i < polydata->GetNumberOfPoints(); i++)
+  {
+    CPPUNIT_ASSERT(fabs(distances[0]->GetValue(i) - distances[1]->GetValue(i)) < 1.0);
+  }
+
+  mafDEL(maps);
+  volume->ReparentTo(NULL);
+  surface->ReparentTo(NULL);
+  mafDEL(volume);
+  mafDEL(surface);
+}
+
 //---------------------------------------------------------
 void medVMEMapsTest::TestGetFirstThreshold()
 //---------------------------------------------------------
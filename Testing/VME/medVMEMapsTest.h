@@ -54,6 +54,7 @@ public:
   CPPUNIT_TEST( TestGetFirstThreshold );
   CPPUNIT_TEST( TestGetSecondThreshold );
   CPPUNIT_TEST( TestGetMaxDistance );
+  CPPUNIT_TEST( TestGetUseDistanceField );
   CPPUNIT_TEST( TestGetVisualPipe );
   CPPUNIT_TEST( TestGetVolume );
   CPPUNIT_TEST( TestGetSurfaceOutput );
@@ -67,6 +68,7 @@ protected:
   void TestGetFirstThreshold();
   void TestGetSecondThreshold();
   void TestGetMaxDistance();
+  void TestGetUseDistanceField();
   void TestGetMappedVMELink();
   void TestGetSourceVMELink();
   void TestGetVisualPipe();
@@ -26,6 +26,7 @@
 #include "medVMESegmentationVolumeTest.h"
 #include "medVMESegmentationVolume.h"
 #include "medAttributeSegmentationVolume.h"
+#include "medSegmentationSparseMask.h"
 #include "mafVMEStorage.h"
 #include "mafVMERoot.h"
 #include "mafVMEVolumeGray.h"
@@ -36,6 +37,8 @@
 #include "vtkRectilinearGrid.h"
 #include "vtkPointData.h"
 
+#include <vector>
+
 #define TEST_RESULT CPPUNIT_ASSERT(m_Result)
 
 //----------------------------------------------------------------------------
@@ -281,6 +284,78 @@ void medVMESegmentationVolumeTest::TestAutomaticSegmentation()
   //////////////////////////////////////////////////////////////////////////
 }
 //---------------------------------------------------------
+void medVMESegmentationVolumeTest::TestIncrementalAutomaticSegmentation()
+//---------------------------------------------------------
+{
+  mafSmartPointer<medVMESegmentationVolume> vme;
+  vme->ReparentTo(m_Storage->GetRoot());
+  vme->SetVolumeLink(m_Volume);
+  vme->SetAutomaticSegmentationThresholdModality(medVMESegmentationVolume::RANGE);
+  vme->AddRange(0,4,10.0);
+  vme->AddRange(5,9,5.0);
+  vme->GetOutput()->Update();
+  vme->Update();
+
+  // only the slices of the second range are computed again
+  CPPUNIT_ASSERT( vme->UpdateRange(1,5,9,7.0) == MAF_OK );
+  vme->GetOutput()->Update();
+  vme->Update();
+
+  mafSmartPointer<medVMESegmentationVolume> full;
+  full->ReparentTo(m_Storage->GetRoot());
+  full->SetVolumeLink(m_Volume);
+  full->SetAutomaticSegmentationThresholdModality(medVMESegmentationVolume::RANGE);
+  full->AddRange(0,4,10.0);
+  full->AddRange(5,9,7.0);
+  full->GetOutput()->Update();
+  full->Update();
+
+  vtkDataArray *incrementalScalars = vme->GetAutomaticOutput()->GetPointData()->GetScalars();
+  vtkDataArray *fullScalars = full->GetAutomaticOutput()->GetPointData()->GetScalars();
+  CPPUNIT_ASSERT( incrementalScalars->GetNumberOfTuples() == fullScalars->GetNumberOfTuples() );
+  for (int i=0;i<fullScalars->GetNumberOfTuples();i++)
+  {
+    CPPUNIT_ASSERT( incrementalScalars->GetTuple1(i) == fullScalars->GetTuple1(i) );
+  }
+}
+//---------------------------------------------------------
+void medVMESegmentationVolumeTest::TestThresholdOnlyDirtySlices()
+//---------------------------------------------------------
+{
+  int dims[3];
+  vtkStructuredPoints::SafeDownCast(m_Volume->GetOutput()->GetVTKData())->GetDimensions(dims);
+
+  mafSmartPointer<medVMESegmentationVolume> vme;
+  vme->ReparentTo(m_Storage->GetRoot());
+  vme->SetVolumeLink(m_Volume);
+  vme->SetAutomaticSegmentationThresholdModality(medVMESegmentationVolume::RANGE);
+  vme->AddRange(0,4,10.0);
+  vme->AddRange(5,dims[2]-1,5.0);
+  vme->GetOutput()->Update();
+  vme->Update();
+
+  // the first computation thresholds every slice
+  CPPUNIT_ASSERT( vme->GetNumberOfThresholdedSlices() == dims[2] );
+
+  // a threshold change thresholds only the slices of the changed range
+  CPPUNIT_ASSERT( vme->UpdateRange(1,5,dims[2]-1,7.0) == MAF_OK );
+  vme->GetOutput()->Update();
+  vme->Update();
+  CPPUNIT_ASSERT( vme->GetNumberOfThresholdedSlices() == dims[2]-5 );
+
+  // a range updated with its own values doesn't threshold any slice
+  CPPUNIT_ASSERT( vme->UpdateRange(0,0,4,10.0) == MAF_OK );
+  vme->GetOutput()->Update();
+  vme->Update();
+  CPPUNIT_ASSERT( vme->GetNumberOfThresholdedSlices() == 0 );
+
+  // moving a range border thresholds only the slices that change range
+  CPPUNIT_ASSERT( vme->UpdateRange(0,0,2,10.0) == MAF_OK );
+  vme->GetOutput()->Update();
+  vme->Update();
+  CPPUNIT_ASSERT( vme->GetNumberOfThresholdedSlices() == 2 );
+}
+//---------------------------------------------------------
 void medVMESegmentationVolumeTest::TestManualSegmentation()
 //---------------------------------------------------------
 {
@@ -355,6 +430,63 @@ void medVMESegmentationVolumeTest::TestRefinementSegmentation()
   //////////////////////////////////////////////////////////////////////////
 }
 //---------------------------------------------------------
+void medVMESegmentationVolumeTest::TestRefinementInputMask()
+//---------------------------------------------------------
+{
+  // the refinement mask edited as sparse tiles gives the same result of its dense volume
+  vtkStructuredPoints *maskData = vtkStructuredPoints::SafeDownCast(m_VolumeRefinementMask->GetOutput()->GetVTKData());
+  maskData->Update();
+  int dims[3];
+  maskData->GetDimensions(dims);
+  vtkDataArray *maskScalars = maskData->GetPointData()->GetScalars();
+  std::vector<unsigned char> values(maskScalars->GetNumberOfTuples());
+  for (int i=0;i<maskScalars->GetNumberOfTuples();i++)
+  {
+    values[i] = maskScalars->GetTuple1(i) != 0 ? 255 : 0;
+  }
+  medSegmentationSparseMask refinementMask;
+  refinementMask.SetDimensions(dims);
+  refinementMask.SetArray(&values[0]);
+
+  mafSmartPointer<medVMESegmentationVolume> dense;
+  dense->ReparentTo(m_Storage->GetRoot());
+  dense->SetVolumeLink(m_Volume);
+  dense->SetAutomaticSegmentationThresholdModality(medVMESegmentationVolume::GLOBAL);
+  dense->SetAutomaticSegmentationGlobalThreshold(5.0);
+  dense->SetManualVolumeMask(m_VolumeManualMask);
+  dense->SetRefinementVolumeMask(m_VolumeRefinementMask);
+  dense->GetOutput()->Update();
+  dense->Update();
+
+  mafSmartPointer<medVMESegmentationVolume> sparse;
+  sparse->ReparentTo(m_Storage->GetRoot());
+  sparse->SetVolumeLink(m_Volume);
+  sparse->SetAutomaticSegmentationThresholdModality(medVMESegmentationVolume::GLOBAL);
+  sparse->SetAutomaticSegmentationGlobalThreshold(5.0);
+  sparse->SetManualVolumeMask(m_VolumeManualMask);
+  sparse->SetRefinementInputMask(&refinementMask);
+  sparse->GetOutput()->Update();
+  sparse->Update();
+
+  vtkDataArray *denseScalars = dense->GetRefinementOutput()->GetPointData()->GetScalars();
+  vtkDataArray *sparseScalars = sparse->GetRefinementOutput()->GetPointData()->GetScalars();
+  CPPUNIT_ASSERT( denseScalars->GetNumberOfTuples() == sparseScalars->GetNumberOfTuples() );
+  for (int i=0;i<denseScalars->GetNumberOfTuples();i++)
+  {
+    CPPUNIT_ASSERT( denseScalars->GetTuple1(i) == sparseScalars->GetTuple1(i) );
+  }
+
+  // an edit of the tiles followed by a new set updates the output
+  refinementMask.SetValue(0,0,0,refinementMask.GetValue(0,0,0) ? 0 : 255);
+  sparse->SetRefinementInputMask(&refinementMask);
+  sparse->GetOutput()->Update();
+  sparse->Update();
+  CPPUNIT_ASSERT( sparse->GetRefinementOutput()->GetPointData()->GetScalars()->GetTuple1(0) != denseScalars->GetTuple1(0) );
+
+  // the mask is not owned
+  sparse->SetRefinementInputMask(NULL);
+}
+//---------------------------------------------------------
 void medVMESegmentationVolumeTest::TestSetManualVolumeMask()
 //---------------------------------------------------------
 {
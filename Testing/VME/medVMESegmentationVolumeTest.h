@@ -47,7 +47,10 @@ public:
   CPPUNIT_TEST( TestSetAutomaticSegmentationGlobalThreshold );
   CPPUNIT_TEST( TestSetVolumeLink );
   CPPUNIT_TEST( TestAutomaticSegmentation );
+  CPPUNIT_TEST( TestIncrementalAutomaticSegmentation );
+  CPPUNIT_TEST( TestThresholdOnlyDirtySlices );
   CPPUNIT_TEST( TestRefinementSegmentation );
+  CPPUNIT_TEST( TestRefinementInputMask );
   CPPUNIT_TEST( TestManualSegmentation );
   CPPUNIT_TEST( TestSetManualVolumeMask );
   CPPUNIT_TEST( TestSetRefinementVolumeMask );
@@ -66,7 +69,12 @@ protected:
   void TestSetAutomaticSegmentationGlobalThreshold();
   void TestSetVolumeLink();
   void TestAutomaticSegmentation();
+  /** Change the threshold of one range and compare the automatic output with a full recompute */
+  void TestIncrementalAutomaticSegmentation();
+  /** Change the thresholds of a kept segmentation volume and check that only the changed slices are thresholded */
+  void TestThresholdOnlyDirtySlices();
   void TestRefinementSegmentation();
+  void TestRefinementInputMask();
   void TestManualSegmentation();
   void TestSetManualVolumeMask();
   void TestSetRefinementVolumeMask();
@@ -0,0 +1,343 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: vtkMAFVolumeSlicer_BESTest
+
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+
+#include "mafDefines.h"
+#include "medDefines.h"
+//----------------------------------------------------------------------------
+// NOTE: Every CPP file in the MAF must include "mafDefines.h" as first.
+// This force to include Window,wxWidgets and VTK exactly in this order.
+// Failing in doing this will result in a run-time error saying:
+// "Failure#0: The value of ESP was not properly saved across a function call"
+//----------------------------------------------------------------------------
+
+#include <cppunit/config/SourcePrefix.h>
+
+#include "vtkMAFVolumeSlicer_BESTest.h"
+#include "vtkMAFVolumeSlicer_BES.h"
+
+#include "vtkImageData.h"
+#include "vtkPointData.h"
+#include "vtkDataArray.h"
+#include "vtkTimerLog.h"
+
+#include <iostream>
+#include <math.h>
+#include <string.h>
+
+#define NUMBER_OF_PLANES        6
+#define BENCHMARK_RESOLUTION    512
+#define BENCHMARK_REPETITIONS   10
+
+//---------------------------------------------------------
+vtkImageData* vtkMAFVolumeSlicer_BESTest::CreateVolume(int nScalarType, const int dims[3], double dblMin, double dblMax)
+//---------------------------------------------------------
+{
+  vtkImageData* volume = vtkImageData::New();
+  volume->SetDimensions(dims[0], dims[1], dims[2]);
+  volume->SetSpacing(0.7, 0.9, 1.5);
+  volume->SetOrigin(-10.0, 5.0, 3.0);
+  volume->SetScalarType(nScalarType);
+  volume->SetNumberOfScalarComponents(1);
+  volume->AllocateScalars();
+
+  //smoothly changing values with some noise
+  vtkDataArray* scalars = volume->GetPointData()->GetScalars();
+  unsigned int nRand = 12345;
+  for (int z = 0, i = 0; z < dims[2]; z++)
+  {
+    for (int y = 0; y < dims[1]; y++)
+    {
+      for (int x = 0; x < dims[0]; x++, i++)
+      {
+        nRand = nRand*1103515245 + 12345;
+        double dblNoise = 0.8 + 0.2*((nRand >> 16) & 0xFF) / 255.0;
+        double dblVal = (0.5 + 0.5*sin(x*0.1)*cos(y*0.13 + z*0.07))*dblNoise;
+        scalars->SetTuple1(i, dblMin + (dblMax - dblMin)*dblVal);
+      }
+    }
+  }
+
+  return volume;
+}
+
+//---------------------------------------------------------
+vtkImageData* vtkMAFVolumeSlicer_BESTest::Slice(vtkImageData* volume, int nPlane, int nRes, bool bSIMD, int nThreads)
+//---------------------------------------------------------
+{
+  //orthonormal axes of an oblique plane going through the centre of the volume
+  double a = 0.3 + nPlane*0.41, b = 0.2 + nPlane*0.27;
+  float xAxis[3] = { (float)cos(a), (float)(sin(a)*cos(b)), (float)(sin(a)*sin(b)) };
+  float yAxis[3] = { (float)-sin(a), (float)(cos(a)*cos(b)), (float)(cos(a)*sin(b)) };
+
+  double center[3];
+  volume->GetCenter(center);
+
+  vtkMAFVolumeSlicer_BES* slicer = vtkMAFVolumeSlicer_BES::New();
+  slicer->SetInput(volume);
+  slicer->SetPlaneOrigin(center);
+  slicer->SetPlaneAxisX(xAxis);
+  slicer->SetPlaneAxisY(yAxis);
+  slicer->SetGPUEnabled(0);
+  slicer->SetSIMDEnabled(bSIMD ? 1 : 0);
+  if (nThreads > 0)
+    slicer->SetNumberOfThreads(nThreads);
+
+  vtkImageData* image = vtkImageData::New();
+  image->SetScalarType(volume->GetScalarType());
+  image->SetNumberOfScalarComponents(1);
+  image->SetExtent(0, nRes - 1, 0, nRes - 1, 0, 0);
+  image->SetSpacing(1.0, 1.0, 1.0);
+
+  slicer->SetOutput(image);
+  slicer->Update();
+
+  vtkImageData* result = vtkImageData::New();
+  result->DeepCopy(image);
+
+  vtkDEL(image);
+  vtkDEL(slicer);
+  return result;
+}
+
+//---------------------------------------------------------
+void vtkMAFVolumeSlicer_BESTest::CompareSIMDWithScalar(int nScalarType, double dblMin, double dblMax, double dblTolerance)
+//---------------------------------------------------------
+{
+  //odd dimensions and resolution, so that scalar code processes the ends of scanlines
+  const int dims[3] = { 67, 53, 41 };
+  vtkImageData* volume = CreateVolume(nScalarType, dims, dblMin, dblMax);
+
+  for (int nPlane = 0; nPlane < NUMBER_OF_PLANES; nPlane++)
+  {
+    vtkImageData* scalar = Slice(volume, nPlane, 203, false);
+    vtkImageData* simd = Slice(volume, nPlane, 203, true);
+
+    vtkDataArray* scalarPixels = scalar->GetPointData()->GetScalars();
+    vtkDataArray* simdPixels = simd->GetPointData()->GetScalars();
+    CPPUNIT_ASSERT(scalarPixels->GetNumberOfTuples() == simdPixels->GetNumberOfTuples());
+
+    int nNonZero = 0;
+    for (int i = 0; i < scalarPixels->GetNumberOfTuples(); i++)
+    {
+      double dblScalar = scalarPixels->GetTuple1(i);
+      CPPUNIT_ASSERT(fabs(simdPixels->GetTuple1(i) - dblScalar) <= dblTolerance);
+
+      if (dblScalar != 0.0)
+        nNonZero++;
+    }
+
+    //the plane goes through the centre, so a good part of the image must be covered
+    CPPUNIT_ASSERT(nNonZero > scalarPixels->GetNumberOfTuples() / 10);
+
+    vtkDEL(scalar);
+    vtkDEL(simd);
+  }
+
+  vtkDEL(volume);
+}
+
+//---------------------------------------------------------
+void vtkMAFVolumeSlicer_BESTest::TestSIMDUnsignedChar()
+//---------------------------------------------------------
+{
+  //single precision may differ by one after truncation
+  CompareSIMDWithScalar(VTK_UNSIGNED_CHAR, 0.0, 255.0, 1.0);
+}
+
+//---------------------------------------------------------
+void vtkMAFVolumeSlicer_BESTest::TestSIMDShort()
+//---------------------------------------------------------
+{
+  CompareSIMDWithScalar(VTK_SHORT, -1024.0, 3071.0, 1.0);
+}
+
+//---------------------------------------------------------
+void vtkMAFVolumeSlicer_BESTest::TestSIMDUnsignedShort()
+//---------------------------------------------------------
+{
+  CompareSIMDWithScalar(VTK_UNSIGNED_SHORT, 0.0, 65535.0, 1.0);
+}
+
+//---------------------------------------------------------
+void vtkMAFVolumeSlicer_BESTest::TestSIMDFloat()
+//---------------------------------------------------------
+{
+  CompareSIMDWithScalar(VTK_FLOAT, -1024.0, 3071.0, 1.e-2);
+}
+
+//---------------------------------------------------------
+void vtkMAFVolumeSlicer_BESTest::TestSIMDBenchmark()
+//---------------------------------------------------------
+{
+  const int dims[3] = { 256, 256, 200 };
+  vtkImageData* volume = CreateVolume(VTK_SHORT, dims, -1024.0, 3071.0);
+
+  double dblTime[2];
+  for (int nSIMD = 0; nSIMD < 2; nSIMD++)
+  {
+    double dblStart = vtkTimerLog::GetUniversalTime();
+    for (int i = 0; i < BENCHMARK_REPETITIONS; i++)
+    {
+      vtkImageData* image = Slice(volume, i % NUMBER_OF_PLANES, BENCHMARK_RESOLUTION, nSIMD != 0);
+      vtkDEL(image);
+    }
+
+    dblTime[nSIMD] = (vtkTimerLog::GetUniversalTime() - dblStart) / BENCHMARK_REPETITIONS;
+  }
+
+  const char* szSets[] = { "none", "SSE2", "AVX2" };
+  std::cout << std::endl << "oblique slice " << BENCHMARK_RESOLUTION << "x" << BENCHMARK_RESOLUTION <<
+    " of short volume: scalar " << dblTime[0]*1000.0 << " ms, vectorised (" << 
+    szSets[vtkMAFVolumeSlicer_BES::GetSIMDInstructionSet()] << ") " << dblTime[1]*1000.0 << " ms" << std::endl;
+
+  vtkDEL(volume);
+}
+
+//---------------------------------------------------------
+void vtkMAFVolumeSlicer_BESTest::TestThreads()
+//---------------------------------------------------------
+{
+  const int dims[3] = { 67, 53, 41 };
+  vtkImageData* volume = CreateVolume(VTK_SHORT, dims, -1024.0, 3071.0);
+
+  //slabs of rows computed by threads must give exactly the same image
+  for (int nSIMD = 0; nSIMD < 2; nSIMD++)
+  {
+    for (int nPlane = 0; nPlane < NUMBER_OF_PLANES; nPlane++)
+    {
+      vtkImageData* serial = Slice(volume, nPlane, 203, nSIMD != 0, 1);
+      vtkImageData* parallel = Slice(volume, nPlane, 203, nSIMD != 0, 4);
+
+      vtkDataArray* serialPixels = serial->GetPointData()->GetScalars();
+      vtkDataArray* parallelPixels = parallel->GetPointData()->GetScalars();
+      CPPUNIT_ASSERT(serialPixels->GetNumberOfTuples() == parallelPixels->GetNumberOfTuples());
+      CPPUNIT_ASSERT(memcmp(serialPixels->GetVoidPointer(0), parallelPixels->GetVoidPointer(0),
+        serialPixels->GetNumberOfTuples()*serialPixels->GetDataTypeSize()) == 0);
+
+      vtkDEL(serial);
+      vtkDEL(parallel);
+    }
+  }
+
+  vtkDEL(volume);
+}
+
+//---------------------------------------------------------
+vtkMAFVolumeSlicer_BES* vtkMAFVolumeSlicer_BESTest::CreateSlicer(vtkImageData* volume, float xAxis[3], float yAxis[3], int nRes)
+//---------------------------------------------------------
+{
+  vtkMAFVolumeSlicer_BES* slicer = vtkMAFVolumeSlicer_BES::New();
+  slicer->SetInput(volume);
+  slicer->SetPlaneAxisX(xAxis);
+  slicer->SetPlaneAxisY(yAxis);
+  slicer->SetGPUEnabled(0);
+
+  vtkImageData* image = vtkImageData::New();
+  image->SetScalarType(volume->GetScalarType());
+  image->SetNumberOfScalarComponents(1);
+  image->SetExtent(0, nRes - 1, 0, nRes - 1, 0, 0);
+  image->SetSpacing(1.0, 1.0, 1.0);
+
+  slicer->SetOutput(image);
+  vtkDEL(image);
+  return slicer;
+}
+
+//---------------------------------------------------------
+void vtkMAFVolumeSlicer_BESTest::TestIncrementalUpdate()
+//---------------------------------------------------------
+{
+  const int dims[3] = { 67, 53, 41 };
+  vtkImageData* volume = CreateVolume(VTK_SHORT, dims, -1024.0, 3071.0);
+
+  double center[3];
+  volume->GetCenter(center);
+
+  //axial, coronal and sagittal planes moved along their normal by sub-voxel 
+  //steps (spacing is 0.7, 0.9 and 1.5), so that layers are both reused and recomputed
+  float axes[3][2][3] = {
+    { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } },
+    { { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } },
+    { { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } },
+  };
+
+  for (int nPlane = 0; nPlane < 3; nPlane++)
+  {
+    vtkMAFVolumeSlicer_BES* incremental = CreateSlicer(volume, axes[nPlane][0], axes[nPlane][1], 203);
+    vtkMAFVolumeSlicer_BES* whole = CreateSlicer(volume, axes[nPlane][0], axes[nPlane][1], 203);
+    CPPUNIT_ASSERT(whole->GetIncrementalUpdateEnabled() == 0);  //opt-in
+    incremental->SetIncrementalUpdateEnabled(1);
+    whole->SetSIMDEnabled(0);
+
+    const int nNormal = 2 - nPlane;
+    for (int nStep = -8; nStep <= 8; nStep++)
+    {
+      double origin[3] = { center[0], center[1], center[2] };
+      origin[nNormal] += nStep*0.35;
+
+      incremental->SetPlaneOrigin(origin);
+      incremental->Update();
+      whole->SetPlaneOrigin(origin);
+      whole->Update();
+
+      vtkDataArray* incrementalPixels = incremental->GetOutput()->GetPointData()->GetScalars();
+      vtkDataArray* wholePixels = whole->GetOutput()->GetPointData()->GetScalars();
+      CPPUNIT_ASSERT(incrementalPixels->GetNumberOfTuples() == wholePixels->GetNumberOfTuples());
+
+      int nNonZero = 0;
+      for (int i = 0; i < wholePixels->GetNumberOfTuples(); i++)
+      {
+        double dblWhole = wholePixels->GetTuple1(i);
+        CPPUNIT_ASSERT(fabs(incrementalPixels->GetTuple1(i) - dblWhole) <= 1.0);
+
+        if (dblWhole != 0.0)
+          nNonZero++;
+      }
+
+      CPPUNIT_ASSERT(nNonZero > wholePixels->GetNumberOfTuples() / 10);
+    }
+
+    vtkDEL(incremental);
+    vtkDEL(whole);
+  }
+
+  vtkDEL(volume);
+}
+
+//---------------------------------------------------------
+void vtkMAFVolumeSlicer_BESTest::TestWindowLevel()
+//---------------------------------------------------------
+{
+  const int dims[3] = { 67, 53, 41 };
+  vtkImageData* volume = CreateVolume(VTK_SHORT, dims, -1024.0, 3071.0);
+
+  float xAxis[3] = { 1.0f, 0.0f, 0.0f };
+  float yAxis[3] = { 0.0f, 1.0f, 0.0f };
+  vtkMAFVolumeSlicer_BES* slicer = CreateSlicer(volume, xAxis, yAxis, 203);
+  slicer->SetPlaneOrigin(volume->GetCenter());
+  slicer->Update();
+
+  //window/level is applied by the lookup table of the texture, 
+  //it must not cause the slice to be recomputed
+  unsigned long nTime = slicer->GetMTime();
+  slicer->SetWindow(1000.0);
+  slicer->SetLevel(200.0);
+  CPPUNIT_ASSERT(slicer->GetMTime() == nTime);
+  CPPUNIT_ASSERT(slicer->GetWindow() == 1000.0 && slicer->GetLevel() == 200.0);
+
+  vtkDEL(slicer);
+  vtkDEL(volume);
+}
@@ -0,0 +1,98 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: vtkMAFVolumeSlicer_BESTest
+ 
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __CPP_UNIT_vtkMAFVolumeSlicer_BESTest_H__
+#define __CPP_UNIT_vtkMAFVolumeSlicer_BESTest_H__
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/BriefTestProgressListener.h>
+#include <cppunit/CompilerOutputter.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/TestResult.h>
+#include <cppunit/TestResultCollector.h>
+#include <cppunit/TestRunner.h>
+
+class vtkImageData;
+class vtkMAFVolumeSlicer_BES;
+
+class vtkMAFVolumeSlicer_BESTest : public CPPUNIT_NS::TestFixture
+{
+public: 
+  CPPUNIT_TEST_SUITE( vtkMAFVolumeSlicer_BESTest );
+  CPPUNIT_TEST( TestSIMDUnsignedChar );
+  CPPUNIT_TEST( TestSIMDShort );
+  CPPUNIT_TEST( TestSIMDUnsignedShort );
+  CPPUNIT_TEST( TestSIMDFloat );
+  CPPUNIT_TEST( TestSIMDBenchmark );
+  CPPUNIT_TEST( TestThreads );
+  CPPUNIT_TEST( TestIncrementalUpdate );
+  CPPUNIT_TEST( TestWindowLevel );
+  CPPUNIT_TEST_SUITE_END();
+
+protected:
+  void TestSIMDUnsignedChar();
+  void TestSIMDShort();
+  void TestSIMDUnsignedShort();
+  void TestSIMDFloat();
+  void TestSIMDBenchmark();
+  void TestThreads();
+  void TestIncrementalUpdate();
+  void TestWindowLevel();
+
+  /** creates a volume of the given scalar type and dimensions with CT-like data
+  values are from dblMin to dblMax, the caller is responsible for deleting it */
+  vtkImageData* CreateVolume(int nScalarType, const int dims[3], double dblMin, double dblMax);
+
+  /** slices the volume by the oblique plane denoted by nPlane producing 
+  the image of nRes x nRes pixels using at most nThreads threads (0 = default),
+  the caller is responsible for deleting it */
+  vtkImageData* Slice(vtkImageData* volume, int nPlane, int nRes, bool bSIMD, int nThreads = 0);
+
+  /** compares slices of the volume of the given type produced by 
+  the scalar and the vectorised code */
+  void CompareSIMDWithScalar(int nScalarType, double dblMin, double dblMax, double dblTolerance);
+
+  /** creates the slicer of the volume producing the image of nRes x nRes pixels 
+  for the plane with the given axes, the caller is responsible for deleting it */
+  vtkMAFVolumeSlicer_BES* CreateSlicer(vtkImageData* volume, float xAxis[3], float yAxis[3], int nRes);
+};
+
+int
+main( int argc, char* argv[] )
+{
+  // Create the event manager and test controller
+  CPPUNIT_NS::TestResult controller;
+
+  // Add a listener that colllects test result
+  CPPUNIT_NS::TestResultCollector result;
+  controller.addListener( &result );        
+
+  // Add a listener that print dots as test run.
+  CPPUNIT_NS::BriefTestProgressListener progress;
+  controller.addListener( &progress );      
+
+  // Add the top suite to the test runner
+  CPPUNIT_NS::TestRunner runner;
+  runner.addTest( vtkMAFVolumeSlicer_BESTest::suite());
+  runner.run( controller );
+
+  // Print test in a compiler compatible format.
+  CPPUNIT_NS::CompilerOutputter outputter( &result, CPPUNIT_NS::stdCOut() );
+  outputter.write(); 
+
+  return result.wasSuccessful() ? 0 : 1;
+}
+
+#endif
@@ -26,6 +26,7 @@
 
 #include "mafVME.h"
 #include "medVMESegmentationVolume.h"
+#include "medSegmentationSparseMask.h"
 
 #include "vtkMAFSmartPointer.h"
 #include "vtkMath.h"
@@ -38,12 +39,16 @@
 #include "vtkRectilinearGrid.h"
 #include "vtkStructuredPoints.h"
 #include "vtkUnsignedCharArray.h"
+#include "vtkMultiThreader.h"
 
 #include "itkImageToVTKImageFilter.h"
 #include "itkVTKImageToImageFilter.h"
 #include "itkBinaryThresholdImageFilter.h"
 #include "itkConnectedThresholdImageFilter.h"
 
+#include <limits>
+#include <string.h>
+
 #define round(x) (x<0?ceil((x)-0.5):floor((x)+0.5))
 
 typedef  itk::Image< double, 3> RealImage;
@@ -60,6 +65,7 @@ medDataPipeCustomSegmentationVolume::medDataPipeCustomSegmentationVolume()
   m_Volume = NULL;
   m_ManualVolumeMask = NULL;
   m_RefinementVolumeMask = NULL;
+  m_RefinementInputMask = NULL;
   m_RG = NULL;
   vtkNEW(m_RG);
   m_SP = NULL;
@@ -86,6 +92,21 @@ medDataPipeCustomSegmentationVolume::medDataPipeCustomSegmentationVolume()
   m_ChangedRefinementData = false;
   m_ChangedRegionGrowingData = false;
 
+  m_AutomaticMask = new medSegmentationSparseMask();
+  m_ManualMask = new medSegmentationSparseMask();
+  m_RefinementMask = new medSegmentationSparseMask();
+  m_RegionGrowingMask = new medSegmentationSparseMask();
+  m_OutputMask = NULL;
+
+  m_AutomaticOutputOutdated = false;
+  m_ManualOutputOutdated = false;
+  m_RefinementOutputOutdated = false;
+  m_RegionGrowingOutputOutdated = false;
+
+  m_ThresholdedScalars = NULL;
+  m_ThresholdedScalarsMTime = 0;
+  m_NumberOfThresholdedSlices = 0;
+
   SetInput(NULL);
 }
 
@@ -103,6 +124,10 @@ medDataPipeCustomSegmentationVolume::~medDataPipeCustomSegmentationVolume()
   vtkDEL(m_RefinementSP);
   vtkDEL(m_RegionGrowingRG);
   vtkDEL(m_RegionGrowingSP);
+  cppDEL(m_AutomaticMask);
+  cppDEL(m_ManualMask);
+  cppDEL(m_RefinementMask);
+  cppDEL(m_RegionGrowingMask);
   //////////////////////////////////////////////////////////////////////////
   for (int i=0;i<m_AutomaticSegmentationRanges.size();i++)
   {
@@ -176,6 +201,112 @@ void medDataPipeCustomSegmentationVolume::SetDoubleThresholdModality(int modalit
   Modified();
 }
 
+//------------------------------------------------------------------------------
+bool medDataPipeCustomSegmentationVolume::GetVolumeDimensions(vtkDataSet *volumeData, int dims[3])
+//------------------------------------------------------------------------------
+{
+  if (vtkRectilinearGrid::SafeDownCast(volumeData))
+  {
+    vtkRectilinearGrid::SafeDownCast(volumeData)->GetDimensions(dims);
+    return true;
+  }
+  else if (vtkStructuredPoints::SafeDownCast(volumeData))
+  {
+    vtkStructuredPoints::SafeDownCast(volumeData)->GetDimensions(dims);
+    return true;
+  }
+  return false;
+}
+//------------------------------------------------------------------------------
+bool medDataPipeCustomSegmentationVolume::DataSetToMask(vtkDataSet *data, medSegmentationSparseMask *mask)
+//------------------------------------------------------------------------------
+{
+  vtkDataArray *scalars = data->GetPointData()->GetScalars();
+  if (scalars == NULL || scalars->GetNumberOfTuples() != mask->GetNumberOfPoints())
+  {
+    return false;
+  }
+
+  vtkUnsignedCharArray *ucScalars = vtkUnsignedCharArray::SafeDownCast(scalars);
+  if (ucScalars && ucScalars->GetNumberOfComponents() == 1)
+  {
+    mask->SetArray(ucScalars->GetPointer(0));
+    return true;
+  }
+
+  int dims[3];
+  mask->GetDimensions(dims);
+  int sliceSize = dims[0]*dims[1];
+  std::vector<unsigned char> slice(sliceSize);
+  for (int k=0;k<dims[2];k++)
+  {
+    for (int p=0;p<sliceSize;p++)
+    {
+      slice[p] = scalars->GetTuple1(p + k*sliceSize) != 0 ? 255 : 0;
+    }
+    mask->SetSlice(k,&slice[0]);
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+void medDataPipeCustomSegmentationVolume::MaskToDataSet(medSegmentationSparseMask *mask, vtkDataSet *volumeData, vtkDataSet *output)
+//------------------------------------------------------------------------------
+{
+  vtkMAFSmartPointer<vtkUnsignedCharArray> newScalars;
+  newScalars->SetName("SCALARS");
+  newScalars->SetNumberOfTuples(mask->GetNumberOfPoints());
+  mask->GetArray(newScalars->GetPointer(0));
+
+  if (vtkStructuredPoints::SafeDownCast(output))
+  {
+    vtkStructuredPoints *sp = vtkStructuredPoints::SafeDownCast(output);
+    sp->CopyStructure(vtkStructuredPoints::SafeDownCast(volumeData));
+    sp->GetPointData()->SetScalars(newScalars);
+    sp->SetScalarTypeToUnsignedChar();
+    sp->Update();
+  }
+  else if (vtkRectilinearGrid::SafeDownCast(output))
+  {
+    vtkRectilinearGrid *rg = vtkRectilinearGrid::SafeDownCast(output);
+    rg->CopyStructure(vtkRectilinearGrid::SafeDownCast(volumeData));
+    rg->GetPointData()->SetScalars(newScalars);
+    rg->Update();
+  }
+}
+//------------------------------------------------------------------------------
+vtkDataSet *medDataPipeCustomSegmentationVolume::GetStageOutput(medSegmentationSparseMask *mask, vtkStructuredPoints *sp, vtkRectilinearGrid *rg, bool &outdated)
+//------------------------------------------------------------------------------
+{
+  mafVME *vol = mafVME::SafeDownCast(m_Volume);
+  if(vol)
+  {
+    vol->GetOutput()->Update();
+    vtkDataSet *volumeData = vol->GetOutput()->GetVTKData();
+    if(volumeData)
+    {
+      volumeData->Update();
+      vtkDataSet *output = NULL;
+      if(volumeData->IsA("vtkRectilinearGrid"))
+      {
+        output = rg;
+      }
+      else if (volumeData->IsA("vtkImageData"))
+      {
+        output = sp;
+      }
+
+      // the dense dataset is written only when it is requested
+      if (output && outdated && mask->GetNumberOfPoints() == volumeData->GetNumberOfPoints())
+      {
+        MaskToDataSet(mask,volumeData,output);
+        outdated = false;
+      }
+      return output;
+    }
+  }
+
+  return NULL;
+}
 //------------------------------------------------------------------------------
 void medDataPipeCustomSegmentationVolume::ApplyManualSegmentation()
 //------------------------------------------------------------------------------
@@ -198,104 +329,185 @@ void medDataPipeCustomSegmentationVolume::ApplyManualSegmentation()
     mafLogMessage("Error! Wrong manual volume mask");
     return;
   }
-  
-  vtkDataArray *maskScalar = maskVolumeData->GetPointData()->GetScalars();
-  vtkDataArray *regionGrowingScalar;
-  
-  if(maskVolumeData->IsA("vtkRectilinearGrid")) 
+
+  if (m_RegionGrowingMask->GetNumberOfPoints() != maskVolumeData->GetNumberOfPoints())
   {
-    m_RegionGrowingRG->Update();
-    if (m_RegionGrowingRG->GetPointData()->GetScalars() == NULL)
+    return;
+  }
+
+  mafEvent e(this,PROGRESSBAR_SHOW);
+  this->GetVME()->ForwardUpEvent(&e);
+
+  int dims[3];
+  m_RegionGrowingMask->GetDimensions(dims);
+  medSegmentationSparseMask manualMask;
+  manualMask.SetDimensions(dims);
+  DataSetToMask(maskVolumeData,&manualMask);
+
+  mafEvent eUpdate(this,PROGRESSBAR_SET_VALUE,(long)50);
+  this->GetVME()->ForwardUpEvent(&eUpdate);
+
+  // the points drawn in the mask invert the region growing result
+  m_ManualMask->DeepCopy(m_RegionGrowingMask);
+  m_ManualMask->Xor(&manualMask);
+  m_ManualOutputOutdated = true;
+  m_OutputMask = m_ManualMask;
+
+  mafEvent eHideProgress(this,PROGRESSBAR_HIDE);
+  this->GetVME()->ForwardUpEvent(&eHideProgress);
+
+}
+//------------------------------------------------------------------------------
+// Writes 255 in out for the values between lower and upper, 0 otherwise. For integer types
+// thresholds are rounded to the native type, so that the comparisons of the loop are done
+// on the native type and can be vectorised by the compiler.
+template <class T>
+static void TH_ThresholdSlice(const T *values, int n, double lower, double upper, unsigned char *out)
+//------------------------------------------------------------------------------
+{
+  if (std::numeric_limits<T>::is_integer)
+  {
+    double minValue = (double)std::numeric_limits<T>::min();
+    double maxValue = (double)std::numeric_limits<T>::max();
+    lower = ceil(lower);
+    upper = floor(upper);
+    if (lower > maxValue || upper < minValue || lower > upper)
     {
+      memset(out, 0, n);
       return;
     }
-    if (m_RegionGrowingRG->GetPointData()->GetScalars()->GetNumberOfTuples() != maskScalar->GetNumberOfTuples())
+    T lo = (T)(lower < minValue ? minValue : lower);
+    T hi = (T)(upper > maxValue ? maxValue : upper);
+    for (int k = 0; k < n; k++)
     {
-      return;
+      out[k] = (unsigned char)(((values[k] >= lo) & (values[k] <= hi)) * 255);
     }
-    regionGrowingScalar = m_RegionGrowingRG->GetPointData()->GetScalars();
   }
-  else if (maskVolumeData->IsA("vtkStructuredPoints"))
+  else
   {
-    m_RegionGrowingSP->Update();
-    if (m_RegionGrowingSP->GetPointData()->GetScalars() == NULL)
-    {
-      return;
-    }
-    if (m_RegionGrowingSP->GetPointData()->GetScalars()->GetNumberOfTuples() != maskScalar->GetNumberOfTuples())
+    for (int k = 0; k < n; k++)
     {
-      return;
+      double value = values[k];
+      out[k] = (unsigned char)(((value >= lower) & (value <= upper)) * 255);
     }
-    regionGrowingScalar = m_RegionGrowingSP->GetPointData()->GetScalars();
   }
+}
 
-  vtkMAFSmartPointer<vtkUnsignedCharArray> newScalars;
-  newScalars->SetName("SCALARS");
-  newScalars->SetNumberOfTuples(maskScalar->GetNumberOfTuples());
-
-  long progress = 0;
+//------------------------------------------------------------------------------
+// Slices of the automatic segmentation to compute
+typedef struct THRESHOLD_JOB
+{
+  vtkDataArray *Scalars;
+  int SliceSize;
+  int NumberOfSlices;
+  const unsigned char *Recompute;   // per slice: 1 if the slice has to be computed
+  const unsigned char *InRange;     // per slice: 1 if the slice has a threshold
+  const double *Lower;              // per slice lower threshold
+  const double *Upper;              // per slice upper threshold
+  int FirstSlab, LastSlab;          // slabs of the current round
+  medSegmentationSparseMask *Mask;
+} THRESHOLD_JOB;
 
-  mafEvent e(this,PROGRESSBAR_SHOW);
-  this->GetVME()->ForwardUpEvent(&e);
+//------------------------------------------------------------------------------
+// Computes the slabs of TILE_SIZE slices of the current round assigned to the thread, 
+// different slabs write different tiles of the mask
+static void TH_ExecuteSlabs(THRESHOLD_JOB *job, int threadId, int numberOfThreads)
+//------------------------------------------------------------------------------
+{
+  std::vector<unsigned char> sliceValues(job->SliceSize);
+  int slabSize = medSegmentationSparseMask::TILE_SIZE;
+  int numberOfComponents = job->Scalars->GetNumberOfComponents();
+  void *scalars = job->Scalars->GetVoidPointer(0);
 
-  int step = ceil((double)maskScalar->GetNumberOfTuples()/100);
-  double invStep = (double)1/step;
-  for (int i=0;i<maskScalar->GetNumberOfTuples();i++)
+  for (int slab = job->FirstSlab + threadId; slab < job->LastSlab; slab += numberOfThreads)
   {
-    if ((i%step) == 0)
-    {
-	    progress = (i*100/maskScalar->GetNumberOfTuples());
-	    mafEvent eUpdate(this,PROGRESSBAR_SET_VALUE,progress);
-	    this->GetVME()->ForwardUpEvent(&eUpdate);
-    }
+    int firstSlice = slab * slabSize;
+    int lastSlice = firstSlice + slabSize - 1 < job->NumberOfSlices - 1 ? firstSlice + slabSize - 1 : job->NumberOfSlices - 1;
+    bool changed = false;
 
-    if (maskScalar->GetTuple1(i) == 0)
+    for (int i = firstSlice; i <= lastSlice; i++)
     {
-      double value = regionGrowingScalar->GetTuple1(i);
-      newScalars->SetTuple1(i,value);
+      if (!job->Recompute[i])
+      {
+        continue;
+      }
+      changed = true;
+
+      unsigned char *out = &sliceValues[0];
+      int n = job->SliceSize;
+      vtkIdType offset = (vtkIdType)i * n;
+      if (!job->InRange[i])
+      {
+        // slices without a range are empty
+        memset(out, 0, n);
+      }
+      else if (numberOfComponents != 1)
+      {
+        for (int k = 0; k < n; k++)
+        {
+          double value = job->Scalars->GetComponent(offset + k, 0);
+          out[k] = (value >= job->Lower[i] && value <= job->Upper[i]) ? 255 : 0;
+        }
+      }
+      else
+      {
+        switch (job->Scalars->GetDataType())
+        {
+          case VTK_CHAR:
+            TH_ThresholdSlice((char *)scalars + offset, n, job->Lower[i], job->Upper[i], out);
+            break;
+          case VTK_UNSIGNED_CHAR:
+            TH_ThresholdSlice((unsigned char *)scalars + offset, n, job->Lower[i], job->Upper[i], out);
+            break;
+          case VTK_SHORT:
+            TH_ThresholdSlice((short *)scalars + offset, n, job->Lower[i], job->Upper[i], out);
+            break;
+          case VTK_UNSIGNED_SHORT:
+            TH_ThresholdSlice((unsigned short *)scalars + offset, n, job->Lower[i], job->Upper[i], out);
+            break;
+          case VTK_INT:
+            TH_ThresholdSlice((int *)scalars + offset, n, job->Lower[i], job->Upper[i], out);
+            break;
+          case VTK_UNSIGNED_INT:
+            TH_ThresholdSlice((unsigned int *)scalars + offset, n, job->Lower[i], job->Upper[i], out);
+            break;
+          case VTK_FLOAT:
+            TH_ThresholdSlice((float *)scalars + offset, n, job->Lower[i], job->Upper[i], out);
+            break;
+          case VTK_DOUBLE:
+            TH_ThresholdSlice((double *)scalars + offset, n, job->Lower[i], job->Upper[i], out);
+            break;
+          default:
+            for (int k = 0; k < n; k++)
+            {
+              double value = job->Scalars->GetTuple1(offset + k);
+              out[k] = (value >= job->Lower[i] && value <= job->Upper[i]) ? 255 : 0;
+            }
+            break;
+        }
+      }
+      job->Mask->SetSlice(i, out);
     }
-    else if (maskScalar->GetTuple1(i) == 255)
+
+    // tiles of partially recomputed slabs are compacted here
+    if (changed)
     {
-      double value = regionGrowingScalar->GetTuple1(i);
-      newScalars->SetTuple1(i,255-value);
+      job->Mask->Squeeze(firstSlice, lastSlice);
     }
   }
+}
 
-  if (volumeData->IsA("vtkStructuredPoints"))
-  {
-    vtkMAFSmartPointer<vtkStructuredPoints> newSP;
-    newSP->CopyStructure(vtkStructuredPoints::SafeDownCast(volumeData));
-    newSP->Update();
-    newSP->GetPointData()->AddArray(newScalars);
-    newSP->GetPointData()->SetActiveScalars("SCALARS");
-    newSP->SetScalarTypeToUnsignedChar();
-    newSP->Update();
-
-    m_ManualSP->DeepCopy(newSP);
-    m_ManualSP->Update();
-    m_SP->DeepCopy(newSP);
-    m_SP->Update();
-  }
-  else
-  {
-    vtkMAFSmartPointer<vtkRectilinearGrid> newRG;
-    newRG->CopyStructure(vtkRectilinearGrid::SafeDownCast(volumeData));
-    newRG->Update();
-    newRG->GetPointData()->AddArray(newScalars);
-    newRG->GetPointData()->SetActiveScalars("SCALARS");
-    newRG->Update();
-
-    m_ManualRG->DeepCopy(newRG);
-    m_ManualRG->Update();
-
-    m_RG->DeepCopy(newRG);
-    m_RG->Update();
-  }
-
-  mafEvent eHideProgress(this,PROGRESSBAR_HIDE);
-  this->GetVME()->ForwardUpEvent(&eHideProgress);  
+//------------------------------------------------------------------------------
+// Thread function of ApplyAutomaticSegmentation
+static VTK_THREAD_RETURN_TYPE TH_ExecuteSlabsThread(void *arg)
+//------------------------------------------------------------------------------
+{
+  vtkMultiThreader::ThreadInfo *info = (vtkMultiThreader::ThreadInfo *)arg;
+  TH_ExecuteSlabs((THRESHOLD_JOB *)info->UserData, info->ThreadID, info->NumberOfThreads);
 
+  return VTK_THREAD_RETURN_VALUE;
 }
+
 //------------------------------------------------------------------------------
 void medDataPipeCustomSegmentationVolume::ApplyAutomaticSegmentation()
 //------------------------------------------------------------------------------
@@ -306,259 +518,193 @@ void medDataPipeCustomSegmentationVolume::ApplyAutomaticSegmentation()
   volumeData->Update();
 
   int volumeDimensions[3];
-  if(volumeData->IsA("vtkRectilinearGrid")) {
-    vtkRectilinearGrid *rectilinearGrid=vtkRectilinearGrid::SafeDownCast(volumeData);
-    rectilinearGrid->GetDimensions(volumeDimensions);
-  }
-  else if (volumeData->IsA("vtkStructuredPoints")) {
-    vtkStructuredPoints *imageData=vtkStructuredPoints::SafeDownCast(volumeData);
-    imageData->GetDimensions(volumeDimensions);
+  vtkDataArray *inputScalars = volumeData->GetPointData()->GetScalars();
+  if (!GetVolumeDimensions(volumeData,volumeDimensions) || inputScalars == NULL)
+  {
+    return;
   }
 
-  long progress = 0;
-
   mafEvent e(this,PROGRESSBAR_SHOW);
   this->GetVME()->ForwardUpEvent(&e);
 
-  vtkMAFSmartPointer<vtkUnsignedCharArray> newScalars;
-  newScalars->SetName("SCALARS");
-  newScalars->SetNumberOfTuples(volumeDimensions[0]*volumeDimensions[1]*volumeDimensions[2]);
-
-  int step = ceil((double)volumeDimensions[2]/100);
-  double invStep = (double)1/step;
-
-  for (int i=0;i<volumeDimensions[2];i++)
+  // thresholds of each slice: slices without a range are empty
+  int numberOfSlices = volumeDimensions[2];
+  std::vector<unsigned char> inRange(numberOfSlices,0);
+  std::vector<double> lower(numberOfSlices,0);
+  std::vector<double> upper(numberOfSlices,0);
+  for (int i=0;i<numberOfSlices;i++)
   {
-    if (i%step == 0)
-    {
-	    progress = (i*100/volumeDimensions[2]);
-	    mafEvent eUpdate(this,PROGRESSBAR_SET_VALUE,progress);
-	    this->GetVME()->ForwardUpEvent(&eUpdate);
-    }
-
     double localThreshold;
     double localUpperTheshold;
-    bool inRange = false;
     if(m_AutomaticSegmentationThresholdModality == medVMESegmentationVolume::RANGE)
     {
       //Find the correct threshold for the slice
-      int rangeIndex = -1;
       for (int j=0;j<m_AutomaticSegmentationRanges.size();j++)
       {
         if (i>=(m_AutomaticSegmentationRanges[j][0]) && i<=(m_AutomaticSegmentationRanges[j][1]))
         {
-          rangeIndex = j;
           localThreshold = m_AutomaticSegmentationThresholds[j];
           localUpperTheshold = m_AutomaticSegmentationUpperThresholds[j];
-          inRange = true;
+          inRange[i] = 1;
           break;
         }
       }
     }
     else
     {
-      inRange = true;
+      inRange[i] = 1;
       localThreshold = m_AutomaticSegmentationGlobalThreshold;
       localUpperTheshold = m_AutomaticSegmentationGlobalUpperThreshold;
     }
-    //////////////////////////////////////////////////////////////////////////
 
-    int numberOfPoints = volumeDimensions[0] * volumeDimensions[1];
-    if(!inRange)
-    // range not specified
+    if (inRange[i])
     {
-      
-      for (int k=0;k<numberOfPoints;k++)
-      {
-        char value = 0;
-        newScalars->SetTuple1(k + i*numberOfPoints,value);
-      }
-    }
-
-    else
-    {
-      for (int k=0;k<(numberOfPoints);k++)
-      {
-        vtkDataArray *inputScalars = volumeData->GetPointData()->GetScalars();       
-        double value = inputScalars->GetTuple1(k + i*numberOfPoints);
-
-        if((!m_UseDoubleThreshold && value >= localThreshold) || (value>= localThreshold && value <= localUpperTheshold))
-          newScalars->SetTuple1(k + i*numberOfPoints,255);
-        else    
-          newScalars->SetTuple1(k + i*numberOfPoints,0);
-      }
+      lower[i] = localThreshold;
+      upper[i] = m_UseDoubleThreshold ? localUpperTheshold : VTK_DOUBLE_MAX;
     }
   }
 
+  // only the slices whose threshold changed since the last computation on the same scalars are computed
+  int maskDimensions[3];
+  m_AutomaticMask->GetDimensions(maskDimensions);
+  bool sameScalars = m_ThresholdedScalars == inputScalars && m_ThresholdedScalarsMTime == inputScalars->GetMTime() &&
+    maskDimensions[0] == volumeDimensions[0] && maskDimensions[1] == volumeDimensions[1] && maskDimensions[2] == volumeDimensions[2] &&
+    m_ThresholdedSliceInRange.size() == numberOfSlices;
+  if (!sameScalars)
+  {
+    m_AutomaticMask->SetDimensions(volumeDimensions);
+  }
 
-  if (volumeData->IsA("vtkStructuredPoints"))
+  std::vector<unsigned char> recompute(numberOfSlices,1);
+  m_NumberOfThresholdedSlices = numberOfSlices;
+  if (sameScalars)
   {
-    vtkMAFSmartPointer<vtkStructuredPoints> newSP;
-    newSP->CopyStructure(vtkStructuredPoints::SafeDownCast(volumeData));
-    newSP->Update();
-    newSP->GetPointData()->AddArray(newScalars);
-    newSP->GetPointData()->SetActiveScalars("SCALARS");
-    //newSP->SetScalarTypeToShort();
-    newSP->Update();
-
-    m_AutomaticSP->DeepCopy(newSP);
-    m_AutomaticSP->Update();
-    m_SP->DeepCopy(newSP); 
-    m_SP->Update();
+    m_NumberOfThresholdedSlices = 0;
+    for (int i=0;i<numberOfSlices;i++)
+    {
+      recompute[i] = inRange[i] != m_ThresholdedSliceInRange[i] ||
+        (inRange[i] && (lower[i] != m_ThresholdedSliceLower[i] || upper[i] != m_ThresholdedSliceUpper[i]));
+      m_NumberOfThresholdedSlices += recompute[i];
+    }
   }
-  else
+
+  THRESHOLD_JOB job;
+  job.Scalars = inputScalars;
+  job.SliceSize = volumeDimensions[0] * volumeDimensions[1];
+  job.NumberOfSlices = numberOfSlices;
+  job.Recompute = &recompute[0];
+  job.InRange = &inRange[0];
+  job.Lower = &lower[0];
+  job.Upper = &upper[0];
+  job.Mask = m_AutomaticMask;
+
+  vtkMultiThreader *threader = vtkMultiThreader::New();
+  int numberOfSlabs = (numberOfSlices + medSegmentationSparseMask::TILE_SIZE - 1) / medSegmentationSparseMask::TILE_SIZE;
+  int nThreads = threader->GetNumberOfThreads();
+  if (nThreads > numberOfSlabs)
+    nThreads = numberOfSlabs;
+  if (nThreads < 1)
+    nThreads = 1;
+
+  // slabs are processed in rounds of one slab per thread, the progress bar is updated after every round
+  mafEvent eUpdate(this,PROGRESSBAR_SET_VALUE,(long)0);
+  for (job.FirstSlab = 0; job.FirstSlab < numberOfSlabs; job.FirstSlab = job.LastSlab)
   {
-    vtkMAFSmartPointer<vtkRectilinearGrid> newRG;
-    newRG->CopyStructure(vtkRectilinearGrid::SafeDownCast(volumeData));
-    newRG->Update();
-    newRG->GetPointData()->AddArray(newScalars);
-    newRG->GetPointData()->SetActiveScalars("SCALARS");
-    newRG->Update();
-
-    double sr[2];
-    int n;
-    vtkDataArray *x = newRG->GetXCoordinates();
-    x->GetRange(sr);
-    n = x->GetNumberOfTuples();
-
-    m_AutomaticRG->DeepCopy(newRG);
-    m_AutomaticRG->Update();
-    m_RG->DeepCopy(newRG);
-    m_RG->Update();
+    job.LastSlab = job.FirstSlab + nThreads < numberOfSlabs ? job.FirstSlab + nThreads : numberOfSlabs;
+
+    if (nThreads == 1)
+    {
+      TH_ExecuteSlabs(&job, 0, 1);
+    }
+    else
+    {
+      threader->SetNumberOfThreads(nThreads);
+      threader->SetSingleMethod(TH_ExecuteSlabsThread, &job);
+      threader->SingleMethodExecute();
+    }
+
+    eUpdate.SetArg((long)(job.LastSlab * 100 / numberOfSlabs));
+    this->GetVME()->ForwardUpEvent(&eUpdate);
   }
+  vtkDEL(threader);
 
-  mafEvent eHideProgress(this,PROGRESSBAR_HIDE);
-  this->GetVME()->ForwardUpEvent(&eHideProgress);
+  m_ThresholdedScalars = inputScalars;
+  m_ThresholdedScalarsMTime = inputScalars->GetMTime();
+  m_ThresholdedSliceInRange = inRange;
+  m_ThresholdedSliceLower = lower;
+  m_ThresholdedSliceUpper = upper;
 
+  m_AutomaticOutputOutdated = true;
+  m_OutputMask = m_AutomaticMask;
 
+  mafEvent eHideProgress(this,PROGRESSBAR_HIDE);
+  this->GetVME()->ForwardUpEvent(&eHideProgress);
 }
 //------------------------------------------------------------------------------
 void medDataPipeCustomSegmentationVolume::ApplyRefinementSegmentation()
 //------------------------------------------------------------------------------
 {
-  if (m_RefinementVolumeMask == NULL)
-  {
-    return;
-  }
-
-  mafVME *vol = mafVME::SafeDownCast(m_Volume);
-  vol->GetOutput()->Update();
-  vtkDataSet *volumeData = vol->GetOutput()->GetVTKData();
-  volumeData->Update();
-
-  vtkDataSet *maskVolumeData = mafVME::SafeDownCast(m_RefinementVolumeMask)->GetOutput()->GetVTKData();
-  maskVolumeData->Update();
+  int dims[3];
+  m_ManualMask->GetDimensions(dims);
+  medSegmentationSparseMask refinementMask;
+  medSegmentationSparseMask *inputMask = m_RefinementInputMask;
 
-  if (maskVolumeData==NULL || maskVolumeData->GetNumberOfPoints() != volumeData->GetNumberOfPoints() || maskVolumeData->GetPointData()->GetScalars()==NULL)
+  if (inputMask)
   {
-    mafLogMessage("Error! Wrong refinement volume mask");
-    return;
-  }
-
-  vtkDataArray *maskScalar = maskVolumeData->GetPointData()->GetScalars();
-  vtkDataArray *manualScalar;
-
-  if(maskVolumeData->IsA("vtkRectilinearGrid")) 
-  {
-    if (m_ManualRG == NULL)
-    {
-      return;
-    }
-
-    m_ManualRG->Update();
-    if (m_ManualRG->GetPointData()->GetScalars() == NULL)
-    {
-      return;
-    }
-    if (m_ManualRG->GetPointData()->GetScalars()->GetNumberOfTuples() != maskScalar->GetNumberOfTuples())
+    // the tiles edited by the tools are used as they are
+    int inputDims[3];
+    inputMask->GetDimensions(inputDims);
+    if (inputDims[0] != dims[0] || inputDims[1] != dims[1] || inputDims[2] != dims[2])
     {
+      mafLogMessage("Error! Wrong refinement input mask");
       return;
     }
-    manualScalar = m_ManualRG->GetPointData()->GetScalars();
   }
-  else if (maskVolumeData->IsA("vtkStructuredPoints"))
+  else
   {
-    if (m_ManualSP == NULL)
+    if (m_RefinementVolumeMask == NULL)
     {
       return;
     }
 
-    m_ManualSP->Update();
-    if (m_ManualSP->GetPointData()->GetScalars() == NULL)
+    mafVME *vol = mafVME::SafeDownCast(m_Volume);
+    vol->GetOutput()->Update();
+    vtkDataSet *volumeData = vol->GetOutput()->GetVTKData();
+    volumeData->Update();
+
+    vtkDataSet *maskVolumeData = mafVME::SafeDownCast(m_RefinementVolumeMask)->GetOutput()->GetVTKData();
+    maskVolumeData->Update();
+
+    if (maskVolumeData==NULL || maskVolumeData->GetNumberOfPoints() != volumeData->GetNumberOfPoints() || maskVolumeData->GetPointData()->GetScalars()==NULL)
     {
+      mafLogMessage("Error! Wrong refinement volume mask");
       return;
     }
-    if (m_ManualSP->GetPointData()->GetScalars()->GetNumberOfTuples() != maskScalar->GetNumberOfTuples())
+
+    if (m_ManualMask->GetNumberOfPoints() != maskVolumeData->GetNumberOfPoints())
     {
       return;
     }
-    manualScalar = m_ManualSP->GetPointData()->GetScalars();
-  }
-
-  vtkMAFSmartPointer<vtkUnsignedCharArray> newScalars;
-  newScalars->SetName("SCALARS");
-  newScalars->SetNumberOfTuples(maskScalar->GetNumberOfTuples());
 
-  long progress = 0;
+    refinementMask.SetDimensions(dims);
+    DataSetToMask(maskVolumeData,&refinementMask);
+    inputMask = &refinementMask;
+  }
 
   mafEvent e(this,PROGRESSBAR_SHOW);
   this->GetVME()->ForwardUpEvent(&e);
 
-  int step = ceil((double)maskScalar->GetNumberOfTuples()/100);
-  double invStep = (double)1/step;
-  for (int i=0;i<maskScalar->GetNumberOfTuples();i++)
-  {
-    if ((i%step) == 0)
-    {
-      progress = (i*100/maskScalar->GetNumberOfTuples());
-      mafEvent eUpdate(this,PROGRESSBAR_SET_VALUE,progress);
-      this->GetVME()->ForwardUpEvent(&eUpdate);
-    }
+  mafEvent eUpdate(this,PROGRESSBAR_SET_VALUE,(long)50);
+  this->GetVME()->ForwardUpEvent(&eUpdate);
 
-    if (maskScalar->GetTuple1(i) == 0)
-    {
-      double value = manualScalar->GetTuple1(i);
-      newScalars->SetTuple1(i,value);
-    }
-    if (maskScalar->GetTuple1(i) == 255)
-    {
-      double value = manualScalar->GetTuple1(i);
-      newScalars->SetTuple1(i,255-value);
-    }
-  }
-
-  if (volumeData->IsA("vtkStructuredPoints"))
-  {
-    vtkMAFSmartPointer<vtkStructuredPoints> newSP;
-    newSP->CopyStructure(vtkStructuredPoints::SafeDownCast(volumeData));
-    newSP->Update();
-    newSP->GetPointData()->AddArray(newScalars);
-    newSP->GetPointData()->SetActiveScalars("SCALARS");
-    newSP->SetScalarTypeToUnsignedChar();
-    newSP->Update();
-
-    m_RefinementSP->DeepCopy(newSP);
-    m_RefinementSP->Update();
-    m_SP->DeepCopy(newSP);
-    m_SP->Update();
-  }
-  else
-  {
-    vtkMAFSmartPointer<vtkRectilinearGrid> newRG;
-    newRG->CopyStructure(vtkRectilinearGrid::SafeDownCast(volumeData));
-    newRG->Update();
-    newRG->GetPointData()->AddArray(newScalars);
-    newRG->GetPointData()->SetActiveScalars("SCALARS");
-    newRG->Update();
-
-    m_RefinementRG->DeepCopy(newRG);
-    m_RefinementRG->Update();
-    m_RG->DeepCopy(newRG);
-    m_RG->Update();
-  }
+  // the points of the refinement mask invert the manual result
+  m_RefinementMask->DeepCopy(m_ManualMask);
+  m_RefinementMask->Xor(inputMask);
+  m_RefinementOutputOutdated = true;
+  m_OutputMask = m_RefinementMask;
 
   mafEvent eHideProgress(this,PROGRESSBAR_HIDE);
-  this->GetVME()->ForwardUpEvent(&eHideProgress);  
+  this->GetVME()->ForwardUpEvent(&eHideProgress);
 }
 //------------------------------------------------------------------------------
 void medDataPipeCustomSegmentationVolume::ApplyRegionGrowingSegmentation()
@@ -577,23 +723,12 @@ void medDataPipeCustomSegmentationVolume::ApplyRegionGrowingSegmentation()
 
   if (m_RegionGrowingSeeds.size()==0)
   {
-    if (volumeData->IsA("vtkStructuredPoints"))
-    {
-      m_RegionGrowingSP->DeepCopy(m_AutomaticSP);
-      m_RegionGrowingSP->Update();
-      m_SP->DeepCopy(m_RegionGrowingSP);
-      m_SP->Update();
-    }
-    else if (volumeData->IsA("vtkRectilinearGrid"))
-    {
-      m_RegionGrowingRG->DeepCopy(m_AutomaticRG);
-      m_RegionGrowingRG->Update();
-      m_RG->DeepCopy(m_RegionGrowingRG);
-      m_RG->Update();
-    }
+    m_RegionGrowingMask->DeepCopy(m_AutomaticMask);
+    m_RegionGrowingOutputOutdated = true;
+    m_OutputMask = m_RegionGrowingMask;
 
     mafEvent eHideProgress(this,PROGRESSBAR_HIDE);
-    this->GetVME()->ForwardUpEvent(&eHideProgress);  
+    this->GetVME()->ForwardUpEvent(&eHideProgress);
     return;
   }
 
@@ -601,13 +736,10 @@ void medDataPipeCustomSegmentationVolume::ApplyRegionGrowingSegmentation()
   this->GetVME()->ForwardUpEvent(&eUpdate);
 
   vtkMAFSmartPointer<vtkStructuredPoints> spInputOfRegionGrowing;
-  vtkDataSet *automaticData;
   if (volumeData->IsA("vtkStructuredPoints"))
   {
     spInputOfRegionGrowing->DeepCopy(vtkStructuredPoints::SafeDownCast(volumeData));
     spInputOfRegionGrowing->Update();
-
-    automaticData = m_AutomaticSP;
   }
   else if (volumeData->IsA("vtkRectilinearGrid"))
   {
@@ -626,9 +758,6 @@ void medDataPipeCustomSegmentationVolume::ApplyRegionGrowingSegmentation()
     spInputOfRegionGrowing->GetPointData()->AddArray(oldScalars);
     spInputOfRegionGrowing->GetPointData()->SetActiveScalars("SCALARS");
     spInputOfRegionGrowing->Update();
-
-    automaticData = m_AutomaticRG;
-    
   }
 
   eUpdate.SetArg(10);
@@ -690,99 +819,39 @@ void medDataPipeCustomSegmentationVolume::ApplyRegionGrowingSegmentation()
   //Perform the OR operation between region growing and automatic output
   //////////////////////////////////////////////////////////////////////////
 
-
   int volumeDimensions[3];
-  if(volumeData->IsA("vtkRectilinearGrid")) {
-    vtkRectilinearGrid *rectilinearGrid=vtkRectilinearGrid::SafeDownCast(volumeData);
-    rectilinearGrid->GetDimensions(volumeDimensions);
-  }
-  else if (volumeData->IsA("vtkStructuredPoints")) {
-    vtkStructuredPoints *imageData=vtkStructuredPoints::SafeDownCast(volumeData);
-    imageData->GetDimensions(volumeDimensions);
-  }
+  GetVolumeDimensions(volumeData,volumeDimensions);
 
-  vtkMAFSmartPointer<vtkUnsignedCharArray> newScalars;
-  newScalars->SetNumberOfTuples(volumeData->GetNumberOfPoints());
-  newScalars->SetName("SCALARS");
-  newScalars->SetNumberOfTuples(volumeDimensions[0]*volumeDimensions[1]*volumeDimensions[2]);
+  medSegmentationSparseMask connectedMask;
+  connectedMask.SetDimensions(volumeDimensions);
+  vtkDataArray *regionGrowingScalars = spOutputRegionGrowing->GetPointData()->GetScalars();
 
   int numberOfPoints = volumeDimensions[0] * volumeDimensions[1];
-  
+  std::vector<unsigned char> sliceValues(numberOfPoints);
   for (int i=0;i<volumeDimensions[2];i++)
   {
-
     for (int k=0;k<numberOfPoints;k++)
     {
-      int index = k+i*(volumeDimensions[0]*volumeDimensions[1]);
-      double automaticValue = automaticData->GetPointData()->GetScalars()->GetTuple1(index);
-      double regionGrowingValue = spOutputRegionGrowing->GetPointData()->GetScalars()->GetTuple1(index);
-
-      if(i>m_RegionGrowingEndSlice || i<m_RegionGrowingStartSlice)
-      {
-        newScalars->SetTuple1(k+i*(volumeDimensions[0]*volumeDimensions[1]),automaticValue);
-      }
-      else
-      {
-        if (automaticValue == 255 || regionGrowingValue == 255)
-        {
-          newScalars->SetTuple1(index,255);
-        }
-        else
-        {
-          newScalars->SetTuple1(index,0);
-        }
-
-      }
-      
+      sliceValues[k] = regionGrowingScalars->GetTuple1(k+i*numberOfPoints) == 255 ? 255 : 0;
     }
+    connectedMask.SetSlice(i,&sliceValues[0]);
   }
 
-
-
-
- /* for (int i=0;i<volumeData->GetNumberOfPoints();i++)
-  {
-    if (automaticData->GetPointData()->GetScalars()->GetTuple1(i) == 255 || spOutputRegionGrowing->GetPointData()->GetScalars()->GetTuple1(i) == 255)
-    {
-      newScalars->SetTuple1(i,255);
-    }
-    else
-    {
-      newScalars->SetTuple1(i,0);
-    }
-  }*/
-  //////////////////////////////////////////////////////////////////////////
-
-  eUpdate.SetArg(85);
-  this->GetVME()->ForwardUpEvent(&eUpdate);
-
-  if (volumeData->IsA("vtkStructuredPoints"))
-  {
-    m_RegionGrowingSP->CopyStructure(vtkStructuredPoints::SafeDownCast(volumeData));
-    m_RegionGrowingSP->GetPointData()->AddArray(newScalars);
-    m_RegionGrowingSP->GetPointData()->SetActiveScalars("SCALARS");
-    m_RegionGrowingSP->SetScalarTypeToUnsignedChar();
-    m_RegionGrowingSP->Update();
-    
-    m_SP->DeepCopy(m_RegionGrowingSP);
-    m_SP->Update();
-  }
-  else if (volumeData->IsA("vtkRectilinearGrid"))
+  // outside the slice range the automatic result is kept
+  m_RegionGrowingMask->DeepCopy(m_AutomaticMask);
+  if (m_RegionGrowingEndSlice >= m_RegionGrowingStartSlice && m_RegionGrowingEndSlice >= 0)
   {
-    m_RegionGrowingRG->CopyStructure(vtkRectilinearGrid::SafeDownCast(volumeData));
-    m_RegionGrowingRG->GetPointData()->AddArray(newScalars);
-    m_RegionGrowingRG->GetPointData()->SetActiveScalars("SCALARS");
-    m_RegionGrowingRG->Update();
-
-    m_RG->DeepCopy(m_RegionGrowingRG);
-    m_RG->Update();
+    m_RegionGrowingMask->Or(&connectedMask,m_RegionGrowingStartSlice,m_RegionGrowingEndSlice);
   }
+  m_RegionGrowingOutputOutdated = true;
+  m_OutputMask = m_RegionGrowingMask;
+  //////////////////////////////////////////////////////////////////////////
 
   eUpdate.SetArg(100);
   this->GetVME()->ForwardUpEvent(&eUpdate);
 
   mafEvent eHideProgress(this,PROGRESSBAR_HIDE);
-  this->GetVME()->ForwardUpEvent(&eHideProgress);  
+  this->GetVME()->ForwardUpEvent(&eHideProgress);
 
 }
 //------------------------------------------------------------------------------
@@ -797,6 +866,8 @@ void medDataPipeCustomSegmentationVolume::PreExecute()
     vtkDataSet *volumeData = vol->GetOutput()->GetVTKData();
     if(volumeData)
     {
+      bool changed = m_ChangedAutomaticData || m_ChangedRegionGrowingData || m_ChangedManualData || m_ChangedRefinementData;
+
       if (m_ChangedAutomaticData)
       {
         ApplyAutomaticSegmentation();
@@ -814,6 +885,19 @@ void medDataPipeCustomSegmentationVolume::PreExecute()
         ApplyRefinementSegmentation();
       }
 
+      // only the output of the last applied segmentation is converted to a dense dataset
+      if (changed && m_OutputMask && m_OutputMask->GetNumberOfPoints() == volumeData->GetNumberOfPoints())
+      {
+        if (volumeData->IsA("vtkRectilinearGrid"))
+        {
+          MaskToDataSet(m_OutputMask,volumeData,m_RG);
+        }
+        else if (volumeData->IsA("vtkStructuredPoints"))
+        {
+          MaskToDataSet(m_OutputMask,volumeData,m_SP);
+        }
+      }
+
       m_ChangedAutomaticData = false;
       m_ChangedManualData = false;
       m_ChangedRefinementData = false;
@@ -937,104 +1021,37 @@ void medDataPipeCustomSegmentationVolume::SetRefinementVolumeMask(mafNode *volum
   Modified();
 }
 //------------------------------------------------------------------------------
-vtkDataSet *medDataPipeCustomSegmentationVolume::GetAutomaticOutput()
+void medDataPipeCustomSegmentationVolume::SetRefinementInputMask(medSegmentationSparseMask *mask)
 //------------------------------------------------------------------------------
 {
-  mafVME *vol = mafVME::SafeDownCast(m_Volume);
-  if(vol)
-  {
-    vol->GetOutput()->Update();
-    vtkDataSet *volumeData = vol->GetOutput()->GetVTKData();
-    if(volumeData)
-    {
-      volumeData->Update();
-      if(volumeData->IsA("vtkRectilinearGrid"))
-      {
-        return m_AutomaticRG;
-      }
-      else if (volumeData->IsA("vtkImageData"))
-      {
-        return m_AutomaticSP;
-      }
-    }
-  }
+  m_RefinementInputMask = mask;
 
-  return NULL;
+  m_ChangedRefinementData = true;
+  Modified();
+}
+//------------------------------------------------------------------------------
+vtkDataSet *medDataPipeCustomSegmentationVolume::GetAutomaticOutput()
+//------------------------------------------------------------------------------
+{
+  return GetStageOutput(m_AutomaticMask,m_AutomaticSP,m_AutomaticRG,m_AutomaticOutputOutdated);
 }
 //------------------------------------------------------------------------------
 vtkDataSet *medDataPipeCustomSegmentationVolume::GetManualOutput()
 //------------------------------------------------------------------------------
 {
-  mafVME *vol = mafVME::SafeDownCast(m_Volume);
-  if(vol)
-  {
-    vol->GetOutput()->Update();
-    vtkDataSet *volumeData = vol->GetOutput()->GetVTKData();
-    if(volumeData)
-    {
-      volumeData->Update();
-      if(volumeData->IsA("vtkRectilinearGrid"))
-      {
-        return m_ManualRG;
-      }
-      else if (volumeData->IsA("vtkImageData"))
-      {
-        return m_ManualSP;
-      }
-    }
-  }
-
-  return NULL;
+  return GetStageOutput(m_ManualMask,m_ManualSP,m_ManualRG,m_ManualOutputOutdated);
 }
 //------------------------------------------------------------------------------
 vtkDataSet *medDataPipeCustomSegmentationVolume::GetRefinementOutput()
 //------------------------------------------------------------------------------
 {
-  mafVME *vol = mafVME::SafeDownCast(m_Volume);
-  if(vol)
-  {
-    vol->GetOutput()->Update();
-    vtkDataSet *volumeData = vol->GetOutput()->GetVTKData();
-    if(volumeData)
-    {
-      volumeData->Update();
-      if(volumeData->IsA("vtkRectilinearGrid"))
-      {
-        return m_RefinementRG;
-      }
-      else if (volumeData->IsA("vtkImageData"))
-      {
-        return m_RefinementSP;
-      }
-    }
-  }
-
-  return NULL;
+  return GetStageOutput(m_RefinementMask,m_RefinementSP,m_RefinementRG,m_RefinementOutputOutdated);
 }
 //------------------------------------------------------------------------------
 vtkDataSet *medDataPipeCustomSegmentationVolume::GetRegionGrowingOutput()
 //------------------------------------------------------------------------------
 {
-  mafVME *vol = mafVME::SafeDownCast(m_Volume);
-  if(vol)
-  {
-    vol->GetOutput()->Update();
-    vtkDataSet *volumeData = vol->GetOutput()->GetVTKData();
-    if(volumeData)
-    {
-      volumeData->Update();
-      if(volumeData->IsA("vtkRectilinearGrid"))
-      {
-        return m_RegionGrowingRG;
-      }
-      else if (volumeData->IsA("vtkImageData"))
-      {
-        return m_RegionGrowingSP;
-      }
-    }
-  }
-
-  return NULL;
+  return GetStageOutput(m_RegionGrowingMask,m_RegionGrowingSP,m_RegionGrowingRG,m_RegionGrowingOutputOutdated);
 }
 //----------------------------------------------------------------------------
 bool medDataPipeCustomSegmentationVolume::CheckNumberOfThresholds()
@@ -28,6 +28,8 @@
 //----------------------------------------------------------------------------
 class vtkRectilinearGrid;
 class vtkStructuredPoints;
+class vtkDataArray;
+class medSegmentationSparseMask;
 
 /** */
 class MED_VME_EXPORT medDataPipeCustomSegmentationVolume : public mafDataPipeCustom
@@ -101,6 +103,14 @@ public:
   /** Get the volume mask for the refinement segmentation */
   mafNode *GetRefinementVolumeMask();
 
+  /** Set the sparse mask edited by the refinement tools, used in place of the refinement volume mask so that
+      its dense copy is not converted at each change. The mask is not owned: set it again after each edit
+      to update the output, and set NULL before deleting it. */
+  void SetRefinementInputMask(medSegmentationSparseMask *mask);
+
+  /** Get the sparse mask edited by the refinement tools */
+  medSegmentationSparseMask *GetRefinementInputMask() {return m_RefinementInputMask;};
+
   /** Return the vtkDataSet of the automatic segmentation */
   vtkDataSet *GetAutomaticOutput();
 
@@ -113,6 +123,24 @@ public:
   /** Return the vtkDataSet of the region growing segmentation */
   vtkDataSet *GetRegionGrowingOutput();
 
+  /** Return the sparse mask of the automatic segmentation */
+  medSegmentationSparseMask *GetAutomaticMask() {return m_AutomaticMask;};
+
+  /** Return the sparse mask of the manual segmentation */
+  medSegmentationSparseMask *GetManualMask() {return m_ManualMask;};
+
+  /** Return the sparse mask of the refinement segmentation */
+  medSegmentationSparseMask *GetRefinementMask() {return m_RefinementMask;};
+
+  /** Return the sparse mask of the region growing segmentation */
+  medSegmentationSparseMask *GetRegionGrowingMask() {return m_RegionGrowingMask;};
+
+  /** Return the number of slices thresholded by the last automatic segmentation, the others were kept from the previous one */
+  int GetNumberOfThresholdedSlices() {return m_NumberOfThresholdedSlices;};
+
+  /** Copy the scalars of data in mask, return false if the number of points doesn't match */
+  static bool DataSetToMask(vtkDataSet *data, medSegmentationSparseMask *mask);
+
   /** Set the region growing upper threshold */
   void SetRegionGrowingUpperThreshold(double value);
 
@@ -173,6 +201,15 @@ protected:
   /** function called to updated the data pipe output */
   /*virtual*/ void Execute();
 
+  /** Get the dimensions of the structured points or rectilinear grid volumeData */
+  static bool GetVolumeDimensions(vtkDataSet *volumeData, int dims[3]);
+
+  /** Write the dense values of mask in output, with the structure of volumeData */
+  static void MaskToDataSet(medSegmentationSparseMask *mask, vtkDataSet *volumeData, vtkDataSet *output);
+
+  /** Return sp or rg according to the volume type, writing in it the values of mask if outdated */
+  vtkDataSet *GetStageOutput(medSegmentationSparseMask *mask, vtkStructuredPoints *sp, vtkRectilinearGrid *rg, bool &outdated);
+
   vtkRectilinearGrid *m_RG;
   vtkStructuredPoints *m_SP;
 
@@ -185,6 +222,25 @@ protected:
   vtkRectilinearGrid *m_RegionGrowingRG;
   vtkStructuredPoints *m_RegionGrowingSP;
 
+  // results of the segmentation stages, dense stage datasets are written only on request
+  medSegmentationSparseMask *m_AutomaticMask;
+  medSegmentationSparseMask *m_ManualMask;
+  medSegmentationSparseMask *m_RefinementMask;
+  medSegmentationSparseMask *m_RegionGrowingMask;
+  medSegmentationSparseMask *m_OutputMask; //< mask of the last applied stage
+  bool m_AutomaticOutputOutdated;
+  bool m_ManualOutputOutdated;
+  bool m_RefinementOutputOutdated;
+  bool m_RegionGrowingOutputOutdated;
+
+  // thresholds of the slices of m_AutomaticMask, to compute only the slices whose threshold changes
+  vtkDataArray *m_ThresholdedScalars;
+  unsigned long m_ThresholdedScalarsMTime;
+  std::vector<unsigned char> m_ThresholdedSliceInRange;
+  std::vector<double> m_ThresholdedSliceLower;
+  std::vector<double> m_ThresholdedSliceUpper;
+  int m_NumberOfThresholdedSlices;
+
   bool m_ChangedManualData;
   bool m_ChangedAutomaticData;
   bool m_ChangedRefinementData;
@@ -193,6 +249,7 @@ protected:
   mafNode *m_Volume;
   mafNode *m_ManualVolumeMask;
   mafNode *m_RefinementVolumeMask;
+  medSegmentationSparseMask *m_RefinementInputMask; //< edited by the tools, not owned
 
   //Stuff for automatic threshold
   int m_UseDoubleThreshold;
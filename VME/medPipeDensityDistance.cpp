@@ -77,6 +77,7 @@ medPipeDensityDistance::medPipeDensityDistance()
   m_Mapper          = NULL;
   m_Actor           = NULL;
   m_DistanceFilter  = NULL;
+  m_DistanceFieldFilter = NULL;
   m_Table           = NULL;
   m_Normals         = NULL;
   m_Volume          = NULL;
@@ -86,6 +87,7 @@ medPipeDensityDistance::medPipeDensityDistance()
   m_FirstThreshold = 700;
   m_SecondThreshold = 300;
   m_MaxDistance = 2;
+  m_UseDistanceField = 0;
 	m_BarTipology = 0;
 	m_NumSections = 3;
 	m_Area[0] = 0;
@@ -109,6 +111,7 @@ void medPipeDensityDistance::Create(mafSceneNode *n/*, bool use_axes*/)
 
   vtkNEW(m_Normals);
 	vtkNEW(m_DistanceFilter);
+  vtkNEW(m_DistanceFieldFilter);
 	vtkNEW(m_Mapper);
 	vtkNEW(m_Actor);
 	vtkNEW(m_Table);
@@ -137,7 +140,12 @@ void medPipeDensityDistance::Create(mafSceneNode *n/*, bool use_axes*/)
 	  m_DistanceFilter->SetThreshold(m_FirstThreshold);
 	  m_DistanceFilter->SetDistanceModeToScalar();
 	  m_DistanceFilter->SetInputMatrix(surface_output->GetAbsMatrix()->GetVTKMatrix());
-		m_DistanceFilter->Update();
+	  m_DistanceFieldFilter->SetSource(((mafVME*)m_Volume)->GetOutput()->GetVTKData());
+	  m_DistanceFieldFilter->SetInput((vtkDataSet *)m_Normals->GetOutput());
+	  m_DistanceFieldFilter->SetMaxDistance(m_MaxDistance);
+	  m_DistanceFieldFilter->SetThreshold(m_FirstThreshold);
+	  m_DistanceFieldFilter->SetInputMatrix(surface_output->GetAbsMatrix()->GetVTKMatrix());
+		GetMapsFilter()->Update();
 
 		/*double i;
 		m_Table->AddRGBPoint(-m_DistanceFilter->GetMaxDistance(), 1.f, 0.f, 0.0f);
@@ -220,17 +228,17 @@ void medPipeDensityDistance::Create(mafSceneNode *n/*, bool use_axes*/)
 		for (i=m_MaxDistance;i<=4*m_MaxDistance;i++)
 			m_Table->AddRGBPoint(i,m_HiColour.Red()/255.0, m_HiColour.Green()/255.0,	m_HiColour.Blue()/255.0);
 	  
-		m_Mapper->SetInput((vtkPolyData*)m_DistanceFilter->GetOutput());
+		m_Mapper->SetInput((vtkPolyData*)GetMapsFilter()->GetOutput());
 
 		//Calculate the areas
 		vtkMAFSmartPointer<vtkMassProperties> mass_all;
-		mass_all->SetInput(m_DistanceFilter->GetPolyDataOutput());
+		mass_all->SetInput(GetMapsFilter()->GetPolyDataOutput());
 		mass_all->Update();
 
 		double total_area = mass_all->GetSurfaceArea();
 
 		vtkMAFSmartPointer<vtkClipPolyData> clipHigh;
-		clipHigh->SetInput(m_DistanceFilter->GetPolyDataOutput());
+		clipHigh->SetInput(GetMapsFilter()->GetPolyDataOutput());
 		clipHigh->SetValue(m_MaxDistance);
 		clipHigh->GenerateClippedOutputOn();
 		clipHigh->Update();
@@ -313,6 +321,10 @@ medPipeDensityDistance::~medPipeDensityDistance()
 	vtkDEL(m_Mapper);
   vtkDEL(m_Actor);
   vtkDEL(m_DistanceFilter);
+  // the cached distance fields keep a reference to the volume
+  if (m_DistanceFieldFilter && m_DistanceFieldFilter->GetSource())
+    vtkMEDDistanceFieldFilter::ReleaseDistanceFields(m_DistanceFieldFilter->GetSource());
+  vtkDEL(m_DistanceFieldFilter);
   vtkDEL(m_Table);
   vtkDEL(m_ScalarBar);
   //cppDEL(m_Axes);
@@ -351,6 +363,7 @@ mafGUI *medPipeDensityDistance::CreateGui()
   m_Gui->Integer(ID_SECOND_THRESHOLD,"2 Threshold",&m_SecondThreshold,range[0],range[1]);
   m_Gui->Divider(1);
   m_Gui->Integer(ID_MAX_DISTANCE,"Max Dist.",&m_MaxDistance,1,100);
+  m_Gui->Bool(ID_USE_DISTANCE_FIELD,_("Distance field"),&m_UseDistanceField,0,_("Read distances and densities from a cached distance transform of the volume"));
   //m_Gui->Integer(ID_NUM_SECTIONS,"Intervals",&m_NumSections,2,100);
 	m_Gui->Divider(1);
 	m_Choices[0]=_("Discrete");
@@ -404,6 +417,7 @@ mafGUI *medPipeDensityDistance::CreateGui()
     m_Gui->Enable(ID_FIRST_THRESHOLD,false);
     m_Gui->Enable(ID_SECOND_THRESHOLD,false);
     m_Gui->Enable(ID_MAX_DISTANCE,false);
+    m_Gui->Enable(ID_USE_DISTANCE_FIELD,false);
 		m_Gui->Enable(ID_NUM_SECTIONS,false);
 		m_Gui->Enable(ID_BAR_TIPOLOGY,false);
   }
@@ -458,6 +472,11 @@ void medPipeDensityDistance::OnEvent(mafEventBase *maf_event)
         UpdatePipeline();
       }
       break;
+    case ID_USE_DISTANCE_FIELD:
+      {
+        SetUseDistanceField(m_UseDistanceField);
+      }
+      break;
     case ID_FIRST_THRESHOLD:
       {
         if(m_DensityDistance==1)
@@ -511,6 +530,11 @@ void medPipeDensityDistance::OnEvent(mafEventBase *maf_event)
 	        m_DistanceFilter->SetDistanceModeToScalar();
 	        m_DistanceFilter->SetInputMatrix(surface_output->GetAbsMatrix()->GetVTKMatrix());
           m_DistanceFilter->Modified();
+          m_DistanceFieldFilter->SetSource(((mafVME*)m_Volume)->GetOutput()->GetVTKData());
+          m_DistanceFieldFilter->SetInput((vtkDataSet *)m_Normals->GetOutput());
+          m_DistanceFieldFilter->SetMaxDistance(m_MaxDistance);
+          m_DistanceFieldFilter->SetThreshold(m_FirstThreshold);
+          m_DistanceFieldFilter->SetInputMatrix(surface_output->GetAbsMatrix()->GetVTKMatrix());
 
 					int i;
 					for (i=-4*m_MaxDistance;i<-m_MaxDistance;i++)
@@ -520,18 +544,18 @@ void medPipeDensityDistance::OnEvent(mafEventBase *maf_event)
 					for (i=m_MaxDistance;i<=4*m_MaxDistance;i++)
 						m_Table->AddRGBPoint(i,m_HiColour.Red()/255.0, m_HiColour.Green()/255.0,	m_HiColour.Blue()/255.0);
 				  
-					m_Mapper->SetInput((vtkPolyData*)m_DistanceFilter->GetOutput());
+					m_Mapper->SetInput((vtkPolyData*)GetMapsFilter()->GetOutput());
 					m_Mapper->Modified();
 
 					//Calculate the areas
 					vtkMAFSmartPointer<vtkMassProperties> mass_all;
-					mass_all->SetInput(m_DistanceFilter->GetPolyDataOutput());
+					mass_all->SetInput(GetMapsFilter()->GetPolyDataOutput());
 					mass_all->Update();
 
 					double total_area = mass_all->GetSurfaceArea();
 
 					vtkMAFSmartPointer<vtkClipPolyData> clipHigh;
-					clipHigh->SetInput(m_DistanceFilter->GetPolyDataOutput());
+					clipHigh->SetInput(GetMapsFilter()->GetPolyDataOutput());
 					clipHigh->SetValue(m_MaxDistance);
 					clipHigh->GenerateClippedOutputOn();
 					clipHigh->Update();
@@ -565,6 +589,7 @@ void medPipeDensityDistance::OnEvent(mafEventBase *maf_event)
           m_Gui->Enable(ID_FIRST_THRESHOLD,true);
           m_Gui->Enable(ID_SECOND_THRESHOLD,true);
           m_Gui->Enable(ID_MAX_DISTANCE,true);
+          m_Gui->Enable(ID_USE_DISTANCE_FIELD,true);
 					m_Gui->Enable(ID_NUM_SECTIONS,true);
           m_Gui->Update();
           UpdatePipeline();
@@ -603,6 +628,26 @@ void medPipeDensityDistance::SetVolume(mafNode *volume)
   m_Volume=volume;
 }
 //----------------------------------------------------------------------------
+void medPipeDensityDistance::SetUseDistanceField(int useDistanceField)
+//----------------------------------------------------------------------------
+{
+  m_UseDistanceField = useDistanceField;
+
+  if(m_Mapper && m_Volume && m_EnableMAPSFilter)
+  {
+    m_Mapper->SetInput((vtkPolyData*)GetMapsFilter()->GetOutput());
+    UpdatePipeline();
+  }
+}
+//----------------------------------------------------------------------------
+vtkDataSetToDataSetFilter *medPipeDensityDistance::GetMapsFilter()
+//----------------------------------------------------------------------------
+{
+  if(m_UseDistanceField)
+    return m_DistanceFieldFilter;
+  return m_DistanceFilter;
+}
+//----------------------------------------------------------------------------
 void medPipeDensityDistance::UpdatePipeline()
 //----------------------------------------------------------------------------
 {
@@ -610,6 +655,7 @@ void medPipeDensityDistance::UpdatePipeline()
   {
     m_Table->RemoveAllPoints();
 	  m_DistanceFilter->SetThreshold(m_FirstThreshold);
+	  m_DistanceFieldFilter->SetThreshold(m_FirstThreshold);
 
     if(m_DensityDistance==0)
     {
@@ -620,10 +666,13 @@ void medPipeDensityDistance::UpdatePipeline()
       mafVMEOutputSurface *surface_output = mafVMEOutputSurface::SafeDownCast(m_Vme->GetOutput());
 
       m_DistanceFilter->SetInputMatrix(surface_output->GetAbsMatrix()->GetVTKMatrix());
+      m_DistanceFieldFilter->SetInputMatrix(surface_output->GetAbsMatrix()->GetVTKMatrix());
 
       m_DistanceFilter->SetFilterModeToDistance();
       m_DistanceFilter->SetMaxDistance(m_MaxDistance);
-		  m_DistanceFilter->Update();
+      m_DistanceFieldFilter->SetFilterModeToDistance();
+      m_DistanceFieldFilter->SetMaxDistance(m_MaxDistance);
+		  GetMapsFilter()->Update();
 
 		  /*double i;
 		  m_Table->AddRGBPoint(-m_DistanceFilter->GetMaxDistance(), 1.f, 0.f, 0.0f);
@@ -716,13 +765,13 @@ void medPipeDensityDistance::UpdatePipeline()
 
 		  //Calculate the areas
 		  vtkMAFSmartPointer<vtkMassProperties> mass_all;
-		  mass_all->SetInput(m_DistanceFilter->GetPolyDataOutput());
+		  mass_all->SetInput(GetMapsFilter()->GetPolyDataOutput());
 		  mass_all->Update();
 
 		  double total_area = mass_all->GetSurfaceArea();
 
 		  vtkMAFSmartPointer<vtkClipPolyData> clipHigh;
-		  clipHigh->SetInput(m_DistanceFilter->GetPolyDataOutput());
+		  clipHigh->SetInput(GetMapsFilter()->GetPolyDataOutput());
 		  clipHigh->SetValue(m_MaxDistance);
 		  clipHigh->GenerateClippedOutputOn();
 		  clipHigh->Update();
@@ -760,9 +809,11 @@ void medPipeDensityDistance::UpdatePipeline()
 
       mafVMEOutputSurface *surface_output = mafVMEOutputSurface::SafeDownCast(m_Vme->GetOutput());
       m_DistanceFilter->SetInputMatrix(surface_output->GetAbsMatrix()->GetVTKMatrix());
+      m_DistanceFieldFilter->SetInputMatrix(surface_output->GetAbsMatrix()->GetVTKMatrix());
 
       m_DistanceFilter->SetFilterModeToDensity();
-		  m_DistanceFilter->Update();
+      m_DistanceFieldFilter->SetFilterModeToDensity();
+		  GetMapsFilter()->Update();
 
 		  double range[2];
 		  ((mafVME*)m_Volume)->GetOutput()->GetVTKData()->GetScalarRange(range);
@@ -795,13 +846,13 @@ void medPipeDensityDistance::UpdatePipeline()
 
 		  //Calculate the areas
 		  vtkMAFSmartPointer<vtkMassProperties> mass_all;
-		  mass_all->SetInput(m_DistanceFilter->GetPolyDataOutput());
+		  mass_all->SetInput(GetMapsFilter()->GetPolyDataOutput());
 		  mass_all->Update();
 
 		  double total_area = mass_all->GetSurfaceArea();
 
 		  vtkMAFSmartPointer<vtkClipPolyData> clipHigh;
-		  clipHigh->SetInput(m_DistanceFilter->GetPolyDataOutput());
+		  clipHigh->SetInput(GetMapsFilter()->GetPolyDataOutput());
 		  clipHigh->SetValue(m_FirstThreshold);
 		  clipHigh->GenerateClippedOutputOn();
 		  clipHigh->Update();
@@ -843,7 +894,7 @@ double medPipeDensityDistance::GetTotalArea()
 {
   //Calculate the areas
   vtkMAFSmartPointer<vtkMassProperties> mass_all;
-  mass_all->SetInput(m_DistanceFilter->GetPolyDataOutput());
+  mass_all->SetInput(GetMapsFilter()->GetPolyDataOutput());
   mass_all->Update();
 
   return mass_all->GetSurfaceArea();
@@ -861,7 +912,7 @@ void medPipeDensityDistance::EnableMAPSFilterOff()
 void medPipeDensityDistance::EnableMAPSFilterOn()
 //----------------------------------------------------------------------------
 {
-  m_Mapper->SetInput((vtkPolyData*)m_DistanceFilter->GetOutput());
+  m_Mapper->SetInput((vtkPolyData*)GetMapsFilter()->GetOutput());
   m_Mapper->Update();
   m_EnableMAPSFilter=true;
   mafEventMacro(mafEvent(this,CAMERA_UPDATE));
@@ -26,6 +26,7 @@
 #include "mafVMEVolume.h"
 #include "vtkPolyDataNormals.h"
 #include "vtkMAFDistanceFilter.h"
+#include "vtkMEDDistanceFieldFilter.h"
 #include "vtkPolyDataMapper.h"
 
 //----------------------------------------------------------------------------
@@ -70,6 +71,11 @@ public:
   void SetSecondThreshold(int secondThreshold){m_SecondThreshold=secondThreshold;UpdatePipeline();};
   void SetMaxDistance(int maxDistance){m_MaxDistance=maxDistance;UpdatePipeline();};
 
+  /** Read distances and densities from a cached distance transform of the volume (vtkMEDDistanceFieldFilter)
+  instead of casting rays from the vertices of the surface (vtkMAFDistanceFilter) */
+  void SetUseDistanceField(int useDistanceField);
+  int GetUseDistanceField(){return m_UseDistanceField;};
+
   void EnableMAPSFilterOff();
   void EnableMAPSFilterOn();
   void EnableMAPSFilter(bool enable);
@@ -92,6 +98,7 @@ public:
 		ID_BAR_TIPOLOGY,
 		ID_AREA,
 		ID_AREA_DISTANCE,
+    ID_USE_DISTANCE_FIELD,
     ID_LAST
   };
 
@@ -108,6 +115,7 @@ protected:
 
   vtkPolyDataNormals      *m_Normals;
   vtkMAFDistanceFilter       *m_DistanceFilter;
+  vtkMEDDistanceFieldFilter  *m_DistanceFieldFilter;
   vtkColorTransferFunction *m_Table;
   vtkScalarBarActor       *m_ScalarBar;
   mafNode                 *m_Volume;
@@ -119,6 +127,7 @@ protected:
   int m_SecondThreshold;
   int m_MaxDistance;
 	int m_BarTipology;
+  int m_UseDistanceField;
 
 	double m_Area[3];
 	double m_AreaDistance[3];
@@ -138,6 +147,9 @@ protected:
   Generate texture coordinate for polydata according to the mapping mode*/
   void GenerateTextureMapCoordinate();
 
+  /** Return the filter computing distances and densities (m_DistanceFieldFilter or m_DistanceFilter) */
+  vtkDataSetToDataSetFilter *GetMapsFilter();
+
   virtual mafGUI  *CreateGui();
 };  
 #endif // __mafPipeSurface_H__
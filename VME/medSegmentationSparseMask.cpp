@@ -0,0 +1,587 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: medSegmentationSparseMask
+
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "medDefines.h"
+//----------------------------------------------------------------------------
+// NOTE: Every CPP file in the MAF must include "mafDefines.h" as first.
+// This force to include Window,wxWidgets and VTK exactly in this order.
+// Failing in doing this will result in a run-time error saying:
+// "Failure#0: The value of ESP was not properly saved across a function call"
+//----------------------------------------------------------------------------
+
+#include "medSegmentationSparseMask.h"
+
+#include <string.h>
+
+//----------------------------------------------------------------------------
+// constants :
+//----------------------------------------------------------------------------
+const int TILE_POINTS = medSegmentationSparseMask::TILE_SIZE * medSegmentationSparseMask::TILE_SIZE * medSegmentationSparseMask::TILE_SIZE;
+
+//----------------------------------------------------------------------------
+medSegmentationSparseMask::medSegmentationSparseMask()
+//----------------------------------------------------------------------------
+{
+  m_Dimensions[0] = m_Dimensions[1] = m_Dimensions[2] = 0;
+  m_NumberOfTiles[0] = m_NumberOfTiles[1] = m_NumberOfTiles[2] = 0;
+}
+//----------------------------------------------------------------------------
+medSegmentationSparseMask::~medSegmentationSparseMask()
+//----------------------------------------------------------------------------
+{
+  ReleaseTiles();
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMask::ReleaseTiles()
+//----------------------------------------------------------------------------
+{
+  for (int t = 0; t < m_Tiles.size(); t++)
+  {
+    delete []m_Tiles[t];
+  }
+  m_Tiles.clear();
+  m_States.clear();
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMask::SetDimensions(const int dims[3])
+//----------------------------------------------------------------------------
+{
+  ReleaseTiles();
+
+  for (int i = 0; i < 3; i++)
+  {
+    m_Dimensions[i] = dims[i] > 0 ? dims[i] : 0;
+    m_NumberOfTiles[i] = (m_Dimensions[i] + TILE_SIZE - 1) / TILE_SIZE;
+  }
+
+  int nTiles = m_NumberOfTiles[0] * m_NumberOfTiles[1] * m_NumberOfTiles[2];
+  m_States.assign(nTiles, EMPTY_TILE);
+  m_Tiles.assign(nTiles, (unsigned char *)NULL);
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMask::GetDimensions(int dims[3])
+//----------------------------------------------------------------------------
+{
+  dims[0] = m_Dimensions[0];
+  dims[1] = m_Dimensions[1];
+  dims[2] = m_Dimensions[2];
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMask::GetNumberOfTiles(int nTiles[3])
+//----------------------------------------------------------------------------
+{
+  nTiles[0] = m_NumberOfTiles[0];
+  nTiles[1] = m_NumberOfTiles[1];
+  nTiles[2] = m_NumberOfTiles[2];
+}
+//----------------------------------------------------------------------------
+int medSegmentationSparseMask::GetNumberOfTiles(int state)
+//----------------------------------------------------------------------------
+{
+  int n = 0;
+  for (int t = 0; t < m_States.size(); t++)
+  {
+    if (m_States[t] == state)
+      n++;
+  }
+  return n;
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMask::GetTileBox(int t, int box[6])
+//----------------------------------------------------------------------------
+{
+  int ti = t % m_NumberOfTiles[0];
+  int tj = (t / m_NumberOfTiles[0]) % m_NumberOfTiles[1];
+  int tk = t / (m_NumberOfTiles[0] * m_NumberOfTiles[1]);
+  int tileIndex[3] = {ti, tj, tk};
+
+  for (int i = 0; i < 3; i++)
+  {
+    box[2*i] = tileIndex[i] * TILE_SIZE;
+    box[2*i + 1] = box[2*i] + TILE_SIZE - 1;
+    if (box[2*i + 1] > m_Dimensions[i] - 1)
+      box[2*i + 1] = m_Dimensions[i] - 1;
+  }
+}
+//----------------------------------------------------------------------------
+unsigned char *medSegmentationSparseMask::MakeDense(int t)
+//----------------------------------------------------------------------------
+{
+  if (m_States[t] != DENSE_TILE)
+  {
+    unsigned char *values = new unsigned char[TILE_POINTS];
+    memset(values, m_States[t] == FULL_TILE ? 255 : 0, TILE_POINTS);
+    m_Tiles[t] = values;
+    m_States[t] = DENSE_TILE;
+  }
+  return m_Tiles[t];
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMask::SetUniform(int t, int state)
+//----------------------------------------------------------------------------
+{
+  delete []m_Tiles[t];
+  m_Tiles[t] = NULL;
+  m_States[t] = state;
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMask::SqueezeTile(int t)
+//----------------------------------------------------------------------------
+{
+  if (m_States[t] != DENSE_TILE)
+    return;
+
+  // only the points inside the volume are checked, border tiles are partially used
+  int box[6];
+  GetTileBox(t, box);
+  const unsigned char *values = m_Tiles[t];
+  unsigned char first = values[0];
+  int rowLength = box[1] - box[0] + 1;
+
+  for (int k = 0; k <= box[5] - box[4]; k++)
+  {
+    for (int j = 0; j <= box[3] - box[2]; j++)
+    {
+      const unsigned char *row = values + TILE_SIZE * (j + TILE_SIZE * k);
+      for (int i = 0; i < rowLength; i++)
+      {
+        if (row[i] != first)
+          return;
+      }
+    }
+  }
+
+  SetUniform(t, first ? FULL_TILE : EMPTY_TILE);
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMask::Squeeze(int startSlice, int endSlice)
+//----------------------------------------------------------------------------
+{
+  if (endSlice < 0 || endSlice > m_Dimensions[2] - 1)
+    endSlice = m_Dimensions[2] - 1;
+  if (startSlice < 0)
+    startSlice = 0;
+  if (startSlice > endSlice)
+    return;
+
+  int slabSize = m_NumberOfTiles[0] * m_NumberOfTiles[1];
+  for (int t = slabSize * (startSlice / TILE_SIZE); t < slabSize * (endSlice / TILE_SIZE + 1); t++)
+  {
+    SqueezeTile(t);
+  }
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMask::Fill(unsigned char value)
+//----------------------------------------------------------------------------
+{
+  for (int t = 0; t < m_States.size(); t++)
+  {
+    SetUniform(t, value ? FULL_TILE : EMPTY_TILE);
+  }
+}
+//----------------------------------------------------------------------------
+unsigned char medSegmentationSparseMask::GetValue(int i, int j, int k)
+//----------------------------------------------------------------------------
+{
+  int t = GetTileIndex(i, j, k);
+  switch (m_States[t])
+  {
+    case EMPTY_TILE:
+      return 0;
+    case FULL_TILE:
+      return 255;
+    default:
+      return m_Tiles[t][GetTileOffset(i, j, k)];
+  }
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMask::SetValue(int i, int j, int k, unsigned char value)
+//----------------------------------------------------------------------------
+{
+  int t = GetTileIndex(i, j, k);
+  value = value ? 255 : 0;
+  if ((m_States[t] == EMPTY_TILE && value == 0) || (m_States[t] == FULL_TILE && value == 255))
+    return;
+
+  MakeDense(t)[GetTileOffset(i, j, k)] = value;
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMask::SetSlice(int k, const unsigned char *values)
+//----------------------------------------------------------------------------
+{
+  int tk = k / TILE_SIZE;
+  int sliceOffset = TILE_SIZE * TILE_SIZE * (k % TILE_SIZE);
+  bool lastSliceOfTile = (k % TILE_SIZE) == TILE_SIZE - 1 || k == m_Dimensions[2] - 1;
+
+  for (int tj = 0; tj < m_NumberOfTiles[1]; tj++)
+  {
+    for (int ti = 0; ti < m_NumberOfTiles[0]; ti++)
+    {
+      int t = ti + m_NumberOfTiles[0] * (tj + m_NumberOfTiles[1] * tk);
+      int i0 = ti * TILE_SIZE, j0 = tj * TILE_SIZE;
+      int i1 = i0 + TILE_SIZE > m_Dimensions[0] ? m_Dimensions[0] : i0 + TILE_SIZE;
+      int j1 = j0 + TILE_SIZE > m_Dimensions[1] ? m_Dimensions[1] : j0 + TILE_SIZE;
+
+      // a uniform tile stays uniform if the slice has its value
+      if (m_States[t] != DENSE_TILE)
+      {
+        bool uniform = true;
+        unsigned char tileValue = m_States[t] == FULL_TILE ? 255 : 0;
+        for (int j = j0; j < j1 && uniform; j++)
+        {
+          const unsigned char *row = values + j * m_Dimensions[0];
+          for (int i = i0; i < i1; i++)
+          {
+            if ((row[i] ? 255 : 0) != tileValue)
+            {
+              uniform = false;
+              break;
+            }
+          }
+        }
+        if (uniform)
+          continue;
+      }
+
+      unsigned char *tile = MakeDense(t) + sliceOffset;
+      for (int j = j0; j < j1; j++)
+      {
+        const unsigned char *row = values + j * m_Dimensions[0];
+        unsigned char *tileRow = tile + TILE_SIZE * (j - j0);
+        for (int i = i0; i < i1; i++)
+        {
+          tileRow[i - i0] = row[i] ? 255 : 0;
+        }
+      }
+    }
+  }
+
+  if (lastSliceOfTile)
+  {
+    int first = m_NumberOfTiles[0] * m_NumberOfTiles[1] * tk;
+    for (int t = first; t < first + m_NumberOfTiles[0] * m_NumberOfTiles[1]; t++)
+    {
+      SqueezeTile(t);
+    }
+  }
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMask::GetSlice(int k, unsigned char *values)
+//----------------------------------------------------------------------------
+{
+  int tk = k / TILE_SIZE;
+  int sliceOffset = TILE_SIZE * TILE_SIZE * (k % TILE_SIZE);
+
+  for (int tj = 0; tj < m_NumberOfTiles[1]; tj++)
+  {
+    for (int ti = 0; ti < m_NumberOfTiles[0]; ti++)
+    {
+      int t = ti + m_NumberOfTiles[0] * (tj + m_NumberOfTiles[1] * tk);
+      int i0 = ti * TILE_SIZE, j0 = tj * TILE_SIZE;
+      int i1 = i0 + TILE_SIZE > m_Dimensions[0] ? m_Dimensions[0] : i0 + TILE_SIZE;
+      int j1 = j0 + TILE_SIZE > m_Dimensions[1] ? m_Dimensions[1] : j0 + TILE_SIZE;
+
+      for (int j = j0; j < j1; j++)
+      {
+        unsigned char *row = values + j * m_Dimensions[0] + i0;
+        if (m_States[t] == DENSE_TILE)
+          memcpy(row, m_Tiles[t] + sliceOffset + TILE_SIZE * (j - j0), i1 - i0);
+        else
+          memset(row, m_States[t] == FULL_TILE ? 255 : 0, i1 - i0);
+      }
+    }
+  }
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMask::SetExtent(const int extent[6], const unsigned char *values)
+//----------------------------------------------------------------------------
+{
+  const int width = extent[1] - extent[0] + 1;
+  const int height = extent[3] - extent[2] + 1;
+
+  for (int tk = extent[4] / TILE_SIZE; tk <= extent[5] / TILE_SIZE; tk++)
+  {
+    for (int tj = extent[2] / TILE_SIZE; tj <= extent[3] / TILE_SIZE; tj++)
+    {
+      for (int ti = extent[0] / TILE_SIZE; ti <= extent[1] / TILE_SIZE; ti++)
+      {
+        int t = ti + m_NumberOfTiles[0] * (tj + m_NumberOfTiles[1] * tk);
+
+        // part of the tile inside the box
+        int box[6];
+        GetTileBox(t, box);
+        for (int i = 0; i < 3; i++)
+        {
+          if (box[2*i] < extent[2*i])
+            box[2*i] = extent[2*i];
+          if (box[2*i + 1] > extent[2*i + 1])
+            box[2*i + 1] = extent[2*i + 1];
+        }
+
+        // a uniform tile stays uniform if the box has its value
+        if (m_States[t] != DENSE_TILE)
+        {
+          bool uniform = true;
+          unsigned char tileValue = m_States[t] == FULL_TILE ? 255 : 0;
+          for (int k = box[4]; k <= box[5] && uniform; k++)
+          {
+            for (int j = box[2]; j <= box[3] && uniform; j++)
+            {
+              const unsigned char *row = values + (j - extent[2]) * width + (k - extent[4]) * width * height - extent[0];
+              for (int i = box[0]; i <= box[1]; i++)
+              {
+                if ((row[i] ? 255 : 0) != tileValue)
+                {
+                  uniform = false;
+                  break;
+                }
+              }
+            }
+          }
+          if (uniform)
+            continue;
+        }
+
+        unsigned char *tile = MakeDense(t);
+        for (int k = box[4]; k <= box[5]; k++)
+        {
+          for (int j = box[2]; j <= box[3]; j++)
+          {
+            const unsigned char *row = values + (j - extent[2]) * width + (k - extent[4]) * width * height - extent[0];
+            unsigned char *tileRow = tile + GetTileOffset(0, j, k);
+            for (int i = box[0]; i <= box[1]; i++)
+            {
+              tileRow[i % TILE_SIZE] = row[i] ? 255 : 0;
+            }
+          }
+        }
+        SqueezeTile(t);
+      }
+    }
+  }
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMask::GetExtent(const int extent[6], unsigned char *values)
+//----------------------------------------------------------------------------
+{
+  const int width = extent[1] - extent[0] + 1;
+  const int height = extent[3] - extent[2] + 1;
+
+  for (int k = extent[4]; k <= extent[5]; k++)
+  {
+    for (int j = extent[2]; j <= extent[3]; j++)
+    {
+      unsigned char *row = values + (j - extent[2]) * width + (k - extent[4]) * width * height;
+
+      // the row is copied in runs, one for each tile it crosses
+      for (int i0 = extent[0]; i0 <= extent[1]; )
+      {
+        int i1 = (i0 / TILE_SIZE + 1) * TILE_SIZE - 1;
+        if (i1 > extent[1])
+          i1 = extent[1];
+
+        int t = GetTileIndex(i0, j, k);
+        if (m_States[t] == DENSE_TILE)
+          memcpy(row + i0 - extent[0], m_Tiles[t] + GetTileOffset(i0, j, k), i1 - i0 + 1);
+        else
+          memset(row + i0 - extent[0], m_States[t] == FULL_TILE ? 255 : 0, i1 - i0 + 1);
+
+        i0 = i1 + 1;
+      }
+    }
+  }
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMask::SetArray(const unsigned char *values)
+//----------------------------------------------------------------------------
+{
+  Fill(0);
+
+  int sliceSize = m_Dimensions[0] * m_Dimensions[1];
+  for (int k = 0; k < m_Dimensions[2]; k++)
+  {
+    SetSlice(k, values + k * sliceSize);
+  }
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMask::GetArray(unsigned char *values)
+//----------------------------------------------------------------------------
+{
+  int sliceSize = m_Dimensions[0] * m_Dimensions[1];
+  for (int k = 0; k < m_Dimensions[2]; k++)
+  {
+    GetSlice(k, values + k * sliceSize);
+  }
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMask::DeepCopy(medSegmentationSparseMask *mask)
+//----------------------------------------------------------------------------
+{
+  if (mask == this)
+    return;
+
+  SetDimensions(mask->m_Dimensions);
+  for (int t = 0; t < m_States.size(); t++)
+  {
+    m_States[t] = mask->m_States[t];
+    if (m_States[t] == DENSE_TILE)
+    {
+      m_Tiles[t] = new unsigned char[TILE_POINTS];
+      memcpy(m_Tiles[t], mask->m_Tiles[t], TILE_POINTS);
+    }
+  }
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMask::Or(medSegmentationSparseMask *mask, int startSlice, int endSlice)
+//----------------------------------------------------------------------------
+{
+  if (mask->m_States.size() != m_States.size())
+    return;
+
+  if (endSlice < 0 || endSlice > m_Dimensions[2] - 1)
+    endSlice = m_Dimensions[2] - 1;
+  if (startSlice < 0)
+    startSlice = 0;
+
+  for (int t = 0; t < m_States.size(); t++)
+  {
+    // nothing to add or nothing that can change
+    if (mask->m_States[t] == EMPTY_TILE || m_States[t] == FULL_TILE)
+      continue;
+
+    int box[6];
+    GetTileBox(t, box);
+    if (box[5] < startSlice || box[4] > endSlice)
+      continue;
+
+    bool wholeTile = box[4] >= startSlice && box[5] <= endSlice;
+    if (wholeTile && mask->m_States[t] == FULL_TILE)
+    {
+      SetUniform(t, FULL_TILE);
+      continue;
+    }
+
+    // OR of the slices of the tile inside the range
+    int k0 = (startSlice > box[4] ? startSlice : box[4]) - box[4];
+    int k1 = (endSlice < box[5] ? endSlice : box[5]) - box[4];
+    unsigned char *values = MakeDense(t);
+    for (int k = k0; k <= k1; k++)
+    {
+      unsigned char *slice = values + TILE_SIZE * TILE_SIZE * k;
+      if (mask->m_States[t] == FULL_TILE)
+      {
+        memset(slice, 255, TILE_SIZE * TILE_SIZE);
+      }
+      else
+      {
+        const unsigned char *maskSlice = mask->m_Tiles[t] + TILE_SIZE * TILE_SIZE * k;
+        for (int p = 0; p < TILE_SIZE * TILE_SIZE; p++)
+        {
+          slice[p] |= maskSlice[p];
+        }
+      }
+    }
+    SqueezeTile(t);
+  }
+}
+//----------------------------------------------------------------------------
+void medSegmentationSparseMask::Xor(medSegmentationSparseMask *mask)
+//----------------------------------------------------------------------------
+{
+  if (mask->m_States.size() != m_States.size())
+    return;
+
+  for (int t = 0; t < m_States.size(); t++)
+  {
+    if (mask->m_States[t] == EMPTY_TILE)
+      continue;
+
+    if (mask->m_States[t] == FULL_TILE)
+    {
+      // the tile is inverted
+      if (m_States[t] == EMPTY_TILE)
+      {
+        m_States[t] = FULL_TILE;
+      }
+      else if (m_States[t] == FULL_TILE)
+      {
+        m_States[t] = EMPTY_TILE;
+      }
+      else
+      {
+        unsigned char *values = m_Tiles[t];
+        for (int p = 0; p < TILE_POINTS; p++)
+        {
+          values[p] = ~values[p];
+        }
+        SqueezeTile(t);
+      }
+      continue;
+    }
+
+    unsigned char *values = MakeDense(t);
+    const unsigned char *maskValues = mask->m_Tiles[t];
+    for (int p = 0; p < TILE_POINTS; p++)
+    {
+      values[p] ^= maskValues[p];
+    }
+    SqueezeTile(t);
+  }
+}
+//----------------------------------------------------------------------------
+int medSegmentationSparseMask::GetNumberOfSetPoints()
+//----------------------------------------------------------------------------
+{
+  int n = 0;
+  for (int t = 0; t < m_States.size(); t++)
+  {
+    if (m_States[t] == EMPTY_TILE)
+      continue;
+
+    int box[6];
+    GetTileBox(t, box);
+    if (m_States[t] == FULL_TILE)
+    {
+      n += (box[1] - box[0] + 1) * (box[3] - box[2] + 1) * (box[5] - box[4] + 1);
+      continue;
+    }
+
+    for (int k = 0; k <= box[5] - box[4]; k++)
+    {
+      for (int j = 0; j <= box[3] - box[2]; j++)
+      {
+        const unsigned char *row = m_Tiles[t] + TILE_SIZE * (j + TILE_SIZE * k);
+        for (int i = 0; i <= box[1] - box[0]; i++)
+        {
+          if (row[i])
+            n++;
+        }
+      }
+    }
+  }
+  return n;
+}
+//----------------------------------------------------------------------------
+unsigned long medSegmentationSparseMask::GetMemorySize()
+//----------------------------------------------------------------------------
+{
+  unsigned long size = m_States.size() * (sizeof(unsigned char) + sizeof(unsigned char *));
+  for (int t = 0; t < m_States.size(); t++)
+  {
+    if (m_States[t] == DENSE_TILE)
+      size += TILE_POINTS;
+  }
+  return size;
+}
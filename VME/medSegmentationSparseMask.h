@@ -0,0 +1,166 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: medSegmentationSparseMask
+
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __medSegmentationSparseMask_h
+#define __medSegmentationSparseMask_h
+
+//----------------------------------------------------------------------------
+// Include:
+//----------------------------------------------------------------------------
+#include "medVMEDefines.h"
+#include <vector>
+
+/**
+  class name: medSegmentationSparseMask
+  Binary mask of a segmentation volume (values 0 and 255) stored in 16x16x16 tiles.
+
+  A tile is EMPTY_TILE (all 0) or FULL_TILE (all 255) without any memory, only DENSE_TILE tiles
+  keep their values, so the memory of a segmentation is proportional to the surface of the
+  segmented objects rather than to the volume. Logical operations between masks work tile by tile
+  and skip the tiles that cannot change. Dense values are written only when a dense buffer is
+  requested by GetArray, GetSlice or GetExtent, e.g. for a VTK consumer.
+
+  Points are indexed as in vtkImageData: i + j*dims[0] + k*dims[0]*dims[1]. Any value other than 0
+  written in the mask is stored as 255.
+*/
+class MED_VME_EXPORT medSegmentationSparseMask
+{
+public:
+
+  /** constructor */
+  medSegmentationSparseMask();
+
+  /** destructor */
+  ~medSegmentationSparseMask();
+
+  /** Side of the cubic tiles */
+  enum {TILE_SIZE = 16};
+
+  /** State of a tile */
+  enum TILE_STATE
+  {
+    EMPTY_TILE = 0,
+    FULL_TILE,
+    DENSE_TILE,
+  };
+
+  /** Set the dimensions of the mask, the mask becomes empty */
+  void SetDimensions(const int dims[3]);
+
+  /** Get the dimensions of the mask */
+  void GetDimensions(int dims[3]);
+
+  /** Return the number of points of the mask */
+  int GetNumberOfPoints() {return m_Dimensions[0]*m_Dimensions[1]*m_Dimensions[2];};
+
+  /** Return the number of tiles along x, y and z */
+  void GetNumberOfTiles(int nTiles[3]);
+
+  /** Return the number of tiles */
+  int GetNumberOfTiles() {return (int)m_States.size();};
+
+  /** Return the state of the tile t */
+  int GetTileState(int t) {return m_States[t];};
+
+  /** Return the number of tiles in the state */
+  int GetNumberOfTiles(int state);
+
+  /** Set all the points of the mask to value */
+  void Fill(unsigned char value);
+
+  /** Return the value of the point i,j,k */
+  unsigned char GetValue(int i, int j, int k);
+
+  /** Set the value of the point i,j,k */
+  void SetValue(int i, int j, int k, unsigned char value);
+
+  /** Copy the dense values of the volume (as many as the points of the mask) in the mask */
+  void SetArray(const unsigned char *values);
+
+  /** Write the values of the mask in the dense buffer values (as many as the points of the mask) */
+  void GetArray(unsigned char *values);
+
+  /** Copy the dense values of the slice k (dims[0]*dims[1] values) in the mask. Tiles are compacted
+      when their last slice is set, so filling the mask slice by slice keeps dense only a slab of tiles.
+      Slices of different slabs of TILE_SIZE slices can be set by different threads at the same time. */
+  void SetSlice(int k, const unsigned char *values);
+
+  /** Write the values of the slice k of the mask in the dense buffer values (dims[0]*dims[1] values) */
+  void GetSlice(int k, unsigned char *values);
+
+  /** Copy the dense values of the box extent (xmin,xmax,ymin,ymax,zmin,zmax, x fastest) in the mask.
+      Only the tiles crossed by the box are touched and they are compacted, so editing a slice of any
+      plane costs a time proportional to the slice. */
+  void SetExtent(const int extent[6], const unsigned char *values);
+
+  /** Write the values of the box extent (xmin,xmax,ymin,ymax,zmin,zmax) of the mask in the dense buffer values, x fastest */
+  void GetExtent(const int extent[6], unsigned char *values);
+
+  /** Make this mask a copy of mask */
+  void DeepCopy(medSegmentationSparseMask *mask);
+
+  /** Set to 255 the points of this mask that are 255 in mask, only for the slices from startSlice
+      to endSlice (endSlice -1 is the last slice). Masks must have the same dimensions. */
+  void Or(medSegmentationSparseMask *mask, int startSlice = 0, int endSlice = -1);
+
+  /** Invert the points of this mask that are 255 in mask. Masks must have the same dimensions. */
+  void Xor(medSegmentationSparseMask *mask);
+
+  /** Convert to EMPTY_TILE or FULL_TILE the dense tiles with uniform values, only for the tiles
+      of the slices from startSlice to endSlice (endSlice -1 is the last slice) */
+  void Squeeze(int startSlice = 0, int endSlice = -1);
+
+  /** Return the number of points set to 255 */
+  int GetNumberOfSetPoints();
+
+  /** Return the number of bytes used by the mask */
+  unsigned long GetMemorySize();
+
+protected:
+
+  /** Return the index of the tile of the point i,j,k */
+  int GetTileIndex(int i, int j, int k) {return i/TILE_SIZE + m_NumberOfTiles[0]*(j/TILE_SIZE + m_NumberOfTiles[1]*(k/TILE_SIZE));};
+
+  /** Return the offset of the point i,j,k in its tile */
+  static int GetTileOffset(int i, int j, int k) {return (i%TILE_SIZE) + TILE_SIZE*((j%TILE_SIZE) + TILE_SIZE*(k%TILE_SIZE));};
+
+  /** Get the box (point indexes) of the tile t */
+  void GetTileBox(int t, int box[6]);
+
+  /** Allocate the values of the tile t filled with its uniform value and make it dense */
+  unsigned char *MakeDense(int t);
+
+  /** Make the tile t uniform with the state EMPTY_TILE or FULL_TILE */
+  void SetUniform(int t, int state);
+
+  /** Make the tile t uniform if all its points have the same value */
+  void SqueezeTile(int t);
+
+  /** Free all tiles */
+  void ReleaseTiles();
+
+  int m_Dimensions[3];
+  int m_NumberOfTiles[3];
+
+  std::vector<unsigned char> m_States;  //< TILE_STATE of the tiles
+  std::vector<unsigned char *> m_Tiles; //< TILE_SIZE^3 values of dense tiles, NULL for uniform tiles
+
+private:
+  /** Not implemented */
+  medSegmentationSparseMask(const medSegmentationSparseMask&);
+  /** Not implemented */
+  void operator=(const medSegmentationSparseMask&);
+};
+#endif
@@ -63,9 +63,13 @@
 #include "vtkDataSet.h"
 #include "vtkRenderer.h"
 #include "vtkRenderWindow.h"
+#include "vtkDataArray.h"
+#include "vtkMultiThreader.h"
 
 #include <list>
 #include <vector>
+#include <algorithm>
+#include <limits>
 
 #define OUTRANGE_SCALAR -1000
 
@@ -103,6 +107,11 @@ medVMELabeledVolume::medVMELabeledVolume()
   m_SMapper = NULL;
   m_ActorSlice = NULL;  
 
+  m_LabeledScalars = NULL;
+  m_LabeledScalarsMTime = 0;
+  m_LabelSourceScalars = NULL;
+  m_LabelSourceScalarsMTime = 0;
+
   m_LabelNameValue = wxEmptyString;
   m_LabelValueValue = wxEmptyString;
 
@@ -319,107 +328,329 @@ void medVMELabeledVolume::UpdateScalars()
 }
 
 //-------------------------------------------------------------------------
-void medVMELabeledVolume::GenerateLabeledVolume()
+// Checked labels: a scalar takes the value of the last label whose range contains it
+typedef struct LV_LABELS
+{
+  std::vector<int> Values;
+  std::vector<int> Min;
+  std::vector<int> Max;
+} LV_LABELS;
+
 //-------------------------------------------------------------------------
+// Sorted table of the bounds of the label ranges: a scalar equal to Bounds[i] takes PointLabels[i],
+// a scalar between Bounds[i-1] and Bounds[i] takes GapLabels[i]
+typedef struct LV_INTERVALS
 {
-  UpdateScalars();
+  std::vector<double> Bounds;
+  std::vector<double> PointLabels;
+  std::vector<double> GapLabels;
+} LV_INTERVALS;
 
-  if (m_VolumeLink)
+//-------------------------------------------------------------------------
+// Returns the label of the scalar value
+static double LV_GetLabel(const LV_LABELS &labels, double value)
+//-------------------------------------------------------------------------
+{
+  for (int c = (int)labels.Values.size() - 1; c >= 0; c--)
   {
-    vtkDataArray *labelScalars;
-    vtkDataArray *volumeScalars;
-
-    if ( m_Dataset->IsA( "vtkStructuredPoints" ) )
+    if (value >= labels.Min[c] && value <= labels.Max[c])
     {
-      vtkStructuredPoints *sp = (vtkStructuredPoints*) m_Dataset;
-      labelScalars = sp->GetPointData()->GetScalars();
-      volumeScalars = sp->GetPointData()->GetScalars();  
+      return labels.Values[c];
     }
-    else if ( m_Dataset->IsA( "vtkRectilinearGrid" ) )
-    {    
-      vtkRectilinearGrid *rg = (vtkRectilinearGrid*) m_Dataset;
-      labelScalars = rg->GetPointData()->GetScalars();
-      volumeScalars = rg->GetPointData()->GetScalars();  
+  }
+  return OUTRANGE_SCALAR;
+}
+
+//-------------------------------------------------------------------------
+// Builds the interval table of the labels
+static void LV_BuildIntervals(const LV_LABELS &labels, LV_INTERVALS &intervals)
+//-------------------------------------------------------------------------
+{
+  intervals.Bounds.clear();
+  for (int c = 0; c < labels.Values.size(); c++)
+  {
+    intervals.Bounds.push_back(labels.Min[c]);
+    intervals.Bounds.push_back(labels.Max[c]);
+  }
+  std::sort(intervals.Bounds.begin(), intervals.Bounds.end());
+  intervals.Bounds.erase(std::unique(intervals.Bounds.begin(), intervals.Bounds.end()), intervals.Bounds.end());
+
+  int nBounds = intervals.Bounds.size();
+  intervals.PointLabels.resize(nBounds);
+  intervals.GapLabels.resize(nBounds + 1);
+  intervals.GapLabels[0] = OUTRANGE_SCALAR;
+  intervals.GapLabels[nBounds] = OUTRANGE_SCALAR;
+  for (int i = 0; i < nBounds; i++)
+  {
+    intervals.PointLabels[i] = LV_GetLabel(labels, intervals.Bounds[i]);
+    if (i > 0)
+    {
+      // label bounds are integers, so the label is constant between two bounds
+      intervals.GapLabels[i] = LV_GetLabel(labels, 0.5*(intervals.Bounds[i - 1] + intervals.Bounds[i]));
     }
-    int numberC = m_TagLabel->GetNumberOfComponents();
-    bool lastComponent = false;
-    int numberChecked = 0;
+  }
+}
+
+//-------------------------------------------------------------------------
+// Returns the label of the scalar value searching the interval table
+static inline double LV_LookUp(const LV_INTERVALS &intervals, double value)
+//-------------------------------------------------------------------------
+{
+  int i = std::lower_bound(intervals.Bounds.begin(), intervals.Bounds.end(), value) - intervals.Bounds.begin();
+  if (i < intervals.Bounds.size() && intervals.Bounds[i] == value)
+  {
+    return intervals.PointLabels[i];
+  }
+  return intervals.GapLabels[i];
+}
+
+//-------------------------------------------------------------------------
+// Converts the label to the scalar type, integer types wrap like the integer conversions
+template <class T>
+static inline T LV_Cast(double label)
+//-------------------------------------------------------------------------
+{
+  if (std::numeric_limits<T>::is_integer)
+  {
+    return static_cast<T>((vtkIdType)label);
+  }
+  return static_cast<T>(label);
+}
 
-    std::vector<int> minVector;
-    std::vector<int> maxVector;
-    std::vector<int> labelIntVector;
+//-------------------------------------------------------------------------
+// Mapping of volume scalars of type T to labels
+template <class T>
+struct LV_JOB
+{
+  const T *Source;
+  T *Labels;
+  vtkIdType NumberOfValues;
+  const T *Lut;                   // label of each value from LutMin, NULL to use Intervals
+  vtkIdType LutMin;
+  vtkIdType LutSize;
+  const LV_INTERVALS *Intervals;
+};
 
-    int counter= 0;
-    //Fill the vectors of range and label value
-    for (int c = 0; c < m_CheckedVector.size(); c++)
+//-------------------------------------------------------------------------
+// Maps the chunk of values assigned to the thread
+template <class T>
+static void LV_MapValues(LV_JOB<T> *job, int threadId, int numberOfThreads)
+//-------------------------------------------------------------------------
+{
+  vtkIdType chunk = (job->NumberOfValues + numberOfThreads - 1) / numberOfThreads;
+  vtkIdType first = chunk * threadId;
+  vtkIdType last = first + chunk < job->NumberOfValues ? first + chunk : job->NumberOfValues;
+
+  const T *source = job->Source;
+  T *labels = job->Labels;
+  if (job->Lut)
+  {
+    const T *lut = job->Lut;
+    T outOfRange = LV_Cast<T>(OUTRANGE_SCALAR);
+    for (vtkIdType i = first; i < last; i++)
     {
-      if (m_CheckedVector.at(c))
-      {
-        wxString label = m_LabelNameVector.at(c);
-        wxStringTokenizer tkz(label,wxT(' '),wxTOKEN_RET_EMPTY_ALL);
-        mafString labelName = tkz.GetNextToken().c_str();
-        mafString labelIntStr = tkz.GetNextToken().c_str();
-        m_LabelIntValue = atoi(labelIntStr);
-        labelIntVector.push_back(m_LabelIntValue);
-        mafString minStr = tkz.GetNextToken().c_str();
-        m_MinValue = atof(minStr);
-        minVector.push_back(m_MinValue);
-        mafString maxStr = tkz.GetNextToken().c_str();
-        m_MaxValue = atof(maxStr);
-        maxVector.push_back(m_MaxValue);
-        counter++;
-      }
+      vtkIdType index = (vtkIdType)source[i] - job->LutMin;
+      labels[i] = (index >= 0 && index < job->LutSize) ? lut[index] : outOfRange;
     }
-    
-    int labelVlaue;
-    if (counter != 0)
+  }
+  else
+  {
+    for (vtkIdType i = first; i < last; i++)
     {
-      int not = volumeScalars->GetNumberOfTuples();
-      for ( int i = 0; i < not; i++ )
-      {
-        bool modified = false;
-        double scalarValue = volumeScalars->GetComponent( i, 0 );
-        for (int c = 0; c < labelIntVector.size(); c++)
-        {
-          if ( scalarValue >= minVector.at(c) && scalarValue <= maxVector.at(c))
-          { 
-            labelVlaue = labelIntVector.at(c);
-            labelScalars->SetTuple1( i, labelVlaue ); 
-            modified = true;
-          }
-        }
-        if (!modified)
-        {
-          labelScalars->SetTuple1( i, OUTRANGE_SCALAR); 
-        }
-      }
-      
-      labelScalars->Modified();
-      m_Dataset->GetPointData()->SetScalars(labelScalars);
-      m_Dataset->Modified();
+      labels[i] = LV_Cast<T>(LV_LookUp(*job->Intervals, source[i]));
     }
-    else
+  }
+}
+
+//-------------------------------------------------------------------------
+// Thread function of LV_Map
+template <class T>
+static VTK_THREAD_RETURN_TYPE LV_MapValuesThread(void *arg)
+//-------------------------------------------------------------------------
+{
+  vtkMultiThreader::ThreadInfo *info = (vtkMultiThreader::ThreadInfo *)arg;
+  LV_MapValues((LV_JOB<T> *)info->UserData, info->ThreadID, info->NumberOfThreads);
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//-------------------------------------------------------------------------
+// Writes in labelValues the labels of the n volumeValues. For integer types a dense table
+// of the labels of all values of range is used, for the other types the interval table.
+template <class T>
+static void LV_Map(const T *volumeValues, T *labelValues, vtkIdType n, const double range[2],
+  const LV_LABELS &labels, const LV_INTERVALS &intervals)
+//-------------------------------------------------------------------------
+{
+  const double MAX_LUT_SIZE = 1 << 20;
+
+  LV_JOB<T> job;
+  job.Source = volumeValues;
+  job.Labels = labelValues;
+  job.NumberOfValues = n;
+  job.Lut = NULL;
+  job.LutMin = 0;
+  job.LutSize = 0;
+  job.Intervals = &intervals;
+
+  std::vector<T> lut;
+  if (std::numeric_limits<T>::is_integer && range[1] - range[0] < MAX_LUT_SIZE)
+  {
+    job.LutMin = (vtkIdType)range[0];
+    job.LutSize = (vtkIdType)range[1] - job.LutMin + 1;
+    lut.resize(job.LutSize);
+    for (vtkIdType v = 0; v < job.LutSize; v++)
     {
-      int not = volumeScalars->GetNumberOfTuples();
-      for ( int i = 0; i < not; i++ )
-      {
-        labelScalars->SetTuple1( i, OUTRANGE_SCALAR); 
-      }
-      labelScalars->Modified();
-      m_Dataset->GetPointData()->SetScalars(labelScalars);
-      m_Dataset->Modified();
+      lut[v] = LV_Cast<T>(LV_LookUp(intervals, (double)(job.LutMin + v)));
     }
+    job.Lut = &lut[0];
+  }
 
-    double scalarRange[2];
-    labelScalars->GetRange(scalarRange);
+  vtkMultiThreader *threader = vtkMultiThreader::New();
+  int nThreads = threader->GetNumberOfThreads();
+  if (n < 65536)
+    nThreads = 1;
 
-    mmaVolumeMaterial *labelMaterial = ((mafVMEOutputVolume *)this->GetOutput())->GetMaterial();
-    labelMaterial->m_ColorLut->SetTableRange(scalarRange);
-    labelMaterial->UpdateFromTables();
+  if (nThreads <= 1)
+  {
+    LV_MapValues(&job, 0, 1);
+  }
+  else
+  {
+    threader->SetNumberOfThreads(nThreads);
+    threader->SetSingleMethod(LV_MapValuesThread<T>, &job);
+    threader->SingleMethodExecute();
+  }
+  vtkDEL(threader);
+}
+
+//-------------------------------------------------------------------------
+void medVMELabeledVolume::GenerateLabeledVolume()
+//-------------------------------------------------------------------------
+{
+  m_VolumeLink = mafVME::SafeDownCast(GetVolumeLink());
+  if (m_VolumeLink == NULL)
+  {
+    UpdateScalars();
+    return;
+  }
+  EnableWidgets(true);
+
+  vtkDataSet *data = m_VolumeLink->GetOutput()->GetVTKData();
+  data->Update();
+  vtkDataArray *volumeScalars = data->GetPointData()->GetScalars();
+  vtkDataArray *labelScalars = m_Dataset->GetPointData()->GetScalars();
+
+  //Fill the vectors of range and label value
+  LV_LABELS labels;
+  for (int c = 0; c < m_CheckedVector.size(); c++)
+  {
+    if (m_CheckedVector.at(c))
+    {
+      wxString label = m_LabelNameVector.at(c);
+      wxStringTokenizer tkz(label,wxT(' '),wxTOKEN_RET_EMPTY_ALL);
+      mafString labelName = tkz.GetNextToken().c_str();
+      mafString labelIntStr = tkz.GetNextToken().c_str();
+      m_LabelIntValue = atoi(labelIntStr);
+      labels.Values.push_back(m_LabelIntValue);
+      mafString minStr = tkz.GetNextToken().c_str();
+      m_MinValue = atof(minStr);
+      labels.Min.push_back(m_MinValue);
+      mafString maxStr = tkz.GetNextToken().c_str();
+      m_MaxValue = atof(maxStr);
+      labels.Max.push_back(m_MaxValue);
+    }
+  }
 
-    mafEvent e(this,CAMERA_UPDATE);
-    ForwardUpEvent(&e);
+  // the labels are computed again only if the checked labels or the scalars changed
+  if (labelScalars == m_LabeledScalars && labelScalars->GetMTime() == m_LabeledScalarsMTime &&
+    volumeScalars == m_LabelSourceScalars && volumeScalars->GetMTime() == m_LabelSourceScalarsMTime &&
+    labels.Values == m_LabeledValues && labels.Min == m_LabeledMin && labels.Max == m_LabeledMax)
+  {
+    return;
+  }
+
+  if (labelScalars->GetDataType() != volumeScalars->GetDataType() ||
+    labelScalars->GetNumberOfTuples() != volumeScalars->GetNumberOfTuples() ||
+    labelScalars->GetNumberOfComponents() != volumeScalars->GetNumberOfComponents())
+  {
+    labelScalars->DeepCopy(volumeScalars);
+  }
+
+  LV_INTERVALS intervals;
+  LV_BuildIntervals(labels, intervals);
+
+  vtkIdType n = volumeScalars->GetNumberOfTuples();
+  double range[2];
+  volumeScalars->GetRange(range);
+  void *volumeValues = volumeScalars->GetVoidPointer(0);
+  void *labelValues = labelScalars->GetVoidPointer(0);
+
+  if (volumeScalars->GetNumberOfComponents() != 1)
+  {
+    for (vtkIdType i = 0; i < n; i++)
+    {
+      labelScalars->SetTuple1(i, LV_LookUp(intervals, volumeScalars->GetComponent(i, 0)));
+    }
+  }
+  else
+  {
+    switch (volumeScalars->GetDataType())
+    {
+      case VTK_CHAR:
+        LV_Map((char *)volumeValues, (char *)labelValues, n, range, labels, intervals);
+        break;
+      case VTK_UNSIGNED_CHAR:
+        LV_Map((unsigned char *)volumeValues, (unsigned char *)labelValues, n, range, labels, intervals);
+        break;
+      case VTK_SHORT:
+        LV_Map((short *)volumeValues, (short *)labelValues, n, range, labels, intervals);
+        break;
+      case VTK_UNSIGNED_SHORT:
+        LV_Map((unsigned short *)volumeValues, (unsigned short *)labelValues, n, range, labels, intervals);
+        break;
+      case VTK_INT:
+        LV_Map((int *)volumeValues, (int *)labelValues, n, range, labels, intervals);
+        break;
+      case VTK_UNSIGNED_INT:
+        LV_Map((unsigned int *)volumeValues, (unsigned int *)labelValues, n, range, labels, intervals);
+        break;
+      case VTK_FLOAT:
+        LV_Map((float *)volumeValues, (float *)labelValues, n, range, labels, intervals);
+        break;
+      case VTK_DOUBLE:
+        LV_Map((double *)volumeValues, (double *)labelValues, n, range, labels, intervals);
+        break;
+      default:
+        for (vtkIdType i = 0; i < n; i++)
+        {
+          labelScalars->SetTuple1(i, LV_LookUp(intervals, volumeScalars->GetComponent(i, 0)));
+        }
+        break;
+    }
   }
+
+  labelScalars->Modified();
+  m_Dataset->GetPointData()->SetScalars(labelScalars);
+  m_Dataset->Modified();
+
+  m_LabeledScalars = labelScalars;
+  m_LabeledScalarsMTime = labelScalars->GetMTime();
+  m_LabelSourceScalars = volumeScalars;
+  m_LabelSourceScalarsMTime = volumeScalars->GetMTime();
+  m_LabeledValues = labels.Values;
+  m_LabeledMin = labels.Min;
+  m_LabeledMax = labels.Max;
+
+  double scalarRange[2];
+  labelScalars->GetRange(scalarRange);
+
+  mmaVolumeMaterial *labelMaterial = ((mafVMEOutputVolume *)this->GetOutput())->GetMaterial();
+  labelMaterial->m_ColorLut->SetTableRange(scalarRange);
+  labelMaterial->UpdateFromTables();
+
+  mafEvent e(this,CAMERA_UPDATE);
+  ForwardUpEvent(&e);
 }
 
 //-----------------------------------------------------------------------
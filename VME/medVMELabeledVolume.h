@@ -43,6 +43,7 @@ class vtkTexture;
 class vtkPolyDataMapper;
 class vtkActor;
 class vtkPolyData;
+class vtkDataArray;
 class mmaVolumeMaterial;
 
 //----------------------------------------------------------------------------
@@ -212,6 +213,15 @@ protected:
   vtkDataSet        *m_Dataset;
   vtkPolyData       *m_Polydata;
 
+  // labels and scalars of the last GenerateLabeledVolume, to skip it when nothing changed
+  vtkDataArray *m_LabeledScalars;
+  unsigned long m_LabeledScalarsMTime;
+  vtkDataArray *m_LabelSourceScalars;
+  unsigned long m_LabelSourceScalarsMTime;
+  std::vector<int> m_LabeledValues;
+  std::vector<int> m_LabeledMin;
+  std::vector<int> m_LabeledMax;
+
   /** This method updates the look-up table. */
   void UpdateLookUpTable();
 
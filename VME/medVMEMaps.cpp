@@ -37,6 +37,7 @@
 #include "mmaMaterial.h"
 
 #include "vtkMAFDistanceFilter.h"
+#include "vtkMEDDistanceFieldFilter.h"
 #include "vtkPolyData.h"
 #include "vtkFloatArray.h"
 #include "vtkPolyDataNormals.h"
@@ -68,6 +69,7 @@ medVMEMaps::medVMEMaps()
   mafNEW(m_Transform);
   vtkNEW(m_Normals);
   vtkNEW(m_DistanceFilter);
+  vtkNEW(m_DistanceFieldFilter);
   vtkNEW(m_PolyData);
 
   mafVMEOutputSurface *output = mafVMEOutputSurface::New(); // an output with no data
@@ -87,6 +89,7 @@ medVMEMaps::medVMEMaps()
   m_FirstThreshold = 700;
   m_SecondThreshold = 300;
   m_MaxDistance = 2;
+  m_UseDistanceField = 0;
 }
 
 //-------------------------------------------------------------------------
@@ -95,6 +98,10 @@ medVMEMaps::~medVMEMaps()
 {
   vtkDEL(m_Normals);
   vtkDEL(m_DistanceFilter);
+  // the cached distance fields keep a reference to the volume
+  if (m_DistanceFieldFilter->GetSource())
+    vtkMEDDistanceFieldFilter::ReleaseDistanceFields(m_DistanceFieldFilter->GetSource());
+  vtkDEL(m_DistanceFieldFilter);
   
   mafDEL(m_Transform);
   vtkDEL(m_PolyData);
@@ -126,6 +133,7 @@ int medVMEMaps::DeepCopy(mafNode *a)
     m_FirstThreshold          = maps->GetFirstThreshold();
     m_SecondThreshold         = maps->GetSecondThreshold();
     m_MaxDistance             = maps->GetMaxDistance();
+    m_UseDistanceField        = maps->GetUseDistanceField();
 
     if(maps->GetSourceVMELink())
       SetSourceVMELink(maps->GetSourceVMELink());
@@ -168,10 +176,12 @@ mafGUI* medVMEMaps::CreateGui()
   m_Choices[0]="Distance";
   m_Choices[1]="Density";
   m_Gui->Radio(ID_DENSITY_DISTANCE,"",&m_DensityDistance,2,m_Choices);
+  m_Gui->Bool(ID_USE_DISTANCE_FIELD,_("Distance field"),&m_UseDistanceField,0,_("Read distances and densities from a cached distance transform of the volume"));
 
   if(!m_Volume)
   {
     m_Gui->Enable(ID_DENSITY_DISTANCE,false);
+    m_Gui->Enable(ID_USE_DISTANCE_FIELD,false);
   }
  
   m_Gui->Divider();
@@ -195,6 +205,11 @@ void medVMEMaps::OnEvent(mafEventBase *maf_event)
         SetDensityDistance(m_DensityDistance);
       }
       break;
+    case ID_USE_DISTANCE_FIELD:
+      {
+        SetUseDistanceField(m_UseDistanceField);
+      }
+      break;
     default:
       Superclass::OnEvent(maf_event);
     }
@@ -263,10 +278,12 @@ void medVMEMaps::InternalPreUpdate()
     if(m_DensityDistance == 0)
     {
       m_DistanceFilter->SetFilterModeToDistance();
+      m_DistanceFieldFilter->SetFilterModeToDistance();
     }
     if(m_DensityDistance == 1)
     {
       m_DistanceFilter->SetFilterModeToDensity();
+      m_DistanceFieldFilter->SetFilterModeToDensity();
     }
 
     vtkDataSet *datasetvol = ((mafVME*)m_Volume)->GetOutput()->GetVTKData();
@@ -277,7 +294,12 @@ void medVMEMaps::InternalPreUpdate()
     m_DistanceFilter->SetMaxDistance(m_MaxDistance);
     m_DistanceFilter->SetThreshold(m_FirstThreshold);
     m_DistanceFilter->SetInputMatrix(vme->GetOutput()->GetAbsMatrix()->GetVTKMatrix());
-    m_DistanceFilter->Update(); 
+    m_DistanceFieldFilter->SetSource(datasetvol);
+    m_DistanceFieldFilter->SetInput((vtkDataSet::SafeDownCast(m_Normals->GetOutput())));
+    m_DistanceFieldFilter->SetMaxDistance(m_MaxDistance);
+    m_DistanceFieldFilter->SetThreshold(m_FirstThreshold);
+    m_DistanceFieldFilter->SetInputMatrix(vme->GetOutput()->GetAbsMatrix()->GetVTKMatrix());
+    GetMapsFilter()->Update(); 
 
     //GetMaterial()->m_ColorLut = CreateTable();
 
@@ -287,7 +309,7 @@ void medVMEMaps::InternalPreUpdate()
 
     //m_PolyData = m_DistanceFilter->GetPolyDataOutput();
 
-    if(polyout = m_DistanceFilter->GetPolyDataOutput())
+    if(polyout = GetMapsFilter()->GetPolyDataOutput())
     {
       polyout->Update();
 
@@ -344,7 +366,10 @@ void medVMEMaps::SetVolume(mafVMEVolume *volume)
 {
   m_Volume = volume;
   if(m_Gui && m_Volume)
+  {
     m_Gui->Enable(ID_DENSITY_DISTANCE, true);
+    m_Gui->Enable(ID_USE_DISTANCE_FIELD, true);
+  }
 }
 
 //-------------------------------------------------------------------------
@@ -488,6 +513,23 @@ void medVMEMaps::SetMaxDistance(int maxDistance)
 
 }
 
+//-------------------------------------------------------------------------
+void medVMEMaps::SetUseDistanceField(int useDistanceField)
+//-------------------------------------------------------------------------
+{
+  m_UseDistanceField = useDistanceField;
+  UpdateFilter();
+}
+
+//-------------------------------------------------------------------------
+vtkDataSetToDataSetFilter *medVMEMaps::GetMapsFilter()
+//-------------------------------------------------------------------------
+{
+  if(m_UseDistanceField)
+    return m_DistanceFieldFilter;
+  return m_DistanceFilter;
+}
+
 //-----------------------------------------------------------------------
 mafNode *medVMEMaps::GetMappedVMELink()
 //-----------------------------------------------------------------------
@@ -600,10 +642,12 @@ void medVMEMaps::UpdateFilter()
     if(m_DensityDistance == 0)
     {
       m_DistanceFilter->SetFilterModeToDistance();
+      m_DistanceFieldFilter->SetFilterModeToDistance();
     }
     if(m_DensityDistance == 1)
     {
       m_DistanceFilter->SetFilterModeToDensity();
+      m_DistanceFieldFilter->SetFilterModeToDensity();
     }
 
     vtkDataSet *datasetvol = ((mafVME*)m_Volume)->GetOutput()->GetVTKData();
@@ -614,12 +658,17 @@ void medVMEMaps::UpdateFilter()
     m_DistanceFilter->SetMaxDistance(m_MaxDistance);
     m_DistanceFilter->SetThreshold(m_FirstThreshold);
     m_DistanceFilter->SetInputMatrix(vme->GetOutput()->GetAbsMatrix()->GetVTKMatrix());
-    m_DistanceFilter->Update(); 
+    m_DistanceFieldFilter->SetSource(datasetvol);
+    m_DistanceFieldFilter->SetInput((vtkDataSet::SafeDownCast(m_Normals->GetOutput())));
+    m_DistanceFieldFilter->SetMaxDistance(m_MaxDistance);
+    m_DistanceFieldFilter->SetThreshold(m_FirstThreshold);
+    m_DistanceFieldFilter->SetInputMatrix(vme->GetOutput()->GetAbsMatrix()->GetVTKMatrix());
+    GetMapsFilter()->Update(); 
 
     vtkPolyData *polyout;
     vtkMAFSmartPointer<vtkFloatArray> scalars;
 
-    if(polyout = m_DistanceFilter->GetPolyDataOutput())
+    if(polyout = GetMapsFilter()->GetPolyDataOutput())
     {
       polyout->Update();
 
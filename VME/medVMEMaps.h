@@ -32,6 +32,8 @@ class mmaMaterial;
 class vtkColorTransferFunction;
 
 class vtkMAFDistanceFilter;
+class vtkMEDDistanceFieldFilter;
+class vtkDataSetToDataSetFilter;
 class vtkPolyData;
 class vtkPolyDataNormals;
 class vtkLookupTable;
@@ -49,6 +51,7 @@ public:
   enum VME_MAPS_WIDGET_ID
   {
     ID_DENSITY_DISTANCE = Superclass::ID_LAST,
+    ID_USE_DISTANCE_FIELD,
     ID_LAST
   };
 
@@ -136,6 +139,13 @@ public:
   /** Set max distance distance-density filter parameter. */
   void SetMaxDistance(int maxDistance);
 
+  /** Get the use of the cached distance transform of the volume. */
+  int GetUseDistanceField(){return m_UseDistanceField;};
+
+  /** Read distances and densities from a cached distance transform of the volume (vtkMEDDistanceFieldFilter)
+  instead of casting rays from the vertices of the surface (vtkMAFDistanceFilter). */
+  void SetUseDistanceField(int useDistanceField);
+
   /** Set the link to the maps.*/
   void SetMappedVMELink(mafNode *node);
 
@@ -173,6 +183,9 @@ private:
   /** Update distance density filter. */
   void UpdateFilter();
 
+  /** Return the filter computing distances and densities (m_DistanceFieldFilter or m_DistanceFilter). */
+  vtkDataSetToDataSetFilter *GetMapsFilter();
+
   /** private to avoid calling by external classes */
   //virtual int SetData(vtkDataSet *data, mafTimeStamp t, int mode=MAF_VME_COPY_DATA);
 
@@ -180,6 +193,7 @@ private:
 
   vtkPolyDataNormals        *m_Normals;
   vtkMAFDistanceFilter      *m_DistanceFilter;
+  vtkMEDDistanceFieldFilter *m_DistanceFieldFilter;
   mafVMEVolume              *m_Volume;
   mafTransform              *m_Transform;
   vtkPolyData               *m_PolyData;
@@ -189,6 +203,7 @@ private:
   int m_FirstThreshold;
   int m_SecondThreshold;
   int m_MaxDistance;
+  int m_UseDistanceField;
 
 };
 #endif
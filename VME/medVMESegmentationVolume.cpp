@@ -449,6 +449,19 @@ mafNode *medVMESegmentationVolume::GetRefinementVolumeMask()
   return GetLink("RefinementVolumeMask");
 }
 //-----------------------------------------------------------------------
+void medVMESegmentationVolume::SetRefinementInputMask(medSegmentationSparseMask *mask)
+//-----------------------------------------------------------------------
+{
+  m_SegmentingDataPipe->SetRefinementInputMask(mask);
+  Modified();
+}
+//-----------------------------------------------------------------------
+int medVMESegmentationVolume::GetNumberOfThresholdedSlices()
+//-----------------------------------------------------------------------
+{
+  return m_SegmentingDataPipe->GetNumberOfThresholdedSlices();
+}
+//-----------------------------------------------------------------------
 vtkDataSet *medVMESegmentationVolume::GetAutomaticOutput()
 //-----------------------------------------------------------------------
 {
@@ -473,6 +486,18 @@ vtkDataSet *medVMESegmentationVolume::GetManualOutput()
   return m_SegmentingDataPipe->GetManualOutput();
 }
 //-----------------------------------------------------------------------
+medSegmentationSparseMask *medVMESegmentationVolume::GetRefinementMask()
+//-----------------------------------------------------------------------
+{
+  return m_SegmentingDataPipe->GetRefinementMask();
+}
+//-----------------------------------------------------------------------
+medSegmentationSparseMask *medVMESegmentationVolume::GetManualMask()
+//-----------------------------------------------------------------------
+{
+  return m_SegmentingDataPipe->GetManualMask();
+}
+//-----------------------------------------------------------------------
 mafNode *medVMESegmentationVolume::GetVolumeLink()
 //-----------------------------------------------------------------------
 {
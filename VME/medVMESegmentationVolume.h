@@ -30,6 +30,7 @@ class mafTransform;
 class mmaVolumeMaterial;
 class medDataPipeCustomSegmentationVolume;
 class medAttributeSegmentationVolume;
+class medSegmentationSparseMask;
 
 class MED_VME_EXPORT medVMESegmentationVolume : public mafVME
 {
@@ -116,6 +117,12 @@ public:
   /** Return the vtkDataSet of the region growing segmentation */
   vtkDataSet *GetRegionGrowingOutput();
 
+  /** Return the sparse mask of the refinement segmentation, the final result of the segmentation */
+  medSegmentationSparseMask *GetRefinementMask();
+
+  /** Return the sparse mask of the manual segmentation */
+  medSegmentationSparseMask *GetManualMask();
+
   /** Set the volume mask for the manual segmentation */
   void SetManualVolumeMask(mafNode *volume);
 
@@ -128,6 +135,9 @@ public:
   /** Get the volume mask for the refinement segmentation */
   mafNode *GetRefinementVolumeMask();
 
+  /** Set the sparse mask edited by the refinement tools, used in place of the refinement volume mask (not owned, not stored) */
+  void SetRefinementInputMask(medSegmentationSparseMask *mask);
+
   /** Add a new range with a particular threshold */
   int AddRange(int startSlice,int endSlice,double threshold, double upperThershold=0);
 
@@ -170,6 +180,9 @@ public:
   /** Return the value to use during a global threshold, in double threshold mode return the lower threshold*/
   double GetAutomaticSegmentationGlobalThreshold();
 
+  /** Return the number of slices thresholded by the last automatic segmentation */
+  int GetNumberOfThresholdedSlices();
+
   /** Check if all thresholds exist */
   bool CheckNumberOfThresholds();
 
@@ -36,6 +36,7 @@
 #include "mmuIdFactory.h"
 #include "mafGUI.h"
 #include "mafAbsMatrixPipe.h"
+#include "mafNodeIterator.h"
 #include "vtkMAFSmartPointer.h"
 
 #include "vtkMAFDataPipe.h"
@@ -46,6 +47,7 @@
 #include "vtkAppendPolyData.h"
 #include "vtkOBBTree.h"
 #include "vtkPoints.h"
+#include "vtkIdList.h"
 #include "vtkTransformPolyDataFilter.h"
 #include "vtkLinearTransform.h"
 #include "vtkPatchLine.h"
@@ -65,6 +67,12 @@
 
 MAF_ID_IMP(medVMEComputeWrapping::LENGTH_THRESHOLD_EVENT);
 
+// maximal number of cached locators of wrapped surfaces, when it is reached,
+// the least recently used locator is rebuilt for the new surface
+const int WRAPPED_LOCATOR_CACHE_SIZE = 4;
+// number of angles searched on each side of the previous best angle by the warm start
+const int WARM_START_WINDOW = 3;
+
 //-------------------------------------------------------------------------
 mafCxxTypeMacro(medVMEComputeWrapping)
 //-------------------------------------------------------------------------
@@ -96,6 +104,8 @@ medVMEComputeWrapping::medVMEComputeWrapping()
 	m_ListBox = NULL;
 	m_Idx = 0;
 	m_PathNum = 36;
+	m_WarmStart = 0;
+	m_WarmStartIndex = -1;
 
 	//m_Tolerance = GetCylinderRadius()/4.0;
 
@@ -122,6 +132,8 @@ medVMEComputeWrapping::medVMEComputeWrapping()
 
 	mafNEW(m_TmpTransform);
 
+	m_WrappedLocatorsUse = 0;
+
 	DependsOnLinkedNodeOn();
 
 	// attach a data pipe which creates a bridge between VTK and MAF
@@ -166,10 +178,138 @@ medVMEComputeWrapping::~medVMEComputeWrapping()
 
 	m_OrderMiddlePointsVMEList.clear();
 
+	for(int i=0; i< (int)m_WrappedLocators.size(); i++)
+	{
+		cppDEL(m_WrappedLocators[i]);
+	}
+	m_WrappedLocators.clear();
 
 	SetOutput(NULL);
 }
 
+//-------------------------------------------------------------------------
+medVMEComputeWrapping::WrappedLocator::WrappedLocator()
+//-------------------------------------------------------------------------
+{
+	vtkNEW(m_Tree);
+	m_Tree->SetGlobalWarningDisplay(0);
+	m_DataSet = NULL;
+	m_DataSetMTime = 0;
+	m_LastUse = 0;
+}
+//-------------------------------------------------------------------------
+medVMEComputeWrapping::WrappedLocator::~WrappedLocator()
+//-------------------------------------------------------------------------
+{
+	vtkDEL(m_Tree);
+}
+//-------------------------------------------------------------------------
+void medVMEComputeWrapping::WrappedLocator::Update(vtkPolyData *data, const mafMatrix &queryToData)
+//-------------------------------------------------------------------------
+{
+	// the tree holds a reference to its data set, so the pointer cannot be reused by another data
+	if (data != m_DataSet || data->GetMTime() != m_DataSetMTime)
+	{
+		m_Tree->SetDataSet(data);
+		m_Tree->BuildLocator();
+
+		m_DataSet = data;
+		m_DataSetMTime = data->GetMTime();
+	}
+
+	mafMatrix dataToQuery;
+	mafMatrix::Invert(queryToData, dataToQuery);
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			m_QueryToData[4*i + j] = queryToData.GetElement(i, j);
+			m_DataToQuery[4*i + j] = dataToQuery.GetElement(i, j);
+		}
+	}
+}
+//-------------------------------------------------------------------------
+void medVMEComputeWrapping::WrappedLocator::TransformPoint(const double mat[12], const double in[3], double out[3])
+//-------------------------------------------------------------------------
+{
+	for (int i = 0; i < 3; i++)
+		out[i] = mat[4*i]*in[0] + mat[4*i + 1]*in[1] + mat[4*i + 2]*in[2] + mat[4*i + 3];
+}
+//-------------------------------------------------------------------------
+int medVMEComputeWrapping::WrappedLocator::InsideOrOutside(const double point[3])
+//-------------------------------------------------------------------------
+{
+	double dataPoint[3];
+	TransformPoint(m_QueryToData, point, dataPoint);
+	return m_Tree->InsideOrOutside(dataPoint);
+}
+//-------------------------------------------------------------------------
+int medVMEComputeWrapping::WrappedLocator::IntersectWithLine(const double p1[3], const double p2[3], vtkPoints *points, vtkIdList *cellIds)
+//-------------------------------------------------------------------------
+{
+	double dataP1[3], dataP2[3];
+	TransformPoint(m_QueryToData, p1, dataP1);
+	TransformPoint(m_QueryToData, p2, dataP2);
+
+	int rtn = m_Tree->IntersectWithLine(dataP1, dataP2, points, cellIds);
+	if (points != NULL)
+	{
+		// intersections back into the local frame of the meter
+		double queryPoint[3];
+		int nPoints = points->GetNumberOfPoints();
+		for (int i = 0; i < nPoints; i++)
+		{
+			TransformPoint(m_DataToQuery, points->GetPoint(i), queryPoint);
+			points->SetPoint(i, queryPoint);
+		}
+	}
+	return rtn;
+}
+//-------------------------------------------------------------------------
+medVMEComputeWrapping::WrappedLocator *medVMEComputeWrapping::GetWrappedLocator(mafVME *wrapped_vme)
+//-------------------------------------------------------------------------
+{
+	vtkPolyData *data = (vtkPolyData *)wrapped_vme->GetOutput()->GetVTKData();
+	data->Update();
+
+	// queries are in the local frame of the meter, the tree is in the local frame of data
+	mafMatrix absInverse, queryToData;
+	mafMatrix::Invert(*wrapped_vme->GetOutput()->GetAbsMatrix(), absInverse);
+	mafMatrix::Multiply4x4(absInverse, GetOutput()->GetAbsTransform()->GetMatrix(), queryToData);
+
+	WrappedLocator *locator = NULL;
+	for (int i = 0; i < (int)m_WrappedLocators.size(); i++)
+	{
+		if (m_WrappedLocators[i]->GetDataSet() == data)
+		{
+			locator = m_WrappedLocators[i];
+			break;
+		}
+	}
+
+	if (locator == NULL)
+	{
+		if ((int)m_WrappedLocators.size() < WRAPPED_LOCATOR_CACHE_SIZE)
+		{
+			locator = new WrappedLocator();
+			m_WrappedLocators.push_back(locator);
+		}
+		else
+		{
+			locator = m_WrappedLocators[0];
+			for (int i = 1; i < (int)m_WrappedLocators.size(); i++)
+			{
+				if (m_WrappedLocators[i]->m_LastUse < locator->m_LastUse)
+					locator = m_WrappedLocators[i];
+			}
+		}
+	}
+
+	locator->m_LastUse = ++m_WrappedLocatorsUse;
+	locator->Update(data, queryToData);
+	return locator;
+}
+
 //-------------------------------------------------------------------------
 int medVMEComputeWrapping::DeepCopy(mafNode *a)
 //-------------------------------------------------------------------------
@@ -200,6 +340,8 @@ int medVMEComputeWrapping::DeepCopy(mafNode *a)
 
 		this->m_Idx = meter->m_Idx;
 		this->m_PathNum = meter->m_PathNum;
+		this->m_WarmStart = meter->m_WarmStart;
+		this->m_WarmStartIndex = -1;
 
 		memcpy(this->m_Alist, meter->m_Alist, sizeof(this->m_Alist));		
 		memcpy(this->m_APoint, meter->m_APoint, sizeof(this->m_APoint));
@@ -341,8 +483,6 @@ void medVMEComputeWrapping::Dispatch(){
 	int obbtreeFlag2 = 0;
 
 	double cosA,sinA,cosB,sinB;//used for get transform matrix
-	vtkMAFSmartPointer<vtkOBBTree> locator1;
-	vtkMAFSmartPointer<vtkOBBTree> locator2;
 
 	mafString logFname = "dispatch.txt";
 	std::ofstream outputFile(logFname, std::ios::out|std::ios::app);
@@ -386,7 +526,6 @@ void medVMEComputeWrapping::Dispatch(){
 		vtkMAFSmartPointer<vtkPoints> pointsIntersection1;
 		vtkMAFSmartPointer<vtkPoints> pointsIntersection2;
 		bool aligned = false;
-		vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstData;
 		//-------------prepare i point
 
 
@@ -1469,21 +1608,8 @@ void medVMEComputeWrapping::WrapSingleCylinder(double vId){
 	//---------------over--------------------------
 
 	// create ordered list of tangent point (2) real algorithm
-	vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstDataInput;
-	transformFirstDataInput->SetTransform((vtkAbstractTransform *)((mafVME *)wrapped_vme1)->GetAbsMatrixPipe()->GetVTKTransform());
-	transformFirstDataInput->SetInput((vtkPolyData *)((mafVME *)wrapped_vme1)->GetOutput()->GetVTKData());
-	transformFirstDataInput->Update();
-
-	vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstData;
-	transformFirstData->SetTransform((vtkAbstractTransform *)m_TmpTransform->GetVTKTransform());
-	transformFirstData->SetInput((vtkPolyData *)transformFirstDataInput->GetOutput());
-	transformFirstData->Update(); 
-
 	// here REAL ALGORITHM //////////////////////////////
-	vtkMAFSmartPointer<vtkOBBTree> locator;
-	locator->SetDataSet(transformFirstData->GetOutput());
-	locator->SetGlobalWarningDisplay(0);
-	locator->BuildLocator();
+	WrappedLocator *locator = GetWrappedLocator(wrapped_vme1);
 
 	SingleWrapAutomatedIOR(wrapped_vme1,local_start,local_end,local_wrapped_center,locator);
 	vtkDEL(SC);
@@ -1968,8 +2094,6 @@ void medVMEComputeWrapping::FormatParameterForHelix(double  tc,double  to,double
 	k = Zo - ( c * toRtn );
 }
 double medVMEComputeWrapping::CaculateHelix2(vtkPolyData * hCurve,double *cCoord,double *vCoord,double drawFlag,int objIdx){
-	vtkMAFSmartPointer<vtkCellArray> cells;
-	vtkPoints *pts = vtkPoints::New();
 	double Xc,Yc,Zc,Xo,Yo,Zo;
 	double r;
 	double cosTc,sinTc,cosTo,sinTo;
@@ -2022,15 +2146,29 @@ double medVMEComputeWrapping::CaculateHelix2(vtkPolyData * hCurve,double *cCoord
 	c = (Zc-Zo) /(tc-to);
 	k = Zc - c*tc;
 
-	rtn = DrawHelix(tc,to,c,k, cells,pts,drawFlag,objIdx);
-
-	if (drawFlag)
+	if (!drawFlag)
 	{
-		hCurve->SetPoints( pts );
-		hCurve->SetLines(cells);
+		//only the length is needed: no polyline is allocated
+		return ComputeHelixLength(tc,to,c,objIdx);
 	}
+
+	vtkMAFSmartPointer<vtkCellArray> cells;
+	vtkMAFSmartPointer<vtkPoints> pts;
+	rtn = DrawHelix(tc,to,c,k, cells,pts,drawFlag,objIdx);
+
+	hCurve->SetPoints( pts );
+	hCurve->SetLines(cells);
 	return rtn;
 }
+//length of the polyline drawn by DrawHelix: its step chords have the same length
+double medVMEComputeWrapping::ComputeHelixLength(double tc,double to,double c,int objIdx){
+	const int step = 10;
+	double r = GetCylinderRadius(objIdx);
+	double d = fabs(to - tc)/step;
+	double chord = 2*r*sin(d/2);
+
+	return step * sqrt(chord*chord + c*c*d*d);
+}
 //compute helix formula and then draw curve
 double medVMEComputeWrapping::CaculateHelix2(vtkPolyData * hCurve,double *cCoord,double *vCoord,double drawFlag){
 	double rtn;
@@ -2846,6 +2984,31 @@ void medVMEComputeWrapping::GetSphereCylinderWrap(const int step,double *viaPoin
 
 	dstep = (high-low)/step;
 
+	//angles of the search, the warm start searches first the ones near the angle found by the previous search
+	std::vector<double> angles;
+	for (double j=low;j<high;j = j+dstep)
+	{
+		angles.push_back(j);
+	}
+	int nAngles = angles.size();
+	std::vector<int> angleOrder;
+	bool warmStart = m_WarmStart && m_WarmStartIndex>=0 && m_WarmStartIndex<nAngles && 2*WARM_START_WINDOW+1<nAngles;
+	if (warmStart)
+	{
+		for (int n=-WARM_START_WINDOW;n<=WARM_START_WINDOW;n++)
+		{
+			angleOrder.push_back((m_WarmStartIndex + n + nAngles) % nAngles);
+		}
+	}
+	else
+	{
+		for (int n=0;n<nAngles;n++)
+		{
+			angleOrder.push_back(n);
+		}
+	}
+	int angleIdxFinal = -1;
+
 
 	GetGlobalSphereCenter(sphereCenter);
 	GetGlobalCylinderCenter(cylinderCenter);
@@ -2864,14 +3027,12 @@ void medVMEComputeWrapping::GetSphereCylinderWrap(const int step,double *viaPoin
 	}
 
 
-	for (double j=low;j<high;j = j+dstep)
+	for (int n=0;n<(int)angleOrder.size();n++)
 	{
+		double j = angles[angleOrder[n]];
 
 		length = 0;
 
-		vtkNEW(clipData);
-		vtkNEW(clipDataCI);
-
 		y1 = GetFunctionValue2(j,filterFlag,filterPlaneNormal,viaWrapLocal,aCoord,bCoord,mCoord,rm);//m is global
 
 		if (y1 != -1)
@@ -2955,6 +3116,7 @@ void medVMEComputeWrapping::GetSphereCylinderWrap(const int step,double *viaPoin
 				if (!(cCoord[2]<m_EndWrapLocal[2])){
 					idx++;
 					angleFinal = j;
+					angleIdxFinal = angleOrder[n];
 					LmFinal = tmpLm;
 
 					aCoordFinal[0] = aCoord[0];aCoordFinal[1]=aCoord[1];aCoordFinal[2]=aCoord[2];
@@ -2967,12 +3129,19 @@ void medVMEComputeWrapping::GetSphereCylinderWrap(const int step,double *viaPoin
 					//outputFile2<<"  "<<j<<"  "<<tmpLm<<std::endl;
 				}
 			}
+		}
 
-			vtkDEL(clipData);
-			vtkDEL(clipDataCI);
-
+		if (warmStart && idx==0 && n==(int)angleOrder.size()-1)
+		{
+			//no path near the previous one: search all the angles
+			warmStart = false;
+			for (int k=0;k<nAngles;k++)
+			{
+				angleOrder.push_back(k);
+			}
 		}
 	}
+	m_WarmStartIndex = angleIdxFinal;
 	//--------------single path-------------
 	if(idx>0){
 
@@ -3103,23 +3272,8 @@ bool medVMEComputeWrapping::IsLineInterSectObject(mafVME *wrapVME,double *point1
 	m_TmpTransform->TransformPoint(point2, endPoint);  // m_TmpTransform needed to fix a memory leaks of GetInverse()
 
 
-	vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstDataInput;
-	vtkMAFSmartPointer<vtkOBBTree> locator;
-	vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstData;
-
-	transformFirstDataInput->SetTransform((vtkAbstractTransform *)((mafVME *)wrapVME)->GetAbsMatrixPipe()->GetVTKTransform());
-	transformFirstDataInput->SetInput((vtkPolyData *)((mafVME *)wrapVME)->GetOutput()->GetVTKData());
-	transformFirstDataInput->Update();
-
-	transformFirstData->SetTransform((vtkAbstractTransform *)m_TmpTransform->GetVTKTransform());
-	transformFirstData->SetInput((vtkPolyData *)transformFirstDataInput->GetOutput());
-	transformFirstData->Update(); 
-
 	//-------test intersect sphere---------------------
-	//vtkMAFSmartPointer<vtkOBBTree> locator;
-	locator->SetDataSet(transformFirstData->GetOutput());//SPHERE
-	locator->SetGlobalWarningDisplay(0);
-	locator->BuildLocator();
+	WrappedLocator *locator = GetWrappedLocator(wrapVME);//SPHERE
 
 	if(locator->InsideOrOutside(startPoint) > 0 &&  locator->InsideOrOutside(endPoint) > 0) //both outside
 	{
@@ -3287,25 +3441,12 @@ int medVMEComputeWrapping::GetViaPoint(double *viaPoint,bool isNearEndflag){
 	m_TmpTransform->TransformPoint(m_EndPoint, endPoint);  // m_TmpTransform needed to fix a memory leaks of GetInverse()
 
 
-	vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstDataInput;
-	vtkMAFSmartPointer<vtkOBBTree> locator;
-	vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstData;
+	WrappedLocator *locator;
 
 	if (wrapped_vme1)
 	{
-		transformFirstDataInput->SetTransform((vtkAbstractTransform *)((mafVME *)GetWrappedVME1())->GetAbsMatrixPipe()->GetVTKTransform());
-		transformFirstDataInput->SetInput((vtkPolyData *)((mafVME *)GetWrappedVME1())->GetOutput()->GetVTKData());
-		transformFirstDataInput->Update();
-
-		transformFirstData->SetTransform((vtkAbstractTransform *)m_TmpTransform->GetVTKTransform());
-		transformFirstData->SetInput((vtkPolyData *)transformFirstDataInput->GetOutput());
-		transformFirstData->Update(); 
-
 		//-------test intersect sphere---------------------
-		//vtkMAFSmartPointer<vtkOBBTree> locator;
-		locator->SetDataSet(transformFirstData->GetOutput());//SPHERE
-		locator->SetGlobalWarningDisplay(0);
-		locator->BuildLocator();
+		locator = GetWrappedLocator(GetWrappedVME1());//SPHERE
 
 		insideFlag1 = locator->InsideOrOutside(startPoint);
 		insideFlag2 =  locator->InsideOrOutside(endPoint);
@@ -3327,17 +3468,7 @@ int medVMEComputeWrapping::GetViaPoint(double *viaPoint,bool isNearEndflag){
 
 	if (wrapped_vme2)
 	{
-		transformFirstDataInput->SetTransform((vtkAbstractTransform *)((mafVME *)GetWrappedVME2())->GetAbsMatrixPipe()->GetVTKTransform());
-		transformFirstDataInput->SetInput((vtkPolyData *)((mafVME *)GetWrappedVME2())->GetOutput()->GetVTKData());
-		transformFirstDataInput->Update();
-
-		transformFirstData->SetTransform((vtkAbstractTransform *)m_TmpTransform->GetVTKTransform());
-		transformFirstData->SetInput((vtkPolyData *)transformFirstDataInput->GetOutput());
-		transformFirstData->Update(); 
-
-		locator->SetDataSet(transformFirstData->GetOutput());
-		locator->SetGlobalWarningDisplay(0);
-		locator->BuildLocator();
+		locator = GetWrappedLocator(GetWrappedVME2());
 
 		insideFlag1 = locator->InsideOrOutside(startPoint);
 		insideFlag2 =  locator->InsideOrOutside(endPoint);
@@ -4608,7 +4739,7 @@ void medVMEComputeWrapping::GetCylinderAxis(mafVME *wrapped_vme,int objIdx){
 		CopyPointValue(pointOnAxis,m_CylinderAxis2);
 	}
 }
-int medVMEComputeWrapping::PrepareData(int wrappedFlag,double *local_start,double *local_via,double *local_wrapped_center, vtkOBBTree *locator)
+int medVMEComputeWrapping::PrepareData(int wrappedFlag,double *local_start,double *local_via,double *local_wrapped_center)
 {
 	int obbtreeFlag = 0;
 	mafVME *start_vme = GetStartVME();
@@ -4728,21 +4859,8 @@ int medVMEComputeWrapping::PrepareData(int wrappedFlag,double *local_start,doubl
 			return -1;
 		}	
 		// create ordered list of tangent point (2) real algorithm
-		vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstDataInput;
-		transformFirstDataInput->SetTransform((vtkAbstractTransform *)((mafVME *)wrapped_vme)->GetAbsMatrixPipe()->GetVTKTransform());
-		transformFirstDataInput->SetInput((vtkPolyData *)((mafVME *)wrapped_vme)->GetOutput()->GetVTKData());
-		transformFirstDataInput->Update();
-
-		vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstData;
-		transformFirstData->SetTransform((vtkAbstractTransform *)m_TmpTransform->GetVTKTransform());
-		transformFirstData->SetInput((vtkPolyData *)transformFirstDataInput->GetOutput());
-		transformFirstData->Update(); 
-
 		//-------test intersect---------------------
-		//vtkMAFSmartPointer<vtkOBBTree> locator;
-		locator->SetDataSet(transformFirstData->GetOutput());
-		locator->SetGlobalWarningDisplay(0);
-		locator->BuildLocator();
+		WrappedLocator *locator = GetWrappedLocator(wrapped_vme);
 
 		//Control if Start or End point is inside vtk data (surface)
 		if(locator->InsideOrOutside(local_start) <= 0 || locator->InsideOrOutside(local_via) <= 0) 
@@ -4763,7 +4881,7 @@ int medVMEComputeWrapping::PrepareData(int wrappedFlag,double *local_start,doubl
 
 }
 
-void medVMEComputeWrapping::SingleWrapAutomatedIOR(mafVME * wrapped_vme,double *local_start,double *local_end,double *local_wrapped_center,vtkOBBTree *locator){
+void medVMEComputeWrapping::SingleWrapAutomatedIOR(mafVME * wrapped_vme,double *local_start,double *local_end,double *local_wrapped_center,WrappedLocator *locator){
 
 	vtkMAFSmartPointer<vtkPoints> pointsIntersection1;
 	vtkMAFSmartPointer<vtkPoints> pointsIntersection2;
@@ -4777,9 +4895,7 @@ void medVMEComputeWrapping::SingleWrapAutomatedIOR(mafVME * wrapped_vme,double *
 	vtkNEW(ET2);
 	vtkClipPolyData *clipData; 
 
-	vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstData;
-
-	GetTwoTangentPoint(wrapped_vme,local_start,local_end,local_wrapped_center,locator,transformFirstData,pointsIntersection1,pointsIntersection2);
+	GetTwoTangentPoint(wrapped_vme,local_start,local_end,local_wrapped_center,locator,pointsIntersection1,pointsIntersection2);
 
 	if(pointsIntersection1->GetNumberOfPoints() == 0 || pointsIntersection2->GetNumberOfPoints() == 0) return;
 
@@ -4813,7 +4929,7 @@ void medVMEComputeWrapping::SingleWrapAutomatedIOR(mafVME * wrapped_vme,double *
 
 }
 
-void medVMEComputeWrapping::GetTwoTangentPoint(mafVME * wrapped_vme,double *local_start,double *local_end,double *local_wrapped_center,vtkOBBTree *locator,vtkTransformPolyDataFilter *transformFirstData ,vtkPoints *pointsIntersection1,vtkPoints *pointsIntersection2){
+void medVMEComputeWrapping::GetTwoTangentPoint(mafVME * wrapped_vme,double *local_start,double *local_end,double *local_wrapped_center,WrappedLocator *locator,vtkPoints *pointsIntersection1,vtkPoints *pointsIntersection2){
 
 	vtkMAFSmartPointer<vtkPoints> temporaryIntersection;
 	bool aligned = false;
@@ -4837,17 +4953,6 @@ void medVMEComputeWrapping::GetTwoTangentPoint(mafVME * wrapped_vme,double *loca
 	}
 
 	// create ordered list of tangent point (2) real algorithm
-	vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstDataInput;
-	transformFirstDataInput->SetTransform((vtkAbstractTransform *)((mafVME *)wrapped_vme)->GetAbsMatrixPipe()->GetVTKTransform());
-	transformFirstDataInput->SetInput((vtkPolyData *)((mafVME *)wrapped_vme)->GetOutput()->GetVTKData());
-	transformFirstDataInput->Update();
-
-	//vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstData;
-	transformFirstData->SetTransform((vtkAbstractTransform *)m_TmpTransform->GetVTKTransform());
-	transformFirstData->SetInput((vtkPolyData *)transformFirstDataInput->GetOutput());
-	transformFirstData->Update(); 
-
-
 	vtkMatrix4x4 *mat = ((mafVME *)wrapped_vme)->GetAbsMatrixPipe()->GetVTKTransform()->GetMatrix();
 	mafMatrix matrix;
 	matrix.SetVTKMatrix(mat);
@@ -5926,6 +6031,69 @@ double *medVMEComputeWrapping::GetEndPointCoordinate()
 	return m_EndPoint;
 }
 //-------------------------------------------------------------------------
+void medVMEComputeWrapping::EvaluateTimeSeries(std::vector<medVMEComputeWrapping *> &meters,
+	const std::vector<mafTimeStamp> &times, std::vector<TimeSeries> &series)
+//-------------------------------------------------------------------------
+{
+	int nMeters = (int)meters.size();
+	int nTimes = (int)times.size();
+
+	series.clear();
+	series.resize(nMeters);
+	for (int i = 0; i < nMeters; i++)
+	{
+		series[i].m_Lengths.resize(nTimes, 0.0);
+		series[i].m_NumberOfExportPoints.resize(nTimes, 0);
+		series[i].m_Points.resize(nTimes*TIME_SERIES_POINTS*3, 0.0);
+	}
+
+	if (nMeters == 0 || nTimes == 0)
+		return;
+
+	mafNode *root = meters[0]->GetRoot();
+	mafTimeStamp oldTime = meters[0]->GetTimeStamp();
+
+	mafNodeIterator *iter = root->NewIterator();
+	for (int t = 0; t < nTimes; t++)
+	{
+		// move only the VMEs, views are not involved
+		for (mafNode *node = iter->GetFirstNode(); node; node = iter->GetNextNode())
+		{
+			if (mafVME *vme = mafVME::SafeDownCast(node))
+				vme->SetTimeStamp(times[t]);
+		}
+
+		for (int i = 0; i < nMeters; i++)
+		{
+			medVMEComputeWrapping *meter = meters[i];
+			meter->GetOutput()->GetVTKData()->Modified();
+			meter->GetOutput()->GetVTKData()->Update();
+			meter->Modified();
+			meter->Update();
+
+			double *points = &series[i].m_Points[t*TIME_SERIES_POINTS*3];
+			int nExportPoints = meter->GetNumberExportPoints();
+			if (nExportPoints > TIME_SERIES_POINTS - 2)
+				nExportPoints = TIME_SERIES_POINTS - 2;
+
+			series[i].m_Lengths[t] = meter->GetDistance();
+			series[i].m_NumberOfExportPoints[t] = nExportPoints;
+
+			meter->CopyPointValue(meter->GetStartPointCoordinate(), points);
+			for (int k = 0; k < nExportPoints; k++)
+				meter->CopyPointValue(meter->GetExportPointCoordinate(k), points + 3*(k + 1));
+			meter->CopyPointValue(meter->GetEndPointCoordinate(), points + 3*(TIME_SERIES_POINTS - 1));
+		}
+	}
+
+	for (mafNode *node = iter->GetFirstNode(); node; node = iter->GetNextNode())
+	{
+		if (mafVME *vme = mafVME::SafeDownCast(node))
+			vme->SetTimeStamp(oldTime);
+	}
+	iter->Delete();
+}
+//-------------------------------------------------------------------------
 void medVMEComputeWrapping::SaveInFile()
 //-------------------------------------------------------------------------
 {
@@ -6308,21 +6476,8 @@ void medVMEComputeWrapping::InternalUpdateAutomated()//second
 			aligned = true;
 
 		// create ordered list of tangent point (2) real algorithm
-		vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstDataInput;
-		transformFirstDataInput->SetTransform((vtkAbstractTransform *)((mafVME *)wrapped_vme)->GetAbsMatrixPipe()->GetVTKTransform());
-		transformFirstDataInput->SetInput((vtkPolyData *)((mafVME *)wrapped_vme)->GetOutput()->GetVTKData());
-		transformFirstDataInput->Update();
-
-		vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstData;
-		transformFirstData->SetTransform((vtkAbstractTransform *)m_TmpTransform->GetVTKTransform());
-		transformFirstData->SetInput((vtkPolyData *)transformFirstDataInput->GetOutput());
-		transformFirstData->Update(); 
-
 		// here REAL ALGORITHM //////////////////////////////
-		vtkMAFSmartPointer<vtkOBBTree> locator;
-		locator->SetDataSet(transformFirstData->GetOutput());
-		locator->SetGlobalWarningDisplay(0);
-		locator->BuildLocator();
+		WrappedLocator *locator = GetWrappedLocator(wrapped_vme);
 
 		//Control if Start or End point is inside vtk data (surface)
 		if(locator->InsideOrOutside(local_start) <= 0 || locator->InsideOrOutside(local_end) <= 0) 
@@ -6563,6 +6718,17 @@ void medVMEComputeWrapping::InternalUpdateAutomated()//second
 		m_PlaneCutter->SetNormal(m_PlaneSource->GetNormal());
 
 
+		// the surface in the local frame of the meter is needed only by the cutter
+		vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstDataInput;
+		transformFirstDataInput->SetTransform((vtkAbstractTransform *)((mafVME *)wrapped_vme)->GetAbsMatrixPipe()->GetVTKTransform());
+		transformFirstDataInput->SetInput((vtkPolyData *)((mafVME *)wrapped_vme)->GetOutput()->GetVTKData());
+		transformFirstDataInput->Update();
+
+		vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstData;
+		transformFirstData->SetTransform((vtkAbstractTransform *)m_TmpTransform->GetVTKTransform());
+		transformFirstData->SetInput((vtkPolyData *)transformFirstDataInput->GetOutput());
+		transformFirstData->Update(); 
+
 		m_Cutter->SetInput(transformFirstData->GetOutput());
 		m_Cutter->SetCutFunction(m_PlaneCutter);
 
@@ -6737,21 +6903,8 @@ void medVMEComputeWrapping::InternalUpdateAutomatedIOR()//third
 			aligned = true;
 
 		// create ordered list of tangent point (2) real algorithm
-		vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstDataInput;
-		transformFirstDataInput->SetTransform((vtkAbstractTransform *)((mafVME *)wrapped_vme)->GetAbsMatrixPipe()->GetVTKTransform());
-		transformFirstDataInput->SetInput((vtkPolyData *)((mafVME *)wrapped_vme)->GetOutput()->GetVTKData());
-		transformFirstDataInput->Update();
-
-		vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstData;
-		transformFirstData->SetTransform((vtkAbstractTransform *)m_TmpTransform->GetVTKTransform());
-		transformFirstData->SetInput((vtkPolyData *)transformFirstDataInput->GetOutput());
-		transformFirstData->Update(); 
-
 		// here REAL ALGORITHM //////////////////////////////
-		vtkMAFSmartPointer<vtkOBBTree> locator;
-		locator->SetDataSet(transformFirstData->GetOutput());
-		locator->SetGlobalWarningDisplay(0);
-		locator->BuildLocator();
+		WrappedLocator *locator = GetWrappedLocator(wrapped_vme);
 
 		//Control if Start or End point is inside vtk data (surface)
 		if(locator->InsideOrOutside(local_start) <= 0 || locator->InsideOrOutside(local_end) <= 0) 
@@ -6889,6 +7042,17 @@ void medVMEComputeWrapping::InternalUpdateAutomatedIOR()//third
 		m_PlaneCutter->SetNormal(m_PlaneSource->GetNormal());
 
 
+		// the surface in the local frame of the meter is needed only by the cutter
+		vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstDataInput;
+		transformFirstDataInput->SetTransform((vtkAbstractTransform *)((mafVME *)wrapped_vme)->GetAbsMatrixPipe()->GetVTKTransform());
+		transformFirstDataInput->SetInput((vtkPolyData *)((mafVME *)wrapped_vme)->GetOutput()->GetVTKData());
+		transformFirstDataInput->Update();
+
+		vtkMAFSmartPointer<vtkTransformPolyDataFilter> transformFirstData;
+		transformFirstData->SetTransform((vtkAbstractTransform *)m_TmpTransform->GetVTKTransform());
+		transformFirstData->SetInput((vtkPolyData *)transformFirstDataInput->GetOutput());
+		transformFirstData->Update(); 
+
 		m_Cutter->SetInput(transformFirstData->GetOutput());
 		m_Cutter->SetCutFunction(m_PlaneCutter);
 
@@ -6995,7 +7159,7 @@ void medVMEComputeWrapping::InternalUpdateAutomatedIOR()//third
 //-----------------------------------------------------------------------
 void medVMEComputeWrapping::WrappingCore(double *init, double *center, double *end,\
 										 bool IsStart, bool controlParallel,\
-										 vtkOBBTree *locator, vtkPoints *temporaryIntersection, vtkPoints *pointsIntersection,\
+										 WrappedLocator *locator, vtkPoints *temporaryIntersection, vtkPoints *pointsIntersection,\
 										 double *versorY, double *versorZ, int nControl)
 										 //-----------------------------------------------------------------------
 {
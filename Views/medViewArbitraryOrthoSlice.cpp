@@ -103,6 +103,9 @@ const int BOUND_1=1;
 #include "vtkMAFSmartPointer.h"
 #include "vtkTextSource.h"
 #include "vtkCaptionActor2D.h"
+#include "vtkRectilinearGrid.h"
+#include "vtkMEDVolumeSlabSlicer.h"
+#include "vtkCallbackCommand.h"
 
 mafCxxTypeMacro(medViewArbitraryOrthoSlice);
 
@@ -153,6 +156,10 @@ medViewArbitraryOrthoSlice::medViewArbitraryOrthoSlice(wxString label, bool show
 	m_EnableThickness[GREEN] = 0;
 	m_EnableThickness[BLUE] = 0;
 
+	m_ThicknessProjection[RED] = vtkMEDVolumeSlabSlicer::AVERAGE_PROJECTION;
+	m_ThicknessProjection[GREEN] = vtkMEDVolumeSlabSlicer::AVERAGE_PROJECTION;
+	m_ThicknessProjection[BLUE] = vtkMEDVolumeSlabSlicer::AVERAGE_PROJECTION;
+
 	m_PathFromDialog = "";
 
 	m_EnableExportImages[RED] = 0;
@@ -1326,6 +1333,12 @@ void medViewArbitraryOrthoSlice::OnEventThis(mafEventBase *maf_event)
 			}
 			break;
 
+		case ID_THICKNESS_PROJECTION_RED:
+			{
+				OnEventID_THICKNESS_VALUE_CHANGED(RED);
+			}
+			break;
+
 		case ID_EXPORT_PLANES_HEIGHT_RED:
 			{
 				OnEventID_EXPORT_PLANES_HEIGHT(RED);
@@ -1344,6 +1357,12 @@ void medViewArbitraryOrthoSlice::OnEventThis(mafEventBase *maf_event)
 			}
 			break;
 
+		case ID_THICKNESS_PROJECTION_GREEN:
+			{
+				OnEventID_THICKNESS_VALUE_CHANGED(GREEN);
+			}
+			break;
+
 		case ID_EXPORT_PLANES_HEIGHT_GREEN:
 			{
 				OnEventID_EXPORT_PLANES_HEIGHT(GREEN);
@@ -1362,6 +1381,12 @@ void medViewArbitraryOrthoSlice::OnEventThis(mafEventBase *maf_event)
 			}
 			break;
 
+		case ID_THICKNESS_PROJECTION_BLUE:
+			{
+				OnEventID_THICKNESS_VALUE_CHANGED(BLUE);
+			}
+			break;
+
 		case ID_EXPORT_PLANES_HEIGHT_BLUE:
 			{
 				OnEventID_EXPORT_PLANES_HEIGHT(BLUE);
@@ -1464,8 +1489,13 @@ mafGUI* medViewArbitraryOrthoSlice::CreateGui()
 		"8.0", "8.5", "9.0",\
 		"9.5", "10.0","20.0","40.0", "80.0" , "100.0" , "130.0"};
 
+	// order of vtkMEDVolumeSlabSlicer::PROJECTION_MODE
+	wxString projectionChoices[3] = {"Average", "MIP", "MinIP"};
+
 	m_Gui->Label("Thickness value:");
 	m_Gui->Combo(ID_THICKNESS_VALUE_CHANGED_RED, _(""), &m_ThicknessComboAssignment[RED], 25, thicknessChoices);
+	m_Gui->Label("Projection:");
+	m_Gui->Combo(ID_THICKNESS_PROJECTION_RED, _(""), &m_ThicknessProjection[RED], 3, projectionChoices);
 
 	//-------------------------------------------------------------------
 	// GREEN Thickness
@@ -1480,6 +1510,8 @@ mafGUI* medViewArbitraryOrthoSlice::CreateGui()
 
 	m_Gui->Label("Thickness value:");
 	m_Gui->Combo(ID_THICKNESS_VALUE_CHANGED_GREEN, _(""), &m_ThicknessComboAssignment[GREEN], 25, thicknessChoices);
+	m_Gui->Label("Projection:");
+	m_Gui->Combo(ID_THICKNESS_PROJECTION_GREEN, _(""), &m_ThicknessProjection[GREEN], 3, projectionChoices);
 
 	m_Gui->Label("");
 
@@ -1496,6 +1528,8 @@ mafGUI* medViewArbitraryOrthoSlice::CreateGui()
 
 	m_Gui->Label("Thickness value:");
 	m_Gui->Combo(ID_THICKNESS_VALUE_CHANGED_BLUE, _(""), &m_ThicknessComboAssignment[BLUE], 25, thicknessChoices);
+	m_Gui->Label("Projection:");
+	m_Gui->Combo(ID_THICKNESS_PROJECTION_BLUE, _(""), &m_ThicknessProjection[BLUE], 3, projectionChoices);
 
 	m_Gui->Label("");
 
@@ -1710,15 +1744,15 @@ void medViewArbitraryOrthoSlice::PostMultiplyEventMatrixToSlicer(mafEventBase *m
 			// update thickness stuff on MOUSE_UP only
 			if (slicerAxis == X)
 			{
-				AccumulateTextures(m_SlicerX, m_ThicknessValue[slicerAxis], NULL, true);
+				AccumulateTextures(m_SlicerX, m_ThicknessValue[RED], m_ThicknessProjection[RED], NULL, true);
 			}
 			else if (slicerAxis == Y)
 			{
-				AccumulateTextures(m_SlicerY, m_ThicknessValue[slicerAxis], NULL, true);
+				AccumulateTextures(m_SlicerY, m_ThicknessValue[GREEN], m_ThicknessProjection[GREEN], NULL, true);
 			}
 			else if (slicerAxis == Z)
 			{
-				AccumulateTextures(m_SlicerZ, m_ThicknessValue[slicerAxis], NULL, true);
+				AccumulateTextures(m_SlicerZ, m_ThicknessValue[BLUE], m_ThicknessProjection[BLUE], NULL, true);
 			}
 
 		}
@@ -3209,7 +3243,7 @@ void medViewArbitraryOrthoSlice::RestoreCameraParametersForAllSubviews()
 }
 
 
-void medViewArbitraryOrthoSlice::AccumulateTextures( mafVMESlicer *inSlicer, double inRXThickness , vtkImageData *outRXTexture /*= NULL */, bool showProgressBar /*= false*/ )
+void medViewArbitraryOrthoSlice::AccumulateTextures( mafVMESlicer *inSlicer, double inRXThickness , int inProjectionMode, vtkImageData *outRXTexture /*= NULL */, bool showProgressBar /*= false*/ )
 {	
 
 	if (showProgressBar)
@@ -3218,155 +3252,71 @@ void medViewArbitraryOrthoSlice::AccumulateTextures( mafVMESlicer *inSlicer, dou
 		mafEventMacro(e);
 	}
 
-	int direction = -1;
-
-	if (inSlicer == m_SlicerX)
-	{
-		direction = X;
-	}
-	else if (inSlicer == m_SlicerY)
-	{
-		direction = Y;
-	}
-	else if (inSlicer == m_SlicerZ)
-	{
-		direction = Z;
-	}
-
+	assert(inSlicer == m_SlicerX || inSlicer == m_SlicerY || inSlicer == m_SlicerZ);
 	assert(m_InputVolume);
 	assert(m_InputVolume->IsA("mafVMEVolumeGray"));
 
-	vtkStructuredPoints *structuredPoints = vtkStructuredPoints::SafeDownCast(m_InputVolume->GetDataPipe()->GetVTKData());
-
-	// BEWARE: working for structured points only
-	// TODO REFACTOR THIS:
-	// can be easyly extended to rectilinear grid
-	assert(structuredPoints);
-
-	double spacing[3];
-
-	structuredPoints->GetSpacing(spacing);
-
-	double minSpacingXY = min(spacing[0], spacing[1]);
-	double minSpacingYZ = min(spacing[1], spacing[2]);
-	double minSpacing = min(minSpacingXY, minSpacingYZ);
-
-	double profileDistance = minSpacing;
-	int additionalProfileNumber = inRXThickness / profileDistance + 1;
-	additionalProfileNumber  /= 2;
-
-	std::ostringstream stringStream;
-	stringStream << "additional profiles number: " << additionalProfileNumber << std::endl;          
-	mafLogMessage(stringStream.str().c_str());
-
-	vtkMatrix4x4 *slicerAbsMatrix = inSlicer->GetAbsMatrixPipe()->GetMatrix().GetVTKMatrix();
-	assert(slicerAbsMatrix);
-
-	// copy the middle image to get original scalars
-	vtkMAFSmartPointer<vtkTransform> originalABSTransform;
-	originalABSTransform->SetMatrix(slicerAbsMatrix);
+	vtkDataSet *volumeData = m_InputVolume->GetDataPipe()->GetVTKData();
+	assert(vtkImageData::SafeDownCast(volumeData) || vtkRectilinearGrid::SafeDownCast(volumeData));
+	volumeData->Update();
 
+	// the texture of the middle slice gives the geometry of the projection
 	mafVMEOutputSurface *outputSurface = mafVMEOutputSurface::SafeDownCast(inSlicer->GetSurfaceOutput());
 	assert(outputSurface);
 
-	vtkImageData *slicerTexture = outputSurface->GetMaterial()->GetMaterialTexture();
-	assert(slicerTexture);
-
 	inSlicer->GetSurfaceOutput()->GetVTKData()->Modified();
 	inSlicer->GetSurfaceOutput()->GetVTKData()->Update();
 
-	// sum the texture scalars in a new image: built from original default texture
-	vtkMAFSmartPointer<vtkImageData> scalarsAccumulationTargetTexture;
-	scalarsAccumulationTargetTexture->DeepCopy(slicerTexture);	
-
-	// add the texture up scalars
-	vtkUnsignedShortArray *targetScalars = vtkUnsignedShortArray::SafeDownCast( scalarsAccumulationTargetTexture->GetPointData()->GetScalars());
-	assert(targetScalars);
-
-	assert(targetScalars->GetNumberOfComponents() == 1);
+	vtkImageData *slicerTexture = outputSurface->GetMaterial()->GetMaterialTexture();
+	assert(slicerTexture);
 
-	const int numberOfTuples = targetScalars->GetNumberOfTuples();
+	// the slicer plane in the volume reference system, where the texture origin is
+	vtkMatrix4x4 *slicerAbsMatrix = inSlicer->GetAbsMatrixPipe()->GetMatrix().GetVTKMatrix();
+	assert(slicerAbsMatrix);
 
-	std::vector<double> scalarsAccumulatorVector(numberOfTuples);
+	vtkMAFSmartPointer<vtkMatrix4x4> volumeAbsInverse;
+	vtkMatrix4x4::Invert(m_InputVolume->GetOutput()->GetAbsMatrix()->GetVTKMatrix(), volumeAbsInverse);
 
-	// total number of slices I'm accumulating
-	int numberOfSlicesToAccumulate = additionalProfileNumber * 2 + 1;
-	int slicesAlreadyProcessed = 0;
-	long progress = -1;
+	vtkMAFSmartPointer<vtkMatrix4x4> slicerToVolume;
+	vtkMatrix4x4::Multiply4x4(volumeAbsInverse, slicerAbsMatrix, slicerToVolume);
 
-	// for each profile
-	for(int profileId = -additionalProfileNumber; profileId <= additionalProfileNumber; profileId++)
+	double axisX[3], axisY[3];
+	for (int i = 0; i < 3; i++)
 	{
-		progress = (100 * ((double )slicesAlreadyProcessed) / ((double) numberOfSlicesToAccumulate));
-
-		if (showProgressBar)
-		{
-			mafEvent eUpdate(this,PROGRESSBAR_SET_VALUE,progress);
-			mafEventMacro(eUpdate);
-		}
-
-		if (profileId == 0)
-		{
-			// this is the default deepcopied texture so it is taken into account already
-			continue;
-		}
-
-		// build the profile probe matrix
-		double currentHeight = profileId * profileDistance;
-		vtkMAFSmartPointer<vtkTransform> currentSliceMatrix;
-		currentSliceMatrix->PostMultiply();
-		currentSliceMatrix->Concatenate(originalABSTransform);
-
-		if (direction == X)
-		{
-			currentSliceMatrix->Translate(currentHeight, 0, 0);
-		}
-		else if (direction == Y)
-		{
-			currentSliceMatrix->Translate(0, currentHeight, 0);
-		}
-		else if (direction == Z)
-		{
-			currentSliceMatrix->Translate(0,0,currentHeight);
-		}
-
-		currentSliceMatrix->Update();
-
-		mafMatrix currentProfileMafMatrix;
-		currentProfileMafMatrix.SetVTKMatrix(currentSliceMatrix->GetMatrix());
-
-		inSlicer->SetAbsMatrix(currentProfileMafMatrix);
-
-		inSlicer->GetSurfaceOutput()->GetVTKData()->Modified();
-		inSlicer->GetSurfaceOutput()->GetVTKData()->Update();
-
-		if (false)
-		{
-			std::ostringstream stringStream;
-			stringStream << "Slicer number: " << profileId  << " matrix" << std::endl;          
-			inSlicer->GetAbsMatrixPipe()->GetMatrix().GetVTKMatrix()->PrintSelf(stringStream, NULL);
-			mafLogMessage(stringStream.str().c_str());
-		}
-		// get the current slice profile texture
-
-		vtkImageData *currentTexture = inSlicer->GetSurfaceOutput()->GetMaterial()->GetMaterialTexture();
-		assert(currentTexture);
-
-		vtkUnsignedShortArray *currentSliceScalars = vtkUnsignedShortArray::SafeDownCast(currentTexture->GetPointData()->GetScalars());
+		axisX[i] = slicerToVolume->GetElement(i, 0);
+		axisY[i] = slicerToVolume->GetElement(i, 1);
+	}
 
+	int textureDimensions[3];
+	double textureSpacing[3];
+	slicerTexture->GetDimensions(textureDimensions);
+	slicerTexture->GetSpacing(textureSpacing);
 
-		// add the scalars to the target texture
-		for (int scalarId = 0; scalarId < numberOfTuples; scalarId++)
-		{
+	// project the slab along the slicer normal in one pass over the texture pixels
+	vtkMAFSmartPointer<vtkMEDVolumeSlabSlicer> slabSlicer;
+	slabSlicer->SetInput(volumeData);
+	slabSlicer->SetPlaneOrigin(slicerTexture->GetOrigin());
+	slabSlicer->SetPlaneAxisX(axisX);
+	slabSlicer->SetPlaneAxisY(axisY);
+	slabSlicer->SetOutputDimensions(textureDimensions[0], textureDimensions[1]);
+	slabSlicer->SetOutputSpacing(textureSpacing[0], textureSpacing[1]);
+	slabSlicer->SetOutputScalarType(slicerTexture->GetScalarType());
+	slabSlicer->SetSlabThickness(inRXThickness);
+	slabSlicer->SetProjectionMode(inProjectionMode);
 
-			unsigned short valueToAdd = currentSliceScalars->GetValue(scalarId);
-			scalarsAccumulatorVector[scalarId] += valueToAdd;
-		}
+	vtkMAFSmartPointer<vtkCallbackCommand> progressCallback;
+	if (showProgressBar)
+	{
+		progressCallback->SetCallback(OnSlabSlicerProgress);
+		progressCallback->SetClientData(this);
+		slabSlicer->AddObserver(vtkCommand::ProgressEvent, progressCallback);
+	}
 
-		slicesAlreadyProcessed += 1;
-		assert(slicesAlreadyProcessed <= numberOfSlicesToAccumulate);
+	slabSlicer->Update();
 
-	} // for each slice
+	std::ostringstream stringStream;
+	stringStream << "slab samples number: " << slabSlicer->GetNumberOfSamples() << std::endl;          
+	mafLogMessage(stringStream.str().c_str());
 
 	if (showProgressBar)
 	{
@@ -3374,27 +3324,25 @@ void medViewArbitraryOrthoSlice::AccumulateTextures( mafVMESlicer *inSlicer, dou
 		mafEventMacro(eHideProgress);
 	}
 
-	for (int scalarId = 0; scalarId < numberOfTuples; scalarId++)
+	// set the projection to the slicer
+	slicerTexture->DeepCopy(slabSlicer->GetOutput());
+
+	// if the output image data is provided deepcopy the rx texture to it
+	if (outRXTexture)
 	{
-		double oldValue = scalarsAccumulatorVector[scalarId];
-		unsigned short newValue = oldValue / numberOfSlicesToAccumulate;
-		targetScalars->SetValue(scalarId, newValue);
+		outRXTexture->DeepCopy(slabSlicer->GetOutput());
 	}
+}
 
+void medViewArbitraryOrthoSlice::OnSlabSlicerProgress( vtkObject *caller, unsigned long eventId, void *clientData, void *callData )
+{
+	medViewArbitraryOrthoSlice *view = (medViewArbitraryOrthoSlice *)clientData;
+	long progress = (long)(*((double *)callData) * 100);
 
-	// original texture 
-	inSlicer->SetAbsMatrix(originalABSTransform->GetMatrix());
-
-	inSlicer->GetSurfaceOutput()->GetVTKData()->Modified();
-	inSlicer->GetSurfaceOutput()->GetVTKData()->Update(); 
-
-	// test set accumulated image to slicer 
-	slicerTexture->DeepCopy(scalarsAccumulationTargetTexture);
-
-	// if the output image data is provided deepcopy the rx texture to it
-	if (outRXTexture)
+	mafEvent eUpdate(view,PROGRESSBAR_SET_VALUE,progress);
+	if (view->m_Listener)
 	{
-		outRXTexture->DeepCopy(scalarsAccumulationTargetTexture);
+		view->m_Listener->OnEvent(&eUpdate);
 	}
 }
 
@@ -4013,16 +3961,19 @@ void medViewArbitraryOrthoSlice::EnableThicknessGUI( bool enable , int color )
 	if (color == RED)
 	{
 		m_Gui->Enable(ID_THICKNESS_VALUE_CHANGED_RED, enable);
+		m_Gui->Enable(ID_THICKNESS_PROJECTION_RED, enable);
 		m_Gui->Enable(ID_ENABLE_THICKNESS_ACTORS_RED, enable);
 	}
 	else if (color == GREEN)
 	{
 		m_Gui->Enable(ID_THICKNESS_VALUE_CHANGED_GREEN, enable);
+		m_Gui->Enable(ID_THICKNESS_PROJECTION_GREEN, enable);
 		m_Gui->Enable(ID_ENABLE_THICKNESS_ACTORS_GREEN, enable);
 	}
 	else if (color == BLUE)
 	{
 		m_Gui->Enable(ID_THICKNESS_VALUE_CHANGED_BLUE, enable);
+		m_Gui->Enable(ID_THICKNESS_PROJECTION_BLUE, enable);
 		m_Gui->Enable(ID_ENABLE_THICKNESS_ACTORS_BLUE, enable);
 	}
 }
@@ -4134,7 +4085,7 @@ void medViewArbitraryOrthoSlice::SaveSlicesTextureToFile(int choosedExportAxis)
 		else if (m_EnableThickness[choosedExportAxis] == true) // use rx projection
 		{
 			textureToWriteOnDisk = vtkImageData::New();
-			AccumulateTextures(currentSlicer, m_ThicknessValue[choosedExportAxis], textureToWriteOnDisk, false );
+			AccumulateTextures(currentSlicer, m_ThicknessValue[choosedExportAxis], m_ThicknessProjection[choosedExportAxis], textureToWriteOnDisk, false );
 			writer->SetInput(textureToWriteOnDisk);
 			textureToWriteOnDisk->Delete();
 
@@ -4172,7 +4123,7 @@ void medViewArbitraryOrthoSlice::SaveSlicesTextureToFile(int choosedExportAxis)
 
 	if (m_EnableThickness[choosedExportAxis] == true)
 	{
-		AccumulateTextures(currentSlicer, m_ThicknessValue[choosedExportAxis], NULL, true);
+		AccumulateTextures(currentSlicer, m_ThicknessValue[choosedExportAxis], m_ThicknessProjection[choosedExportAxis], NULL, true);
 	}
 
 	currentSlicer->GetSurfaceOutput()->GetVTKData()->Modified();
@@ -4189,17 +4140,13 @@ void medViewArbitraryOrthoSlice::OnEventID_ENABLE_THICKNESS( int color )
 {
 	assert(m_InputVolume);
 
-	vtkStructuredPoints *structuredPoints = vtkStructuredPoints::SafeDownCast(m_InputVolume->GetDataPipe()->GetVTKData());
-
-	// BEWARE: working for structured points only
-	// TODO REFACTOR THIS:
-	// can be easyly extended to rectilinear grid
-	if (structuredPoints == NULL)
+	vtkDataSet *volumeData = m_InputVolume->GetDataPipe()->GetVTKData();
+	if (vtkImageData::SafeDownCast(volumeData) == NULL && vtkRectilinearGrid::SafeDownCast(volumeData) == NULL)
 	{
 		EnableThickness(false, color);
 
 		wxMessageBox(wxString::Format(
-			_("The RX accumulation works for structured points only, \n" 
+			_("The RX accumulation works for structured points and rectilinear grids only, \n" 
 			"in current release.\n", )));    
 
 		return;
@@ -4217,17 +4164,17 @@ void medViewArbitraryOrthoSlice::UpdateAllViewsThickness()
 
 	if (m_EnableThickness[RED] == true) // prevent cpu waste
 	{
-		AccumulateTextures(m_SlicerX, m_ThicknessValue[RED], NULL, true);
+		AccumulateTextures(m_SlicerX, m_ThicknessValue[RED], m_ThicknessProjection[RED], NULL, true);
 	}
 
 	if (m_EnableThickness[GREEN] == true) // prevent cpu waste
 	{
-		AccumulateTextures(m_SlicerY, m_ThicknessValue[GREEN], NULL, true);
+		AccumulateTextures(m_SlicerY, m_ThicknessValue[GREEN], m_ThicknessProjection[GREEN], NULL, true);
 	}
 
 	if (m_EnableThickness[BLUE] == true) // prevent cpu waste
 	{
-		AccumulateTextures(m_SlicerZ, m_ThicknessValue[BLUE], NULL, true);
+		AccumulateTextures(m_SlicerZ, m_ThicknessValue[BLUE], m_ThicknessProjection[BLUE], NULL, true);
 	}
 }
 
@@ -4763,7 +4710,7 @@ void medViewArbitraryOrthoSlice::SaveSlicesFromRenderWindowToFile(int chooseExpo
 		else if (m_EnableThickness[chooseExportAxis] == true)
 		{
 			textureToWriteOnDisk = vtkImageData::New();
-			AccumulateTextures(currentSlicer, m_ThicknessValue[chooseExportAxis], textureToWriteOnDisk, false );
+			AccumulateTextures(currentSlicer, m_ThicknessValue[chooseExportAxis], m_ThicknessProjection[chooseExportAxis], textureToWriteOnDisk, false );
 			writer->SetInput(textureToWriteOnDisk);
 			textureToWriteOnDisk->Delete();
 
@@ -4860,7 +4807,7 @@ void medViewArbitraryOrthoSlice::SaveSlicesFromRenderWindowToFile(int chooseExpo
 
 	if (m_EnableThickness[chooseExportAxis] == true)
 	{
-		AccumulateTextures(currentSlicer, m_ThicknessValue[chooseExportAxis], NULL, true);
+		AccumulateTextures(currentSlicer, m_ThicknessValue[chooseExportAxis], m_ThicknessProjection[chooseExportAxis], NULL, true);
 	}
 
 	currentSlicer->GetSurfaceOutput()->GetVTKData()->Modified();
@@ -5077,17 +5024,17 @@ void medViewArbitraryOrthoSlice::UpdateThickness( int axis)
 {
 	if (axis == RED) // prevent cpu waste
 	{
-		AccumulateTextures(m_SlicerX, m_ThicknessValue[RED], NULL, true);
+		AccumulateTextures(m_SlicerX, m_ThicknessValue[RED], m_ThicknessProjection[RED], NULL, true);
 	}
 
 	if (axis == GREEN) // prevent cpu waste
 	{
-		AccumulateTextures(m_SlicerY, m_ThicknessValue[GREEN], NULL, true);
+		AccumulateTextures(m_SlicerY, m_ThicknessValue[GREEN], m_ThicknessProjection[GREEN], NULL, true);
 	}
 
 	if (axis == BLUE) // prevent cpu waste
 	{
-		AccumulateTextures(m_SlicerZ, m_ThicknessValue[BLUE], NULL, true);
+		AccumulateTextures(m_SlicerZ, m_ThicknessValue[BLUE], m_ThicknessProjection[BLUE], NULL, true);
 	}
 }
 
@@ -145,6 +145,7 @@ public:
 		ID_ENABLE_THICKNESS_RED,
 		ID_ENABLE_THICKNESS_ACTORS_RED,
 		ID_THICKNESS_VALUE_CHANGED_RED,
+		ID_THICKNESS_PROJECTION_RED,
 		ID_NUMBER_OF_AXIAL_SECTIONS_RED,
 		ID_EXPORT_PLANES_HEIGHT_RED,
 		ID_ENABLE_EXPORT_IMAGES_RED,
@@ -152,6 +153,7 @@ public:
 		ID_ENABLE_THICKNESS_GREEN,
 		ID_ENABLE_THICKNESS_ACTORS_GREEN,
 		ID_THICKNESS_VALUE_CHANGED_GREEN,
+		ID_THICKNESS_PROJECTION_GREEN,
 		ID_NUMBER_OF_AXIAL_SECTIONS_GREEN,
 		ID_EXPORT_PLANES_HEIGHT_GREEN,
 		ID_ENABLE_EXPORT_IMAGES_GREEN,
@@ -159,6 +161,7 @@ public:
 		ID_ENABLE_THICKNESS_BLUE,
 		ID_ENABLE_THICKNESS_ACTORS_BLUE,
 		ID_THICKNESS_VALUE_CHANGED_BLUE,
+		ID_THICKNESS_PROJECTION_BLUE,
 		ID_NUMBER_OF_AXIAL_SECTIONS_BLUE,
 		ID_EXPORT_PLANES_HEIGHT_BLUE,
 		ID_ENABLE_EXPORT_IMAGES_BLUE,
@@ -366,9 +369,12 @@ protected:
 	/** Recalculate the RX projection for the three slicers and display it */
 	void UpdateAllViewsThickness();
 
-	/** structured points only: create rx projection for the given slicer normal and set it as slicer texture.	
-	If rxTexture is provided result of the accumulation will be deepcopied to it */
-	void AccumulateTextures(mafVMESlicer *inSlicer, double inRXThickness , vtkImageData *outRXTexture = NULL , bool showProgressBar = false);
+	/** structured points or rectilinear grid: create rx projection (average, MIP or MinIP of the slab, see vtkMEDVolumeSlabSlicer::PROJECTION_MODE)
+	for the given slicer normal and set it as slicer texture. If rxTexture is provided result of the accumulation will be deepcopied to it */
+	void AccumulateTextures(mafVMESlicer *inSlicer, double inRXThickness , int inProjectionMode, vtkImageData *outRXTexture = NULL , bool showProgressBar = false);
+
+	/** Send the progress of the slab projection of AccumulateTextures (clientData is the view) to the progress bar */
+	static void OnSlabSlicerProgress(vtkObject *caller, unsigned long eventId, void *clientData, void *callData);
 
 	/** Post multiply maf_event matrix to given slicer */
 	void PostMultiplyEventMatrixToSlicer(mafEventBase *maf_event, int slicerAxis);
@@ -533,6 +539,7 @@ protected:
 	int m_EnableThickness[3]; 
 
 	double m_ThicknessValue[3];
+	int m_ThicknessProjection[3]; //< vtkMEDVolumeSlabSlicer::PROJECTION_MODE of the thickness
 	int m_ThicknessComboAssignment[3];
 
 	wxString m_PathFromDialog;
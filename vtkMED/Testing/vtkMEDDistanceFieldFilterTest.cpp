@@ -0,0 +1,267 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: vtkMEDDistanceFieldFilterTest
+
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "mafDefines.h"
+//----------------------------------------------------------------------------
+// NOTE: Every CPP file in the MAF must include "mafDefines.h" as first.
+// This force to include Window,wxWidgets and VTK exactly in this order.
+// Failing in doing this will result in a run-time error saying:
+// "Failure#0: The value of ESP was not properly saved across a function call"
+//----------------------------------------------------------------------------
+
+#include "vtkMEDDistanceFieldFilter.h"
+#include "vtkMEDDistanceFieldFilterTest.h"
+
+#include "vtkImageData.h"
+#include "vtkPolyData.h"
+#include "vtkPoints.h"
+#include "vtkPointData.h"
+#include "vtkShortArray.h"
+#include "vtkFloatArray.h"
+#include "vtkMatrix4x4.h"
+
+#define DIM 10
+#define TOLERANCE 1.e-5
+
+//-------------------------------------------------------------------------
+void vtkMEDDistanceFieldFilterTest::setUp()
+//-------------------------------------------------------------------------
+{
+}
+//-------------------------------------------------------------------------
+void vtkMEDDistanceFieldFilterTest::tearDown()
+//-------------------------------------------------------------------------
+{
+  vtkMEDDistanceFieldFilter::ReleaseDistanceFields();
+}
+
+//-------------------------------------------------------------------------
+vtkImageData *vtkMEDDistanceFieldFilterTest::CreateVolume()
+//-------------------------------------------------------------------------
+{
+  vtkShortArray *scalars = vtkShortArray::New();
+  scalars->SetNumberOfTuples(DIM * DIM * DIM);
+  for (int z = 0; z < DIM; z++)
+    for (int y = 0; y < DIM; y++)
+      for (int x = 0; x < DIM; x++)
+      {
+        bool inside = x >= 3 && x <= 6 && y >= 3 && y <= 6 && z >= 3 && z <= 6;
+        scalars->SetValue(x + DIM * (y + DIM * z), inside ? 100 : 0);
+      }
+
+  vtkImageData *volume = vtkImageData::New();
+  volume->SetDimensions(DIM, DIM, DIM);
+  volume->SetSpacing(1, 1, 1);
+  volume->SetOrigin(0, 0, 0);
+  volume->SetScalarTypeToShort();
+  volume->GetPointData()->SetScalars(scalars);
+  vtkDEL(scalars);
+  return volume;
+}
+
+//-------------------------------------------------------------------------
+vtkPolyData *vtkMEDDistanceFieldFilterTest::CreatePoints(int numberOfPoints, const double *points)
+//-------------------------------------------------------------------------
+{
+  vtkPoints *vtkpoints = vtkPoints::New();
+  for (int i = 0; i < numberOfPoints; i++)
+    vtkpoints->InsertNextPoint(points + 3 * i);
+
+  vtkPolyData *polydata = vtkPolyData::New();
+  polydata->SetPoints(vtkpoints);
+  vtkDEL(vtkpoints);
+  return polydata;
+}
+
+//-------------------------------------------------------------------------
+void vtkMEDDistanceFieldFilterTest::TestDynamicAllocation()
+//-------------------------------------------------------------------------
+{
+  vtkMEDDistanceFieldFilter *filter = vtkMEDDistanceFieldFilter::New();
+  filter->Delete();
+}
+
+//-------------------------------------------------------------------------
+void vtkMEDDistanceFieldFilterTest::TestDistance()
+//-------------------------------------------------------------------------
+{
+  vtkImageData *volume = CreateVolume();
+
+  // outside, inside, between two voxels outside, out of the volume
+  const double points[] = {0, 4, 4,  4, 4, 4,  1.5, 4, 4,  20, 4, 4};
+  vtkPolyData *polydata = CreatePoints(4, points);
+
+  vtkMEDDistanceFieldFilter *filter = vtkMEDDistanceFieldFilter::New();
+  filter->SetInput(polydata);
+  filter->SetSource(volume);
+  filter->SetThreshold(50);
+  filter->SetMaxDistance(10);
+  filter->SetFilterModeToDistance();
+  filter->Update();
+
+  // the iso-surface is half voxel away from the voxels
+  vtkDataArray *distances = filter->GetOutput()->GetPointData()->GetScalars();
+  CPPUNIT_ASSERT(distances != NULL && distances->GetNumberOfTuples() == 4);
+  CPPUNIT_ASSERT(fabs(distances->GetTuple1(0) - 2.5) < TOLERANCE);
+  CPPUNIT_ASSERT(fabs(distances->GetTuple1(1) + 1.5) < TOLERANCE);
+  CPPUNIT_ASSERT(fabs(distances->GetTuple1(2) - 1.0) < TOLERANCE);
+  CPPUNIT_ASSERT(fabs(distances->GetTuple1(3) - 10.0) < TOLERANCE);
+
+  // distances are clamped to MaxDistance
+  filter->SetMaxDistance(2);
+  filter->Update();
+  distances = filter->GetOutput()->GetPointData()->GetScalars();
+  CPPUNIT_ASSERT(fabs(distances->GetTuple1(0) - 2.0) < TOLERANCE);
+  CPPUNIT_ASSERT(fabs(distances->GetTuple1(1) + 1.5) < TOLERANCE);
+  CPPUNIT_ASSERT(fabs(distances->GetTuple1(3) - 2.0) < TOLERANCE);
+
+  vtkDEL(filter);
+  vtkDEL(polydata);
+  vtkDEL(volume);
+}
+
+//-------------------------------------------------------------------------
+void vtkMEDDistanceFieldFilterTest::TestDensity()
+//-------------------------------------------------------------------------
+{
+  vtkImageData *volume = CreateVolume();
+
+  const double points[] = {4, 4, 4,  2.5, 4, 4,  20, 4, 4};
+  vtkPolyData *polydata = CreatePoints(3, points);
+
+  vtkMEDDistanceFieldFilter *filter = vtkMEDDistanceFieldFilter::New();
+  filter->SetInput(polydata);
+  filter->SetSource(volume);
+  filter->SetFilterModeToDensity();
+  filter->Update();
+
+  vtkDataArray *densities = filter->GetOutput()->GetPointData()->GetScalars();
+  CPPUNIT_ASSERT(densities != NULL && densities->GetNumberOfTuples() == 3);
+  CPPUNIT_ASSERT(fabs(densities->GetTuple1(0) - 100.0) < TOLERANCE);
+  CPPUNIT_ASSERT(fabs(densities->GetTuple1(1) - 50.0) < TOLERANCE);
+  CPPUNIT_ASSERT(fabs(densities->GetTuple1(2)) < TOLERANCE);
+
+  vtkDEL(filter);
+  vtkDEL(polydata);
+  vtkDEL(volume);
+}
+
+//-------------------------------------------------------------------------
+void vtkMEDDistanceFieldFilterTest::TestInputMatrix()
+//-------------------------------------------------------------------------
+{
+  vtkImageData *volume = CreateVolume();
+
+  const double points[] = {-1, 4, 4};
+  vtkPolyData *polydata = CreatePoints(1, points);
+
+  vtkMatrix4x4 *matrix = vtkMatrix4x4::New();
+  matrix->SetElement(0, 3, 1);
+
+  vtkMEDDistanceFieldFilter *filter = vtkMEDDistanceFieldFilter::New();
+  filter->SetInput(polydata);
+  filter->SetSource(volume);
+  filter->SetThreshold(50);
+  filter->SetInputMatrix(matrix);
+  filter->Update();
+  CPPUNIT_ASSERT(fabs(filter->GetOutput()->GetPointData()->GetScalars()->GetTuple1(0) - 2.5) < TOLERANCE);
+
+  // changes of the matrix update the output
+  matrix->SetElement(0, 3, 2);
+  filter->Update();
+  CPPUNIT_ASSERT(fabs(filter->GetOutput()->GetPointData()->GetScalars()->GetTuple1(0) - 1.5) < TOLERANCE);
+
+  vtkDEL(filter);
+  vtkDEL(matrix);
+  vtkDEL(polydata);
+  vtkDEL(volume);
+}
+
+//-------------------------------------------------------------------------
+void vtkMEDDistanceFieldFilterTest::TestDistanceFieldCache()
+//-------------------------------------------------------------------------
+{
+  vtkImageData *volume = CreateVolume();
+
+  vtkFloatArray *field = vtkMEDDistanceFieldFilter::GetDistanceField(volume, 50);
+  CPPUNIT_ASSERT(field != NULL && field->GetNumberOfTuples() == DIM * DIM * DIM);
+  CPPUNIT_ASSERT(vtkMEDDistanceFieldFilter::GetDistanceField(volume, 50) == field);
+
+  vtkFloatArray *otherField = vtkMEDDistanceFieldFilter::GetDistanceField(volume, 150);
+  CPPUNIT_ASSERT(otherField != field);
+  CPPUNIT_ASSERT(vtkMEDDistanceFieldFilter::GetDistanceField(volume, 50) == field);
+
+  // without voxels inside the distance is infinite
+  CPPUNIT_ASSERT(otherField->GetValue(0) == VTK_FLOAT_MAX);
+
+  // the field of a modified volume is computed again
+  vtkDataArray *scalars = volume->GetPointData()->GetScalars();
+  scalars->FillComponent(0, 100);
+  scalars->Modified();
+  field = vtkMEDDistanceFieldFilter::GetDistanceField(volume, 50);
+  CPPUNIT_ASSERT(field->GetValue(0) == -VTK_FLOAT_MAX);
+
+  // the fields of a volume are released with their reference to it, the other fields are kept
+  vtkImageData *otherVolume = CreateVolume();
+  vtkMEDDistanceFieldFilter::GetDistanceField(otherVolume, 50);
+  CPPUNIT_ASSERT(volume->GetReferenceCount() == 2 && otherVolume->GetReferenceCount() == 2);
+  vtkMEDDistanceFieldFilter::ReleaseDistanceFields(volume);
+  CPPUNIT_ASSERT(volume->GetReferenceCount() == 1 && otherVolume->GetReferenceCount() == 2);
+
+  vtkMEDDistanceFieldFilter::ReleaseDistanceFields();
+  CPPUNIT_ASSERT(otherVolume->GetReferenceCount() == 1);
+  vtkDEL(otherVolume);
+  vtkDEL(volume);
+}
+
+//-------------------------------------------------------------------------
+void vtkMEDDistanceFieldFilterTest::TestThreads()
+//-------------------------------------------------------------------------
+{
+  vtkImageData *volume = CreateVolume();
+
+  // 20000 points are split among 4 threads
+  const int numberOfPoints = 20000;
+  double *points = new double[3 * numberOfPoints];
+  for (int i = 0; i < 3 * numberOfPoints; i++)
+    points[i] = -1.0 + ((i * 7919) % 1201) / 100.0;
+  vtkPolyData *polydata = CreatePoints(numberOfPoints, points);
+  delete[] points;
+
+  vtkMEDDistanceFieldFilter *filter = vtkMEDDistanceFieldFilter::New();
+  filter->SetInput(polydata);
+  filter->SetSource(volume);
+  filter->SetThreshold(50);
+  filter->SetNumberOfThreads(1);
+  filter->Update();
+
+  vtkFloatArray *serialDistances = vtkFloatArray::New();
+  serialDistances->DeepCopy(filter->GetOutput()->GetPointData()->GetScalars());
+
+  filter->SetNumberOfThreads(4);
+  filter->Update();
+  vtkDataArray *parallelDistances = filter->GetOutput()->GetPointData()->GetScalars();
+
+  CPPUNIT_ASSERT(serialDistances->GetNumberOfTuples() == parallelDistances->GetNumberOfTuples());
+  for (int i = 0; i < numberOfPoints; i++)
+  {
+    CPPUNIT_ASSERT(serialDistances->GetTuple1(i) == parallelDistances->GetTuple1(i));
+  }
+
+  vtkDEL(serialDistances);
+  vtkDEL(filter);
+  vtkDEL(polydata);
+  vtkDEL(volume);
+}
@@ -0,0 +1,98 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: vtkMEDDistanceFieldFilterTest
+
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __CPP_UNIT_vtkMEDDistanceFieldFilterTEST_H__
+#define __CPP_UNIT_vtkMEDDistanceFieldFilterTEST_H__
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/BriefTestProgressListener.h>
+#include <cppunit/CompilerOutputter.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/TestResult.h>
+#include <cppunit/TestResultCollector.h>
+#include <cppunit/TestRunner.h>
+
+//-----------------------------------------------------
+// forward references:
+//-----------------------------------------------------
+
+class vtkImageData;
+class vtkPolyData;
+
+class vtkMEDDistanceFieldFilterTest : public CPPUNIT_NS::TestFixture
+{
+  public:
+  // CPPUNIT fixture: executed before each test
+  void setUp();
+
+  // CPPUNIT fixture: executed after each test
+  void tearDown();
+
+  CPPUNIT_TEST_SUITE( vtkMEDDistanceFieldFilterTest );
+  CPPUNIT_TEST( TestDynamicAllocation );
+  CPPUNIT_TEST( TestDistance );
+  CPPUNIT_TEST( TestDensity );
+  CPPUNIT_TEST( TestInputMatrix );
+  CPPUNIT_TEST( TestDistanceFieldCache );
+  CPPUNIT_TEST( TestThreads );
+  CPPUNIT_TEST_SUITE_END();
+
+  protected:
+  void TestDynamicAllocation();
+  /** signed distance of points outside, inside and out of the volume */
+  void TestDistance();
+  /** interpolated density of points inside and out of the volume */
+  void TestDensity();
+  /** points are transformed by the input matrix */
+  void TestInputMatrix();
+  /** distance fields are reused for the same volume and threshold */
+  void TestDistanceFieldCache();
+  /** the output does not depend on the number of threads */
+  void TestThreads();
+
+  /** create the test volume (a cube of value 100 from 3 to 6 in a volume of value 0 from 0 to 9) */
+  vtkImageData *CreateVolume();
+
+  /** create a polydata with the given points */
+  vtkPolyData *CreatePoints(int numberOfPoints, const double *points);
+};
+
+int
+main( int argc, char* argv[] )
+{
+  // Create the event manager and test controller
+  CPPUNIT_NS::TestResult controller;
+
+  // Add a listener that colllects test result
+  CPPUNIT_NS::TestResultCollector result;
+  controller.addListener( &result );
+
+  // Add a listener that print dots as test run.
+  CPPUNIT_NS::BriefTestProgressListener progress;
+  controller.addListener( &progress );
+
+  // Add the top suite to the test runner
+  CPPUNIT_NS::TestRunner runner;
+  runner.addTest( vtkMEDDistanceFieldFilterTest::suite());
+  runner.run( controller );
+
+  // Print test in a compiler compatible format.
+  CPPUNIT_NS::CompilerOutputter outputter( &result, CPPUNIT_NS::stdCOut() );
+  outputter.write();
+
+  return result.wasSuccessful() ? 0 : 1;
+}
+
+#endif
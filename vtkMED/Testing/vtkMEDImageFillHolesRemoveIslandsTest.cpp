@@ -46,6 +46,7 @@
 #include "vtkJPEGReader.h"
 #include "vtkPointData.h"
 #include "vtkTimerLog.h"
+#include "vtkUnsignedCharArray.h"
 
 #include "mafString.h"
 
@@ -119,6 +120,169 @@ void vtkMEDImageFillHolesRemoveIslandsTest::TestRemoveIslands()
   TestAlgorithm();
 }
 
+//--------------------------------------------
+void vtkMEDImageFillHolesRemoveIslandsTest::TestConnectedComponents()
+//--------------------------------------------
+{
+  // 4 slices of a square with a hole of 2x2 pixels in every slice and a hole of 5x5 pixels in slices 1 and 2
+  int dims[3] = {20,20,4};
+  vtkMAFSmartPointer<vtkStructuredPoints> image;
+  image->SetDimensions(dims);
+  image->SetSpacing(1.0,1.0,1.0);
+  image->SetScalarTypeToUnsignedChar();
+
+  vtkMAFSmartPointer<vtkUnsignedCharArray> scalars;
+  scalars->SetName("SCALARS");
+  scalars->SetNumberOfTuples(dims[0]*dims[1]*dims[2]);
+  for (int z = 0, i = 0; z < dims[2]; z++)
+  {
+    for (int y = 0; y < dims[1]; y++)
+    {
+      for (int x = 0; x < dims[0]; x++, i++)
+      {
+        bool on = x >= 2 && x < 18 && y >= 2 && y < 18;
+        bool smallHole = x >= 4 && x < 6 && y >= 4 && y < 6;
+        bool bigHole = z >= 1 && z < 3 && x >= 9 && x < 14 && y >= 9 && y < 14;
+        scalars->SetTuple1(i, on && !smallHole && !bigHole ? ON_PIXEL : OFF_PIXEL);
+      }
+    }
+  }
+  image->GetPointData()->SetScalars(scalars);
+  image->Update();
+
+  vtkMEDImageFillHolesRemoveIslands *filter = vtkMEDImageFillHolesRemoveIslands::New();
+  filter->SetInput(image);
+  filter->SetAlgorithmToFillHoles();
+  filter->SetEdgeSize(3);
+
+  // slices: only the small hole is filled, in every slice
+  filter->SetMethodToConnectedComponents2D();
+  filter->Update();
+  vtkDataArray *output = filter->GetOutput()->GetPointData()->GetScalars();
+  for (int z = 0; z < dims[2]; z++)
+  {
+    int offset = z*dims[0]*dims[1];
+    CPPUNIT_ASSERT(output->GetTuple1(offset + 4*dims[0] + 4) == ON_PIXEL);
+    CPPUNIT_ASSERT(output->GetTuple1(offset + 5*dims[0] + 5) == ON_PIXEL);
+    CPPUNIT_ASSERT(output->GetTuple1(offset + 11*dims[0] + 11) == (z >= 1 && z < 3 ? OFF_PIXEL : ON_PIXEL));
+    CPPUNIT_ASSERT(output->GetTuple1(offset) == OFF_PIXEL);
+  }
+
+  // volume: the small hole touches the first and the last slices, the big hole is 5 pixels wide
+  filter->SetMethodToConnectedComponents3D();
+  filter->SetEdgeSize(5);
+  filter->Update();
+  output = filter->GetOutput()->GetPointData()->GetScalars();
+  for (int z = 0; z < dims[2]; z++)
+  {
+    int offset = z*dims[0]*dims[1];
+    CPPUNIT_ASSERT(output->GetTuple1(offset + 4*dims[0] + 4) == OFF_PIXEL);
+    CPPUNIT_ASSERT(output->GetTuple1(offset + 11*dims[0] + 11) == ON_PIXEL);
+  }
+
+  // the maximum area excludes the big hole
+  filter->SetMaximumArea(49);
+  filter->Update();
+  output = filter->GetOutput()->GetPointData()->GetScalars();
+  CPPUNIT_ASSERT(output->GetTuple1(dims[0]*dims[1] + 11*dims[0] + 11) == OFF_PIXEL);
+
+  filter->Delete();
+}
+//--------------------------------------------
+void vtkMEDImageFillHolesRemoveIslandsTest::TestConnectedComponents2DAgainstSquareScan()
+//--------------------------------------------
+{
+  mafString filename = MED_DATA_ROOT;
+  filename<<"/Test_ImageFillHolesRemoveIslands/test.bmp";
+
+  vtkBMPReader *r = vtkBMPReader::New();
+  r->SetFileName(filename.GetCStr());
+  r->Allow8BitBMPOn();
+  r->SetDataScalarTypeToUnsignedChar();
+  r->Update();
+
+  vtkMAFSmartPointer<vtkStructuredPoints> image;
+  image->SetSpacing(r->GetOutput()->GetSpacing());
+  image->SetDimensions(r->GetOutput()->GetDimensions());
+  image->SetScalarTypeToUnsignedChar();
+
+  vtkMAFSmartPointer<vtkUnsignedCharArray> scalars;
+  scalars->SetName("SCALARS");
+  for(int i=0; i<image->GetNumberOfPoints();i++)
+  {
+    scalars->InsertNextTuple1(r->GetOutput()->GetPointData()->GetScalars()->GetTuple(i)[0] > 127 ? ON_PIXEL : OFF_PIXEL);
+  }
+  image->GetPointData()->SetScalars(scalars);
+  image->Update();
+  r->Delete();
+
+  CompareMethods(image);
+
+  // noise: many small islands and holes near each other, to the border and to the corners of the squares
+  int dims[3] = {64,48,1};
+  vtkMAFSmartPointer<vtkStructuredPoints> noise;
+  noise->SetDimensions(dims);
+  noise->SetSpacing(1.0,1.0,1.0);
+  noise->SetScalarTypeToUnsignedChar();
+
+  vtkMAFSmartPointer<vtkUnsignedCharArray> noiseScalars;
+  noiseScalars->SetName("SCALARS");
+  noiseScalars->SetNumberOfTuples(dims[0]*dims[1]);
+  unsigned int seed = 12345;
+  for (int i = 0; i < dims[0]*dims[1]; i++)
+  {
+    seed = seed*1103515245 + 12345;
+    noiseScalars->SetTuple1(i, ((seed >> 16) % 100) < 70 ? ON_PIXEL : OFF_PIXEL);
+  }
+  noise->GetPointData()->SetScalars(noiseScalars);
+  noise->Update();
+
+  CompareMethods(noise);
+}
+//--------------------------------------------
+void vtkMEDImageFillHolesRemoveIslandsTest::CompareMethods(vtkStructuredPoints *image)
+//--------------------------------------------
+{
+  vtkMEDImageFillHolesRemoveIslands *scan = vtkMEDImageFillHolesRemoveIslands::New();
+  scan->SetInput(image);
+  scan->SetMethodToSquareScan();
+
+  vtkMEDImageFillHolesRemoveIslands *components = vtkMEDImageFillHolesRemoveIslands::New();
+  components->SetInput(image);
+  components->SetMethodToConnectedComponents2D();
+
+  for (int algorithm = vtkMEDImageFillHolesRemoveIslands::FILL_HOLES; algorithm <= vtkMEDImageFillHolesRemoveIslands::REMOVE_ISLANDS; algorithm++)
+  {
+    for (int peninsula = 0; peninsula < 2; peninsula++)
+    {
+      for (int edgeSize = 1; edgeSize <= 4; edgeSize++)
+      {
+        scan->SetAlgorithm(algorithm);
+        scan->SetRemovePeninsulaRegions(peninsula == 1);
+        scan->SetEdgeSize(edgeSize);
+        scan->Modified();
+        scan->Update();
+
+        components->SetAlgorithm(algorithm);
+        components->SetRemovePeninsulaRegions(peninsula == 1);
+        components->SetEdgeSize(edgeSize);
+        components->Modified();
+        components->Update();
+
+        vtkDataArray *scanScalars = scan->GetOutput()->GetPointData()->GetScalars();
+        vtkDataArray *componentsScalars = components->GetOutput()->GetPointData()->GetScalars();
+        CPPUNIT_ASSERT(scanScalars->GetNumberOfTuples() == componentsScalars->GetNumberOfTuples());
+        for (int i = 0; i < scanScalars->GetNumberOfTuples(); i++)
+        {
+          CPPUNIT_ASSERT(scanScalars->GetTuple1(i) == componentsScalars->GetTuple1(i));
+        }
+      }
+    }
+  }
+
+  scan->Delete();
+  components->Delete();
+}
 //--------------------------------------------
 void vtkMEDImageFillHolesRemoveIslandsTest::TestAlgorithm()
 //--------------------------------------------
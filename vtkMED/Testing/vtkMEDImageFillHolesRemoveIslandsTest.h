@@ -31,6 +31,7 @@
 //------------------------------------------------------------------------------
 class vtkRenderWindow;
 class vtkActor;
+class vtkStructuredPoints;
 
 //------------------------------------------------------------------------------
 // Test class for vtkMEDImageFillHolesRemoveIslands
@@ -50,6 +51,8 @@ class vtkMEDImageFillHolesRemoveIslandsTest : public CPPUNIT_NS::TestFixture
     CPPUNIT_TEST( TestDynamicAllocation );
     CPPUNIT_TEST( TestFillHoles );
     CPPUNIT_TEST( TestRemoveIslands );
+    CPPUNIT_TEST( TestConnectedComponents );
+    CPPUNIT_TEST( TestConnectedComponents2DAgainstSquareScan );
     CPPUNIT_TEST_SUITE_END();
 
   protected:
@@ -59,11 +62,17 @@ class vtkMEDImageFillHolesRemoveIslandsTest : public CPPUNIT_NS::TestFixture
     void TestDynamicAllocation();
     void TestFillHoles();
     void TestRemoveIslands();
+    /** Fill holes recognised by connected components of slices and of the volume */
+    void TestConnectedComponents();
+    /** Connected components of a slice and the square scan give the same mask for every algorithm, edge size
+    and peninsula option, on the test image and on noise */
+    void TestConnectedComponents2DAgainstSquareScan();
     
     //accessories
     void RenderData(vtkActor *actor );
     void CompareImages(vtkRenderWindow * renwin);
     void TestAlgorithm();
+    void CompareMethods(vtkStructuredPoints *image);
 
     int m_Algorithm;
 };
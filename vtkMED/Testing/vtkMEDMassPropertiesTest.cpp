@@ -0,0 +1,167 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: vtkMEDMassPropertiesTest
+ 
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "mafDefines.h" 
+//----------------------------------------------------------------------------
+// NOTE: Every CPP file in the MAF must include "mafDefines.h" as first.
+// This force to include Window,wxWidgets and VTK exactly in this order.
+// Failing in doing this will result in a run-time error saying:
+// "Failure#0: The value of ESP was not properly saved across a function call"
+//----------------------------------------------------------------------------
+
+#include "vtkMEDMassPropertiesTest.h"
+#include "vtkMEDMassProperties.h"
+
+#include "vtkMAFSmartPointer.h"
+#include "vtkCubeSource.h"
+#include "vtkSphereSource.h"
+#include "vtkTriangleFilter.h"
+#include "vtkStripper.h"
+#include "vtkMassProperties.h"
+#include "vtkPolyData.h"
+
+#define EPSILON 1.e-9
+
+//-------------------------------------------------------------------------
+void vtkMEDMassPropertiesTest::TestDynamicAllocation()
+//-------------------------------------------------------------------------
+{
+  vtkMEDMassProperties *filter = vtkMEDMassProperties::New();
+  filter->Delete();
+}
+//-------------------------------------------------------------------------
+void vtkMEDMassPropertiesTest::TestBox()
+//-------------------------------------------------------------------------
+{
+  // box 2 x 3 x 4 centred at (1000, -500, 250), quads are triangulated as fans
+  vtkMAFSmartPointer<vtkCubeSource> cube;
+  cube->SetXLength(2.0);
+  cube->SetYLength(3.0);
+  cube->SetZLength(4.0);
+  cube->SetCenter(1000.0, -500.0, 250.0);
+  cube->Update();
+
+  vtkMAFSmartPointer<vtkMEDMassProperties> filter;
+  filter->SetInput(cube->GetOutput());
+  filter->SetDensity(2.0);
+  filter->Update();
+
+  CPPUNIT_ASSERT(filter->GetNumberOfTriangles() == 12);
+  CPPUNIT_ASSERT(fabs(filter->GetVolume() - 24.0) < EPSILON);
+  CPPUNIT_ASSERT(fabs(filter->GetMass() - 48.0) < EPSILON);
+
+  double cm[3];
+  filter->GetCenterOfMass(cm);
+  CPPUNIT_ASSERT(fabs(cm[0] - 1000.0) < EPSILON && fabs(cm[1] + 500.0) < EPSILON && fabs(cm[2] - 250.0) < EPSILON);
+
+  // I = m / 12 * (b^2 + c^2), products of inertia are zero
+  double expected[9] = { 4.0*(9.0 + 16.0), 0, 0, 0, 4.0*(4.0 + 16.0), 0, 0, 0, 4.0*(4.0 + 9.0) };
+  double* tensor = filter->GetInertiaTensor();
+  for (int i = 0; i < 9; i++)
+  {
+    CPPUNIT_ASSERT(fabs(tensor[i] - expected[i]) < 1.e-6);
+  }
+
+  double principal[3];
+  filter->GetPrincipalMoments(principal);
+  CPPUNIT_ASSERT(fabs(principal[0] - expected[0]) < 1.e-6);
+  CPPUNIT_ASSERT(fabs(principal[1] - expected[4]) < 1.e-6);
+  CPPUNIT_ASSERT(fabs(principal[2] - expected[8]) < 1.e-6);
+}
+//-------------------------------------------------------------------------
+void vtkMEDMassPropertiesTest::TestSphere()
+//-------------------------------------------------------------------------
+{
+  vtkMAFSmartPointer<vtkSphereSource> sphere;
+  sphere->SetRadius(5.0);
+  sphere->SetThetaResolution(64);
+  sphere->SetPhiResolution(64);
+  sphere->Update();
+
+  vtkMAFSmartPointer<vtkMassProperties> vtkMass;
+  vtkMass->SetInput(sphere->GetOutput());
+
+  vtkMAFSmartPointer<vtkMEDMassProperties> filter;
+  filter->SetInput(sphere->GetOutput());
+  filter->Update();
+
+  // the same polyhedron as measured by VTK
+  double volume = filter->GetVolume();
+  CPPUNIT_ASSERT(fabs(volume - vtkMass->GetVolume()) < 1.e-6*volume);
+
+  // close to the analytic sphere: I = 2/5 m r^2
+  double principal[3];
+  filter->GetPrincipalMoments(principal);
+  for (int i = 0; i < 3; i++)
+  {
+    double expected = 0.4 * volume * 25.0;
+    CPPUNIT_ASSERT(fabs(principal[i] - expected) < 0.01*expected);
+  }
+}
+//-------------------------------------------------------------------------
+void vtkMEDMassPropertiesTest::TestStrips()
+//-------------------------------------------------------------------------
+{
+  vtkMAFSmartPointer<vtkSphereSource> sphere;
+  sphere->SetCenter(10.0, 20.0, 30.0);
+  sphere->SetThetaResolution(32);
+  sphere->SetPhiResolution(32);
+
+  vtkMAFSmartPointer<vtkStripper> stripper;
+  stripper->SetInput(sphere->GetOutput());
+  stripper->Update();
+
+  vtkMAFSmartPointer<vtkMEDMassProperties> triangles;
+  triangles->SetInput(sphere->GetOutput());
+  triangles->Update();
+
+  vtkMAFSmartPointer<vtkMEDMassProperties> strips;
+  strips->SetInput(stripper->GetOutput());
+  strips->Update();
+
+  CPPUNIT_ASSERT(stripper->GetOutput()->GetNumberOfStrips() > 0);
+  CPPUNIT_ASSERT(triangles->GetNumberOfTriangles() == strips->GetNumberOfTriangles());
+  CPPUNIT_ASSERT(fabs(triangles->GetVolume() - strips->GetVolume()) < EPSILON);
+  for (int i = 0; i < 9; i++)
+  {
+    CPPUNIT_ASSERT(fabs(triangles->GetInertiaTensor()[i] - strips->GetInertiaTensor()[i]) < EPSILON);
+  }
+}
+//-------------------------------------------------------------------------
+void vtkMEDMassPropertiesTest::TestThreads()
+//-------------------------------------------------------------------------
+{
+  // more triangles than one task processes
+  vtkMAFSmartPointer<vtkSphereSource> sphere;
+  sphere->SetThetaResolution(256);
+  sphere->SetPhiResolution(256);
+  sphere->Update();
+
+  vtkMAFSmartPointer<vtkMEDMassProperties> filter1;
+  filter1->SetInput(sphere->GetOutput());
+  filter1->SetNumberOfThreads(1);
+  filter1->Update();
+
+  vtkMAFSmartPointer<vtkMEDMassProperties> filter4;
+  filter4->SetInput(sphere->GetOutput());
+  filter4->SetNumberOfThreads(4);
+  filter4->Update();
+
+  CPPUNIT_ASSERT(filter1->GetVolume() == filter4->GetVolume());
+  for (int i = 0; i < 9; i++)
+  {
+    CPPUNIT_ASSERT(filter1->GetInertiaTensor()[i] == filter4->GetInertiaTensor()[i]);
+  }
+}
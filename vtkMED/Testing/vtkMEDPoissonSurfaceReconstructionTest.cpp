@@ -0,0 +1,103 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: vtkMEDPoissonSurfaceReconstructionTest
+
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "mafDefines.h"
+//----------------------------------------------------------------------------
+// NOTE: Every CPP file in the MAF must include "mafDefines.h" as first.
+// This force to include Window,wxWidgets and VTK exactly in this order.
+// Failing in doing this will result in a run-time error saying:
+// "Failure#0: The value of ESP was not properly saved across a function call"
+//----------------------------------------------------------------------------
+
+#include "vtkMEDPoissonSurfaceReconstruction.h"
+#include "vtkMEDPoissonSurfaceReconstructionTest.h"
+
+#include "vtkSphereSource.h"
+#include "vtkPolyData.h"
+#include "vtkCellArray.h"
+
+//-------------------------------------------------------------------------
+void vtkMEDPoissonSurfaceReconstructionTest::setUp()
+//-------------------------------------------------------------------------
+{
+}
+//-------------------------------------------------------------------------
+void vtkMEDPoissonSurfaceReconstructionTest::tearDown()
+//-------------------------------------------------------------------------
+{
+}
+
+//-------------------------------------------------------------------------
+void vtkMEDPoissonSurfaceReconstructionTest::TestDynamicAllocation()
+//-------------------------------------------------------------------------
+{
+  vtkMEDPoissonSurfaceReconstruction *filter = vtkMEDPoissonSurfaceReconstruction::New();
+  CPPUNIT_ASSERT(filter->GetNumberOfThreads() >= 1);
+  filter->Delete();
+}
+
+//-------------------------------------------------------------------------
+void vtkMEDPoissonSurfaceReconstructionTest::TestThreads()
+//-------------------------------------------------------------------------
+{
+  // points and normals dense enough to solve the finest depth with more threads
+  vtkSphereSource *sphere = vtkSphereSource::New();
+  sphere->SetRadius(10);
+  sphere->SetThetaResolution(256);
+  sphere->SetPhiResolution(256);
+  sphere->Update();
+
+  vtkMEDPoissonSurfaceReconstruction *filter = vtkMEDPoissonSurfaceReconstruction::New();
+  filter->SetInput(sphere->GetOutput());
+  filter->SetNumberOfThreads(1);
+  filter->Update();
+
+  vtkPolyData *serialSurface = vtkPolyData::New();
+  serialSurface->DeepCopy(filter->GetOutput());
+  CPPUNIT_ASSERT(serialSurface->GetNumberOfPoints() > 0 && serialSurface->GetNumberOfPolys() > 0);
+  CPPUNIT_ASSERT(filter->GetNumberOfThreadedSteps() == 0);
+
+  filter->SetNumberOfThreads(4);
+  filter->Update();
+  // the finest depth must be big enough to be solved by more threads
+  CPPUNIT_ASSERT(filter->GetNumberOfThreadedSteps() > 0);
+  vtkPolyData *parallelSurface = filter->GetOutput();
+
+  CPPUNIT_ASSERT(serialSurface->GetNumberOfPoints() == parallelSurface->GetNumberOfPoints());
+  CPPUNIT_ASSERT(serialSurface->GetNumberOfPolys() == parallelSurface->GetNumberOfPolys());
+  for (int i = 0; i < serialSurface->GetNumberOfPoints(); i++)
+  {
+    double *serialPoint = serialSurface->GetPoint(i);
+    double *parallelPoint = parallelSurface->GetPoint(i);
+    CPPUNIT_ASSERT(serialPoint[0] == parallelPoint[0] && serialPoint[1] == parallelPoint[1] && serialPoint[2] == parallelPoint[2]);
+  }
+
+  vtkIdType serialSize, parallelSize, *serialIds, *parallelIds;
+  serialSurface->GetPolys()->InitTraversal();
+  parallelSurface->GetPolys()->InitTraversal();
+  while (serialSurface->GetPolys()->GetNextCell(serialSize, serialIds))
+  {
+    CPPUNIT_ASSERT(parallelSurface->GetPolys()->GetNextCell(parallelSize, parallelIds));
+    CPPUNIT_ASSERT(serialSize == parallelSize);
+    for (int j = 0; j < serialSize; j++)
+    {
+      CPPUNIT_ASSERT(serialIds[j] == parallelIds[j]);
+    }
+  }
+
+  serialSurface->Delete();
+  filter->Delete();
+  sphere->Delete();
+}
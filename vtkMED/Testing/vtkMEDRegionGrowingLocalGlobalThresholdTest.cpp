@@ -29,6 +29,10 @@
 #include "vtkDoubleArray.h"
 #include "vtkPointData.h"
 #include "vtkDataSetWriter.h"
+#include "vtkShortArray.h"
+
+#include <math.h>
+#include <stdlib.h>
 
 #define X_DIM 4
 #define Y_DIM 3
@@ -265,3 +269,79 @@ void vtkMEDRegionGrowingLocalGlobalThresholdTest::TestBorderCreate()
   m_Filter->Delete();
   imBordered->Delete();
 }
+//-------------------------------------------------------------------------
+void vtkMEDRegionGrowingLocalGlobalThresholdTest::TestExecuteNeighbourhood()
+//-------------------------------------------------------------------------
+{
+  //more slices than a slab to have more tasks
+  int dims[3] = {9,7,40};
+  int numberOfPoints = dims[0]*dims[1]*dims[2];
+
+  vtkImageData *image = vtkImageData::New();
+  image->SetDimensions(dims);
+  image->SetSpacing(1.0,1.0,1.0);
+  image->Update();
+
+  vtkShortArray *scalars = vtkShortArray::New();
+  scalars->SetNumberOfTuples(numberOfPoints);
+  scalars->SetName("Scalars");
+
+  srand(1);
+  for (int i=0;i<numberOfPoints;i++)
+  {
+    scalars->SetTuple1(i,(double)(rand()%200 - 50));
+  }
+
+  image->GetPointData()->AddArray(scalars);
+  image->GetPointData()->SetActiveScalars("Scalars");
+  image->Update();
+
+  m_Filter = vtkMEDRegionGrowingLocalGlobalThreshold::New();
+  m_Filter->SetInput(image);
+  m_Filter->SetLowerThreshold(-20);
+  m_Filter->SetUpperThreshold(120);
+  m_Filter->SetLowerLabel(0);
+  m_Filter->SetUpperLabel(1);
+
+  vtkImageData *imBordered = vtkImageData::New();
+  m_Filter->BorderCreate(imBordered);
+
+  int threads[2] = {1,4};
+  for (int t=0;t<2;t++)
+  {
+    m_Filter->SetNumberOfThreads(threads[t]);
+    m_Filter->Update();
+    vtkDataArray *labels = m_Filter->GetOutput()->GetPointData()->GetScalars();
+    CPPUNIT_ASSERT( labels != NULL && labels->GetNumberOfTuples() == numberOfPoints );
+
+    for (int i=0;i<numberOfPoints;i++)
+    {
+      double value = scalars->GetTuple1(i);
+      double label = 1;
+      if (value > -20 && value < 120)
+      {
+        int error;
+        int indexNearest[26];
+        m_Filter->ComputeIndexNearstPoints(i,indexNearest,error,imBordered);
+        double mean = m_Filter->ComputeMeanValue(i,indexNearest,error,imBordered);
+        double stdDev = m_Filter->ComputeStandardDeviation(i,indexNearest,mean,error,imBordered);
+        //a voxel at the limit may be labelled either way because of the rounding
+        if (fabs(value - (mean - stdDev)) < 1.0e-9)
+        {
+          continue;
+        }
+        label = value < mean - stdDev ? 0 : 1;
+      }
+      else if (value <= -20)
+      {
+        label = 0;
+      }
+      CPPUNIT_ASSERT( labels->GetTuple1(i) == label );
+    }
+  }
+
+  m_Filter->Delete();
+  imBordered->Delete();
+  scalars->Delete();
+  image->Delete();
+}
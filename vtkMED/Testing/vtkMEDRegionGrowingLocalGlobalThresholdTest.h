@@ -50,6 +50,7 @@ public:
   CPPUNIT_TEST( TestComputeStandardDeviation );
   CPPUNIT_TEST( TestExecute );
   CPPUNIT_TEST( TestSetOutputScalarType );
+  CPPUNIT_TEST( TestExecuteNeighbourhood );
   CPPUNIT_TEST_SUITE_END();
 
 protected:
@@ -59,6 +60,9 @@ protected:
   void TestComputeStandardDeviation();
   void TestExecute();
   void TestSetOutputScalarType();
+  /** Compare the labels of Update with the ones given by the mean value and the standard deviation
+  of the 26 voxels near computed on the bordered image, for one and more threads */
+  void TestExecuteNeighbourhood();
 
   vtkImageData *m_Image;
   vtkMEDRegionGrowingLocalGlobalThreshold *m_Filter;
@@ -0,0 +1,218 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: vtkMEDVolumeSlabSlicerTest
+
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "mafDefines.h"
+//----------------------------------------------------------------------------
+// NOTE: Every CPP file in the MAF must include "mafDefines.h" as first.
+// This force to include Window,wxWidgets and VTK exactly in this order.
+// Failing in doing this will result in a run-time error saying:
+// "Failure#0: The value of ESP was not properly saved across a function call"
+//----------------------------------------------------------------------------
+
+#include "vtkMEDVolumeSlabSlicer.h"
+#include "vtkMEDVolumeSlabSlicerTest.h"
+
+#include "vtkImageData.h"
+#include "vtkRectilinearGrid.h"
+#include "vtkPointData.h"
+#include "vtkShortArray.h"
+#include "vtkDoubleArray.h"
+
+#define DIM_X 8
+#define DIM_Y 8
+#define DIM_Z 5
+
+//-------------------------------------------------------------------------
+void vtkMEDVolumeSlabSlicerTest::setUp()
+//-------------------------------------------------------------------------
+{
+}
+//-------------------------------------------------------------------------
+void vtkMEDVolumeSlabSlicerTest::tearDown()
+//-------------------------------------------------------------------------
+{
+}
+
+//-------------------------------------------------------------------------
+vtkDataSet *vtkMEDVolumeSlabSlicerTest::CreateVolume(bool rectilinearGrid)
+//-------------------------------------------------------------------------
+{
+  vtkShortArray *scalars = vtkShortArray::New();
+  scalars->SetNumberOfTuples(DIM_X * DIM_Y * DIM_Z);
+  for (int z = 0; z < DIM_Z; z++)
+    for (int y = 0; y < DIM_Y; y++)
+      for (int x = 0; x < DIM_X; x++)
+        scalars->SetValue(x + DIM_X * (y + DIM_Y * z), 10 * z + x);
+
+  vtkDataSet *volume = NULL;
+  if (rectilinearGrid)
+  {
+    vtkRectilinearGrid *grid = vtkRectilinearGrid::New();
+    grid->SetDimensions(DIM_X, DIM_Y, DIM_Z);
+    int dims[3] = {DIM_X, DIM_Y, DIM_Z};
+    vtkDoubleArray *coords[3];
+    for (int i = 0; i < 3; i++)
+    {
+      coords[i] = vtkDoubleArray::New();
+      for (int c = 0; c < dims[i]; c++)
+        coords[i]->InsertNextTuple1(c);
+    }
+    grid->SetXCoordinates(coords[0]);
+    grid->SetYCoordinates(coords[1]);
+    grid->SetZCoordinates(coords[2]);
+    for (int i = 0; i < 3; i++)
+      vtkDEL(coords[i]);
+    volume = grid;
+  }
+  else
+  {
+    vtkImageData *image = vtkImageData::New();
+    image->SetDimensions(DIM_X, DIM_Y, DIM_Z);
+    image->SetSpacing(1, 1, 1);
+    image->SetOrigin(0, 0, 0);
+    image->SetScalarTypeToShort();
+    volume = image;
+  }
+
+  volume->GetPointData()->SetScalars(scalars);
+  vtkDEL(scalars);
+  return volume;
+}
+
+//-------------------------------------------------------------------------
+vtkImageData *vtkMEDVolumeSlabSlicerTest::Slice(vtkDataSet *input, int mode, double thickness, int numberOfThreads, int resolution)
+//-------------------------------------------------------------------------
+{
+  vtkMEDVolumeSlabSlicer *slicer = vtkMEDVolumeSlabSlicer::New();
+  slicer->SetInput(input);
+  slicer->SetPlaneOrigin(0, 0, 2);
+  slicer->SetPlaneAxisX(1, 0, 0);
+  slicer->SetPlaneAxisY(0, 1, 0);
+  slicer->SetOutputDimensions(DIM_X * resolution, DIM_Y * resolution);
+  slicer->SetOutputSpacing(1.0 / resolution, 1.0 / resolution);
+  slicer->SetSlabThickness(thickness);
+  slicer->SetProjectionMode(mode);
+  slicer->SetNumberOfThreads(numberOfThreads);
+  slicer->Update();
+
+  vtkImageData *output = vtkImageData::New();
+  output->DeepCopy(slicer->GetOutput());
+  vtkDEL(slicer);
+  return output;
+}
+
+//-------------------------------------------------------------------------
+void vtkMEDVolumeSlabSlicerTest::TestDynamicAllocation()
+//-------------------------------------------------------------------------
+{
+  vtkMEDVolumeSlabSlicer *slicer = vtkMEDVolumeSlabSlicer::New();
+  slicer->Delete();
+}
+
+//-------------------------------------------------------------------------
+void vtkMEDVolumeSlabSlicerTest::TestProjectionModes()
+//-------------------------------------------------------------------------
+{
+  vtkDataSet *volume = CreateVolume(false);
+
+  // thickness 2 with spacing 1: samples on the planes z = 1, 2, 3
+  vtkImageData *output = Slice(volume, vtkMEDVolumeSlabSlicer::AVERAGE_PROJECTION, 2, 1);
+  CPPUNIT_ASSERT(output->GetScalarType() == VTK_SHORT);
+  CPPUNIT_ASSERT(output->GetPointData()->GetScalars()->GetNumberOfTuples() == DIM_X * DIM_Y);
+  CPPUNIT_ASSERT(output->GetPointData()->GetScalars()->GetTuple1(0) == 20);
+  CPPUNIT_ASSERT(output->GetPointData()->GetScalars()->GetTuple1(3 + DIM_X) == 23);
+  vtkDEL(output);
+
+  output = Slice(volume, vtkMEDVolumeSlabSlicer::MAX_PROJECTION, 2, 1);
+  CPPUNIT_ASSERT(output->GetPointData()->GetScalars()->GetTuple1(0) == 30);
+  CPPUNIT_ASSERT(output->GetPointData()->GetScalars()->GetTuple1(3 + DIM_X) == 33);
+  vtkDEL(output);
+
+  output = Slice(volume, vtkMEDVolumeSlabSlicer::MIN_PROJECTION, 2, 1);
+  CPPUNIT_ASSERT(output->GetPointData()->GetScalars()->GetTuple1(0) == 10);
+  CPPUNIT_ASSERT(output->GetPointData()->GetScalars()->GetTuple1(3 + DIM_X) == 13);
+  vtkDEL(output);
+
+  // samples outside the volume are not taken into account: z = 0, 1, 2, 3, 4
+  output = Slice(volume, vtkMEDVolumeSlabSlicer::MAX_PROJECTION, 10, 1);
+  CPPUNIT_ASSERT(output->GetPointData()->GetScalars()->GetTuple1(0) == 40);
+  vtkDEL(output);
+
+  output = Slice(volume, vtkMEDVolumeSlabSlicer::AVERAGE_PROJECTION, 10, 1);
+  CPPUNIT_ASSERT(output->GetPointData()->GetScalars()->GetTuple1(0) == 20);
+  vtkDEL(output);
+
+  // integer outputs are rounded: at x = 0.5 the average is 20.5 and the maximum 30.5
+  output = Slice(volume, vtkMEDVolumeSlabSlicer::AVERAGE_PROJECTION, 2, 1, 2);
+  CPPUNIT_ASSERT(output->GetPointData()->GetScalars()->GetTuple1(1) == 21);
+  vtkDEL(output);
+
+  output = Slice(volume, vtkMEDVolumeSlabSlicer::MAX_PROJECTION, 2, 1, 2);
+  CPPUNIT_ASSERT(output->GetPointData()->GetScalars()->GetTuple1(1) == 31);
+  vtkDEL(output);
+
+  vtkDEL(volume);
+}
+
+//-------------------------------------------------------------------------
+void vtkMEDVolumeSlabSlicerTest::TestRectilinearGrid()
+//-------------------------------------------------------------------------
+{
+  vtkDataSet *image = CreateVolume(false);
+  vtkDataSet *grid = CreateVolume(true);
+
+  for (int mode = vtkMEDVolumeSlabSlicer::AVERAGE_PROJECTION; mode <= vtkMEDVolumeSlabSlicer::MIN_PROJECTION; mode++)
+  {
+    vtkImageData *imageOutput = Slice(image, mode, 2, 1);
+    vtkImageData *gridOutput = Slice(grid, mode, 2, 1);
+
+    vtkDataArray *imageScalars = imageOutput->GetPointData()->GetScalars();
+    vtkDataArray *gridScalars = gridOutput->GetPointData()->GetScalars();
+    CPPUNIT_ASSERT(imageScalars->GetNumberOfTuples() == gridScalars->GetNumberOfTuples());
+    for (int i = 0; i < imageScalars->GetNumberOfTuples(); i++)
+    {
+      CPPUNIT_ASSERT(imageScalars->GetTuple1(i) == gridScalars->GetTuple1(i));
+    }
+
+    vtkDEL(imageOutput);
+    vtkDEL(gridOutput);
+  }
+
+  vtkDEL(image);
+  vtkDEL(grid);
+}
+
+//-------------------------------------------------------------------------
+void vtkMEDVolumeSlabSlicerTest::TestThreads()
+//-------------------------------------------------------------------------
+{
+  vtkDataSet *volume = CreateVolume(false);
+
+  // 64 rows are split among 4 threads
+  vtkImageData *serialOutput = Slice(volume, vtkMEDVolumeSlabSlicer::AVERAGE_PROJECTION, 3, 1, 8);
+  vtkImageData *parallelOutput = Slice(volume, vtkMEDVolumeSlabSlicer::AVERAGE_PROJECTION, 3, 4, 8);
+
+  vtkDataArray *serialScalars = serialOutput->GetPointData()->GetScalars();
+  vtkDataArray *parallelScalars = parallelOutput->GetPointData()->GetScalars();
+  CPPUNIT_ASSERT(serialScalars->GetNumberOfTuples() == parallelScalars->GetNumberOfTuples());
+  for (int i = 0; i < serialScalars->GetNumberOfTuples(); i++)
+  {
+    CPPUNIT_ASSERT(serialScalars->GetTuple1(i) == parallelScalars->GetTuple1(i));
+  }
+
+  vtkDEL(serialOutput);
+  vtkDEL(parallelOutput);
+  vtkDEL(volume);
+}
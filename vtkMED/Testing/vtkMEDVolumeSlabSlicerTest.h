@@ -0,0 +1,93 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: vtkMEDVolumeSlabSlicerTest
+
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __CPP_UNIT_vtkMEDVolumeSlabSlicerTEST_H__
+#define __CPP_UNIT_vtkMEDVolumeSlabSlicerTEST_H__
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/BriefTestProgressListener.h>
+#include <cppunit/CompilerOutputter.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/TestResult.h>
+#include <cppunit/TestResultCollector.h>
+#include <cppunit/TestRunner.h>
+
+//-----------------------------------------------------
+// forward references:
+//-----------------------------------------------------
+
+class vtkDataSet;
+class vtkImageData;
+
+class vtkMEDVolumeSlabSlicerTest : public CPPUNIT_NS::TestFixture
+{
+  public:
+  // CPPUNIT fixture: executed before each test
+  void setUp();
+
+  // CPPUNIT fixture: executed after each test
+  void tearDown();
+
+  CPPUNIT_TEST_SUITE( vtkMEDVolumeSlabSlicerTest );
+  CPPUNIT_TEST( TestDynamicAllocation );
+  CPPUNIT_TEST( TestProjectionModes );
+  CPPUNIT_TEST( TestRectilinearGrid );
+  CPPUNIT_TEST( TestThreads );
+  CPPUNIT_TEST_SUITE_END();
+
+  protected:
+  void TestDynamicAllocation();
+  /** average, MIP and MinIP of a slab orthogonal to z */
+  void TestProjectionModes();
+  /** same projections of a rectilinear grid with the same points */
+  void TestRectilinearGrid();
+  /** the output does not depend on the number of threads */
+  void TestThreads();
+
+  /** create the test volume (value = 10*z + x) as vtkImageData or as vtkRectilinearGrid */
+  vtkDataSet *CreateVolume(bool rectilinearGrid);
+
+  /** project the slab of the given thickness around the plane z = 2 with resolution pixels per voxel,
+  the caller deletes the output */
+  vtkImageData *Slice(vtkDataSet *input, int mode, double thickness, int numberOfThreads, int resolution = 1);
+};
+
+int
+main( int argc, char* argv[] )
+{
+  // Create the event manager and test controller
+  CPPUNIT_NS::TestResult controller;
+
+  // Add a listener that colllects test result
+  CPPUNIT_NS::TestResultCollector result;
+  controller.addListener( &result );
+
+  // Add a listener that print dots as test run.
+  CPPUNIT_NS::BriefTestProgressListener progress;
+  controller.addListener( &progress );
+
+  // Add the top suite to the test runner
+  CPPUNIT_NS::TestRunner runner;
+  runner.addTest( vtkMEDVolumeSlabSlicerTest::suite());
+  runner.run( controller );
+
+  // Print test in a compiler compatible format.
+  CPPUNIT_NS::CompilerOutputter outputter( &result, CPPUNIT_NS::stdCOut() );
+  outputter.write();
+
+  return result.wasSuccessful() ? 0 : 1;
+}
+
+#endif
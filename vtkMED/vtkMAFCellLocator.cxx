@@ -35,6 +35,7 @@ See the COPYINGS file for license details
 #include "vtkBox.h"
 
 #include <math.h>
+#include <string.h>
 
 vtkCxxRevisionMacro(vtkMAFCellLocator, "$Revision: 1.1.2.1 $");
 vtkStandardNewMacro(vtkMAFCellLocator);
@@ -47,8 +48,15 @@ vtkStandardNewMacro(vtkMAFCellLocator);
 //__PROFILING_DECLARE_DEFAULT_PROFILER(false);
 
 //----------------------------------------------------------------------------
-void vtkMAFCellLocator::FindCellsAlongLine(double p1[3], double p2[3], double vtkNotUsed(tol),
+void vtkMAFCellLocator::FindCellsAlongLine(double p1[3], double p2[3], double tol,
                                         vtkIdList *cells)
+{
+  this->FindCellsAlongLine(p1, p2, tol, cells, this->CellHasBeenVisited, this->QueryNumber);
+}
+
+//----------------------------------------------------------------------------
+void vtkMAFCellLocator::FindCellsAlongLine(double p1[3], double p2[3], double vtkNotUsed(tol),
+                                        vtkIdList *cells, int *visited, int& queryNumber)
 {
   cells->Reset();
 
@@ -105,11 +113,11 @@ void vtkMAFCellLocator::FindCellsAlongLine(double p1[3], double p2[3], double vt
     // Clear the array that indicates whether we have visited this cell.
     // The array is only cleared when the query number rolls over.  This
     // saves a number of calls to memset.
-    this->QueryNumber++;
-    if (this->QueryNumber == 0)
+    queryNumber++;
+    if (queryNumber == 0)
       {
-      this->ClearCellHasBeenVisited();
-      this->QueryNumber++;    // can't use 0 as a marker
+      memset(visited, 0, this->DataSet->GetNumberOfCells()*sizeof(int));
+      queryNumber++;    // can't use 0 as a marker
       }
     
     // set up curr and stop dist
@@ -144,14 +152,13 @@ void vtkMAFCellLocator::FindCellsAlongLine(double p1[3], double p2[3], double vt
       {
       if (this->Tree[idx])
         {
-        this->ComputeOctantBounds(pos[0]-1,pos[1]-1,pos[2]-1);
         for (tMax = VTK_DOUBLE_MAX, cellId=0; 
         cellId < this->Tree[idx]->GetNumberOfIds(); cellId++) 
           {
           cId = this->Tree[idx]->GetId(cellId);
-          if (this->CellHasBeenVisited[cId] != this->QueryNumber)
+          if (visited[cId] != queryNumber)
             {
-            this->CellHasBeenVisited[cId] = this->QueryNumber;
+            visited[cId] = queryNumber;
             hitCellBounds = 0;
             
             // check whether we intersect the cell bounds
@@ -173,7 +180,7 @@ void vtkMAFCellLocator::FindCellsAlongLine(double p1[3], double p2[3], double vt
               {
               cells->InsertUniqueId(cId);
               } // if (hitCellBounds)
-            } // if (!this->CellHasBeenVisited[cId])
+            } // if (!visited[cId])
           }
         }
       
@@ -45,6 +45,15 @@ public:
   void FindCellsAlongLine(double p1[3], double p2[3], double tolerance,
                           vtkIdList *cells);
 
+  // Description:
+  // The same as above but the locator is not modified, so more threads
+  // may query the same (built) locator concurrently. Every thread passes
+  // its own array of visit marks (one for every cell of the data set,
+  // zeroed before the first query) and the query number, which is
+  // increased by the query (both are reset, when it rolls over).
+  void FindCellsAlongLine(double p1[3], double p2[3], double tolerance,
+                          vtkIdList *cells, int *visited, int& queryNumber);
+
 protected:
   /** constructor */
   vtkMAFCellLocator() {
@@ -31,6 +31,33 @@
 
 #include "assert.h"
 
+//Vectorised CPU slicing (see CreateImage) is available on x86 only,
+//AVX2 needs a compiler that allows AVX2 intrinsics in functions
+//without compiling the whole file for AVX2
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define VS_SIMD
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <emmintrin.h>
+#if _MSC_VER >= 1800
+#define VS_AVX2
+#include <immintrin.h>
+#endif
+#define VS_TARGET_SSE2
+#define VS_TARGET_AVX2
+#elif defined(__GNUC__)
+#include <emmintrin.h>
+#if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define VS_AVX2
+#include <immintrin.h>
+#endif
+#define VS_TARGET_SSE2 __attribute__((target("sse2")))
+#define VS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#undef VS_SIMD
+#endif
+#endif
+
 vtkCxxRevisionMacro(vtkMAFVolumeSlicer_BES, "$Revision: 1.1.2.9 $");
 vtkStandardNewMacro(vtkMAFVolumeSlicer_BES);
 
@@ -46,6 +73,425 @@ typedef unsigned int u_int;
 //Defines the finest of sampling
 static const int SamplingTableSize = 64000;
 
+#ifdef VS_SIMD
+//parameters of one scanline of the output texture for vectorised kernels
+typedef struct VS_SCANLINE
+{
+  const int* pStIndices[3];   //<StIndices tables
+  const float* pStOffsets[3]; //<StOffsets tables
+  const int* pSamplingOffs;   //<offsets of 8 voxels around the sample, see CreateImage
+  int nElems;                 //<number of scalars in the input
+  float p0[3];                //<sample coordinates of the first pixel of the scanline
+  float axis[3];              //<increment of sample coordinates from pixel to pixel
+} VS_SCANLINE;
+
+//------------------------------------------------------------------------
+//Computes indices into sampling tables for nLanes (4) pixels starting at xi,
+//pixels whose samples are outside the volume have all bits of outside set and
+//index 0 in pi. Returns false, if all pixels are outside. SSE2 version.
+VS_TARGET_SSE2 static inline bool VS_SampleIndicesSSE2(int xi, const VS_SCANLINE& line,
+                                                   __m128i pi[3], __m128i& outside)
+//------------------------------------------------------------------------
+{
+  const __m128 fx = _mm_add_ps(_mm_set1_ps((float)xi), _mm_setr_ps(0.f, 1.f, 2.f, 3.f));
+  const __m128i limit = _mm_set1_epi32(SamplingTableSize);
+  const __m128i zero = _mm_setzero_si128();
+
+  outside = zero;
+  for (int c = 0; c < 3; c++)
+  {
+    //NB: the same operations as in the scalar code so that both select the same voxels
+    __m128 p = _mm_add_ps(_mm_set1_ps(line.p0[c]), _mm_mul_ps(fx, _mm_set1_ps(line.axis[c])));
+    pi[c] = _mm_cvttps_epi32(p);    //NaN and too large values give 0x80000000, i.e., negative
+
+    //unsigned comparison pi > SamplingTableSize of the scalar code
+    outside = _mm_or_si128(outside, _mm_or_si128(
+      _mm_cmpgt_epi32(pi[c], limit), _mm_cmplt_epi32(pi[c], zero)));
+  }
+
+  if (_mm_movemask_epi8(outside) == 0xFFFF)
+    return false;
+
+  for (int c = 0; c < 3; c++) {
+    pi[c] = _mm_andnot_si128(outside, pi[c]);
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------
+//Interpolates between a (weight w) and b (weight 1 - w)
+VS_TARGET_SSE2 static inline __m128 VS_LerpSSE2(__m128 a, __m128 b, __m128 w)
+//------------------------------------------------------------------------
+{
+  return _mm_add_ps(b, _mm_mul_ps(_mm_sub_ps(a, b), w));
+}
+
+//Stores 4 values (truncated to the output type) into output
+VS_TARGET_SSE2 static inline void VS_StoreSSE2(u_char* output, __m128 v)
+{
+  __m128i vi = _mm_cvttps_epi32(v);
+  vi = _mm_packs_epi32(vi, vi);
+  vi = _mm_packus_epi16(vi, vi);
+  int nPacked = _mm_cvtsi128_si32(vi);
+  memcpy(output, &nPacked, sizeof(nPacked));
+}
+
+VS_TARGET_SSE2 static inline void VS_StoreSSE2(short* output, __m128 v)
+{
+  __m128i vi = _mm_cvttps_epi32(v);
+  _mm_storel_epi64((__m128i*)output, _mm_packs_epi32(vi, vi));
+}
+
+VS_TARGET_SSE2 static inline void VS_StoreSSE2(u_short* output, __m128 v)
+{
+  //SSE2 has no unsigned saturation from 32 to 16 bits => shift the range to signed
+  const __m128i bias = _mm_set1_epi32(32768);
+  __m128i vi = _mm_sub_epi32(_mm_cvttps_epi32(v), bias);
+  vi = _mm_xor_si128(_mm_packs_epi32(vi, vi), _mm_set1_epi16((short)0x8000));
+  _mm_storel_epi64((__m128i*)output, vi);
+}
+
+VS_TARGET_SSE2 static inline void VS_StoreSSE2(float* output, __m128 v)
+{
+  _mm_storeu_ps(output, v);
+}
+
+//------------------------------------------------------------------------
+//Slices 4 pixels of the scanline starting at pixel xi. SSE2 version.
+//SSE2 has no gathers, so voxels are loaded by scalar code, weights and
+//the tri-linear interpolation are computed for all pixels at once.
+template< typename T >
+VS_TARGET_SSE2 static inline void VS_SliceBatchSSE2(const T* input, T* output,
+                                               int xi, const VS_SCANLINE& line)
+//------------------------------------------------------------------------
+{
+  __m128i pi[3], outside;
+  if (!VS_SampleIndicesSSE2(xi, line, pi, outside))
+    return; //all pixels are outside, output is already zeroed
+
+  int sti[3][4];
+  for (int c = 0; c < 3; c++) {
+    _mm_storeu_si128((__m128i*)sti[c], pi[c]);
+  }
+
+  int index[4];
+  float w[3][4];
+  for (int i = 0; i < 4; i++)
+  {
+    index[i] = line.pStIndices[0][sti[0][i]] + line.pStIndices[1][sti[1][i]] + 
+      line.pStIndices[2][sti[2][i]];
+
+    for (int c = 0; c < 3; c++) {
+      w[c][i] = line.pStOffsets[c][sti[c][i]];
+    }
+  }
+
+  //load 8 voxels around every sample, interpolate along x, then y and z
+  __m128 vx[4];
+  const __m128 wx = _mm_loadu_ps(w[0]);
+  for (int k = 0; k < 4; k++)
+  {
+    const T* pVoxels = input + line.pSamplingOffs[2*k];
+    __m128 v0 = _mm_setr_ps((float)pVoxels[index[0]], (float)pVoxels[index[1]], 
+      (float)pVoxels[index[2]], (float)pVoxels[index[3]]);
+    __m128 v1 = _mm_setr_ps((float)pVoxels[index[0] + 1], (float)pVoxels[index[1] + 1], 
+      (float)pVoxels[index[2] + 1], (float)pVoxels[index[3] + 1]);
+
+    vx[k] = VS_LerpSSE2(v0, v1, wx);
+  }
+
+  const __m128 wy = _mm_loadu_ps(w[1]);
+  __m128 sample = VS_LerpSSE2(VS_LerpSSE2(vx[0], vx[1], wy), 
+    VS_LerpSSE2(vx[2], vx[3], wy), _mm_loadu_ps(w[2]));
+
+  VS_StoreSSE2(output + xi, _mm_andnot_ps(_mm_castsi128_ps(outside), sample));
+}
+
+//------------------------------------------------------------------------
+//Slices the scanline of nPixels pixels, 8 pixels per step. SSE2 version.
+//Returns the number of pixels processed, the remaining ones are left to the scalar code.
+template< typename T >
+VS_TARGET_SSE2 static int VS_SliceScanlineSSE2(const T* input, T* output,
+                                          int nPixels, const VS_SCANLINE& line)
+//------------------------------------------------------------------------
+{
+  int xi = 0;
+  for ( ; xi + 8 <= nPixels; xi += 8)
+  {
+    VS_SliceBatchSSE2(input, output, xi, line);
+    VS_SliceBatchSSE2(input, output, xi + 4, line);
+  }
+
+  if (xi + 4 <= nPixels) 
+  {
+    VS_SliceBatchSSE2(input, output, xi, line);
+    xi += 4;
+  }
+  return xi;
+}
+
+#ifdef VS_AVX2
+//------------------------------------------------------------------------
+//Gathers voxels at indices index and index + 1 from input. AVX2 version.
+//Voxels of 8 and 16-bit types are gathered as one 32-bit word.
+VS_TARGET_AVX2 static inline void VS_GatherPairAVX2(const u_char* input, __m256i index, 
+                                                __m256& v0, __m256& v1)
+//------------------------------------------------------------------------
+{
+  const __m256i mask = _mm256_set1_epi32(0xFF);
+  __m256i g = _mm256_i32gather_epi32((const int*)input, index, 1);
+  v0 = _mm256_cvtepi32_ps(_mm256_and_si256(g, mask));
+  v1 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(g, 8), mask));
+}
+
+VS_TARGET_AVX2 static inline void VS_GatherPairAVX2(const short* input, __m256i index, 
+                                                __m256& v0, __m256& v1)
+{
+  __m256i g = _mm256_i32gather_epi32((const int*)input, index, 2);
+  v0 = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(g, 16), 16));
+  v1 = _mm256_cvtepi32_ps(_mm256_srai_epi32(g, 16));
+}
+
+VS_TARGET_AVX2 static inline void VS_GatherPairAVX2(const u_short* input, __m256i index, 
+                                                __m256& v0, __m256& v1)
+{
+  __m256i g = _mm256_i32gather_epi32((const int*)input, index, 2);
+  v0 = _mm256_cvtepi32_ps(_mm256_and_si256(g, _mm256_set1_epi32(0xFFFF)));
+  v1 = _mm256_cvtepi32_ps(_mm256_srli_epi32(g, 16));
+}
+
+VS_TARGET_AVX2 static inline void VS_GatherPairAVX2(const float* input, __m256i index, 
+                                                __m256& v0, __m256& v1)
+{
+  v0 = _mm256_i32gather_ps(input, index, 4);
+  v1 = _mm256_i32gather_ps(input + 1, index, 4);
+}
+
+//Stores 8 values (truncated to the output type) into output
+VS_TARGET_AVX2 static inline void VS_StoreAVX2(u_char* output, __m256 v)
+{
+  __m256i vi = _mm256_cvttps_epi32(v);
+  __m128i vs = _mm_packs_epi32(_mm256_castsi256_si128(vi), _mm256_extracti128_si256(vi, 1));
+  _mm_storel_epi64((__m128i*)output, _mm_packus_epi16(vs, vs));
+}
+
+VS_TARGET_AVX2 static inline void VS_StoreAVX2(short* output, __m256 v)
+{
+  __m256i vi = _mm256_cvttps_epi32(v);
+  _mm_storeu_si128((__m128i*)output, 
+    _mm_packs_epi32(_mm256_castsi256_si128(vi), _mm256_extracti128_si256(vi, 1)));
+}
+
+VS_TARGET_AVX2 static inline void VS_StoreAVX2(u_short* output, __m256 v)
+{
+  __m256i vi = _mm256_cvttps_epi32(v);
+  _mm_storeu_si128((__m128i*)output, 
+    _mm_packus_epi32(_mm256_castsi256_si128(vi), _mm256_extracti128_si256(vi, 1)));
+}
+
+VS_TARGET_AVX2 static inline void VS_StoreAVX2(float* output, __m256 v)
+{
+  _mm256_storeu_ps(output, v);
+}
+
+//------------------------------------------------------------------------
+//Interpolates between a (weight w) and b (weight 1 - w)
+VS_TARGET_AVX2 static inline __m256 VS_LerpAVX2(__m256 a, __m256 b, __m256 w)
+//------------------------------------------------------------------------
+{
+  return _mm256_add_ps(b, _mm256_mul_ps(_mm256_sub_ps(a, b), w));
+}
+
+//------------------------------------------------------------------------
+//Slices 8 pixels of the scanline starting at pixel xi. AVX2 version.
+//Returns false, if some voxel is too close to the end of input to be gathered 
+//safely as a part of 32-bit word, the pixels are left to the scalar code then.
+template< typename T >
+VS_TARGET_AVX2 static inline bool VS_SliceBatchAVX2(const T* input, T* output,
+                                               int xi, const VS_SCANLINE& line)
+//------------------------------------------------------------------------
+{
+  const __m256 fx = _mm256_add_ps(_mm256_set1_ps((float)xi), 
+    _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f));
+  const __m256i limit = _mm256_set1_epi32(SamplingTableSize);
+  const __m256i zero = _mm256_setzero_si256();
+
+  //see VS_SampleIndicesSSE2
+  __m256i pi[3], outside = zero;
+  for (int c = 0; c < 3; c++)
+  {
+    __m256 p = _mm256_add_ps(_mm256_set1_ps(line.p0[c]), _mm256_mul_ps(fx, _mm256_set1_ps(line.axis[c])));
+    pi[c] = _mm256_cvttps_epi32(p);
+    outside = _mm256_or_si256(outside, _mm256_or_si256(
+      _mm256_cmpgt_epi32(pi[c], limit), _mm256_cmpgt_epi32(zero, pi[c])));
+  }
+
+  if (_mm256_movemask_epi8(outside) == -1)
+    return true;  //all pixels are outside, output is already zeroed
+
+  __m256i index = zero;
+  __m256 w[3];
+  for (int c = 0; c < 3; c++)
+  {
+    pi[c] = _mm256_andnot_si256(outside, pi[c]);
+    index = _mm256_add_epi32(index, _mm256_i32gather_epi32(line.pStIndices[c], pi[c], 4));
+    w[c] = _mm256_i32gather_ps(line.pStOffsets[c], pi[c], 4);
+  }
+
+  //the last voxel gathered is at index + pSamplingOffs[6] + 4 / sizeof(T) - 1 
+  //for 8 and 16-bit types and at index + pSamplingOffs[7] for float
+  const int nMaxIndex = line.nElems - line.pSamplingOffs[6] - (sizeof(T) == 1 ? 4 : 2);
+  if (_mm256_movemask_epi8(_mm256_cmpgt_epi32(index, _mm256_set1_epi32(nMaxIndex))) != 0)
+    return false;
+
+  //gather 8 voxels around every sample, interpolate along x, then y and z
+  __m256 vx[4];
+  for (int k = 0; k < 4; k++)
+  {
+    __m256 v0, v1;
+    VS_GatherPairAVX2(input + line.pSamplingOffs[2*k], index, v0, v1);
+    vx[k] = VS_LerpAVX2(v0, v1, w[0]);
+  }
+
+  __m256 sample = VS_LerpAVX2(VS_LerpAVX2(vx[0], vx[1], w[1]), 
+    VS_LerpAVX2(vx[2], vx[3], w[1]), w[2]);
+
+  VS_StoreAVX2(output + xi, _mm256_andnot_ps(_mm256_castsi256_ps(outside), sample));
+  return true;
+}
+
+//------------------------------------------------------------------------
+//Slices the scanline of nPixels pixels, 16 pixels per step (two independent 
+//batches hide the latency of gathers). AVX2 version.
+//Returns the number of pixels processed, the remaining ones are left to the scalar code.
+template< typename T >
+VS_TARGET_AVX2 static int VS_SliceScanlineAVX2(const T* input, T* output,
+                                          int nPixels, const VS_SCANLINE& line)
+//------------------------------------------------------------------------
+{
+  int xi = 0;
+  for ( ; xi + 16 <= nPixels; xi += 16)
+  {
+    if (!VS_SliceBatchAVX2(input, output, xi, line))
+      return xi;
+
+    if (!VS_SliceBatchAVX2(input, output, xi + 8, line))
+      return xi + 8;
+  }
+
+  if (xi + 8 <= nPixels && VS_SliceBatchAVX2(input, output, xi, line))
+    xi += 8;
+  return xi;
+}
+#endif //VS_AVX2
+
+//------------------------------------------------------------------------
+//Slices the scanline of nPixels pixels using the instruction set nSIMD.
+//Returns the number of pixels processed, the remaining ones are left to the scalar code.
+template< typename T >
+static inline int VS_SliceScanlineSIMD(int nSIMD, const T* input, T* output,
+                                       int nPixels, const VS_SCANLINE& line)
+//------------------------------------------------------------------------
+{
+#ifdef VS_AVX2
+  if (nSIMD == vtkMAFVolumeSlicer_BES::SIMD_AVX2)
+    return VS_SliceScanlineAVX2(input, output, nPixels, line);
+#endif
+  return VS_SliceScanlineSSE2(input, output, nPixels, line);
+}
+
+//Only gray-scale inputs and outputs of the same type are vectorised
+template< typename InputDataType, typename OutputDataType >
+static inline int VS_SliceScanline(int, const InputDataType*, OutputDataType*, int, const VS_SCANLINE&) {
+  return 0;
+}
+
+static inline int VS_SliceScanline(int nSIMD, const u_char* input, u_char* output, int nPixels, const VS_SCANLINE& line) {
+  return VS_SliceScanlineSIMD(nSIMD, input, output, nPixels, line);
+}
+
+static inline int VS_SliceScanline(int nSIMD, const short* input, short* output, int nPixels, const VS_SCANLINE& line) {
+  return VS_SliceScanlineSIMD(nSIMD, input, output, nPixels, line);
+}
+
+static inline int VS_SliceScanline(int nSIMD, const u_short* input, u_short* output, int nPixels, const VS_SCANLINE& line) {
+  return VS_SliceScanlineSIMD(nSIMD, input, output, nPixels, line);
+}
+
+static inline int VS_SliceScanline(int nSIMD, const float* input, float* output, int nPixels, const VS_SCANLINE& line) {
+  return VS_SliceScanlineSIMD(nSIMD, input, output, nPixels, line);
+}
+#endif //VS_SIMD
+
+//Minimal number of rows of the image processed by one thread in CreateImage
+static const int MinRowsPerThread = 16;
+
+//job of threads of CreateImage
+typedef struct VS_THREAD_JOB
+{
+  vtkMAFVolumeSlicer_BES* pSlicer;    //<slicer that creates the image
+  const void* pInput;                 //<input scalars
+  void* pOutput;                      //<output scalars
+  int nRows;                          //<number of rows of the image
+  int nLayer;                         //<layer to be computed (CreateLayerRows only)
+
+  //CreateImageRows (or CreateLayerRows) of pSlicer for the correct data types
+  void (*pfnCreateRows)(VS_THREAD_JOB* job, int nFromRow, int nToRow);
+} VS_THREAD_JOB;
+
+//------------------------------------------------------------------------
+//Calls CreateImageRows for the data types of the job
+template< typename InputDataType, typename OutputDataType >
+static void VS_CreateImageRows(VS_THREAD_JOB* job, int nFromRow, int nToRow)
+//------------------------------------------------------------------------
+{
+  job->pSlicer->CreateImageRows((const InputDataType*)job->pInput, 
+    (OutputDataType*)job->pOutput, nFromRow, nToRow);
+}
+
+//------------------------------------------------------------------------
+//Calls CreateLayerRows for the data type of the job
+template< typename InputDataType >
+static void VS_CreateLayerRows(VS_THREAD_JOB* job, int nFromRow, int nToRow)
+//------------------------------------------------------------------------
+{
+  job->pSlicer->CreateLayerRows((const InputDataType*)job->pInput, 
+    job->nLayer, nFromRow, nToRow);
+}
+
+//------------------------------------------------------------------------
+//Thread function of CreateImage, every thread slices one slab of consecutive rows
+static VTK_THREAD_RETURN_TYPE VS_CreateImageThread(void* arg)
+//------------------------------------------------------------------------
+{
+  vtkMultiThreader::ThreadInfo* info = (vtkMultiThreader::ThreadInfo*)arg;
+  VS_THREAD_JOB* job = (VS_THREAD_JOB*)info->UserData;
+
+  int nFromRow = (int)(((long long)info->ThreadID)*job->nRows / info->NumberOfThreads);
+  int nToRow = (int)(((long long)info->ThreadID + 1)*job->nRows / info->NumberOfThreads);
+  if (nFromRow < nToRow)
+    job->pfnCreateRows(job, nFromRow, nToRow);
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//------------------------------------------------------------------------
+//Executes the job, rows are split into slabs processed by at most nMaxThreads threads
+static void VS_ExecuteJob(VS_THREAD_JOB* job, vtkMultiThreader* threader, int nMaxThreads)
+//------------------------------------------------------------------------
+{
+  //small images are not worth of threads
+  int nThreads = min(nMaxThreads, job->nRows / MinRowsPerThread);
+  if (nThreads <= 1)
+    job->pfnCreateRows(job, 0, job->nRows);
+  else
+  {
+    threader->SetNumberOfThreads(nThreads);
+    threader->SetSingleMethod(VS_CreateImageThread, job);
+    threader->SingleMethodExecute();
+  }
+}
+
 //----------------------------------------------------------------------------
 // Constructor sets default values
 vtkMAFVolumeSlicer_BES::vtkMAFVolumeSlicer_BES() 
@@ -70,6 +516,15 @@ vtkMAFVolumeSlicer_BES::vtkMAFVolumeSlicer_BES()
 
   this->AutoSpacing = 1;    //Autospacing is enabled by the default
   this->LastGPUEnabled = this->GPUEnabled = 1;     //GPU is enabled by the default
+  this->SIMDEnabled = 1;    //SSE2/AVX2 is enabled by the default
+
+  this->Threader = vtkMultiThreader::New();
+  this->NumberOfThreads = this->Threader->GetNumberOfThreads();   //number of CPUs
+  this->ImageParams.RowOrigins = NULL;
+
+  this->IncrementalUpdateEnabled = 0;   //opt-in, see SetIncrementalUpdateEnabled
+  memset(&this->LayersCache, 0, sizeof(this->LayersCache));
+  this->LayersCache.LayerIndex[0] = this->LayersCache.LayerIndex[1] = -1;
 
   for (int i = 0; i < 3; i++)
   {
@@ -98,6 +553,9 @@ vtkMAFVolumeSlicer_BES::~vtkMAFVolumeSlicer_BES()
     delete[] this->StOffsets[i];
   }
 
+  this->Threader->Delete();
+  this->ReleaseLayers();
+
 #ifdef _WIN32
   if (m_pGPUProvider != NULL)
   {
@@ -1123,10 +1581,10 @@ void vtkMAFVolumeSlicer_BES::CreateImage(const InputDataType *input, OutputDataT
   //the first pixel has coordinates GlobalPlaneOrigin - DataOrigin
   //as there is SamplingTableMultiplier samples per one mm, pixel coordinates to 
   //sample indices can be simply obtained using these variables:
-  const float xaxis[3] = { 
-    this->GlobalPlaneAxisX[0] * dx * this->SamplingTableMultiplier[0], 
-    this->GlobalPlaneAxisX[1] * dx * this->SamplingTableMultiplier[1], 
-    this->GlobalPlaneAxisX[2] * dx * this->SamplingTableMultiplier[2]};
+  float* xaxis = this->ImageParams.AxisX;
+  xaxis[0] = this->GlobalPlaneAxisX[0] * dx * this->SamplingTableMultiplier[0];
+  xaxis[1] = this->GlobalPlaneAxisX[1] * dx * this->SamplingTableMultiplier[1]; 
+  xaxis[2] = this->GlobalPlaneAxisX[2] * dx * this->SamplingTableMultiplier[2];
 
   const float yaxis[3] = { 
     this->GlobalPlaneAxisY[0] * dy * this->SamplingTableMultiplier[0], 
@@ -1138,34 +1596,118 @@ void vtkMAFVolumeSlicer_BES::CreateImage(const InputDataType *input, OutputDataT
     (this->GlobalPlaneOrigin[1] - this->DataOrigin[1]) * this->SamplingTableMultiplier[1],
     (this->GlobalPlaneOrigin[2] - this->DataOrigin[2]) * this->SamplingTableMultiplier[2]};
       
-  memset(output, 0, sizeof(OutputDataType) * xs * ys * numComp);
-  OutputDataType* pixel = output;
-  int samplingOffs[8] = { 
-    0,    //voxel [i,j,k]
-    1,    //voxel [i + 1,j,k]
-    this->DataDimensions[0],    //voxel [i,j+1,k]
-    this->DataDimensions[0] + 1,//voxel [i+1,j+1,k]
-		this->DataDimensions[0] * this->DataDimensions[1],      //voxel [i,j,k+1]
-    this->DataDimensions[0] * this->DataDimensions[1] + 1,  //voxel [i+1,j,k+1]
-    this->DataDimensions[0] * this->DataDimensions[1] + this->DataDimensions[0],    //voxel [i,j+1,k+1]
-    this->DataDimensions[0] * this->DataDimensions[1] + this->DataDimensions[0] + 1 //voxel [i+1,j+1,k+1]
-  };
+  int* samplingOffs = this->ImageParams.SamplingOffs;
+  samplingOffs[0] = 0;    //voxel [i,j,k]
+  samplingOffs[1] = 1;    //voxel [i + 1,j,k]
+  samplingOffs[2] = this->DataDimensions[0];    //voxel [i,j+1,k]
+  samplingOffs[3] = this->DataDimensions[0] + 1;//voxel [i+1,j+1,k]
+  samplingOffs[4] = this->DataDimensions[0] * this->DataDimensions[1];      //voxel [i,j,k+1]
+  samplingOffs[5] = this->DataDimensions[0] * this->DataDimensions[1] + 1;  //voxel [i+1,j,k+1]
+  samplingOffs[6] = this->DataDimensions[0] * this->DataDimensions[1] + this->DataDimensions[0];    //voxel [i,j+1,k+1]
+  samplingOffs[7] = this->DataDimensions[0] * this->DataDimensions[1] + this->DataDimensions[0] + 1; //voxel [i+1,j+1,k+1]
 
   for (int i = 1; i < 8; i++) {
     samplingOffs[i] *= numComp;
   }
-    
-  //process every pixel in the output texture
-  float pl[3] = { offset[0], offset[1], offset[2] };
 
+  //the first pixel of every row, rows are processed independently, but the coordinates
+  //are accumulated from row to row exactly as the serial code did, so that the image
+  //is the same for any number of threads
+  float* rowOrigins = new float[3*ys];
+  float pl[3] = { offset[0], offset[1], offset[2] };
   for (int yi = 0; yi < ys; yi++, 
     pl[0] += yaxis[0], pl[1] += yaxis[1], pl[2] += yaxis[2]) 
   {
-    //all pixels in this line has this base
-    float p[3] = { pl[0], pl[1], pl[2] };
-    for (int xi = 0; xi < xs; xi++, 
-      p[0] += xaxis[0], p[1] += xaxis[1], p[2] += xaxis[2], pixel += numComp) 
+    rowOrigins[3*yi] = pl[0]; rowOrigins[3*yi + 1] = pl[1]; rowOrigins[3*yi + 2] = pl[2];
+  }
+
+  this->ImageParams.Dimensions[0] = xs;
+  this->ImageParams.Dimensions[1] = ys;
+  this->ImageParams.RowOrigins = rowOrigins;
+
+  //gray-scale data with tri-linear interpolation can be processed by vectorised kernels
+  this->ImageParams.SIMD = SIMD_NONE;
+  if (this->SIMDEnabled != 0 && numComp == 1 && m_TriLinearInterpolationOn &&
+    this->DataDimensions[0] > 1 && this->DataDimensions[1] > 1 && this->DataDimensions[2] > 1)
+    this->ImageParams.SIMD = GetSIMDInstructionSet();
+
+  //planes aligned with the volume axes (typically, orthogonal slices moved along their normal)
+  //can be interpolated from layers that are usually ready from the previous update
+  //NB: layers are stored in floats, so double volumes are always sliced as a whole
+  bool bDone = false;
+  if (this->IncrementalUpdateEnabled != 0 && numComp == 1 && m_TriLinearInterpolationOn &&
+    this->GetInput()->GetPointData()->GetScalars()->GetDataType() != VTK_DOUBLE)
+    bDone = this->CreateImageFromLayers(input, output, offset, yaxis);
+
+  if (!bDone)
+  {
+    //split rows into slabs, one per thread
+    VS_THREAD_JOB job;
+    job.pSlicer = this;
+    job.pInput = input;
+    job.pOutput = output;
+    job.nRows = ys;
+    job.nLayer = 0;
+    job.pfnCreateRows = &VS_CreateImageRows<InputDataType, OutputDataType>;
+    VS_ExecuteJob(&job, this->Threader, this->NumberOfThreads);
+  }
+
+  this->ImageParams.RowOrigins = NULL;
+  delete[] rowOrigins;
+}
+
+//----------------------------------------------------------------------------
+//Slices rows nFromRow to nToRow - 1 of the output image using ImageParams
+//prepared by CreateImage. 
+//NB: called from multiple threads concurrently, each with a different range of rows
+template<typename InputDataType, typename OutputDataType> 
+void vtkMAFVolumeSlicer_BES::CreateImageRows(const InputDataType *input, OutputDataType *output, int nFromRow, int nToRow)
+//----------------------------------------------------------------------------
+{
+  const int xs = this->ImageParams.Dimensions[0];
+  const int numComp = this->NumComponents;
+  const float* xaxis = this->ImageParams.AxisX;
+  const int* samplingOffs = this->ImageParams.SamplingOffs;
+
+  memset(output + nFromRow*xs*numComp, 0, sizeof(OutputDataType) * xs * (nToRow - nFromRow) * numComp);
+
+#ifdef VS_SIMD
+  //vectorised kernels slice the major part of every scanline, the rest is processed by the code below
+  const int nSIMD = this->ImageParams.SIMD;
+
+  VS_SCANLINE line;
+  for (int i = 0; i < 3; i++)
+  {
+    line.pStIndices[i] = StIndices[i];
+    line.pStOffsets[i] = StOffsets[i];
+    line.axis[i] = xaxis[i];
+  }
+  line.pSamplingOffs = samplingOffs;
+  line.nElems = this->DataDimensions[0] * this->DataDimensions[1] * this->DataDimensions[2];
+#endif
+   
+  //process every pixel in the output texture
+  for (int yi = nFromRow; yi < nToRow; yi++) 
+  {
+    const float* pl = &this->ImageParams.RowOrigins[3*yi];
+
+    int xi = 0;
+#ifdef VS_SIMD
+    if (nSIMD != SIMD_NONE)
     {
+      line.p0[0] = pl[0]; line.p0[1] = pl[1]; line.p0[2] = pl[2];
+      xi = VS_SliceScanline(nSIMD, input, output + yi*xs, xs, line);
+    }
+#endif
+
+    //all pixels in this line has this base, pixel xi has coordinates 
+    //base + xi*xaxis (computed directly, so that there is no accumulation of errors)
+    OutputDataType* pixel = output + (yi*xs + xi)*numComp;
+    for ( ; xi < xs; xi++, pixel += numComp) 
+    {
+      const float fxi = (float)xi;
+      const float p[3] = { pl[0] + fxi*xaxis[0], pl[1] + fxi*xaxis[1], pl[2] + fxi*xaxis[2] };
+
       //round p to integers
       const unsigned int pi[3] = { u_int(p[0]), u_int(p[1]), u_int(p[2])};
       if (pi[0] > SamplingTableSize || pi[1] > SamplingTableSize || pi[2] > SamplingTableSize)
@@ -1204,6 +1746,195 @@ void vtkMAFVolumeSlicer_BES::CreateImage(const InputDataType *input, OutputDataT
 
 }
 
+//----------------------------------------------------------------------------
+//Slices voxels from input producing image in output for planes aligned with the volume axes.
+//The image is interpolated from two layers of LayersCache, which are computed only if needed,
+//i.e., if the plane moves along its normal within the same voxel, layers are just blended,
+//if it moves to the neighbouring voxel, one layer is reused and only the other one is computed
+//Returns false, if the plane is not aligned with the volume axes (nothing is done). 
+template<typename InputDataType, typename OutputDataType> 
+bool vtkMAFVolumeSlicer_BES::CreateImageFromLayers(const InputDataType *input, OutputDataType *output, 
+                                                   const float offset[3], const float yaxis[3])
+//----------------------------------------------------------------------------
+{
+  //find volume axes of the image axes, the image axes must be exactly aligned 
+  //with volume axes, so that every column (row) has the same sample coordinates
+  const float* xaxis = this->ImageParams.AxisX;
+  int axes[3] = { -1, -1, -1 };
+  for (int i = 0; i < 3; i++)
+  {
+    if (xaxis[i] != 0.0f)
+    {
+      if (axes[0] >= 0)
+        return false; //oblique plane
+      axes[0] = i;
+    }
+
+    if (yaxis[i] != 0.0f)
+    {
+      if (axes[1] >= 0)
+        return false; //oblique plane
+      axes[1] = i;
+    }
+  }
+
+  if (axes[0] < 0 || axes[1] < 0 || axes[0] == axes[1])
+    return false;
+  
+  axes[2] = 3 - axes[0] - axes[1];   //axis of the normal
+
+  const int xs = this->ImageParams.Dimensions[0];
+  const int ys = this->ImageParams.Dimensions[1];
+  const int* samplingOffs = this->ImageParams.SamplingOffs;
+
+  LAYERS_CACHE& lc = this->LayersCache;
+  if (lc.Layers[0] == NULL || lc.Dimensions[0] != xs || lc.Dimensions[1] != ys ||
+    lc.Axes[0] != axes[0] || lc.Axes[1] != axes[1] || 
+    lc.Origin[0] != offset[axes[0]] || lc.Origin[1] != offset[axes[1]] || 
+    lc.Steps[0] != xaxis[axes[0]] || lc.Steps[1] != yaxis[axes[1]] ||
+    lc.InputPointer != input || lc.PreprocessingTime != this->PreprocessingTime.GetMTime())
+  {
+    //the plane has changed otherwise than by moving along its normal, 
+    //or the input has changed, layers must be computed from scratch
+    this->ReleaseLayers();
+
+    lc.Layers[0] = new float[xs*ys];
+    lc.Layers[1] = new float[xs*ys];
+    lc.ColIndices = new int[xs];
+    lc.ColOffsets = new float[xs];
+    lc.RowIndices = new int[ys];
+    lc.RowOffsets = new float[ys];
+
+    lc.Dimensions[0] = xs; lc.Dimensions[1] = ys;
+    memcpy(lc.Axes, axes, sizeof(lc.Axes));
+    lc.Origin[0] = offset[axes[0]]; lc.Origin[1] = offset[axes[1]];
+    lc.Steps[0] = xaxis[axes[0]]; lc.Steps[1] = yaxis[axes[1]];
+    lc.InputPointer = input;
+    lc.PreprocessingTime = this->PreprocessingTime.GetMTime();
+    lc.Increments[0] = samplingOffs[1 << axes[0]];
+    lc.Increments[1] = samplingOffs[1 << axes[1]];
+
+    //sample coordinates are computed in the same way as in CreateImageRows
+    for (int xi = 0; xi < xs; xi++)
+    {
+      const u_int pi = u_int(offset[axes[0]] + (float)xi*xaxis[axes[0]]);
+      lc.ColIndices[xi] = (pi > SamplingTableSize) ? -1 : StIndices[axes[0]][pi];
+      lc.ColOffsets[xi] = (pi > SamplingTableSize) ? 0.0f : StOffsets[axes[0]][pi];
+    }
+
+    for (int yi = 0; yi < ys; yi++)
+    {
+      const u_int pi = u_int(this->ImageParams.RowOrigins[3*yi + axes[1]]);
+      lc.RowIndices[yi] = (pi > SamplingTableSize) ? -1 : StIndices[axes[1]][pi];
+      lc.RowOffsets[yi] = (pi > SamplingTableSize) ? 0.0f : StOffsets[axes[1]][pi];
+    }
+  }
+
+  //all pixels have the same coordinate along the normal
+  const u_int pi = u_int(offset[axes[2]]);
+  if (pi > SamplingTableSize)
+  {
+    memset(output, 0, sizeof(OutputDataType) * xs * ys);
+    return true;  //the plane is outside the volume
+  }
+
+  const int layerIndex[2] = { StIndices[axes[2]][pi], StIndices[axes[2]][pi] + samplingOffs[1 << axes[2]] };
+  if (lc.LayerIndex[0] == layerIndex[1] || lc.LayerIndex[1] == layerIndex[0])
+  {
+    //the plane moved to the neighbouring voxel, one of layers can be reused
+    float* pLayer = lc.Layers[0];
+    lc.Layers[0] = lc.Layers[1]; lc.Layers[1] = pLayer;
+
+    int nIndex = lc.LayerIndex[0];
+    lc.LayerIndex[0] = lc.LayerIndex[1]; lc.LayerIndex[1] = nIndex;
+  }
+
+  for (int i = 0; i < 2; i++)
+  {
+    if (lc.LayerIndex[i] == layerIndex[i])
+      continue;   //the layer is ready
+
+    lc.LayerIndex[i] = layerIndex[i];
+
+    VS_THREAD_JOB job;
+    job.pSlicer = this;
+    job.pInput = input;
+    job.pOutput = NULL;
+    job.nRows = ys;
+    job.nLayer = i;
+    job.pfnCreateRows = &VS_CreateLayerRows<InputDataType>;
+    VS_ExecuteJob(&job, this->Threader, this->NumberOfThreads);
+  }
+
+  //interpolate between layers
+  const float w0 = StOffsets[axes[2]][pi], w1 = 1.0f - w0;
+  const float* pLayer0 = lc.Layers[0];
+  const float* pLayer1 = lc.Layers[1];
+  for (int i = 0; i < xs*ys; i++) {
+    output[i] = (OutputDataType)(pLayer0[i]*w0 + pLayer1[i]*w1);
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+//Computes rows nFromRow to nToRow - 1 of the layer nLayer of LayersCache,
+//i.e., bilinearly interpolates samples in the voxel plane of the layer
+//NB: called from multiple threads concurrently, each with a different range of rows
+template<typename InputDataType> 
+void vtkMAFVolumeSlicer_BES::CreateLayerRows(const InputDataType *input, int nLayer, int nFromRow, int nToRow)
+//----------------------------------------------------------------------------
+{
+  const LAYERS_CACHE& lc = this->LayersCache;
+  const int xs = lc.Dimensions[0];
+  const int incX = lc.Increments[0], incY = lc.Increments[1];
+
+  for (int yi = nFromRow; yi < nToRow; yi++)
+  {
+    float* pLayer = lc.Layers[nLayer] + yi*xs;
+    if (lc.RowIndices[yi] < 0)
+    {
+      memset(pLayer, 0, sizeof(float)*xs);
+      continue; //row is outside the volume
+    }
+
+    const InputDataType* pRow = input + lc.LayerIndex[nLayer] + lc.RowIndices[yi];
+    const float wy0 = lc.RowOffsets[yi], wy1 = 1.0f - wy0;
+    for (int xi = 0; xi < xs; xi++)
+    {
+      if (lc.ColIndices[xi] < 0) 
+      {
+        pLayer[xi] = 0.0f;
+        continue; //pixel is outside the volume
+      }
+
+      const InputDataType* pVoxel = pRow + lc.ColIndices[xi];
+      const float wx0 = lc.ColOffsets[xi], wx1 = 1.0f - wx0;
+      pLayer[xi] = (pVoxel[0]*wx0 + pVoxel[incX]*wx1)*wy0 + 
+        (pVoxel[incY]*wx0 + pVoxel[incX + incY]*wx1)*wy1;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+//Releases buffers of LayersCache
+void vtkMAFVolumeSlicer_BES::ReleaseLayers()
+//----------------------------------------------------------------------------
+{
+  LAYERS_CACHE& lc = this->LayersCache;
+  for (int i = 0; i < 2; i++)
+  {
+    delete[] lc.Layers[i];
+    lc.Layers[i] = NULL;
+    lc.LayerIndex[i] = -1;
+  }
+
+  delete[] lc.ColIndices; lc.ColIndices = NULL;
+  delete[] lc.ColOffsets; lc.ColOffsets = NULL;
+  delete[] lc.RowIndices; lc.RowIndices = NULL;
+  delete[] lc.RowOffsets; lc.RowOffsets = NULL;
+}
+
 //----------------------------------------------------------------------------
 //Calculates the coordinates for the given point and texture denoted by its size and spacing.
 //Texture is considered to have an origin at GlobalPlaneOrigin, to be oriented according to GlobalPlaneAxisX
@@ -1410,4 +2141,47 @@ void vtkMAFVolumeSlicer_BES::SetGPUEnabled(int enable)
 
   Modified();
 
+}
+
+//----------------------------------------------------------------------------
+//Returns the best instruction set from SIMD_INSTRUCTION_SET supported
+//by both, this build and the CPU of this computer
+/*static*/ int vtkMAFVolumeSlicer_BES::GetSIMDInstructionSet()
+//----------------------------------------------------------------------------
+{
+  static int nInstructionSet = -1;  //detected once, CPU does not change
+  if (nInstructionSet < 0)
+  {
+    int nDetected = SIMD_NONE;
+#if defined(VS_SIMD) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int nMaxLeaf = info[0];
+
+    __cpuid(info, 1);
+    if ((info[3] & (1 << 26)) != 0)
+      nDetected = SIMD_SSE2;
+
+#ifdef VS_AVX2
+    //AVX2 requires also the OS to save YMM registers (OSXSAVE and XCR0)
+    if (nMaxLeaf >= 7 && (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6)
+    {
+      __cpuidex(info, 7, 0);
+      if ((info[1] & (1 << 5)) != 0)
+        nDetected = SIMD_AVX2;
+    }
+#endif
+#elif defined(VS_SIMD)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+      nDetected = SIMD_SSE2;
+#ifdef VS_AVX2
+    if (__builtin_cpu_supports("avx2"))
+      nDetected = SIMD_AVX2;
+#endif
+#endif
+    nInstructionSet = nDetected;
+  }
+
+  return nInstructionSet;
 }
\ No newline at end of file
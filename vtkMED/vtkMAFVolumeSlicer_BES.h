@@ -35,6 +35,7 @@
 #include "vtkDataSetToDataSetFilter.h"
 #include "vtkImageData.h"
 #include "vtkPolyData.h"
+#include "vtkMultiThreader.h"
 
 
 //----------------------------------------------------------------------------
@@ -78,16 +79,19 @@ public:
   /**
   Set / Get the Window for color modulation. The formula for modulation is 
   (S - (L - W/2))/ W where S is the scalar value, L is the level and W is the window.
-  BES: It is used nowhere, to be removed */
-  vtkSetMacro( Window, double );
+  BES: It is used nowhere, to be removed 
+  NB. the output contains raw scalars, window/level is applied by the lookup table 
+  of the texture, therefore, setting it does not cause the slice to be recomputed */
+  void SetWindow(double window) { this->Window = window; }
   vtkGetMacro( Window, double );
 
   /**
   Set / Get the Level to use -> modulation will be performed on the 
   color based on (S - (L - W/2))/W where S is the scalar value, L is
   the level and W is the window.
-  BES: It is used nowhere, to be removed */
-  vtkSetMacro( Level, double );
+  BES: It is used nowhere, to be removed 
+  NB. setting it does not cause the slice to be recomputed, see SetWindow */
+  void SetLevel(double level) { this->Level = level; }
   vtkGetMacro( Level, double );
 
   /** Set/get auto-spacing feature. 
@@ -105,6 +109,47 @@ public:
   void SetGPUEnabled(int enable);
   vtkGetMacro( GPUEnabled, int );
 
+  /** Set/get whether vectorised CPU slicing should be used. 
+  If enabled and the CPU supports SSE2 or AVX2 (detected at runtime), gray-scale 
+  unsigned char, short, unsigned short and float volumes are sliced with tri-linear
+  interpolation several pixels at once, otherwise the scalar code is used.
+  Enabled by the default. 
+  NB. vectorised processing uses single precision, i.e., integer outputs may differ
+  from those of the scalar code by one */
+  vtkSetMacro( SIMDEnabled, int );
+  vtkGetMacro( SIMDEnabled, int );
+  vtkBooleanMacro( SIMDEnabled, int );
+
+  /** Instruction sets that can be used for vectorised slicing */
+  enum SIMD_INSTRUCTION_SET
+  {
+    SIMD_NONE = 0,    //<scalar code only
+    SIMD_SSE2,        //<4 pixels per vector, 8 pixels per step
+    SIMD_AVX2,        //<8 pixels per vector (with gathers), 16 pixels per step
+  };
+
+  /** Returns the best instruction set from SIMD_INSTRUCTION_SET supported
+  by both, this build and the CPU of this computer */
+  static int GetSIMDInstructionSet();
+
+  /** Set/get whether slices by planes aligned with the volume axes should be updated incrementally.
+  If enabled, the image is interpolated from two layers of samples lying in voxel planes 
+  around the slicing plane, which are kept, so that when the plane moves along its normal 
+  within the same voxel, only the interpolation between layers is done, and when it moves 
+  to the neighbouring voxel, only one layer is computed. Double volumes, RGB volumes and
+  oblique planes are always sliced as a whole. Disabled by the default, as integer outputs 
+  may differ by one from those of the slicing as a whole (the rounding is done per layer). */
+  vtkSetMacro( IncrementalUpdateEnabled, int );
+  vtkGetMacro( IncrementalUpdateEnabled, int );
+  vtkBooleanMacro( IncrementalUpdateEnabled, int );
+
+  /** Set/get the maximal number of threads used to create the image.
+  Rows of the image are split into slabs sliced concurrently, the image 
+  does not depend on the number of threads. By the default, it is 
+  the number of CPUs of this computer. */
+  vtkSetClampMacro( NumberOfThreads, int, 1, VTK_MAX_THREADS );
+  vtkGetMacro( NumberOfThreads, int );
+
   /** Set tri-linear interpolation to on */
   void SetTrilinearInterpolationOn(){m_TriLinearInterpolationOn = true;};
   
@@ -137,6 +182,18 @@ public:
   Transform slicer plane according to the given transformation before slicing.*/
   void SetSliceTransform(vtkLinearTransform *trans);
 
+  /** Slices rows nFromRow to nToRow - 1 of the output image using ImageParams
+  prepared by CreateImage. It is public so that the thread functions can call this method.
+  NB: called from multiple threads concurrently, each with a different range of rows */
+  template<typename InputDataType, typename OutputDataType> 
+  void CreateImageRows(const InputDataType *input, OutputDataType *output, int nFromRow, int nToRow);
+
+  /** Computes rows nFromRow to nToRow - 1 of the layer nLayer of LayersCache.
+  It is public so that the thread functions can call this method.
+  NB: called from multiple threads concurrently, each with a different range of rows */
+  template<typename InputDataType> 
+  void CreateLayerRows(const InputDataType *input, int nLayer, int nFromRow, int nToRow);
+
 protected:
   vtkMAFVolumeSlicer_BES();
   ~vtkMAFVolumeSlicer_BES();
@@ -206,6 +263,17 @@ protected:
   template<typename InputDataType, typename OutputDataType> 
   void CreateImage(const InputDataType *input, OutputDataType *output, vtkImageData *outputObject);
 
+  /** Slices voxels from input producing image in output for planes aligned with the volume axes,
+  the image is interpolated from two layers of LayersCache, which are computed only if needed.
+  offset and yaxis are sample coordinates of the first pixel and the increment between rows.
+  Returns false, if the plane is not aligned with the volume axes (nothing is done). */
+  template<typename InputDataType, typename OutputDataType> 
+  bool CreateImageFromLayers(const InputDataType *input, OutputDataType *output, 
+    const float offset[3], const float yaxis[3]);
+
+  /** Releases buffers of LayersCache */
+  void ReleaseLayers();
+
 #ifdef _WIN32
   /** Slices voxels from input producing image in output using GPU. */  
   template<typename OutputDataType> 
@@ -240,6 +308,7 @@ protected:
 
   int AutoSpacing;
   int GPUEnabled;         //<Non-zero if GPU processing should be used whenever it is possible
+  int SIMDEnabled;        //<Non-zero if SSE2/AVX2 processing should be used whenever it is possible
 
   // look-up tables and caches
   vtkTimeStamp PreprocessingTime;
@@ -259,15 +328,52 @@ protected:
 
   int LastGPUEnabled; //<to reflect GPU Enable/Disable change
 
+  vtkMultiThreader* Threader;   //<threads for CreateImage
+  int NumberOfThreads;          //<maximal number of threads used by CreateImage
+
+  //parameters of the image being created by CreateImage, shared by its threads
+  typedef struct IMAGE_PARAMS
+  {
+    int Dimensions[2];          //<dimensions of the output image
+    float AxisX[3];             //<increment of sample coordinates from pixel to pixel in a row
+    float* RowOrigins;          //<sample coordinates of the first pixel of every row
+    int SamplingOffs[8];        //<offsets of 8 voxels around the sample
+    int SIMD;                   //<instruction set used by vectorised kernels, see SIMD_INSTRUCTION_SET
+  } IMAGE_PARAMS;
+
+  IMAGE_PARAMS ImageParams;
+
+  int IncrementalUpdateEnabled; //<Non-zero if axis-aligned slices should be interpolated from LayersCache
+
+  //two layers of samples in voxel planes around the axis-aligned slicing plane, see CreateImageFromLayers
+  typedef struct LAYERS_CACHE
+  {
+    float* Layers[2];           //<samples bilinearly interpolated in the voxel planes
+    int LayerIndex[2];          //<index of the first voxel of the voxel plane of every layer, -1 if invalid
+    int Dimensions[2];          //<dimensions of the image (and layers)
+    int Axes[3];                //<volume axes of the image x-axis, the image y-axis and the plane normal
+    float Origin[2];            //<sample coordinates of the first pixel along Axes[0] and Axes[1]
+    float Steps[2];             //<increments of sample coordinates between pixels along Axes[0] and Axes[1]
+    const void* InputPointer;   //<input scalars the layers were computed for
+    unsigned long PreprocessingTime;  //<PreprocessingTime the layers were computed for
+    int Increments[2];          //<offsets of the next voxels along Axes[0] and Axes[1]
+    int* ColIndices;            //<indices of voxels of columns along Axes[0], -1 if outside the volume
+    float* ColOffsets;          //<weights of voxels of columns
+    int* RowIndices;            //<indices of voxels of rows along Axes[1], -1 if outside the volume
+    float* RowOffsets;          //<weights of voxels of rows
+  } LAYERS_CACHE;
+
+  LAYERS_CACHE LayersCache;
+
 #ifdef _WIN32
   bool m_bGPUProcessing;        //<true, if GPU processing will be used in ExecuteData
   mafGPUOGL* m_pGPUProvider;    //<GPU provider for GPU computation
   int m_TextureId;           //<Texture representing the input data
 
   float m_GPUDataDimensions[3]; //<area covered by input data (in mm)
+#endif  
 
   bool m_TriLinearInterpolationOn; //<define if tri-linear interpolation is performed or not on slice's texture
-#endif  
 
 private:
   vtkMAFVolumeSlicer_BES(const vtkMAFVolumeSlicer_BES&);  // Not implemented.
@@ -0,0 +1,786 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: vtkMEDDistanceFieldFilter
+
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "medDefines.h"
+//----------------------------------------------------------------------------
+// NOTE: Every CPP file in the MAF must include "mafDefines.h" as first.
+// This force to include Window,wxWidgets and VTK exactly in this order.
+// Failing in doing this will result in a run-time error saying:
+// "Failure#0: The value of ESP was not properly saved across a function call"
+//----------------------------------------------------------------------------
+
+#include "vtkMEDDistanceFieldFilter.h"
+#include "vtkObjectFactory.h"
+#include "vtkImageData.h"
+#include "vtkRectilinearGrid.h"
+#include "vtkPointData.h"
+#include "vtkCellData.h"
+#include "vtkFloatArray.h"
+#include "vtkMatrix4x4.h"
+
+#include <vector>
+#include <list>
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+vtkCxxRevisionMacro(vtkMEDDistanceFieldFilter, "$Revision: 1.1.2.1 $");
+vtkStandardNewMacro(vtkMEDDistanceFieldFilter);
+
+// Minimal number of input points processed by one thread
+#define MIN_POINTS_PER_THREAD 4096
+
+// Minimal number of lines of the volume processed by one thread
+#define MIN_LINES_PER_THREAD 64
+
+// Squared distance of voxels without features
+#define DF_INFINITY VTK_FLOAT_MAX
+
+// Tolerance (in voxels) of the points on the boundary of the volume
+#define DF_BOUNDARY_TOLERANCE 1.e-6
+
+// Points of the volume along one axis
+typedef struct DF_AXIS
+{
+  const double *Coordinates;  //< Coordinates of the points (increasing), NULL for a regular axis
+  int Dimension;              //< Number of points
+  double Origin;              //< Coordinate of the first point of a regular axis
+  double InvSpacing;          //< 1 / spacing of a regular axis
+  vtkIdType Increment;        //< Increment of the value index between two points (0 if there is one point only)
+} DF_AXIS;
+
+// Stages of the computation of a distance field
+enum DF_FIELD_STAGE
+{
+  DF_CLASSIFY_STAGE = 0,      //< Squared distances are 0 on the features and DF_INFINITY elsewhere
+  DF_X_STAGE,                 //< Transform of the lines along x
+  DF_Y_STAGE,                 //< Transform of the lines along y
+  DF_Z_STAGE,                 //< Transform of the lines along z
+  DF_SIGN_STAGE,              //< Signed distance from the squared distances
+};
+
+// Job of threads computing a distance field
+typedef struct DF_FIELD_JOB
+{
+  const void *Scalars;        //< Scalars of the volume
+  int NumberOfComponents;     //< Number of components of the scalars (the first one is thresholded)
+  double Threshold;           //< Voxels with value >= Threshold are inside
+  int Dimensions[3];          //< Number of points of the volume
+  const double *Coordinates[3]; //< Coordinates of the points of the volume
+  double HalfVoxel;           //< Half of the minimal spacing, distance of the iso-surface from the voxels (exact along the axes of minimal spacing only)
+  float *Outside;             //< Squared distance from the inside voxels, the signed distance at the end
+  float *Inside;              //< Squared distance from the outside voxels
+  int Stage;                  //< Current stage (DF_FIELD_STAGE)
+  void (*Classify)(const DF_FIELD_JOB *job, vtkIdType fromVoxel, vtkIdType toVoxel); //< Kernel of DF_CLASSIFY_STAGE
+} DF_FIELD_JOB;
+
+// Job of threads computing distances or densities of the input points
+typedef struct DF_LOOKUP_JOB
+{
+  vtkDataSet *Input;          //< Input points
+  const double *Matrix;       //< Transformation of the input points (row-major), NULL for the identity
+  DF_AXIS Axes[3];            //< Points of the volume
+  const void *Values;         //< Distance field or scalars of the volume
+  double OutsideValue;        //< Value of the points outside the volume
+  double MinValue;            //< Minimal value of the output
+  double MaxValue;            //< Maximal value of the output
+  float *Output;              //< Output values
+  vtkIdType NumberOfPoints;   //< Number of input points
+  double (*Fetch)(const DF_LOOKUP_JOB *job, vtkIdType index, const double w[3]); //< Tri-linear interpolation
+} DF_LOOKUP_JOB;
+
+// Distance field of the cache
+typedef struct DF_CACHE_ENTRY
+{
+  vtkDataSet *Source;         //< Volume (registered by the cache)
+  unsigned long SourceMTime;  //< Modification time of the volume and of its scalars
+  double Threshold;           //< Threshold of the volume
+  vtkFloatArray *Field;       //< Signed distance transform
+} DF_CACHE_ENTRY;
+
+// Distance fields, the most recently used first
+static std::list<DF_CACHE_ENTRY> DF_Cache;
+
+//----------------------------------------------------------------------------
+// Fills coordinates and axes with the points of volume along the axes (increment are in values, not components).
+// Returns false if volume is not a vtkImageData or a vtkRectilinearGrid.
+static bool DF_GetAxes(vtkDataSet *volume, int numberOfComponents, std::vector<double> coordinates[3], DF_AXIS axes[3], double &minSpacing)
+//----------------------------------------------------------------------------
+{
+  int dims[3];
+  minSpacing = VTK_DOUBLE_MAX;
+  vtkImageData *imageData = vtkImageData::SafeDownCast(volume);
+  vtkRectilinearGrid *gridData = vtkRectilinearGrid::SafeDownCast(volume);
+  if (imageData != NULL)
+  {
+    double origin[3], spacing[3];
+    imageData->GetDimensions(dims);
+    imageData->GetOrigin(origin);
+    imageData->GetSpacing(spacing);
+    for (int i = 0; i < 3; i++)
+    {
+      coordinates[i].resize(dims[i]);
+      for (int c = 0; c < dims[i]; c++)
+        coordinates[i][c] = origin[i] + c * spacing[i];
+
+      axes[i].Coordinates = NULL;
+      axes[i].Origin = origin[i];
+      axes[i].InvSpacing = spacing[i] != 0 ? 1.0 / spacing[i] : 0.0;
+      if (dims[i] > 1 && fabs(spacing[i]) < minSpacing)
+        minSpacing = fabs(spacing[i]);
+    }
+  }
+  else if (gridData != NULL)
+  {
+    gridData->GetDimensions(dims);
+    vtkDataArray *coords[3] = {gridData->GetXCoordinates(), gridData->GetYCoordinates(), gridData->GetZCoordinates()};
+    for (int i = 0; i < 3; i++)
+    {
+      coordinates[i].resize(dims[i]);
+      for (int c = 0; c < dims[i]; c++)
+        coordinates[i][c] = coords[i]->GetTuple1(c);
+
+      axes[i].Coordinates = &coordinates[i][0];
+      axes[i].Origin = coordinates[i][0];
+      axes[i].InvSpacing = 0.0;
+      for (int c = 1; c < dims[i]; c++)
+      {
+        if (coordinates[i][c] - coordinates[i][c - 1] < minSpacing)
+          minSpacing = coordinates[i][c] - coordinates[i][c - 1];
+      }
+    }
+  }
+  else
+    return false;
+
+  vtkIdType increment = numberOfComponents;
+  for (int i = 0; i < 3; i++)
+  {
+    axes[i].Dimension = dims[i];
+    axes[i].Increment = dims[i] > 1 ? increment : 0;
+    increment *= dims[i];
+  }
+
+  if (minSpacing == VTK_DOUBLE_MAX)
+    minSpacing = 0.0;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Finds the cell of axis containing x, index is the first point of the cell and weight the
+// interpolation weight of the second point. Returns false if x is outside the axis.
+static inline bool DF_Locate(const DF_AXIS &axis, double x, int &index, double &weight)
+//----------------------------------------------------------------------------
+{
+  index = 0;
+  weight = 0;
+
+  if (axis.Coordinates == NULL)
+  {
+    double t = (x - axis.Origin) * axis.InvSpacing;
+    if (t < -DF_BOUNDARY_TOLERANCE || t > axis.Dimension - 1 + DF_BOUNDARY_TOLERANCE)
+      return false;
+    if (axis.Dimension == 1)
+      return true;
+
+    index = t <= 0 ? 0 : (int)t;
+    if (index > axis.Dimension - 2)
+      index = axis.Dimension - 2;
+    weight = t - index;
+    weight = weight < 0 ? 0 : (weight > 1 ? 1 : weight);
+    return true;
+  }
+
+  const double *first = axis.Coordinates, *last = axis.Coordinates + axis.Dimension - 1;
+  if (axis.Dimension == 1)
+    return fabs(x - *first) <= DF_BOUNDARY_TOLERANCE;
+  if (x < *first || x > *last)
+    return false;
+
+  index = (int)(std::upper_bound(first, last + 1, x) - first) - 1;
+  if (index > axis.Dimension - 2)
+    index = axis.Dimension - 2;
+  weight = (x - first[index]) / (first[index + 1] - first[index]);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Sets the squared distances of voxels fromVoxel to toVoxel - 1: 0 on the features, DF_INFINITY elsewhere
+template<typename DataType>
+static void DF_Classify(const DF_FIELD_JOB *job, vtkIdType fromVoxel, vtkIdType toVoxel)
+//----------------------------------------------------------------------------
+{
+  const DataType *scalars = (const DataType *)job->Scalars;
+  for (vtkIdType i = fromVoxel; i < toVoxel; i++)
+  {
+    bool inside = scalars[i * job->NumberOfComponents] >= job->Threshold;
+    job->Outside[i] = inside ? 0.0f : DF_INFINITY;
+    job->Inside[i] = inside ? DF_INFINITY : 0.0f;
+  }
+}
+
+//----------------------------------------------------------------------------
+// One dimensional squared distance transform (lower envelope of parabolas, Felzenszwalb and Huttenlocher)
+// of the n values f[0], f[stride], ... at the increasing coordinates x.
+// v, z, g and d are buffers of n, n, n and n values.
+static void DF_TransformLine(float *f, vtkIdType stride, int n, const double *x, int *v, double *z, double *g, double *d)
+//----------------------------------------------------------------------------
+{
+  // parabolas of the lower envelope: vertex x[v[k]], height g[k], left bound z[k]
+  int k = -1;
+  for (int q = 0; q < n; q++)
+  {
+    const double fq = f[q * stride];
+    if (fq >= DF_INFINITY)
+      continue;
+
+    double s = -VTK_DOUBLE_MAX;
+    while (k >= 0)
+    {
+      s = ((fq + x[q] * x[q]) - (g[k] + x[v[k]] * x[v[k]])) / (2.0 * (x[q] - x[v[k]]));
+      if (s > z[k])
+        break;
+
+      k--;
+      s = -VTK_DOUBLE_MAX;
+    }
+
+    k++;
+    v[k] = q;
+    g[k] = fq;
+    z[k] = s;
+  }
+
+  if (k < 0)
+    return; // no features on the line
+
+  for (int q = 0, j = 0; q < n; q++)
+  {
+    while (j < k && z[j + 1] < x[q])
+      j++;
+    const double dx = x[q] - x[v[j]];
+    d[q] = dx * dx + g[j];
+  }
+
+  for (int q = 0; q < n; q++)
+    f[q * stride] = (float)d[q];
+}
+
+//----------------------------------------------------------------------------
+// Executes the current stage of job on the part of the volume of thread threadId of numberOfThreads
+static void DF_ComputeField(const DF_FIELD_JOB *job, int threadId, int numberOfThreads)
+//----------------------------------------------------------------------------
+{
+  const vtkIdType dims[3] = {job->Dimensions[0], job->Dimensions[1], job->Dimensions[2]};
+  const vtkIdType numberOfVoxels = dims[0] * dims[1] * dims[2];
+
+  if (job->Stage == DF_CLASSIFY_STAGE || job->Stage == DF_SIGN_STAGE)
+  {
+    const vtkIdType fromVoxel = threadId * numberOfVoxels / numberOfThreads;
+    const vtkIdType toVoxel = (threadId + 1) * numberOfVoxels / numberOfThreads;
+    if (job->Stage == DF_CLASSIFY_STAGE)
+    {
+      job->Classify(job, fromVoxel, toVoxel);
+      return;
+    }
+
+    for (vtkIdType i = fromVoxel; i < toVoxel; i++)
+    {
+      if (job->Inside[i] == 0.0f)
+        job->Outside[i] = job->Outside[i] >= DF_INFINITY ? VTK_FLOAT_MAX : (float)(sqrt(job->Outside[i]) - job->HalfVoxel);
+      else
+        job->Outside[i] = job->Inside[i] >= DF_INFINITY ? -VTK_FLOAT_MAX : (float)(job->HalfVoxel - sqrt(job->Inside[i]));
+    }
+    return;
+  }
+
+  // lines along the axis of the stage
+  const int axis = job->Stage - DF_X_STAGE;
+  const int n = job->Dimensions[axis];
+  const vtkIdType stride = axis == 0 ? 1 : (axis == 1 ? dims[0] : dims[0] * dims[1]);
+  const vtkIdType numberOfLines = numberOfVoxels / n;
+  const vtkIdType fromLine = threadId * numberOfLines / numberOfThreads;
+  const vtkIdType toLine = (threadId + 1) * numberOfLines / numberOfThreads;
+
+  std::vector<int> v(n);
+  std::vector<double> z(n), g(n), d(n);
+  for (vtkIdType line = fromLine; line < toLine; line++)
+  {
+    vtkIdType first;
+    if (axis == 0)
+      first = line * dims[0];
+    else if (axis == 1)
+      first = (line % dims[0]) + (line / dims[0]) * dims[0] * dims[1];
+    else
+      first = line;
+
+    DF_TransformLine(job->Outside + first, stride, n, job->Coordinates[axis], &v[0], &z[0], &g[0], &d[0]);
+    DF_TransformLine(job->Inside + first, stride, n, job->Coordinates[axis], &v[0], &z[0], &g[0], &d[0]);
+  }
+}
+
+//----------------------------------------------------------------------------
+// Thread function of ComputeDistanceField
+static VTK_THREAD_RETURN_TYPE DF_ComputeFieldThread(void *arg)
+//----------------------------------------------------------------------------
+{
+  vtkMultiThreader::ThreadInfo *info = (vtkMultiThreader::ThreadInfo *)arg;
+  DF_ComputeField((const DF_FIELD_JOB *)info->UserData, info->ThreadID, info->NumberOfThreads);
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+// Tri-linear interpolation of the values of job around index with weights w
+template<typename DataType>
+static double DF_Fetch(const DF_LOOKUP_JOB *job, vtkIdType index, const double w[3])
+//----------------------------------------------------------------------------
+{
+  const DataType *values = (const DataType *)job->Values + index;
+  const vtkIdType dx = job->Axes[0].Increment, dy = job->Axes[1].Increment, dz = job->Axes[2].Increment;
+
+  double value = 0.0;
+  for (int z = 0; z < 2; z++)
+  {
+    const double zweight = z ? w[2] : 1.0 - w[2];
+    for (int y = 0; y < 2; y++)
+    {
+      const double yzweight = (y ? w[1] : 1.0 - w[1]) * zweight;
+      const DataType *row = values + y * dy + z * dz;
+      value += (row[0] * (1.0 - w[0]) + row[dx] * w[0]) * yzweight;
+    }
+  }
+  return value;
+}
+
+//----------------------------------------------------------------------------
+// Computes the values of points fromPoint to toPoint - 1 of job
+static void DF_LookupPoints(const DF_LOOKUP_JOB *job, vtkIdType fromPoint, vtkIdType toPoint)
+//----------------------------------------------------------------------------
+{
+  const DF_AXIS *axes = job->Axes;
+  const double *m = job->Matrix;
+  for (vtkIdType id = fromPoint; id < toPoint; id++)
+  {
+    double p[3], q[3];
+    job->Input->GetPoint(id, p);
+    if (m != NULL)
+    {
+      const double w = m[12] * p[0] + m[13] * p[1] + m[14] * p[2] + m[15];
+      for (int i = 0; i < 3; i++)
+        q[i] = (m[4 * i] * p[0] + m[4 * i + 1] * p[1] + m[4 * i + 2] * p[2] + m[4 * i + 3]) / w;
+    }
+    else
+    {
+      q[0] = p[0]; q[1] = p[1]; q[2] = p[2];
+    }
+
+    int ijk[3];
+    double w[3];
+    if (!DF_Locate(axes[0], q[0], ijk[0], w[0]) || !DF_Locate(axes[1], q[1], ijk[1], w[1]) ||
+      !DF_Locate(axes[2], q[2], ijk[2], w[2]))
+    {
+      job->Output[id] = (float)job->OutsideValue;
+      continue;
+    }
+
+    double value = job->Fetch(job, ijk[0]*axes[0].Increment + ijk[1]*axes[1].Increment + ijk[2]*axes[2].Increment, w);
+    value = value < job->MinValue ? job->MinValue : (value > job->MaxValue ? job->MaxValue : value);
+    job->Output[id] = (float)value;
+  }
+}
+
+//----------------------------------------------------------------------------
+// Thread function of Execute, every thread computes a range of consecutive points
+static VTK_THREAD_RETURN_TYPE DF_LookupPointsThread(void *arg)
+//----------------------------------------------------------------------------
+{
+  vtkMultiThreader::ThreadInfo *info = (vtkMultiThreader::ThreadInfo *)arg;
+  const DF_LOOKUP_JOB *job = (const DF_LOOKUP_JOB *)info->UserData;
+
+  vtkIdType fromPoint = info->ThreadID * job->NumberOfPoints / info->NumberOfThreads;
+  vtkIdType toPoint = (info->ThreadID + 1) * job->NumberOfPoints / info->NumberOfThreads;
+  DF_LookupPoints(job, fromPoint, toPoint);
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+vtkMEDDistanceFieldFilter::vtkMEDDistanceFieldFilter()
+//----------------------------------------------------------------------------
+{
+  Threshold = 0.;
+  MaxDistance = 10.;
+  FilterMode = DISTANCE_MODE;
+  InputMatrix = NULL;
+
+  Threader = vtkMultiThreader::New();
+  NumberOfThreads = Threader->GetNumberOfThreads(); // number of CPUs
+}
+
+//----------------------------------------------------------------------------
+vtkMEDDistanceFieldFilter::~vtkMEDDistanceFieldFilter()
+//----------------------------------------------------------------------------
+{
+  SetInputMatrix(NULL);
+  Threader->Delete();
+}
+
+//----------------------------------------------------------------------------
+void vtkMEDDistanceFieldFilter::SetSource(vtkDataSet *source)
+//----------------------------------------------------------------------------
+{
+  this->vtkProcessObject::SetNthInput(1, source);
+}
+
+//----------------------------------------------------------------------------
+vtkDataSet *vtkMEDDistanceFieldFilter::GetSource()
+//----------------------------------------------------------------------------
+{
+  if (this->NumberOfInputs < 2)
+    return NULL;
+  return (vtkDataSet *)(this->Inputs[1]);
+}
+
+//----------------------------------------------------------------------------
+void vtkMEDDistanceFieldFilter::SetInputMatrix(vtkMatrix4x4 *matrix)
+//----------------------------------------------------------------------------
+{
+  if (InputMatrix == matrix)
+    return;
+
+  if (InputMatrix != NULL)
+    InputMatrix->UnRegister(this);
+  InputMatrix = matrix;
+  if (InputMatrix != NULL)
+    InputMatrix->Register(this);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkMEDDistanceFieldFilter::GetMTime()
+//----------------------------------------------------------------------------
+{
+  unsigned long mTime = this->Superclass::GetMTime();
+  if (InputMatrix != NULL && InputMatrix->GetMTime() > mTime)
+    mTime = InputMatrix->GetMTime();
+  return mTime;
+}
+
+//----------------------------------------------------------------------------
+void vtkMEDDistanceFieldFilter::ComputeInputUpdateExtents(vtkDataObject *output)
+//----------------------------------------------------------------------------
+{
+  this->Superclass::ComputeInputUpdateExtents(output);
+
+  // the distance field is computed on the whole volume
+  vtkDataSet *source = this->GetSource();
+  if (source != NULL)
+    source->SetUpdateExtentToWholeExtent();
+}
+
+//----------------------------------------------------------------------------
+void vtkMEDDistanceFieldFilter::Execute()
+//----------------------------------------------------------------------------
+{
+  vtkDataSet *input = this->GetInput();
+  vtkDataSet *output = this->GetOutput();
+  vtkDataSet *source = this->GetSource();
+  if (input == NULL)
+    return;
+
+  output->CopyStructure(input);
+  output->GetPointData()->PassData(input->GetPointData());
+  output->GetCellData()->PassData(input->GetCellData());
+
+  vtkDataArray *sourceScalars = source != NULL ? source->GetPointData()->GetScalars() : NULL;
+  if (sourceScalars == NULL || sourceScalars->GetNumberOfTuples() == 0)
+  {
+    vtkErrorMacro(<< "vtkMEDDistanceFieldFilter: No source scalars");
+    return;
+  }
+
+  DF_LOOKUP_JOB job;
+  std::vector<double> coordinates[3];
+  double minSpacing;
+  int numComp = FilterMode == DISTANCE_MODE ? 1 : sourceScalars->GetNumberOfComponents();
+  if (!DF_GetAxes(source, numComp, coordinates, job.Axes, minSpacing))
+  {
+    vtkErrorMacro(<< "vtkMEDDistanceFieldFilter: Invalid source, vtkImageData or vtkRectilinearGrid expected");
+    return;
+  }
+
+  if (FilterMode == DISTANCE_MODE)
+  {
+    vtkFloatArray *field = GetDistanceField(source, Threshold, NumberOfThreads);
+    if (field == NULL)
+      return;
+
+    job.Values = field->GetPointer(0);
+    job.Fetch = &DF_Fetch<float>;
+    job.OutsideValue = MaxDistance;
+    job.MinValue = -MaxDistance;
+    job.MaxValue = MaxDistance;
+  }
+  else
+  {
+    job.Values = sourceScalars->GetVoidPointer(0);
+    switch (sourceScalars->GetDataType())
+    {
+    case VTK_CHAR:
+      job.Fetch = &DF_Fetch<char>; break;
+    case VTK_UNSIGNED_CHAR:
+      job.Fetch = &DF_Fetch<unsigned char>; break;
+    case VTK_SHORT:
+      job.Fetch = &DF_Fetch<short>; break;
+    case VTK_UNSIGNED_SHORT:
+      job.Fetch = &DF_Fetch<unsigned short>; break;
+    case VTK_INT:
+      job.Fetch = &DF_Fetch<int>; break;
+    case VTK_UNSIGNED_INT:
+      job.Fetch = &DF_Fetch<unsigned int>; break;
+    case VTK_FLOAT:
+      job.Fetch = &DF_Fetch<float>; break;
+    case VTK_DOUBLE:
+      job.Fetch = &DF_Fetch<double>; break;
+    default:
+      vtkErrorMacro(<< "vtkMEDDistanceFieldFilter: Scalar type is not supported");
+      return;
+    }
+    job.OutsideValue = 0.0;
+    job.MinValue = -VTK_DOUBLE_MAX;
+    job.MaxValue = VTK_DOUBLE_MAX;
+  }
+
+  vtkFloatArray *values = vtkFloatArray::New();
+  values->SetName(FilterMode == DISTANCE_MODE ? "Distance" : "Density");
+  values->SetNumberOfTuples(input->GetNumberOfPoints());
+
+  double matrix[16];
+  if (InputMatrix != NULL)
+  {
+    for (int i = 0; i < 4; i++)
+      for (int j = 0; j < 4; j++)
+        matrix[4 * i + j] = InputMatrix->GetElement(i, j);
+  }
+
+  job.Input = input;
+  job.Matrix = InputMatrix != NULL ? matrix : NULL;
+  job.Output = values->GetPointer(0);
+  job.NumberOfPoints = input->GetNumberOfPoints();
+
+  // make sure that the structure of the input is built before the threads query its points
+  if (job.NumberOfPoints > 0)
+  {
+    double p[3];
+    input->GetPoint(0, p);
+  }
+
+  vtkIdType nThreads = job.NumberOfPoints / MIN_POINTS_PER_THREAD;
+  if (nThreads > NumberOfThreads)
+    nThreads = NumberOfThreads;
+  if (nThreads <= 1)
+  {
+    DF_LookupPoints(&job, 0, job.NumberOfPoints);
+  }
+  else
+  {
+    Threader->SetNumberOfThreads((int)nThreads);
+    Threader->SetSingleMethod(DF_LookupPointsThread, &job);
+    Threader->SingleMethodExecute();
+  }
+
+  output->GetPointData()->SetScalars(values);
+  values->Delete();
+}
+
+//----------------------------------------------------------------------------
+vtkFloatArray *vtkMEDDistanceFieldFilter::GetDistanceField(vtkDataSet *source, double threshold, int numberOfThreads)
+//----------------------------------------------------------------------------
+{
+  if (source == NULL || source->GetPointData()->GetScalars() == NULL)
+    return NULL;
+
+  unsigned long sourceMTime = source->GetMTime();
+  if (source->GetPointData()->GetScalars()->GetMTime() > sourceMTime)
+    sourceMTime = source->GetPointData()->GetScalars()->GetMTime();
+
+  // release fields of modified volumes and of volumes referenced by the cache only
+  std::list<DF_CACHE_ENTRY>::iterator it = DF_Cache.begin();
+  while (it != DF_Cache.end())
+  {
+    bool hit = it->Source == source && it->Threshold == threshold;
+    bool stale = (it->Source == source && it->SourceMTime != sourceMTime) ||
+      (it->Source != source && it->Source->GetReferenceCount() == 1);
+    if (hit && !stale)
+    {
+      // move to the front
+      if (it != DF_Cache.begin())
+        DF_Cache.splice(DF_Cache.begin(), DF_Cache, it);
+      return DF_Cache.front().Field;
+    }
+
+    if (stale)
+    {
+      it->Field->Delete();
+      it->Source->UnRegister(NULL);
+      it = DF_Cache.erase(it);
+    }
+    else
+      ++it;
+  }
+
+  vtkFloatArray *field = ComputeDistanceField(source, threshold, numberOfThreads);
+  if (field == NULL)
+    return NULL;
+
+  while (DF_Cache.size() >= DISTANCE_FIELD_CACHE_SIZE)
+  {
+    DF_Cache.back().Field->Delete();
+    DF_Cache.back().Source->UnRegister(NULL);
+    DF_Cache.pop_back();
+  }
+
+  DF_CACHE_ENTRY entry;
+  entry.Source = source;
+  entry.Source->Register(NULL);
+  entry.SourceMTime = sourceMTime;
+  entry.Threshold = threshold;
+  entry.Field = field;
+  DF_Cache.push_front(entry);
+  return field;
+}
+
+//----------------------------------------------------------------------------
+void vtkMEDDistanceFieldFilter::ReleaseDistanceFields()
+//----------------------------------------------------------------------------
+{
+  for (std::list<DF_CACHE_ENTRY>::iterator it = DF_Cache.begin(); it != DF_Cache.end(); ++it)
+  {
+    it->Field->Delete();
+    it->Source->UnRegister(NULL);
+  }
+  DF_Cache.clear();
+}
+
+//----------------------------------------------------------------------------
+void vtkMEDDistanceFieldFilter::ReleaseDistanceFields(vtkDataSet *source)
+//----------------------------------------------------------------------------
+{
+  std::list<DF_CACHE_ENTRY>::iterator it = DF_Cache.begin();
+  while (it != DF_Cache.end())
+  {
+    if (it->Source == source)
+    {
+      it->Field->Delete();
+      it->Source->UnRegister(NULL);
+      it = DF_Cache.erase(it);
+    }
+    else
+      ++it;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkFloatArray *vtkMEDDistanceFieldFilter::ComputeDistanceField(vtkDataSet *source, double threshold, int numberOfThreads)
+//----------------------------------------------------------------------------
+{
+  vtkDataArray *scalars = source->GetPointData()->GetScalars();
+
+  DF_FIELD_JOB job;
+  DF_AXIS axes[3];
+  std::vector<double> coordinates[3];
+  double minSpacing;
+  if (!DF_GetAxes(source, 1, coordinates, axes, minSpacing))
+  {
+    vtkGenericWarningMacro(<< "vtkMEDDistanceFieldFilter: Invalid source, vtkImageData or vtkRectilinearGrid expected");
+    return NULL;
+  }
+
+  switch (scalars->GetDataType())
+  {
+  case VTK_CHAR:
+    job.Classify = &DF_Classify<char>; break;
+  case VTK_UNSIGNED_CHAR:
+    job.Classify = &DF_Classify<unsigned char>; break;
+  case VTK_SHORT:
+    job.Classify = &DF_Classify<short>; break;
+  case VTK_UNSIGNED_SHORT:
+    job.Classify = &DF_Classify<unsigned short>; break;
+  case VTK_INT:
+    job.Classify = &DF_Classify<int>; break;
+  case VTK_UNSIGNED_INT:
+    job.Classify = &DF_Classify<unsigned int>; break;
+  case VTK_FLOAT:
+    job.Classify = &DF_Classify<float>; break;
+  case VTK_DOUBLE:
+    job.Classify = &DF_Classify<double>; break;
+  default:
+    vtkGenericWarningMacro(<< "vtkMEDDistanceFieldFilter: Scalar type is not supported");
+    return NULL;
+  }
+
+  vtkIdType numberOfVoxels = 1;
+  for (int i = 0; i < 3; i++)
+  {
+    job.Dimensions[i] = axes[i].Dimension;
+    job.Coordinates[i] = &coordinates[i][0];
+    numberOfVoxels *= axes[i].Dimension;
+  }
+  if (numberOfVoxels == 0 || numberOfVoxels != scalars->GetNumberOfTuples())
+    return NULL;
+
+  vtkFloatArray *field = vtkFloatArray::New();
+  field->SetNumberOfTuples(numberOfVoxels);
+  std::vector<float> inside(numberOfVoxels);
+
+  job.Scalars = scalars->GetVoidPointer(0);
+  job.NumberOfComponents = scalars->GetNumberOfComponents();
+  job.Threshold = threshold;
+  job.HalfVoxel = 0.5 * minSpacing;
+  job.Outside = field->GetPointer(0);
+  job.Inside = &inside[0];
+
+  vtkMultiThreader *threader = vtkMultiThreader::New();
+  if (numberOfThreads <= 0)
+    numberOfThreads = threader->GetNumberOfThreads();
+
+  for (job.Stage = DF_CLASSIFY_STAGE; job.Stage <= DF_SIGN_STAGE; job.Stage++)
+  {
+    // the lines of a pass are split among the threads, there is nothing to do along axes of one point
+    vtkIdType work = numberOfVoxels / MIN_LINES_PER_THREAD;
+    if (job.Stage >= DF_X_STAGE && job.Stage <= DF_Z_STAGE)
+    {
+      int n = job.Dimensions[job.Stage - DF_X_STAGE];
+      if (n == 1)
+        continue;
+      work = numberOfVoxels / n / MIN_LINES_PER_THREAD;
+    }
+
+    int nThreads = work < numberOfThreads ? (int)work : numberOfThreads;
+    if (nThreads <= 1)
+    {
+      DF_ComputeField(&job, 0, 1);
+    }
+    else
+    {
+      threader->SetNumberOfThreads(nThreads);
+      threader->SetSingleMethod(DF_ComputeFieldThread, &job);
+      threader->SingleMethodExecute();
+    }
+  }
+
+  threader->Delete();
+  return field;
+}
@@ -0,0 +1,155 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: vtkMEDDistanceFieldFilter
+
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __vtkMEDDistanceFieldFilter_H__
+#define __vtkMEDDistanceFieldFilter_H__
+
+#include "vtkMEDConfigure.h"
+#include "vtkDataSetToDataSetFilter.h"
+#include "vtkMultiThreader.h"
+
+class vtkMatrix4x4;
+class vtkFloatArray;
+
+/**
+  class name: vtkMEDDistanceFieldFilter
+  Computes for every point of the input the distance from the iso-surface of Threshold of the
+  Source volume (vtkImageData or vtkRectilinearGrid) or the density of the volume at the point.
+
+  The distance is read (tri-linear interpolation) from a signed Euclidean distance transform of
+  the thresholded volume: voxels with value >= Threshold are inside, the distance is negative for
+  the points inside, positive for the points outside and it is clamped to [-MaxDistance, MaxDistance].
+  Points outside the volume are at MaxDistance and have density 0.
+  The iso-surface is put half of the minimal spacing away from the voxels inside: distances of
+  volumes with anisotropic spacing are approximate, with an error up to half of the difference
+  between the maximal and the minimal spacing.
+
+  The distance transform is computed by a separable algorithm (one pass for each axis, lines of
+  a pass are processed by different threads) and it is kept in a cache shared by all filters,
+  so changing MaxDistance, the input or its pose does not compute it again, as well as going back
+  to a threshold already used. The cache keeps the last DISTANCE_FIELD_CACHE_SIZE fields (a
+  reference to their volumes is kept), fields of volumes not used anywhere else are released;
+  the owners of the filters release the fields of their volumes, the application the whole cache at exit.
+  NB: the filter must be executed by the main thread only, as the cache is not synchronised.
+*/
+//----------------------------------------------------------------------------
+class VTK_vtkMED_EXPORT vtkMEDDistanceFieldFilter : public vtkDataSetToDataSetFilter
+//----------------------------------------------------------------------------
+{
+public:
+
+  /** Output scalars */
+  enum FILTER_MODE
+  {
+    DISTANCE_MODE = 0,
+    DENSITY_MODE,
+  };
+
+  /** Number of distance fields kept in the cache */
+  enum {DISTANCE_FIELD_CACHE_SIZE = 4};
+
+  /** */
+  static vtkMEDDistanceFieldFilter *New();
+
+  /** RTTI Macro */
+  vtkTypeRevisionMacro(vtkMEDDistanceFieldFilter, vtkDataSetToDataSetFilter);
+
+  /** Set the volume (vtkImageData or vtkRectilinearGrid) */
+  void SetSource(vtkDataSet *source);
+
+  /** Get the volume */
+  vtkDataSet *GetSource();
+
+  /** Set the iso-value of the surface of the volume */
+  vtkSetMacro(Threshold, double);
+
+  /** Get the iso-value of the surface of the volume */
+  vtkGetMacro(Threshold, double);
+
+  /** Set the maximal absolute value of the distance */
+  vtkSetClampMacro(MaxDistance, double, 0, VTK_DOUBLE_MAX);
+
+  /** Get the maximal absolute value of the distance */
+  vtkGetMacro(MaxDistance, double);
+
+  /** Set the output scalars (see FILTER_MODE) */
+  vtkSetClampMacro(FilterMode, int, DISTANCE_MODE, DENSITY_MODE);
+
+  /** Get the output scalars */
+  vtkGetMacro(FilterMode, int);
+
+  /** Output the distance from the iso-surface */
+  void SetFilterModeToDistance() {this->SetFilterMode(DISTANCE_MODE);};
+
+  /** Output the density of the volume */
+  void SetFilterModeToDensity() {this->SetFilterMode(DENSITY_MODE);};
+
+  /** Set the matrix transforming the points of the input in the coordinates of the volume */
+  virtual void SetInputMatrix(vtkMatrix4x4 *matrix);
+
+  /** Get the matrix transforming the points of the input in the coordinates of the volume */
+  vtkGetObjectMacro(InputMatrix, vtkMatrix4x4);
+
+  /** Set the maximal number of threads, by default the number of CPUs (the output does not depend on it) */
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+
+  /** Get the maximal number of threads */
+  vtkGetMacro(NumberOfThreads, int);
+
+  /** Return the signed distance transform of the volume thresholded at threshold (one value
+  for each point of the volume), computed if it is not in the cache. The array belongs to the cache. */
+  static vtkFloatArray *GetDistanceField(vtkDataSet *source, double threshold, int numberOfThreads = 0);
+
+  /** Release all distance fields of the cache */
+  static void ReleaseDistanceFields();
+
+  /** Release the distance fields of source, e.g. when the objects using it are deleted */
+  static void ReleaseDistanceFields(vtkDataSet *source);
+
+  /** Include the modification time of InputMatrix */
+  unsigned long GetMTime();
+
+protected:
+
+  /** ctor */
+  vtkMEDDistanceFieldFilter();
+
+  /** dtor */
+  ~vtkMEDDistanceFieldFilter();
+
+  /** Request the whole extent of the volume */
+  void ComputeInputUpdateExtents(vtkDataObject *output);
+
+  /** Compute distances or densities of the points of the input */
+  void Execute();
+
+  /** Compute the signed distance transform of the volume thresholded at threshold */
+  static vtkFloatArray *ComputeDistanceField(vtkDataSet *source, double threshold, int numberOfThreads);
+
+  double Threshold;             //< Iso-value of the surface of the volume
+  double MaxDistance;           //< Maximal absolute value of the distance
+  int FilterMode;               //< Output scalars
+  vtkMatrix4x4 *InputMatrix;    //< Transformation of the input points in the coordinates of the volume
+
+  vtkMultiThreader *Threader;   //< Threads computing distances or densities
+  int NumberOfThreads;          //< Maximal number of threads used by the Threader
+
+private:
+  /** Not implemented */
+  vtkMEDDistanceFieldFilter(const vtkMEDDistanceFieldFilter&);
+  /** Not implemented */
+  void operator=(const vtkMEDDistanceFieldFilter&);
+};
+#endif //#ifndef __vtkMEDDistanceFieldFilter_H__
@@ -24,8 +24,10 @@
 #include "vtkUnsignedCharArray.h"
 #include "vtkDoubleArray.h"
 #include "vtkPointData.h"
+#include "vtkMultiThreader.h"
 
 #include <cassert>
+#include <vector>
 
 
 #define PENINSULA_CORNER_MAXIMUM_NUMBER_OF_PIXELS 1
@@ -33,6 +35,293 @@
 vtkCxxRevisionMacro(vtkMEDImageFillHolesRemoveIslands, "$Revision: 1.1.2.2 $");
 vtkStandardNewMacro(vtkMEDImageFillHolesRemoveIslands);
 
+// data shared by threads of ExecuteConnectedComponents
+typedef struct FH_THREAD_JOB
+{
+  const unsigned char *Input;
+  unsigned char *Output;
+  int *Parents;                 // union-find parents of voxels of the volume (3D only)
+  int Dims[3];
+  unsigned char DiscriminationPixelValue;
+  int EightConnectivity;
+  int RemovePeninsulaRegions;
+  int EdgeSize;
+  int MaximumArea;
+  int Volume;                   // label the slices of the volume only, components are filled later
+} FH_THREAD_JOB;
+
+// statistics of a connected component
+typedef struct FH_COMPONENT
+{
+  int NumberOfPixels;
+  int Min[3];
+  int Max[3];
+  bool Border;
+} FH_COMPONENT;
+
+//----------------------------------------------------------------------------
+// Root of the component of the pixel i
+static inline int FHFind(int *parents, int i)
+//----------------------------------------------------------------------------
+{
+  while (parents[i] != i)
+  {
+    parents[i] = parents[parents[i]];
+    i = parents[i];
+  }
+  return i;
+}
+
+//----------------------------------------------------------------------------
+// Join the components of the pixels i and j, the root is the pixel with the lowest index
+static inline void FHUnion(int *parents, int i, int j)
+//----------------------------------------------------------------------------
+{
+  i = FHFind(parents, i);
+  j = FHFind(parents, j);
+  if (i < j)
+  {
+    parents[j] = i;
+  }
+  else if (j < i)
+  {
+    parents[i] = j;
+  }
+}
+
+//----------------------------------------------------------------------------
+// Label the connected components of pixels different from the discrimination value of the slice
+// starting at the index first, background pixels have parent -1
+static void FHLabelSlice(const unsigned char *input, int *parents, int first, int nx, int ny, unsigned char discrimination, int eightConnectivity)
+//----------------------------------------------------------------------------
+{
+  for (int y = 0, i = first; y < ny; y++)
+  {
+    for (int x = 0; x < nx; x++, i++)
+    {
+      if (input[i] == discrimination)
+      {
+        parents[i] = -1;
+        continue;
+      }
+
+      parents[i] = i;
+      if (x > 0 && parents[i - 1] >= 0)
+      {
+        FHUnion(parents, i, i - 1);
+      }
+      if (y > 0)
+      {
+        if (parents[i - nx] >= 0)
+        {
+          FHUnion(parents, i, i - nx);
+        }
+        if (eightConnectivity && x > 0 && parents[i - nx - 1] >= 0)
+        {
+          FHUnion(parents, i, i - nx - 1);
+        }
+        if (eightConnectivity && x < nx - 1 && parents[i - nx + 1] >= 0)
+        {
+          FHUnion(parents, i, i - nx + 1);
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+// Summed area table of the pixels of the slice different from the discrimination value,
+// sums[y*(nx + 1) + x] is the number of those pixels in [0,x)x[0,y)
+static void FHSumSlice(const unsigned char *input, int *sums, int nx, int ny, unsigned char discrimination)
+//----------------------------------------------------------------------------
+{
+  for (int x = 0; x <= nx; x++)
+  {
+    sums[x] = 0;
+  }
+  for (int y = 0, i = 0; y < ny; y++)
+  {
+    int *row = sums + (y + 1)*(nx + 1);
+    row[0] = 0;
+    for (int x = 0; x < nx; x++, i++)
+    {
+      row[x + 1] = row[x] + (row - (nx + 1))[x + 1] - (row - (nx + 1))[x] + (input[i] != discrimination ? 1 : 0);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+// Number of pixels different from the discrimination value in [x0,x1)x[y0,y1)
+static inline int FHCount(const int *sums, int nx, int x0, int y0, int x1, int y1)
+//----------------------------------------------------------------------------
+{
+  return sums[y1*(nx + 1) + x1] - sums[y0*(nx + 1) + x1] - sums[y1*(nx + 1) + x0] + sums[y0*(nx + 1) + x0];
+}
+
+//----------------------------------------------------------------------------
+// True if the square scan fills the component of the slice: a recognition square with edge from 3 to EdgeSize + 2
+// has the component inside and only discrimination pixels on its sides (but one corner when peninsula regions
+// are removed). As in the scan, squares start from the first row/column and never reach the last one.
+static bool FHSquareExists(FH_THREAD_JOB *job, const unsigned char *input, const int *sums, const FH_COMPONENT &component)
+//----------------------------------------------------------------------------
+{
+  int nx = job->Dims[0];
+  int ny = job->Dims[1];
+  int width = component.Max[0] - component.Min[0] + 1;
+  int height = component.Max[1] - component.Min[1] + 1;
+
+  for (int edge = (width > height ? width : height) + 2; edge <= job->EdgeSize + 2; edge++)
+  {
+    int firstX = component.Max[0] - edge + 2 > 0 ? component.Max[0] - edge + 2 : 0;
+    int lastX = component.Min[0] - 1 < nx - edge - 1 ? component.Min[0] - 1 : nx - edge - 1;
+    int firstY = component.Max[1] - edge + 2 > 0 ? component.Max[1] - edge + 2 : 0;
+    int lastY = component.Min[1] - 1 < ny - edge - 1 ? component.Min[1] - 1 : ny - edge - 1;
+
+    for (int y0 = firstY; y0 <= lastY; y0++)
+    {
+      for (int x0 = firstX; x0 <= lastX; x0++)
+      {
+        int x1 = x0 + edge - 1;
+        int y1 = y0 + edge - 1;
+        int sides = FHCount(sums, nx, x0, y0, x1 + 1, y1 + 1) - FHCount(sums, nx, x0 + 1, y0 + 1, x1, y1);
+        if (sides == 0)
+        {
+          return true;
+        }
+        if (job->RemovePeninsulaRegions && sides <= PENINSULA_CORNER_MAXIMUM_NUMBER_OF_PIXELS)
+        {
+          unsigned char d = job->DiscriminationPixelValue;
+          int corners = (input[y0*nx + x0] != d) + (input[y0*nx + x1] != d) + (input[y1*nx + x0] != d) + (input[y1*nx + x1] != d);
+          if (corners == sides)
+          {
+            return true;
+          }
+        }
+      }
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+// Set to the discrimination value the labelled components of the image dims that do not touch its border and
+// are not bigger than the edge size and the maximum area. For slices (sums of the input not NULL) the components
+// must also be recognised by a square of the square scan.
+static void FHFillComponents(FH_THREAD_JOB *job, const int dims[3], int *parents, unsigned char *output, 
+                             const unsigned char *input = NULL, const int *sums = NULL)
+//----------------------------------------------------------------------------
+{
+  // replace parents with consecutive component ids, roots have the lowest index of their components
+  std::vector<FH_COMPONENT> components;
+  int n = dims[0]*dims[1]*dims[2];
+  for (int i = 0; i < n; i++)
+  {
+    if (parents[i] < 0)
+    {
+      continue;
+    }
+    if (parents[i] == i)
+    {
+      parents[i] = components.size();
+      FH_COMPONENT component;
+      component.NumberOfPixels = 0;
+      component.Border = false;
+      components.push_back(component);
+    }
+    else
+    {
+      // parents[i] < i has been already replaced with the id of the component
+      parents[i] = parents[parents[i]];
+    }
+  }
+
+  // statistics of the components
+  for (int z = 0, i = 0; z < dims[2]; z++)
+  {
+    for (int y = 0; y < dims[1]; y++)
+    {
+      for (int x = 0; x < dims[0]; x++, i++)
+      {
+        if (parents[i] < 0)
+        {
+          continue;
+        }
+        FH_COMPONENT &component = components[parents[i]];
+        int coordinates[3] = {x, y, z};
+        for (int c = 0; c < 3; c++)
+        {
+          if (component.NumberOfPixels == 0 || coordinates[c] < component.Min[c])
+          {
+            component.Min[c] = coordinates[c];
+          }
+          if (component.NumberOfPixels == 0 || coordinates[c] > component.Max[c])
+          {
+            component.Max[c] = coordinates[c];
+          }
+        }
+        component.NumberOfPixels++;
+        if (x == 0 || x == dims[0] - 1 || y == 0 || y == dims[1] - 1 || (dims[2] > 1 && (z == 0 || z == dims[2] - 1)))
+        {
+          component.Border = true;
+        }
+      }
+    }
+  }
+
+  std::vector<bool> fill(components.size());
+  for (int i = 0; i < (int)components.size(); i++)
+  {
+    FH_COMPONENT &component = components[i];
+    fill[i] = !component.Border && (job->MaximumArea <= 0 || component.NumberOfPixels <= job->MaximumArea);
+    for (int c = 0; c < 3 && fill[i]; c++)
+    {
+      fill[i] = component.Max[c] - component.Min[c] + 1 <= job->EdgeSize;
+    }
+    if (fill[i] && sums != NULL)
+    {
+      fill[i] = FHSquareExists(job, input, sums, component);
+    }
+  }
+
+  for (int i = 0; i < n; i++)
+  {
+    if (parents[i] >= 0 && fill[parents[i]])
+    {
+      output[i] = job->DiscriminationPixelValue;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+// Thread function of ExecuteConnectedComponents, every thread processes slices ThreadID, ThreadID + NumberOfThreads, ...
+static VTK_THREAD_RETURN_TYPE vtkMEDImageFillHolesRemoveIslandsThread(void *arg)
+//----------------------------------------------------------------------------
+{
+  vtkMultiThreader::ThreadInfo *info = (vtkMultiThreader::ThreadInfo *)arg;
+  FH_THREAD_JOB *job = (FH_THREAD_JOB *)info->UserData;
+
+  int sliceSize = job->Dims[0]*job->Dims[1];
+  int sliceDims[3] = {job->Dims[0], job->Dims[1], 1};
+  std::vector<int> sliceParents(job->Volume ? 0 : sliceSize);
+  std::vector<int> sliceSums(job->Volume ? 0 : (job->Dims[0] + 1)*(job->Dims[1] + 1));
+
+  for (int z = info->ThreadID; z < job->Dims[2]; z += info->NumberOfThreads)
+  {
+    if (job->Volume)
+    {
+      FHLabelSlice(job->Input, job->Parents, z*sliceSize, job->Dims[0], job->Dims[1], job->DiscriminationPixelValue, job->EightConnectivity);
+    }
+    else
+    {
+      FHLabelSlice(job->Input + z*sliceSize, &sliceParents[0], 0, job->Dims[0], job->Dims[1], job->DiscriminationPixelValue, job->EightConnectivity);
+      FHSumSlice(job->Input + z*sliceSize, &sliceSums[0], job->Dims[0], job->Dims[1], job->DiscriminationPixelValue);
+      FHFillComponents(job, sliceDims, &sliceParents[0], job->Output + z*sliceSize, job->Input + z*sliceSize, &sliceSums[0]);
+    }
+  }
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
 //----------------------------------------------------------------------------
 vtkMEDImageFillHolesRemoveIslands::vtkMEDImageFillHolesRemoveIslands()
 //----------------------------------------------------------------------------
@@ -40,12 +329,17 @@ vtkMEDImageFillHolesRemoveIslands::vtkMEDImageFillHolesRemoveIslands()
   SetAlgorithmToFillHoles(); // Algorithm = FILL_HOLES; DiscriminationPixelValue = 255;
   EdgeSize = 1;
   RemovePeninsulaRegions = false;
+  Method = SQUARE_SCAN;
+  MaximumArea = 0;
+  Threader = vtkMultiThreader::New();
+  NumberOfThreads = Threader->GetNumberOfThreads();   //number of CPUs
 }
 
 //----------------------------------------------------------------------------
 vtkMEDImageFillHolesRemoveIslands::~vtkMEDImageFillHolesRemoveIslands()
 //----------------------------------------------------------------------------
 { 
+  Threader->Delete();
 }
 
 //----------------------------------------------------------------------------
@@ -84,6 +378,12 @@ void vtkMEDImageFillHolesRemoveIslands::Execute()
   output->UpdateData();
   output->Update();
 
+  if (Method != SQUARE_SCAN)
+  {
+    ExecuteConnectedComponents(input, output);
+    return;
+  }
+
   int recognitionSquareEdge = EdgeSize + 2; // Number of pixels of the recognition square
 
   int dims[3];
@@ -188,4 +488,89 @@ void vtkMEDImageFillHolesRemoveIslands::Execute()
   output->UpdateData();
   output->Update();
   this->SetOutput(output);
-}
\ No newline at end of file
+}
+
+//------------------------------------------------------------------------------
+void vtkMEDImageFillHolesRemoveIslands::ExecuteConnectedComponents(vtkStructuredPoints *input, vtkStructuredPoints *output)
+//------------------------------------------------------------------------------
+{
+  vtkUnsignedCharArray* input_scalars = vtkUnsignedCharArray::SafeDownCast(input->GetPointData()->GetScalars());
+  vtkUnsignedCharArray* output_scalars = vtkUnsignedCharArray::SafeDownCast(output->GetPointData()->GetScalars());
+  if (input_scalars == NULL || output_scalars == NULL || input_scalars->GetNumberOfComponents() != 1)
+  {
+    vtkErrorMacro(<<"Input must be a binary image of unsigned char");
+    return;
+  }
+
+  FH_THREAD_JOB job;
+  job.Input = input_scalars->GetPointer(0);
+  job.Output = output_scalars->GetPointer(0);
+  input->GetDimensions(job.Dims);
+  job.DiscriminationPixelValue = DiscriminationPixelValue;
+  job.EightConnectivity = !RemovePeninsulaRegions;
+  job.RemovePeninsulaRegions = RemovePeninsulaRegions;
+  job.EdgeSize = EdgeSize;
+  job.MaximumArea = MaximumArea;
+  job.Volume = (Method == CONNECTED_COMPONENTS_3D);
+
+  // the volume needs parents of all the voxels
+  std::vector<int> parents(job.Volume ? job.Dims[0]*job.Dims[1]*job.Dims[2] : 0);
+  job.Parents = job.Volume ? &parents[0] : NULL;
+
+  // label (and fill for 2D) slices in parallel
+  int nThreads = NumberOfThreads < job.Dims[2] ? NumberOfThreads : job.Dims[2];
+  if (nThreads > 1)
+  {
+    Threader->SetNumberOfThreads(nThreads);
+    Threader->SetSingleMethod(vtkMEDImageFillHolesRemoveIslandsThread, &job);
+    Threader->SingleMethodExecute();
+  }
+  else
+  {
+    vtkMultiThreader::ThreadInfo info;
+    info.ThreadID = 0;
+    info.NumberOfThreads = 1;
+    info.UserData = &job;
+    vtkMEDImageFillHolesRemoveIslandsThread(&info);
+  }
+
+  if (job.Volume)
+  {
+    // join the components of consecutive slices
+    int nx = job.Dims[0];
+    int ny = job.Dims[1];
+    int sliceSize = nx*ny;
+    for (int z = 1; z < job.Dims[2]; z++)
+    {
+      for (int y = 0, i = z*sliceSize; y < ny; y++)
+      {
+        for (int x = 0; x < nx; x++, i++)
+        {
+          if (parents[i] < 0)
+          {
+            continue;
+          }
+          for (int dy = -1; dy <= 1; dy++)
+          {
+            for (int dx = -1; dx <= 1; dx++)
+            {
+              if ((!job.EightConnectivity && (dx != 0 || dy != 0)) || x + dx < 0 || x + dx >= nx || y + dy < 0 || y + dy >= ny)
+              {
+                continue;
+              }
+              int j = i - sliceSize + dy*nx + dx;
+              if (parents[j] >= 0)
+              {
+                FHUnion(&parents[0], i, j);
+              }
+            }
+          }
+        }
+      }
+    }
+
+    FHFillComponents(&job, job.Dims, &parents[0], job.Output);
+  }
+
+  output->GetPointData()->Modified();
+}
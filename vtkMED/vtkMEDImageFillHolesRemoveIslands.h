@@ -22,6 +22,7 @@
 
 class vtkImageData;
 class vtkStructuredPoints;
+class vtkMultiThreader;
 
 #define OFF_PIXEL 0
 #define ON_PIXEL 255
@@ -29,6 +30,14 @@ class vtkStructuredPoints;
 /** vtkMEDImageFillHolesRemoveIslands: Fill holes or remove island of the specified size (or less) from the given image data
 vtkMEDImageFillHolesRemoveIslands is a vtkStructuredPointsToStructuredPointsFilte that fill holes or remove islands from the specified vtkStructuredPoint
 that must be a binary image represented by a vtkUCharArray with values of 0 or 255 only.
+Holes/islands are recognised either by sliding squares of decreasing size over the first slice (SQUARE_SCAN, default)
+or by labelling the connected components of every slice (CONNECTED_COMPONENTS_2D) or of the whole volume (CONNECTED_COMPONENTS_3D)
+with union-find: a component is filled/removed when it does not touch the border of the image and its bounding box
+is not bigger than the edge size (and its number of pixels is not bigger than the maximum area, if set).
+Connected components are 8 (26 in 3D) connected, 4 (6 in 3D) connected when peninsula regions are removed,
+so that regions joined to the rest only by a corner are recognised. Slices are labelled in parallel.
+CONNECTED_COMPONENTS_2D gives every slice the mask of the square scan: a component is filled/removed only when one
+of the squares of the scan has it inside and only discrimination pixels on its sides (but one corner for peninsulas).
 */
 //---------------------------------------------------------------------------
 class VTK_vtkMED_EXPORT vtkMEDImageFillHolesRemoveIslands : public vtkStructuredPointsToStructuredPointsFilter
@@ -43,6 +52,14 @@ public:
     INVALID_ALGORITHM,
   };
 
+  enum METHODS
+  {
+    SQUARE_SCAN,
+    CONNECTED_COMPONENTS_2D,
+    CONNECTED_COMPONENTS_3D,
+    INVALID_METHOD,
+  };
+
   /** Add collect revision method */
   vtkTypeRevisionMacro(vtkMEDImageFillHolesRemoveIslands,vtkStructuredPointsToStructuredPointsFilter);
 
@@ -73,15 +90,49 @@ public:
   /** Get if peninsula regions are removed or not  */
   vtkGetMacro(RemovePeninsulaRegions,bool);
 
+  /** Set the method recognising holes or islands */
+  vtkSetClampMacro(Method,int,SQUARE_SCAN,CONNECTED_COMPONENTS_3D);
+
+  /** Get the method recognising holes or islands */
+  vtkGetMacro(Method,int);
+
+  /** Set the method recognising holes or islands to the sliding squares on the first slice */
+  inline void SetMethodToSquareScan(){SetMethod(SQUARE_SCAN);};
+
+  /** Set the method recognising holes or islands to the connected components of every slice */
+  inline void SetMethodToConnectedComponents2D(){SetMethod(CONNECTED_COMPONENTS_2D);};
+
+  /** Set the method recognising holes or islands to the connected components of the volume */
+  inline void SetMethodToConnectedComponents3D(){SetMethod(CONNECTED_COMPONENTS_3D);};
+
+  /** Set the maximum number of pixels of holes/islands recognised by connected components, 0 for no limit (default) */
+  vtkSetMacro(MaximumArea,int);
+
+  /** Get the maximum number of pixels of holes/islands recognised by connected components */
+  vtkGetMacro(MaximumArea,int);
+
+  /** Set the number of threads labelling slices (default the number of CPUs) */
+  vtkSetClampMacro(NumberOfThreads,int,1,VTK_MAX_THREADS);
+
+  /** Get the number of threads labelling slices */
+  vtkGetMacro(NumberOfThreads,int);
+
 protected:
 
   /** Execute this filter */
   void Execute();
 
+  /** Fill holes or remove islands recognised by connected components, output must be a copy of input */
+  void ExecuteConnectedComponents(vtkStructuredPoints *input, vtkStructuredPoints *output);
+
   int Algorithm;                            //> fill holes or remove islands
   unsigned int EdgeSize;                    //> maximum holes/islands size
   unsigned char DiscriminationPixelValue;   //> ON_PIXEL for fill holes, OFF_PIXEL for remove islands
   bool RemovePeninsulaRegions;              //> determine if penisnula pixel are removed or not
+  int Method;                               //> square scan or connected components
+  int MaximumArea;                          //> maximum holes/islands number of pixels (connected components only)
+  int NumberOfThreads;                      //> number of threads labelling slices
+  vtkMultiThreader *Threader;
 
 private:
 
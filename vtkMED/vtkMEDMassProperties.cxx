@@ -0,0 +1,366 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: vtkMEDMassProperties
+
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "vtkMEDMassProperties.h"
+
+#include "vtkObjectFactory.h"
+#include "vtkPolyData.h"
+#include "vtkCellArray.h"
+#include "vtkMultiThreader.h"
+#include "vtkMath.h"
+
+#include <vector>
+
+// number of triangles whose coordinates are gathered into arrays processed by one loop
+#define MP_BLOCK_SIZE 64
+
+// number of triangles whose integrals are summed by one task
+#define MP_CHUNK_SIZE 16384
+
+vtkCxxRevisionMacro(vtkMEDMassProperties, "$Revision: 1.1.2.1 $");
+vtkStandardNewMacro(vtkMEDMassProperties);
+
+// data shared by threads of Update
+typedef struct MP_THREAD_JOB
+{
+  const double* Points;
+  const vtkIdType* Triangles;
+  int NumberOfTriangles;
+  int NumberOfChunks;
+  double* ChunkIntegrals;       // 10 integrals for every chunk
+} MP_THREAD_JOB;
+
+//----------------------------------------------------------------------------
+// Thread function of Update, every thread computes integrals of chunks
+// ThreadID, ThreadID + NumberOfThreads, ...
+static VTK_THREAD_RETURN_TYPE vtkMEDMassPropertiesThread(void* arg)
+//----------------------------------------------------------------------------
+{
+  vtkMultiThreader::ThreadInfo* info = (vtkMultiThreader::ThreadInfo*)arg;
+  MP_THREAD_JOB* job = (MP_THREAD_JOB*)info->UserData;
+
+  for (int i = info->ThreadID; i < job->NumberOfChunks; i += info->NumberOfThreads)
+  {
+    int nFirst = i*MP_CHUNK_SIZE;
+    int nCount = job->NumberOfTriangles - nFirst;
+    if (nCount > MP_CHUNK_SIZE)
+      nCount = MP_CHUNK_SIZE;
+
+    double* integrals = job->ChunkIntegrals + 10*i;
+    for (int j = 0; j < 10; j++)
+    {
+      integrals[j] = 0.0;
+    }
+
+    vtkMEDMassProperties::ComputeIntegrals(job->Points, job->Triangles + 3*nFirst, nCount, integrals);
+  }
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+vtkMEDMassProperties::vtkMEDMassProperties()
+//----------------------------------------------------------------------------
+{
+  this->Input = NULL;
+  this->Density = 1.0;
+
+  this->Threader = vtkMultiThreader::New();
+  this->NumberOfThreads = this->Threader->GetNumberOfThreads();   //number of CPUs
+
+  this->Volume = 0.0;
+  this->CenterOfMass[0] = this->CenterOfMass[1] = this->CenterOfMass[2] = 0.0;
+  for (int i = 0; i < 9; i++)
+  {
+    this->InertiaTensor[i] = 0.0;
+  }
+  this->PrincipalMoments[0] = this->PrincipalMoments[1] = this->PrincipalMoments[2] = 0.0;
+  this->NumberOfTriangles = 0;
+
+  this->Points = NULL;
+  this->Triangles = NULL;
+}
+
+//----------------------------------------------------------------------------
+vtkMEDMassProperties::~vtkMEDMassProperties()
+//----------------------------------------------------------------------------
+{
+  this->Threader->Delete();
+}
+
+//----------------------------------------------------------------------------
+void vtkMEDMassProperties::PrintSelf(ostream& os, vtkIndent indent)
+//----------------------------------------------------------------------------
+{
+  this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "Density: " << this->Density << "\n";
+  os << indent << "Number Of Threads: " << this->NumberOfThreads << "\n";
+  os << indent << "Number Of Triangles: " << this->NumberOfTriangles << "\n";
+  os << indent << "Volume: " << this->Volume << "\n";
+  os << indent << "Center Of Mass: (" << this->CenterOfMass[0] << ", "
+    << this->CenterOfMass[1] << ", " << this->CenterOfMass[2] << ")\n";
+  os << indent << "Principal Moments: (" << this->PrincipalMoments[0] << ", "
+    << this->PrincipalMoments[1] << ", " << this->PrincipalMoments[2] << ")\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkMEDMassProperties::ComputeIntegrals(const double* points, const vtkIdType* triangles,
+                                            int nTriangles, double integrals[10])
+//----------------------------------------------------------------------------
+{
+  // coordinates of vertices and terms of integrals for the block of triangles
+  double x[3][MP_BLOCK_SIZE], y[3][MP_BLOCK_SIZE], z[3][MP_BLOCK_SIZE];
+  double terms[10][MP_BLOCK_SIZE];
+
+  for (int nFirst = 0; nFirst < nTriangles; nFirst += MP_BLOCK_SIZE)
+  {
+    int n = nTriangles - nFirst;
+    if (n > MP_BLOCK_SIZE)
+      n = MP_BLOCK_SIZE;
+
+    // gather coordinates
+    const vtkIdType* pIds = triangles + 3*nFirst;
+    for (int i = 0; i < n; i++, pIds += 3)
+    {
+      for (int j = 0; j < 3; j++)
+      {
+        const double* p = points + 3*pIds[j];
+        x[j][i] = p[0]; y[j][i] = p[1]; z[j][i] = p[2];
+      }
+    }
+
+    // closed-form terms, no branches, so the loop can be vectorised
+    for (int i = 0; i < n; i++)
+    {
+      double x0 = x[0][i], x1 = x[1][i], x2 = x[2][i];
+      double y0 = y[0][i], y1 = y[1][i], y2 = y[2][i];
+      double z0 = z[0][i], z1 = z[1][i], z2 = z[2][i];
+
+      // normal of the triangle (not normalized)
+      double a1 = x1 - x0, b1 = y1 - y0, c1 = z1 - z0;
+      double a2 = x2 - x0, b2 = y2 - y0, c2 = z2 - z0;
+      double d0 = b1*c2 - b2*c1;
+      double d1 = a2*c1 - a1*c2;
+      double d2 = a1*b2 - a2*b1;
+
+      // subexpressions of integrals of polynomials over the triangle
+      double t0 = x0 + x1, t1 = x0*x0, t2 = t1 + x1*t0;
+      double f1x = t0 + x2, f2x = t2 + x2*f1x, f3x = x0*t1 + x1*t2 + x2*f2x;
+      double g0x = f2x + x0*(f1x + x0), g1x = f2x + x1*(f1x + x1), g2x = f2x + x2*(f1x + x2);
+
+      t0 = y0 + y1; t1 = y0*y0; t2 = t1 + y1*t0;
+      double f1y = t0 + y2, f2y = t2 + y2*f1y, f3y = y0*t1 + y1*t2 + y2*f2y;
+      double g0y = f2y + y0*(f1y + y0), g1y = f2y + y1*(f1y + y1), g2y = f2y + y2*(f1y + y2);
+
+      t0 = z0 + z1; t1 = z0*z0; t2 = t1 + z1*t0;
+      double f2z = t2 + z2*(t0 + z2), f3z = z0*t1 + z1*t2 + z2*f2z;
+      double f1z = t0 + z2;
+      double g0z = f2z + z0*(f1z + z0), g1z = f2z + z1*(f1z + z1), g2z = f2z + z2*(f1z + z2);
+
+      terms[0][i] = d0*f1x;
+      terms[1][i] = d0*f2x;
+      terms[2][i] = d1*f2y;
+      terms[3][i] = d2*f2z;
+      terms[4][i] = d0*f3x;
+      terms[5][i] = d1*f3y;
+      terms[6][i] = d2*f3z;
+      terms[7][i] = d0*(y0*g0x + y1*g1x + y2*g2x);
+      terms[8][i] = d1*(z0*g0y + z1*g1y + z2*g2y);
+      terms[9][i] = d2*(x0*g0z + x1*g1z + x2*g2z);
+    }
+
+    for (int k = 0; k < 10; k++)
+    {
+      for (int i = 0; i < n; i++)
+      {
+        integrals[k] += terms[k][i];
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkMEDMassProperties::PrepareTriangles(const double center[3])
+//----------------------------------------------------------------------------
+{
+  int nPoints = this->Input->GetNumberOfPoints();
+  this->Points = new double[3*nPoints];
+  for (int i = 0; i < nPoints; i++)
+  {
+    double* p = this->Points + 3*i;
+    this->Input->GetPoint(i, p);
+    p[0] -= center[0]; p[1] -= center[1]; p[2] -= center[2];
+  }
+
+  // count triangles
+  vtkIdType npts, *pts;
+  vtkCellArray* cells[2] = { this->Input->GetPolys(), this->Input->GetStrips() };
+
+  this->NumberOfTriangles = 0;
+  for (int c = 0; c < 2; c++)
+  {
+    for (cells[c]->InitTraversal(); cells[c]->GetNextCell(npts, pts); )
+    {
+      if (npts > 2)
+        this->NumberOfTriangles += npts - 2;
+    }
+  }
+
+  // polygons are triangulated as fans, strips with the alternating orientation
+  this->Triangles = new vtkIdType[3*this->NumberOfTriangles];
+  vtkIdType* pIds = this->Triangles;
+  for (cells[0]->InitTraversal(); cells[0]->GetNextCell(npts, pts); )
+  {
+    for (int j = 0; j < npts - 2; j++, pIds += 3)
+    {
+      pIds[0] = pts[0]; pIds[1] = pts[j + 1]; pIds[2] = pts[j + 2];
+    }
+  }
+
+  for (cells[1]->InitTraversal(); cells[1]->GetNextCell(npts, pts); )
+  {
+    for (int j = 0; j < npts - 2; j++, pIds += 3)
+    {
+      pIds[0] = pts[j]; pIds[1] = pts[j + 1 + (j & 1)]; pIds[2] = pts[j + 2 - (j & 1)];
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkMEDMassProperties::Update()
+//----------------------------------------------------------------------------
+{
+  this->Volume = 0.0;
+  this->CenterOfMass[0] = this->CenterOfMass[1] = this->CenterOfMass[2] = 0.0;
+  for (int i = 0; i < 9; i++)
+  {
+    this->InertiaTensor[i] = 0.0;
+  }
+  this->PrincipalMoments[0] = this->PrincipalMoments[1] = this->PrincipalMoments[2] = 0.0;
+  this->NumberOfTriangles = 0;
+
+  if (this->Input == NULL)
+  {
+    vtkErrorMacro(<<"No input");
+    return;
+  }
+
+  this->Input->Update();
+  if (this->Input->GetNumberOfPoints() == 0)
+    return;
+
+  double bounds[6], center[3];
+  this->Input->GetBounds(bounds);
+  center[0] = (bounds[0] + bounds[1]) / 2;
+  center[1] = (bounds[2] + bounds[3]) / 2;
+  center[2] = (bounds[4] + bounds[5]) / 2;
+
+  this->UpdateProgress(0.0);
+  PrepareTriangles(center);
+
+  // integrate chunks of triangles in parallel
+  MP_THREAD_JOB job;
+  job.Points = this->Points;
+  job.Triangles = this->Triangles;
+  job.NumberOfTriangles = this->NumberOfTriangles;
+  job.NumberOfChunks = (this->NumberOfTriangles + MP_CHUNK_SIZE - 1) / MP_CHUNK_SIZE;
+
+  std::vector< double > chunkIntegrals(10*job.NumberOfChunks + 10);
+  job.ChunkIntegrals = &chunkIntegrals[0];
+
+  int nThreads = this->NumberOfThreads < job.NumberOfChunks ? this->NumberOfThreads : job.NumberOfChunks;
+  if (nThreads > 1)
+  {
+    this->Threader->SetNumberOfThreads(nThreads);
+    this->Threader->SetSingleMethod(vtkMEDMassPropertiesThread, &job);
+    this->Threader->SingleMethodExecute();
+  }
+  else
+  {
+    vtkMultiThreader::ThreadInfo info;
+    info.ThreadID = 0;
+    info.NumberOfThreads = 1;
+    info.UserData = &job;
+    vtkMEDMassPropertiesThread(&info);
+  }
+
+  delete[] this->Points;
+  delete[] this->Triangles;
+  this->Points = NULL;
+  this->Triangles = NULL;
+
+  // sum chunks in their order, so that the result does not depend on the number of threads
+  double integrals[10];
+  for (int k = 0; k < 10; k++)
+  {
+    integrals[k] = 0.0;
+    for (int i = 0; i < job.NumberOfChunks; i++)
+    {
+      integrals[k] += chunkIntegrals[10*i + k];
+    }
+  }
+
+  static const double mult[10] = { 1.0/6, 1.0/24, 1.0/24, 1.0/24,
+    1.0/60, 1.0/60, 1.0/60, 1.0/120, 1.0/120, 1.0/120 };
+  for (int k = 0; k < 10; k++)
+  {
+    integrals[k] *= mult[k];
+  }
+
+  this->Volume = integrals[0];
+  if (this->Volume == 0.0)
+  {
+    vtkWarningMacro(<<"The surface does not bound any volume");
+    this->UpdateProgress(1.0);
+    return;
+  }
+
+  // centre of mass (relative to the centre of bounds)
+  double cm[3];
+  cm[0] = integrals[1] / this->Volume;
+  cm[1] = integrals[2] / this->Volume;
+  cm[2] = integrals[3] / this->Volume;
+
+  // second moments about the centre of mass
+  double xx = integrals[4] - this->Volume*cm[0]*cm[0];
+  double yy = integrals[5] - this->Volume*cm[1]*cm[1];
+  double zz = integrals[6] - this->Volume*cm[2]*cm[2];
+  double xy = integrals[7] - this->Volume*cm[0]*cm[1];
+  double yz = integrals[8] - this->Volume*cm[1]*cm[2];
+  double zx = integrals[9] - this->Volume*cm[2]*cm[0];
+
+  double* I = this->InertiaTensor;
+  I[0] = this->Density*(yy + zz);  I[1] = -this->Density*xy;       I[2] = -this->Density*zx;
+  I[3] = I[1];                     I[4] = this->Density*(zz + xx); I[5] = -this->Density*yz;
+  I[6] = I[2];                     I[7] = I[5];                    I[8] = this->Density*(xx + yy);
+
+  for (int i = 0; i < 3; i++)
+  {
+    this->CenterOfMass[i] = cm[i] + center[i];
+  }
+
+  // principal moments are eigenvalues of the tensor
+  double *a[3], a0[3], a1[3], a2[3], *v[3], v0[3], v1[3], v2[3];
+  a[0] = a0; a[1] = a1; a[2] = a2;
+  v[0] = v0; v[1] = v1; v[2] = v2;
+  for (int i = 0; i < 3; i++)
+  {
+    a0[i] = I[i]; a1[i] = I[3 + i]; a2[i] = I[6 + i];
+  }
+  vtkMath::Jacobi(a, this->PrincipalMoments, v);
+
+  this->UpdateProgress(1.0);
+}
@@ -0,0 +1,133 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: vtkMEDMassProperties
+
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __vtkMEDMassProperties_h
+#define __vtkMEDMassProperties_h
+
+//----------------------------------------------------------------------------
+// Include :
+//----------------------------------------------------------------------------
+#include "vtkProcessObject.h"
+#include "vtkMEDConfigure.h"
+
+//----------------------------------------------------------------------------
+// forward references :
+//----------------------------------------------------------------------------
+class vtkPolyData;
+class vtkMultiThreader;
+
+/**
+    class name: vtkMEDMassProperties
+    Computes exactly the volume, the centre of mass and the inertia tensor of the solid
+    bounded by a closed, consistently oriented triangulated surface (polygons and triangle strips)
+    with the uniform density. The volume integrals of 1, x, y, z, x^2, y^2, z^2, xy, yz and zx are
+    converted by the divergence theorem into closed-form sums over triangles (D. Eberly,
+    Polyhedral Mass Properties), which are accumulated in a single pass over triangles.
+    Triangles are processed in blocks of coordinates gathered into arrays, so that the inner
+    loop has no branches and can be vectorised by the compiler, and chunks of blocks are processed
+    in parallel. Sums of chunks are added in a fixed order, so the results do not depend
+    on the number of threads. Coordinates are taken relatively to the centre of the bounds
+    of the input to avoid the loss of precision for surfaces far from the origin.
+*/
+class VTK_vtkMED_EXPORT vtkMEDMassProperties : public vtkProcessObject
+{
+public:
+  /** RTTI macro */
+  vtkTypeRevisionMacro(vtkMEDMassProperties,vtkProcessObject);
+
+  /** create instance of the object */
+  static vtkMEDMassProperties *New();
+
+  /** print object information */
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /** Set the closed surface */
+  void SetInput(vtkPolyData *input) {this->Input = input; this->Modified();};
+
+  /** Get the closed surface */
+  vtkPolyData* GetInput() {return this->Input;};
+
+  /** Set the uniform density of the solid (default 1) */
+  vtkSetMacro(Density,double);
+  /** Get the uniform density of the solid */
+  vtkGetMacro(Density,double);
+
+  /** Set the number of threads processing triangles (default the number of CPUs) */
+  vtkSetClampMacro(NumberOfThreads,int,1,VTK_MAX_THREADS);
+  /** Get the number of threads processing triangles */
+  vtkGetMacro(NumberOfThreads,int);
+
+  /** Compute the mass properties of the input */
+  void Update();
+
+  /** Get the volume of the solid */
+  double GetVolume() {return this->Volume;};
+
+  /** Get the mass of the solid, i.e., Density * Volume */
+  double GetMass() {return this->Density*this->Volume;};
+
+  /** Get the centre of mass */
+  vtkGetVector3Macro(CenterOfMass,double);
+
+  /** Get the inertia tensor (row by row) about the centre of mass scaled by the density:
+      | Ixx  -Ixy  -Ixz |
+      | -Ixy  Iyy  -Iyz |
+      | -Ixz -Iyz   Izz |  */
+  double* GetInertiaTensor() {return this->InertiaTensor;};
+
+  /** Get the principal moments of inertia (eigenvalues of the inertia tensor) in decreasing order */
+  vtkGetVector3Macro(PrincipalMoments,double);
+
+  /** Get the number of triangles processed by the last Update */
+  vtkGetMacro(NumberOfTriangles,int);
+
+  /** Add to integrals[10] the volume integrals of 1, x, y, z, x^2, y^2, z^2, xy, yz and zx
+      (without the constant factors 1/6, 1/24, 1/60 and 1/120) over the solid bounded
+      by nTriangles triangles, the vertices of the i-th triangle are points[triangles[3*i + j]],
+      points are stored as x, y, z triplets.
+      NB: thread safe, integrals are summed in the order of triangles. */
+  static void ComputeIntegrals(const double* points, const vtkIdType* triangles,
+    int nTriangles, double integrals[10]);
+
+protected:
+  /** object constructor */
+  vtkMEDMassProperties();
+  /** object destructor */
+  ~vtkMEDMassProperties();
+
+  /** Fill Points with coordinates relative to center and Triangles with
+      the triangulation of polygons and strips of the input */
+  void PrepareTriangles(const double center[3]);
+
+  vtkPolyData *Input;
+  double Density;
+  int NumberOfThreads;
+  vtkMultiThreader *Threader;
+
+  double Volume;
+  double CenterOfMass[3];
+  double InertiaTensor[9];
+  double PrincipalMoments[3];
+  int NumberOfTriangles;
+
+  double* Points;               //< coordinates of points relative to the centre of bounds
+  vtkIdType* Triangles;         //< triangulation of the input, 3 point ids per triangle
+
+private:
+  vtkMEDMassProperties(const vtkMEDMassProperties&);  // Not implemented.
+  void operator=(const vtkMEDMassProperties&);  // Not implemented.
+};
+
+#endif
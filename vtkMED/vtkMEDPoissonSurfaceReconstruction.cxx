@@ -22,6 +22,7 @@
 #include "vtkObjectFactory.h"
 #include "vtkFloatArray.h"
 #include "vtkMath.h"
+#include "vtkMultiThreader.h"
 #include "float.h"
 
 
@@ -30,11 +31,17 @@ vtkStandardNewMacro(vtkMEDPoissonSurfaceReconstruction);
 
 vtkDataSet* vtk_psr_input;
 vtkPolyData* vtk_psr_output;
+int vtk_psr_number_of_threads = 1;
+int vtk_psr_number_of_threaded_steps = 0;
 
 //----------------------------------------------------------------------------
 vtkMEDPoissonSurfaceReconstruction::vtkMEDPoissonSurfaceReconstruction()
 //----------------------------------------------------------------------------
 {
+  vtkMultiThreader *threader = vtkMultiThreader::New();
+  NumberOfThreads = threader->GetNumberOfThreads();
+  threader->Delete();
+  NumberOfThreadedSteps = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -70,8 +77,12 @@ void vtkMEDPoissonSurfaceReconstruction::Execute()
 
   vtk_psr_input = input;
   vtk_psr_output = output;
+  vtk_psr_number_of_threads = this->NumberOfThreads;
+  vtk_psr_number_of_threaded_steps = 0;
 
   PSR_main();
+
+  this->NumberOfThreadedSteps = vtk_psr_number_of_threaded_steps;
 }
 
 //----------------------------------------------------------------------------
@@ -90,6 +101,8 @@ void vtkMEDPoissonSurfaceReconstruction::PrintSelf(ostream& os, vtkIndent indent
 //----------------------------------------------------------------------------
 {
   this->Superclass::PrintSelf(os,indent);
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "NumberOfThreadedSteps: " << this->NumberOfThreadedSteps << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -3085,6 +3098,180 @@ Vector<T2> SparseNMatrix<T,Dim>::operator * (const NVector<T2,Dim>& V) const
 	return R;
 }
 
+////////////////////////////
+// Parallel solver helpers //
+////////////////////////////
+// Rows are processed in chunks of PSR_CHUNK_SIZE rows assigned to the threads in a fixed way, and the
+// partial sums of the chunks are added in chunk order, so that the results do not depend on the number
+// of threads.
+#define PSR_CHUNK_SIZE 4096
+// Minimum number of rows for which the rows are processed by more threads
+#define PSR_PARALLEL_ROWS 32768
+// Maximum memory of the full storage of a symmetric matrix (see PSR_SYMMETRIC_JOB)
+#define PSR_MAX_EXPANDED_BYTES (256<<20)
+
+typedef void (*PSR_CHUNK_FUNCTION)(void *userData,int chunk);
+
+typedef struct PSR_CHUNK_JOB
+{
+	PSR_CHUNK_FUNCTION Function;
+	void *UserData;
+	int NumberOfChunks;
+} PSR_CHUNK_JOB;
+
+static VTK_THREAD_RETURN_TYPE PSR_ExecuteChunksThread(void *arg)
+{
+	vtkMultiThreader::ThreadInfo *info=(vtkMultiThreader::ThreadInfo *)arg;
+	PSR_CHUNK_JOB *job=(PSR_CHUNK_JOB *)info->UserData;
+	for(int c=info->ThreadID;c<job->NumberOfChunks;c+=info->NumberOfThreads){job->Function(job->UserData,c);}
+
+	return VTK_THREAD_RETURN_VALUE;
+}
+
+/** Call function for the chunks of rows rows, in vtk_psr_number_of_threads threads for big problems */
+static void PSR_ExecuteChunks(PSR_CHUNK_FUNCTION function,void *userData,int rows)
+{
+	int numberOfChunks=(rows+PSR_CHUNK_SIZE-1)/PSR_CHUNK_SIZE;
+	int nThreads=rows>=PSR_PARALLEL_ROWS ? vtk_psr_number_of_threads : 1;
+	if(nThreads>numberOfChunks){nThreads=numberOfChunks;}
+
+	if(nThreads<=1){
+		for(int c=0;c<numberOfChunks;c++){function(userData,c);}
+	}
+	else{
+		PSR_CHUNK_JOB job;
+		job.Function=function;
+		job.UserData=userData;
+		job.NumberOfChunks=numberOfChunks;
+
+		vtkMultiThreader *threader=vtkMultiThreader::New();
+		threader->SetNumberOfThreads(nThreads);
+		threader->SetSingleMethod(PSR_ExecuteChunksThread,&job);
+		threader->SingleMethodExecute();
+		threader->Delete();
+		vtk_psr_number_of_threaded_steps++;
+	}
+}
+
+/** Product of a symmetric matrix with a vector, and dot products.
+    The threads need the matrix stored with all its entries (each row holds its entries and the
+    transposed entries of the other rows), which takes as much memory again as the half stored by
+    SparseSymmetricMatrix. The full storage is built only for matrices of at least PSR_PARALLEL_ROWS
+    rows taking at most PSR_MAX_EXPANDED_BYTES, the other products use the half storage in the
+    calling thread. The choice does not depend on the number of threads, so neither do the results. */
+template<class T,class T2>
+struct PSR_SYMMETRIC_JOB
+{
+	const SparseSymmetricMatrix<T> *Matrix;
+	bool Expanded;
+	int Rows;
+	std::vector<int> RowStart;
+	std::vector<MatrixEntry<T> > Entries;
+	const T2 *In;
+	T2 *Out;
+	const T2 *A;
+	const T2 *B;
+	std::vector<T2> Partials;
+};
+
+template<class T,class T2>
+static void PSR_SetSymmetricJob(PSR_SYMMETRIC_JOB<T,T2>& job,const SparseSymmetricMatrix<T>& M)
+{
+	int i,j;
+	job.Matrix=&M;
+	job.Rows=M.rows;
+	job.Partials.resize((M.rows+PSR_CHUNK_SIZE-1)/PSR_CHUNK_SIZE);
+
+	double entries=0;
+	for(i=0;i<M.rows;i++){entries+=M.rowSizes[i];}
+	job.Expanded=M.rows>=PSR_PARALLEL_ROWS && 2*entries*sizeof(MatrixEntry<T>)<=PSR_MAX_EXPANDED_BYTES;
+	if(!job.Expanded){return;}
+
+	job.RowStart.assign(M.rows+1,0);
+	for(i=0;i<M.rows;i++){
+		job.RowStart[i+1]+=M.rowSizes[i];
+		for(j=0;j<M.rowSizes[i];j++){job.RowStart[M.m_ppElements[i][j].N+1]++;}
+	}
+	for(i=0;i<M.rows;i++){job.RowStart[i+1]+=job.RowStart[i];}
+
+	// stored entries first, then the transposed entries by increasing row: the sums of a row are added in
+	// a fixed order, so they do not depend on the number of threads, but it is not the order of the serial
+	// SparseSymmetricMatrix product, so the results may differ from it in the last bits
+	std::vector<int> position(job.RowStart.begin(),job.RowStart.end()-1);
+	job.Entries.resize(job.RowStart[M.rows]);
+	for(i=0;i<M.rows;i++){for(j=0;j<M.rowSizes[i];j++){job.Entries[position[i]++]=M.m_ppElements[i][j];}}
+	for(i=0;i<M.rows;i++){
+		for(j=0;j<M.rowSizes[i];j++){
+			MatrixEntry<T>& e=job.Entries[position[M.m_ppElements[i][j].N]++];
+			e.N=i;
+			e.Value=M.m_ppElements[i][j].Value;
+		}
+	}
+}
+
+template<class T,class T2>
+static void PSR_MultiplyChunk(void *userData,int chunk)
+{
+	PSR_SYMMETRIC_JOB<T,T2> *job=(PSR_SYMMETRIC_JOB<T,T2> *)userData;
+	int first=chunk*PSR_CHUNK_SIZE;
+	int last=first+PSR_CHUNK_SIZE<job->Rows ? first+PSR_CHUNK_SIZE : job->Rows;
+	const MatrixEntry<T>* entries=job->Entries.empty() ? NULL : &job->Entries[0];
+	T2 dot=0;
+	for(int i=first;i<last;i++){
+		T2 out1=0;
+		for(int e=job->RowStart[i];e<job->RowStart[i+1];e++){
+			T2 v=entries[e].Value;
+			out1+=v * job->In[entries[e].N];
+		}
+		job->Out[i]=out1;
+		dot+=job->In[i]*out1;
+	}
+	job->Partials[chunk]=dot;
+}
+
+template<class T,class T2>
+static void PSR_DotChunk(void *userData,int chunk)
+{
+	PSR_SYMMETRIC_JOB<T,T2> *job=(PSR_SYMMETRIC_JOB<T,T2> *)userData;
+	int first=chunk*PSR_CHUNK_SIZE;
+	int last=first+PSR_CHUNK_SIZE<job->Rows ? first+PSR_CHUNK_SIZE : job->Rows;
+	T2 dot=0;
+	for(int i=first;i<last;i++){dot+=job->A[i]*job->B[i];}
+	job->Partials[chunk]=dot;
+}
+
+template<class T,class T2>
+static T2 PSR_SumPartials(const PSR_SYMMETRIC_JOB<T,T2>& job)
+{
+	T2 sum=0;
+	for(size_t c=0;c<job.Partials.size();c++){sum+=job.Partials[c];}
+	return sum;
+}
+
+/** return A.B */
+template<class T,class T2>
+static T2 PSR_Dot(PSR_SYMMETRIC_JOB<T,T2>& job,const Vector<T2>& A,const Vector<T2>& B)
+{
+	job.A=A.m_pV;
+	job.B=B.m_pV;
+	PSR_ExecuteChunks(PSR_DotChunk<T,T2>,&job,job.Rows);
+	return PSR_SumPartials(job);
+}
+
+/** Out=M*In, return In.Out */
+template<class T,class T2>
+static T2 PSR_Multiply(PSR_SYMMETRIC_JOB<T,T2>& job,const Vector<T2>& In,Vector<T2>& Out)
+{
+	if(!job.Expanded){
+		job.Matrix->Multiply(In,Out);
+		return PSR_Dot(job,In,Out);
+	}
+	job.In=In.m_pV;
+	job.Out=Out.m_pV;
+	PSR_ExecuteChunks(PSR_MultiplyChunk<T,T2>,&job,job.Rows);
+	return PSR_SumPartials(job);
+}
+
 ///////////////////////////
 // SparseSymmetricMatrix //
 ///////////////////////////
@@ -3132,27 +3319,29 @@ template<class T2>
 int SparseSymmetricMatrix<T>::Solve(const SparseSymmetricMatrix<T>& M,const Vector<T2>& b,const int& iters,Vector<T2>& solution,const T2 eps,const int& reset){
 	Vector<T2> d,r,Md;
 	T2 alpha,beta,rDotR,bDotB;
+	PSR_SYMMETRIC_JOB<T,T2> job;
+	PSR_SetSymmetricJob(job,M);
 	Md.Resize(b.Dimensions());
 	if(reset){
 		solution.Resize(b.Dimensions());
 		solution.SetZero();
 	}
-	d=r=b-M.Multiply(solution);
-	rDotR=r.Dot(r);
-	bDotB=b.Dot(b);
-	if(b.Dot(b)<=eps){
+	PSR_Multiply(job,solution,Md);
+	d=r=b-Md;
+	rDotR=PSR_Dot(job,r,r);
+	bDotB=PSR_Dot(job,b,b);
+	if(bDotB<=eps){
 		solution.SetZero();
 		return 0;
 	}
 	int i;
 	for(i=0;i<iters;i++){
 		T2 temp;
-		M.Multiply(d,Md);
-		temp=d.Dot(Md);
+		temp=PSR_Multiply(job,d,Md);
 		if(fabs(temp)<=eps){break;}
 		alpha=rDotR/temp;
 		r.SubtractScaled(Md,alpha);
-		temp=r.Dot(r);
+		temp=PSR_Dot(job,r,r);
 		if(temp/bDotB<=eps){break;}
 		beta=temp/rDotR;
 		solution.AddScaled(d,alpha);
@@ -3661,7 +3850,7 @@ double Octree<Degree>::maxMemoryUsage=0;
 
 template<int Degree>
 double Octree<Degree>::MemoryUsage(void){
-	double mem=MemoryInfo::Usage()/(1<<20);
+	double mem=double(TreeOctNode::Allocator.MemorySize()+SparseMatrix<float>::Allocator.MemorySize())/(1<<20);
 	if(mem>maxMemoryUsage){maxMemoryUsage=mem;}
 	return mem;
 }
@@ -4092,15 +4281,35 @@ Real Octree<Degree>::GetDotProduct(const int idx[DIMENSION]) const
 	return Real(fData.dotTable[idx[0]]*fData.dotTable[idx[1]]*fData.dotTable[idx[2]]);
 }
 
+/** Rows of the laplacian at a depth computed by chunks of PSR_CHUNK_SIZE rows */
 template<int Degree>
-int Octree<Degree>::GetFixedDepthLaplacian(SparseSymmetricMatrix<float>& matrix,const int& depth,const SortedTreeNodes& sNodes)
+struct PSR_LAPLACIAN_JOB
+{
+	Octree<Degree>* Tree;
+	const SortedTreeNodes* Nodes;
+	int Depth;
+	int Rows;
+	std::vector<std::vector<MatrixEntry<float> > > ChunkEntries;
+	std::vector<int> RowSizes;
+};
+
+template<int Degree>
+static void PSR_LaplacianChunk(void *userData,int chunk)
+{
+	PSR_LAPLACIAN_JOB<Degree> *job=(PSR_LAPLACIAN_JOB<Degree> *)userData;
+	int first=chunk*PSR_CHUNK_SIZE;
+	int last=first+PSR_CHUNK_SIZE<job->Rows ? first+PSR_CHUNK_SIZE : job->Rows;
+	job->Tree->GetFixedDepthLaplacianRows(job->Depth,*job->Nodes,first,last,job->ChunkEntries[chunk],&job->RowSizes[0]);
+}
+
+template<int Degree>
+void Octree<Degree>::GetFixedDepthLaplacianRows(const int& depth,const SortedTreeNodes& sNodes,const int& firstRow,const int& lastRow,std::vector<MatrixEntry<float> >& entries,int* rowSizes)
 {
 	LaplacianMatrixFunction mf;
 	mf.ot=this;
 	mf.offset=sNodes.nodeCount[depth];
-	matrix.Resize(sNodes.nodeCount[depth+1]-sNodes.nodeCount[depth]);
-	mf.rowElements=(MatrixEntry<float>*)malloc(sizeof(MatrixEntry<float>)*matrix.rows);
-	for(int i=sNodes.nodeCount[depth];i<sNodes.nodeCount[depth+1];i++){
+	mf.rowElements=(MatrixEntry<float>*)malloc(sizeof(MatrixEntry<float>)*(sNodes.nodeCount[depth+1]-sNodes.nodeCount[depth]));
+	for(int i=sNodes.nodeCount[depth]+firstRow;i<sNodes.nodeCount[depth]+lastRow;i++){
 		mf.elementCount=0;
 		mf.d2=int(sNodes.treeNodes[i]->d);
 		mf.x2=int(sNodes.treeNodes[i]->off[0]);
@@ -4110,10 +4319,37 @@ int Octree<Degree>::GetFixedDepthLaplacian(SparseSymmetricMatrix<float>& matrix,
 		mf.index[1]=mf.y2;
 		mf.index[2]=mf.z2;
 		TreeOctNode::ProcessTerminatingNodeAdjacentNodes(fData.depth,sNodes.treeNodes[i],2*width-1,&tree,1,&mf);
-		matrix.SetRowSize(i-sNodes.nodeCount[depth],mf.elementCount);
-		memcpy(matrix.m_ppElements[i-sNodes.nodeCount[depth]],mf.rowElements,sizeof(MatrixEntry<float>)*mf.elementCount);
+		rowSizes[i-sNodes.nodeCount[depth]]=mf.elementCount;
+		entries.insert(entries.end(),mf.rowElements,mf.rowElements+mf.elementCount);
 	}
 	free(mf.rowElements);
+}
+
+template<int Degree>
+int Octree<Degree>::GetFixedDepthLaplacian(SparseSymmetricMatrix<float>& matrix,const int& depth,const SortedTreeNodes& sNodes)
+{
+	// rows are computed in parallel, then copied in the matrix since the entries allocator is not thread safe
+	PSR_LAPLACIAN_JOB<Degree> job;
+	job.Tree=this;
+	job.Nodes=&sNodes;
+	job.Depth=depth;
+	job.Rows=sNodes.nodeCount[depth+1]-sNodes.nodeCount[depth];
+	job.ChunkEntries.resize((job.Rows+PSR_CHUNK_SIZE-1)/PSR_CHUNK_SIZE);
+	job.RowSizes.resize(job.Rows+1);
+	matrix.Resize(job.Rows);
+	PSR_ExecuteChunks(PSR_LaplacianChunk<Degree>,&job,job.Rows);
+
+	for(int c=0;c<int(job.ChunkEntries.size());c++){
+		int first=c*PSR_CHUNK_SIZE;
+		int last=first+PSR_CHUNK_SIZE<job.Rows ? first+PSR_CHUNK_SIZE : job.Rows;
+		int position=0;
+		for(int i=first;i<last;i++){
+			matrix.SetRowSize(i,job.RowSizes[i]);
+			if(job.RowSizes[i]){memcpy(matrix.m_ppElements[i],&job.ChunkEntries[c][position],sizeof(MatrixEntry<float>)*job.RowSizes[i]);}
+			position+=job.RowSizes[i];
+		}
+		std::vector<MatrixEntry<float> >().swap(job.ChunkEntries[c]);
+	}
 	return 1;
 }
 template<int Degree>
@@ -57,6 +57,15 @@ public:
   // This is not for external use. 
   void Error(const char *message);
 
+  /** Set/Get the number of threads used by the solver; the reconstructed surface does not depend on it.
+  Big matrices (up to 256MB) are stored again with all their entries to be multiplied by more threads. */
+  vtkSetClampMacro(NumberOfThreads,int,1,VTK_LARGE_INTEGER);
+  vtkGetMacro(NumberOfThreads,int);
+
+  /** Get the number of steps of the last execution (Laplacian rows, products) run by more threads;
+  only matrices of at least 32768 rows are processed by more threads. */
+  vtkGetMacro(NumberOfThreadedSteps,int);
+
 protected:
   /** constructor */
   vtkMEDPoissonSurfaceReconstruction();
@@ -71,6 +80,9 @@ protected:
   void ComputeInputUpdateExtents(vtkDataObject *output);
   /** only check if input is not null */
   void ExecuteInformation(); 
+
+  int NumberOfThreads;
+  int NumberOfThreadedSteps;
   
 private:
   /** copy constructor not implemented */
@@ -161,6 +173,10 @@ public:
 		memory.clear();
 		blockSize=index=remains=0;
 	}
+	/** This method returns the number of bytes allocated by the allocator. */
+	size_t MemorySize(void) const{
+		return memory.size()*blockSize*sizeof(T);
+	}
 	/** This method returns the memory state of the allocator. */
 	AllocatorState getState(void) const{
 		AllocatorState s;
@@ -1947,6 +1963,8 @@ class Octree{
 
   /** compute laplacian, fixed depth */
 	int GetFixedDepthLaplacian(SparseSymmetricMatrix<float>& matrix,const int& depth,const SortedTreeNodes& sNodes);
+  /** compute the rows from firstRow to lastRow (excluded) of the laplacian at the depth, the entries of the rows are appended to entries */
+	void GetFixedDepthLaplacianRows(const int& depth,const SortedTreeNodes& sNodes,const int& firstRow,const int& lastRow,std::vector<MatrixEntry<float> >& entries,int* rowSizes);
   /** compute restricted laplacian, fixed depth */
 	int GetRestrictedFixedDepthLaplacian(SparseSymmetricMatrix<float>& matrix,const int& depth,const int* entries,const int& entryCount,const TreeOctNode* rNode,const Real& radius,const SortedTreeNodes& sNodes);
 
@@ -2027,7 +2045,7 @@ class Octree{
 	void getCornerValueAndNormal(const TreeOctNode* node,const int& corner,Real& value,Point3D<Real>& normal);
 public:
 	static double maxMemoryUsage;
-  /** return memory usage. update max memory usage attribute. */
+  /** return the memory (MB) of the octree nodes and of the matrix entries allocators. update max memory usage attribute. */
 	static double MemoryUsage(void);
 	std::vector< Point3D<Real> >* normals;
 	Real postNormalSmooth;
@@ -25,14 +25,242 @@ PURPOSE.  See the above copyright notice for more information.
 #include "vtkUnsignedCharArray.h"
 #include "vtkPointData.h"
 #include "vtkDataSetWriter.h"
+#include "vtkMultiThreader.h"
 
 #include <math.h>
+#include <vector>
 
 #define APLHA 1.0
 
+// number of slices of a slab processed by one task
+#define RG_SLAB_SIZE 16
+
 vtkCxxRevisionMacro(vtkMEDRegionGrowingLocalGlobalThreshold, "$Revision: 1.1.2.4 $");
 vtkStandardNewMacro(vtkMEDRegionGrowingLocalGlobalThreshold);
 
+// data shared by threads of Update
+typedef struct RG_THREAD_JOB
+{
+  vtkMEDRegionGrowingLocalGlobalThreshold *Filter;
+  void *InputPointer;
+  int InputType;
+  void *OutputPointer;
+  int OutputType;
+  int Dims[3];
+  double LowerThreshold;
+  double UpperThreshold;
+  double LowerLabel;
+  double UpperLabel;
+  int NumberOfSlabs;
+} RG_THREAD_JOB;
+
+// buffers of a thread: box sums of the scalars and of their squares over 3x3 voxels of three consecutive slices
+typedef struct RG_PLANE_SUMS
+{
+  std::vector<double> Sum[3];
+  std::vector<double> Sum2[3];
+  int Slice[3];                 // slice whose sums are stored in the buffer, -1 if none
+  std::vector<double> Row[2];   // sums along x of the previous row of the slice
+} RG_PLANE_SUMS;
+
+//----------------------------------------------------------------------------
+// Compute the sums of the scalars and of their squares over the 3x3 voxels around every voxel of the slice z,
+// rows and columns outside the image are the nearest ones of the image
+template <class IT>
+static void vtkMEDRegionGrowingPlaneSums(const IT *input, const int dims[3], int z, double *sum, double *sum2, double *row, double *row2)
+//----------------------------------------------------------------------------
+{
+  const int nx = dims[0];
+  const int ny = dims[1];
+  const IT *slice = input + (vtkIdType)z*nx*ny;
+
+  // sums along x
+  for (int y = 0; y < ny; y++)
+  {
+    const IT *line = slice + y*nx;
+    double *s = sum + y*nx;
+    double *s2 = sum2 + y*nx;
+    for (int x = 0; x < nx; x++)
+    {
+      double v0 = line[x > 0 ? x - 1 : 0];
+      double v1 = line[x];
+      double v2 = line[x < nx - 1 ? x + 1 : nx - 1];
+      s[x] = v0 + v1 + v2;
+      s2[x] = v0*v0 + v1*v1 + v2*v2;
+    }
+  }
+
+  // sums along y in place, row keeps the sums along x of the previous row
+  for (int x = 0; x < nx; x++)
+  {
+    row[x] = sum[x];
+    row2[x] = sum2[x];
+  }
+  for (int y = 0; y < ny; y++)
+  {
+    double *s = sum + y*nx;
+    double *s2 = sum2 + y*nx;
+    const double *next = sum + (y < ny - 1 ? y + 1 : y)*nx;
+    const double *next2 = sum2 + (y < ny - 1 ? y + 1 : y)*nx;
+    for (int x = 0; x < nx; x++)
+    {
+      double current = s[x];
+      double current2 = s2[x];
+      s[x] = row[x] + current + next[x];
+      s2[x] = row2[x] + current2 + next2[x];
+      row[x] = current;
+      row2[x] = current2;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+// Label the slices [zFirst, zLast) of the input
+template <class IT, class OT>
+static void vtkMEDRegionGrowingExecute(const IT *input, OT *output, RG_THREAD_JOB *job, RG_PLANE_SUMS *sums, int zFirst, int zLast)
+//----------------------------------------------------------------------------
+{
+  const int nx = job->Dims[0];
+  const int ny = job->Dims[1];
+  const int nz = job->Dims[2];
+  const vtkIdType sliceSize = (vtkIdType)nx*ny;
+
+  const OT lowerLabel = (OT)job->LowerLabel;
+  const OT upperLabel = (OT)job->UpperLabel;
+  const double lowerThreshold = job->LowerThreshold;
+  const double upperThreshold = job->UpperThreshold;
+
+  for (int z = zFirst; z < zLast; z++)
+  {
+    // box sums of the slices z-1, z, z+1 (the nearest ones at the borders)
+    int slices[3] = {z > 0 ? z - 1 : 0, z, z < nz - 1 ? z + 1 : nz - 1};
+    const double *sum[3], *sum2[3];
+    for (int i = 0; i < 3; i++)
+    {
+      int b = slices[i] % 3;
+      if (sums->Slice[b] != slices[i])
+      {
+        vtkMEDRegionGrowingPlaneSums(input, job->Dims, slices[i], &sums->Sum[b][0], &sums->Sum2[b][0], &sums->Row[0][0], &sums->Row[1][0]);
+        sums->Slice[b] = slices[i];
+      }
+      sum[i] = &sums->Sum[b][0];
+      sum2[i] = &sums->Sum2[b][0];
+    }
+
+    const IT *in = input + z*sliceSize;
+    OT *out = output + z*sliceSize;
+    for (vtkIdType i = 0; i < sliceSize; i++)
+    {
+      double scalarValue = in[i];
+
+      if (scalarValue > lowerThreshold && scalarValue < upperThreshold)
+      {
+        // mean value and standard deviation of the 26 voxels near (the voxel itself is removed from the box)
+        double s = sum[0][i] + sum[1][i] + sum[2][i] - scalarValue;
+        double s2 = sum2[0][i] + sum2[1][i] + sum2[2][i] - scalarValue*scalarValue;
+        double mean = s / 26;
+        double variance = (26*s2 - s*s) / (26*26);
+        double stdDev = variance > 0 ? sqrt(variance) : 0.0;
+
+        //Condition of region growing
+        out[i] = scalarValue < (mean - ( APLHA*stdDev )) ? lowerLabel : upperLabel;
+      }
+      else if (scalarValue <= lowerThreshold)
+      {
+        out[i] = lowerLabel;
+      }
+      else if (scalarValue >= upperThreshold)
+      {
+        out[i] = upperLabel;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+template <class IT>
+static void vtkMEDRegionGrowingExecute(const IT *input, RG_THREAD_JOB *job, RG_PLANE_SUMS *sums, int zFirst, int zLast)
+//----------------------------------------------------------------------------
+{
+  switch(job->OutputType)
+  {
+  case VTK_DOUBLE:
+    vtkMEDRegionGrowingExecute(input, (double *)job->OutputPointer, job, sums, zFirst, zLast);
+    break;
+  case VTK_FLOAT:
+    vtkMEDRegionGrowingExecute(input, (float *)job->OutputPointer, job, sums, zFirst, zLast);
+    break;
+  case VTK_UNSIGNED_SHORT:
+    vtkMEDRegionGrowingExecute(input, (unsigned short *)job->OutputPointer, job, sums, zFirst, zLast);
+    break;
+  case VTK_SHORT:
+    vtkMEDRegionGrowingExecute(input, (short *)job->OutputPointer, job, sums, zFirst, zLast);
+    break;
+  case VTK_CHAR:
+    vtkMEDRegionGrowingExecute(input, (char *)job->OutputPointer, job, sums, zFirst, zLast);
+    break;
+  case VTK_UNSIGNED_CHAR:
+    vtkMEDRegionGrowingExecute(input, (unsigned char *)job->OutputPointer, job, sums, zFirst, zLast);
+    break;
+  }
+}
+
+//----------------------------------------------------------------------------
+// Thread function of Update, every thread labels slabs ThreadID, ThreadID + NumberOfThreads, ...
+static VTK_THREAD_RETURN_TYPE vtkMEDRegionGrowingThread(void *arg)
+//----------------------------------------------------------------------------
+{
+  vtkMultiThreader::ThreadInfo *info = (vtkMultiThreader::ThreadInfo *)arg;
+  RG_THREAD_JOB *job = (RG_THREAD_JOB *)info->UserData;
+
+  RG_PLANE_SUMS sums;
+  int sliceSize = job->Dims[0]*job->Dims[1];
+  for (int i = 0; i < 3; i++)
+  {
+    sums.Sum[i].resize(sliceSize);
+    sums.Sum2[i].resize(sliceSize);
+    sums.Slice[i] = -1;
+  }
+  sums.Row[0].resize(job->Dims[0]);
+  sums.Row[1].resize(job->Dims[0]);
+
+  for (int slab = info->ThreadID; slab < job->NumberOfSlabs; slab += info->NumberOfThreads)
+  {
+    int zFirst = slab*RG_SLAB_SIZE;
+    int zLast = zFirst + RG_SLAB_SIZE < job->Dims[2] ? zFirst + RG_SLAB_SIZE : job->Dims[2];
+
+    switch(job->InputType)
+    {
+    case VTK_DOUBLE:
+      vtkMEDRegionGrowingExecute((const double *)job->InputPointer, job, &sums, zFirst, zLast);
+      break;
+    case VTK_FLOAT:
+      vtkMEDRegionGrowingExecute((const float *)job->InputPointer, job, &sums, zFirst, zLast);
+      break;
+    case VTK_UNSIGNED_SHORT:
+      vtkMEDRegionGrowingExecute((const unsigned short *)job->InputPointer, job, &sums, zFirst, zLast);
+      break;
+    case VTK_SHORT:
+      vtkMEDRegionGrowingExecute((const short *)job->InputPointer, job, &sums, zFirst, zLast);
+      break;
+    case VTK_CHAR:
+      vtkMEDRegionGrowingExecute((const char *)job->InputPointer, job, &sums, zFirst, zLast);
+      break;
+    case VTK_UNSIGNED_CHAR:
+      vtkMEDRegionGrowingExecute((const unsigned char *)job->InputPointer, job, &sums, zFirst, zLast);
+      break;
+    }
+
+    // the first thread runs in the thread calling Update
+    if (info->ThreadID == 0)
+    {
+      job->Filter->UpdateProgress((double)(slab + 1) / job->NumberOfSlabs);
+    }
+  }
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
 //----------------------------------------------------------------------------
 vtkMEDRegionGrowingLocalGlobalThreshold::vtkMEDRegionGrowingLocalGlobalThreshold()
 //----------------------------------------------------------------------------
@@ -46,6 +274,9 @@ vtkMEDRegionGrowingLocalGlobalThreshold::vtkMEDRegionGrowingLocalGlobalThreshold
   Output = vtkImageData::New();
 
   OutputScalarType = VTK_UNSIGNED_CHAR;
+
+  Threader = vtkMultiThreader::New();
+  NumberOfThreads = Threader->GetNumberOfThreads();   //number of CPUs
 }
 
 //----------------------------------------------------------------------------
@@ -53,6 +284,7 @@ vtkMEDRegionGrowingLocalGlobalThreshold::~vtkMEDRegionGrowingLocalGlobalThreshol
 //----------------------------------------------------------------------------
 {
   Output->Delete();
+  Threader->Delete();
 }
 
 //----------------------------------------------------------------------------
@@ -60,6 +292,8 @@ void vtkMEDRegionGrowingLocalGlobalThreshold::PrintSelf(ostream& os, vtkIndent i
 //----------------------------------------------------------------------------
 {
   this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "NumberOfThreads: " << NumberOfThreads << "\n";
 }
 //----------------------------------------------------------------------------
 void vtkMEDRegionGrowingLocalGlobalThreshold::ComputeIndexNearstPoints(int index, int indexNearest[26] , int &error, vtkImageData *imBordered)
@@ -393,72 +627,52 @@ void vtkMEDRegionGrowingLocalGlobalThreshold::Update()
     scalarsOutput->SetName("Scalars");
     scalarsOutput->SetNumberOfTuples(inputIM->GetNumberOfPoints());
 
-    vtkImageData *imBordered = vtkImageData::New();
-
-    BorderCreate(imBordered);
-    
-    double progress = 0;
-    for (int i=0;i<inputIM->GetPointData()->GetScalars()->GetNumberOfTuples();i++)//For each scalar
+    vtkDataArray *scalars = inputIM->GetPointData()->GetScalars();
+    int inputType = scalars->GetDataType();
+    if (scalars->GetNumberOfComponents() != 1 || !(inputType == VTK_DOUBLE || inputType == VTK_FLOAT ||
+      inputType == VTK_UNSIGNED_SHORT || inputType == VTK_SHORT || inputType == VTK_CHAR || inputType == VTK_UNSIGNED_CHAR))
     {
-      double newProgress = (double)i/inputIM->GetPointData()->GetScalars()->GetNumberOfTuples();
-      if (newProgress > progress + 0.01)
-      {
-      	this->UpdateProgress(newProgress);
-        progress = newProgress;
-      }
-
-      double scalarValue = inputIM->GetPointData()->GetScalars()->GetTuple1(i);
-
-      if (scalarValue > LowerThreshold && scalarValue < UpperThreshold)
-      {
-        int error = FALSE;
-        int indexNearest[26];
-        double mean = 0.0;
-        double stdDev = 0.0;
-        ComputeIndexNearstPoints(i,indexNearest,error,imBordered);
-        if (error == TRUE)
-        {
-          return;
-        }
-        mean = ComputeMeanValue(i,indexNearest,error,imBordered);
-        if (error == TRUE)
-        {
-          return;
-        }
-        stdDev = ComputeStandardDeviation(i,indexNearest,mean,error,imBordered);
-        if (error == TRUE)
-        {
-          return;
-        }
+      vtkErrorMacro(<<"Unsupported scalars of the input");
+      scalarsOutput->Delete();
+      return;
+    }
 
-        //Condition of region growing
-        double valueLabel = scalarValue < (mean - ( APLHA*stdDev )) ? LowerLabel : UpperLabel;
-        scalarsOutput->SetTuple1(i,(double)valueLabel);
-
-//         if ( scalarValue < (mean - ( APLHA*stdDev )) )
-//         {
-//           scalarsOutput->SetTuple1(i,(double)LowerLabel);
-//         }
-//         else if( scalarValue >= (mean - ( APLHA*stdDev )) )
-//         {
-//           scalarsOutput->SetTuple1(i,(double)UpperLabel);
-//         }
-      }
-      else if (scalarValue <= LowerThreshold)
-      {
-        scalarsOutput->SetTuple1(i,(double)LowerLabel);
-      }
-      else if (scalarValue >= UpperThreshold)
-      {
-        scalarsOutput->SetTuple1(i,(double)UpperLabel);
-      }
+    // label slabs of slices in parallel
+    RG_THREAD_JOB job;
+    job.Filter = this;
+    job.InputPointer = scalars->GetVoidPointer(0);
+    job.InputType = inputType;
+    job.OutputPointer = scalarsOutput->GetVoidPointer(0);
+    job.OutputType = scalarsOutput->GetDataType();
+    inputIM->GetDimensions(job.Dims);
+    job.LowerThreshold = LowerThreshold;
+    job.UpperThreshold = UpperThreshold;
+    job.LowerLabel = LowerLabel;
+    job.UpperLabel = UpperLabel;
+    job.NumberOfSlabs = (job.Dims[2] + RG_SLAB_SIZE - 1) / RG_SLAB_SIZE;
+
+    this->UpdateProgress(0.0);
+
+    int nThreads = NumberOfThreads < job.NumberOfSlabs ? NumberOfThreads : job.NumberOfSlabs;
+    if (nThreads > 1)
+    {
+      Threader->SetNumberOfThreads(nThreads);
+      Threader->SetSingleMethod(vtkMEDRegionGrowingThread, &job);
+      Threader->SingleMethodExecute();
+    }
+    else
+    {
+      vtkMultiThreader::ThreadInfo info;
+      info.ThreadID = 0;
+      info.NumberOfThreads = 1;
+      info.UserData = &job;
+      vtkMEDRegionGrowingThread(&info);
     }
 
     Output->GetPointData()->SetScalars(scalarsOutput);
     Output->GetPointData()->GetScalars()->Modified();
     Output->Update();
 
-    imBordered->Delete();
     scalarsOutput->Delete();
   }
 }
\ No newline at end of file
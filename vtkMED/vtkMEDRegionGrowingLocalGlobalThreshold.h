@@ -17,6 +17,7 @@ PURPOSE.  See the above copyright notice for more information.
 #define __vtkMEDRegionGrowingLocalGlobalThreshold_h
 
 class vtkImageData;
+class vtkMultiThreader;
 
 #include "vtkProcessObject.h"
 #include "vtkMEDConfigure.h"
@@ -46,10 +47,17 @@ public:
   vtkGetMacro(OutputScalarType,int);
   vtkSetMacro(OutputScalarType,int);
 
+  /** Set the number of threads processing slabs of slices (default the number of CPUs) */
+  vtkSetClampMacro(NumberOfThreads,int,1,VTK_MAX_THREADS);
+  /** Get the number of threads processing slabs of slices */
+  vtkGetMacro(NumberOfThreads,int);
+
   /** Set the input data */
   void SetInput(vtkImageData *UserSetInput) {this->Input = UserSetInput;};  
 
-  /** Process the algorithm */
+  /** Process the algorithm: the mean value and the standard deviation of the 26 voxels near of every voxel
+  are computed by running 3x3x3 box sums of the scalars and of their squares (borders are the nearest image value),
+  slabs of slices are processed in parallel */
   void Update();
 
   /** Get the output data */
@@ -79,6 +87,9 @@ protected:
   /** Compute the index of the 26 nearest points */
   void ComputeIndexNearstPoints(int index, int indexNearest[26] , int &error, vtkImageData *imBordered);
 
+  int NumberOfThreads;
+  vtkMultiThreader *Threader;
+
 private:
   /** Copy constructor */
   vtkMEDRegionGrowingLocalGlobalThreshold(const vtkMEDRegionGrowingLocalGlobalThreshold&);  // Not implemented.
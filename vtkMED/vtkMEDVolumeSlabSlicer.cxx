@@ -0,0 +1,484 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: vtkMEDVolumeSlabSlicer
+
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "medDefines.h"
+//----------------------------------------------------------------------------
+// NOTE: Every CPP file in the MAF must include "mafDefines.h" as first.
+// This force to include Window,wxWidgets and VTK exactly in this order.
+// Failing in doing this will result in a run-time error saying:
+// "Failure#0: The value of ESP was not properly saved across a function call"
+//----------------------------------------------------------------------------
+
+#include "vtkMEDVolumeSlabSlicer.h"
+#include "vtkObjectFactory.h"
+#include "vtkImageData.h"
+#include "vtkRectilinearGrid.h"
+#include "vtkPointData.h"
+#include "vtkDataArray.h"
+#include "vtkMath.h"
+
+#include <vector>
+#include <algorithm>
+#include <float.h>
+
+vtkCxxRevisionMacro(vtkMEDVolumeSlabSlicer, "$Revision: 1.1.2.1 $");
+vtkStandardNewMacro(vtkMEDVolumeSlabSlicer);
+
+// Minimal number of rows of the output computed by one thread
+#define MIN_ROWS_PER_THREAD 16
+
+// Maximal number of rounds of rows of the output, the progress is updated after each round
+#define SLAB_PROGRESS_ROUNDS 10
+
+// Tolerance (in voxels) of the samples on the boundary of the volume
+#define SLAB_BOUNDARY_TOLERANCE 1.e-6
+
+// Points of the input along one axis
+typedef struct SLAB_AXIS
+{
+  const double *Coordinates;  //< Coordinates of the points (increasing), NULL for a regular axis
+  int Dimension;              //< Number of points
+  double Origin;              //< Coordinate of the first point of a regular axis
+  double InvSpacing;          //< 1 / spacing of a regular axis
+  vtkIdType Increment;        //< Increment of the scalar index between two points (0 if there is one point only)
+} SLAB_AXIS;
+
+// Job of threads computing rows of the output
+typedef struct SLAB_JOB
+{
+  const void *Input;          //< Input scalars
+  void *Output;               //< Output scalars
+  int NumberOfComponents;     //< Number of components of the scalars
+  SLAB_AXIS Axes[3];          //< Points of the input
+  double Origin[3];           //< Position of the first pixel of the output
+  double StepX[3];            //< Distance of two pixels of a row of the output
+  double StepY[3];            //< Distance of two rows of the output
+  double StepZ[3];            //< Distance of two samples along the normal
+  int Dimensions[2];          //< Number of pixels of the output
+  int FromRow, ToRow;         //< Rows of the current round
+  int NumberOfSamples;        //< Number of samples along the normal (odd, the middle one is on the plane)
+  int ProjectionMode;         //< Combination of the samples
+  void (*CreateRows)(const SLAB_JOB *job, int fromRow, int toRow); //< Kernel
+} SLAB_JOB;
+
+//----------------------------------------------------------------------------
+// Finds the cell of axis containing x, index is the first point of the cell and weight the
+// interpolation weight of the second point. Returns false if x is outside the axis.
+static inline bool SS_Locate(const SLAB_AXIS &axis, double x, int &index, double &weight)
+//----------------------------------------------------------------------------
+{
+  index = 0;
+  weight = 0;
+
+  if (axis.Coordinates == NULL)
+  {
+    double t = (x - axis.Origin) * axis.InvSpacing;
+    if (t < -SLAB_BOUNDARY_TOLERANCE || t > axis.Dimension - 1 + SLAB_BOUNDARY_TOLERANCE)
+      return false;
+    if (axis.Dimension == 1)
+      return true;
+
+    index = t <= 0 ? 0 : (int)t;
+    if (index > axis.Dimension - 2)
+      index = axis.Dimension - 2;
+    weight = t - index;
+    weight = weight < 0 ? 0 : (weight > 1 ? 1 : weight);
+    return true;
+  }
+
+  const double *first = axis.Coordinates, *last = axis.Coordinates + axis.Dimension - 1;
+  if (axis.Dimension == 1)
+    return fabs(x - *first) <= SLAB_BOUNDARY_TOLERANCE;
+  if (x < *first || x > *last)
+    return false;
+
+  index = (int)(std::upper_bound(first, last + 1, x) - first) - 1;
+  if (index > axis.Dimension - 2)
+    index = axis.Dimension - 2;
+  weight = (x - first[index]) / (first[index + 1] - first[index]);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Computes rows fromRow to toRow - 1 of the output of job
+template<typename InputDataType, typename OutputDataType>
+static void SS_CreateRows(const SLAB_JOB *job, int fromRow, int toRow)
+//----------------------------------------------------------------------------
+{
+  const InputDataType *input = (const InputDataType *)job->Input;
+  OutputDataType *output = (OutputDataType *)job->Output;
+  const int numComp = job->NumberOfComponents;
+  const int xs = job->Dimensions[0];
+  const int halfSamples = job->NumberOfSamples / 2;
+  const SLAB_AXIS *axes = job->Axes;
+
+  //offsets of the 8 corners of a cell
+  vtkIdType samplingOffs[8];
+  for (int z = 0, si = 0; z < 2; z++)
+    for (int y = 0; y < 2; y++)
+      for (int x = 0; x < 2; x++, si++)
+        samplingOffs[si] = x*axes[0].Increment + y*axes[1].Increment + z*axes[2].Increment;
+
+  //integer outputs are rounded, the cast would truncate them
+  const bool roundValues = (OutputDataType)0.5 == 0;
+
+  std::vector<double> values(numComp);
+  for (int yi = fromRow; yi < toRow; yi++)
+  {
+    OutputDataType *pixel = output + ((vtkIdType)yi) * xs * numComp;
+    for (int xi = 0; xi < xs; xi++, pixel += numComp)
+    {
+      //the position is computed directly, so that there is no accumulation of errors
+      const double p[3] = {
+        job->Origin[0] + xi*job->StepX[0] + yi*job->StepY[0],
+        job->Origin[1] + xi*job->StepX[1] + yi*job->StepY[1],
+        job->Origin[2] + xi*job->StepX[2] + yi*job->StepY[2]};
+
+      for (int comp = 0; comp < numComp; comp++)
+      {
+        values[comp] = job->ProjectionMode == vtkMEDVolumeSlabSlicer::MAX_PROJECTION ? -VTK_DOUBLE_MAX :
+          (job->ProjectionMode == vtkMEDVolumeSlabSlicer::MIN_PROJECTION ? VTK_DOUBLE_MAX : 0.0);
+      }
+
+      int numberOfSamples = 0;
+      for (int s = -halfSamples; s <= halfSamples; s++)
+      {
+        const double q[3] = {p[0] + s*job->StepZ[0], p[1] + s*job->StepZ[1], p[2] + s*job->StepZ[2]};
+
+        int ijk[3];
+        double w[3];
+        if (!SS_Locate(axes[0], q[0], ijk[0], w[0]) || !SS_Locate(axes[1], q[1], ijk[1], w[1]) ||
+          !SS_Locate(axes[2], q[2], ijk[2], w[2]))
+          continue;   //sample is outside the volume
+
+        const vtkIdType index = ijk[0]*axes[0].Increment + ijk[1]*axes[1].Increment + ijk[2]*axes[2].Increment;
+        for (int comp = 0; comp < numComp; comp++)
+        {
+          // tri-linear interpolation
+          double sample = 0.0;
+          for (int z = 0, si = 0; z < 2; z++)
+          {
+            const double zweight = z ? w[2] : 1.0 - w[2];
+            for (int y = 0; y < 2; y++)
+            {
+              const double yzweight = (y ? w[1] : 1.0 - w[1]) * zweight;
+              for (int x = 0; x < 2; x++, si++)
+                sample += input[samplingOffs[si] + index + comp] * (x ? w[0] : 1.0 - w[0]) * yzweight;
+            }
+          }
+
+          switch (job->ProjectionMode)
+          {
+          case vtkMEDVolumeSlabSlicer::MAX_PROJECTION:
+            if (sample > values[comp])
+              values[comp] = sample;
+            break;
+          case vtkMEDVolumeSlabSlicer::MIN_PROJECTION:
+            if (sample < values[comp])
+              values[comp] = sample;
+            break;
+          default:
+            values[comp] += sample;
+            break;
+          }
+        }
+        numberOfSamples++;
+      }
+
+      for (int comp = 0; comp < numComp; comp++)
+      {
+        double value = 0.0;
+        if (numberOfSamples > 0)
+          value = job->ProjectionMode == vtkMEDVolumeSlabSlicer::AVERAGE_PROJECTION ? values[comp] / numberOfSamples : values[comp];
+        pixel[comp] = (OutputDataType)(roundValues ? floor(value + 0.5) : value);
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+// Thread function of CreateImage, every thread computes one slab of consecutive rows of the round
+static VTK_THREAD_RETURN_TYPE SS_CreateRowsThread(void *arg)
+//----------------------------------------------------------------------------
+{
+  vtkMultiThreader::ThreadInfo *info = (vtkMultiThreader::ThreadInfo *)arg;
+  const SLAB_JOB *job = (const SLAB_JOB *)info->UserData;
+
+  int rows = job->ToRow - job->FromRow;
+  int fromRow = job->FromRow + info->ThreadID * rows / info->NumberOfThreads;
+  int toRow = job->FromRow + (info->ThreadID + 1) * rows / info->NumberOfThreads;
+  job->CreateRows(job, fromRow, toRow);
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+vtkMEDVolumeSlabSlicer::vtkMEDVolumeSlabSlicer()
+//----------------------------------------------------------------------------
+{
+  PlaneOrigin[0] = PlaneOrigin[1] = PlaneOrigin[2] = 0.;
+  PlaneAxisX[0] = 1.; PlaneAxisX[1] = PlaneAxisX[2] = 0.;
+  PlaneAxisY[1] = 1.; PlaneAxisY[0] = PlaneAxisY[2] = 0.;
+  OutputDimensions[0] = OutputDimensions[1] = 512;
+  OutputSpacing[0] = OutputSpacing[1] = 1.;
+  SlabThickness = 0.;
+  SampleDistance = 0.;
+  ProjectionMode = AVERAGE_PROJECTION;
+  OutputScalarType = -1;
+  NumberOfSamples = 0;
+
+  Threader = vtkMultiThreader::New();
+  NumberOfThreads = Threader->GetNumberOfThreads(); // number of CPUs
+}
+
+//----------------------------------------------------------------------------
+vtkMEDVolumeSlabSlicer::~vtkMEDVolumeSlabSlicer()
+//----------------------------------------------------------------------------
+{
+  Threader->Delete();
+}
+
+//----------------------------------------------------------------------------
+void vtkMEDVolumeSlabSlicer::ExecuteInformation()
+//----------------------------------------------------------------------------
+{
+  vtkDataSet *input = NULL;
+  if ((input = GetInput()) == NULL || this->GetNumberOfOutputs() == 0)
+    return; // No input or no output
+
+  vtkImageData *output = this->GetOutput();
+  output->SetWholeExtent(0, OutputDimensions[0] - 1, 0, OutputDimensions[1] - 1, 0, 0);
+  output->SetOrigin(PlaneOrigin);
+  output->SetSpacing(OutputSpacing[0], OutputSpacing[1], 1.);
+
+  vtkDataArray *inputScalars = input->GetPointData()->GetScalars();
+  if (inputScalars != NULL)
+  {
+    output->SetScalarType(OutputScalarType < 0 ? inputScalars->GetDataType() : OutputScalarType);
+    output->SetNumberOfScalarComponents(inputScalars->GetNumberOfComponents());
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkMEDVolumeSlabSlicer::ExecuteData(vtkDataObject *output)
+//----------------------------------------------------------------------------
+{
+  // Redirect on correct output type ExecuteData function
+  if (vtkImageData::SafeDownCast(output) != NULL)
+    this->ExecuteData((vtkImageData*)output);
+}
+
+//----------------------------------------------------------------------------
+void vtkMEDVolumeSlabSlicer::ExecuteData(vtkImageData *output)
+//----------------------------------------------------------------------------
+{
+  output->SetExtent(output->GetWholeExtent());
+  output->AllocateScalars();
+
+  vtkDataArray *outputScalars = output->GetPointData()->GetScalars();
+  memset(outputScalars->GetVoidPointer(0), 0, outputScalars->GetSize() * outputScalars->GetDataTypeSize());
+
+  vtkDataSet *input = this->GetInput();
+  vtkDataArray *inputScalars = input != NULL ? input->GetPointData()->GetScalars() : NULL;
+  if (inputScalars == NULL || inputScalars->GetNumberOfTuples() == 0)
+    return; // black image
+
+  const void *inputPointer = inputScalars->GetVoidPointer(0);
+  switch (inputScalars->GetDataType())
+  {
+  case VTK_CHAR:
+    this->CreateImage((const char*)inputPointer, output); break;
+  case VTK_UNSIGNED_CHAR:
+    this->CreateImage((const unsigned char*)inputPointer, output); break;
+  case VTK_SHORT:
+    this->CreateImage((const short*)inputPointer, output); break;
+  case VTK_UNSIGNED_SHORT:
+    this->CreateImage((const unsigned short*)inputPointer, output); break;
+  case VTK_INT:
+    this->CreateImage((const int*)inputPointer, output); break;
+  case VTK_UNSIGNED_INT:
+    this->CreateImage((const unsigned int*)inputPointer, output); break;
+  case VTK_FLOAT:
+    this->CreateImage((const float*)inputPointer, output); break;
+  case VTK_DOUBLE:
+    this->CreateImage((const double*)inputPointer, output); break;
+  default:
+    vtkErrorMacro(<< "vtkMEDVolumeSlabSlicer: Scalar type is not supported");
+    return;
+  }
+}
+
+//----------------------------------------------------------------------------
+template<typename InputDataType>
+void vtkMEDVolumeSlabSlicer::CreateImage(const InputDataType *input, vtkImageData *output)
+//----------------------------------------------------------------------------
+{
+  void *outputPointer = output->GetPointData()->GetScalars()->GetVoidPointer(0);
+  switch (output->GetPointData()->GetScalars()->GetDataType())
+  {
+  case VTK_CHAR:
+    this->CreateImage(input, (char*)outputPointer); break;
+  case VTK_UNSIGNED_CHAR:
+    this->CreateImage(input, (unsigned char*)outputPointer); break;
+  case VTK_SHORT:
+    this->CreateImage(input, (short*)outputPointer); break;
+  case VTK_UNSIGNED_SHORT:
+    this->CreateImage(input, (unsigned short*)outputPointer); break;
+  case VTK_INT:
+    this->CreateImage(input, (int*)outputPointer); break;
+  case VTK_UNSIGNED_INT:
+    this->CreateImage(input, (unsigned int*)outputPointer); break;
+  case VTK_FLOAT:
+    this->CreateImage(input, (float*)outputPointer); break;
+  case VTK_DOUBLE:
+    this->CreateImage(input, (double*)outputPointer); break;
+  default:
+    vtkErrorMacro(<< "vtkMEDVolumeSlabSlicer: Output scalar type is not supported");
+    return;
+  }
+}
+
+//----------------------------------------------------------------------------
+template<typename InputDataType, typename OutputDataType>
+void vtkMEDVolumeSlabSlicer::CreateImage(const InputDataType *input, OutputDataType *output)
+//----------------------------------------------------------------------------
+{
+  vtkDataSet *inputData = this->GetInput();
+
+  SLAB_JOB job;
+  job.Input = input;
+  job.Output = output;
+  job.NumberOfComponents = inputData->GetPointData()->GetScalars()->GetNumberOfComponents();
+  job.Dimensions[0] = OutputDimensions[0];
+  job.Dimensions[1] = OutputDimensions[1];
+  job.ProjectionMode = ProjectionMode;
+  job.CreateRows = &SS_CreateRows<InputDataType, OutputDataType>;
+
+  //points of the input along the axes, rectilinear grid coordinates are kept in coordinates
+  int dims[3];
+  double minSpacing = VTK_DOUBLE_MAX;
+  std::vector<double> coordinates[3];
+  vtkImageData *imageData = vtkImageData::SafeDownCast(inputData);
+  vtkRectilinearGrid *gridData = vtkRectilinearGrid::SafeDownCast(inputData);
+  if (imageData != NULL)
+  {
+    double origin[3], spacing[3];
+    imageData->GetDimensions(dims);
+    imageData->GetOrigin(origin);
+    imageData->GetSpacing(spacing);
+    for (int i = 0; i < 3; i++)
+    {
+      job.Axes[i].Coordinates = NULL;
+      job.Axes[i].Origin = origin[i];
+      job.Axes[i].InvSpacing = spacing[i] != 0 ? 1.0 / spacing[i] : 0.0;
+      if (dims[i] > 1 && fabs(spacing[i]) < minSpacing)
+        minSpacing = fabs(spacing[i]);
+    }
+  }
+  else if (gridData != NULL)
+  {
+    gridData->GetDimensions(dims);
+    vtkDataArray *coords[3] = {gridData->GetXCoordinates(), gridData->GetYCoordinates(), gridData->GetZCoordinates()};
+    for (int i = 0; i < 3; i++)
+    {
+      coordinates[i].resize(dims[i]);
+      for (int c = 0; c < dims[i]; c++)
+        coordinates[i][c] = coords[i]->GetTuple1(c);
+
+      job.Axes[i].Coordinates = &coordinates[i][0];
+      job.Axes[i].Origin = coordinates[i][0];
+      job.Axes[i].InvSpacing = 0.0;
+      if (dims[i] > 1)
+      {
+        double spacing = (coordinates[i][dims[i] - 1] - coordinates[i][0]) / (dims[i] - 1);
+        if (spacing < minSpacing)
+          minSpacing = spacing;
+      }
+    }
+  }
+  else
+  {
+    vtkErrorMacro(<< "vtkMEDVolumeSlabSlicer: Invalid input, vtkImageData or vtkRectilinearGrid expected");
+    return;
+  }
+
+  vtkIdType increment = job.NumberOfComponents;
+  for (int i = 0; i < 3; i++)
+  {
+    job.Axes[i].Dimension = dims[i];
+    job.Axes[i].Increment = dims[i] > 1 ? increment : 0;
+    increment *= dims[i];
+  }
+
+  //the plane and its normal
+  double axisX[3] = {PlaneAxisX[0], PlaneAxisX[1], PlaneAxisX[2]};
+  double axisY[3] = {PlaneAxisY[0], PlaneAxisY[1], PlaneAxisY[2]};
+  double normal[3];
+  vtkMath::Normalize(axisX);
+  vtkMath::Normalize(axisY);
+  vtkMath::Cross(axisX, axisY, normal);
+  if (vtkMath::Normalize(normal) == 0.0)
+  {
+    vtkErrorMacro(<< "vtkMEDVolumeSlabSlicer: PlaneAxisX and PlaneAxisY are parallel");
+    return;
+  }
+
+  //samples are symmetric around the plane, the middle one is on the plane
+  double sampleDistance = SampleDistance;
+  if (sampleDistance <= 0)
+    sampleDistance = minSpacing < VTK_DOUBLE_MAX && minSpacing > 0 ? minSpacing : 1.0;
+
+  int halfSamples = (int)((SlabThickness / sampleDistance + 1) / 2);
+  NumberOfSamples = 2 * halfSamples + 1;
+
+  for (int i = 0; i < 3; i++)
+  {
+    job.Origin[i] = PlaneOrigin[i];
+    job.StepX[i] = axisX[i] * OutputSpacing[0];
+    job.StepY[i] = axisY[i] * OutputSpacing[1];
+    job.StepZ[i] = normal[i] * sampleDistance;
+  }
+  job.NumberOfSamples = NumberOfSamples;
+
+  //rows are computed in rounds, the rows of a round are split into slabs, one per thread:
+  //rounds are made large enough to keep all threads busy
+  int rounds = OutputDimensions[1] / (MIN_ROWS_PER_THREAD * NumberOfThreads);
+  if (rounds > SLAB_PROGRESS_ROUNDS)
+    rounds = SLAB_PROGRESS_ROUNDS;
+  if (rounds < 1)
+    rounds = 1;
+
+  this->UpdateProgress(0.0);
+  for (int round = 0; round < rounds; round++)
+  {
+    job.FromRow = round * OutputDimensions[1] / rounds;
+    job.ToRow = (round + 1) * OutputDimensions[1] / rounds;
+
+    int nThreads = (job.ToRow - job.FromRow) / MIN_ROWS_PER_THREAD;
+    if (nThreads > NumberOfThreads)
+      nThreads = NumberOfThreads;
+    if (nThreads <= 1)
+    {
+      job.CreateRows(&job, job.FromRow, job.ToRow);
+    }
+    else
+    {
+      Threader->SetNumberOfThreads(nThreads);
+      Threader->SetSingleMethod(SS_CreateRowsThread, &job);
+      Threader->SingleMethodExecute();
+    }
+    this->UpdateProgress((round + 1.0) / rounds);
+  }
+}
@@ -0,0 +1,167 @@
+/*=========================================================================
+
+ Program: MAF2Medical
+ Module: vtkMEDVolumeSlabSlicer
+
+ Copyright (c) B3C
+ All rights reserved. See Copyright.txt or
+ http://www.scsitaly.com/Copyright.htm for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __vtkMEDVolumeSlabSlicer_H__
+#define __vtkMEDVolumeSlabSlicer_H__
+
+#include "vtkImageData.h"
+#include "vtkMEDConfigure.h"
+#include "vtkDataSetToImageFilter.h"
+#include "vtkMultiThreader.h"
+
+/**
+  class name: vtkMEDVolumeSlabSlicer
+  Projects a thick slab of a volume (vtkImageData or vtkRectilinearGrid) on a plane.
+
+  The output pixel [i,j] lies at PlaneOrigin + i*OutputSpacing[0]*PlaneAxisX + j*OutputSpacing[1]*PlaneAxisY,
+  i.e., the output has the same geometry of the textures produced by vtkMAFVolumeSlicer for the same plane.
+  For every pixel the volume is sampled (tri-linear interpolation) once at each SampleDistance along
+  the plane normal, within SlabThickness/2 on both sides of the plane, and the samples are combined
+  as average (RX-like projection), maximum (MIP) or minimum (MinIP). Samples outside the volume are
+  not taken into account, pixels without samples are 0, values of integer outputs are rounded.
+  Rows of the output are computed by different threads, the output does not depend on their number;
+  the progress is updated after each round of rows.
+*/
+//----------------------------------------------------------------------------
+class VTK_vtkMED_EXPORT vtkMEDVolumeSlabSlicer : public vtkDataSetToImageFilter
+//----------------------------------------------------------------------------
+{
+public:
+
+  /** Combination of the samples of the slab */
+  enum PROJECTION_MODE
+  {
+    AVERAGE_PROJECTION = 0,
+    MAX_PROJECTION,
+    MIN_PROJECTION,
+  };
+
+  /** */
+  static vtkMEDVolumeSlabSlicer *New();
+
+  /** RTTI Macro */
+  vtkTypeRevisionMacro(vtkMEDVolumeSlabSlicer, vtkDataSetToImageFilter);
+
+  /** Set the position of the first pixel of the output (in the coordinates of the input) */
+  vtkSetVector3Macro(PlaneOrigin, double);
+
+  /** Get the position of the first pixel of the output */
+  vtkGetVector3Macro(PlaneOrigin, double);
+
+  /** Set the direction of the rows of the output, it is normalized during the execution */
+  vtkSetVector3Macro(PlaneAxisX, double);
+
+  /** Get the direction of the rows of the output */
+  vtkGetVector3Macro(PlaneAxisX, double);
+
+  /** Set the direction of the columns of the output, it is normalized during the execution */
+  vtkSetVector3Macro(PlaneAxisY, double);
+
+  /** Get the direction of the columns of the output */
+  vtkGetVector3Macro(PlaneAxisY, double);
+
+  /** Set the number of pixels of the output along PlaneAxisX and PlaneAxisY */
+  vtkSetVector2Macro(OutputDimensions, int);
+
+  /** Get the number of pixels of the output */
+  vtkGetVector2Macro(OutputDimensions, int);
+
+  /** Set the distance of the pixels of the output along PlaneAxisX and PlaneAxisY */
+  vtkSetVector2Macro(OutputSpacing, double);
+
+  /** Get the distance of the pixels of the output */
+  vtkGetVector2Macro(OutputSpacing, double);
+
+  /** Set the thickness of the slab, 0 to slice the volume on the plane */
+  vtkSetClampMacro(SlabThickness, double, 0, VTK_DOUBLE_MAX);
+
+  /** Get the thickness of the slab */
+  vtkGetMacro(SlabThickness, double);
+
+  /** Set the distance of the samples along the normal of the plane,
+  0 (default) to use the minimal spacing of the input */
+  vtkSetClampMacro(SampleDistance, double, 0, VTK_DOUBLE_MAX);
+
+  /** Get the distance of the samples along the normal of the plane */
+  vtkGetMacro(SampleDistance, double);
+
+  /** Set the combination of the samples (see PROJECTION_MODE), AVERAGE_PROJECTION by default */
+  vtkSetClampMacro(ProjectionMode, int, AVERAGE_PROJECTION, MIN_PROJECTION);
+
+  /** Get the combination of the samples */
+  vtkGetMacro(ProjectionMode, int);
+
+  /** Set the scalar type of the output, -1 (default) for the scalar type of the input */
+  vtkSetMacro(OutputScalarType, int);
+
+  /** Get the scalar type of the output */
+  vtkGetMacro(OutputScalarType, int);
+
+  /** Set the maximal number of threads used to compute the output,
+  by default the number of CPUs (the output does not depend on it) */
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+
+  /** Get the maximal number of threads used to compute the output */
+  vtkGetMacro(NumberOfThreads, int);
+
+  /** Return the number of samples along the normal of the plane of the last execution */
+  vtkGetMacro(NumberOfSamples, int);
+
+protected:
+
+  /** ctor */
+  vtkMEDVolumeSlabSlicer();
+
+  /** dtor */
+  ~vtkMEDVolumeSlabSlicer();
+
+  /** Set the geometry and the scalar type of the output */
+  virtual void ExecuteInformation();
+
+  /** Redirect on ExecuteData(vtkImageData *) */
+  /*virtual*/ void ExecuteData(vtkDataObject *output);
+
+  /** Compute the projection of the slab */
+  virtual void ExecuteData(vtkImageData *output);
+
+  /** Compute the projection from input scalars of type InputDataType */
+  template<typename InputDataType>
+  void CreateImage(const InputDataType *input, vtkImageData *output);
+
+  /** Compute the projection from input scalars of type InputDataType to output scalars of type OutputDataType */
+  template<typename InputDataType, typename OutputDataType>
+  void CreateImage(const InputDataType *input, OutputDataType *output);
+
+  double PlaneOrigin[3];        //< Position of the first pixel of the output
+  double PlaneAxisX[3];         //< Direction of the rows of the output
+  double PlaneAxisY[3];         //< Direction of the columns of the output
+  int OutputDimensions[2];      //< Number of pixels of the output
+  double OutputSpacing[2];      //< Distance of the pixels of the output
+  double SlabThickness;         //< Thickness of the slab
+  double SampleDistance;        //< Distance of the samples along the normal (0 for the minimal input spacing)
+  int ProjectionMode;           //< Combination of the samples
+  int OutputScalarType;         //< Scalar type of the output (-1 for the input type)
+  int NumberOfSamples;          //< Number of samples along the normal of the last execution
+
+  vtkMultiThreader *Threader;   //< Threads computing rows of the output
+  int NumberOfThreads;          //< Maximal number of threads used by the Threader
+
+private:
+  /** Not implemented */
+  vtkMEDVolumeSlabSlicer(const vtkMEDVolumeSlabSlicer&);
+  /** Not implemented */
+  void operator=(const vtkMEDVolumeSlabSlicer&);
+};
+#endif //#ifndef __vtkMEDVolumeSlabSlicer_H__
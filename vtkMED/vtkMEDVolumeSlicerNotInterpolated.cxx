@@ -42,6 +42,56 @@
 vtkCxxRevisionMacro(vtkMEDVolumeSlicerNotInterpolated, "$Revision: 1.1.2.3 $");
 vtkStandardNewMacro(vtkMEDVolumeSlicerNotInterpolated);
 
+// Minimal number of rows of the slice extracted by one thread
+#define MIN_ROWS_PER_THREAD 16
+
+// Job of threads extracting rows of the slice
+typedef struct EXTRACT_ROWS_JOB
+{
+  const char *InputPointer;   //< Input scalars
+  char *OutputPointer;        //< Output scalars
+  int TupleSize;              //< Size of one tuple in bytes
+  int ILength;                //< Number of tuples in one row of the slice
+  int JLength;                //< Number of rows of the slice
+  int IStart;                 //< Index of the first column of the slice in the input
+  int JStart;                 //< Index of the first row of the slice in the input
+  vtkIdType IFactor;          //< Increment of the input tuple index between two columns
+  vtkIdType JFactor;          //< Increment of the input tuple index between two rows
+  vtkIdType BaseIndex;        //< Index of the input tuple of the slice origin
+} EXTRACT_ROWS_JOB;
+
+//----------------------------------------------------------------------------
+// Copies rows from fromRow to toRow - 1 of the slice from the input
+static void ExtractRows(const EXTRACT_ROWS_JOB *job, int fromRow, int toRow)
+//----------------------------------------------------------------------------
+{
+  const int tupleSize = job->TupleSize;
+  for(int j = fromRow; j < toRow; j++)
+  {
+    char *outputTuple = job->OutputPointer + ((vtkIdType)j) * job->ILength * tupleSize;
+    vtkIdType index = (j + job->JStart) * job->JFactor + job->IStart * job->IFactor + job->BaseIndex;
+    for(int i = 0; i < job->ILength; i++, index += job->IFactor, outputTuple += tupleSize)
+    {
+      memcpy(outputTuple, job->InputPointer + index * tupleSize, tupleSize);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+// Thread function of ExecuteData, every thread extracts one slab of consecutive rows
+static VTK_THREAD_RETURN_TYPE ExtractRowsThread(void *arg)
+//----------------------------------------------------------------------------
+{
+  vtkMultiThreader::ThreadInfo *info = (vtkMultiThreader::ThreadInfo *)arg;
+  const EXTRACT_ROWS_JOB *job = (const EXTRACT_ROWS_JOB *)info->UserData;
+
+  int fromRow = info->ThreadID * job->JLength / info->NumberOfThreads;
+  int toRow = (info->ThreadID + 1) * job->JLength / info->NumberOfThreads;
+  ExtractRows(job, fromRow, toRow);
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
 //----------------------------------------------------------------------------
 vtkMEDVolumeSlicerNotInterpolated::vtkMEDVolumeSlicerNotInterpolated() 
 //----------------------------------------------------------------------------
@@ -64,6 +114,9 @@ vtkMEDVolumeSlicerNotInterpolated::vtkMEDVolumeSlicerNotInterpolated()
   AxisY = 1;
 
   NumberOfPieces = 1;
+
+  Threader = vtkMultiThreader::New();
+  NumberOfThreads = Threader->GetNumberOfThreads(); // number of CPUs
 }
 //----------------------------------------------------------------------------
 vtkMEDVolumeSlicerNotInterpolated::~vtkMEDVolumeSlicerNotInterpolated() 
@@ -74,6 +127,8 @@ vtkMEDVolumeSlicerNotInterpolated::~vtkMEDVolumeSlicerNotInterpolated()
     OutputRectilinearGrid->Delete();
     OutputRectilinearGrid = NULL;
   }
+
+  Threader->Delete();
 }
 
 //----------------------------------------------------------------------------
@@ -451,8 +506,8 @@ void vtkMEDVolumeSlicerNotInterpolated::ExecuteData(vtkImageData *output)
     vtkDataArray * inputScalars = input->GetPointData()->GetScalars();
 
     // Fill variables for scalar index recognition
-    double iFactor = 1;
-    double jFactor = InputDimensions[0];
+    vtkIdType iFactor = 1;
+    vtkIdType jFactor = InputDimensions[0];
     switch(SliceAxis)
     {
     case SLICE_Z:
@@ -534,15 +589,35 @@ void vtkMEDVolumeSlicerNotInterpolated::ExecuteData(vtkImageData *output)
       jLenght--;
     }
 
-    // Fill output scalars with the right values
-    for(int j = 0; j < jLenght; j++)
+    // Fill output scalars with the right values, the output has the same type
+    // as the input, so tuples are copied; every row is independent, so slabs 
+    // of rows are extracted concurrently
+    scalars->SetNumberOfTuples((iLenght > 0 && jLenght > 0) ? iLenght * jLenght : 0);
+
+    EXTRACT_ROWS_JOB job;
+    job.InputPointer = (const char *)inputScalars->GetVoidPointer(0);
+    job.OutputPointer = (char *)scalars->GetVoidPointer(0);
+    job.TupleSize = inputScalars->GetDataTypeSize() * inputScalars->GetNumberOfComponents();
+    job.ILength = iLenght;
+    job.JLength = jLenght;
+    job.IStart = iStart;
+    job.JStart = jStart;
+    job.IFactor = iFactor;
+    job.JFactor = jFactor;
+    job.BaseIndex = BaseIndex;
+
+    if (iLenght > 0 && jLenght > 0)
     {
-      for(int i = 0; i < iLenght; i++)
+      int numberOfThreads = jLenght / MIN_ROWS_PER_THREAD;
+      if (numberOfThreads > NumberOfThreads)
+        numberOfThreads = NumberOfThreads;
+      if (numberOfThreads <= 1)
+        ExtractRows(&job, 0, jLenght);
+      else
       {
-        // calculate right index
-        int index[2] = {i + iStart,j + jStart};
-        double *tuple = inputScalars->GetTuple(index[0] * iFactor + index[1] * jFactor + BaseIndex);
-        vtkIdType sid = scalars->InsertNextTuple(tuple);
+        Threader->SetNumberOfThreads(numberOfThreads);
+        Threader->SetSingleMethod(ExtractRowsThread, &job);
+        Threader->SingleMethodExecute();
       }
     }
     
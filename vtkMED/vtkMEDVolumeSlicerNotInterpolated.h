@@ -21,6 +21,7 @@
 #include "vtkMEDConfigure.h"
 #include "vtkDataSetToImageFilter.h"
 #include "vtkRectilinearGrid.h"
+#include "vtkMultiThreader.h"
 
 #define MAX_NUMBER_OF_PIECES 20
 
@@ -67,6 +68,13 @@ public:
   /** Get number of pieces */
   vtkGetMacro(NumberOfPieces,int);
 
+  /** Set the maximal number of threads used to extract the slice, 
+  by default the number of CPUs (the slice does not depend on it) */
+  vtkSetClampMacro(NumberOfThreads,int,1,VTK_MAX_THREADS);
+
+  /** Get the maximal number of threads used to extract the slice */
+  vtkGetMacro(NumberOfThreads,int);
+
 protected:
 
   /** ctor */
@@ -111,6 +119,9 @@ protected:
   double SlicePieceSpacings[MAX_NUMBER_OF_PIECES][2];        //< Slice Piece spacing
   double SlicePieceOrigins[MAX_NUMBER_OF_PIECES][3];         //< Slice Piece spacing
   int NumberOfPieces;
+
+  vtkMultiThreader *Threader;                 //< Threads extracting rows of the slice
+  int NumberOfThreads;                        //< Maximal number of threads used by the Threader
 private:
 
   void AddOutputsAttributes(int dimension, double spacing, int** dimensions, double** spacings, int size);